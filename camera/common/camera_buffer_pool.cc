@@ -7,6 +7,7 @@
 #include "camera/common/camera_buffer_pool.h"
 
 #include <optional>
+#include <utility>
 
 #include "cros-camera/common.h"
 
@@ -38,8 +39,10 @@ CameraBufferPool::Buffer& CameraBufferPool::Buffer::operator=(Buffer&& other) {
   return *this;
 }
 
-CameraBufferPool::BufferSlot::BufferSlot(ScopedBufferHandle handle)
-    : handle_(std::move(handle)) {}
+CameraBufferPool::BufferSlot::BufferSlot(CameraBufferPool* pool,
+                                         ScopedBufferHandle handle,
+                                         size_t size)
+    : pool_(pool), handle_(std::move(handle)), size_(size) {}
 
 CameraBufferPool::Buffer CameraBufferPool::BufferSlot::Acquire() {
   DCHECK(!is_acquired_);
@@ -48,6 +51,7 @@ CameraBufferPool::Buffer CameraBufferPool::BufferSlot::Acquire() {
 }
 
 void CameraBufferPool::BufferSlot::Release() {
+  base::AutoLock lock(pool_->lock_);
   DCHECK(is_acquired_);
   is_acquired_ = false;
 }
@@ -55,6 +59,8 @@ void CameraBufferPool::BufferSlot::Release() {
 const ScopedMapping& CameraBufferPool::BufferSlot::Map() {
   if (!mapping_) {
     mapping_ = std::make_optional<ScopedMapping>(*handle_);
+    base::AutoLock lock(pool_->lock_);
+    ++pool_->stats_.num_maps;
   }
   return *mapping_;
 }
@@ -64,33 +70,94 @@ void CameraBufferPool::BufferSlot::Unmap() {
 }
 
 CameraBufferPool::~CameraBufferPool() {
-  auto it =
-      std::find_if(buffer_slots_.begin(), buffer_slots_.end(),
-                   [](const BufferSlot& slot) { return slot.is_acquired(); });
-  if (it != buffer_slots_.end()) {
-    LOGF(FATAL) << "CameraBufferPool destructed when there's buffer in use";
+  size_t allocated_bytes;
+  {
+    base::AutoLock lock(lock_);
+    auto it =
+        std::find_if(buffer_slots_.begin(), buffer_slots_.end(),
+                     [](const BufferSlot& slot) { return slot.is_acquired(); });
+    if (it != buffer_slots_.end()) {
+      LOGF(FATAL) << "CameraBufferPool destructed when there's buffer in use";
+    }
+    allocated_bytes = stats_.allocated_bytes;
+  }
+  if (options_.budget && allocated_bytes > 0) {
+    options_.budget->Unreserve(allocated_bytes);
   }
 }
 
 std::optional<CameraBufferPool::Buffer> CameraBufferPool::RequestBuffer() {
-  auto it =
-      std::find_if(buffer_slots_.begin(), buffer_slots_.end(),
-                   [](const BufferSlot& slot) { return !slot.is_acquired(); });
-  if (it != buffer_slots_.end()) {
-    return it->Acquire();
-  }
-  if (buffer_slots_.size() < options_.max_num_buffers) {
-    ScopedBufferHandle handle = CameraBufferManager::AllocateScopedBuffer(
-        options_.width, options_.height, options_.format, options_.usage);
-    if (!handle) {
+  {
+    base::AutoLock lock(lock_);
+    auto it =
+        std::find_if(buffer_slots_.begin(), buffer_slots_.end(),
+                     [](const BufferSlot& slot) { return !slot.is_acquired(); });
+    if (it != buffer_slots_.end()) {
+      return it->Acquire();
+    }
+    if (buffer_slots_.size() + num_pending_allocations_ >=
+        options_.max_num_buffers) {
+      VLOGF(1) << "Buffer pool ran out of free buffers";
       return std::nullopt;
     }
-    buffer_slots_.emplace_back(std::move(handle));
-    VLOGF(1) << "Increased pool buffer count to " << buffer_slots_.size();
-    return buffer_slots_.back().Acquire();
+    ++num_pending_allocations_;
+  }
+
+  // Allocate outside |lock_| so that other threads can keep recycling the
+  // allocated buffers, and so that the budget can free buffers of this pool.
+  ScopedBufferHandle handle = CameraBufferManager::AllocateScopedBuffer(
+      options_.width, options_.height, options_.format, options_.usage);
+  size_t size = 0;
+  bool reserved = false;
+  if (handle) {
+    for (uint32_t i = 0; i < CameraBufferManager::GetNumPlanes(*handle); ++i) {
+      size += CameraBufferManager::GetPlaneSize(*handle, i);
+    }
+    reserved = !options_.budget || options_.budget->Reserve(size);
+  }
+
+  base::AutoLock lock(lock_);
+  --num_pending_allocations_;
+  if (!handle) {
+    LOGF(ERROR) << "Failed to allocate buffer";
+    return std::nullopt;
   }
-  VLOGF(1) << "Buffer pool ran out of free buffers";
-  return std::nullopt;
+  if (!reserved) {
+    VLOGF(1) << "Buffer pool ran out of memory budget";
+    return std::nullopt;
+  }
+  buffer_slots_.emplace_back(this, std::move(handle), size);
+  ++stats_.num_buffers;
+  ++stats_.num_allocations;
+  stats_.allocated_bytes += size;
+  VLOGF(1) << "Increased pool buffer count to " << buffer_slots_.size();
+  return buffer_slots_.back().Acquire();
+}
+
+size_t CameraBufferPool::ReleaseFreeBuffers() {
+  size_t freed_bytes = 0;
+  {
+    base::AutoLock lock(lock_);
+    for (auto it = buffer_slots_.begin(); it != buffer_slots_.end();) {
+      if (it->is_acquired()) {
+        ++it;
+        continue;
+      }
+      freed_bytes += it->size();
+      --stats_.num_buffers;
+      it = buffer_slots_.erase(it);
+    }
+    stats_.allocated_bytes -= freed_bytes;
+  }
+  if (options_.budget && freed_bytes > 0) {
+    options_.budget->Unreserve(freed_bytes);
+  }
+  return freed_bytes;
+}
+
+CameraBufferPool::Stats CameraBufferPool::GetStats() const {
+  base::AutoLock lock(lock_);
+  return stats_;
 }
 
 }  // namespace cros
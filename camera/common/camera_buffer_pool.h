@@ -14,14 +14,17 @@
 #include <optional>
 #include <utility>
 
+#include <base/synchronization/lock.h>
+#include <base/thread_annotations.h>
+
 #include "cros-camera/camera_buffer_manager.h"
 
 namespace cros {
 
 // CameraBufferPool owns a number of lazily allocated buffers, and provides
-// unique access to the buffer handles.  This class and its returned objects are
-// not thread-safe and the caller needs to ensure access to the buffers is
-// synchronized.
+// unique access to the buffer handles.  Buffers can be requested and released
+// from any thread.  A Buffer itself is not thread-safe, and its owner needs to
+// synchronize the access to it when sharing it across threads.
 class CameraBufferPool {
  private:
   class BufferSlot;
@@ -51,6 +54,34 @@ class CameraBufferPool {
     BufferSlot* slot_ = nullptr;
   };
 
+  // Budget accounts for the memory of the buffers allocated by one or more
+  // pools.  The methods are called without any pool lock held.
+  class Budget {
+   public:
+    virtual ~Budget() = default;
+
+    // Called before a newly allocated buffer of |size| bytes is added to a
+    // pool.  Returns false if the buffer doesn't fit in the budget, in which
+    // case the buffer is freed and the request fails.
+    virtual bool Reserve(size_t size) = 0;
+
+    // Called after buffers of |size| bytes in total are freed by a pool.
+    virtual void Unreserve(size_t size) = 0;
+  };
+
+  struct Stats {
+    // The number of buffers currently allocated in the pool.
+    size_t num_buffers = 0;
+
+    // The number of bytes currently allocated in the pool.
+    size_t allocated_bytes = 0;
+
+    // The number of buffer allocations and CPU mappings done since the pool
+    // was created.  Steady-state streaming shouldn't increase either of them.
+    size_t num_allocations = 0;
+    size_t num_maps = 0;
+  };
+
   struct Options {
     // Buffer parameters that will be used to allocate buffers with
     // CameraBufferManager.
@@ -61,6 +92,10 @@ class CameraBufferPool {
 
     // The maximum number of buffers that can be allocated in the pool.
     size_t max_num_buffers = 0;
+
+    // If set, the memory of the allocated buffers is accounted in |budget|,
+    // which must out-live the pool.
+    Budget* budget = nullptr;
   };
 
   explicit CameraBufferPool(const Options& options) : options_(options) {}
@@ -73,13 +108,22 @@ class CameraBufferPool {
   CameraBufferPool& operator=(CameraBufferPool&&) = delete;
 
   // Returns a Buffer, or nullopt if the number of buffers in use reaches
-  // maximum.  The returned Buffer cannot out-live this class.
+  // maximum or the budget is exhausted.  The returned Buffer cannot out-live
+  // this class.
   std::optional<Buffer> RequestBuffer();
 
+  // Frees the buffers that are not in use, and returns the number of bytes
+  // freed.
+  size_t ReleaseFreeBuffers();
+
+  Stats GetStats() const;
+
+  const Options& options() const { return options_; }
+
  private:
   class BufferSlot {
    public:
-    explicit BufferSlot(ScopedBufferHandle handle);
+    BufferSlot(CameraBufferPool* pool, ScopedBufferHandle handle, size_t size);
 
     Buffer Acquire();
     void Release();
@@ -88,18 +132,28 @@ class CameraBufferPool {
     void Unmap();
 
     buffer_handle_t* handle() const { return handle_.get(); }
+    size_t size() const { return size_; }
     bool is_acquired() const { return is_acquired_; }
 
    private:
+    CameraBufferPool* pool_;
     ScopedBufferHandle handle_;
+    size_t size_;
     std::optional<ScopedMapping> mapping_;
     bool is_acquired_ = false;
   };
 
-  Options options_;
+  const Options options_;
+
+  mutable base::Lock lock_;
 
   // Use std::list for pointer stability.
-  std::list<BufferSlot> buffer_slots_;
+  std::list<BufferSlot> buffer_slots_ GUARDED_BY(lock_);
+
+  // The number of buffers being allocated outside |lock_|.
+  size_t num_pending_allocations_ GUARDED_BY(lock_) = 0;
+
+  Stats stats_ GUARDED_BY(lock_);
 };
 
 }  // namespace cros
@@ -6,31 +6,67 @@
 
 #include "camera/common/camera_buffer_pool.h"
 
+#include <map>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest-death-test.h>
 #include <gtest/gtest.h>
 
+#include "common/shared_camera_buffer_pool.h"
+
 namespace cros {
 
-// Fake scoped buffer implementations.
+namespace {
+
+// The sizes of the fake buffers, in bytes.
+std::map<buffer_handle_t, size_t> g_buffer_sizes;
+
+}  // namespace
+
+// Fake scoped buffer implementations.  Each buffer has a single plane of
+// |width| * |height| bytes.
 ScopedBufferHandle CameraBufferManager::AllocateScopedBuffer(size_t width,
                                                              size_t height,
                                                              uint32_t format,
                                                              uint32_t usage) {
-  return ScopedBufferHandle(new buffer_handle_t(new native_handle_t{}));
+  auto* handle = new buffer_handle_t(new native_handle_t{});
+  g_buffer_sizes[*handle] = width * height;
+  return ScopedBufferHandle(handle);
 }
 
 void BufferHandleDeleter::operator()(buffer_handle_t* handle) {
   if (handle) {
+    g_buffer_sizes.erase(*handle);
     delete *handle;
     delete handle;
   }
 }
 
+uint32_t CameraBufferManager::GetNumPlanes(buffer_handle_t buffer) {
+  return 1;
+}
+
+size_t CameraBufferManager::GetPlaneSize(buffer_handle_t buffer,
+                                         size_t plane) {
+  return g_buffer_sizes[buffer];
+}
+
+ScopedMapping::ScopedMapping(buffer_handle_t buffer) : buf_(buffer) {}
+
 ScopedMapping::~ScopedMapping() {}
 
+ScopedMapping::ScopedMapping(ScopedMapping&& other) {
+  *this = std::move(other);
+}
+
+ScopedMapping& ScopedMapping::operator=(ScopedMapping&& other) {
+  buf_ = other.buf_;
+  other.buf_ = nullptr;
+  return *this;
+}
+
 // Tests.
 TEST(CameraBufferPoolTest, RequestAndReleaseBuffers) {
   CameraBufferPool::Options options = {
@@ -88,6 +124,103 @@ TEST(CameraBufferPoolTest, DestroyBufferPoolInUse) {
       "CameraBufferPool destructed when there's buffer in use");
 }
 
+TEST(CameraBufferPoolTest, MappingIsKeptAcrossRequests) {
+  CameraBufferPool::Options options = {
+      .width = 320,
+      .height = 240,
+      .format = HAL_PIXEL_FORMAT_YCbCr_420_888,
+      .usage = 0,
+      .max_num_buffers = 1,
+  };
+  CameraBufferPool pool(options);
+
+  for (int i = 0; i < 10; ++i) {
+    std::optional<CameraBufferPool::Buffer> buffer = pool.RequestBuffer();
+    ASSERT_TRUE(buffer.has_value());
+    buffer->Map();
+  }
+  CameraBufferPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.num_buffers, 1u);
+  EXPECT_EQ(stats.allocated_bytes, 320u * 240u);
+  EXPECT_EQ(stats.num_allocations, 1u);
+  EXPECT_EQ(stats.num_maps, 1u);
+}
+
+TEST(CameraBufferPoolTest, ReleaseFreeBuffers) {
+  CameraBufferPool::Options options = {
+      .width = 320,
+      .height = 240,
+      .format = HAL_PIXEL_FORMAT_YCbCr_420_888,
+      .usage = 0,
+      .max_num_buffers = 2,
+  };
+  CameraBufferPool pool(options);
+
+  std::optional<CameraBufferPool::Buffer> buffer1 = pool.RequestBuffer();
+  std::optional<CameraBufferPool::Buffer> buffer2 = pool.RequestBuffer();
+  ASSERT_TRUE(buffer1.has_value());
+  ASSERT_TRUE(buffer2.has_value());
+  buffer2.reset();
+  EXPECT_EQ(pool.ReleaseFreeBuffers(), 320u * 240u);
+  EXPECT_EQ(pool.GetStats().num_buffers, 1u);
+  EXPECT_EQ(pool.ReleaseFreeBuffers(), 0u);
+}
+
+TEST(SharedCameraBufferPoolTest, PoolsByBufferParameters) {
+  SharedCameraBufferPool pool;
+
+  std::optional<CameraBufferPool::Buffer> buffer1 =
+      pool.RequestBuffer(320, 240, HAL_PIXEL_FORMAT_YCbCr_420_888, 0);
+  ASSERT_TRUE(buffer1.has_value());
+  buffer_handle_t handle1 = *buffer1->handle();
+  buffer1.reset();
+
+  // A buffer with the same parameters is recycled.
+  std::optional<CameraBufferPool::Buffer> buffer2 =
+      pool.RequestBuffer(320, 240, HAL_PIXEL_FORMAT_YCbCr_420_888, 0);
+  ASSERT_TRUE(buffer2.has_value());
+  EXPECT_EQ(*buffer2->handle(), handle1);
+
+  // A buffer with different parameters comes from another pool.
+  std::optional<CameraBufferPool::Buffer> buffer3 =
+      pool.RequestBuffer(320, 240, HAL_PIXEL_FORMAT_Y8, 0);
+  ASSERT_TRUE(buffer3.has_value());
+  EXPECT_NE(*buffer3->handle(), handle1);
+
+  SharedCameraBufferPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.pools.num_buffers, 2u);
+  EXPECT_EQ(stats.pools.num_allocations, 2u);
+  EXPECT_EQ(stats.pools.allocated_bytes, 2u * 320u * 240u);
+}
+
+TEST(SharedCameraBufferPoolTest, EnforceMemoryBudget) {
+  SharedCameraBufferPool pool(/*max_total_bytes=*/2 * 320 * 240);
+
+  std::optional<CameraBufferPool::Buffer> buffer1 =
+      pool.RequestBuffer(320, 240, HAL_PIXEL_FORMAT_YCbCr_420_888, 0);
+  std::optional<CameraBufferPool::Buffer> buffer2 =
+      pool.RequestBuffer(320, 240, HAL_PIXEL_FORMAT_Y8, 0);
+  ASSERT_TRUE(buffer1.has_value());
+  ASSERT_TRUE(buffer2.has_value());
+
+  // The budget is exhausted by buffers in use.
+  EXPECT_FALSE(
+      pool.RequestBuffer(320, 240, HAL_PIXEL_FORMAT_YCbCr_420_888, 0)
+          .has_value());
+
+  // The idle buffer of another pool is evicted to make room.
+  buffer2.reset();
+  std::optional<CameraBufferPool::Buffer> buffer3 =
+      pool.RequestBuffer(320, 240, HAL_PIXEL_FORMAT_YCbCr_420_888, 0);
+  ASSERT_TRUE(buffer3.has_value());
+
+  SharedCameraBufferPool::Stats stats = pool.GetStats();
+  EXPECT_EQ(stats.pools.num_buffers, 2u);
+  EXPECT_EQ(stats.pools.allocated_bytes, 2u * 320u * 240u);
+  EXPECT_EQ(stats.peak_allocated_bytes, 2u * 320u * 240u);
+  EXPECT_EQ(stats.num_budget_overflows, 2u);
+}
+
 }  // namespace cros
 
 int main(int argc, char* argv[]) {
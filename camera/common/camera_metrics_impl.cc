@@ -131,6 +131,11 @@ constexpr int kMinTet = 1;
 constexpr int kMaxTet = 10000;
 constexpr int kTetBuckets = 50;
 
+// *** StreamManipulator metrics ***
+
+constexpr char kCameraStreamManipulatorLatency[] =
+    "ChromeOS.Camera.StreamManipulator.Latency.%s";
+
 }  // namespace
 
 // static
@@ -342,4 +347,13 @@ void CameraMetricsImpl::SendGcamAeAvgTet(int tet) {
                           kTetBuckets);
 }
 
+void CameraMetricsImpl::SendStreamManipulatorLatency(const std::string& name,
+                                                     base::TimeDelta latency) {
+  std::string key =
+      base::StringPrintf(kCameraStreamManipulatorLatency, name.c_str());
+  metrics_lib_->SendToUMA(key, latency.InMicroseconds(),
+                          kMinLatency.InMicroseconds(),
+                          kMaxLatency.InMicroseconds(), kBucketLatency);
+}
+
 }  // namespace cros
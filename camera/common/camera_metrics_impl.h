@@ -8,6 +8,7 @@
 #define CAMERA_COMMON_CAMERA_METRICS_IMPL_H_
 
 #include <memory>
+#include <string>
 
 #include <base/time/time.h>
 #include <base/process/process_metrics.h>
@@ -57,6 +58,9 @@ class CameraMetricsImpl : public CameraMetrics {
   void SendGcamAeAvgHdrRatio(int hdr_ratio) override;
   void SendGcamAeAvgTet(int tet) override;
 
+  void SendStreamManipulatorLatency(const std::string& name,
+                                    base::TimeDelta latency) override;
+
  private:
   std::unique_ptr<MetricsLibraryInterface> metrics_lib_;
 };
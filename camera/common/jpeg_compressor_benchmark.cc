@@ -0,0 +1,93 @@
+/*
+ * Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <linux/videodev2.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <base/check.h>
+
+#include "common/jpeg_compressor_impl.h"
+
+namespace cros {
+
+namespace {
+
+// Fills an NV12 frame with gradients and some noise, so that the entropy
+// coding cost is closer to that of a camera frame than a flat image.
+std::vector<uint8_t> CreateSampleNv12Frame(int width, int height) {
+  std::vector<uint8_t> frame(width * height * 3 / 2);
+  uint32_t seed = 1;
+  auto next_noise = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<int>((seed >> 16) & 0xf);
+  };
+  uint8_t* y_plane = frame.data();
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      y_plane[y * width + x] =
+          static_cast<uint8_t>((x * 255 / width + y * 64 / height) & 0xf0) +
+          next_noise();
+    }
+  }
+  uint8_t* uv_plane = frame.data() + width * height;
+  for (int y = 0; y < height / 2; ++y) {
+    for (int x = 0; x < width / 2; ++x) {
+      uv_plane[y * width + 2 * x] = static_cast<uint8_t>(x * 510 / width);
+      uv_plane[y * width + 2 * x + 1] = static_cast<uint8_t>(y * 510 / height);
+    }
+  }
+  return frame;
+}
+
+void RunJpegCompressor(benchmark::State& state, size_t max_slices) {
+  const int width = state.range(0);
+  const int height = state.range(1);
+  std::vector<uint8_t> input = CreateSampleNv12Frame(width, height);
+  std::vector<uint8_t> output(width * height * 3 / 2);
+  JpegCompressorImpl compressor(/*token=*/nullptr);
+  compressor.set_max_sw_encode_slices(max_slices);
+  uint32_t out_data_size = 0;
+  for (auto _ : state) {
+    CHECK(compressor.CompressImageFromMemory(
+        input.data(), V4L2_PIX_FMT_NV12, output.data(), output.size(), width,
+        height, /*quality=*/95, nullptr, 0, &out_data_size));
+  }
+  state.counters["jpeg_bytes"] = out_data_size;
+}
+
+}  // namespace
+
+static void BM_JpegCompressorSingleSlice(benchmark::State& state) {
+  RunJpegCompressor(state, 1);
+}
+BENCHMARK(BM_JpegCompressorSingleSlice)
+    ->Unit(benchmark::kMillisecond)
+    ->Args({640, 480})     // 0.3Mpix (VGA)
+    ->Args({1920, 1080})   // 2Mpix (1080p)
+    ->Args({2592, 1944})   // 5Mpix
+    ->Args({3264, 2448})   // 8Mpix
+    ->Args({4208, 3120});  // 13Mpix
+
+static void BM_JpegCompressorSliced(benchmark::State& state) {
+  RunJpegCompressor(state, state.range(2));
+}
+BENCHMARK(BM_JpegCompressorSliced)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime()
+    ->Args({1920, 1080, 2})
+    ->Args({1920, 1080, 4})
+    ->Args({2592, 1944, 2})
+    ->Args({2592, 1944, 4})
+    ->Args({3264, 2448, 2})
+    ->Args({3264, 2448, 4})
+    ->Args({4208, 3120, 2})
+    ->Args({4208, 3120, 4});
+
+}  // namespace cros
+
+BENCHMARK_MAIN();
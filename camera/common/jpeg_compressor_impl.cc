@@ -6,6 +6,7 @@
 
 #include "common/jpeg_compressor_impl.h"
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
@@ -14,9 +15,13 @@
 #include <linux/videodev2.h>
 #include <time.h>
 
+#include <base/bind.h>
 #include <base/check.h>
 #include <base/memory/ptr_util.h>
 #include <base/memory/writable_shared_memory_region.h>
+#include <base/strings/stringprintf.h>
+#include <base/synchronization/waitable_event.h>
+#include <base/system/sys_info.h>
 #include <base/timer/elapsed_timer.h>
 #include "cros-camera/camera_buffer_manager.h"
 #include "cros-camera/camera_mojo_channel_manager.h"
@@ -31,13 +36,104 @@ namespace cros {
 // allowed is: 65535 - 2 = 65533.
 constexpr size_t kMaxMarkerSizeAllowed = 65533;
 
-// The destination manager that can access members in JpegCompressorImpl.
+// The maximum number of slices of a software encode, which is also capped by
+// the number of CPUs.
+constexpr size_t kMaxSwEncodeSlices = 4;
+
+// Images are only split into slices of at least this many pixels, so that the
+// thread hops don't outweigh the encoding time.
+constexpr int kMinSwEncodeSlicePixels = 640 * 480;
+
+// The MCU of YUV 4:2:0 images is 16x16 pixels.
+constexpr int kMcuSize = 16;
+
+constexpr uint16_t kJpegMarkerSOF0 = 0xFFC0;
+constexpr uint16_t kJpegMarkerRST0 = 0xFFD0;
+constexpr uint16_t kJpegMarkerEOI = 0xFFD9;
+constexpr uint16_t kJpegMarkerSOS = 0xFFDA;
+constexpr uint16_t kJpegMarkerDRI = 0xFFDD;
+
+// The destination manager that writes the encoded data to a buffer provided by
+// the caller.
 struct destination_mgr {
  public:
   struct jpeg_destination_mgr mgr;
-  JpegCompressorImpl* compressor;
+
+  // Point to output buffer. JpegCompressorImpl doesn't own this buffer.
+  JOCTET* out_buffer_ptr;
+
+  // Output buffer size.
+  uint32_t out_buffer_size;
+
+  // Final JPEG encoded size.
+  uint32_t out_data_size;
+
+  // Since output buffer is passed from caller, use a variable to indicate
+  // buffer is enough to encode or not.
+  bool is_encode_success;
+};
+
+// One horizontal slice of a sliced software encode.
+struct JpegCompressorImpl::SwEncodeSlice {
+  const uint8_t* y_plane = nullptr;
+  const uint8_t* u_plane = nullptr;
+  const uint8_t* v_plane = nullptr;
+  int width = 0;
+  int height = 0;
+  int quality = 0;
+  const void* app1_buffer = nullptr;
+  unsigned int app1_size = 0;
+
+  // The slice encoded as a standalone JPEG image.
+  std::vector<uint8_t> output;
+  uint32_t output_size = 0;
+  bool success = false;
+
+  base::WaitableEvent done;
 };
 
+namespace {
+
+uint16_t ReadWord(const uint8_t* addr) {
+  return (addr[0] << 8) | addr[1];
+}
+
+uint8_t* WriteWord(uint8_t* dst, uint16_t value) {
+  dst[0] = (value >> 8) & 0xFF;
+  dst[1] = value & 0xFF;
+  return dst + 2;
+}
+
+// Finds the SOF0 and SOS segments in the JPEG image |jpeg| of |size| bytes
+// produced by libjpeg, and the start of its entropy-coded data.
+bool ParseJpegHeader(const uint8_t* jpeg,
+                     size_t size,
+                     size_t* sof0_offset,
+                     size_t* sos_offset,
+                     size_t* scan_offset) {
+  // Skip SOI.
+  size_t offset = 2;
+  bool has_sof0 = false;
+  while (offset + 4 <= size) {
+    uint16_t marker = ReadWord(jpeg + offset);
+    size_t segment_size = 2 + ReadWord(jpeg + offset + 2);
+    if (marker == kJpegMarkerSOF0) {
+      *sof0_offset = offset;
+      has_sof0 = true;
+    } else if (marker == kJpegMarkerSOS) {
+      *sos_offset = offset;
+      *scan_offset = offset + segment_size;
+      // The entropy-coded data is followed by EOI.
+      return has_sof0 && *scan_offset + 2 <= size &&
+             ReadWord(jpeg + size - 2) == kJpegMarkerEOI;
+    }
+    offset += segment_size;
+  }
+  return false;
+}
+
+}  // namespace
+
 // static
 std::unique_ptr<JpegCompressor> JpegCompressor::GetInstance() {
   return JpegCompressor::GetInstance(CameraMojoChannelManager::GetInstance());
@@ -53,12 +149,10 @@ JpegCompressorImpl::JpegCompressorImpl(CameraMojoChannelManagerToken* token)
     : camera_metrics_(CameraMetrics::New()),
       hw_encoder_(nullptr),
       hw_encoder_started_(false),
-      out_buffer_ptr_(nullptr),
-      out_buffer_size_(0),
-      out_data_size_(0),
-      is_encode_success_(false),
       force_jpeg_hw_encode_for_testing_(false),
-      mojo_manager_token_(token) {
+      mojo_manager_token_(token),
+      max_sw_encode_slices_(std::min<size_t>(
+          kMaxSwEncodeSlices, base::SysInfo::NumberOfProcessors())) {
   // Read force_jpeg_hw_enc configs
   std::unique_ptr<CameraConfig> camera_config =
       CameraConfig::Create(constants::kCrosCameraTestConfigPathString);
@@ -326,28 +420,27 @@ bool JpegCompressorImpl::GenerateThumbnail(const void* image,
 
 void JpegCompressorImpl::InitDestination(j_compress_ptr cinfo) {
   destination_mgr* dest = reinterpret_cast<destination_mgr*>(cinfo->dest);
-  dest->mgr.next_output_byte = dest->compressor->out_buffer_ptr_;
-  dest->mgr.free_in_buffer = dest->compressor->out_buffer_size_;
-  dest->compressor->is_encode_success_ = true;
+  dest->mgr.next_output_byte = dest->out_buffer_ptr;
+  dest->mgr.free_in_buffer = dest->out_buffer_size;
+  dest->is_encode_success = true;
 }
 
 boolean JpegCompressorImpl::EmptyOutputBuffer(j_compress_ptr cinfo) {
   destination_mgr* dest = reinterpret_cast<destination_mgr*>(cinfo->dest);
-  dest->mgr.next_output_byte = dest->compressor->out_buffer_ptr_;
-  dest->mgr.free_in_buffer = dest->compressor->out_buffer_size_;
-  dest->compressor->is_encode_success_ = false;
+  dest->mgr.next_output_byte = dest->out_buffer_ptr;
+  dest->mgr.free_in_buffer = dest->out_buffer_size;
+  dest->is_encode_success = false;
   // jcmarker.c in libjpeg-turbo will trigger exit(EXIT_FAILURE) if buffer is
   // not enough to fill marker. If we want to solve this failure, we have to
   // override cinfo.err->error_exit. It's too complicated. Therefore, we use a
-  // variable |is_encode_success_| to indicate error and always return true
+  // variable |is_encode_success| to indicate error and always return true
   // here.
   return true;
 }
 
 void JpegCompressorImpl::TerminateDestination(j_compress_ptr cinfo) {
   destination_mgr* dest = reinterpret_cast<destination_mgr*>(cinfo->dest);
-  dest->compressor->out_data_size_ =
-      dest->compressor->out_buffer_size_ - dest->mgr.free_in_buffer;
+  dest->out_data_size = dest->out_buffer_size - dest->mgr.free_in_buffer;
 }
 
 void JpegCompressorImpl::OutputErrorMessage(j_common_ptr cinfo) {
@@ -443,9 +536,6 @@ bool JpegCompressorImpl::EncodeLegacy(const void* inYuv,
                                       void* out_buffer,
                                       uint32_t* out_data_size) {
   base::ElapsedTimer timer;
-  out_buffer_ptr_ = static_cast<JOCTET*>(out_buffer);
-  out_buffer_size_ = out_buffer_size;
-
   jpeg_compress_struct cinfo;
   jpeg_error_mgr jerr;
 
@@ -453,7 +543,8 @@ bool JpegCompressorImpl::EncodeLegacy(const void* inYuv,
   // Override output_message() to print error log with ALOGE().
   cinfo.err->output_message = &OutputErrorMessage;
   jpeg_create_compress(&cinfo);
-  SetJpegDestination(&cinfo);
+  SetJpegDestination(&cinfo, out_buffer, out_buffer_size);
+  destination_mgr* dest = reinterpret_cast<destination_mgr*>(cinfo.dest);
 
   SetJpegCompressStruct(width, height, jpeg_quality, &cinfo);
   jpeg_start_compress(&cinfo, TRUE);
@@ -463,25 +554,28 @@ bool JpegCompressorImpl::EncodeLegacy(const void* inYuv,
                       static_cast<const JOCTET*>(app1_buffer), app1_size);
   }
 
-  if (!Compress(&cinfo, static_cast<const uint8_t*>(inYuv))) {
-    is_encode_success_ = false;
+  const uint8_t* y_plane = static_cast<const uint8_t*>(inYuv);
+  size_t y_plane_size = width * height;
+  if (!Compress(&cinfo, y_plane, y_plane + y_plane_size,
+                y_plane + y_plane_size + y_plane_size / 4)) {
+    dest->is_encode_success = false;
   }
 
   jpeg_finish_compress(&cinfo);
-  jpeg_destroy_compress(&cinfo);
-
-  if (is_encode_success_) {
-    *out_data_size = out_data_size_;
+  bool is_encode_success = dest->is_encode_success;
+  if (is_encode_success) {
+    *out_data_size = dest->out_data_size;
   }
+  jpeg_destroy_compress(&cinfo);
 
-  if (is_encode_success_) {
+  if (is_encode_success) {
     camera_metrics_->SendJpegProcessLatency(JpegProcessType::kEncode,
                                             JpegProcessMethod::kSoftware,
                                             timer.Elapsed());
     camera_metrics_->SendJpegResolution(
         JpegProcessType::kEncode, JpegProcessMethod::kSoftware, width, height);
   }
-  return is_encode_success_;
+  return is_encode_success;
 }
 
 bool JpegCompressorImpl::EncodeHw(buffer_handle_t input_handle,
@@ -627,9 +721,45 @@ bool JpegCompressorImpl::EncodeSw(const android_ycbcr& input_ycbcr,
     return false;
   }
 
-  out_buffer_ptr_ = static_cast<JOCTET*>(output_ptr);
-  out_buffer_size_ = output_buffer_size;
+  bool is_success = false;
+  size_t num_slices = GetNumSwEncodeSlices(width, height);
+  if (num_slices > 1) {
+    is_success = EncodeI420Sliced(i420_buffer.data(), width, height,
+                                  jpeg_quality, app1_buffer, app1_size,
+                                  output_ptr, output_buffer_size, num_slices,
+                                  out_data_size);
+    if (!is_success) {
+      LOGF(WARNING) << "Sliced SW encode failed. Fall back to whole image";
+    }
+  }
+  if (!is_success) {
+    is_success = EncodeI420(i420_y_plane, i420_u_plane, i420_v_plane, width,
+                            height, jpeg_quality, app1_buffer, app1_size,
+                            output_ptr, output_buffer_size, out_data_size);
+  }
 
+  if (is_success) {
+    camera_metrics_->SendJpegProcessLatency(JpegProcessType::kEncode,
+                                            JpegProcessMethod::kSoftware,
+                                            timer.Elapsed());
+    camera_metrics_->SendJpegResolution(
+        JpegProcessType::kEncode, JpegProcessMethod::kSoftware, width, height);
+  }
+  return is_success;
+}
+
+// static
+bool JpegCompressorImpl::EncodeI420(const uint8_t* y_plane,
+                                    const uint8_t* u_plane,
+                                    const uint8_t* v_plane,
+                                    int width,
+                                    int height,
+                                    int jpeg_quality,
+                                    const void* app1_buffer,
+                                    unsigned int app1_size,
+                                    void* output_ptr,
+                                    uint32_t output_buffer_size,
+                                    uint32_t* out_data_size) {
   jpeg_compress_struct cinfo;
   jpeg_error_mgr jerr;
 
@@ -637,7 +767,8 @@ bool JpegCompressorImpl::EncodeSw(const android_ycbcr& input_ycbcr,
   // Override output_message() to print error log with ALOGE().
   cinfo.err->output_message = &OutputErrorMessage;
   jpeg_create_compress(&cinfo);
-  SetJpegDestination(&cinfo);
+  SetJpegDestination(&cinfo, output_ptr, output_buffer_size);
+  destination_mgr* dest = reinterpret_cast<destination_mgr*>(cinfo.dest);
 
   SetJpegCompressStruct(width, height, jpeg_quality, &cinfo);
 
@@ -653,34 +784,189 @@ bool JpegCompressorImpl::EncodeSw(const android_ycbcr& input_ycbcr,
                       static_cast<const JOCTET*>(app1_buffer), app1_size);
   }
 
-  if (!Compress(&cinfo, static_cast<const uint8_t*>(i420_y_plane))) {
-    is_encode_success_ = false;
+  if (!Compress(&cinfo, y_plane, u_plane, v_plane)) {
+    dest->is_encode_success = false;
   }
   jpeg_finish_compress(&cinfo);
+  bool is_encode_success = dest->is_encode_success;
+  if (is_encode_success) {
+    *out_data_size = dest->out_data_size;
+  }
   jpeg_destroy_compress(&cinfo);
+  return is_encode_success;
+}
 
-  if (is_encode_success_) {
-    *out_data_size = out_data_size_;
-    camera_metrics_->SendJpegProcessLatency(JpegProcessType::kEncode,
-                                            JpegProcessMethod::kSoftware,
-                                            timer.Elapsed());
-    camera_metrics_->SendJpegResolution(
-        JpegProcessType::kEncode, JpegProcessMethod::kSoftware, width, height);
+bool JpegCompressorImpl::EncodeI420Sliced(const uint8_t* i420,
+                                          int width,
+                                          int height,
+                                          int jpeg_quality,
+                                          const void* app1_buffer,
+                                          unsigned int app1_size,
+                                          void* output_ptr,
+                                          uint32_t output_buffer_size,
+                                          size_t num_slices,
+                                          uint32_t* out_data_size) {
+  // All the slices but the last one are made of whole MCU rows, so that each
+  // of them is exactly one restart interval.
+  const int mcus_per_row = (width + kMcuSize - 1) / kMcuSize;
+  const int mcu_rows = (height + kMcuSize - 1) / kMcuSize;
+  const int mcu_rows_per_slice =
+      (mcu_rows + static_cast<int>(num_slices) - 1) /
+      static_cast<int>(num_slices);
+  const int restart_interval = mcus_per_row * mcu_rows_per_slice;
+  if (restart_interval > 0xFFFF) {
+    VLOGF(1) << "Restart interval " << restart_interval << " is too large";
+    return false;
+  }
+  num_slices = (mcu_rows + mcu_rows_per_slice - 1) / mcu_rows_per_slice;
+
+  std::vector<scoped_refptr<base::SingleThreadTaskRunner>> task_runners;
+  {
+    base::AutoLock lock(sw_encode_threads_lock_);
+    while (sw_encode_threads_.size() < num_slices - 1) {
+      auto thread = std::make_unique<base::Thread>(base::StringPrintf(
+          "JpegSliceEncoder%zu", sw_encode_threads_.size()));
+      if (!thread->Start()) {
+        LOGF(ERROR) << "Failed to start slice encoder thread";
+        return false;
+      }
+      sw_encode_threads_.push_back(std::move(thread));
+    }
+    for (size_t i = 0; i < num_slices - 1; ++i) {
+      task_runners.push_back(sw_encode_threads_[i]->task_runner());
+    }
+  }
+
+  const uint8_t* y_plane = i420;
+  const uint8_t* u_plane = y_plane + width * height;
+  const uint8_t* v_plane = u_plane + width * height / 4;
+  std::vector<SwEncodeSlice> slices(num_slices);
+  for (size_t i = 0; i < num_slices; ++i) {
+    SwEncodeSlice& slice = slices[i];
+    int top = static_cast<int>(i) * mcu_rows_per_slice * kMcuSize;
+    slice.y_plane = y_plane + top * width;
+    slice.u_plane = u_plane + (top / 2) * (width / 2);
+    slice.v_plane = v_plane + (top / 2) * (width / 2);
+    slice.width = width;
+    slice.height = std::min(mcu_rows_per_slice * kMcuSize, height - top);
+    slice.quality = jpeg_quality;
+    // Only the headers of the first slice are kept.
+    if (i == 0) {
+      slice.app1_buffer = app1_buffer;
+      slice.app1_size = app1_size;
+    }
+    // Leave room for incompressible data and the headers.
+    slice.output.resize(slice.width * slice.height * 3 / 2 + app1_size + 4096);
+    if (i > 0) {
+      task_runners[i - 1]->PostTask(
+          FROM_HERE,
+          base::BindOnce(&JpegCompressorImpl::EncodeSlice, &slice));
+    }
   }
-  return is_encode_success_;
+  EncodeSlice(&slices[0]);
+  bool success = true;
+  for (auto& slice : slices) {
+    slice.done.Wait();
+    success &= slice.success;
+  }
+  if (!success) {
+    LOGF(ERROR) << "Failed to encode JPEG slices";
+    return false;
+  }
+
+  // Stitch the slices into one image: the headers of the first slice, with the
+  // full image height and a DRI segment, and the entropy-coded data of all the
+  // slices separated by restart markers.
+  std::vector<size_t> scan_offsets(num_slices);
+  size_t sof0_offset = 0, sos_offset = 0;
+  size_t total_size = 0;
+  for (size_t i = 0; i < num_slices; ++i) {
+    size_t slice_sof0_offset, slice_sos_offset;
+    if (!ParseJpegHeader(slices[i].output.data(), slices[i].output_size,
+                         &slice_sof0_offset, &slice_sos_offset,
+                         &scan_offsets[i])) {
+      LOGF(ERROR) << "Failed to parse JPEG slice " << i;
+      return false;
+    }
+    if (i == 0) {
+      sof0_offset = slice_sof0_offset;
+      sos_offset = slice_sos_offset;
+      // The headers, DRI and SOS segments.
+      total_size += scan_offsets[0] + 6;
+    } else {
+      // The RSTn marker.
+      total_size += 2;
+    }
+    // The entropy-coded data without EOI.
+    total_size += slices[i].output_size - 2 - scan_offsets[i];
+  }
+  // EOI.
+  total_size += 2;
+  if (total_size > output_buffer_size) {
+    LOGF(ERROR) << "Output buffer is too small: " << output_buffer_size
+                << " < " << total_size;
+    return false;
+  }
+
+  const uint8_t* header = slices[0].output.data();
+  uint8_t* dst = static_cast<uint8_t*>(output_ptr);
+  dst = std::copy(header, header + sos_offset, dst);
+  // The image height follows the marker, length and sample precision of SOF0.
+  WriteWord(static_cast<uint8_t*>(output_ptr) + sof0_offset + 5, height);
+  dst = WriteWord(dst, kJpegMarkerDRI);
+  dst = WriteWord(dst, 4);
+  dst = WriteWord(dst, restart_interval);
+  for (size_t i = 0; i < num_slices; ++i) {
+    const uint8_t* src = slices[i].output.data();
+    if (i == 0) {
+      dst = std::copy(src + sos_offset, src + scan_offsets[0], dst);
+    } else {
+      dst = WriteWord(dst,
+                      kJpegMarkerRST0 + static_cast<uint16_t>((i - 1) % 8));
+    }
+    dst = std::copy(src + scan_offsets[i], src + slices[i].output_size - 2,
+                    dst);
+  }
+  dst = WriteWord(dst, kJpegMarkerEOI);
+  *out_data_size = dst - static_cast<uint8_t*>(output_ptr);
+  DCHECK_EQ(*out_data_size, total_size);
+  VLOGF(1) << "Encoded JPEG in " << num_slices << " slices";
+  return true;
 }
 
-void JpegCompressorImpl::SetJpegDestination(jpeg_compress_struct* cinfo) {
+// static
+void JpegCompressorImpl::EncodeSlice(SwEncodeSlice* slice) {
+  slice->success = EncodeI420(
+      slice->y_plane, slice->u_plane, slice->v_plane, slice->width,
+      slice->height, slice->quality, slice->app1_buffer, slice->app1_size,
+      slice->output.data(), slice->output.size(), &slice->output_size);
+  slice->done.Signal();
+}
+
+size_t JpegCompressorImpl::GetNumSwEncodeSlices(int width, int height) const {
+  size_t num_slices = std::min<size_t>(
+      max_sw_encode_slices_, width * height / kMinSwEncodeSlicePixels);
+  return std::max<size_t>(num_slices, 1);
+}
+
+// static
+void JpegCompressorImpl::SetJpegDestination(jpeg_compress_struct* cinfo,
+                                            void* out_buffer,
+                                            uint32_t out_buffer_size) {
   destination_mgr* dest =
       static_cast<struct destination_mgr*>((*cinfo->mem->alloc_small)(
           (j_common_ptr)cinfo, JPOOL_PERMANENT, sizeof(destination_mgr)));
-  dest->compressor = this;
+  dest->out_buffer_ptr = static_cast<JOCTET*>(out_buffer);
+  dest->out_buffer_size = out_buffer_size;
+  dest->out_data_size = 0;
+  dest->is_encode_success = false;
   dest->mgr.init_destination = &InitDestination;
   dest->mgr.empty_output_buffer = &EmptyOutputBuffer;
   dest->mgr.term_destination = &TerminateDestination;
   cinfo->dest = reinterpret_cast<struct jpeg_destination_mgr*>(dest);
 }
 
+// static
 void JpegCompressorImpl::SetJpegCompressStruct(int width,
                                                int height,
                                                int quality,
@@ -706,18 +992,19 @@ void JpegCompressorImpl::SetJpegCompressStruct(int width,
   cinfo->comp_info[2].v_samp_factor = 1;
 }
 
+// static
 bool JpegCompressorImpl::Compress(jpeg_compress_struct* cinfo,
-                                  const uint8_t* yuv) {
+                                  const uint8_t* y_plane_ptr,
+                                  const uint8_t* u_plane_ptr,
+                                  const uint8_t* v_plane_ptr) {
   JSAMPROW y[kCompressBatchSize];
   JSAMPROW cb[kCompressBatchSize / 2];
   JSAMPROW cr[kCompressBatchSize / 2];
   JSAMPARRAY planes[3]{y, cb, cr};
 
-  size_t y_plane_size = cinfo->image_width * cinfo->image_height;
-  size_t uv_plane_size = y_plane_size / 4;
-  uint8_t* y_plane = const_cast<uint8_t*>(yuv);
-  uint8_t* u_plane = const_cast<uint8_t*>(yuv + y_plane_size);
-  uint8_t* v_plane = const_cast<uint8_t*>(yuv + y_plane_size + uv_plane_size);
+  uint8_t* y_plane = const_cast<uint8_t*>(y_plane_ptr);
+  uint8_t* u_plane = const_cast<uint8_t*>(u_plane_ptr);
+  uint8_t* v_plane = const_cast<uint8_t*>(v_plane_ptr);
   std::unique_ptr<uint8_t[]> empty(new uint8_t[cinfo->image_width]);
   memset(empty.get(), 0, cinfo->image_width);
 
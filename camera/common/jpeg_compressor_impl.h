@@ -22,18 +22,33 @@ extern "C" {
 #include <jpeglib.h>
 }
 
+#include <base/synchronization/lock.h>
+#include <base/thread_annotations.h>
+#include <base/threading/thread.h>
+
 #include "cros-camera/camera_metrics.h"
 
 namespace cros {
 
 class JpegEncodeAccelerator;
 
-// Implementation of JpegCompressor. This class is not thread-safe.
+// Implementation of JpegCompressor. This class is not thread-safe, except that
+// CompressImageFromMemory() can run concurrently with the other methods.
+//
+// Large images are encoded by software in horizontal slices on multiple
+// threads.  Each slice is an independent entropy-coded segment, and the slices
+// are stitched together with restart markers into a baseline JPEG.
 class JpegCompressorImpl : public JpegCompressor {
  public:
   explicit JpegCompressorImpl(CameraMojoChannelManagerToken* token);
   ~JpegCompressorImpl() override;
 
+  // Sets the maximum number of slices a software encode is split into.  1
+  // disables the sliced encoding.
+  void set_max_sw_encode_slices(size_t max_slices) {
+    max_sw_encode_slices_ = max_slices;
+  }
+
   // To be deprecated.
   bool CompressImage(const void* image,
                      int width,
@@ -80,7 +95,8 @@ class JpegCompressorImpl : public JpegCompressor {
 
  private:
   // InitDestination(), EmptyOutputBuffer() and TerminateDestination() are
-  // callback functions to be passed into jpeg library.
+  // callback functions to be passed into jpeg library.  The destination state
+  // lives in |cinfo|, so concurrent software encodes don't interfere.
   static void InitDestination(j_compress_ptr cinfo);
   static boolean EmptyOutputBuffer(j_compress_ptr cinfo);
   static void TerminateDestination(j_compress_ptr cinfo);
@@ -128,13 +144,55 @@ class JpegCompressorImpl : public JpegCompressor {
                 unsigned int app1_size,
                 uint32_t* out_data_size);
 
-  void SetJpegDestination(jpeg_compress_struct* cinfo);
-  void SetJpegCompressStruct(int width,
-                             int height,
-                             int quality,
-                             jpeg_compress_struct* cinfo);
+  // Encodes the I420 image in |y_plane|, |u_plane| and |v_plane|, whose rows
+  // are |width| and |width| / 2 bytes long, into |output_ptr|.  Returns false
+  // if errors occur.
+  static bool EncodeI420(const uint8_t* y_plane,
+                         const uint8_t* u_plane,
+                         const uint8_t* v_plane,
+                         int width,
+                         int height,
+                         int jpeg_quality,
+                         const void* app1_buffer,
+                         unsigned int app1_size,
+                         void* output_ptr,
+                         uint32_t output_buffer_size,
+                         uint32_t* out_data_size);
+
+  // Encodes the contiguous I420 image |i420| in |num_slices| slices in
+  // parallel.  Returns false if the image can't be sliced or errors occur, in
+  // which case the caller should encode it as a whole.
+  bool EncodeI420Sliced(const uint8_t* i420,
+                        int width,
+                        int height,
+                        int jpeg_quality,
+                        const void* app1_buffer,
+                        unsigned int app1_size,
+                        void* output_ptr,
+                        uint32_t output_buffer_size,
+                        size_t num_slices,
+                        uint32_t* out_data_size);
+
+  struct SwEncodeSlice;
+
+  // Encodes |slice| as a standalone JPEG image and signals |slice->done|.
+  static void EncodeSlice(SwEncodeSlice* slice);
+
+  // Returns the number of slices to encode a |width|x|height| image in.
+  size_t GetNumSwEncodeSlices(int width, int height) const;
+
+  static void SetJpegDestination(jpeg_compress_struct* cinfo,
+                                 void* out_buffer,
+                                 uint32_t out_buffer_size);
+  static void SetJpegCompressStruct(int width,
+                                    int height,
+                                    int quality,
+                                    jpeg_compress_struct* cinfo);
   // Returns false if errors occur.
-  bool Compress(jpeg_compress_struct* cinfo, const uint8_t* yuv);
+  static bool Compress(jpeg_compress_struct* cinfo,
+                       const uint8_t* y_plane,
+                       const uint8_t* u_plane,
+                       const uint8_t* v_plane);
 
   // Metrics that used to record things like encoding latency.
   std::unique_ptr<CameraMetrics> camera_metrics_;
@@ -146,18 +204,14 @@ class JpegCompressorImpl : public JpegCompressor {
   // We must pass at least 16 scanlines according to libjpeg documentation.
   static const int kCompressBatchSize = 16;
 
-  // Point to output buffer. JpegCompressorImpl doesn't own this buffer.
-  JOCTET* out_buffer_ptr_;
-
-  // Output buffer size.
-  uint32_t out_buffer_size_;
-
-  // Final JPEG encoded size.
-  uint32_t out_data_size_;
+  // The maximum number of slices of a software encode.
+  size_t max_sw_encode_slices_;
 
-  // Since output buffer is passed from caller, use a variable to indicate
-  // buffer is enough to encode or not.
-  bool is_encode_success_;
+  // The threads encoding the slices other than the first one, which is
+  // encoded on the calling thread.  Created on the first sliced encode.
+  base::Lock sw_encode_threads_lock_;
+  std::vector<std::unique_ptr<base::Thread>> sw_encode_threads_
+      GUARDED_BY(sw_encode_threads_lock_);
 
   // Flag to disable SW encode fallback when HW encode failed
   bool force_jpeg_hw_encode_for_testing_;
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "common/jpeg_compressor_impl.h"
+
+#include <linux/videodev2.h>
+
+#include <vector>
+
+#include <base/at_exit.h>
+#include <gtest/gtest.h>
+
+namespace cros {
+
+namespace {
+
+// Large enough to be split into up to 4 slices. 1000 is not a multiple of the
+// height of the slices of any of the tested slice counts.
+constexpr int kWidth = 1280;
+constexpr int kHeight = 1000;
+constexpr int kQuality = 90;
+
+// Fills an NV12 frame with gradients and some noise.
+std::vector<uint8_t> CreateSampleNv12Frame(int width, int height) {
+  std::vector<uint8_t> frame(width * height * 3 / 2);
+  uint32_t seed = 1;
+  auto next_noise = [&seed]() {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<int>((seed >> 16) & 0xf);
+  };
+  uint8_t* y_plane = frame.data();
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      y_plane[y * width + x] =
+          static_cast<uint8_t>((x * 255 / width + y * 64 / height) & 0xf0) +
+          next_noise();
+    }
+  }
+  uint8_t* uv_plane = frame.data() + width * height;
+  for (int y = 0; y < height / 2; ++y) {
+    for (int x = 0; x < width / 2; ++x) {
+      uv_plane[y * width + 2 * x] = static_cast<uint8_t>(x * 510 / width);
+      uv_plane[y * width + 2 * x + 1] = static_cast<uint8_t>(y * 510 / height);
+    }
+  }
+  return frame;
+}
+
+// Returns the number of restart markers in |jpeg|. Bytes 0xFF of the
+// entropy-coded data are followed by 0x00, so they can't be mistaken for one.
+size_t CountRestartMarkers(const std::vector<uint8_t>& jpeg) {
+  size_t count = 0;
+  for (size_t i = 0; i + 1 < jpeg.size(); ++i) {
+    if (jpeg[i] == 0xFF && jpeg[i + 1] >= 0xD0 && jpeg[i + 1] <= 0xD7) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+// Decodes |jpeg| with libjpeg into interleaved YCbCr pixels. Returns an empty
+// vector on failure.
+std::vector<uint8_t> DecodeJpeg(const std::vector<uint8_t>& jpeg,
+                                int* width,
+                                int* height) {
+  jpeg_decompress_struct dinfo;
+  jpeg_error_mgr jerr;
+  dinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&dinfo);
+  jpeg_mem_src(&dinfo, jpeg.data(), jpeg.size());
+  if (jpeg_read_header(&dinfo, TRUE) != JPEG_HEADER_OK) {
+    jpeg_destroy_decompress(&dinfo);
+    return {};
+  }
+  dinfo.out_color_space = JCS_YCbCr;
+  jpeg_start_decompress(&dinfo);
+  *width = dinfo.output_width;
+  *height = dinfo.output_height;
+  const size_t row_size = dinfo.output_width * dinfo.output_components;
+  std::vector<uint8_t> pixels(row_size * dinfo.output_height);
+  while (dinfo.output_scanline < dinfo.output_height) {
+    JSAMPROW row = pixels.data() + dinfo.output_scanline * row_size;
+    jpeg_read_scanlines(&dinfo, &row, 1);
+  }
+  const bool warned = jerr.num_warnings > 0;
+  jpeg_finish_decompress(&dinfo);
+  jpeg_destroy_decompress(&dinfo);
+  return warned ? std::vector<uint8_t>() : pixels;
+}
+
+}  // namespace
+
+class JpegCompressorImplTest : public testing::Test {
+ protected:
+  // Encodes |input_| by software in at most |max_slices| slices.
+  std::vector<uint8_t> Encode(size_t max_slices) {
+    JpegCompressorImpl compressor(/*token=*/nullptr);
+    compressor.set_max_sw_encode_slices(max_slices);
+    std::vector<uint8_t> output(kWidth * kHeight * 3 / 2);
+    uint32_t out_data_size = 0;
+    EXPECT_TRUE(compressor.CompressImageFromMemory(
+        input_.data(), V4L2_PIX_FMT_NV12, output.data(), output.size(), kWidth,
+        kHeight, kQuality, nullptr, 0, &out_data_size));
+    output.resize(out_data_size);
+    return output;
+  }
+
+  const std::vector<uint8_t> input_ = CreateSampleNv12Frame(kWidth, kHeight);
+};
+
+TEST_F(JpegCompressorImplTest, SlicedEncodeMatchesSingleSlice) {
+  const std::vector<uint8_t> single_slice_jpeg = Encode(1);
+  ASSERT_EQ(CountRestartMarkers(single_slice_jpeg), 0u);
+  int width = 0, height = 0;
+  const std::vector<uint8_t> expected_pixels =
+      DecodeJpeg(single_slice_jpeg, &width, &height);
+  ASSERT_FALSE(expected_pixels.empty());
+  EXPECT_EQ(width, kWidth);
+  EXPECT_EQ(height, kHeight);
+
+  for (size_t num_slices : {2u, 3u, 4u}) {
+    SCOPED_TRACE(num_slices);
+    const std::vector<uint8_t> sliced_jpeg = Encode(num_slices);
+    // The slices are separated by restart markers.
+    EXPECT_EQ(CountRestartMarkers(sliced_jpeg), num_slices - 1);
+
+    // The slices only reset the DC prediction, so the decoded image is the
+    // same as the one encoded in a single slice.
+    width = height = 0;
+    const std::vector<uint8_t> pixels =
+        DecodeJpeg(sliced_jpeg, &width, &height);
+    ASSERT_FALSE(pixels.empty());
+    EXPECT_EQ(width, kWidth);
+    EXPECT_EQ(height, kHeight);
+    EXPECT_TRUE(pixels == expected_pixels);
+  }
+}
+
+}  // namespace cros
+
+int main(int argc, char** argv) {
+  base::AtExitManager exit_manager;
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
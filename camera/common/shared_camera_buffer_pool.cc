@@ -0,0 +1,119 @@
+/*
+ * Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "common/shared_camera_buffer_pool.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "cros-camera/common.h"
+
+namespace cros {
+
+SharedCameraBufferPool::SharedCameraBufferPool(size_t max_total_bytes)
+    : max_total_bytes_(max_total_bytes) {}
+
+SharedCameraBufferPool::~SharedCameraBufferPool() {
+  // The pools give their budget back when destroyed, which takes |lock_|.
+  std::map<PoolKey, std::unique_ptr<CameraBufferPool>> pools;
+  {
+    base::AutoLock lock(lock_);
+    pools.swap(pools_);
+  }
+  pools.clear();
+}
+
+std::optional<CameraBufferPool::Buffer> SharedCameraBufferPool::RequestBuffer(
+    uint32_t width, uint32_t height, uint32_t format, uint32_t usage) {
+  CameraBufferPool* pool;
+  {
+    base::AutoLock lock(lock_);
+    std::unique_ptr<CameraBufferPool>& entry =
+        pools_[std::make_tuple(width, height, format, usage)];
+    if (!entry) {
+      // The number of buffers is bounded by the budget only.
+      entry = std::make_unique<CameraBufferPool>(CameraBufferPool::Options{
+          .width = width,
+          .height = height,
+          .format = format,
+          .usage = usage,
+          .max_num_buffers = std::numeric_limits<size_t>::max(),
+          .budget = this,
+      });
+    }
+    pool = entry.get();
+  }
+  return pool->RequestBuffer();
+}
+
+size_t SharedCameraBufferPool::ReleaseFreeBuffers() {
+  std::vector<CameraBufferPool*> pools;
+  {
+    base::AutoLock lock(lock_);
+    for (auto& [key, pool] : pools_) {
+      pools.push_back(pool.get());
+    }
+  }
+  size_t freed_bytes = 0;
+  for (auto* pool : pools) {
+    freed_bytes += pool->ReleaseFreeBuffers();
+  }
+  return freed_bytes;
+}
+
+SharedCameraBufferPool::Stats SharedCameraBufferPool::GetStats() const {
+  base::AutoLock lock(lock_);
+  Stats stats = {
+      .peak_allocated_bytes = peak_reserved_bytes_,
+      .num_budget_overflows = num_budget_overflows_,
+  };
+  for (auto& [key, pool] : pools_) {
+    CameraBufferPool::Stats pool_stats = pool->GetStats();
+    stats.pools.num_buffers += pool_stats.num_buffers;
+    stats.pools.allocated_bytes += pool_stats.allocated_bytes;
+    stats.pools.num_allocations += pool_stats.num_allocations;
+    stats.pools.num_maps += pool_stats.num_maps;
+  }
+  return stats;
+}
+
+bool SharedCameraBufferPool::Reserve(size_t size) {
+  {
+    base::AutoLock lock(lock_);
+    if (reserved_bytes_ + size <= max_total_bytes_) {
+      reserved_bytes_ += size;
+      peak_reserved_bytes_ = std::max(peak_reserved_bytes_, reserved_bytes_);
+      return true;
+    }
+    ++num_budget_overflows_;
+  }
+
+  // Make room by evicting the idle buffers, which may belong to streams that
+  // are no longer configured.
+  size_t freed_bytes = ReleaseFreeBuffers();
+  VLOGF(1) << "Buffer budget exceeded; released " << freed_bytes << " bytes";
+
+  base::AutoLock lock(lock_);
+  if (reserved_bytes_ + size > max_total_bytes_) {
+    LOGF(WARNING) << "Failed to reserve " << size << " bytes: "
+                  << reserved_bytes_ << " of " << max_total_bytes_
+                  << " bytes in use";
+    return false;
+  }
+  reserved_bytes_ += size;
+  peak_reserved_bytes_ = std::max(peak_reserved_bytes_, reserved_bytes_);
+  return true;
+}
+
+void SharedCameraBufferPool::Unreserve(size_t size) {
+  base::AutoLock lock(lock_);
+  DCHECK_GE(reserved_bytes_, size);
+  reserved_bytes_ -= size;
+}
+
+}  // namespace cros
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef CAMERA_COMMON_SHARED_CAMERA_BUFFER_POOL_H_
+#define CAMERA_COMMON_SHARED_CAMERA_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+
+#include <base/synchronization/lock.h>
+#include <base/thread_annotations.h>
+
+#include "common/camera_buffer_pool.h"
+
+namespace cros {
+
+// SharedCameraBufferPool recycles camera buffers across the stream
+// manipulators of all the camera devices.  Buffers are pooled by their
+// (width, height, format, usage) and keep their CPU mapping across requests,
+// so a stage can hand a buffer over to the next one by moving the
+// CameraBufferPool::Buffer instead of copying the pixels.
+//
+// The total size of the pooled buffers is capped by a memory budget.  When an
+// allocation doesn't fit, the free buffers of all the pools are released
+// before the request fails.
+//
+// The class is thread-safe, and must out-live all the Buffers it returns.
+class SharedCameraBufferPool : private CameraBufferPool::Budget {
+ public:
+  static constexpr size_t kDefaultMaxTotalBytes = 256 * 1024 * 1024;
+
+  struct Stats {
+    // The sums of the CameraBufferPool::Stats of all the pools.
+    CameraBufferPool::Stats pools;
+
+    // The peak of |pools.allocated_bytes|.
+    size_t peak_allocated_bytes = 0;
+
+    // The number of allocations that failed or freed other buffers because of
+    // the budget.
+    size_t num_budget_overflows = 0;
+  };
+
+  explicit SharedCameraBufferPool(
+      size_t max_total_bytes = kDefaultMaxTotalBytes);
+  ~SharedCameraBufferPool() override;
+
+  SharedCameraBufferPool(const SharedCameraBufferPool&) = delete;
+  SharedCameraBufferPool& operator=(const SharedCameraBufferPool&) = delete;
+
+  // Returns a buffer with the given parameters, or nullopt if the allocation
+  // failed or didn't fit in the budget.
+  std::optional<CameraBufferPool::Buffer> RequestBuffer(uint32_t width,
+                                                        uint32_t height,
+                                                        uint32_t format,
+                                                        uint32_t usage);
+
+  // Frees the buffers that are not in use, e.g. when a stream configuration
+  // is torn down.  Returns the number of bytes freed.
+  size_t ReleaseFreeBuffers();
+
+  Stats GetStats() const;
+
+ private:
+  using PoolKey = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>;
+
+  // CameraBufferPool::Budget implementations.
+  bool Reserve(size_t size) override;
+  void Unreserve(size_t size) override;
+
+  const size_t max_total_bytes_;
+
+  mutable base::Lock lock_;
+
+  // The pools are only destroyed with this class, so they can be accessed
+  // outside |lock_| once looked up.
+  std::map<PoolKey, std::unique_ptr<CameraBufferPool>> pools_ GUARDED_BY(lock_);
+
+  size_t reserved_bytes_ GUARDED_BY(lock_) = 0;
+  size_t peak_reserved_bytes_ GUARDED_BY(lock_) = 0;
+  size_t num_budget_overflows_ GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace cros
+
+#endif  // CAMERA_COMMON_SHARED_CAMERA_BUFFER_POOL_H_
@@ -237,6 +237,8 @@ inline uint8_t* WriteTwoBytes(uint8_t* dst, uint16_t value) {
 StillCaptureProcessorImpl::StillCaptureProcessorImpl(
     std::unique_ptr<JpegCompressor> jpeg_compressor)
     : thread_("StillCaptureProcessorImplThread"),
+      encode_thread_("StillCaptureEncodeThread"),
+      thumbnail_thread_("StillCaptureThumbnailThread"),
       jpeg_compressor_(std::move(jpeg_compressor)) {}
 
 StillCaptureProcessorImpl::~StillCaptureProcessorImpl() {
@@ -250,10 +252,18 @@ void StillCaptureProcessorImpl::Initialize(
   result_callback_ = std::move(result_callback);
   request_contexts_.clear();
   CHECK(thread_.Start());
+  CHECK(encode_thread_.Start());
+  CHECK(thumbnail_thread_.Start());
+  task_runner_ = thread_.task_runner();
 }
 
 void StillCaptureProcessorImpl::Reset() {
+  // Stop |thread_| first so that no more encoding is requested.  The results
+  // of the in-flight encoding are dropped.
   thread_.Stop();
+  encode_thread_.Stop();
+  thumbnail_thread_.Stop();
+  task_runner_ = nullptr;
   blob_stream_ = nullptr;
   result_callback_ = base::NullCallback();
   request_contexts_.clear();
@@ -370,68 +380,139 @@ void StillCaptureProcessorImpl::QueuePendingYuvImageOnThread(
   }
 
   RequestContext& context = request_contexts_[frame_number];
-  if (!jpeg_compressor_->CompressImageFromHandle(
-          yuv_buffer, *context.jpeg_blob, blob_stream_->width,
-          blob_stream_->height, context.jpeg_quality, nullptr, 0,
-          &context.jpeg_blob_size, /*enable_hw_encode=*/false)) {
+  encode_thread_.task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&StillCaptureProcessorImpl::EncodeJpegOnEncodeThread,
+                     base::Unretained(this), frame_number, yuv_buffer,
+                     *context.jpeg_blob, context.jpeg_quality));
+  if (context.thumbnail_size.area() > 0) {
+    // Produce the thumbnail at the same time as the main image.
+    thumbnail_thread_.task_runner()->PostTask(
+        FROM_HERE,
+        base::BindOnce(
+            &StillCaptureProcessorImpl::EncodeThumbnailOnThumbnailThread,
+            base::Unretained(this), frame_number, yuv_buffer,
+            context.thumbnail_size, context.thumbnail_quality));
+  } else {
+    context.has_thumbnail = true;
+  }
+}
+
+void StillCaptureProcessorImpl::EncodeJpegOnEncodeThread(
+    int frame_number,
+    buffer_handle_t yuv_buffer,
+    buffer_handle_t jpeg_blob,
+    int jpeg_quality) {
+  DCHECK(encode_thread_.task_runner()->BelongsToCurrentThread());
+
+  std::optional<uint32_t> jpeg_blob_size;
+  uint32_t data_size = 0;
+  if (jpeg_compressor_->CompressImageFromHandle(
+          yuv_buffer, jpeg_blob, blob_stream_->width, blob_stream_->height,
+          jpeg_quality, nullptr, 0, &data_size, /*enable_hw_encode=*/false)) {
+    jpeg_blob_size = data_size;
+  }
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&StillCaptureProcessorImpl::OnJpegEncodedOnThread,
+                     base::Unretained(this), frame_number, jpeg_blob_size));
+}
+
+void StillCaptureProcessorImpl::EncodeThumbnailOnThumbnailThread(
+    int frame_number,
+    buffer_handle_t yuv_buffer,
+    Size thumbnail_size,
+    int thumbnail_quality) {
+  DCHECK(thumbnail_thread_.task_runner()->BelongsToCurrentThread());
+
+  // Scale down the YUV image and produce JPEG thumbnail.
+  ScopedMapping mapping(yuv_buffer);
+  std::vector<uint8_t> scaled_nv12(thumbnail_size.area() * 3 / 2);
+  // If the thumbnail image aspect ratio is different from the primary JPEG
+  // image, we need to crop the main image first before scaling.
+  int src_width, src_height, src_x_start, src_y_start;
+  GetCropSizeAndXySkips(mapping.width(), mapping.height(),
+                        thumbnail_size.width, thumbnail_size.height,
+                        &src_width, &src_height, &src_x_start, &src_y_start);
+  int y_plane_start = src_x_start + src_y_start * mapping.plane(0).stride;
+  // UV plane has 2:1 subsampling with 2 bytes per pixel.
+  int uv_plane_start =
+      (src_x_start / 2) * 2 + (src_y_start / 2) * mapping.plane(1).stride;
+  uint8_t* dst_y = scaled_nv12.data();
+  int dst_stride_y = thumbnail_size.width;
+  uint8_t* dst_uv = scaled_nv12.data() + thumbnail_size.area();
+  int dst_stride_uv = thumbnail_size.width / 2 * 2;
+  if (libyuv::NV12Scale(
+          mapping.plane(0).addr + y_plane_start, mapping.plane(0).stride,
+          mapping.plane(1).addr + uv_plane_start, mapping.plane(1).stride,
+          src_width, src_height, dst_y, dst_stride_y, dst_uv, dst_stride_uv,
+          thumbnail_size.width, thumbnail_size.height,
+          libyuv::kFilterBilinear)) {
+    LOGF(ERROR) << "Cannot downscale YUV image to produce thumbnail";
+  }
+
+  // This leaves 15533 bytes of space for other metadata in APP1 segment.
+  constexpr int kThumbnailSizeLimit = 50000;
+  uint32_t thumbnail_data_size = 0;
+  std::vector<uint8_t> thumbnail_buffer(thumbnail_size.area() * 2);
+  do {
+    auto ret = jpeg_compressor_->CompressImageFromMemory(
+        scaled_nv12.data(), V4L2_PIX_FMT_NV12, thumbnail_buffer.data(),
+        thumbnail_buffer.size(), thumbnail_size.width, thumbnail_size.height,
+        thumbnail_quality, nullptr, 0, &thumbnail_data_size);
+    if (!ret) {
+      LOGF(ERROR) << "Cannot produce JPEG thumbnail image";
+      thumbnail_data_size = 0;
+      break;
+    }
+    thumbnail_quality -= 10;
+  } while (thumbnail_data_size > kThumbnailSizeLimit && thumbnail_quality > 0);
+  thumbnail_buffer.resize(thumbnail_data_size);
+  VLOGFID(1, frame_number)
+      << "Produced thumbnail with size=" << thumbnail_size.ToString()
+      << " data_length=" << thumbnail_data_size;
+
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&StillCaptureProcessorImpl::OnThumbnailEncodedOnThread,
+                     base::Unretained(this), frame_number,
+                     std::move(thumbnail_buffer)));
+}
+
+void StillCaptureProcessorImpl::OnJpegEncodedOnThread(
+    int frame_number, std::optional<uint32_t> jpeg_blob_size) {
+  DCHECK(thread_.task_runner()->BelongsToCurrentThread());
+
+  if (request_contexts_.count(frame_number) == 0) {
+    LOGF(ERROR) << "No output buffer queued";
+    return;
+  }
+  if (!jpeg_blob_size) {
     LOGF(ERROR) << "Cannot encode YUV image to JPEG";
     // TODO(jcliang): Notify buffer error here.
     return;
   }
+
+  RequestContext& context = request_contexts_[frame_number];
+  context.jpeg_blob_size = *jpeg_blob_size;
   context.has_jpeg = true;
-  if (context.thumbnail_size.area() > 0) {
-    // Scale down the YUV image and produce JPEG thumbnail.
-    ScopedMapping mapping(yuv_buffer);
-    std::vector<uint8_t> scaled_nv12(context.thumbnail_size.area() * 3 / 2);
-    // If the thumbnail image aspect ratio is different from the primary JPEG
-    // image, we need to crop the main image first before scaling.
-    int src_width, src_height, src_x_start, src_y_start;
-    GetCropSizeAndXySkips(mapping.width(), mapping.height(),
-                          context.thumbnail_size.width,
-                          context.thumbnail_size.height, &src_width,
-                          &src_height, &src_x_start, &src_y_start);
-    int y_plane_start = src_x_start + src_y_start * mapping.plane(0).stride;
-    // UV plane has 2:1 subsampling with 2 bytes per pixel.
-    int uv_plane_start =
-        (src_x_start / 2) * 2 + (src_y_start / 2) * mapping.plane(1).stride;
-    uint8_t* dst_y = scaled_nv12.data();
-    int dst_stride_y = context.thumbnail_size.width;
-    uint8_t* dst_uv = scaled_nv12.data() + context.thumbnail_size.area();
-    int dst_stride_uv = context.thumbnail_size.width / 2 * 2;
-    if (libyuv::NV12Scale(
-            mapping.plane(0).addr + y_plane_start, mapping.plane(0).stride,
-            mapping.plane(1).addr + uv_plane_start, mapping.plane(1).stride,
-            src_width, src_height, dst_y, dst_stride_y, dst_uv, dst_stride_uv,
-            context.thumbnail_size.width, context.thumbnail_size.height,
-            libyuv::kFilterBilinear)) {
-      LOGF(ERROR) << "Cannot downscale YUV image to produce thumbnail";
-    }
 
-    // This leaves 15533 bytes of space for other metadata in APP1 segment.
-    constexpr int kThumbnailSizeLimit = 50000;
-    uint32_t thumbnail_data_size = 0;
-    int thumbnail_quality = context.thumbnail_quality;
-    context.thumbnail_buffer.resize(context.thumbnail_size.area() * 2);
-    do {
-      auto ret = jpeg_compressor_->CompressImageFromMemory(
-          scaled_nv12.data(), V4L2_PIX_FMT_NV12,
-          context.thumbnail_buffer.data(), context.thumbnail_buffer.size(),
-          context.thumbnail_size.width, context.thumbnail_size.height,
-          thumbnail_quality, nullptr, 0, &thumbnail_data_size);
-      if (!ret) {
-        LOGF(ERROR) << "Cannot produce JPEG thumbnail image";
-        thumbnail_data_size = 0;
-        break;
-      }
-      thumbnail_quality -= 10;
-    } while (thumbnail_data_size > kThumbnailSizeLimit &&
-             thumbnail_quality > 0);
-    context.thumbnail_buffer.resize(thumbnail_data_size);
-    VLOGFID(1, frame_number)
-        << "Produced thumbnail with size=" << context.thumbnail_size.ToString()
-        << " data_length=" << thumbnail_data_size;
+  MaybeProduceCaptureResultOnThread(frame_number);
+}
+
+void StillCaptureProcessorImpl::OnThumbnailEncodedOnThread(
+    int frame_number, std::vector<uint8_t> thumbnail_buffer) {
+  DCHECK(thread_.task_runner()->BelongsToCurrentThread());
+
+  if (request_contexts_.count(frame_number) == 0) {
+    LOGF(ERROR) << "No output buffer queued";
+    return;
   }
 
+  RequestContext& context = request_contexts_[frame_number];
+  context.thumbnail_buffer = std::move(thumbnail_buffer);
+  context.has_thumbnail = true;
+
   MaybeProduceCaptureResultOnThread(frame_number);
 }
 
@@ -441,7 +522,8 @@ void StillCaptureProcessorImpl::MaybeProduceCaptureResultOnThread(
   DCHECK_EQ(request_contexts_.count(frame_number), 1);
 
   RequestContext& context = request_contexts_.at(frame_number);
-  if (!(context.has_apps_segments && context.has_jpeg)) {
+  if (!(context.has_apps_segments && context.has_jpeg &&
+        context.has_thumbnail)) {
     return;
   }
 
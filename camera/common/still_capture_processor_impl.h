@@ -13,6 +13,7 @@
 
 #include <map>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include <base/callback_helpers.h>
@@ -26,6 +27,10 @@
 
 namespace cros {
 
+// StillCaptureProcessorImpl encodes the main image and the thumbnail of a still
+// capture concurrently on dedicated threads, and assembles the final JPEG on
+// |thread_|.  The stages are pipelined, so the encoding of a still capture
+// overlaps with the assembly of the previous one.
 class StillCaptureProcessorImpl : public StillCaptureProcessor {
  public:
   explicit StillCaptureProcessorImpl(
@@ -55,6 +60,7 @@ class StillCaptureProcessorImpl : public StillCaptureProcessor {
     std::vector<uint8_t> thumbnail_buffer;
     Size thumbnail_size = {0, 0};
     int thumbnail_quality = 80;
+    bool has_thumbnail = false;
 
     ScopedBufferHandle jpeg_blob;
     bool has_jpeg = false;
@@ -72,9 +78,28 @@ class StillCaptureProcessorImpl : public StillCaptureProcessor {
       std::map<uint16_t, base::span<uint8_t>> apps_segments_index);
   void QueuePendingYuvImageOnThread(int frame_number,
                                     buffer_handle_t yuv_buffer);
+  void EncodeJpegOnEncodeThread(int frame_number,
+                                buffer_handle_t yuv_buffer,
+                                buffer_handle_t jpeg_blob,
+                                int jpeg_quality);
+  void EncodeThumbnailOnThumbnailThread(int frame_number,
+                                        buffer_handle_t yuv_buffer,
+                                        Size thumbnail_size,
+                                        int thumbnail_quality);
+  void OnJpegEncodedOnThread(int frame_number, std::optional<uint32_t> size);
+  void OnThumbnailEncodedOnThread(int frame_number,
+                                  std::vector<uint8_t> thumbnail_buffer);
   void MaybeProduceCaptureResultOnThread(int frame_number);
 
+  // |thread_| does the bookkeeping and assembles the results.  The JPEG main
+  // image and thumbnail are encoded on |encode_thread_| and
+  // |thumbnail_thread_| respectively.
   base::Thread thread_;
+  base::Thread encode_thread_;
+  base::Thread thumbnail_thread_;
+  // The task runner of |thread_|, which the encode threads post their results
+  // to.  Posting to it after Reset() is a no-op.
+  scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
   std::unique_ptr<JpegCompressor> jpeg_compressor_;
 
   const camera3_stream_t* blob_stream_ = nullptr;
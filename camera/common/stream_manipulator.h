@@ -20,6 +20,7 @@
 namespace cros {
 
 class CameraDeviceAdapter;
+class SharedCameraBufferPool;
 
 // Interface class that can be used by feature implementations to add hooks into
 // the standard camera HAL3 capture pipeline.
@@ -39,6 +40,10 @@ class CROS_CAMERA_EXPORT StreamManipulator {
     // The state of auto framing. Can be either off, single person mode or
     // multi people mode.
     mojom::CameraAutoFramingState auto_framing_state;
+
+    // The buffer pool shared by the stream manipulators of all the camera
+    // devices.  It out-lives the stream manipulators.
+    SharedCameraBufferPool* buffer_pool = nullptr;
   };
 
   // Callback for the StreamManipulator to return capture results to the client
@@ -114,6 +119,10 @@ class CROS_CAMERA_EXPORT StreamManipulator {
   // CameraDeviceAdapter for each notify message |msg| produced by the camera
   // HAL implemnetation.
   virtual bool Notify(camera3_notify_msg_t* msg) = 0;
+
+  // Returns the name of the StreamManipulator, which is used to tag the
+  // metrics collected about it.
+  virtual std::string GetName() const = 0;
 };
 
 }  // namespace cros
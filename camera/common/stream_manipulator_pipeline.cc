@@ -0,0 +1,182 @@
+/*
+ * Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "common/stream_manipulator_pipeline.h"
+
+#include <utility>
+
+#include <base/strings/stringprintf.h>
+#include <base/timer/elapsed_timer.h>
+
+#include "cros-camera/common.h"
+
+namespace cros {
+
+StreamManipulatorPipeline::StreamManipulatorPipeline(
+    std::vector<StreamManipulator*> stream_manipulators,
+    ResultCallback result_callback,
+    NotifyCallback notify_callback,
+    size_t max_queued_messages)
+    : result_callback_(std::move(result_callback)),
+      notify_callback_(std::move(notify_callback)),
+      max_queued_messages_(max_queued_messages) {
+  DCHECK_GT(max_queued_messages_, 0u);
+  // Capture results go through the StreamManipulators in reverse order.
+  for (size_t i = stream_manipulators.size(); i > 0; --i) {
+    stages_.push_back(Stage{
+        .stream_manipulator = stream_manipulators[i - 1],
+        .position = i - 1,
+        .thread = std::make_unique<base::Thread>(
+            base::StringPrintf("SMPipelineStage%zu", i - 1)),
+    });
+  }
+}
+
+StreamManipulatorPipeline::~StreamManipulatorPipeline() {
+  Drain();
+  for (auto& stage : stages_) {
+    stage.thread->Stop();
+  }
+}
+
+bool StreamManipulatorPipeline::Start() {
+  for (auto& stage : stages_) {
+    if (!stage.thread->Start()) {
+      LOGF(ERROR) << "Failed to start thread of stage " << stage.position;
+      return false;
+    }
+  }
+  return true;
+}
+
+void StreamManipulatorPipeline::ProcessCaptureResult(
+    Camera3CaptureDescriptor result, bool wait) {
+  bool returned = false;
+  {
+    base::AutoLock l(lock_);
+    ++num_in_flight_;
+  }
+  Enqueue(0, Message{
+                 .result = std::move(result),
+                 .returned = wait ? &returned : nullptr,
+             });
+  if (wait) {
+    base::AutoLock l(lock_);
+    while (!returned) {
+      cv_.Wait();
+    }
+  }
+}
+
+void StreamManipulatorPipeline::Notify(const camera3_notify_msg_t& msg) {
+  {
+    base::AutoLock l(lock_);
+    ++num_in_flight_;
+  }
+  Enqueue(0, Message{.notify = msg});
+}
+
+void StreamManipulatorPipeline::Drain() {
+  base::AutoLock l(lock_);
+  while (num_in_flight_ > 0) {
+    cv_.Wait();
+  }
+}
+
+void StreamManipulatorPipeline::Enqueue(size_t index, Message message) {
+  if (index == stages_.size()) {
+    Return(std::move(message));
+    return;
+  }
+
+  Stage& stage = stages_[index];
+  {
+    base::AutoLock l(lock_);
+    // The first stage is fed by the camera HAL callback thread, which must not
+    // block.
+    while (index > 0 && stage.num_queued >= max_queued_messages_) {
+      cv_.Wait();
+    }
+    ++stage.num_queued;
+    // A notify message may be waiting in RunNotify() for this one to be
+    // counted.
+    cv_.Broadcast();
+  }
+  // Each stage is only fed by the previous one, so messages are posted in the
+  // order they were dequeued.
+  stage.thread->task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&StreamManipulatorPipeline::RunStage,
+                     base::Unretained(this), index, std::move(message)));
+}
+
+void StreamManipulatorPipeline::RunStage(size_t index, Message message) {
+  Stage& stage = stages_[index];
+  DCHECK(stage.thread->task_runner()->BelongsToCurrentThread());
+
+  if (message.notify) {
+    DCHECK_EQ(index, 0u);
+    RunNotify(std::move(message));
+    return;
+  }
+
+  base::ElapsedTimer timer;
+  stage.stream_manipulator->ProcessCaptureResult(&message.result);
+  if (latency_callback_) {
+    latency_callback_.Run(stage.position, timer.Elapsed());
+  }
+  if (inspect_result_callback_) {
+    inspect_result_callback_.Run(stage.position, &message.result);
+  }
+
+  {
+    base::AutoLock l(lock_);
+    --stage.num_queued;
+    cv_.Broadcast();
+  }
+  Enqueue(index + 1, std::move(message));
+}
+
+void StreamManipulatorPipeline::RunNotify(Message message) {
+  Stage& first_stage = stages_[0];
+  {
+    base::AutoLock l(lock_);
+    // The messages received after |message| are still queued in the first
+    // stage, so the others were received before it.
+    while (num_in_flight_ > first_stage.num_queued) {
+      cv_.Wait();
+    }
+  }
+
+  // No other stage has a message, so the hooks can run on this thread. The
+  // stages are in reverse order of the capture requests.
+  for (auto it = stages_.rbegin(); it != stages_.rend(); ++it) {
+    it->stream_manipulator->Notify(&message.notify.value());
+  }
+
+  {
+    base::AutoLock l(lock_);
+    --first_stage.num_queued;
+  }
+  Return(std::move(message));
+}
+
+void StreamManipulatorPipeline::Return(Message message) {
+  if (message.notify) {
+    notify_callback_.Run(&message.notify.value());
+  } else {
+    result_callback_.Run(std::move(message.result));
+  }
+
+  base::AutoLock l(lock_);
+  --num_in_flight_;
+  if (message.returned) {
+    *message.returned = true;
+  }
+  cv_.Broadcast();
+}
+
+}  // namespace cros
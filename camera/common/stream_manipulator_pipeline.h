@@ -0,0 +1,162 @@
+/*
+ * Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef CAMERA_COMMON_STREAM_MANIPULATOR_PIPELINE_H_
+#define CAMERA_COMMON_STREAM_MANIPULATOR_PIPELINE_H_
+
+#include <hardware/camera3.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/synchronization/condition_variable.h>
+#include <base/synchronization/lock.h>
+#include <base/thread_annotations.h>
+#include <base/threading/thread.h>
+#include <base/time/time.h>
+
+#include "common/camera_hal3_helpers.h"
+#include "common/stream_manipulator.h"
+#include "cros-camera/export.h"
+
+namespace cros {
+
+// StreamManipulatorPipeline runs the capture result and notify hooks of a
+// chain of StreamManipulators as a pipeline, instead of running all the hooks
+// one after another on the camera HAL callback thread.
+//
+// Each StreamManipulator runs on its own thread, or stage, and the capture
+// results flow through the stages in the same order as CameraDeviceAdapter
+// would call the hooks, i.e. in reverse order of the capture requests. A stage
+// can work on a frame while the following stages still work on the earlier
+// frames.
+//
+// The Notify() hooks are called in the order of the capture requests, as
+// CameraDeviceAdapter does, which is the opposite direction. To keep them in
+// order with the capture results for every StreamManipulator, a notify message
+// waits in the first stage until the messages received before it were
+// returned, and then runs all the hooks before letting the following messages
+// in. Messages are returned to the client in the order they were received from
+// the camera HAL.
+//
+// The queue of the first stage is not bounded so that the camera HAL callback
+// thread never blocks; the camera HAL can't have more results in flight than
+// the buffers of the configured streams anyway. The queues of the following
+// stages are bounded: when one is full, the stage feeding it blocks until it
+// has room.
+class CROS_CAMERA_EXPORT StreamManipulatorPipeline {
+ public:
+  static constexpr size_t kDefaultMaxQueuedMessages = 8;
+
+  // Called with the capture results which went through all the stages, on the
+  // thread of the last stage, and with the notify messages, on the thread of
+  // the first stage.
+  using ResultCallback =
+      base::RepeatingCallback<void(Camera3CaptureDescriptor result)>;
+  using NotifyCallback =
+      base::RepeatingCallback<void(camera3_notify_msg_t* msg)>;
+
+  // Called on the thread of a stage with |result| after it was processed by
+  // the StreamManipulator at |position| in the list given to the constructor.
+  using InspectResultCallback = base::RepeatingCallback<void(
+      size_t position, Camera3CaptureDescriptor* result)>;
+
+  // Called on the thread of a stage with the time the StreamManipulator at
+  // |position| took to process a capture result.
+  using LatencyCallback =
+      base::RepeatingCallback<void(size_t position, base::TimeDelta latency)>;
+
+  // |stream_manipulators| are not owned, and are in the order their
+  // ProcessCaptureRequest() hooks are called.
+  StreamManipulatorPipeline(
+      std::vector<StreamManipulator*> stream_manipulators,
+      ResultCallback result_callback,
+      NotifyCallback notify_callback,
+      size_t max_queued_messages = kDefaultMaxQueuedMessages);
+  StreamManipulatorPipeline(const StreamManipulatorPipeline&) = delete;
+  StreamManipulatorPipeline& operator=(const StreamManipulatorPipeline&) =
+      delete;
+
+  // Waits for the queued messages to be returned, and stops the stages.
+  ~StreamManipulatorPipeline();
+
+  // Starts the threads of the stages. Returns false on failure.
+  bool Start();
+
+  // The callbacks must be set before Start().
+  void set_inspect_result_callback(InspectResultCallback callback) {
+    inspect_result_callback_ = std::move(callback);
+  }
+  void set_latency_callback(LatencyCallback callback) {
+    latency_callback_ = std::move(callback);
+  }
+
+  // Queues |result| in the pipeline. |result| must not refer to data owned by
+  // the caller, unless |wait| is true in which case the call returns once
+  // |result| was returned.
+  void ProcessCaptureResult(Camera3CaptureDescriptor result, bool wait = false);
+
+  // Queues |msg| in the pipeline.
+  void Notify(const camera3_notify_msg_t& msg);
+
+  // Blocks until all the queued messages were returned. Must not be called
+  // from a stage.
+  void Drain();
+
+ private:
+  // A capture result or a notify message flowing through the stages.
+  struct Message {
+    Camera3CaptureDescriptor result;
+    std::optional<camera3_notify_msg_t> notify;
+    // Set for messages whose sender waits for them to be returned.
+    bool* returned = nullptr;
+  };
+
+  struct Stage {
+    StreamManipulator* stream_manipulator;
+    // Position of |stream_manipulator| in the list given to the constructor.
+    size_t position;
+    std::unique_ptr<base::Thread> thread;
+
+    // Number of messages posted to |thread| and not processed yet, guarded
+    // by |lock_|.
+    size_t num_queued = 0;
+  };
+
+  // Queues |message| in the stage at |index|, waiting for room if needed
+  // unless it's the first stage.
+  void Enqueue(size_t index, Message message);
+
+  // Runs the hook of the stage at |index| on |message|, on its thread.
+  void RunStage(size_t index, Message message);
+
+  // Runs all the Notify() hooks on |message| once the messages received before
+  // it were returned, and returns it, on the thread of the first stage.
+  void RunNotify(Message message);
+
+  // Returns |message| to the client.
+  void Return(Message message);
+
+  const ResultCallback result_callback_;
+  const NotifyCallback notify_callback_;
+  const size_t max_queued_messages_;
+  InspectResultCallback inspect_result_callback_;
+  LatencyCallback latency_callback_;
+
+  base::Lock lock_;
+  // Signaled when a stage gets room, or when a message is returned.
+  base::ConditionVariable cv_{&lock_};
+  // Stages in the order messages go through them.
+  std::vector<Stage> stages_;
+  // Number of messages in the pipeline.
+  size_t num_in_flight_ GUARDED_BY(lock_) = 0;
+};
+
+}  // namespace cros
+
+#endif  // CAMERA_COMMON_STREAM_MANIPULATOR_PIPELINE_H_
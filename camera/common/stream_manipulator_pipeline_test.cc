@@ -0,0 +1,389 @@
+/*
+ * Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "common/stream_manipulator_pipeline.h"
+
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/at_exit.h>
+#include <base/bind.h>
+#include <base/synchronization/waitable_event.h>
+#include <base/threading/platform_thread.h>
+#include <base/timer/elapsed_timer.h>
+#include <gtest/gtest.h>
+
+namespace cros {
+
+namespace {
+
+// A message seen by a FakeStreamManipulator or returned to the client.
+struct Event {
+  enum class Type { kResult, kNotify };
+
+  Type type;
+  uint32_t frame_number;
+  // Position of the StreamManipulator, or -1 for the client.
+  int position;
+};
+
+bool operator==(const Event& a, const Event& b) {
+  return a.type == b.type && a.frame_number == b.frame_number &&
+         a.position == b.position;
+}
+
+// Records the events in the order they happen across all the threads.
+class EventLog {
+ public:
+  void Add(Event event) {
+    base::AutoLock l(lock_);
+    events_.push_back(event);
+  }
+
+  // Returns the events matching |type| and |position|, in order.
+  std::vector<uint32_t> GetFrameNumbers(Event::Type type, int position) {
+    base::AutoLock l(lock_);
+    std::vector<uint32_t> frame_numbers;
+    for (const auto& e : events_) {
+      if (e.type == type && e.position == position) {
+        frame_numbers.push_back(e.frame_number);
+      }
+    }
+    return frame_numbers;
+  }
+
+  // Returns the positions which saw the result of |frame_number|, in order.
+  std::vector<int> GetResultPath(uint32_t frame_number) {
+    base::AutoLock l(lock_);
+    std::vector<int> positions;
+    for (const auto& e : events_) {
+      if (e.type == Event::Type::kResult && e.frame_number == frame_number) {
+        positions.push_back(e.position);
+      }
+    }
+    return positions;
+  }
+
+  std::vector<Event> events() {
+    base::AutoLock l(lock_);
+    return events_;
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<Event> events_;
+};
+
+// StreamManipulator taking |delay| to process each capture result.
+class FakeStreamManipulator : public StreamManipulator {
+ public:
+  FakeStreamManipulator(int position, base::TimeDelta delay, EventLog* log)
+      : position_(position), delay_(delay), log_(log) {}
+
+  // If set, ProcessCaptureResult() blocks until |event| is signaled.
+  void set_blocking_event(base::WaitableEvent* event) { blocking_ = event; }
+
+  bool Initialize(const camera_metadata_t* static_info,
+                  CaptureResultCallback result_callback) override {
+    return true;
+  }
+  bool ConfigureStreams(Camera3StreamConfiguration* stream_config) override {
+    return true;
+  }
+  bool OnConfiguredStreams(Camera3StreamConfiguration* stream_config) override {
+    return true;
+  }
+  bool ConstructDefaultRequestSettings(
+      android::CameraMetadata* default_request_settings, int type) override {
+    return true;
+  }
+  bool ProcessCaptureRequest(Camera3CaptureDescriptor* request) override {
+    return true;
+  }
+  bool Flush() override { return true; }
+
+  bool ProcessCaptureResult(Camera3CaptureDescriptor* result) override {
+    if (blocking_) {
+      blocking_->Wait();
+    }
+    base::PlatformThread::Sleep(delay_);
+    log_->Add({Event::Type::kResult, result->frame_number(), position_});
+    return true;
+  }
+
+  bool Notify(camera3_notify_msg_t* msg) override {
+    log_->Add({Event::Type::kNotify, msg->message.shutter.frame_number,
+               position_});
+    return true;
+  }
+
+  std::string GetName() const override { return "Fake"; }
+
+ private:
+  const int position_;
+  const base::TimeDelta delay_;
+  EventLog* log_;
+  base::WaitableEvent* blocking_ = nullptr;
+};
+
+// A capture result recorded from a camera HAL, to be replayed without the
+// camera hardware.
+struct RecordedResult {
+  uint32_t frame_number;
+  uint32_t partial_result;
+  int64_t sensor_timestamp;
+};
+
+std::vector<RecordedResult> MakeRecording(uint32_t num_frames) {
+  // 30 fps stream with two partial results per frame.
+  constexpr int64_t kFrameDurationNs = 33333333;
+  std::vector<RecordedResult> recording;
+  for (uint32_t i = 0; i < num_frames; ++i) {
+    recording.push_back({i, 1, kFrameDurationNs * i});
+    recording.push_back({i, 2, kFrameDurationNs * i});
+  }
+  return recording;
+}
+
+}  // namespace
+
+class StreamManipulatorPipelineTest : public testing::Test {
+ protected:
+  // Creates a pipeline with a FakeStreamManipulator per delay in |delays|.
+  void CreatePipeline(
+      std::vector<base::TimeDelta> delays,
+      size_t max_queued_messages =
+          StreamManipulatorPipeline::kDefaultMaxQueuedMessages) {
+    std::vector<StreamManipulator*> raw_stream_manipulators;
+    for (size_t i = 0; i < delays.size(); ++i) {
+      stream_manipulators_.push_back(std::make_unique<FakeStreamManipulator>(
+          static_cast<int>(i), delays[i], &log_));
+      raw_stream_manipulators.push_back(stream_manipulators_.back().get());
+    }
+    pipeline_ = std::make_unique<StreamManipulatorPipeline>(
+        std::move(raw_stream_manipulators),
+        base::BindRepeating(&StreamManipulatorPipelineTest::OnResult,
+                            base::Unretained(this)),
+        base::BindRepeating(&StreamManipulatorPipelineTest::OnNotify,
+                            base::Unretained(this)),
+        max_queued_messages);
+    pipeline_->set_latency_callback(
+        base::BindRepeating(&StreamManipulatorPipelineTest::OnLatency,
+                            base::Unretained(this)));
+    ASSERT_TRUE(pipeline_->Start());
+  }
+
+  // Feeds |recording| to the pipeline as the camera HAL would, with a shutter
+  // notify message before the first partial result of each frame.
+  void Replay(const std::vector<RecordedResult>& recording) {
+    for (const auto& recorded : recording) {
+      if (recorded.partial_result == 1) {
+        camera3_notify_msg_t msg = {.type = CAMERA3_MSG_SHUTTER};
+        msg.message.shutter.frame_number = recorded.frame_number;
+        msg.message.shutter.timestamp = recorded.sensor_timestamp;
+        pipeline_->Notify(msg);
+      }
+      pipeline_->ProcessCaptureResult(MakeResult(recorded));
+    }
+  }
+
+  Camera3CaptureDescriptor MakeResult(const RecordedResult& recorded) {
+    camera3_capture_result_t raw_result = {
+        .frame_number = recorded.frame_number,
+        .partial_result = recorded.partial_result,
+    };
+    Camera3CaptureDescriptor result(raw_result);
+    std::array<int64_t, 1> timestamp = {recorded.sensor_timestamp};
+    result.UpdateMetadata<int64_t>(ANDROID_SENSOR_TIMESTAMP, timestamp);
+    return result;
+  }
+
+  void OnResult(Camera3CaptureDescriptor result) {
+    base::span<const int64_t> timestamp =
+        result.GetMetadata<int64_t>(ANDROID_SENSOR_TIMESTAMP);
+    EXPECT_EQ(timestamp.size(), 1u);
+    log_.Add({Event::Type::kResult, result.frame_number(), -1});
+  }
+
+  void OnNotify(camera3_notify_msg_t* msg) {
+    log_.Add({Event::Type::kNotify, msg->message.shutter.frame_number, -1});
+  }
+
+  void OnLatency(size_t position, base::TimeDelta latency) {
+    base::AutoLock l(latencies_lock_);
+    latencies_[position].push_back(latency);
+  }
+
+  // Waits until the StreamManipulator at |position| processed |count| capture
+  // results.
+  void WaitForResults(int position, size_t count) {
+    while (log_.GetFrameNumbers(Event::Type::kResult, position).size() <
+           count) {
+      base::PlatformThread::Sleep(base::Milliseconds(1));
+    }
+  }
+
+  EventLog log_;
+  base::Lock latencies_lock_;
+  std::map<size_t, std::vector<base::TimeDelta>> latencies_;
+  std::vector<std::unique_ptr<FakeStreamManipulator>> stream_manipulators_;
+  std::unique_ptr<StreamManipulatorPipeline> pipeline_;
+};
+
+TEST_F(StreamManipulatorPipelineTest, ResultsAreReturnedInOrder) {
+  CreatePipeline({base::Milliseconds(1), base::Milliseconds(3),
+                  base::Milliseconds(2)});
+  constexpr uint32_t kNumFrames = 20;
+  Replay(MakeRecording(kNumFrames));
+  pipeline_->Drain();
+
+  std::vector<uint32_t> expected_frame_numbers;
+  for (uint32_t i = 0; i < kNumFrames; ++i) {
+    expected_frame_numbers.push_back(i);
+    expected_frame_numbers.push_back(i);
+  }
+  for (int position = -1; position < 3; ++position) {
+    EXPECT_EQ(log_.GetFrameNumbers(Event::Type::kResult, position),
+              expected_frame_numbers)
+        << "position " << position;
+  }
+  // Capture results go through the StreamManipulators in reverse order.
+  for (uint32_t i = 0; i < kNumFrames; ++i) {
+    EXPECT_EQ(log_.GetResultPath(i),
+              std::vector<int>({2, 1, 0, -1, 2, 1, 0, -1}))
+        << "frame " << i;
+  }
+}
+
+TEST_F(StreamManipulatorPipelineTest, NotifyStaysInOrderWithResults) {
+  CreatePipeline({base::Milliseconds(2), base::Milliseconds(1)});
+  Replay(MakeRecording(10));
+  pipeline_->Drain();
+
+  // The client gets the shutter of each frame before its capture results.
+  std::vector<Event> client_events;
+  for (const auto& e : log_.events()) {
+    if (e.position == -1) {
+      client_events.push_back(e);
+    }
+  }
+  ASSERT_EQ(client_events.size(), 30u);
+  for (uint32_t i = 0; i < 10; ++i) {
+    EXPECT_EQ(client_events[i * 3], (Event{Event::Type::kNotify, i, -1}));
+    EXPECT_EQ(client_events[i * 3 + 1], (Event{Event::Type::kResult, i, -1}));
+    EXPECT_EQ(client_events[i * 3 + 2], (Event{Event::Type::kResult, i, -1}));
+  }
+
+  // Notify messages go through the StreamManipulators in the order of the
+  // capture requests, and every StreamManipulator sees them in order with the
+  // capture results.
+  for (uint32_t i = 0; i < 10; ++i) {
+    std::vector<int> positions;
+    for (const auto& e : log_.events()) {
+      if (e.type == Event::Type::kNotify && e.frame_number == i) {
+        positions.push_back(e.position);
+      }
+    }
+    EXPECT_EQ(positions, std::vector<int>({0, 1, -1})) << "frame " << i;
+  }
+  for (int position = 0; position < 2; ++position) {
+    std::vector<Event> events;
+    for (const auto& e : log_.events()) {
+      if (e.position == position) {
+        events.push_back(e);
+      }
+    }
+    ASSERT_EQ(events.size(), 30u) << "position " << position;
+    for (uint32_t i = 0; i < 10; ++i) {
+      EXPECT_EQ(events[i * 3], (Event{Event::Type::kNotify, i, position}));
+      EXPECT_EQ(events[i * 3 + 1], (Event{Event::Type::kResult, i, position}));
+      EXPECT_EQ(events[i * 3 + 2], (Event{Event::Type::kResult, i, position}));
+    }
+  }
+}
+
+TEST_F(StreamManipulatorPipelineTest, StagesOverlap) {
+  constexpr base::TimeDelta kDelay = base::Milliseconds(10);
+  CreatePipeline({kDelay, kDelay, kDelay});
+  constexpr uint32_t kNumFrames = 10;
+
+  base::ElapsedTimer timer;
+  Replay(MakeRecording(kNumFrames));
+  pipeline_->Drain();
+
+  // Running the stages one after another would take 3 * kDelay per result,
+  // while the pipeline takes about kDelay per result once it's filled up.
+  EXPECT_LT(timer.Elapsed(), kDelay * 3 * kNumFrames * 2 * 2 / 3);
+}
+
+TEST_F(StreamManipulatorPipelineTest, QueuesAreBoundedBetweenStages) {
+  CreatePipeline({base::TimeDelta(), base::TimeDelta()},
+                 /*max_queued_messages=*/1);
+  base::WaitableEvent unblock;
+  stream_manipulators_[0]->set_blocking_event(&unblock);
+
+  // The camera HAL callback thread never blocks, even though the last stage is
+  // stuck.
+  for (uint32_t i = 0; i < 3; ++i) {
+    pipeline_->ProcessCaptureResult(MakeResult({i, 1, 0}));
+  }
+
+  // The last stage is still processing the first result, so the first stage
+  // waits to hand over the second one and doesn't process the third one.
+  WaitForResults(1, 2);
+  base::PlatformThread::Sleep(base::Milliseconds(100));
+  EXPECT_EQ(log_.GetFrameNumbers(Event::Type::kResult, 1),
+            std::vector<uint32_t>({0, 1}));
+
+  unblock.Signal();
+  pipeline_->Drain();
+  EXPECT_EQ(log_.GetFrameNumbers(Event::Type::kResult, -1),
+            std::vector<uint32_t>({0, 1, 2}));
+}
+
+TEST_F(StreamManipulatorPipelineTest, LatencyIsReportedPerResult) {
+  CreatePipeline({base::Milliseconds(1), base::Milliseconds(5)});
+  Replay(MakeRecording(3));
+  pipeline_->Drain();
+
+  base::AutoLock l(latencies_lock_);
+  ASSERT_EQ(latencies_.size(), 2u);
+  ASSERT_EQ(latencies_[0].size(), 6u);
+  ASSERT_EQ(latencies_[1].size(), 6u);
+  for (size_t i = 0; i < 6; ++i) {
+    EXPECT_GE(latencies_[0][i], base::Milliseconds(1));
+    EXPECT_GE(latencies_[1][i], base::Milliseconds(5));
+  }
+}
+
+TEST_F(StreamManipulatorPipelineTest, WaitForResult) {
+  CreatePipeline({base::Milliseconds(5), base::Milliseconds(5)});
+  pipeline_->ProcessCaptureResult(MakeResult({0, 1, 0}), /*wait=*/true);
+  EXPECT_EQ(log_.GetFrameNumbers(Event::Type::kResult, -1),
+            std::vector<uint32_t>({0}));
+}
+
+TEST_F(StreamManipulatorPipelineTest, NoStreamManipulator) {
+  CreatePipeline({});
+  Replay(MakeRecording(2));
+  // Messages are returned synchronously without any stage.
+  EXPECT_EQ(log_.GetFrameNumbers(Event::Type::kResult, -1),
+            std::vector<uint32_t>({0, 0, 1, 1}));
+  EXPECT_EQ(log_.GetFrameNumbers(Event::Type::kNotify, -1),
+            std::vector<uint32_t>({0, 1}));
+}
+
+}  // namespace cros
+
+int main(int argc, char** argv) {
+  base::AtExitManager exit_manager;
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
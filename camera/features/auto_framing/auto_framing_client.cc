@@ -6,9 +6,6 @@
 
 #include "features/auto_framing/auto_framing_client.h"
 
-#include <hardware/gralloc.h>
-#include <libyuv.h>
-
 #include <numeric>
 #include <optional>
 #include <string>
@@ -27,9 +24,6 @@ namespace {
 // Estimated duration in frames that input buffer sent to the auto-framing
 // engine should keep valid.
 constexpr size_t kInputBufferCount = 10;
-constexpr uint32_t kInputBufferUsage = GRALLOC_USAGE_HW_TEXTURE |
-                                       GRALLOC_USAGE_SW_READ_OFTEN |
-                                       GRALLOC_USAGE_SW_WRITE_OFTEN;
 
 constexpr char kAutoFramingGraphConfigOverridePath[] =
     "/run/camera/auto_framing_subgraph.pbtxt";
@@ -63,17 +57,6 @@ bool AutoFramingClient::SetUp(const Options& options) {
     return false;
   }
 
-  // Allocate buffers for auto-framing engine inputs.
-  // TODO(kamesan): Use a smaller size if detection works well.
-  CameraBufferPool::Options buffer_pool_options = {
-      .width = options.input_size.width,
-      .height = options.input_size.height,
-      .format = HAL_PIXEL_FORMAT_Y8,
-      .usage = kInputBufferUsage,
-      .max_num_buffers = kInputBufferCount,
-  };
-  buffer_pool_ = std::make_unique<CameraBufferPool>(buffer_pool_options);
-
   region_of_interest_ = std::nullopt;
   crop_window_ =
       GetCenteringFullCrop(options.input_size, options.target_aspect_ratio_x,
@@ -83,40 +66,35 @@ bool AutoFramingClient::SetUp(const Options& options) {
 }
 
 bool AutoFramingClient::ProcessFrame(int64_t timestamp,
-                                     buffer_handle_t src_buffer) {
+                                     CameraBufferPool::Buffer buffer) {
   base::AutoLock lock(lock_);
 
   if (!auto_framing_) {
     LOGF(ERROR) << "AutoFramingClient is not initialized";
     return false;
   }
-
-  DCHECK_NE(buffer_pool_, nullptr);
-  std::optional<CameraBufferPool::Buffer> dst_buffer =
-      buffer_pool_->RequestBuffer();
-  if (!dst_buffer) {
-    LOGF(ERROR) << "Failed to allocate buffer for detection @" << timestamp;
+  if (inflight_buffers_.size() >= kInputBufferCount) {
+    LOGF(ERROR) << "Too many frames in flight for detection @" << timestamp;
     return false;
   }
 
-  // TODO(kamesan): Use GPU to copy/scale the buffers.
-  ScopedMapping src_mapping(src_buffer);
-  const ScopedMapping& dst_mapping = dst_buffer->Map();
-  DCHECK_EQ(src_mapping.width(), dst_mapping.width());
-  DCHECK_EQ(src_mapping.height(), dst_mapping.height());
-  libyuv::CopyPlane(src_mapping.plane(0).addr, src_mapping.plane(0).stride,
-                    dst_mapping.plane(0).addr, dst_mapping.plane(0).stride,
-                    dst_mapping.width(), dst_mapping.height());
+  // The Y plane of the frame is the GRAY8 input of the engine, so it's passed
+  // without copying.  The mapping is kept by the pool for the next frames.
+  const ScopedMapping& mapping = buffer.Map();
+  if (!mapping.is_valid()) {
+    LOGF(ERROR) << "Failed to map buffer for detection @" << timestamp;
+    return false;
+  }
 
   VLOGF(2) << "Process frame @" << timestamp;
-  if (!auto_framing_->ProcessFrame(timestamp, dst_mapping.plane(0).addr,
-                                   dst_mapping.plane(0).stride)) {
+  if (!auto_framing_->ProcessFrame(timestamp, mapping.plane(0).addr,
+                                   mapping.plane(0).stride)) {
     LOGF(ERROR) << "Failed to process frame @" << timestamp;
     return false;
   }
 
   DCHECK_EQ(inflight_buffers_.count(timestamp), 0);
-  inflight_buffers_.insert(std::make_pair(timestamp, *std::move(dst_buffer)));
+  inflight_buffers_.insert(std::make_pair(timestamp, std::move(buffer)));
 
   return true;
 }
@@ -136,7 +114,6 @@ Rect<uint32_t> AutoFramingClient::GetCropWindow() {
 void AutoFramingClient::TearDown() {
   auto_framing_.reset();
   inflight_buffers_.clear();
-  buffer_pool_.reset();
 }
 
 void AutoFramingClient::OnFrameProcessed(int64_t timestamp) {
@@ -34,8 +34,10 @@ class AutoFramingClient : public AutoFramingCrOS::Client {
   // Set up the pipeline.
   bool SetUp(const Options& options);
 
-  // Process one frame.  |buffer| is only used during this function call.
-  bool ProcessFrame(int64_t timestamp, buffer_handle_t buffer);
+  // Process one frame.  The auto-framing engine reads the luma plane of the
+  // YUV |buffer| in place, and the buffer is released back to its pool once
+  // the engine is done with it.
+  bool ProcessFrame(int64_t timestamp, CameraBufferPool::Buffer buffer);
 
   // Return the stored ROI if a new detection is available, or nullopt if not.
   // After this call the stored ROI is cleared, waiting for another new
@@ -61,7 +63,6 @@ class AutoFramingClient : public AutoFramingCrOS::Client {
  private:
   base::Lock lock_;
   std::unique_ptr<AutoFramingCrOS> auto_framing_ GUARDED_BY(lock_);
-  std::unique_ptr<CameraBufferPool> buffer_pool_ GUARDED_BY(lock_);
   std::map<int64_t, CameraBufferPool::Buffer> inflight_buffers_
       GUARDED_BY(lock_);
   std::optional<Rect<uint32_t>> region_of_interest_ GUARDED_BY(lock_);
@@ -222,6 +222,7 @@ AutoFramingStreamManipulator::AutoFramingStreamManipulator(
       metadata_logger_({.dump_path = base::FilePath(kMetadataDumpPath)}),
       thread_("AutoFramingThread") {
   DCHECK_NE(runtime_options_, nullptr);
+  DCHECK_NE(runtime_options_->buffer_pool, nullptr);
   CHECK(thread_.Start());
 
   config_.SetCallback(base::BindRepeating(
@@ -303,6 +304,10 @@ bool AutoFramingStreamManipulator::Notify(camera3_notify_msg_t* msg) {
   return true;
 }
 
+std::string AutoFramingStreamManipulator::GetName() const {
+  return "AutoFraming";
+}
+
 bool AutoFramingStreamManipulator::Flush() {
   return true;
 }
@@ -425,17 +430,8 @@ bool AutoFramingStreamManipulator::OnConfiguredStreamsOnThread(
     LOGF(ERROR) << "Failed to negotiate buffer usage";
     return false;
   }
-  // Allocate buffers for |full_frame_stream_|.
-  CameraBufferPool::Options buffer_pool_options = {
-      .width = full_frame_stream_.width,
-      .height = full_frame_stream_.height,
-      .format = base::checked_cast<uint32_t>(full_frame_stream_.format),
-      .usage = full_frame_stream_.usage,
-      .max_num_buffers =
-          base::strict_cast<size_t>(full_frame_stream_.max_buffers) + 1,
-  };
-  full_frame_buffer_pool_ =
-      std::make_unique<CameraBufferPool>(buffer_pool_options);
+  buffer_pool_stats_ = runtime_options_->buffer_pool->GetStats();
+  num_frames_ = 0;
 
   if (!stream_config->SetStreams(client_streams_)) {
     LOGF(ERROR) << "Failed to recover stream config";
@@ -494,8 +490,10 @@ bool AutoFramingStreamManipulator::ProcessCaptureRequestOnThread(
     }
   }
   // Add an output for auto-framing.
-  DCHECK_NE(full_frame_buffer_pool_, nullptr);
-  ctx->full_frame_buffer = full_frame_buffer_pool_->RequestBuffer();
+  ctx->full_frame_buffer = runtime_options_->buffer_pool->RequestBuffer(
+      full_frame_stream_.width, full_frame_stream_.height,
+      base::checked_cast<uint32_t>(full_frame_stream_.format),
+      full_frame_stream_.usage);
   if (!ctx->full_frame_buffer) {
     LOGF(ERROR) << "Failed to allocate buffer for request "
                 << request->frame_number();
@@ -603,12 +601,6 @@ bool AutoFramingStreamManipulator::ProcessCaptureResultOnThread(
       full_frame_buffer.release_fence = -1;
     }
 
-    if (!auto_framing_client_.ProcessFrame(*ctx->timestamp,
-                                           *full_frame_buffer.buffer)) {
-      LOGF(ERROR) << "Failed to process frame " << result->frame_number();
-      return false;
-    }
-
     std::optional<Rect<uint32_t>> roi =
         auto_framing_client_.TakeNewRegionOfInterest();
     if (roi) {
@@ -653,8 +645,24 @@ bool AutoFramingStreamManipulator::ProcessCaptureResultOnThread(
     b.release_fence = release_fence.release();
   }
 
+  if (!face_tracker_) {
+    // Hand the full frame over to the auto-framing engine only after the crops
+    // above are issued.  The engine releases it from its own thread, after
+    // which the shared pool may recycle or free it at any time.  Detection
+    // runs asynchronously, so its ROI is picked up by the next frames anyway.
+    DCHECK(ctx->full_frame_buffer.has_value());
+    CameraBufferPool::Buffer buffer = *std::move(ctx->full_frame_buffer);
+    ctx->full_frame_buffer.reset();
+    if (!auto_framing_client_.ProcessFrame(*ctx->timestamp,
+                                           std::move(buffer))) {
+      LOGF(ERROR) << "Failed to process frame " << result->frame_number();
+      return false;
+    }
+  }
+
   // Done framing.
   framing_error_handler.ReplaceClosure(base::DoNothing());
+  ++num_frames_;
 
   std::vector<camera3_stream_buffer_t> result_buffers;
   for (auto& b : result->GetOutputBuffers()) {
@@ -834,7 +842,25 @@ void AutoFramingStreamManipulator::ResetOnThread() {
   full_frame_stream_ = {};
   target_output_stream_ = nullptr;
   capture_contexts_.clear();
-  full_frame_buffer_pool_.reset();
+
+  // Report the buffer recycling efficiency of the session, and give the idle
+  // full frame buffers back to the shared pool budget.
+  if (num_frames_ > 0) {
+    SharedCameraBufferPool::Stats stats =
+        runtime_options_->buffer_pool->GetStats();
+    VLOGF(1) << "Buffer pool usage in " << num_frames_ << " frames: "
+             << static_cast<float>(stats.pools.num_allocations -
+                                   buffer_pool_stats_.pools.num_allocations) /
+                    num_frames_
+             << " allocations/frame, "
+             << static_cast<float>(stats.pools.num_maps -
+                                   buffer_pool_stats_.pools.num_maps) /
+                    num_frames_
+             << " maps/frame, peak " << stats.peak_allocated_bytes
+             << " bytes";
+    num_frames_ = 0;
+  }
+  runtime_options_->buffer_pool->ReleaseFreeBuffers();
 
   faces_.clear();
   region_of_interest_ = Rect<float>(0.0f, 0.0f, 1.0f, 1.0f);
@@ -11,11 +11,13 @@
 
 #include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "common/camera_buffer_pool.h"
 #include "common/metadata_logger.h"
 #include "common/reloadable_config_file.h"
+#include "common/shared_camera_buffer_pool.h"
 #include "cros-camera/camera_thread.h"
 #include "cros-camera/common_types.h"
 #include "features/auto_framing/auto_framing_client.h"
@@ -84,6 +86,7 @@ class AutoFramingStreamManipulator : public StreamManipulator {
   bool ProcessCaptureRequest(Camera3CaptureDescriptor* request) override;
   bool ProcessCaptureResult(Camera3CaptureDescriptor* result) override;
   bool Notify(camera3_notify_msg_t* msg) override;
+  std::string GetName() const override;
   bool Flush() override;
 
  private:
@@ -142,7 +145,10 @@ class AutoFramingStreamManipulator : public StreamManipulator {
   AutoFramingClient auto_framing_client_;
   std::unique_ptr<FaceTracker> face_tracker_;
   std::unique_ptr<Framer> framer_;
-  std::unique_ptr<CameraBufferPool> full_frame_buffer_pool_;
+
+  // Buffer pool usage since the streams were configured.
+  SharedCameraBufferPool::Stats buffer_pool_stats_;
+  size_t num_frames_ = 0;
 
   std::vector<Rect<float>> faces_;
   Rect<float> region_of_interest_ = {0.0f, 0.0f, 1.0f, 1.0f};
@@ -248,6 +248,10 @@ bool FaceDetectionStreamManipulator::Notify(camera3_notify_msg_t* msg) {
   return true;
 }
 
+std::string FaceDetectionStreamManipulator::GetName() const {
+  return "FaceDetection";
+}
+
 bool FaceDetectionStreamManipulator::Flush() {
   return true;
 }
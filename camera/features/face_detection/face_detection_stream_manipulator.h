@@ -8,6 +8,7 @@
 #define CAMERA_FEATURES_FACE_DETECTION_FACE_DETECTION_STREAM_MANIPULATOR_H_
 
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "common/metadata_logger.h"
@@ -57,6 +58,7 @@ class FaceDetectionStreamManipulator : public StreamManipulator {
   bool ProcessCaptureRequest(Camera3CaptureDescriptor* request) override;
   bool ProcessCaptureResult(Camera3CaptureDescriptor* result) override;
   bool Notify(camera3_notify_msg_t* msg) override;
+  std::string GetName() const override;
   bool Flush() override;
 
  private:
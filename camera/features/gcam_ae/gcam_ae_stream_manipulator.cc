@@ -165,6 +165,10 @@ bool GcamAeStreamManipulator::Notify(camera3_notify_msg_t* msg) {
   return true;
 }
 
+std::string GcamAeStreamManipulator::GetName() const {
+  return "GcamAe";
+}
+
 bool GcamAeStreamManipulator::Flush() {
   return true;
 }
@@ -10,6 +10,7 @@
 #include "common/stream_manipulator.h"
 
 #include <memory>
+#include <string>
 
 #include <base/callback_helpers.h>
 #include <base/synchronization/lock.h>
@@ -53,6 +54,7 @@ class GcamAeStreamManipulator : public StreamManipulator {
   bool ProcessCaptureRequest(Camera3CaptureDescriptor* request) override;
   bool ProcessCaptureResult(Camera3CaptureDescriptor* result) override;
   bool Notify(camera3_notify_msg_t* msg) override;
+  std::string GetName() const override;
   bool Flush() override;
 
  private:
@@ -235,6 +235,10 @@ bool HdrNetStreamManipulator::Notify(camera3_notify_msg_t* msg) {
   return ret;
 }
 
+std::string HdrNetStreamManipulator::GetName() const {
+  return "HDRnet";
+}
+
 bool HdrNetStreamManipulator::Flush() {
   bool ret;
   gpu_thread_.PostTaskSync(
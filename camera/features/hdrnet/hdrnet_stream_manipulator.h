@@ -14,6 +14,7 @@
 #include <optional>
 #include <queue>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <base/files/scoped_file.h>
@@ -52,6 +53,7 @@ class HdrNetStreamManipulator : public StreamManipulator {
   bool ProcessCaptureRequest(Camera3CaptureDescriptor* request) override;
   bool ProcessCaptureResult(Camera3CaptureDescriptor* result) override;
   bool Notify(camera3_notify_msg_t* msg) override;
+  std::string GetName() const override;
   bool Flush() override;
 
  private:
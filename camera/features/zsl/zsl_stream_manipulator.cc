@@ -103,6 +103,10 @@ bool ZslStreamManipulator::Notify(camera3_notify_msg_t* msg) {
   return true;
 }
 
+std::string ZslStreamManipulator::GetName() const {
+  return "ZSL";
+}
+
 bool ZslStreamManipulator::Flush() {
   return true;
 }
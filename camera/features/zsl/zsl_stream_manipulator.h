@@ -11,6 +11,7 @@
 
 #include <atomic>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include <hardware/camera3.h>
@@ -35,6 +36,7 @@ class ZslStreamManipulator : public StreamManipulator {
   bool ProcessCaptureRequest(Camera3CaptureDescriptor* request) override;
   bool ProcessCaptureResult(Camera3CaptureDescriptor* result) override;
   bool Notify(camera3_notify_msg_t* msg) override;
+  std::string GetName() const override;
   bool Flush() override;
 
  private:
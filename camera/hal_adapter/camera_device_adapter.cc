@@ -19,6 +19,8 @@
 #include <base/callback_helpers.h>
 #include <base/check.h>
 #include <base/check_op.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
 #include <base/strings/string_number_conversions.h>
 #include <base/timer/elapsed_timer.h>
 #include <drm_fourcc.h>
@@ -31,6 +33,7 @@
 #include "common/camera_buffer_handle.h"
 #include "cros-camera/camera_buffer_manager.h"
 #include "cros-camera/common.h"
+#include "cros-camera/constants.h"
 #include "cros-camera/future.h"
 #include "cros-camera/ipc_util.h"
 #include "cros-camera/utils/camera_config.h"
@@ -239,6 +242,30 @@ int32_t CameraDeviceAdapter::Initialize(
        ++it) {
     (*it)->Initialize(static_info_, result_callback);
   }
+  if (!stream_manipulators_.empty() &&
+      base::PathExists(base::FilePath(
+          constants::kForceEnableStreamManipulatorPipelinePath))) {
+    std::vector<StreamManipulator*> stream_manipulators;
+    for (const auto& stream_manipulator : stream_manipulators_) {
+      stream_manipulators.push_back(stream_manipulator.get());
+    }
+    stream_manipulator_pipeline_ = std::make_unique<StreamManipulatorPipeline>(
+        std::move(stream_manipulators), result_callback,
+        base::BindRepeating(&CameraDeviceAdapter::ReturnNotifyToClient,
+                            base::Unretained(this)));
+    if (camera_metadata_inspector_) {
+      stream_manipulator_pipeline_->set_inspect_result_callback(
+          base::BindRepeating(&CameraDeviceAdapter::InspectPipelinedResult,
+                              base::Unretained(this)));
+    }
+    stream_manipulator_pipeline_->set_latency_callback(
+        base::BindRepeating(&CameraDeviceAdapter::SendStreamManipulatorLatency,
+                            base::Unretained(this)));
+    if (!stream_manipulator_pipeline_->Start()) {
+      LOGF(ERROR) << "Failed to start the stream manipulator pipeline";
+      return -ENODEV;
+    }
+  }
 
   capture_request_monitor_.Attach();
   capture_result_monitor_.Attach();
@@ -262,6 +289,11 @@ int32_t CameraDeviceAdapter::ConfigureStreams(
 
   base::ElapsedTimer timer;
 
+  // The results still in the pipeline refer to the current streams.
+  if (stream_manipulator_pipeline_) {
+    stream_manipulator_pipeline_->Drain();
+  }
+
   base::AutoLock l(streams_lock_);
 
   // Free previous allocated buffers before new allocation.
@@ -611,7 +643,13 @@ int32_t CameraDeviceAdapter::Flush() {
        ++it) {
     (*it)->Flush();
   }
-  return camera_device_->ops->flush(camera_device_);
+  int32_t ret = camera_device_->ops->flush(camera_device_);
+  // The client expects all the in-flight results to be returned once flush()
+  // returns.
+  if (stream_manipulator_pipeline_) {
+    stream_manipulator_pipeline_->Drain();
+  }
+  return ret;
 }
 
 int32_t CameraDeviceAdapter::RegisterBuffer(
@@ -648,6 +686,9 @@ int32_t CameraDeviceAdapter::Close() {
   reprocess_effect_thread_.Stop();
   int32_t ret = camera_device_->common.close(&camera_device_->common);
   DCHECK_EQ(ret, 0);
+  if (stream_manipulator_pipeline_) {
+    stream_manipulator_pipeline_->Drain();
+  }
   {
     base::AutoLock l(fence_sync_thread_lock_);
     fence_sync_thread_.Stop();
@@ -704,6 +745,15 @@ void CameraDeviceAdapter::ProcessCaptureResult(
         result_descriptor.LockForResult(), self->stream_manipulators_.size());
     result_descriptor.Unlock();
   }
+  if (self->stream_manipulator_pipeline_) {
+    // The physical camera metadata is not copied by Camera3CaptureDescriptor,
+    // so wait for the result to go through the pipeline before returning it
+    // to the camera HAL.
+    const bool wait = result->num_physcam_metadata > 0;
+    self->stream_manipulator_pipeline_->ProcessCaptureResult(
+        std::move(result_descriptor), wait);
+    return;
+  }
   for (size_t i = 0; i < self->stream_manipulators_.size(); ++i) {
     size_t j = self->stream_manipulators_.size() - i - 1;
     self->stream_manipulators_[j]->ProcessCaptureResult(&result_descriptor);
@@ -790,19 +840,44 @@ void CameraDeviceAdapter::Notify(const camera3_callback_ops_t* ops,
     }
   }
 
+  // Keep the notify messages in order with the capture results.
+  if (self->stream_manipulator_pipeline_) {
+    self->stream_manipulator_pipeline_->Notify(*msg);
+    return;
+  }
+
   camera3_notify_msg_t* mutable_msg = const_cast<camera3_notify_msg_t*>(msg);
   for (auto it = self->stream_manipulators_.begin();
        it != self->stream_manipulators_.end(); ++it) {
     (*it)->Notify(mutable_msg);
   }
+  self->ReturnNotifyToClient(mutable_msg);
+}
 
-  mojom::Camera3NotifyMsgPtr msg_ptr = self->PrepareNotifyMsg(mutable_msg);
-  base::AutoLock l(self->callback_ops_delegate_lock_);
-  if (self->callback_ops_delegate_) {
-    self->callback_ops_delegate_->Notify(std::move(msg_ptr));
+void CameraDeviceAdapter::ReturnNotifyToClient(camera3_notify_msg_t* msg) {
+  mojom::Camera3NotifyMsgPtr msg_ptr = PrepareNotifyMsg(msg);
+  base::AutoLock l(callback_ops_delegate_lock_);
+  if (callback_ops_delegate_) {
+    callback_ops_delegate_->Notify(std::move(msg_ptr));
   }
 }
 
+void CameraDeviceAdapter::InspectPipelinedResult(
+    size_t position, Camera3CaptureDescriptor* result) {
+  if (!camera_metadata_inspector_->IsPositionInspected(position)) {
+    return;
+  }
+  base::AutoLock l(inspect_result_lock_);
+  camera_metadata_inspector_->InspectResult(result->LockForResult(), position);
+  result->Unlock();
+}
+
+void CameraDeviceAdapter::SendStreamManipulatorLatency(
+    size_t position, base::TimeDelta latency) {
+  camera_metrics_->SendStreamManipulatorLatency(
+      stream_manipulators_[position]->GetName(), latency);
+}
+
 bool CameraDeviceAdapter::AllocateBuffersForStreams(
     const std::vector<mojom::Camera3StreamPtr>& streams,
     AllocatedBuffers* allocated_buffers) {
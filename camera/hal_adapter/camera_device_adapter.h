@@ -31,6 +31,7 @@
 #include "camera/mojo/camera3.mojom.h"
 #include "common/camera_hal3_helpers.h"
 #include "common/stream_manipulator.h"
+#include "common/stream_manipulator_pipeline.h"
 #include "common/utils/common_types.h"
 #include "common/utils/cros_camera_mojo_utils.h"
 #include "cros-camera/camera_buffer_manager.h"
@@ -162,6 +163,16 @@ class CameraDeviceAdapter : public camera3_callback_ops_t {
 
   static void Notify(const camera3_callback_ops_t* ops,
                      const camera3_notify_msg_t* msg);
+  void ReturnNotifyToClient(camera3_notify_msg_t* msg);
+
+  // Inspects |result| after it was processed by the stream manipulator at
+  // |position| when |stream_manipulator_pipeline_| is used.
+  void InspectPipelinedResult(size_t position,
+                              Camera3CaptureDescriptor* result);
+
+  // Records the time the stream manipulator at |position| took to process a
+  // capture result when |stream_manipulator_pipeline_| is used.
+  void SendStreamManipulatorLatency(size_t position, base::TimeDelta latency);
 
   // Allocates buffers for given |streams|. Returns true and the allocated
   // buffers will be put in |allocated_buffers| if the allocation succeeds.
@@ -337,6 +348,15 @@ class CameraDeviceAdapter : public camera3_callback_ops_t {
   CameraMonitor capture_result_monitor_;
 
   std::vector<std::unique_ptr<StreamManipulator>> stream_manipulators_;
+
+  // Runs the capture result and notify hooks of |stream_manipulators_| when
+  // enabled with |kForceEnableStreamManipulatorPipelinePath|. Declared after
+  // |stream_manipulators_| so that it's destroyed first.
+  std::unique_ptr<StreamManipulatorPipeline> stream_manipulator_pipeline_;
+
+  // Serializes the calls to |camera_metadata_inspector_| from the stages of
+  // |stream_manipulator_pipeline_|.
+  base::Lock inspect_result_lock_;
 };
 
 }  // namespace cros
@@ -78,6 +78,8 @@ CameraHalAdapter::CameraHalAdapter(
       mojo_manager_token_(token),
       activity_callback_(activity_callback) {
   VLOGF_ENTER();
+  stream_manipulator_runtime_options_.buffer_pool =
+      &stream_manipulator_buffer_pool_;
 }
 
 CameraHalAdapter::~CameraHalAdapter() {
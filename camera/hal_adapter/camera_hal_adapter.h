@@ -28,6 +28,7 @@
 #include "camera/mojo/camera3.mojom.h"
 #include "camera/mojo/camera_common.mojom.h"
 #include "camera/mojo/cros_camera_service.mojom.h"
+#include "common/shared_camera_buffer_pool.h"
 #include "common/stream_manipulator.h"
 #include "common/utils/common_types.h"
 #include "common/vendor_tag_manager.h"
@@ -264,6 +265,10 @@ class CameraHalAdapter {
   uint32_t callbacks_id_;
   uint32_t vendor_tag_ops_id_;
 
+  // The buffers shared by the stream manipulators of the camera devices.  Must
+  // out-live |device_adapters_|.
+  SharedCameraBufferPool stream_manipulator_buffer_pool_;
+
   // The handles to the opened camera devices.  |device_adapters_| is accessed
   // only in OpenDevice(), CloseDevice() and CameraDeviceStatusChange().  In
   // order to do lock-free access to |device_adapters_|, we run all of them on
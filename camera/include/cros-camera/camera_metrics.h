@@ -8,6 +8,7 @@
 #define CAMERA_INCLUDE_CROS_CAMERA_CAMERA_METRICS_H_
 
 #include <memory>
+#include <string>
 
 #include <base/time/time.h>
 #include "cros-camera/export.h"
@@ -166,6 +167,13 @@ class CROS_CAMERA_EXPORT CameraMetrics {
 
   // Records the average total exposure time (TET) per session.
   virtual void SendGcamAeAvgTet(int tet) = 0;
+
+  // *** StreamManipulator metrics ***
+
+  // Records the latency of the capture result hook of the StreamManipulator
+  // named |name| per capture result.
+  virtual void SendStreamManipulatorLatency(const std::string& name,
+                                            base::TimeDelta latency) = 0;
 };
 
 }  // namespace cros
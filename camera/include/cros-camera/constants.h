@@ -35,6 +35,11 @@ const char kForceEnableAutoFramingPath[] =
 const char kForceDisableAutoFramingPath[] =
     "/run/camera/force_disable_auto_framing";
 
+// Special file to run the capture result hooks of the stream manipulators on
+// a pipeline of threads.
+const char kForceEnableStreamManipulatorPipelinePath[] =
+    "/run/camera/force_enable_stream_manipulator_pipeline";
+
 // ------Configuration for |kCrosCameraTestConfigPathString|-------
 // boolean value used in test mode for forcing hardware jpeg encode/decode in
 // USB HAL (won't fallback to SW encode/decode).
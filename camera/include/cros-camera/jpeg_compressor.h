@@ -91,7 +91,8 @@ class CROS_CAMERA_EXPORT JpegCompressor {
   // |output_buffer_size|.
   // The actually encoded size will be written into |out_data_size| if image
   // encoded successfully. Returns false if errors
-  // occur during compression.
+  // occur during compression. It may be called concurrently with the other
+  // methods, e.g. to encode a thumbnail while the main image is encoded.
   virtual bool CompressImageFromMemory(void* input,
                                        uint32_t input_format,
                                        void* output,
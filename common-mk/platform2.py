@@ -115,6 +115,7 @@ _IUSE = [
     'opengles',
     'os_install_service',
     'passive_metrics',
+    'perfetto',
     'pinweaver',
     'pinweaver_csme',
     'postinstall_config_efi_and_legacy',
@@ -0,0 +1,169 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/crash_sender_rate_ledger.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/files/file_enumerator.h>
+#include <base/files/file_util.h>
+#include <base/files/important_file_writer.h>
+#include <base/logging.h>
+
+#include "crash-reporter/util.h"
+
+namespace util {
+
+namespace {
+
+// If we can't get a size for one of our uploads, use this as a size. It's an
+// overestimate, but it ensures that when a user upgrades from a previous
+// version of the code to this version, we don't send a huge batch of reports
+// because the previous version didn't write out sizes.
+constexpr int kGuesstimateBytes = util::kDefaultMaxUploadBytes;
+
+// Smallest serialization of an attempt in the ledger: the tag and length of
+// the record, then the tag and timestamp, a 5-byte varint until 2038. The size
+// is omitted when unknown.
+constexpr size_t kMinSerializedRecordBytes = 8;
+
+}  // namespace
+
+SendRateLedger::SendRateLedger(const base::FilePath& timestamps_dir,
+                               base::Clock* clock)
+    : timestamps_dir_(timestamps_dir),
+      ledger_path_(timestamps_dir.Append(kSendLedgerName)),
+      clock_(clock) {}
+
+void SendRateLedger::Load() {
+  ledger_.Clear();
+  std::string serialized;
+  if (!base::PathExists(ledger_path_)) {
+    if (base::DirectoryExists(timestamps_dir_))
+      ImportSendRecordFiles();
+  } else if (!base::ReadFileToString(ledger_path_, &serialized) ||
+             !ledger_.ParseFromString(serialized)) {
+    // Don't lift the limits because of a bad ledger: assume it held as many
+    // attempts as would fit in its size, of unknown size, made just now.
+    const size_t attempts =
+        std::max<size_t>(serialized.size() / kMinSerializedRecordBytes, 1);
+    LOG(WARNING) << "Could not read " << ledger_path_.value()
+                 << "; counting it as " << attempts << " attempts";
+    ledger_.Clear();
+    for (size_t i = 0; i < attempts; ++i)
+      ledger_.add_records()->set_timestamp(clock_->Now().ToTimeT());
+    Save();
+  }
+  if (Prune())
+    Save();
+}
+
+bool SendRateLedger::IsBelowRate(int max_crash_rate,
+                                 int max_crash_bytes) const {
+  const int rate = current_rate();
+  const int64_t bytes = current_bytes();
+  LOG(INFO) << "Current send rate: " << rate << " sends and " << bytes
+            << " bytes/24hrs";
+
+  // We allow either condition independently; see comments around
+  // kMaxCrashBytes. Therefore, we use || instead of the more common &&.
+  return rate < max_crash_rate || bytes < max_crash_bytes;
+}
+
+bool SendRateLedger::RecordSendAttempt(int bytes) {
+  crash::SendRecord* record = ledger_.add_records();
+  record->set_size(bytes);
+  record->set_timestamp(clock_->Now().ToTimeT());
+  Prune();
+  return Save();
+}
+
+int64_t SendRateLedger::current_bytes() const {
+  int64_t bytes = 0;
+  for (const crash::SendRecord& record : ledger_.records()) {
+    // Zero is not a realistic size for an upload, so don't believe it. It
+    // probably comes from a previous version of the code that didn't write out
+    // the sizes.
+    bytes += record.size() > 0 ? record.size() : kGuesstimateBytes;
+  }
+  return bytes;
+}
+
+void SendRateLedger::ImportSendRecordFiles() {
+  std::vector<std::pair<base::Time, crash::SendRecord>> records;
+  base::FileEnumerator iter(timestamps_dir_, false /* recursive */,
+                            base::FileEnumerator::FILES, "*");
+  for (base::FilePath file = iter.Next(); !file.empty(); file = iter.Next()) {
+    const base::Time last_modified = iter.GetInfo().GetLastModifiedTime();
+    if (clock_->Now() - last_modified < kSendRateWindow) {
+      crash::SendRecord record;
+      std::string serialized;
+      if (!base::ReadFileToString(file, &serialized) ||
+          !record.ParseFromString(serialized)) {
+        // Keep the attempt, with a guess of its size: what else can we do?
+        LOG(WARNING) << "Could not read " << file.value();
+        record.Clear();
+      }
+      records.emplace_back(last_modified, std::move(record));
+    }
+    if (!base::DeleteFile(file))
+      PLOG(WARNING) << "Failed to remove old send record " << file.value();
+  }
+
+  std::sort(records.begin(), records.end(),
+            [](const auto& r1, const auto& r2) { return r1.first < r2.first; });
+  for (auto& pair : records) {
+    crash::SendRecord* record = ledger_.add_records();
+    *record = std::move(pair.second);
+    record->set_timestamp(pair.first.ToTimeT());
+  }
+  LOG(INFO) << "Imported " << records.size() << " send records into "
+            << ledger_path_.value();
+  Save();
+}
+
+bool SendRateLedger::Prune() {
+  const base::Time now = clock_->Now();
+  bool changed = false;
+  auto* records = ledger_.mutable_records();
+  auto it = records->begin();
+  while (it != records->end()) {
+    base::Time time = base::Time::FromTimeT(it->timestamp());
+    // Attempts stamped in the future, because the clock went back, leave the
+    // window in at most |kSendRateWindow|.
+    if (time > now) {
+      it->set_timestamp(now.ToTimeT());
+      time = now;
+      changed = true;
+    }
+    if (now - time >= kSendRateWindow) {
+      it = records->erase(it);
+      changed = true;
+    } else {
+      ++it;
+    }
+  }
+  return changed;
+}
+
+bool SendRateLedger::Save() {
+  if (!base::CreateDirectory(timestamps_dir_)) {
+    PLOG(ERROR) << "Failed to create a timestamps directory: "
+                << timestamps_dir_.value();
+    return false;
+  }
+  std::string serialized;
+  if (!ledger_.SerializeToString(&serialized) ||
+      !base::ImportantFileWriter::WriteFileAtomically(ledger_path_,
+                                                       serialized)) {
+    LOG(ERROR) << "Failed to write " << ledger_path_.value();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace util
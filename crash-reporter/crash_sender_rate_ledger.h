@@ -0,0 +1,75 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CRASH_REPORTER_CRASH_SENDER_RATE_LEDGER_H_
+#define CRASH_REPORTER_CRASH_SENDER_RATE_LEDGER_H_
+
+#include <stdint.h>
+
+#include <base/files/file_path.h>
+#include <base/time/clock.h>
+#include <base/time/time.h>
+
+#include "crash-reporter/crash_sender.pb.h"
+
+namespace util {
+
+// Window over which crash_sender limits its uploads.
+constexpr base::TimeDelta kSendRateWindow = base::Hours(24);
+
+// Name of the ledger file in the timestamps directory.
+constexpr char kSendLedgerName[] = "send_ledger";
+
+// Persistent record of the upload attempts of the last |kSendRateWindow|, kept
+// in a single file of the timestamps directory.
+//
+// Previous versions wrote one SendRecord file per attempt, so every rate check
+// enumerated the directory and read each file. These files are imported into
+// the ledger, and removed, the first time a ledger is loaded.
+//
+// The ledger doesn't lock its file; callers hold the crash_sender lock file
+// while loading and recording.
+class SendRateLedger {
+ public:
+  SendRateLedger(const base::FilePath& timestamps_dir, base::Clock* clock);
+  SendRateLedger(const SendRateLedger&) = delete;
+  SendRateLedger& operator=(const SendRateLedger&) = delete;
+
+  // Reads the ledger, dropping the attempts that left the window. A missing
+  // ledger is treated as empty. An unreadable one is replaced by as many
+  // attempts of unknown size as it could hold, made now.
+  void Load();
+
+  // Returns true if sending a crash report now does not exceed
+  // |max_crash_rate| crashes and |max_crash_bytes| bytes per window.
+  bool IsBelowRate(int max_crash_rate, int max_crash_bytes) const;
+
+  // Appends an attempt of |bytes| to the ledger, and writes it out. Returns
+  // false if the ledger couldn't be written.
+  bool RecordSendAttempt(int bytes);
+
+  // Attempts, and their bytes, in the window as of the last Load() or
+  // RecordSendAttempt().
+  int current_rate() const { return ledger_.records_size(); }
+  int64_t current_bytes() const;
+
+ private:
+  // Imports and removes the per-attempt files of previous versions.
+  void ImportSendRecordFiles();
+
+  // Drops the attempts that left the window. Returns true if the ledger
+  // changed.
+  bool Prune();
+
+  bool Save();
+
+  const base::FilePath timestamps_dir_;
+  const base::FilePath ledger_path_;
+  base::Clock* const clock_;
+  crash::SendLedger ledger_;
+};
+
+}  // namespace util
+
+#endif  // CRASH_REPORTER_CRASH_SENDER_RATE_LEDGER_H_
@@ -0,0 +1,200 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/crash_sender_rate_ledger.h"
+
+#include <string>
+
+#include <base/files/file_enumerator.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/test/simple_test_clock.h>
+#include <gtest/gtest.h>
+
+#include "crash-reporter/crash_sender.pb.h"
+#include "crash-reporter/test_util.h"
+#include "crash-reporter/util.h"
+
+namespace util {
+namespace {
+
+class SendRateLedgerTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    timestamps_dir_ = temp_dir_.GetPath().Append("crash_sender");
+    clock_.SetNow(test_util::GetDefaultTime());
+  }
+
+  // Returns the number of files in the timestamps directory.
+  int CountFiles() {
+    int count = 0;
+    base::FileEnumerator iter(timestamps_dir_, false /* recursive */,
+                              base::FileEnumerator::FILES);
+    for (base::FilePath file = iter.Next(); !file.empty(); file = iter.Next())
+      ++count;
+    return count;
+  }
+
+  // Writes a per-attempt file of previous versions, sent at |time|.
+  bool CreateSendRecordFile(const std::string& name,
+                            const std::string& contents,
+                            base::Time time) {
+    const base::FilePath file = timestamps_dir_.Append(name);
+    return test_util::CreateFile(file, contents) &&
+           base::TouchFile(file, time, time);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath timestamps_dir_;
+  base::SimpleTestClock clock_;
+};
+
+TEST_F(SendRateLedgerTest, ReachesMaxRate) {
+  const int kMaxRate = 3;
+  const int kMaxBytes = 50;
+  SendRateLedger ledger(timestamps_dir_, &clock_);
+  ledger.Load();
+
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  ASSERT_TRUE(ledger.RecordSendAttempt(kMaxBytes - 5));
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  clock_.Advance(base::Hours(1));
+  ASSERT_TRUE(ledger.RecordSendAttempt(kMaxBytes - 5));
+  // Exceeds max bytes; should be allowed to upload since we have not hit max
+  // rate.
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  ASSERT_TRUE(ledger.RecordSendAttempt(kMaxBytes - 5));
+
+  // Should not pass the rate + byte limit.
+  EXPECT_FALSE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+
+  // A single file should be used for tracking the attempts.
+  EXPECT_EQ(1, CountFiles());
+
+  // Once the first attempt leaves the window, it should pass the rate limit.
+  clock_.Advance(kSendRateWindow - base::Hours(1));
+  ledger.Load();
+  EXPECT_EQ(2, ledger.current_rate());
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+}
+
+TEST_F(SendRateLedgerTest, ReachesMaxBytes) {
+  const int kMaxRate = 3;
+  const int kMaxBytes = 100;
+  SendRateLedger ledger(timestamps_dir_, &clock_);
+  ledger.Load();
+
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  ASSERT_TRUE(ledger.RecordSendAttempt(50));
+  clock_.Advance(base::Hours(1));
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  ASSERT_TRUE(ledger.RecordSendAttempt(20));
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  ASSERT_TRUE(ledger.RecordSendAttempt(5));
+  // Exceeds max rate, but passes because it's below max bytes.
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  ASSERT_TRUE(ledger.RecordSendAttempt(5));
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  ASSERT_TRUE(ledger.RecordSendAttempt(20));
+
+  // Exceeds max bytes.
+  EXPECT_FALSE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+  EXPECT_EQ(100, ledger.current_bytes());
+
+  // Once the first attempt leaves the window, we should get some bandwidth
+  // marked available again.
+  clock_.Advance(kSendRateWindow - base::Hours(1));
+  ledger.Load();
+  EXPECT_EQ(50, ledger.current_bytes());
+  EXPECT_TRUE(ledger.IsBelowRate(kMaxRate, kMaxBytes));
+}
+
+TEST_F(SendRateLedgerTest, PersistsAttempts) {
+  {
+    SendRateLedger ledger(timestamps_dir_, &clock_);
+    ledger.Load();
+    ASSERT_TRUE(ledger.RecordSendAttempt(10));
+    ASSERT_TRUE(ledger.RecordSendAttempt(20));
+  }
+
+  SendRateLedger ledger(timestamps_dir_, &clock_);
+  ledger.Load();
+  EXPECT_EQ(2, ledger.current_rate());
+  EXPECT_EQ(30, ledger.current_bytes());
+}
+
+TEST_F(SendRateLedgerTest, ImportsSendRecordFiles) {
+  crash::SendRecord record;
+  record.set_size(1000);
+  std::string serialized;
+  ASSERT_TRUE(record.SerializeToString(&serialized));
+  const base::Time now = clock_.Now();
+  ASSERT_TRUE(CreateSendRecordFile("new", serialized, now - base::Hours(1)));
+  ASSERT_TRUE(CreateSendRecordFile("old", serialized, now - base::Hours(25)));
+  // Written by a version that didn't record sizes.
+  ASSERT_TRUE(CreateSendRecordFile("empty", "", now - base::Hours(2)));
+
+  SendRateLedger ledger(timestamps_dir_, &clock_);
+  ledger.Load();
+  EXPECT_EQ(2, ledger.current_rate());
+  EXPECT_EQ(1000 + kDefaultMaxUploadBytes, ledger.current_bytes());
+  // The per-attempt files should be replaced by the ledger.
+  EXPECT_EQ(1, CountFiles());
+  EXPECT_TRUE(base::PathExists(timestamps_dir_.Append(kSendLedgerName)));
+
+  // The imported attempts leave the window like recorded ones.
+  clock_.Advance(kSendRateWindow - base::Minutes(90));
+  ledger.Load();
+  EXPECT_EQ(1, ledger.current_rate());
+}
+
+TEST_F(SendRateLedgerTest, CountsCorruptLedgerConservatively) {
+  ASSERT_TRUE(test_util::CreateFile(timestamps_dir_.Append(kSendLedgerName),
+                                    "\xff\xff\xff"));
+
+  SendRateLedger ledger(timestamps_dir_, &clock_);
+  ledger.Load();
+  // The corrupt ledger counts as an attempt of unknown size.
+  EXPECT_EQ(1, ledger.current_rate());
+  EXPECT_EQ(kDefaultMaxUploadBytes, ledger.current_bytes());
+  ASSERT_TRUE(ledger.RecordSendAttempt(10));
+  ledger.Load();
+  EXPECT_EQ(2, ledger.current_rate());
+  EXPECT_EQ(10 + kDefaultMaxUploadBytes, ledger.current_bytes());
+
+  // The guessed attempt leaves the window like recorded ones.
+  clock_.Advance(kSendRateWindow);
+  ledger.Load();
+  EXPECT_EQ(0, ledger.current_rate());
+}
+
+TEST_F(SendRateLedgerTest, CountsLargeCorruptLedgerAsManyAttempts) {
+  ASSERT_TRUE(test_util::CreateFile(timestamps_dir_.Append(kSendLedgerName),
+                                    std::string(80, '\xff')));
+
+  SendRateLedger ledger(timestamps_dir_, &clock_);
+  ledger.Load();
+  EXPECT_EQ(10, ledger.current_rate());
+  EXPECT_FALSE(ledger.IsBelowRate(10, 10 * kDefaultMaxUploadBytes));
+}
+
+TEST_F(SendRateLedgerTest, ClampsAttemptsInTheFuture) {
+  SendRateLedger ledger(timestamps_dir_, &clock_);
+  ledger.Load();
+  ASSERT_TRUE(ledger.RecordSendAttempt(10));
+
+  // The clock goes back a year; the attempt should still leave the window a
+  // day later.
+  clock_.Advance(-base::Days(365));
+  ledger.Load();
+  ASSERT_TRUE(ledger.RecordSendAttempt(10));
+  EXPECT_EQ(2, ledger.current_rate());
+  clock_.Advance(kSendRateWindow);
+  ledger.Load();
+  EXPECT_EQ(0, ledger.current_rate());
+}
+
+}  // namespace
+}  // namespace util
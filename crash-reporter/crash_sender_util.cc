@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -28,6 +29,7 @@
 #include <base/strings/string_util.h>
 #include <base/strings/stringprintf.h>
 #include <base/threading/platform_thread.h>
+#include <base/time/default_clock.h>
 #include <base/time/time.h>
 #include <brillo/flag_helper.h>
 #include <brillo/files/file_util.h>
@@ -43,6 +45,7 @@
 #include "crash-reporter/constants.h"
 #include "crash-reporter/crash_sender.pb.h"
 #include "crash-reporter/crash_sender_paths.h"
+#include "crash-reporter/crash_sender_rate_ledger.h"
 #include "crash-reporter/paths.h"
 #include "crash-reporter/util.h"
 
@@ -86,6 +89,33 @@ constexpr char kUMAAttemptedCrashRemoval[] =
 constexpr char kCrashSenderRemoveHistName[] =
     "Platform.CrOS.CrashSenderRemoveReason";
 
+// Payload kind of kernel crashes.
+constexpr char kKindForKernelCrash[] = "kcrash";
+
+// Returns the rank of |kind| when picking reports for the bytes left: crashes
+// of programs and of the kernel come before logs, device coredumps and such.
+int GetSendRank(const std::string& kind) {
+  if (kind == constants::kKindForMinidump ||
+      kind == constants::kKindForJavaScriptError ||
+      kind == kKindForKernelCrash) {
+    return 0;
+  }
+  return 1;
+}
+
+// Returns the size of the meta and payload files of |report|, to estimate the
+// size of its upload.
+int64_t GetReportSize(const MetaFile& report) {
+  int64_t size = 0;
+  for (const base::FilePath& file :
+       {report.first, report.second.payload_file}) {
+    int64_t file_size;
+    if (!file.empty() && base::GetFileSize(file, &file_size))
+      size += file_size;
+  }
+  return size;
+}
+
 }  // namespace
 
 void ParseCommandLine(int argc,
@@ -228,6 +258,44 @@ void SortReports(std::vector<MetaFile>* reports) {
             });
 }
 
+std::vector<SendBatch> ScheduleSends(const std::vector<MetaFile>& reports,
+                                     int64_t sends_left,
+                                     int64_t bytes_left,
+                                     size_t max_batch_size) {
+  SendBatch to_send;
+  size_t i = 0;
+  for (; i < reports.size() && sends_left > 0; ++i, --sends_left)
+    to_send.push_back(&reports[i]);
+
+  // Sends beyond the max crash rate are allowed while below the max crash
+  // bytes, so send crashes first, and small reports first to send as many as
+  // the bytes left allow. Upload sizes are only known once compressed, so the
+  // rate is checked again before each send.
+  if (bytes_left > 0) {
+    std::vector<std::tuple<int, int64_t, const MetaFile*>> candidates;
+    for (; i < reports.size(); ++i) {
+      candidates.emplace_back(GetSendRank(reports[i].second.payload_kind),
+                              GetReportSize(reports[i]), &reports[i]);
+    }
+    // Stable, so that reports of the same rank and size are sent oldest first.
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const auto& c1, const auto& c2) {
+                       return std::tie(std::get<0>(c1), std::get<1>(c1)) <
+                              std::tie(std::get<0>(c2), std::get<1>(c2));
+                     });
+    for (const auto& candidate : candidates)
+      to_send.push_back(std::get<2>(candidate));
+  }
+
+  std::vector<SendBatch> batches;
+  max_batch_size = std::max<size_t>(max_batch_size, 1);
+  for (size_t begin = 0; begin < to_send.size(); begin += max_batch_size) {
+    const size_t end = std::min(begin + max_batch_size, to_send.size());
+    batches.emplace_back(to_send.begin() + begin, to_send.begin() + end);
+  }
+  return batches;
+}
+
 std::vector<base::FilePath> GetMetaFiles(const base::FilePath& crash_dir) {
   std::vector<base::FilePath> meta_files;
   if (!base::DirectoryExists(crash_dir)) {
@@ -272,84 +340,15 @@ bool IsTimestampNewEnough(const base::FilePath& timestamp_file) {
 bool IsBelowRate(const base::FilePath& timestamps_dir,
                  int max_crash_rate,
                  int max_crash_bytes) {
-  // If we can't get a size for one of our uploads, use this as a size. It's
-  // an overestimate, but it ensures that when a user upgrades from a previous
-  // version of the code to this version, we don't send a huge batch of reports
-  // because the previous version didn't write out sizes.
-  const int kGuesstimateBytes = util::kDefaultMaxUploadBytes;
-
-  // Count the number of timestamp files, that were written in the past 24
-  // hours. Remove files that are older. Each file that exists should contain
-  // a SendRecord protobuf giving the number of bytes used for that send; add
-  // them up.
-  int current_rate = 0;
-  int current_bytes = 0;
-  base::FileEnumerator iter(timestamps_dir, false /* recursive */,
-                            base::FileEnumerator::FILES, "*");
-  for (base::FilePath file = iter.Next(); !file.empty(); file = iter.Next()) {
-    if (IsTimestampNewEnough(file)) {
-      ++current_rate;
-      std::string serialized;
-      if (!base::ReadFileToString(file, &serialized)) {
-        PLOG(WARNING) << "Unable to read timestamp file at " << file.value();
-        // Keep going without reading the file; what else can we do? If we
-        // really get a file with bad permissions, we don't want to stop ever
-        // sending crashes from this computer, so we shouldn't return false.
-        // But do add something to current_bytes to avoid uploading an unlimited
-        // number of reports if this happens to all our files.
-        current_bytes += kGuesstimateBytes;
-        continue;
-      }
-
-      crash::SendRecord previous_send;
-      if (!previous_send.ParseFromString(serialized)) {
-        LOG(WARNING) << "Could not parse " << file.value();
-        current_bytes += kGuesstimateBytes;
-        continue;
-      }
-
-      if (previous_send.size() <= 0) {
-        // Zero is not a realistic size for the upload, so don't believe it.
-        // Probably from a previous version of the code that didn't write out
-        // the sizes. proto3 will read an empty file as "all fields are zero".
-        LOG(WARNING) << "Previous upload size was " << previous_send.size()
-                     << "; ignoring and guessing " << kGuesstimateBytes;
-        current_bytes += kGuesstimateBytes;
-        continue;
-      }
-      current_bytes += previous_send.size();
-    } else {
-      if (!base::DeleteFile(file))
-        PLOG(WARNING) << "Failed to remove old report " << file.value();
-    }
-  }
-  LOG(INFO) << "Current send rate: " << current_rate << " sends and "
-            << current_bytes << " bytes/24hrs";
-
-  // We allow either condition independently; see comments around
-  // kMaxCrashBytes. Therefore, we use || instead of the more common &&.
-  return current_rate < max_crash_rate || current_bytes < max_crash_bytes;
+  SendRateLedger ledger(timestamps_dir, base::DefaultClock::GetInstance());
+  ledger.Load();
+  return ledger.IsBelowRate(max_crash_rate, max_crash_bytes);
 }
 
 void RecordSendAttempt(const base::FilePath& timestamps_dir, int bytes) {
-  if (!base::CreateDirectory(timestamps_dir)) {
-    PLOG(ERROR) << "Failed to create a timestamps directory: "
-                << timestamps_dir.value();
-    return;
-  }
-
-  base::FilePath temp_file_path;
-  base::ScopedFILE temp_file(
-      base::CreateAndOpenTemporaryStreamInDir(timestamps_dir, &temp_file_path));
-  if (temp_file == nullptr) {
-    PLOG(ERROR) << "Failed to create a file in " << timestamps_dir.value();
-  } else {
-    crash::SendRecord record;
-    record.set_size(bytes);
-    std::string serialized;
-    record.SerializeToString(&serialized);
-    fwrite(serialized.c_str(), 1, serialized.size(), temp_file.get());
-  }
+  SendRateLedger ledger(timestamps_dir, base::DefaultClock::GetInstance());
+  ledger.Load();
+  ledger.RecordSendAttempt(bytes);
 }
 
 Sender::Sender(std::unique_ptr<MetricsLibraryInterface> metrics_lib,
@@ -363,6 +362,8 @@ Sender::Sender(std::unique_ptr<MetricsLibraryInterface> metrics_lib,
       max_crash_rate_(options.max_crash_rate),
       max_crash_bytes_(options.max_crash_bytes),
       max_spread_time_(options.max_spread_time),
+      max_send_batch_size_(options.max_send_batch_size),
+      upload_url_(options.upload_url),
       allow_dev_sending_(options.allow_dev_sending),
       test_mode_(options.test_mode),
       upload_old_reports_(options.upload_old_reports),
@@ -510,19 +511,51 @@ void Sender::SendCrashes(const std::vector<MetaFile>& crash_meta_files) {
   std::string client_id = GetClientId();
 
   base::File lock(AcquireLockFileOrDie());
-  for (const auto& pair : crash_meta_files) {
-    const base::FilePath& meta_file = pair.first;
-    const CrashInfo& info = pair.second;
-    LOG(INFO) << "Evaluating crash report: " << meta_file.value();
 
+  SendRateLedger ledger(paths::Get(paths::kTimestampsDirectory),
+                        base::DefaultClock::GetInstance());
+  ledger.Load();
+  const std::vector<SendBatch> batches = ScheduleSends(
+      crash_meta_files,
+      std::max<int64_t>(
+          static_cast<int64_t>(max_crash_rate_) - ledger.current_rate(), 0),
+      std::max<int64_t>(max_crash_bytes_ - ledger.current_bytes(), 0),
+      max_send_batch_size_);
+  size_t scheduled = 0;
+  for (const SendBatch& batch : batches)
+    scheduled += batch.size();
+  if (scheduled < crash_meta_files.size()) {
+    LOG(WARNING) << "Cannot send " << crash_meta_files.size() - scheduled
+                 << " of " << crash_meta_files.size() << " crashes. Sending "
+                 << "would exceed the max daily rate of " << max_crash_rate_
+                 << " crashes and " << max_crash_bytes_ << " bytes";
+  }
+
+  for (const SendBatch& batch : batches) {
+    // Sleep once for the batch: spread out by up to |max_spread_time_|, and
+    // long enough for the hold-off time of each crash.
+    SendBatch to_send;
     base::TimeDelta sleep_time;
-    if (!GetSleepTime(meta_file, max_spread_time_, hold_off_time_,
-                      &sleep_time)) {
-      LOG(WARNING) << "Failed to compute sleep time for " << meta_file.value();
-      continue;
+    for (const MetaFile* report : batch) {
+      const base::FilePath& meta_file = report->first;
+      LOG(INFO) << "Evaluating crash report: " << meta_file.value();
+
+      base::TimeDelta report_sleep_time;
+      if (!GetSleepTime(meta_file,
+                        to_send.empty() ? max_spread_time_ : base::TimeDelta(),
+                        hold_off_time_, &report_sleep_time)) {
+        LOG(WARNING) << "Failed to compute sleep time for "
+                     << meta_file.value();
+        continue;
+      }
+      sleep_time = std::max(sleep_time, report_sleep_time);
+      to_send.push_back(report);
     }
+    if (to_send.empty())
+      continue;
 
-    LOG(INFO) << "Scheduled to send in " << sleep_time.InSeconds() << "s";
+    LOG(INFO) << "Scheduled to send " << to_send.size() << " crash reports in "
+              << sleep_time.InSeconds() << "s";
     lock.Close();  // Don't hold lock during sleep.
     if (!IsMock()) {
       base::PlatformThread::Sleep(sleep_time);
@@ -532,74 +565,85 @@ void Sender::SendCrashes(const std::vector<MetaFile>& crash_meta_files) {
 
     lock = AcquireLockFileOrDie();
 
-    {
-      // Mark the crash as being processed so that if we crash, we don't try to
-      // send the crash again.
-      // This is in a scope so that RemoveReportFiles doesn't try to remove
-      // the .processing file (causing a LOG(ERROR) in the ScopedProcessingFile
-      // destructor).
-      ScopedProcessingFile processing(meta_file);
-
-      // This should be checked inside of the loop, since the device can disable
-      // metrics while sending crash reports with an interval up to
-      // max_spread_time_ between sends. We only need to check if metrics are
-      // enabled and not guest mode because in guest mode, it always indicates
-      // that metrics are disabled.
-      if (!HasCrashUploadingConsent(info)) {
-        LOG(INFO) << "Metrics disabled or guest mode entered, delaying crash "
-                  << "sending";
+    for (const MetaFile* report : to_send) {
+      if (!SendCrash(*report, client_id))
         return;
-      }
+    }
+  }
+}
 
-      // User-specific crash reports become inaccessible if the user signs out
-      // while sleeping, thus we need to check if the metadata is still
-      // accessible.
-      if (!base::PathExists(meta_file)) {
-        LOG(INFO) << "Metadata is no longer accessible: " << meta_file.value();
-        continue;
-      }
+bool Sender::SendCrash(const MetaFile& report, const std::string& client_id) {
+  const base::FilePath& meta_file = report.first;
+  const CrashInfo& info = report.second;
+
+  // Mark the crash as being processed so that if we crash, we don't try to
+  // send the crash again.
+  ScopedProcessingFile processing(meta_file);
+
+  // This should be checked for each crash, since the device can disable
+  // metrics while sending crash reports with an interval up to
+  // max_spread_time_ between batches. We only need to check if metrics are
+  // enabled and not guest mode because in guest mode, it always indicates
+  // that metrics are disabled.
+  if (!HasCrashUploadingConsent(info)) {
+    LOG(INFO) << "Metrics disabled or guest mode entered, delaying crash "
+              << "sending";
+    return false;
+  }
 
-      const base::FilePath timestamps_dir =
-          paths::Get(paths::kTimestampsDirectory);
-      if (!IsBelowRate(timestamps_dir, max_crash_rate_, max_crash_bytes_)) {
-        LOG(WARNING) << "Cannot send more crashes. Sending "
-                     << meta_file.value()
-                     << " would exceed the max daily rate of "
-                     << max_crash_rate_ << " crashes and " << max_crash_bytes_
-                     << " bytes";
-        return;
-      }
+  // User-specific crash reports become inaccessible if the user signs out
+  // while sleeping, thus we need to check if the metadata is still
+  // accessible.
+  if (!base::PathExists(meta_file)) {
+    LOG(INFO) << "Metadata is no longer accessible: " << meta_file.value();
+    return true;
+  }
 
-      // If we are offline, then don't try to send any crashes.
-      if (!IsMock() && !IsNetworkOnline()) {
-        LOG(INFO) << "Stopping crash sending; network is offline";
-        return;
-      }
+  // Another crash_sender may have sent crashes while we slept, and uploads
+  // may be larger than scheduled, so check the rate again.
+  const base::FilePath timestamps_dir = paths::Get(paths::kTimestampsDirectory);
+  if (!IsBelowRate(timestamps_dir, max_crash_rate_, max_crash_bytes_)) {
+    LOG(WARNING) << "Cannot send more crashes. Sending " << meta_file.value()
+                 << " would exceed the max daily rate of " << max_crash_rate_
+                 << " crashes and " << max_crash_bytes_ << " bytes";
+    return false;
+  }
 
-      const CrashDetails details = {
-          .meta_file = meta_file,
-          .payload_file = info.payload_file,
-          .payload_kind = info.payload_kind,
-          .client_id = client_id,
-          .metadata = info.metadata,
-      };
-      Sender::CrashRemoveReason result = RequestToSendCrash(details);
-      if (SenderBase::CrashRemoveReason::kRetryUploading == result) {
-        LOG(WARNING) << "Failed to send " << meta_file.value()
-                     << ", not removing; will retry later";
-        continue;
-      }
-      if (SenderBase::CrashRemoveReason::kFinishedUploading == result) {
-        LOG(INFO) << "Successfully sent crash " << meta_file.value()
-                  << " and removing.";
-      } else {
-        LOG(WARNING) << "Failed to send " << meta_file.value()
-                     << " due to error code " << result << ". Removing";
-      }
-      RecordCrashRemoveReason(result);
-      RemoveReportFiles(meta_file);
-    }
+  // If we are offline, then don't try to send any crashes.
+  if (!IsMock() && !IsNetworkOnline()) {
+    LOG(INFO) << "Stopping crash sending; network is offline";
+    return false;
   }
+
+  const CrashDetails details = {
+      .meta_file = meta_file,
+      .payload_file = info.payload_file,
+      .payload_kind = info.payload_kind,
+      .client_id = client_id,
+      .metadata = info.metadata,
+  };
+  Sender::CrashRemoveReason result = RequestToSendCrash(details);
+  if (SenderBase::CrashRemoveReason::kRetryUploading == result) {
+    LOG(WARNING) << "Failed to send " << meta_file.value()
+                 << ", not removing; will retry later";
+    return true;
+  }
+  if (SenderBase::CrashRemoveReason::kFinishedUploading == result) {
+    LOG(INFO) << "Successfully sent crash " << meta_file.value()
+              << " and removing.";
+  } else {
+    LOG(WARNING) << "Failed to send " << meta_file.value()
+                 << " due to error code " << result << ". Removing";
+  }
+  RecordCrashRemoveReason(result);
+  RemoveReportFiles(meta_file);
+  return true;
+}
+
+std::string Sender::GetUploadUrl() const {
+  if (!upload_url_.empty())
+    return upload_url_;
+  return allow_dev_sending_ ? kReportUploadStagingUrl : kReportUploadProdUrl;
 }
 
 std::unique_ptr<brillo::http::FormData> Sender::CreateCrashFormData(
@@ -871,9 +915,8 @@ SenderBase::CrashRemoveReason Sender::RequestToSendCrash(
   std::unique_ptr<brillo::http::Response> response;
   if (!compressed_form_data.empty()) {
     response = brillo::http::PostBinaryAndBlock(
-        allow_dev_sending_ ? kReportUploadStagingUrl : kReportUploadProdUrl,
-        compressed_form_data.data(), compressed_form_data.size(),
-        form_data->GetContentType(),
+        GetUploadUrl(), compressed_form_data.data(),
+        compressed_form_data.size(), form_data->GetContentType(),
         {{brillo::http::request_header::kContentEncoding, "gzip"}}, transport,
         &upload_error);
   } else {
@@ -888,8 +931,8 @@ SenderBase::CrashRemoveReason Sender::RequestToSendCrash(
       return CrashRemoveReason::kRetryUploading;
     }
     response = brillo::http::PostFormDataAndBlock(
-        allow_dev_sending_ ? kReportUploadStagingUrl : kReportUploadProdUrl,
-        std::move(form_data), {} /* headers */, transport, &upload_error);
+        GetUploadUrl(), std::move(form_data), {} /* headers */, transport,
+        &upload_error);
   }
 
   if (!response) {
@@ -5,6 +5,8 @@
 #ifndef CRASH_REPORTER_CRASH_SENDER_UTIL_H_
 #define CRASH_REPORTER_CRASH_SENDER_UTIL_H_
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 #include <utility>
@@ -47,6 +49,10 @@ constexpr int kMaxCrashBytes = 24 * 1024 * 1024;
 // immediately.
 constexpr int kMaxSpreadTimeInSeconds = 600;
 
+// Maximum crash reports to send back to back, after a single sleep of up to
+// kMaxSpreadTimeInSeconds.
+constexpr size_t kMaxSendBatchSize = 8;
+
 // Parsed command line flags.
 struct CommandLineFlags {
   base::TimeDelta max_spread_time;
@@ -64,6 +70,9 @@ struct CommandLineFlags {
 // Represents a metadata file name, and its parsed metadata.
 typedef std::pair<base::FilePath, CrashInfo> MetaFile;
 
+// Crash reports to send back to back.
+typedef std::vector<const MetaFile*> SendBatch;
+
 // Parses the command line, and handles the command line flags.
 //
 // On error, the process exits as a failure with an error message for the
@@ -97,6 +106,21 @@ void RemoveOrphanedCrashFiles(const base::FilePath& crash_dir);
 // is at the front of the vector.
 void SortReports(std::vector<MetaFile>* reports);
 
+// Orders the crash reports of |reports|, sorted by SortReports(), that may be
+// sent without exceeding the rate limits, and groups them in batches of up to
+// |max_batch_size| reports.
+//
+// |sends_left| and |bytes_left| are what is left of the max crash rate and max
+// crash bytes. The oldest reports are scheduled first, for the sends left.
+// Then, if bytes are left, the other reports are scheduled with crashes of
+// programs and of the kernel before other kinds of reports, and smaller
+// reports first; the caller stops once the max crash bytes are reached. The
+// returned batches point to |reports|.
+std::vector<SendBatch> ScheduleSends(const std::vector<MetaFile>& reports,
+                                     int64_t sends_left,
+                                     int64_t bytes_left,
+                                     size_t max_batch_size);
+
 // Returns the list of meta data files (files with ".meta" suffix), sorted by
 // the timestamp in the old-to-new order.
 std::vector<base::FilePath> GetMetaFiles(const base::FilePath& crash_dir);
@@ -111,7 +135,7 @@ bool IsTimestampNewEnough(const base::FilePath& timestamp_file);
 // Returns true if sending a crash report now does not exceed |max_crash_rate|
 // crashes and |max_crash_bytes| bytes per 24 hours.
 //
-// |timestamps_dir| contains the state files indicating how many sends have
+// |timestamps_dir| contains the SendRateLedger indicating how many sends have
 // happened and how big they were.
 bool IsBelowRate(const base::FilePath& timestamps_dir,
                  int max_crash_rate,
@@ -144,6 +168,13 @@ class Sender : public SenderBase {
     // Maximum time to sleep before attempting to send.
     base::TimeDelta max_spread_time;
 
+    // Maximum crash reports to send after each sleep.
+    size_t max_send_batch_size = kMaxSendBatchSize;
+
+    // If set, crash reports are uploaded to this URL instead of the crash
+    // server. Used by tests.
+    std::string upload_url;
+
     // Boundary to use in the form data.
     std::string form_data_boundary;
 
@@ -193,10 +224,13 @@ class Sender : public SenderBase {
   // Creates an Http transport object for invoking the Crash Server.
   virtual std::shared_ptr<brillo::http::Transport> GetTransport();
 
-  // Sends each crash in |crash_meta_files|, in multiple steps:
+  // Sends the crashes in |crash_meta_files|, in multiple steps:
   //
-  // For each meta file:
-  // - Sleeps to avoid overloading the network
+  // - Schedules the crashes that the rate limit per 24 hours allows in
+  //   batches, with ScheduleSends().
+  // For each batch:
+  // - Sleeps to avoid overloading the network.
+  // For each crash of the batch:
   // - Checks if the device enters guest mode, and stops if entered.
   // - Enforces the rate limit per 24 hours.
   // - Removes crash files that are successfully uploaded.
@@ -221,6 +255,13 @@ class Sender : public SenderBase {
   // More specifically, if "foo.meta" is given, "foo.*" will be removed.
   void RemoveReportFiles(const base::FilePath& meta_file);
 
+  // Sends the crash of |report|, or removes it if it can't be sent. Returns
+  // false if no more crashes should be sent.
+  bool SendCrash(const MetaFile& report, const std::string& client_id);
+
+  // Returns the URL to upload crash reports to.
+  std::string GetUploadUrl() const;
+
   // Send the specified reason for removing a crash to UMA.
   void RecordCrashRemoveReason(SenderBase::CrashRemoveReason reason) override;
 
@@ -254,6 +295,8 @@ class Sender : public SenderBase {
   const int max_crash_rate_;
   const int max_crash_bytes_;
   const base::TimeDelta max_spread_time_;
+  const size_t max_send_batch_size_;
+  const std::string upload_url_;
   bool allow_dev_sending_;
   const bool test_mode_;
   const bool upload_old_reports_;
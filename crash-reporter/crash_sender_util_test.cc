@@ -32,6 +32,7 @@
 #include <base/strings/string_number_conversions.h>
 #include <base/strings/string_split.h>
 #include <base/strings/string_util.h>
+#include <base/strings/stringprintf.h>
 #include <base/time/time.h>
 #include <base/values.h>
 #include <brillo/flag_helper.h>
@@ -46,8 +47,11 @@
 #include <metrics/metrics_library_mock.h>
 #include <shill/dbus-proxy-mocks.h>
 
+#include "crash-reporter/crash_sender.pb.h"
 #include "crash-reporter/crash_sender_base.h"
 #include "crash-reporter/crash_sender_paths.h"
+#include "crash-reporter/crash_sender_rate_ledger.h"
+#include "crash-reporter/loopback_upload_server.h"
 #include "crash-reporter/paths.h"
 #include "crash-reporter/test_util.h"
 #include "crash-reporter/util.h"
@@ -1496,19 +1500,11 @@ TEST_F(CrashSenderUtilTest, IsBelowRateReachesMaxRate) {
   // Should not pass the rate + byte limit.
   EXPECT_FALSE(IsBelowRate(timestamp_dir, kMaxRate, kMaxBytes));
 
-  // Three files should be created for tracking timestamps.
+  // A single ledger should be created for tracking the attempts. How attempts
+  // leave the window is tested in crash_sender_rate_ledger_test.cc.
   std::vector<base::FilePath> files = GetFileNamesIn(timestamp_dir);
-  ASSERT_EQ(3, files.size());
-
-  const base::Time now = base::Time::Now();
-
-  // Make one of them older than 24 hours.
-  ASSERT_TRUE(test_util::TouchFileHelper(files[0], now - base::Hours(25)));
-
-  // It should now pass the rate limit.
-  EXPECT_TRUE(IsBelowRate(timestamp_dir, kMaxRate, kMaxBytes));
-  // The old file should now be gone.
-  EXPECT_TRUE(!base::PathExists(files[0]));
+  ASSERT_EQ(1, files.size());
+  EXPECT_EQ(kSendLedgerName, files[0].BaseName().value());
 }
 
 TEST_F(CrashSenderUtilTest, IsBelowRateReachesMaxBytes) {
@@ -1531,14 +1527,99 @@ TEST_F(CrashSenderUtilTest, IsBelowRateReachesMaxBytes) {
 
   // Exceeds max bytes.
   EXPECT_FALSE(IsBelowRate(timestamp_dir, kMaxRate, kMaxBytes));
+}
 
-  // Make one file older than 24 hours, and we should get some bandwidth
-  // marked available again.
+TEST_F(CrashSenderUtilTest, IsBelowRateImportsTimestampFiles) {
+  const int kMaxRate = 2;
+  const int kMaxBytes = 0;
+  const base::FilePath timestamp_dir =
+      test_dir_.Append("IsBelowRateImportsTimestampFiles");
+
+  // Timestamp files of previous versions, one per attempt.
+  crash::SendRecord record;
+  record.set_size(100);
+  std::string serialized;
+  ASSERT_TRUE(record.SerializeToString(&serialized));
+  const base::FilePath old_file = timestamp_dir.Append("old");
+  ASSERT_TRUE(test_util::CreateFile(old_file, serialized));
+  ASSERT_TRUE(test_util::TouchFileHelper(
+      old_file, base::Time::Now() - base::Hours(25)));
+  ASSERT_TRUE(test_util::CreateFile(timestamp_dir.Append("new"), serialized));
+
+  // Only the new attempt is in the window.
+  EXPECT_TRUE(IsBelowRate(timestamp_dir, kMaxRate, kMaxBytes));
+  RecordSendAttempt(timestamp_dir, 100);
+  EXPECT_FALSE(IsBelowRate(timestamp_dir, kMaxRate, kMaxBytes));
+
+  // The timestamp files should be replaced by the ledger.
   std::vector<base::FilePath> files = GetFileNamesIn(timestamp_dir);
-  ASSERT_EQ(5, files.size());
+  ASSERT_EQ(1, files.size());
+  EXPECT_EQ(kSendLedgerName, files[0].BaseName().value());
+}
+
+// Creates a crash report of |kind| in |directory| with a payload of
+// |payload_size| bytes, last modified at |last_modified|.
+MetaFile CreateReport(const base::FilePath& directory,
+                      const std::string& name,
+                      const std::string& kind,
+                      int payload_size,
+                      base::Time last_modified) {
+  const base::FilePath meta_file = directory.Append(name + ".meta");
+  const base::FilePath payload_file = directory.Append(name + "." + kind);
+  CHECK(test_util::CreateFile(meta_file, "done=1\n"));
+  CHECK(test_util::CreateFile(payload_file, std::string(payload_size, 'x')));
+  CrashInfo info;
+  info.payload_file = payload_file;
+  info.payload_kind = kind;
+  info.last_modified = last_modified;
+  return MetaFile(meta_file, std::move(info));
+}
+
+// Returns the base names of the meta files of |batches|.
+std::vector<std::vector<std::string>> GetBatchNames(
+    const std::vector<SendBatch>& batches) {
+  std::vector<std::vector<std::string>> names;
+  for (const SendBatch& batch : batches) {
+    names.emplace_back();
+    for (const MetaFile* report : batch) {
+      names.back().push_back(
+          report->first.BaseName().RemoveExtension().value());
+    }
+  }
+  return names;
+}
+
+TEST_F(CrashSenderUtilTest, ScheduleSends) {
   const base::Time now = base::Time::Now();
-  ASSERT_TRUE(test_util::TouchFileHelper(files[0], now - base::Hours(25)));
-  EXPECT_TRUE(IsBelowRate(timestamp_dir, kMaxRate, kMaxBytes));
+  std::vector<MetaFile> reports;
+  reports.push_back(CreateReport(test_dir_, "a", "devcore", 5000,
+                                 now - base::Hours(6)));
+  reports.push_back(CreateReport(test_dir_, "b", "log", 100,
+                                 now - base::Hours(5)));
+  reports.push_back(CreateReport(test_dir_, "c", "devcore", 3000,
+                                 now - base::Hours(4)));
+  reports.push_back(CreateReport(test_dir_, "d", "log", 200,
+                                 now - base::Hours(3)));
+  reports.push_back(CreateReport(test_dir_, "e", "minidump", 1000,
+                                 now - base::Hours(2)));
+  reports.push_back(CreateReport(test_dir_, "f", "kcrash", 500,
+                                 now - base::Hours(1)));
+  SortReports(&reports);
+
+  // The oldest reports are sent for the sends left, then crashes and smaller
+  // reports first.
+  EXPECT_EQ(GetBatchNames(ScheduleSends(reports, 2, 1, 3)),
+            (std::vector<std::vector<std::string>>{{"a", "b", "f"},
+                                                   {"e", "d", "c"}}));
+  // Without bytes left, only the sends left are scheduled.
+  EXPECT_EQ(GetBatchNames(ScheduleSends(reports, 3, 0, 2)),
+            (std::vector<std::vector<std::string>>{{"a", "b"}, {"c"}}));
+  // Without sends left, reports are scheduled for the bytes left.
+  EXPECT_EQ(GetBatchNames(ScheduleSends(reports, 0, 1, 8)),
+            (std::vector<std::vector<std::string>>{
+                {"f", "e", "b", "d", "c", "a"}}));
+  EXPECT_THAT(ScheduleSends(reports, 0, 0, 8), IsEmpty());
+  EXPECT_THAT(ScheduleSends({}, 32, 1024, 8), IsEmpty());
 }
 
 TEST_F(CrashSenderUtilTest, SortReports) {
@@ -1965,10 +2046,10 @@ TEST_F(CrashSenderUtilTest, SendCrashes) {
   std::vector<std::optional<base::Value>> rows =
       ParseChromeUploadsLog(contents);
   // Should only contain two results, since max_crash_rate is set to 2.
-  // FakeSleep should be called three times since we sleep before we check the
-  // crash rate.
+  // FakeSleep should be called once since both crashes are sent in a batch,
+  // and the third isn't scheduled.
   ASSERT_EQ(2, rows.size());
-  EXPECT_EQ(3, sleep_times.size());
+  EXPECT_EQ(1, sleep_times.size());
 
   // Each line of the uploads.log file is "{"upload_time":<value>,"upload_id":
   // <value>,"local_id":<value>,"capture_time":<value>,"state":<value>,"source":
@@ -2144,6 +2225,70 @@ TEST_F(CrashSenderUtilTest, SendCrashes_Fail) {
   EXPECT_FALSE(base::PathExists(paths::Get(paths::kChromeCrashLog)));
 }
 
+// Sends a queue of crash reports to a stand-in crash server over HTTP, one
+// report per sleep as before batching, and in batches.
+TEST_F(CrashSenderUtilTest, SendCrashes_DrainsQueue) {
+  const int kNumCrashes = 12;
+  const base::TimeDelta kLatency = base::Milliseconds(20);
+  ASSERT_TRUE(CreateClientIdFile());
+  SetMockCrashSending(true);
+
+  for (size_t batch_size : {size_t{1}, kMaxSendBatchSize}) {
+    const base::FilePath crash_dir = paths::Get(paths::kSystemCrashDirectory);
+    std::vector<MetaFile> crashes_to_send;
+    for (int i = 0; i < kNumCrashes; ++i) {
+      const std::string name = base::StringPrintf("exec.%d.0.0.0", i);
+      const std::string meta = base::StringPrintf(
+          "payload=%s.log\n"
+          "exec_name=exec\n"
+          "upload_var_prod=foo\n"
+          "done=1\n",
+          name.c_str());
+      const base::FilePath meta_file = crash_dir.Append(name + ".meta");
+      const base::FilePath log = crash_dir.Append(name + ".log");
+      ASSERT_TRUE(test_util::CreateFile(meta_file, meta));
+      ASSERT_TRUE(test_util::CreateFile(log, std::string(4096, 'x')));
+      CrashInfo info;
+      ASSERT_TRUE(info.metadata.LoadFromString(meta));
+      info.payload_file = log;
+      info.payload_kind = "log";
+      info.last_modified = base::Time::Now();
+      crashes_to_send.emplace_back(meta_file, std::move(info));
+    }
+
+    auto metrics_lib = std::make_unique<MetricsLibraryMock>();
+    ASSERT_TRUE(SetConditions(kOfficialBuild, kSignInMode, kMetricsEnabled,
+                              metrics_lib.get()));
+    test_util::LoopbackUploadServer server(kLatency);
+    ASSERT_TRUE(server.Start());
+    std::vector<base::TimeDelta> sleep_times;
+    Sender::Options options;
+    options.max_spread_time = base::Seconds(kMaxSpreadTimeInSeconds);
+    options.hold_off_time = base::TimeDelta();
+    options.max_send_batch_size = batch_size;
+    options.upload_url = server.GetUrl();
+    options.sleep_function = base::BindRepeating(&FakeSleep, &sleep_times);
+    Sender sender(std::move(metrics_lib),
+                  std::make_unique<test_util::AdvancingClock>(), options);
+
+    const base::TimeTicks start = base::TimeTicks::Now();
+    sender.SendCrashes(crashes_to_send);
+    const base::TimeDelta upload_time = base::TimeTicks::Now() - start;
+
+    EXPECT_EQ(kNumCrashes, server.num_uploads());
+    const size_t num_batches = (kNumCrashes + batch_size - 1) / batch_size;
+    EXPECT_EQ(num_batches, sleep_times.size());
+    EXPECT_GE(upload_time, kLatency * kNumCrashes);
+    // On average, each sleep is half of the max spread time.
+    LOG(INFO) << "Drained " << kNumCrashes << " crashes in batches of "
+              << batch_size << " in " << upload_time << " of uploads and "
+              << options.max_spread_time * static_cast<int>(num_batches) / 2
+              << " of sleeps on average";
+    for (const MetaFile& crash : crashes_to_send)
+      EXPECT_FALSE(base::PathExists(crash.first));
+  }
+}
+
 // Verify behavior when SendCrashes itself crashes.
 TEST_F(CrashSenderUtilDeathTest, SendCrashes_Crash) {
   // Set up the mock session manager client.
@@ -0,0 +1,158 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "crash-reporter/loopback_upload_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/strings/string_util.h>
+#include <base/strings/stringprintf.h>
+#include <base/threading/platform_thread.h>
+
+namespace test_util {
+
+namespace {
+
+constexpr char kHeaderEnd[] = "\r\n\r\n";
+
+// Reads from |fd| into |buffer| until it holds |size| bytes. Returns false if
+// the connection is closed first.
+bool ReadAtLeast(int fd, size_t size, std::string* buffer) {
+  char chunk[4096];
+  while (buffer->size() < size) {
+    const ssize_t n = HANDLE_EINTR(read(fd, chunk, sizeof(chunk)));
+    if (n <= 0)
+      return false;
+    buffer->append(chunk, n);
+  }
+  return true;
+}
+
+// Reads from |fd| into |buffer| until it holds the headers of a request.
+// Returns the size of the headers, or 0 if the connection is closed first.
+size_t ReadHeaders(int fd, std::string* buffer) {
+  size_t end;
+  while ((end = buffer->find(kHeaderEnd)) == std::string::npos) {
+    if (!ReadAtLeast(fd, buffer->size() + 1, buffer))
+      return 0;
+  }
+  return end + strlen(kHeaderEnd);
+}
+
+}  // namespace
+
+LoopbackUploadServer::LoopbackUploadServer(base::TimeDelta latency)
+    : latency_(latency) {}
+
+LoopbackUploadServer::~LoopbackUploadServer() {
+  if (thread_) {
+    // Makes accept() fail, so that the thread returns.
+    shutdown(listen_fd_.get(), SHUT_RDWR);
+    thread_->Join();
+  }
+}
+
+bool LoopbackUploadServer::Start() {
+  listen_fd_.reset(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+  if (!listen_fd_.is_valid()) {
+    PLOG(ERROR) << "socket failed";
+    return false;
+  }
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  if (bind(listen_fd_.get(), reinterpret_cast<struct sockaddr*>(&addr),
+           addr_len) < 0 ||
+      listen(listen_fd_.get(), SOMAXCONN) < 0 ||
+      getsockname(listen_fd_.get(), reinterpret_cast<struct sockaddr*>(&addr),
+                  &addr_len) < 0) {
+    PLOG(ERROR) << "Failed to listen on the loopback interface";
+    return false;
+  }
+  port_ = ntohs(addr.sin_port);
+
+  thread_ = std::make_unique<base::DelegateSimpleThread>(
+      this, "LoopbackUploadServer");
+  thread_->StartAsync();
+  return true;
+}
+
+std::string LoopbackUploadServer::GetUrl() const {
+  return base::StringPrintf("http://127.0.0.1:%d/cr/report", port_);
+}
+
+void LoopbackUploadServer::Run() {
+  while (true) {
+    base::ScopedFD fd(HANDLE_EINTR(
+        accept4(listen_fd_.get(), nullptr, nullptr, SOCK_CLOEXEC)));
+    if (!fd.is_valid())
+      return;
+    HandleConnection(fd.get());
+  }
+}
+
+void LoopbackUploadServer::HandleConnection(int fd) {
+  std::string buffer;
+  size_t header_size;
+  while ((header_size = ReadHeaders(fd, &buffer)) > 0) {
+    size_t content_length = 0;
+    bool expect_continue = false;
+    const std::vector<std::string> lines = base::SplitStringUsingSubstr(
+        buffer.substr(0, header_size), "\r\n", base::TRIM_WHITESPACE,
+        base::SPLIT_WANT_NONEMPTY);
+    for (const std::string& line : lines) {
+      const size_t colon = line.find(':');
+      if (colon == std::string::npos)
+        continue;
+      const std::string name = base::ToLowerASCII(line.substr(0, colon));
+      const std::string value(base::TrimWhitespaceASCII(
+          line.substr(colon + 1), base::TRIM_ALL));
+      if (name == "content-length") {
+        base::StringToSizeT(value, &content_length);
+      } else if (name == "expect") {
+        expect_continue =
+            base::EqualsCaseInsensitiveASCII(value, "100-continue");
+      }
+    }
+
+    // Clients wait for this before sending large bodies.
+    if (expect_continue) {
+      const std::string response = "HTTP/1.1 100 Continue\r\n\r\n";
+      if (!base::WriteFileDescriptor(fd, response))
+        return;
+    }
+    if (!ReadAtLeast(fd, header_size + content_length, &buffer))
+      return;
+    buffer.erase(0, header_size + content_length);
+
+    base::PlatformThread::Sleep(latency_);
+    const int report_id = ++num_uploads_;
+    num_bytes_ += content_length;
+    const std::string body = base::StringPrintf("%016x", report_id);
+    const std::string response = base::StringPrintf(
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: %zu\r\n"
+        "\r\n"
+        "%s",
+        body.size(), body.c_str());
+    if (!base::WriteFileDescriptor(fd, response))
+      return;
+  }
+}
+
+}  // namespace test_util
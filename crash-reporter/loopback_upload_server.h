@@ -0,0 +1,58 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CRASH_REPORTER_LOOPBACK_UPLOAD_SERVER_H_
+#define CRASH_REPORTER_LOOPBACK_UPLOAD_SERVER_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include <base/files/scoped_file.h>
+#include <base/threading/simple_thread.h>
+#include <base/time/time.h>
+
+namespace test_util {
+
+// A stand-in for the crash server, on 127.0.0.1. It answers each upload with a
+// report ID after |latency|, like a server at some distance would, so that
+// tests can measure how long crash_sender takes to drain its queue through a
+// real HTTP transport.
+class LoopbackUploadServer : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit LoopbackUploadServer(base::TimeDelta latency);
+  LoopbackUploadServer(const LoopbackUploadServer&) = delete;
+  LoopbackUploadServer& operator=(const LoopbackUploadServer&) = delete;
+  ~LoopbackUploadServer() override;
+
+  // Starts listening on an ephemeral port. Returns false on error.
+  bool Start();
+
+  // URL to upload crash reports to, once started.
+  std::string GetUrl() const;
+
+  // Uploads received so far, and the bytes of their bodies.
+  int num_uploads() const { return num_uploads_; }
+  int64_t num_bytes() const { return num_bytes_; }
+
+ private:
+  // base::DelegateSimpleThread::Delegate:
+  void Run() override;
+
+  // Answers the requests of a connection until the client closes it.
+  void HandleConnection(int fd);
+
+  const base::TimeDelta latency_;
+  base::ScopedFD listen_fd_;
+  int port_ = 0;
+  std::unique_ptr<base::DelegateSimpleThread> thread_;
+  std::atomic<int> num_uploads_{0};
+  std::atomic<int64_t> num_bytes_{0};
+};
+
+}  // namespace test_util
+
+#endif  // CRASH_REPORTER_LOOPBACK_UPLOAD_SERVER_H_
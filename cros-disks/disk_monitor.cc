@@ -7,6 +7,7 @@
 #include <inttypes.h>
 #include <string.h>
 #include <sys/mount.h>
+#include <sys/statvfs.h>
 #include <time.h>
 
 #include <utility>
@@ -25,6 +26,7 @@
 #include <brillo/udev/udev_monitor.h>
 
 #include "cros-disks/device_ejector.h"
+#include "cros-disks/mount_info.h"
 #include "cros-disks/quote.h"
 #include "cros-disks/udev_device.h"
 
@@ -38,6 +40,8 @@ const char kScsiDevice[] = "scsi_device";
 const char kUdevAddAction[] = "add";
 const char kUdevChangeAction[] = "change";
 const char kUdevRemoveAction[] = "remove";
+const char kUdevMoveAction[] = "move";
+const char kPropertyDevPathOld[] = "DEVPATH_OLD";
 const char kPropertyDiskEjectRequest[] = "DISK_EJECT_REQUEST";
 const char kPropertyDiskMediaChange[] = "DISK_MEDIA_CHANGE";
 
@@ -90,6 +94,30 @@ bool MatchDiskByPath(const std::string& path,
   return false;  // Match. Stop enumeration.
 }
 
+// Updates the fields of the |disk| of |entry| which depend on where it is
+// mounted, as they can change without any udev event. As in
+// UdevDevice::GetSizeInfo(), the capacity of a device whose size is unknown
+// to udev is the size of its mounted filesystem.
+void UpdateMountState(const MountInfo& mount_info,
+                      const DiskRegistry::Entry& entry,
+                      Disk* disk) {
+  disk->mount_paths.clear();
+  disk->bytes_remaining = 0;
+  if (!entry.has_device_size)
+    disk->device_capacity = 0;
+  if (disk->device_file.empty())
+    return;
+
+  disk->mount_paths = mount_info.GetMountPaths(disk->device_file);
+  struct statvfs stat;
+  if (!disk->mount_paths.empty() &&
+      statvfs(disk->mount_paths[0].c_str(), &stat) == 0) {
+    if (!entry.has_device_size)
+      disk->device_capacity = stat.f_blocks * stat.f_frsize;
+    disk->bytes_remaining = stat.f_bfree * stat.f_frsize;
+  }
+}
+
 // Logs a device with its properties.
 void LogUdevDevice(const brillo::UdevDevice& dev) {
   if (!VLOG_IS_ON(1))
@@ -149,6 +177,9 @@ bool DiskMonitor::Initialize() {
   // to correctly populate |disks_detected_|.
   EnumerateBlockDevices(base::BindRepeating(
       &DiskMonitor::EmulateAddBlockDeviceEvent, base::Unretained(this)));
+  // From now on, |registry_| is kept up to date by the udev events.
+  registry_initialized_ = true;
+  LOG(INFO) << "Found " << registry_.size() << " block devices";
   return true;
 }
 
@@ -163,11 +194,65 @@ bool DiskMonitor::EmulateAddBlockDeviceEvent(
 
 std::vector<Disk> DiskMonitor::EnumerateDisks() const {
   std::vector<Disk> disks;
-  EnumerateBlockDevices(base::BindRepeating(&AppendDiskIfNotIgnored, allowlist_,
-                                            base::Unretained(&disks)));
+  if (!registry_initialized_) {
+    EnumerateBlockDevices(base::BindRepeating(
+        &AppendDiskIfNotIgnored, allowlist_, base::Unretained(&disks)));
+    return disks;
+  }
+
+  MountInfo mount_info;
+  mount_info.RetrieveFromCurrentProcess();
+  registry_.ForEach([&](const DiskRegistry::Entry& entry) {
+    if (!IsEntryAllowed(entry))
+      return;
+    disks.push_back(entry.disk);
+    UpdateMountState(mount_info, entry, &disks.back());
+  });
   return disks;
 }
 
+bool DiskMonitor::IsEntryAllowed(const DiskRegistry::Entry& entry) const {
+  return !entry.needs_allowlist ||
+         base::Contains(allowlist_, entry.disk.native_path);
+}
+
+void DiskMonitor::UpdateRegistry(const brillo::UdevDevice& raw_device,
+                                 UdevDevice* device,
+                                 const char* action) {
+  const std::string sys_path = device->NativePath();
+  const char* dev_path = raw_device.GetDevicePath();
+  if (strcmp(action, kUdevMoveAction) == 0) {
+    // The device was renamed, so it can no longer be found by its previous
+    // sysfs path, which has the same prefix as the current one.
+    const char* old_dev_path = raw_device.GetPropertyValue(kPropertyDevPathOld);
+    if (old_dev_path && dev_path &&
+        base::EndsWith(sys_path, dev_path, base::CompareCase::SENSITIVE)) {
+      registry_.Remove(sys_path.substr(0, sys_path.size() - strlen(dev_path)) +
+                       old_dev_path);
+    }
+  }
+
+  if (strcmp(action, kUdevRemoveAction) == 0 || device->IsIgnored()) {
+    registry_.Remove(sys_path);
+    return;
+  }
+
+  // Any other action may change the properties of the device. For example, a
+  // 'change' event is received when a filesystem is created or relabeled.
+  DiskRegistry::Entry entry;
+  entry.needs_allowlist = device->IsLoopDevice() ||
+                          device->IsMobileBroadbandDevice() ||
+                          device->IsOnBootDevice();
+  entry.disk = device->ToDisk();
+  uint64_t device_size = 0;
+  entry.has_device_size = device->GetDeviceSize(&device_size);
+
+  std::vector<std::string> aliases = {entry.disk.device_file};
+  if (dev_path)
+    aliases.push_back(dev_path);
+  registry_.Add(sys_path, aliases, std::move(entry));
+}
+
 void DiskMonitor::EnumerateBlockDevices(
     base::RepeatingCallback<bool(std::unique_ptr<brillo::UdevDevice> dev)>
         callback) const {
@@ -198,6 +283,7 @@ void DiskMonitor::ProcessBlockDeviceEvents(
   brillo::UdevDevice* raw_dev = dev.get();
   UdevDevice device(std::move(dev));
   LogDevice(device);
+  UpdateRegistry(*raw_dev, &device, action);
   if (!IsDeviceAllowed(device, allowlist_))
     return;
 
@@ -338,6 +424,20 @@ bool DiskMonitor::GetDiskByDevicePath(const base::FilePath& device_path,
   if (device_path.empty())
     return false;
 
+  if (registry_initialized_) {
+    const DiskRegistry::Entry* entry = registry_.Find(device_path.value());
+    if (!entry || !IsEntryAllowed(*entry))
+      return false;
+
+    if (disk) {
+      *disk = entry->disk;
+      MountInfo mount_info;
+      mount_info.RetrieveFromCurrentProcess();
+      UpdateMountState(mount_info, *entry, disk);
+    }
+    return true;
+  }
+
   std::unique_ptr<UdevDevice> device;
   EnumerateBlockDevices(base::BindRepeating(
       &MatchDiskByPath, device_path.value(), base::Unretained(&device)));
@@ -18,6 +18,7 @@
 #include "cros-disks/device_event.h"
 #include "cros-disks/device_event_source_interface.h"
 #include "cros-disks/disk.h"
+#include "cros-disks/disk_registry.h"
 #include "cros-disks/mount_manager.h"
 
 namespace brillo {
@@ -28,10 +29,16 @@ class UdevMonitor;
 
 namespace cros_disks {
 
+class UdevDevice;
+
 // The DiskMonitor is responsible for reading device state from udev.
 // Said changes could be the result of a udev notification or a synchronous
 // call to enumerate the relevant storage devices attached to the system.
 //
+// Once initialized, the DiskMonitor keeps the block devices of the system in
+// a DiskRegistry, which is kept up to date from the udev notifications. Disks
+// are then enumerated and looked up without scanning udev devices again.
+//
 // This class is designed to run within a single-threaded GMainLoop application
 // and should not be considered thread safe.
 class DiskMonitor : public DeviceEventSourceInterface {
@@ -42,7 +49,7 @@ class DiskMonitor : public DeviceEventSourceInterface {
 
   ~DiskMonitor() override;
 
-  // Initializes the disk monitor.
+  // Initializes the disk monitor and its registry of block devices.
   // Returns true on success.
   virtual bool Initialize();
 
@@ -68,6 +75,18 @@ class DiskMonitor : public DeviceEventSourceInterface {
   void RemoveDeviceFromAllowlist(const base::FilePath& device);
 
  private:
+  friend class DiskMonitorBenchmark;
+  friend class DiskMonitorTest;
+
+  // Checks if the block device |entry| is allowed to be used through
+  // cros-disks.
+  bool IsEntryAllowed(const DiskRegistry::Entry& entry) const;
+
+  // Updates |registry_| from a udev |action| on the block |device|.
+  void UpdateRegistry(const brillo::UdevDevice& raw_device,
+                      UdevDevice* device,
+                      const char* action);
+
   // An EnumerateBlockDevices callback that emulates an 'add' action on
   // |device|. Always returns true to continue enumeration in
   // EnumerateBlockDevices.
@@ -105,6 +124,10 @@ class DiskMonitor : public DeviceEventSourceInterface {
   std::map<std::string, std::set<std::string>> disks_detected_;
 
   std::set<std::string> allowlist_;
+
+  // Block devices of the system, filled by Initialize().
+  DiskRegistry registry_;
+  bool registry_initialized_ = false;
 };
 
 }  // namespace cros_disks
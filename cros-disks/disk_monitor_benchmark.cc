@@ -0,0 +1,99 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include <base/files/file_path.h>
+#include <base/strings/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+#include "cros-disks/disk.h"
+#include "cros-disks/disk_monitor.h"
+#include "cros-disks/disk_registry.h"
+
+namespace cros_disks {
+
+class DiskMonitorBenchmark {
+ public:
+  // Fills the registry of |monitor| with |count| fake block devices, as if
+  // they were found by DiskMonitor::Initialize().
+  static void AddFakeDevices(DiskMonitor* monitor, int count) {
+    for (int i = 0; i < count; i++) {
+      DiskRegistry::Entry entry;
+      entry.disk.native_path =
+          base::StringPrintf("/sys/devices/virtual/block/dm-%d", i);
+      entry.disk.device_file = base::StringPrintf("/dev/dm-%d", i);
+      entry.disk.is_auto_mountable = true;
+      monitor->registry_.Add(entry.disk.native_path,
+                             {entry.disk.device_file}, entry);
+    }
+    monitor->registry_initialized_ = true;
+  }
+};
+
+namespace {
+
+// Measures the enumeration of the disks of the system by scanning udev, as
+// done before the DiskMonitor is initialized.
+void BM_EnumerateDisksUdevScan(benchmark::State& state) {
+  DiskMonitor monitor;
+  size_t num_disks = 0;
+  for (auto _ : state) {
+    num_disks = monitor.EnumerateDisks().size();
+  }
+  state.counters["disks"] = num_disks;
+}
+BENCHMARK(BM_EnumerateDisksUdevScan)->Unit(benchmark::kMillisecond);
+
+// Measures the lookup of a disk of the system by scanning udev.
+void BM_GetDiskByDevicePathUdevScan(benchmark::State& state) {
+  DiskMonitor monitor;
+  const std::vector<Disk> disks = monitor.EnumerateDisks();
+  if (disks.empty()) {
+    state.SkipWithError("No disk found");
+    return;
+  }
+  // The last disk is the worst case of the scan.
+  const base::FilePath device_path(disks.back().device_file);
+  for (auto _ : state) {
+    Disk disk;
+    benchmark::DoNotOptimize(monitor.GetDiskByDevicePath(device_path, &disk));
+  }
+}
+BENCHMARK(BM_GetDiskByDevicePathUdevScan)->Unit(benchmark::kMillisecond);
+
+// Measures the enumeration of the disks kept in the registry.
+void BM_EnumerateDisksRegistry(benchmark::State& state) {
+  DiskMonitor monitor;
+  DiskMonitorBenchmark::AddFakeDevices(&monitor, state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(monitor.EnumerateDisks());
+  }
+}
+BENCHMARK(BM_EnumerateDisksRegistry)
+    ->RangeMultiplier(2)
+    ->Range(128, 1024)
+    ->Unit(benchmark::kMicrosecond);
+
+// Measures the lookup of a disk in the registry.
+void BM_GetDiskByDevicePathRegistry(benchmark::State& state) {
+  DiskMonitor monitor;
+  DiskMonitorBenchmark::AddFakeDevices(&monitor, state.range(0));
+  const base::FilePath device_path(
+      base::StringPrintf("/dev/dm-%d", static_cast<int>(state.range(0)) - 1));
+  for (auto _ : state) {
+    Disk disk;
+    benchmark::DoNotOptimize(monitor.GetDiskByDevicePath(device_path, &disk));
+  }
+}
+BENCHMARK(BM_GetDiskByDevicePathRegistry)
+    ->RangeMultiplier(2)
+    ->Range(128, 1024)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace cros_disks
+
+BENCHMARK_MAIN();
@@ -4,21 +4,67 @@
 
 #include "cros-disks/disk_monitor.h"
 
+#include <memory>
+#include <utility>
+
 #include <base/files/file_path.h>
 #include <base/logging.h>
 #include <base/stl_util.h>
+#include <brillo/udev/mock_udev_device.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "cros-disks/device_ejector.h"
 
 namespace cros_disks {
+namespace {
+
+using ::testing::NiceMock;
+using ::testing::Return;
+using ::testing::StrEq;
+
+const char kDevPath[] = "/devices/pci0000:00/usb1/1-1/1-1:1.0/block/sdz";
+const char kSysPath[] = "/sys/devices/pci0000:00/usb1/1-1/1-1:1.0/block/sdz";
+const char kMovedDevPath[] = "/devices/pci0000:00/usb1/1-2/1-2:1.0/block/sdz";
+const char kMovedSysPath[] =
+    "/sys/devices/pci0000:00/usb1/1-2/1-2:1.0/block/sdz";
+const char kDeviceFile[] = "/dev/sdz";
+
+}  // namespace
 
 class DiskMonitorTest : public ::testing::Test {
  public:
   DiskMonitorTest() = default;
 
  protected:
+  // Makes |monitor_| rely on its registry, without filling it with the block
+  // devices of the system.
+  void UseRegistry() { monitor_.registry_initialized_ = true; }
+
+  // Sends the udev |action| on the block device |sys_path| to |monitor_|.
+  // The device has |size_in_sectors| in sysfs, or no size if it is null, and
+  // was previously at |old_dev_path| if it isn't null.
+  void SendBlockDeviceEvent(const char* action,
+                            const char* sys_path,
+                            const char* dev_path,
+                            const char* size_in_sectors,
+                            const char* old_dev_path = nullptr) {
+    auto dev = std::make_unique<NiceMock<brillo::MockUdevDevice>>();
+    ON_CALL(*dev, GetSysPath()).WillByDefault(Return(sys_path));
+    ON_CALL(*dev, GetDevicePath()).WillByDefault(Return(dev_path));
+    ON_CALL(*dev, GetDeviceNode()).WillByDefault(Return(kDeviceFile));
+    ON_CALL(*dev, GetSysAttributeValue(StrEq("size")))
+        .WillByDefault(Return(size_in_sectors));
+    ON_CALL(*dev, GetPropertyValue(StrEq("DEVPATH_OLD")))
+        .WillByDefault(Return(old_dev_path));
+    // The fake device would otherwise need to be allowlisted if the boot
+    // device can't be determined.
+    monitor_.AddDeviceToAllowlist(base::FilePath(sys_path));
+
+    DeviceEventList events;
+    monitor_.ProcessBlockDeviceEvents(std::move(dev), action, &events);
+  }
+
   DiskMonitor monitor_;
 };
 
@@ -54,4 +100,67 @@ TEST_F(DiskMonitorTest, GetDiskByNonexistentDevicePath) {
   EXPECT_FALSE(monitor_.GetDiskByDevicePath(device_path, &disk));
 }
 
+TEST_F(DiskMonitorTest, AddChangeAndRemoveBlockDevice) {
+  UseRegistry();
+  SendBlockDeviceEvent("add", kSysPath, kDevPath, "2048");
+
+  // The device can be found by its sysfs path, udev path or device file.
+  for (const char* path : {kSysPath, kDevPath, kDeviceFile}) {
+    Disk disk;
+    EXPECT_TRUE(monitor_.GetDiskByDevicePath(base::FilePath(path), &disk))
+        << path;
+    EXPECT_EQ(kSysPath, disk.native_path);
+    EXPECT_EQ(kDeviceFile, disk.device_file);
+    EXPECT_EQ(2048u * 512, disk.device_capacity);
+  }
+  std::vector<Disk> disks = monitor_.EnumerateDisks();
+  ASSERT_EQ(1u, disks.size());
+  EXPECT_EQ(kSysPath, disks[0].native_path);
+
+  // A 'change' event updates the device.
+  SendBlockDeviceEvent("change", kSysPath, kDevPath, "4096");
+  Disk disk;
+  EXPECT_TRUE(monitor_.GetDiskByDevicePath(base::FilePath(kDeviceFile), &disk));
+  EXPECT_EQ(4096u * 512, disk.device_capacity);
+  EXPECT_EQ(1u, monitor_.EnumerateDisks().size());
+
+  SendBlockDeviceEvent("remove", kSysPath, kDevPath, "4096");
+  for (const char* path : {kSysPath, kDevPath, kDeviceFile}) {
+    EXPECT_FALSE(monitor_.GetDiskByDevicePath(base::FilePath(path), &disk))
+        << path;
+  }
+  EXPECT_TRUE(monitor_.EnumerateDisks().empty());
+}
+
+TEST_F(DiskMonitorTest, MoveBlockDevice) {
+  UseRegistry();
+  SendBlockDeviceEvent("add", kSysPath, kDevPath, "2048");
+  SendBlockDeviceEvent("move", kMovedSysPath, kMovedDevPath, "2048", kDevPath);
+
+  // The device is no longer known by its previous paths.
+  Disk disk;
+  EXPECT_FALSE(monitor_.GetDiskByDevicePath(base::FilePath(kSysPath), &disk));
+  EXPECT_FALSE(monitor_.GetDiskByDevicePath(base::FilePath(kDevPath), &disk));
+  for (const char* path : {kMovedSysPath, kMovedDevPath, kDeviceFile}) {
+    EXPECT_TRUE(monitor_.GetDiskByDevicePath(base::FilePath(path), &disk))
+        << path;
+    EXPECT_EQ(kMovedSysPath, disk.native_path);
+  }
+  std::vector<Disk> disks = monitor_.EnumerateDisks();
+  ASSERT_EQ(1u, disks.size());
+  EXPECT_EQ(kMovedSysPath, disks[0].native_path);
+}
+
+TEST_F(DiskMonitorTest, CapacityOfUnmountedDeviceWithoutSize) {
+  UseRegistry();
+  SendBlockDeviceEvent("add", kSysPath, kDevPath, nullptr);
+
+  // Without any size from udev or sysfs, the capacity is the size of the
+  // mounted filesystem, and there is none.
+  Disk disk;
+  EXPECT_TRUE(monitor_.GetDiskByDevicePath(base::FilePath(kDeviceFile), &disk));
+  EXPECT_EQ(0u, disk.device_capacity);
+  EXPECT_TRUE(disk.mount_paths.empty());
+}
+
 }  // namespace cros_disks
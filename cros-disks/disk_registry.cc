@@ -0,0 +1,59 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cros-disks/disk_registry.h"
+
+#include <utility>
+
+namespace cros_disks {
+
+DiskRegistry::DiskRegistry() = default;
+
+DiskRegistry::~DiskRegistry() = default;
+
+void DiskRegistry::Add(const std::string& sys_path,
+                       const std::vector<std::string>& aliases,
+                       Entry entry) {
+  // Drop the aliases of the previous entry, the device file of a device can
+  // change when it is re-added.
+  Remove(sys_path);
+
+  Record& record = records_[sys_path];
+  record.entry = std::move(entry);
+  for (const auto& alias : aliases) {
+    if (alias.empty() || alias == sys_path)
+      continue;
+    aliases_[alias] = sys_path;
+    record.aliases.push_back(alias);
+  }
+}
+
+void DiskRegistry::Remove(const std::string& sys_path) {
+  const auto it = records_.find(sys_path);
+  if (it == records_.end())
+    return;
+
+  for (const auto& alias : it->second.aliases) {
+    // The alias may already refer to another device.
+    const auto alias_it = aliases_.find(alias);
+    if (alias_it != aliases_.end() && alias_it->second == sys_path)
+      aliases_.erase(alias_it);
+  }
+  records_.erase(it);
+}
+
+const DiskRegistry::Entry* DiskRegistry::Find(const std::string& path) const {
+  auto it = records_.find(path);
+  if (it == records_.end()) {
+    const auto alias_it = aliases_.find(path);
+    if (alias_it == aliases_.end())
+      return nullptr;
+    it = records_.find(alias_it->second);
+    if (it == records_.end())
+      return nullptr;
+  }
+  return &it->second.entry;
+}
+
+}  // namespace cros_disks
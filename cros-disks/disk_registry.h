@@ -0,0 +1,78 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CROS_DISKS_DISK_REGISTRY_H_
+#define CROS_DISKS_DISK_REGISTRY_H_
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cros-disks/disk.h"
+
+namespace cros_disks {
+
+// The DiskRegistry keeps the Disk objects of the block devices known to the
+// DiskMonitor. A device can be looked up in constant time by any of the paths
+// cros-disks clients use to refer to it: its sysfs path, its udev device path
+// or its device file.
+class DiskRegistry {
+ public:
+  struct Entry {
+    Disk disk;
+    // Whether the device is a loop device, a mobile broadband device or a
+    // device on the boot device, which can only be used when allowlisted.
+    bool needs_allowlist = false;
+    // Whether udev or sysfs provides the size of the device, which is then
+    // its capacity. Otherwise, the capacity of the device is the size of its
+    // mounted filesystem, which can change without any udev event.
+    bool has_device_size = false;
+  };
+
+  DiskRegistry();
+  DiskRegistry(const DiskRegistry&) = delete;
+  DiskRegistry& operator=(const DiskRegistry&) = delete;
+
+  ~DiskRegistry();
+
+  // Adds the block device with the sysfs path |sys_path|, or replaces it if
+  // it is already known. Besides |sys_path|, the device can be looked up by
+  // each of |aliases|.
+  void Add(const std::string& sys_path,
+           const std::vector<std::string>& aliases,
+           Entry entry);
+
+  // Removes the block device with the sysfs path |sys_path|, if known.
+  void Remove(const std::string& sys_path);
+
+  // Returns the entry of the block device whose sysfs path or one of whose
+  // aliases is |path|, or nullptr if there is none.
+  const Entry* Find(const std::string& path) const;
+
+  // Invokes |callback| on every known block device.
+  template <typename Callback>
+  void ForEach(Callback callback) const {
+    for (const auto& [sys_path, record] : records_) {
+      callback(record.entry);
+    }
+  }
+
+  size_t size() const { return records_.size(); }
+
+ private:
+  struct Record {
+    Entry entry;
+    std::vector<std::string> aliases;
+  };
+
+  // Block devices keyed by their sysfs path.
+  std::unordered_map<std::string, Record> records_;
+
+  // Maps the aliases of the block devices to their sysfs path.
+  std::unordered_map<std::string, std::string> aliases_;
+};
+
+}  // namespace cros_disks
+
+#endif  // CROS_DISKS_DISK_REGISTRY_H_
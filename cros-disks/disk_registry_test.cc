@@ -0,0 +1,91 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "cros-disks/disk_registry.h"
+
+#include <set>
+#include <string>
+
+#include <gtest/gtest.h>
+
+namespace cros_disks {
+
+class DiskRegistryTest : public ::testing::Test {
+ protected:
+  // Adds a device named |name| with the device file |device_file|.
+  void AddDevice(const std::string& name, const std::string& device_file) {
+    DiskRegistry::Entry entry;
+    entry.disk.native_path = "/sys/devices/block/" + name;
+    entry.disk.device_file = device_file;
+    registry_.Add(entry.disk.native_path,
+                  {device_file, "/devices/block/" + name}, entry);
+  }
+
+  DiskRegistry registry_;
+};
+
+TEST_F(DiskRegistryTest, FindByAnyPath) {
+  AddDevice("sdb1", "/dev/sdb1");
+  EXPECT_EQ(1u, registry_.size());
+
+  for (const char* path :
+       {"/sys/devices/block/sdb1", "/devices/block/sdb1", "/dev/sdb1"}) {
+    const DiskRegistry::Entry* entry = registry_.Find(path);
+    ASSERT_NE(nullptr, entry) << path;
+    EXPECT_EQ("/dev/sdb1", entry->disk.device_file);
+  }
+  EXPECT_EQ(nullptr, registry_.Find("/dev/sdb"));
+  EXPECT_EQ(nullptr, registry_.Find(""));
+}
+
+TEST_F(DiskRegistryTest, Remove) {
+  AddDevice("sdb1", "/dev/sdb1");
+  AddDevice("sdb2", "/dev/sdb2");
+
+  registry_.Remove("/sys/devices/block/sdb1");
+  EXPECT_EQ(1u, registry_.size());
+  EXPECT_EQ(nullptr, registry_.Find("/sys/devices/block/sdb1"));
+  EXPECT_EQ(nullptr, registry_.Find("/dev/sdb1"));
+  EXPECT_NE(nullptr, registry_.Find("/dev/sdb2"));
+
+  // Removing an unknown device is a no-op.
+  registry_.Remove("/sys/devices/block/sdb1");
+  EXPECT_EQ(1u, registry_.size());
+}
+
+TEST_F(DiskRegistryTest, ReplaceDropsOldAliases) {
+  AddDevice("sdb1", "/dev/sdb1");
+  AddDevice("sdb1", "/dev/sdc1");
+
+  EXPECT_EQ(1u, registry_.size());
+  EXPECT_EQ(nullptr, registry_.Find("/dev/sdb1"));
+  const DiskRegistry::Entry* entry = registry_.Find("/dev/sdc1");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ("/dev/sdc1", entry->disk.device_file);
+}
+
+TEST_F(DiskRegistryTest, AliasTakenOverByAnotherDevice) {
+  // The device file of a removed device is reused before its removal is
+  // processed.
+  AddDevice("sdb1", "/dev/sdb1");
+  AddDevice("sdc1", "/dev/sdb1");
+  registry_.Remove("/sys/devices/block/sdb1");
+
+  const DiskRegistry::Entry* entry = registry_.Find("/dev/sdb1");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ("/sys/devices/block/sdc1", entry->disk.native_path);
+}
+
+TEST_F(DiskRegistryTest, ForEach) {
+  AddDevice("sdb1", "/dev/sdb1");
+  AddDevice("sdb2", "/dev/sdb2");
+
+  std::set<std::string> device_files;
+  registry_.ForEach([&device_files](const DiskRegistry::Entry& entry) {
+    device_files.insert(entry.disk.device_file);
+  });
+  EXPECT_EQ(std::set<std::string>({"/dev/sdb1", "/dev/sdb2"}), device_files);
+}
+
+}  // namespace cros_disks
@@ -151,7 +151,6 @@ std::string UdevDevice::GetPropertyFromBlkId(const char* key) {
 
 void UdevDevice::GetSizeInfo(uint64_t* total_size,
                              uint64_t* remaining_size) const {
-  static const int kSectorSize = 512;
   uint64_t total = 0, remaining = 0;
 
   // If the device is mounted, obtain the total and remaining size in bytes
@@ -165,22 +164,11 @@ void UdevDevice::GetSizeInfo(uint64_t* total_size,
     }
   }
 
-  // If the UDISKS_PARTITION_SIZE property is set, use it as the total size
-  // instead. If the UDISKS_PARTITION_SIZE property is not set but sysfs
-  // provides a size value, which is the actual size in bytes divided by 512,
-  // use that as the total size instead.
-  const std::string partition_size = GetProperty(kPropertyPartitionSize);
-  int64_t size = 0;
-  if (!partition_size.empty()) {
-    base::StringToInt64(partition_size, &size);
+  // If udev or sysfs provides the size of the device, use it as the total
+  // size instead.
+  uint64_t size = 0;
+  if (GetDeviceSize(&size))
     total = size;
-  } else {
-    const std::string size_attr = GetAttribute(kAttributeSize);
-    if (!size_attr.empty()) {
-      base::StringToInt64(size_attr, &size);
-      total = size * kSectorSize;
-    }
-  }
 
   if (total_size)
     *total_size = total;
@@ -188,6 +176,30 @@ void UdevDevice::GetSizeInfo(uint64_t* total_size,
     *remaining_size = remaining;
 }
 
+bool UdevDevice::GetDeviceSize(uint64_t* size) const {
+  static const int kSectorSize = 512;
+
+  // Use the UDISKS_PARTITION_SIZE property if it is set. Otherwise, use the
+  // size value sysfs may provide, which is the actual size in bytes divided by
+  // 512.
+  const std::string partition_size = GetProperty(kPropertyPartitionSize);
+  int64_t value = 0;
+  if (!partition_size.empty()) {
+    base::StringToInt64(partition_size, &value);
+    *size = value;
+    return true;
+  }
+
+  const std::string size_attr = GetAttribute(kAttributeSize);
+  if (!size_attr.empty()) {
+    base::StringToInt64(size_attr, &value);
+    *size = value * kSectorSize;
+    return true;
+  }
+
+  return false;
+}
+
 size_t UdevDevice::GetPartitionCount() const {
   size_t partition_count = 0;
   const char* dev_file = dev_->GetDeviceNode();
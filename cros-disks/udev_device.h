@@ -57,6 +57,11 @@ class UdevDevice {
   // Gets the total and remaining capacity of the device.
   void GetSizeInfo(uint64_t* total_size, uint64_t* remaining_size) const;
 
+  // Gets the size of the device from udev or sysfs. Returns false if neither
+  // provides it, in which case the total capacity of the device is the size
+  // of its mounted filesystem, if any.
+  bool GetDeviceSize(uint64_t* size) const;
+
   // Gets the number of partitions on the device.
   size_t GetPartitionCount() const;
 
@@ -5,6 +5,7 @@
 #include "diagnostics/cros_health_tool/telem/telem.h"
 
 #include <sys/types.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <cstdlib>
@@ -19,15 +20,25 @@
 #include <vector>
 
 #include <base/at_exit.h>
+#include <base/files/file_enumerator.h>
+#include <base/files/file_util.h>
 #include <base/json/json_writer.h>
 #include <base/logging.h>
+#include <base/run_loop.h>
+#include <base/strings/string_number_conversions.h>
 #include <base/strings/stringprintf.h>
 #include <base/strings/string_split.h>
 #include <base/strings/string_util.h>
 #include <base/task/single_thread_task_executor.h>
+#include <base/threading/platform_thread.h>
+#include <base/threading/thread_task_runner_handle.h>
+#include <base/time/time.h>
 #include <base/values.h>
 #include <brillo/flag_helper.h>
 #include <brillo/syslog_logging.h>
+#include <mojo/public/cpp/bindings/pending_receiver.h>
+#include <mojo/public/cpp/bindings/pending_remote.h>
+#include <mojo/public/cpp/bindings/receiver.h>
 
 #include "diagnostics/cros_healthd_mojo_adapter/cros_healthd_mojo_adapter.h"
 #include "diagnostics/mojom/external/network_health.mojom.h"
@@ -1171,6 +1182,113 @@ void DisplayTelemetryInfo(const mojom::TelemetryInfoPtr& info) {
     DisplayDisplayInfo(display_result);
 }
 
+// Displays the telemetry updates sent by cros_healthd.
+class TelemetryObserver final : public mojom::CrosHealthdTelemetryObserver {
+ public:
+  explicit TelemetryObserver(
+      mojo::PendingReceiver<mojom::CrosHealthdTelemetryObserver> receiver)
+      : receiver_{this /* impl */, std::move(receiver)} {}
+  TelemetryObserver(const TelemetryObserver&) = delete;
+  TelemetryObserver& operator=(const TelemetryObserver&) = delete;
+
+  // mojom::CrosHealthdTelemetryObserver overrides:
+  void OnTelemetryUpdate(mojom::TelemetryInfoPtr telemetry_info) override {
+    DisplayTelemetryInfo(telemetry_info);
+    update_count_++;
+  }
+
+  int update_count() const { return update_count_; }
+
+ private:
+  mojo::Receiver<mojom::CrosHealthdTelemetryObserver> receiver_;
+  int update_count_ = 0;
+};
+
+// Returns the CPU time used so far by the cros_healthd processes.
+base::TimeDelta GetCrosHealthdCpuTime() {
+  const int64_t ticks_per_second = sysconf(_SC_CLK_TCK);
+  base::TimeDelta cpu_time;
+  base::FileEnumerator proc(base::FilePath("/proc"), false,
+                            base::FileEnumerator::DIRECTORIES);
+  for (auto dir = proc.Next(); !dir.empty(); dir = proc.Next()) {
+    std::string comm;
+    if (!base::ReadFileToString(dir.Append("comm"), &comm) ||
+        base::TrimWhitespaceASCII(comm, base::TRIM_TRAILING) !=
+            "cros_healthd") {
+      continue;
+    }
+    std::string stat;
+    if (!base::ReadFileToString(dir.Append("stat"), &stat))
+      continue;
+    // The process name may contain spaces, the fields are counted after it.
+    // utime and stime are the 14th and 15th fields.
+    const size_t name_end = stat.rfind(')');
+    if (name_end == std::string::npos)
+      continue;
+    const std::vector<std::string> fields =
+        base::SplitString(stat.substr(name_end + 1), " ", base::KEEP_WHITESPACE,
+                          base::SPLIT_WANT_NONEMPTY);
+    uint64_t utime, stime;
+    if (fields.size() < 13 || !base::StringToUint64(fields[11], &utime) ||
+        !base::StringToUint64(fields[12], &stime)) {
+      continue;
+    }
+    cpu_time += base::Seconds(1) * (utime + stime) / ticks_per_second;
+  }
+  return cpu_time;
+}
+
+// Sends the telemetry of |categories| every |period| for |duration|, either by
+// probing it or through a telemetry observer, and displays the number of
+// updates and the CPU time cros_healthd used to send them.
+bool RunPeriodicTelemetry(
+    CrosHealthdMojoAdapter* adapter,
+    const std::vector<mojom::ProbeCategoryEnum>& categories,
+    base::TimeDelta period,
+    base::TimeDelta duration,
+    bool subscribe) {
+  const base::TimeDelta start_cpu_time = GetCrosHealthdCpuTime();
+  int update_count = 0;
+  if (subscribe) {
+    mojo::PendingRemote<mojom::CrosHealthdTelemetryObserver> remote;
+    TelemetryObserver observer(remote.InitWithNewPipeAndPassReceiver());
+    if (!adapter->AddTelemetryObserver(categories, period.InSeconds(),
+                                       std::move(remote))) {
+      LOG(ERROR) << "Unable to add a telemetry observer";
+      return false;
+    }
+    base::RunLoop run_loop;
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE, run_loop.QuitClosure(), duration);
+    run_loop.Run();
+    update_count = observer.update_count();
+  } else {
+    const base::TimeTicks end = base::TimeTicks::Now() + duration;
+    for (base::TimeTicks next = base::TimeTicks::Now(); next < end;
+         next += period) {
+      const base::TimeDelta delay = next - base::TimeTicks::Now();
+      if (delay.is_positive())
+        base::PlatformThread::Sleep(delay);
+      mojom::TelemetryInfoPtr result = adapter->GetTelemetryInfo(categories);
+      if (!result) {
+        LOG(ERROR) << "Unable to probe telemetry info";
+        return false;
+      }
+      DisplayTelemetryInfo(result);
+      update_count++;
+    }
+  }
+
+  base::Value output{base::Value::Type::DICTIONARY};
+  output.SetStringKey("mode", subscribe ? "subscribe" : "poll");
+  output.SetIntKey("updates", update_count);
+  output.SetIntKey(
+      "cros_healthd_cpu_time_ms",
+      (GetCrosHealthdCpuTime() - start_cpu_time).InMilliseconds());
+  OutputJson(output);
+  return true;
+}
+
 // Create a stringified list of the category names for use in help.
 std::string GetCategoryHelp() {
   std::stringstream ss;
@@ -1189,11 +1307,20 @@ std::string GetCategoryHelp() {
 // 'telem' sub-command for cros-health-tool:
 //
 // Test driver for cros_healthd's telemetry collection. Supports requesting a
-// comma-separate list of categories and/or a single process at a time.
+// comma-separate list of categories and/or a single process at a time. The
+// categories can be sent periodically, to compare the cost of polling with the
+// cost of a telemetry observer.
 int telem_main(int argc, char** argv) {
   std::string category_help = GetCategoryHelp();
   DEFINE_string(category, "", category_help.c_str());
   DEFINE_uint32(process, 0, "Process ID to probe.");
+  DEFINE_uint32(period_seconds, 0,
+                "If set, keep sending the categories every period_seconds.");
+  DEFINE_uint32(duration_seconds, 60,
+                "Number of seconds to keep sending the categories for.");
+  DEFINE_bool(subscribe, false,
+              "Receive the categories through a telemetry observer instead "
+              "of probing them every period_seconds.");
   brillo::FlagHelper::Init(argc, argv, "telem - Device telemetry tool.");
   brillo::InitLog(brillo::kLogToSyslog | brillo::kLogToStderrIfTty);
 
@@ -1236,6 +1363,16 @@ int telem_main(int argc, char** argv) {
       categories_to_probe.push_back(iterator->second);
     }
 
+    // Keep sending the category or categories, if requested.
+    if (FLAGS_period_seconds != 0) {
+      return RunPeriodicTelemetry(adapter.get(), categories_to_probe,
+                                  base::Seconds(FLAGS_period_seconds),
+                                  base::Seconds(FLAGS_duration_seconds),
+                                  FLAGS_subscribe)
+                 ? EXIT_SUCCESS
+                 : EXIT_FAILURE;
+    }
+
     // Probe and display the category or categories.
     mojom::TelemetryInfoPtr result =
         adapter->GetTelemetryInfo(categories_to_probe);
@@ -8,6 +8,7 @@
 
 #include <utility>
 
+#include <base/bind.h>
 #include <base/check.h>
 #include <base/logging.h>
 
@@ -32,7 +33,9 @@ CrosHealthdMojoService::CrosHealthdMojoService(
       lid_events_(lid_events),
       power_events_(power_events),
       audio_events_(audio_events),
-      udev_events_(udev_events) {
+      udev_events_(udev_events),
+      telemetry_subscriptions_(base::BindRepeating(
+          &FetchAggregator::Run, base::Unretained(fetch_aggregator))) {
   DCHECK(context_);
   DCHECK(fetch_aggregator_);
   DCHECK(bluetooth_events_);
@@ -98,6 +101,16 @@ void CrosHealthdMojoService::ProbeTelemetryInfo(
   return fetch_aggregator_->Run(categories, std::move(callback));
 }
 
+void CrosHealthdMojoService::AddTelemetryObserver(
+    const std::vector<ProbeCategoryEnum>& categories,
+    uint32_t period_seconds,
+    mojo::PendingRemote<
+        chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver>
+        observer) {
+  telemetry_subscriptions_.AddObserver(
+      categories, base::Seconds(period_seconds), std::move(observer));
+}
+
 void CrosHealthdMojoService::GetServiceStatus(
     GetServiceStatusCallback callback) {
   auto response = chromeos::cros_healthd::mojom::ServiceStatus::New();
@@ -18,6 +18,7 @@
 #include "diagnostics/cros_healthd/events/power_events.h"
 #include "diagnostics/cros_healthd/events/udev_events.h"
 #include "diagnostics/cros_healthd/fetch_aggregator.h"
+#include "diagnostics/cros_healthd/telemetry_subscriptions.h"
 #include "diagnostics/mojom/external/network_health.mojom.h"
 #include "diagnostics/mojom/public/cros_healthd.mojom.h"
 
@@ -80,6 +81,12 @@ class CrosHealthdMojoService final
                         ProbeProcessInfoCallback callback) override;
   void ProbeTelemetryInfo(const std::vector<ProbeCategoryEnum>& categories,
                           ProbeTelemetryInfoCallback callback) override;
+  void AddTelemetryObserver(
+      const std::vector<ProbeCategoryEnum>& categories,
+      uint32_t period_seconds,
+      mojo::PendingRemote<
+          chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver> observer)
+      override;
 
   // chromeos::cros_healthd::mojom::CrosHealthdSystemService overrides:
   void GetServiceStatus(GetServiceStatusCallback callback) override;
@@ -113,6 +120,9 @@ class CrosHealthdMojoService final
   PowerEvents* const power_events_ = nullptr;
   AudioEvents* const audio_events_ = nullptr;
   UdevEvents* const udev_events_ = nullptr;
+
+  // Serves the telemetry observers, using |fetch_aggregator_|.
+  TelemetrySubscriptions telemetry_subscriptions_;
 };
 
 }  // namespace diagnostics
@@ -166,7 +166,7 @@ CrosHealthdRoutineFactoryImpl::MakeBatteryChargeRoutine(
 
 std::unique_ptr<DiagnosticRoutine>
 CrosHealthdRoutineFactoryImpl::MakeMemoryRoutine() {
-  return std::make_unique<MemoryRoutine>(context_);
+  return std::make_unique<MemoryRoutine>();
 }
 
 std::unique_ptr<DiagnosticRoutine>
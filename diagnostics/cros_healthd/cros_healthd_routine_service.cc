@@ -377,6 +377,7 @@ void CrosHealthdRoutineService::PopulateAvailableRoutines() {
       mojo_ipc::DiagnosticRoutineEnum::kFloatingPointAccuracy,
       mojo_ipc::DiagnosticRoutineEnum::kPrimeSearch,
       mojo_ipc::DiagnosticRoutineEnum::kMemory,
+      mojo_ipc::DiagnosticRoutineEnum::kDiskRead,
       mojo_ipc::DiagnosticRoutineEnum::kLanConnectivity,
       mojo_ipc::DiagnosticRoutineEnum::kSignalStrength,
       mojo_ipc::DiagnosticRoutineEnum::kGatewayCanBePinged,
@@ -416,10 +417,6 @@ void CrosHealthdRoutineService::PopulateAvailableRoutines() {
   if (context_->system_config()->SmartCtlSupported()) {
     available_routines_.insert(mojo_ipc::DiagnosticRoutineEnum::kSmartctlCheck);
   }
-
-  if (context_->system_config()->FioSupported()) {
-    available_routines_.insert(mojo_ipc::DiagnosticRoutineEnum::kDiskRead);
-  }
 }
 
 }  // namespace diagnostics
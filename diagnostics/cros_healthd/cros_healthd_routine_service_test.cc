@@ -101,16 +101,10 @@ std::set<mojo_ipc::DiagnosticRoutineEnum> GetSmartCtlRoutines() {
       mojo_ipc::DiagnosticRoutineEnum::kSmartctlCheck};
 }
 
-std::set<mojo_ipc::DiagnosticRoutineEnum> GetFioRoutines() {
-  return std::set<mojo_ipc::DiagnosticRoutineEnum>{
-      mojo_ipc::DiagnosticRoutineEnum::kDiskRead};
-}
-
 // Tests for the CrosHealthdRoutineService class.
 class CrosHealthdRoutineServiceTest : public testing::Test {
  protected:
   void SetUp() override {
-    mock_context_.fake_system_config()->SetFioSupported(true);
     mock_context_.fake_system_config()->SetHasBattery(true);
     mock_context_.fake_system_config()->SetNvmeSupported(true);
     mock_context_.fake_system_config()->SetNvmeSupported(true);
@@ -245,22 +239,6 @@ TEST_F(CrosHealthdRoutineServiceTest, GetAvailableRoutinesNoSmartctl) {
   EXPECT_EQ(reply_set, expected_routines);
 }
 
-// Test that GetAvailableRoutines returns the expected list of routines when
-// fio routines are not supported.
-TEST_F(CrosHealthdRoutineServiceTest, GetAvailableRoutinesNoFio) {
-  mock_context()->fake_system_config()->SetFioSupported(false);
-  CreateService();
-  auto reply = ExecuteGetAvailableRoutines();
-  std::set<mojo_ipc::DiagnosticRoutineEnum> reply_set(reply.begin(),
-                                                      reply.end());
-
-  auto expected_routines = GetAllAvailableRoutines();
-  for (const auto r : GetFioRoutines())
-    expected_routines.erase(r);
-
-  EXPECT_EQ(reply_set, expected_routines);
-}
-
 // Test that GetAvailableRoutines returns the expected list of routines when
 // wilco routines are not supported.
 TEST_F(CrosHealthdRoutineServiceTest, GetAvailableRoutinesNotWilcoDevice) {
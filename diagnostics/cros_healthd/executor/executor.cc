@@ -18,7 +18,6 @@
 #include <base/files/file_util.h>
 #include <base/logging.h>
 #include <base/strings/stringprintf.h>
-#include <base/system/sys_info.h>
 #include <base/task/task_traits.h>
 #include <base/task/thread_pool.h>
 #include <base/time/time.h>
@@ -27,7 +26,6 @@
 
 #include "diagnostics/cros_healthd/executor/mojom/executor.mojom.h"
 #include "diagnostics/cros_healthd/process/process_with_output.h"
-#include "diagnostics/cros_healthd/routines/memory/memory_constants.h"
 #include "diagnostics/cros_healthd/utils/file_utils.h"
 
 namespace diagnostics {
@@ -59,10 +57,6 @@ constexpr std::array<const char*, 2> kIwScanDumpCommand{"scan", "dump"};
 // characters are in lowercase.  Max length is 16 characters.
 constexpr auto kWirelessInterfaceRegex = R"((wl[a-z][a-z0-9]{1,12}[0-9]))";
 
-// SECCOMP policy for memtester, relative to kSandboxDirPath.
-constexpr char kMemtesterSeccompPolicyPath[] = "memtester-seccomp.policy";
-constexpr char kMemtesterBinary[] = "/usr/sbin/memtester";
-
 // Whitelist of msr registers that can be read by the ReadMsr call.
 constexpr uint32_t kMsrAccessAllowList[] = {cpu_msr::kIA32TmeCapability,
                                             cpu_msr::kIA32TmeActivate};
@@ -258,75 +252,6 @@ void Executor::GetScanDump(const std::string& interface_name,
   base::ThreadPool::PostTask(FROM_HERE, {base::MayBlock()}, std::move(closure));
 }
 
-void Executor::RunMemtester(RunMemtesterCallback callback) {
-  mojom::ExecutedProcessResult result;
-
-  // TODO(b/193211343): Design a mechanism for multiple resource intensive task.
-  // Only allow one instance of memtester at a time. This is reasonable, because
-  // memtester mlocks almost the entirety of the device's memory, and a second
-  // memtester process wouldn't have any memory to test.
-  auto itr = processes_.find(kMemtesterBinary);
-  if (itr != processes_.end()) {
-    result.return_code = MemtesterErrorCodes::kAllocatingLockingInvokingError;
-    result.err = "Memtester process already running.";
-    std::move(callback).Run(result.Clone());
-    return;
-  }
-
-  // Get AvailablePhysicalMemory in MiB.
-  int64_t available_mem = base::SysInfo::AmountOfAvailablePhysicalMemory();
-  available_mem /= (1024 * 1024);
-
-  available_mem -= kMemoryRoutineReservedSizeMiB;
-  if (available_mem <= 0) {
-    result.err = "Not enough available memory to run memtester.";
-    result.return_code = MemtesterErrorCodes::kAllocatingLockingInvokingError;
-    std::move(callback).Run(result.Clone());
-    return;
-  }
-
-  // Minijail setup for memtester.
-  std::vector<std::string> sandboxing_args;
-  sandboxing_args.push_back("-c");
-  sandboxing_args.push_back("cap_ipc_lock=e");
-
-  // Additional args for memtester.
-  std::vector<std::string> memtester_args;
-  // Run with all free memory, except that which we left to the operating system
-  // above.
-  memtester_args.push_back(base::StringPrintf("%" PRId64, available_mem));
-  // Run for one loop.
-  memtester_args.push_back("1");
-
-  const auto kSeccompPolicyPath =
-      base::FilePath(kSandboxDirPath).Append(kMemtesterSeccompPolicyPath);
-
-  // Since no user:group is specified, this will run with the default
-  // cros_healthd:cros_healthd user and group.
-  base::ThreadPool::PostTask(
-      FROM_HERE, {base::MayBlock()},
-      base::BindOnce(&Executor::RunTrackedBinary, weak_factory_.GetWeakPtr(),
-                     kSeccompPolicyPath, sandboxing_args, std::nullopt,
-                     base::FilePath(kMemtesterBinary), memtester_args,
-                     std::move(result), std::move(callback)));
-}
-
-void Executor::KillMemtester() {
-  base::AutoLock auto_lock(lock_);
-  auto itr = processes_.find(kMemtesterBinary);
-  if (itr == processes_.end())
-    return;
-
-  brillo::Process* process = itr->second.get();
-  // If the process has ended, don't try to kill anything.
-  if (!process->pid())
-    return;
-
-  // Try to terminate the process nicely, then kill it if necessary.
-  if (!process->Kill(SIGTERM, kTerminationTimeout.InSeconds()))
-    process->Kill(SIGKILL, kTerminationTimeout.InSeconds());
-}
-
 void Executor::GetProcessIOContents(const uint32_t pid,
                                     GetProcessIOContentsCallback callback) {
   std::string result;
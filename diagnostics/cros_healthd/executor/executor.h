@@ -45,8 +45,6 @@ class Executor final : public mojom::Executor {
                GetInfoCallback callback) override;
   void GetScanDump(const std::string& interface_name,
                    GetScanDumpCallback callback) override;
-  void RunMemtester(RunMemtesterCallback callback) override;
-  void KillMemtester() override;
   void GetProcessIOContents(const uint32_t pid,
                             GetProcessIOContentsCallback callback) override;
   void ReadMsr(const uint32_t msr_reg,
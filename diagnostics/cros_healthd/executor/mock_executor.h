@@ -38,8 +38,6 @@ class MockExecutor final : public mojom::Executor {
               GetScanDump,
               (const std::string& interface_name, GetScanDumpCallback),
               (override));
-  MOCK_METHOD(void, RunMemtester, (RunMemtesterCallback), (override));
-  MOCK_METHOD(void, KillMemtester, (), (override));
   MOCK_METHOD(void,
               GetProcessIOContents,
               (uint32_t pid, GetProcessIOContentsCallback),
@@ -23,4 +23,13 @@ void FakeProbeService::ProbeTelemetryInfo(
   NOTIMPLEMENTED();
 }
 
+void FakeProbeService::AddTelemetryObserver(
+    const std::vector<ProbeCategoryEnum>& categories,
+    uint32_t period_seconds,
+    mojo::PendingRemote<
+        chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver>
+        observer) {
+  NOTIMPLEMENTED();
+}
+
 }  // namespace diagnostics
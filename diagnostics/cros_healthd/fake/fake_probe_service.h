@@ -8,6 +8,8 @@
 #include <cstdint>
 #include <vector>
 
+#include <mojo/public/cpp/bindings/pending_remote.h>
+
 #include "diagnostics/mojom/public/cros_healthd.mojom.h"
 
 namespace diagnostics {
@@ -28,6 +30,12 @@ class FakeProbeService final
                         ProbeProcessInfoCallback callback) override;
   void ProbeTelemetryInfo(const std::vector<ProbeCategoryEnum>& categories,
                           ProbeTelemetryInfoCallback callback) override;
+  void AddTelemetryObserver(
+      const std::vector<ProbeCategoryEnum>& categories,
+      uint32_t period_seconds,
+      mojo::PendingRemote<
+          chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver> observer)
+      override;
 };
 
 }  // namespace diagnostics
@@ -0,0 +1,164 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "diagnostics/cros_healthd/routines/cpu_validation/cpu_validation_engine.h"
+
+#include <sched.h>
+
+#include <utility>
+
+#include <base/logging.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/threading/simple_thread.h>
+
+namespace diagnostics {
+
+namespace {
+
+// Worker thread running kernels on a single CPU.
+class Worker : public base::SimpleThread {
+ public:
+  Worker(int cpu,
+         std::vector<std::unique_ptr<CpuValidationKernel>> kernels,
+         base::TimeTicks end_time)
+      : base::SimpleThread("cpu_validation_" + base::NumberToString(cpu)),
+        kernels_(std::move(kernels)),
+        end_time_(end_time) {
+    result_.cpu = cpu;
+    for (const auto& kernel : kernels_) {
+      result_.kernels.emplace_back();
+      result_.kernels.back().name = kernel->GetName();
+    }
+  }
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+
+  const CpuValidationEngine::CpuResult& result() const { return result_; }
+
+  void Run() override {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(result_.cpu, &cpu_set);
+    result_.pinned = sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+    if (!result_.pinned)
+      PLOG(WARNING) << "Failed to pin worker to CPU " << result_.cpu;
+
+    do {
+      for (size_t i = 0; i < kernels_.size(); ++i) {
+        auto& kernel_result = result_.kernels[i];
+        const base::TimeTicks start = base::TimeTicks::Now();
+        const bool success = kernels_[i]->Run();
+        kernel_result.elapsed += base::TimeTicks::Now() - start;
+        kernel_result.iterations++;
+        if (!success) {
+          LOG(ERROR) << "Kernel " << kernel_result.name
+                     << " returned a wrong answer on CPU " << result_.cpu;
+          kernel_result.mismatches++;
+        }
+      }
+    } while (base::TimeTicks::Now() < end_time_);
+  }
+
+ private:
+  const std::vector<std::unique_ptr<CpuValidationKernel>> kernels_;
+  const base::TimeTicks end_time_;
+  CpuValidationEngine::CpuResult result_;
+};
+
+}  // namespace
+
+CpuValidationEngine::CpuValidationEngine(
+    std::vector<KernelFactory> kernel_factories)
+    : kernel_factories_(std::move(kernel_factories)) {}
+
+CpuValidationEngine::~CpuValidationEngine() = default;
+
+std::vector<CpuValidationEngine::CpuResult> CpuValidationEngine::Run(
+    base::TimeDelta duration) {
+  const base::TimeTicks end_time = base::TimeTicks::Now() + duration;
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (int cpu : GetOnlineCpus()) {
+    std::vector<std::unique_ptr<CpuValidationKernel>> kernels;
+    for (const auto& factory : kernel_factories_)
+      kernels.push_back(factory.Run());
+    workers.push_back(
+        std::make_unique<Worker>(cpu, std::move(kernels), end_time));
+  }
+
+  for (auto& worker : workers)
+    worker->Start();
+
+  std::vector<CpuResult> results;
+  for (auto& worker : workers) {
+    worker->Join();
+    results.push_back(worker->result());
+  }
+  return results;
+}
+
+// static
+std::vector<int> CpuValidationEngine::GetOnlineCpus() {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) != 0) {
+    PLOG(ERROR) << "Failed to get the CPU affinity";
+    // Still run a single unpinned worker.
+    return {0};
+  }
+
+  std::vector<int> cpus;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set))
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+// static
+uint64_t CpuValidationEngine::CountMismatches(
+    const std::vector<CpuResult>& results) {
+  uint64_t mismatches = 0;
+  for (const auto& cpu_result : results) {
+    for (const auto& kernel_result : cpu_result.kernels)
+      mismatches += kernel_result.mismatches;
+  }
+  return mismatches;
+}
+
+// static
+base::Value CpuValidationEngine::ResultsToValue(
+    const std::vector<CpuResult>& results) {
+  base::Value cpus(base::Value::Type::LIST);
+  for (const auto& cpu_result : results) {
+    base::Value kernels(base::Value::Type::LIST);
+    for (const auto& kernel_result : cpu_result.kernels) {
+      base::Value kernel(base::Value::Type::DICTIONARY);
+      kernel.SetStringKey("name", kernel_result.name);
+      kernel.SetIntKey("iterations",
+                       static_cast<int>(kernel_result.iterations));
+      kernel.SetIntKey("mismatches",
+                       static_cast<int>(kernel_result.mismatches));
+      const double seconds = kernel_result.elapsed.InSecondsF();
+      kernel.SetDoubleKey(
+          "iterationsPerSecond",
+          seconds > 0 ? kernel_result.iterations / seconds : 0.0);
+      kernels.Append(std::move(kernel));
+    }
+
+    base::Value cpu(base::Value::Type::DICTIONARY);
+    cpu.SetIntKey("cpu", cpu_result.cpu);
+    cpu.SetBoolKey("pinned", cpu_result.pinned);
+    cpu.SetKey("kernels", std::move(kernels));
+    cpus.Append(std::move(cpu));
+  }
+
+  base::Value output(base::Value::Type::DICTIONARY);
+  output.SetKey("cpus", std::move(cpus));
+  output.SetIntKey("mismatches",
+                   static_cast<int>(CountMismatches(results)));
+  return output;
+}
+
+}  // namespace diagnostics
@@ -0,0 +1,74 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DIAGNOSTICS_CROS_HEALTHD_ROUTINES_CPU_VALIDATION_CPU_VALIDATION_ENGINE_H_
+#define DIAGNOSTICS_CROS_HEALTHD_ROUTINES_CPU_VALIDATION_CPU_VALIDATION_ENGINE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/time/time.h>
+#include <base/values.h>
+
+#include "diagnostics/cros_healthd/routines/cpu_validation/cpu_validation_kernels.h"
+
+namespace diagnostics {
+
+// CpuValidationEngine runs a set of kernels with known answers on every online
+// CPU at once, each on a worker thread pinned to its CPU, and reports the
+// throughput and the mismatches of every kernel per CPU. Running all the cores
+// together catches faults that only show up under load, and the per-CPU
+// results point at the faulty core.
+class CpuValidationEngine {
+ public:
+  using KernelFactory =
+      base::RepeatingCallback<std::unique_ptr<CpuValidationKernel>()>;
+
+  struct KernelResult {
+    std::string name;
+    // Number of runs of the kernel and number of runs which returned a wrong
+    // answer.
+    uint64_t iterations = 0;
+    uint64_t mismatches = 0;
+    // Total time spent running the kernel.
+    base::TimeDelta elapsed;
+  };
+
+  struct CpuResult {
+    int cpu = 0;
+    // False if the worker could not be pinned to |cpu| and ran wherever the
+    // scheduler put it.
+    bool pinned = false;
+    std::vector<KernelResult> kernels;
+  };
+
+  // Each worker creates its own kernels from |kernel_factories|.
+  explicit CpuValidationEngine(std::vector<KernelFactory> kernel_factories);
+  CpuValidationEngine(const CpuValidationEngine&) = delete;
+  CpuValidationEngine& operator=(const CpuValidationEngine&) = delete;
+  ~CpuValidationEngine();
+
+  // Runs the kernels in turn on every CPU returned by GetOnlineCpus() until
+  // |duration| has elapsed. Every kernel runs at least once on each CPU.
+  std::vector<CpuResult> Run(base::TimeDelta duration);
+
+  // Returns the CPUs the process is allowed to run on.
+  static std::vector<int> GetOnlineCpus();
+
+  // Returns the total number of mismatches in |results|.
+  static uint64_t CountMismatches(const std::vector<CpuResult>& results);
+
+  // Converts |results| to the dictionary reported as the routine output.
+  static base::Value ResultsToValue(const std::vector<CpuResult>& results);
+
+ private:
+  const std::vector<KernelFactory> kernel_factories_;
+};
+
+}  // namespace diagnostics
+
+#endif  // DIAGNOSTICS_CROS_HEALTHD_ROUTINES_CPU_VALIDATION_CPU_VALIDATION_ENGINE_H_
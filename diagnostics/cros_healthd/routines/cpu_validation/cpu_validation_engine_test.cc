@@ -0,0 +1,111 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+
+#include <base/bind.h>
+#include <base/time/time.h>
+#include <base/values.h>
+#include <gtest/gtest.h>
+
+#include "diagnostics/cros_healthd/routines/cpu_validation/cpu_validation_engine.h"
+#include "diagnostics/cros_healthd/routines/cpu_validation/cpu_validation_kernels.h"
+
+namespace diagnostics {
+namespace {
+
+// Kernel returning a fixed answer.
+class FakeKernel : public CpuValidationKernel {
+ public:
+  explicit FakeKernel(bool result) : result_(result) {}
+
+  std::string GetName() const override { return "fake"; }
+  bool Run() override { return result_; }
+
+ private:
+  const bool result_;
+};
+
+std::unique_ptr<CpuValidationKernel> CreateFakeKernel(bool result) {
+  return std::make_unique<FakeKernel>(result);
+}
+
+// Test that the kernels find the known answers.
+TEST(CpuValidationKernelsTest, KernelsPass) {
+  EXPECT_TRUE(CreatePrimeSearchKernel(1000)->Run());
+  EXPECT_TRUE(CreateFloatingPointKernel()->Run());
+  EXPECT_TRUE(CreateSimdKernel()->Run());
+
+  // The pattern changes between runs.
+  auto cache_kernel = CreateCacheKernel(1024 * 1024);
+  EXPECT_TRUE(cache_kernel->Run());
+  EXPECT_TRUE(cache_kernel->Run());
+}
+
+// Test that every kernel runs at least once on every online CPU.
+TEST(CpuValidationEngineTest, RunOnEveryCpu) {
+  CpuValidationEngine engine(
+      {base::BindRepeating(&CreateFakeKernel, true),
+       base::BindRepeating(&CreateFloatingPointKernel)});
+  const auto results = engine.Run(base::TimeDelta());
+
+  ASSERT_EQ(results.size(), CpuValidationEngine::GetOnlineCpus().size());
+  for (const auto& cpu_result : results) {
+    ASSERT_EQ(cpu_result.kernels.size(), 2u);
+    EXPECT_EQ(cpu_result.kernels[0].name, "fake");
+    EXPECT_EQ(cpu_result.kernels[1].name, "floatingPoint");
+    for (const auto& kernel_result : cpu_result.kernels) {
+      EXPECT_GE(kernel_result.iterations, 1u);
+      EXPECT_EQ(kernel_result.mismatches, 0u);
+    }
+  }
+  EXPECT_EQ(CpuValidationEngine::CountMismatches(results), 0u);
+}
+
+// Test that wrong answers are reported for every CPU.
+TEST(CpuValidationEngineTest, ReportMismatches) {
+  CpuValidationEngine engine({base::BindRepeating(&CreateFakeKernel, false)});
+  const auto results = engine.Run(base::TimeDelta());
+
+  uint64_t iterations = 0;
+  for (const auto& cpu_result : results) {
+    ASSERT_EQ(cpu_result.kernels.size(), 1u);
+    EXPECT_EQ(cpu_result.kernels[0].mismatches,
+              cpu_result.kernels[0].iterations);
+    iterations += cpu_result.kernels[0].iterations;
+  }
+  EXPECT_GE(iterations, 1u);
+  EXPECT_EQ(CpuValidationEngine::CountMismatches(results), iterations);
+}
+
+// Test the format of the report.
+TEST(CpuValidationEngineTest, ResultsToValue) {
+  CpuValidationEngine::CpuResult cpu_result;
+  cpu_result.cpu = 3;
+  cpu_result.pinned = true;
+  cpu_result.kernels.push_back({"simd", 10, 2, base::Seconds(2)});
+
+  const base::Value value = CpuValidationEngine::ResultsToValue({cpu_result});
+  EXPECT_EQ(value.FindIntKey("mismatches"), 2);
+  const base::Value* cpus = value.FindListKey("cpus");
+  ASSERT_TRUE(cpus);
+  ASSERT_EQ(cpus->GetList().size(), 1u);
+
+  const base::Value& cpu = cpus->GetList()[0];
+  EXPECT_EQ(cpu.FindIntKey("cpu"), 3);
+  EXPECT_EQ(cpu.FindBoolKey("pinned"), true);
+  const base::Value* kernels = cpu.FindListKey("kernels");
+  ASSERT_TRUE(kernels);
+  ASSERT_EQ(kernels->GetList().size(), 1u);
+
+  const base::Value& kernel = kernels->GetList()[0];
+  EXPECT_EQ(*kernel.FindStringKey("name"), "simd");
+  EXPECT_EQ(kernel.FindIntKey("iterations"), 10);
+  EXPECT_EQ(kernel.FindIntKey("mismatches"), 2);
+  EXPECT_EQ(kernel.FindDoubleKey("iterationsPerSecond"), 5.0);
+}
+
+}  // namespace
+}  // namespace diagnostics
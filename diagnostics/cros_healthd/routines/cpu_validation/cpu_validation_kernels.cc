@@ -0,0 +1,265 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "diagnostics/cros_healthd/routines/cpu_validation/cpu_validation_kernels.h"
+
+#include <float.h>
+#include <math.h>
+
+#include <array>
+#include <vector>
+
+#include <base/logging.h>
+
+#include "diagnostics/cros_healthd/routines/prime_search/prime_number_search.h"
+
+namespace diagnostics {
+
+namespace {
+
+// 1.0 / 1024.0, exactly representable as are all its multiples used below.
+constexpr float kIncrement = 0.0009765625f;
+// Number of iterations of the floating-point and SIMD kernels. Adding
+// |kIncrement| that many times gives exactly |kExpectedSum|.
+constexpr int kIterations = 1000000;
+constexpr float kExpectedSum = 976.5625f;
+
+// Parameters of the linear congruential generator used by the SIMD kernel.
+constexpr uint32_t kLcgMultiplier = 1664525;
+constexpr uint32_t kLcgIncrement = 1013904223;
+
+// Number of 32-bit lanes of the widest vectors used by the SIMD kernel.
+constexpr int kMaxLanes = 8;
+
+// The inputs are read from volatile variables so that the compiler can't
+// compute the results at build time.
+volatile float g_increment = kIncrement;
+volatile uint32_t g_lcg_multiplier = kLcgMultiplier;
+volatile uint32_t g_lcg_increment = kLcgIncrement;
+
+bool IsExpectedSum(float sum) {
+  return fabs(sum - kExpectedSum) <= FLT_EPSILON;
+}
+
+class PrimeSearchKernel : public CpuValidationKernel {
+ public:
+  explicit PrimeSearchKernel(uint64_t max_num)
+      : prime_number_search_(max_num) {}
+
+  std::string GetName() const override { return "primeSearch"; }
+  bool Run() override { return prime_number_search_.Run(); }
+
+ private:
+  PrimeNumberSearch prime_number_search_;
+};
+
+class FloatingPointKernel : public CpuValidationKernel {
+ public:
+  std::string GetName() const override { return "floatingPoint"; }
+
+  // Declares 16 variables which will map to 16 XMM registers on the
+  // architecture where the SSE hardware is available.
+  bool Run() override {
+    const float increment = g_increment;
+    float a = 0.0f, b = 0.0f, c = 0.0f, d = 0.0f;
+    float e = 0.0f, f = 0.0f, g = 0.0f, h = 0.0f;
+    float i = 0.0f, j = 0.0f, k = 0.0f, l = 0.0f;
+    float m = 0.0f, n = 0.0f, o = 0.0f, p = 0.0f;
+
+    int x = kIterations;
+    do {
+      a += increment;
+      b += increment;
+      c += increment;
+      d += increment;
+      e += increment;
+      f += increment;
+      g += increment;
+      h += increment;
+      i += increment;
+      j += increment;
+      k += increment;
+      l += increment;
+      m += increment;
+      n += increment;
+      o += increment;
+      p += increment;
+    } while (--x);
+
+    for (float sum : {a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p}) {
+      if (!IsExpectedSum(sum))
+        return false;
+    }
+    return true;
+  }
+};
+
+using Float4 = float __attribute__((vector_size(16)));
+using Uint4 = uint32_t __attribute__((vector_size(16)));
+
+// Returns the value of the linear congruential generator after |kIterations|
+// steps from |seed|.
+uint32_t ScalarLcg(uint32_t seed) {
+  const uint32_t multiplier = g_lcg_multiplier;
+  const uint32_t increment = g_lcg_increment;
+  for (int i = 0; i < kIterations; ++i)
+    seed = seed * multiplier + increment;
+  return seed;
+}
+
+// Runs the computations of the SIMD kernel on 4 lanes vectors. Lane |i| of the
+// generator is seeded with |i|.
+bool RunSimd128(const std::array<uint32_t, kMaxLanes>& expected_lcg) {
+  const float increment = g_increment;
+  const uint32_t multiplier = g_lcg_multiplier;
+  const uint32_t lcg_increment = g_lcg_increment;
+  Float4 a = {}, b = {}, c = {}, d = {};
+  const Float4 increments = {increment, increment, increment, increment};
+  Uint4 x = {0, 1, 2, 3};
+  Uint4 y = {4, 5, 6, 7};
+
+  for (int i = 0; i < kIterations; ++i) {
+    a += increments;
+    b += increments;
+    c += increments;
+    d += increments;
+    x = x * multiplier + lcg_increment;
+    y = y * multiplier + lcg_increment;
+  }
+
+  for (int lane = 0; lane < 4; ++lane) {
+    if (!IsExpectedSum(a[lane]) || !IsExpectedSum(b[lane]) ||
+        !IsExpectedSum(c[lane]) || !IsExpectedSum(d[lane]) ||
+        x[lane] != expected_lcg[lane] || y[lane] != expected_lcg[lane + 4]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+using Float8 = float __attribute__((vector_size(32)));
+using Uint8 = uint32_t __attribute__((vector_size(32)));
+
+// Same as RunSimd128() on AVX2 vectors of 8 lanes.
+__attribute__((target("avx2"))) bool RunSimd256(
+    const std::array<uint32_t, kMaxLanes>& expected_lcg) {
+  const float increment = g_increment;
+  const uint32_t multiplier = g_lcg_multiplier;
+  const uint32_t lcg_increment = g_lcg_increment;
+  Float8 a = {}, b = {};
+  const Float8 increments = {increment, increment, increment, increment,
+                             increment, increment, increment, increment};
+  Uint8 x = {0, 1, 2, 3, 4, 5, 6, 7};
+
+  for (int i = 0; i < kIterations; ++i) {
+    a += increments;
+    b += increments;
+    x = x * multiplier + lcg_increment;
+  }
+
+  for (int lane = 0; lane < 8; ++lane) {
+    if (!IsExpectedSum(a[lane]) || !IsExpectedSum(b[lane]) ||
+        x[lane] != expected_lcg[lane]) {
+      return false;
+    }
+  }
+  return true;
+}
+#endif  // defined(__x86_64__) || defined(__i386__)
+
+class SimdKernel : public CpuValidationKernel {
+ public:
+  SimdKernel() {
+    for (int lane = 0; lane < kMaxLanes; ++lane)
+      expected_lcg_[lane] = ScalarLcg(lane);
+#if defined(__x86_64__) || defined(__i386__)
+    has_avx2_ = __builtin_cpu_supports("avx2");
+#endif
+  }
+
+  std::string GetName() const override { return "simd"; }
+
+  bool Run() override {
+    if (!RunSimd128(expected_lcg_))
+      return false;
+#if defined(__x86_64__) || defined(__i386__)
+    if (has_avx2_ && !RunSimd256(expected_lcg_))
+      return false;
+#endif
+    return true;
+  }
+
+ private:
+  std::array<uint32_t, kMaxLanes> expected_lcg_;
+  bool has_avx2_ = false;
+};
+
+// Odd stride, in words, used to read the buffer of the cache kernel. It spans
+// several pages so that consecutive reads hit different cache sets.
+constexpr size_t kCacheStride = 4099;
+
+class CacheKernel : public CpuValidationKernel {
+ public:
+  explicit CacheKernel(size_t buffer_size) {
+    // A power of two number of words makes |kCacheStride| coprime with the
+    // buffer size, so that the strided reads visit every word once.
+    size_t words = 1;
+    while (words * 2 * sizeof(uint64_t) <= buffer_size)
+      words *= 2;
+    buffer_.resize(words);
+  }
+
+  std::string GetName() const override { return "cache"; }
+
+  bool Run() override {
+    pass_++;
+    for (size_t i = 0; i < buffer_.size(); ++i)
+      buffer_[i] = Pattern(i);
+
+    // Reads go through a volatile pointer so that they are not optimized out.
+    const volatile uint64_t* words = buffer_.data();
+    const size_t mask = buffer_.size() - 1;
+    size_t index = 0;
+    for (size_t i = 0; i < buffer_.size(); ++i) {
+      if (words[index] != Pattern(index)) {
+        LOG(ERROR) << "Cache pattern mismatch at word " << index;
+        return false;
+      }
+      index = (index + kCacheStride) & mask;
+    }
+    return true;
+  }
+
+ private:
+  // Returns the pattern of word |index| for the current pass. Patterns change
+  // between passes so that stale data is detected.
+  uint64_t Pattern(size_t index) const {
+    return (index * 0x9E3779B97F4A7C15ull) ^ (pass_ * 0xC2B2AE3D27D4EB4Full);
+  }
+
+  std::vector<uint64_t> buffer_;
+  uint64_t pass_ = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<CpuValidationKernel> CreatePrimeSearchKernel(
+    uint64_t max_num) {
+  return std::make_unique<PrimeSearchKernel>(max_num);
+}
+
+std::unique_ptr<CpuValidationKernel> CreateFloatingPointKernel() {
+  return std::make_unique<FloatingPointKernel>();
+}
+
+std::unique_ptr<CpuValidationKernel> CreateSimdKernel() {
+  return std::make_unique<SimdKernel>();
+}
+
+std::unique_ptr<CpuValidationKernel> CreateCacheKernel(size_t buffer_size) {
+  return std::make_unique<CacheKernel>(buffer_size);
+}
+
+}  // namespace diagnostics
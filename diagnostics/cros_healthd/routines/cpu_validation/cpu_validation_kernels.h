@@ -0,0 +1,50 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DIAGNOSTICS_CROS_HEALTHD_ROUTINES_CPU_VALIDATION_CPU_VALIDATION_KERNELS_H_
+#define DIAGNOSTICS_CROS_HEALTHD_ROUTINES_CPU_VALIDATION_CPU_VALIDATION_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace diagnostics {
+
+// A computation with a known answer, run repeatedly by CpuValidationEngine to
+// exercise one unit of a CPU core.
+class CpuValidationKernel {
+ public:
+  virtual ~CpuValidationKernel() = default;
+
+  // Returns the name of the kernel used in the report.
+  virtual std::string GetName() const = 0;
+
+  // Runs the computation once. Returns false if the result doesn't match the
+  // known answer.
+  virtual bool Run() = 0;
+};
+
+// Compares a Sieve of Eratosthenes with trial divisions for the numbers up to
+// |max_num|. Exercises the integer units.
+std::unique_ptr<CpuValidationKernel> CreatePrimeSearchKernel(uint64_t max_num);
+
+// Accumulates exactly representable increments in 16 scalar floats.
+// Exercises the floating-point unit.
+std::unique_ptr<CpuValidationKernel> CreateFloatingPointKernel();
+
+// Runs floating-point and integer computations on 128-bit vectors, which
+// compile to SSE on x86 and NEON on ARM, and on 256-bit AVX vectors when
+// supported. Results are compared with the same computations done with
+// scalars.
+std::unique_ptr<CpuValidationKernel> CreateSimdKernel();
+
+// Writes a pattern to a buffer of |buffer_size| bytes and reads it back with a
+// stride defeating the prefetchers. The buffer should be larger than the
+// caches of a core to exercise cache fills and evictions.
+std::unique_ptr<CpuValidationKernel> CreateCacheKernel(size_t buffer_size);
+
+}  // namespace diagnostics
+
+#endif  // DIAGNOSTICS_CROS_HEALTHD_ROUTINES_CPU_VALIDATION_CPU_VALIDATION_KERNELS_H_
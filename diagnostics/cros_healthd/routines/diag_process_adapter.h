@@ -26,6 +26,12 @@ class DiagProcessAdapter {
   virtual bool StartProcess(const std::vector<std::string>& args,
                             base::ProcessHandle* handle) = 0;
 
+  // Launches the specified process with its standard output redirected to
+  // |stdout_fd|.
+  virtual bool StartProcessWithOutput(const std::vector<std::string>& args,
+                                      int stdout_fd,
+                                      base::ProcessHandle* handle) = 0;
+
   // Kills the process which was started earlier by StartProcess.
   virtual bool KillProcess(const base::ProcessHandle& handle) = 0;
 };
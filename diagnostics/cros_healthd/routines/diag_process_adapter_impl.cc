@@ -5,6 +5,7 @@
 #include "diagnostics/cros_healthd/routines/diag_process_adapter_impl.h"
 
 #include <stdlib.h>
+#include <unistd.h>
 
 #include <base/check_op.h>
 #include <base/command_line.h>
@@ -28,8 +29,23 @@ base::TerminationStatus DiagProcessAdapterImpl::GetStatus(
 
 bool DiagProcessAdapterImpl::StartProcess(const std::vector<std::string>& args,
                                           base::ProcessHandle* handle) {
+  return LaunchProcess(args, base::LaunchOptions(), handle);
+}
+
+bool DiagProcessAdapterImpl::StartProcessWithOutput(
+    const std::vector<std::string>& args,
+    int stdout_fd,
+    base::ProcessHandle* handle) {
+  base::LaunchOptions options;
+  options.fds_to_remap.emplace_back(stdout_fd, STDOUT_FILENO);
+  return LaunchProcess(args, options, handle);
+}
+
+bool DiagProcessAdapterImpl::LaunchProcess(const std::vector<std::string>& args,
+                                           const base::LaunchOptions& options,
+                                           base::ProcessHandle* handle) {
   exe_path_ = args[0];
-  base::Process process = base::LaunchProcess(args, base::LaunchOptions());
+  base::Process process = base::LaunchProcess(args, options);
   if (process.IsValid()) {
     *handle = process.Handle();
     return true;
@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 
+#include <base/process/launch.h>
+
 #include "diagnostics/cros_healthd/routines/diag_process_adapter.h"
 
 namespace diagnostics {
@@ -23,9 +25,16 @@ class DiagProcessAdapterImpl final : public DiagProcessAdapter {
       const base::ProcessHandle& handle) const override;
   bool StartProcess(const std::vector<std::string>& args,
                     base::ProcessHandle* handle) override;
+  bool StartProcessWithOutput(const std::vector<std::string>& args,
+                              int stdout_fd,
+                              base::ProcessHandle* handle) override;
   bool KillProcess(const base::ProcessHandle& handle) override;
 
  private:
+  bool LaunchProcess(const std::vector<std::string>& args,
+                     const base::LaunchOptions& options,
+                     base::ProcessHandle* handle);
+
   std::string exe_path_;
 };
 
@@ -4,98 +4,297 @@
 
 #include "diagnostics/cros_healthd/routines/disk_read/disk_read.h"
 
-#include <list>
-#include <string>
+#include <fcntl.h>
+
+#include <algorithm>
+#include <atomic>
 #include <utility>
-#include <vector>
 
 #include <base/bind.h>
-#include <base/command_line.h>
+#include <base/check.h>
+#include <base/check_op.h>
 #include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/json/json_writer.h>
 #include <base/logging.h>
-#include <base/numerics/safe_conversions.h>
-#include <base/strings/string_number_conversions.h>
+#include <base/memory/ref_counted.h>
+#include <base/posix/eintr_wrapper.h>
 #include <base/system/sys_info.h>
-#include <base/time/time.h>
+#include <base/task/task_traits.h>
+#include <base/task/thread_pool.h>
+
+#include "diagnostics/common/mojo_utils.h"
+
+namespace diagnostics {
 
 namespace {
 
 namespace mojo_ipc = ::chromeos::cros_healthd::mojom;
 
 constexpr char kTmpPath[] = "/var/cache/diagnostics";
-constexpr char kTestFileName[] = "fio-test-file";
-constexpr char kFioExePath[] = "/usr/bin/fio";
-constexpr float kFileCreationTimePerMB = 0.005;
-constexpr uint32_t kSpaceLowMB = 1024;
+constexpr char kTestFileName[] = "disk-read-test-file";
+// Approximate time to write the test file, used to report progress.
+constexpr base::TimeDelta kFileCreationTimePerMB = base::Milliseconds(5);
+// Free space left on the stateful partition while the test file exists, so
+// that the storage space state doesn't fall into 'low'.
+constexpr int64_t kSpaceLowMB = 1024;
+
+// Sequential reads use large blocks to measure the bandwidth, random reads
+// small blocks at a high queue depth to measure the IOPS.
+constexpr size_t kLinearReadBlockSize = 128 * 1024;
+constexpr uint32_t kLinearReadQueueDepth = 4;
+constexpr size_t kRandomReadBlockSize = kDiskReadSectorSize;
+constexpr uint32_t kRandomReadQueueDepth = 32;
+
+int64_t NowInMicroseconds() {
+  return (base::TimeTicks::Now() - base::TimeTicks()).InMicroseconds();
+}
 
 }  // namespace
 
-namespace diagnostics {
+// Writes the test file, reads it back and deletes it, on a thread pool.
+class DiskReadJob : public base::RefCountedThreadSafe<DiskReadJob> {
+ public:
+  DiskReadJob(const base::FilePath& test_file,
+              uint64_t file_size,
+              const DiskReadOptions& options)
+      : test_file_(test_file), file_size_(file_size), options_(options) {}
+  DiskReadJob(const DiskReadJob&) = delete;
+  DiskReadJob& operator=(const DiskReadJob&) = delete;
 
-std::unique_ptr<DiagnosticRoutine> CreateDiskReadRoutine(
-    chromeos::cros_healthd::mojom::DiskReadRoutineTypeEnum type,
-    base::TimeDelta exec_duration,
-    uint32_t file_size_mb) {
-  std::vector<std::string> prepare_cmd{
-      kFioExePath,
-      "--name=prepare",
-      "--filename=" + base::FilePath(kTmpPath).Append(kTestFileName).value(),
-      "--size=" + base::NumberToString(file_size_mb) + "MB",
-      "--verify=md5",
-      "--rw=write",
-      "--end_fsync=1"};
-
-  std::vector<std::string> run_cmd{
-      kFioExePath,
-      "--name=run",
-      "--filename=" + base::FilePath(kTmpPath).Append(kTestFileName).value(),
-      "--time_based=1",
-      "--runtime=" + base::NumberToString(exec_duration.InSeconds()),
-      "--direct=1",
-      (type == mojo_ipc::DiskReadRoutineTypeEnum::kLinearRead)
-          ? "--rw=read"
-          : "--rw=randread"};
-
-  auto subproc_routine_ptr = std::make_unique<SubprocRoutine>(
-      std::list<base::CommandLine>{base::CommandLine(prepare_cmd),
-                                   base::CommandLine(run_cmd)},
-      exec_duration + base::Seconds(static_cast<int>(kFileCreationTimePerMB *
-                                                     file_size_mb)));
+  // Returns nullopt if the test file could not be written or read.
+  std::optional<DiskReadResult> Run() {
+    std::optional<DiskReadResult> result;
+    if (WriteDiskReadTestFile(test_file_, file_size_, &written_bytes_,
+                              &cancelled_)) {
+      result = ReadTestFile();
+    }
+    if (!base::DeleteFile(test_file_))
+      LOG(ERROR) << "Failed to delete " << test_file_.value();
+    return result;
+  }
+
+  void Cancel() { cancelled_.store(true); }
+
+  // Returns whether the test file was read with O_DIRECT. Only valid once
+  // Run() returned.
+  bool direct_io() const { return direct_io_.load(); }
+
+  uint32_t GetProgressPercent() const {
+    // The progress of the reads is based on time, as they stop after
+    // |options_.duration|.
+    const double write_seconds =
+        (kFileCreationTimePerMB * (file_size_ / (1024 * 1024))).InSecondsF();
+    const double read_seconds = options_.duration.InSecondsF();
+    if (write_seconds + read_seconds <= 0)
+      return 0;
+
+    double done_seconds = 0;
+    if (file_size_ > 0) {
+      done_seconds += write_seconds * written_bytes_.load() / file_size_;
+    }
+    const int64_t read_start_us = read_start_us_.load();
+    if (read_start_us) {
+      done_seconds += std::min(
+          read_seconds, (NowInMicroseconds() - read_start_us) / 1000000.0);
+    }
+    return std::min<uint32_t>(
+        100, 100 * done_seconds / (write_seconds + read_seconds));
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<DiskReadJob>;
+  ~DiskReadJob() = default;
+
+  std::optional<DiskReadResult> ReadTestFile() {
+    // O_DIRECT bypasses the page cache, which holds the file just written.
+    base::ScopedFD fd(HANDLE_EINTR(
+        open(test_file_.value().c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC)));
+    direct_io_.store(fd.is_valid());
+    if (!fd.is_valid() && errno == EINVAL) {
+      // Some file systems, e.g. tmpfs, don't support O_DIRECT.
+      LOG(WARNING) << "Reading " << test_file_.value() << " without O_DIRECT";
+      fd.reset(HANDLE_EINTR(
+          open(test_file_.value().c_str(), O_RDONLY | O_CLOEXEC)));
+      if (fd.is_valid())
+        posix_fadvise(fd.get(), 0, 0, POSIX_FADV_DONTNEED);
+    }
+    if (!fd.is_valid()) {
+      PLOG(ERROR) << "Failed to open " << test_file_.value();
+      return std::nullopt;
+    }
+
+    read_start_us_.store(NowInMicroseconds());
+    return DiskReader(fd.get(), file_size_, options_).Run(&cancelled_);
+  }
+
+  const base::FilePath test_file_;
+  const uint64_t file_size_;
+  const DiskReadOptions options_;
+
+  std::atomic<bool> cancelled_{false};
+  std::atomic<bool> direct_io_{false};
+  std::atomic<uint64_t> written_bytes_{0};
+  // When the reads started, zero before.
+  std::atomic<int64_t> read_start_us_{0};
+};
+
+DiskReadRoutine::DiskReadRoutine(mojo_ipc::DiskReadRoutineTypeEnum type,
+                                 base::TimeDelta exec_duration,
+                                 uint32_t file_size_mb,
+                                 const base::FilePath& test_dir)
+    : test_file_(test_dir.Append(kTestFileName)),
+      file_size_mb_(file_size_mb),
+      status_(mojo_ipc::DiagnosticRoutineStatusEnum::kReady) {
+  options_.random = type == mojo_ipc::DiskReadRoutineTypeEnum::kRandomRead;
+  options_.block_size =
+      options_.random ? kRandomReadBlockSize : kLinearReadBlockSize;
+  options_.queue_depth =
+      options_.random ? kRandomReadQueueDepth : kLinearReadQueueDepth;
+  options_.duration = exec_duration;
+}
+
+DiskReadRoutine::~DiskReadRoutine() {
+  // Stop the background job early, it would not be reported anyway.
+  if (status_ == mojo_ipc::DiagnosticRoutineStatusEnum::kRunning)
+    job_->Cancel();
+}
+
+void DiskReadRoutine::Start() {
+  DCHECK_EQ(status_, mojo_ipc::DiagnosticRoutineStatusEnum::kReady);
 
   // Ensure DUT has sufficient storage space and prevent storage space state
   // from falling into 'low' state during test.
-  auto storage_space_check = base::BindOnce(
-      [=](uint32_t file_size_mb) {
-        int64_t available_storage_space_byte =
-            base::SysInfo::AmountOfFreeDiskSpace(base::FilePath(kTmpPath));
-        if (available_storage_space_byte == -1) {
-          LOG(ERROR) << "Failed to retrieve available disk space";
-          return false;
-        }
-        uint32_t available_storage_space_mb =
-            base::checked_cast<uint32_t>(available_storage_space_byte / 1024 /
-                                         1024) -
-            kSpaceLowMB;
-        if (available_storage_space_mb < file_size_mb) {
-          LOG(ERROR) << "Insufficient storage space";
-          return false;
-        }
-        return true;
-      },
-      file_size_mb);
-
-  // Clean up test file created by fio.
-  auto test_file_deletion = base::BindOnce([]() {
-    auto test_file = base::FilePath(kTmpPath).Append(kTestFileName);
-    if (base::PathExists(test_file)) {
-      base::DeleteFile(test_file);
-    }
-  });
+  const int64_t available_storage_space_byte =
+      base::SysInfo::AmountOfFreeDiskSpace(test_file_.DirName());
+  if (available_storage_space_byte == -1) {
+    LOG(ERROR) << "Failed to retrieve available disk space";
+    status_ = mojo_ipc::DiagnosticRoutineStatusEnum::kFailedToStart;
+    status_message_ = kDiskReadRoutineErrorMessage;
+    return;
+  }
+  if (available_storage_space_byte / 1024 / 1024 - kSpaceLowMB <
+      file_size_mb_) {
+    LOG(ERROR) << "Insufficient storage space";
+    status_ = mojo_ipc::DiagnosticRoutineStatusEnum::kFailedToStart;
+    status_message_ = kDiskReadRoutineInsufficientSpaceMessage;
+    return;
+  }
+
+  job_ = base::MakeRefCounted<DiskReadJob>(
+      test_file_, uint64_t{file_size_mb_} * 1024 * 1024, options_);
+  status_ = mojo_ipc::DiagnosticRoutineStatusEnum::kRunning;
+  status_message_ = kDiskReadRoutineRunningMessage;
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE, {base::MayBlock()},
+      base::BindOnce(&DiskReadJob::Run, job_),
+      base::BindOnce(&DiskReadRoutine::DetermineRoutineResult,
+                     weak_ptr_factory_.GetWeakPtr()));
+}
+
+// The disk read routine cannot be resumed.
+void DiskReadRoutine::Resume() {}
+
+void DiskReadRoutine::Cancel() {
+  // Only cancel if the routine is running.
+  if (status_ != mojo_ipc::DiagnosticRoutineStatusEnum::kRunning)
+    return;
+
+  // Make sure any other callbacks won't run - they would override the state
+  // and status message.
+  weak_ptr_factory_.InvalidateWeakPtrs();
+
+  job_->Cancel();
+  status_ = mojo_ipc::DiagnosticRoutineStatusEnum::kCancelled;
+  status_message_ = kDiskReadRoutineCancelledMessage;
+}
+
+void DiskReadRoutine::PopulateStatusUpdate(mojo_ipc::RoutineUpdate* response,
+                                           bool include_output) {
+  DCHECK(response);
+
+  // Because the disk read routine is non-interactive, we will never include a
+  // user message.
+  mojo_ipc::NonInteractiveRoutineUpdate update;
+  update.status = status_;
+  update.status_message = status_message_;
+
+  response->routine_update_union->set_noninteractive_update(update.Clone());
+
+  if (include_output && !output_dict_.DictEmpty()) {
+    std::string json;
+    base::JSONWriter::WriteWithOptions(
+        output_dict_, base::JSONWriter::Options::OPTIONS_PRETTY_PRINT, &json);
+    response->output =
+        CreateReadOnlySharedMemoryRegionMojoHandle(base::StringPiece(json));
+  }
 
-  subproc_routine_ptr->RegisterPreStartCallback(std::move(storage_space_check));
-  subproc_routine_ptr->RegisterPostStopCallback(std::move(test_file_deletion));
+  if (status_ == mojo_ipc::DiagnosticRoutineStatusEnum::kPassed ||
+      status_ == mojo_ipc::DiagnosticRoutineStatusEnum::kFailed) {
+    response->progress_percent = 100;
+    return;
+  }
 
-  return std::move(subproc_routine_ptr);
+  if (!job_) {
+    // The routine has not started.
+    response->progress_percent = 0;
+    return;
+  }
+
+  // Cap the progress at 99 until the result is determined.
+  response->progress_percent =
+      std::min<uint32_t>(99, job_->GetProgressPercent());
+}
+
+mojo_ipc::DiagnosticRoutineStatusEnum DiskReadRoutine::GetStatus() {
+  return status_;
+}
+
+void DiskReadRoutine::DetermineRoutineResult(
+    std::optional<DiskReadResult> result) {
+  if (!result.has_value()) {
+    status_ = mojo_ipc::DiagnosticRoutineStatusEnum::kError;
+    status_message_ = kDiskReadRoutineErrorMessage;
+    return;
+  }
+
+  const double seconds = result->elapsed.InSecondsF();
+  base::Value latency_dict(base::Value::Type::DICTIONARY);
+  latency_dict.SetIntKey("p50", result->latency_p50.InMicroseconds());
+  latency_dict.SetIntKey("p90", result->latency_p90.InMicroseconds());
+  latency_dict.SetIntKey("p99", result->latency_p99.InMicroseconds());
+  latency_dict.SetIntKey("max", result->latency_max.InMicroseconds());
+
+  base::Value result_dict(base::Value::Type::DICTIONARY);
+  result_dict.SetStringKey("ioInterface", result->io_interface);
+  result_dict.SetBoolKey("directIo", job_->direct_io());
+  result_dict.SetIntKey("queueDepth", result->queue_depth);
+  result_dict.SetIntKey("blockSizeBytes", options_.block_size);
+  result_dict.SetIntKey("reads", static_cast<int>(result->reads));
+  result_dict.SetDoubleKey("iops", seconds > 0 ? result->reads / seconds : 0);
+  result_dict.SetDoubleKey(
+      "bandwidthMiBPerSecond",
+      seconds > 0 ? result->bytes_read / seconds / (1024 * 1024) : 0);
+  result_dict.SetKey("latencyMicroseconds", std::move(latency_dict));
+  result_dict.SetIntKey("readErrors", static_cast<int>(result->read_errors));
+  result_dict.SetIntKey("dataErrors", static_cast<int>(result->data_errors));
+  output_dict_.SetKey("resultDetails", std::move(result_dict));
+
+  if (result->read_errors || result->data_errors) {
+    status_ = mojo_ipc::DiagnosticRoutineStatusEnum::kFailed;
+    status_message_ = kDiskReadRoutineFailedMessage;
+    return;
+  }
+  status_ = mojo_ipc::DiagnosticRoutineStatusEnum::kPassed;
+  status_message_ = kDiskReadRoutineSucceededMessage;
+}
+
+std::unique_ptr<DiagnosticRoutine> CreateDiskReadRoutine(
+    mojo_ipc::DiskReadRoutineTypeEnum type,
+    base::TimeDelta exec_duration,
+    uint32_t file_size_mb) {
+  return std::make_unique<DiskReadRoutine>(type, exec_duration, file_size_mb,
+                                           base::FilePath(kTmpPath));
 }
 
 }  // namespace diagnostics
@@ -7,15 +7,86 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
 
+#include <base/files/file_path.h>
+#include <base/memory/scoped_refptr.h>
+#include <base/memory/weak_ptr.h>
 #include <base/time/time.h>
-#include <brillo/process/process.h>
+#include <base/values.h>
 
-#include "diagnostics/cros_healthd/routines/subproc_routine.h"
+#include "diagnostics/cros_healthd/routines/diag_routine.h"
+#include "diagnostics/cros_healthd/routines/disk_read/disk_reader.h"
 #include "diagnostics/mojom/public/cros_healthd_diagnostics.mojom.h"
 
 namespace diagnostics {
 
+// Status messages the disk read routine can report.
+inline constexpr char kDiskReadRoutineSucceededMessage[] =
+    "Disk read routine passed.";
+inline constexpr char kDiskReadRoutineRunningMessage[] =
+    "Disk read routine running.";
+inline constexpr char kDiskReadRoutineCancelledMessage[] =
+    "Disk read routine cancelled.";
+inline constexpr char kDiskReadRoutineInsufficientSpaceMessage[] =
+    "Insufficient storage space for the test file.";
+inline constexpr char kDiskReadRoutineErrorMessage[] =
+    "Failed to write or read the test file.";
+inline constexpr char kDiskReadRoutineFailedMessage[] =
+    "Errors reading the test file.";
+
+class DiskReadJob;
+
+// The disk read routine writes a test file and reads it back, sequentially or
+// randomly, for a given duration. It verifies the data read and reports the
+// IOPS, bandwidth and latency percentiles of the reads.
+class DiskReadRoutine final : public DiagnosticRoutine {
+ public:
+  // The test file is written in |test_dir|.
+  DiskReadRoutine(chromeos::cros_healthd::mojom::DiskReadRoutineTypeEnum type,
+                  base::TimeDelta exec_duration,
+                  uint32_t file_size_mb,
+                  const base::FilePath& test_dir);
+  DiskReadRoutine(const DiskReadRoutine&) = delete;
+  DiskReadRoutine& operator=(const DiskReadRoutine&) = delete;
+  ~DiskReadRoutine() override;
+
+  // DiagnosticRoutine overrides:
+  void Start() override;
+  void Resume() override;
+  void Cancel() override;
+  void PopulateStatusUpdate(
+      chromeos::cros_healthd::mojom::RoutineUpdate* response,
+      bool include_output) override;
+  chromeos::cros_healthd::mojom::DiagnosticRoutineStatusEnum GetStatus()
+      override;
+
+ private:
+  // Determines whether or not the routine succeeded from |result|, and
+  // reports its details in |output_dict_|.
+  void DetermineRoutineResult(std::optional<DiskReadResult> result);
+
+  const base::FilePath test_file_;
+  const uint32_t file_size_mb_;
+  DiskReadOptions options_;
+
+  // Status of the routine, reported by GetStatus() or routine updates.
+  chromeos::cros_healthd::mojom::DiagnosticRoutineStatusEnum status_;
+  // Details of the routine's status, reported in all status updates.
+  std::string status_message_;
+  // Details about the routine's execution. Reported in status updates when
+  // requested.
+  base::Value output_dict_{base::Value::Type::DICTIONARY};
+
+  // Writes and reads the test file in the background while the routine is
+  // running.
+  scoped_refptr<DiskReadJob> job_;
+
+  // Must be the last class member.
+  base::WeakPtrFactory<DiskReadRoutine> weak_ptr_factory_{this};
+};
+
 std::unique_ptr<DiagnosticRoutine> CreateDiskReadRoutine(
     chromeos::cros_healthd::mojom::DiskReadRoutineTypeEnum type,
     base::TimeDelta exec_duration,
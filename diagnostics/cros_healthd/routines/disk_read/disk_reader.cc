@@ -0,0 +1,203 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "diagnostics/cros_healthd/routines/disk_read/disk_reader.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <base/files/file.h>
+#include <base/logging.h>
+#include <base/memory/aligned_memory.h>
+#include <base/rand_util.h>
+
+#include "diagnostics/cros_healthd/routines/disk_read/read_queue.h"
+
+namespace diagnostics {
+
+namespace {
+
+// Size of the writes of the test file.
+constexpr size_t kWriteChunkSize = 1024 * 1024;
+
+// At most this many latencies are kept to compute the percentiles, about
+// 16 MiB.
+constexpr size_t kMaxLatencySamples = 4 * 1024 * 1024;
+
+constexpr size_t kWordsPerSector = kDiskReadSectorSize / sizeof(uint64_t);
+
+// Returns the word filling the sector at |offset| in the test file.
+uint64_t SectorPattern(uint64_t offset) {
+  return (offset / kDiskReadSectorSize) * 0x9E3779B97F4A7C15ull ^
+         0x4449534B52454144ull;
+}
+
+void FillSectors(uint64_t* words, size_t size, uint64_t offset) {
+  for (size_t sector = 0; sector < size / kDiskReadSectorSize; ++sector) {
+    const uint64_t pattern =
+        SectorPattern(offset + sector * kDiskReadSectorSize);
+    std::fill_n(words + sector * kWordsPerSector, kWordsPerSector, pattern);
+  }
+}
+
+// Returns true if |size| bytes read at |offset| hold the test file pattern.
+bool VerifySectors(const uint64_t* words, size_t size, uint64_t offset) {
+  uint64_t diff = 0;
+  for (size_t sector = 0; sector < size / kDiskReadSectorSize; ++sector) {
+    const uint64_t pattern =
+        SectorPattern(offset + sector * kDiskReadSectorSize);
+    const uint64_t* sector_words = words + sector * kWordsPerSector;
+    for (size_t i = 0; i < kWordsPerSector; ++i)
+      diff |= sector_words[i] ^ pattern;
+  }
+  return diff == 0;
+}
+
+base::TimeDelta Percentile(std::vector<int64_t>* latencies_us,
+                           double percentile) {
+  if (latencies_us->empty())
+    return base::TimeDelta();
+  auto nth = latencies_us->begin() +
+             static_cast<size_t>(percentile * (latencies_us->size() - 1));
+  std::nth_element(latencies_us->begin(), nth, latencies_us->end());
+  return base::Microseconds(*nth);
+}
+
+}  // namespace
+
+bool WriteDiskReadTestFile(const base::FilePath& path,
+                           uint64_t size,
+                           std::atomic<uint64_t>* written_bytes,
+                           const std::atomic<bool>* cancelled) {
+  base::File file(path, base::File::FLAG_CREATE_ALWAYS |
+                            base::File::FLAG_WRITE);
+  if (!file.IsValid()) {
+    LOG(ERROR) << "Failed to create " << path.value() << ": "
+               << base::File::ErrorToString(file.error_details());
+    return false;
+  }
+
+  size -= size % kDiskReadSectorSize;
+  std::vector<uint64_t> chunk(kWriteChunkSize / sizeof(uint64_t));
+  for (uint64_t offset = 0; offset < size; offset += kWriteChunkSize) {
+    if (cancelled->load())
+      return false;
+    const size_t length = std::min<uint64_t>(kWriteChunkSize, size - offset);
+    FillSectors(chunk.data(), length, offset);
+    if (file.Write(offset, reinterpret_cast<const char*>(chunk.data()),
+                   length) != static_cast<int>(length)) {
+      PLOG(ERROR) << "Failed to write " << path.value();
+      return false;
+    }
+    written_bytes->fetch_add(length);
+  }
+
+  // The data must be on the disk before it is read back with O_DIRECT.
+  if (!file.Flush()) {
+    PLOG(ERROR) << "Failed to flush " << path.value();
+    return false;
+  }
+  return true;
+}
+
+DiskReader::DiskReader(int fd,
+                       uint64_t file_size,
+                       const DiskReadOptions& options)
+    : fd_(fd), file_size_(file_size), options_(options) {}
+
+DiskReader::~DiskReader() = default;
+
+std::optional<DiskReadResult> DiskReader::Run(
+    const std::atomic<bool>* cancelled) {
+  const size_t block_size = options_.block_size;
+  const uint64_t num_blocks = file_size_ / block_size;
+  if (block_size == 0 || block_size % kDiskReadSectorSize || num_blocks == 0) {
+    LOG(ERROR) << "Invalid block size " << block_size << " for a file of "
+               << file_size_ << " bytes";
+    return std::nullopt;
+  }
+
+  uint32_t queue_depth = std::max<uint32_t>(options_.queue_depth, 1);
+  // Declared before |queue| so that the buffers outlive the reads in flight.
+  std::unique_ptr<char, base::AlignedFreeDeleter> buffers(static_cast<char*>(
+      base::AlignedAlloc(queue_depth * block_size, kDiskReadSectorSize)));
+  std::unique_ptr<ReadQueue> queue = CreateIoUringReadQueue(fd_, queue_depth);
+  if (!queue) {
+    // pread() completes a single read at a time.
+    queue = CreatePreadReadQueue(fd_);
+    queue_depth = 1;
+  }
+
+  DiskReadResult result;
+  result.io_interface = queue->GetName();
+  result.queue_depth = queue_depth;
+
+  std::vector<uint64_t> offsets(queue_depth);
+  std::vector<base::TimeTicks> submit_ticks(queue_depth);
+  uint64_t next_block = 0;
+  auto submit = [&](uint32_t tag) {
+    const uint64_t block = options_.random ? base::RandGenerator(num_blocks)
+                                           : next_block++ % num_blocks;
+    offsets[tag] = block * block_size;
+    submit_ticks[tag] = base::TimeTicks::Now();
+    return queue->Submit(tag, buffers.get() + tag * block_size, block_size,
+                         offsets[tag]);
+  };
+
+  const base::TimeTicks start_ticks = base::TimeTicks::Now();
+  const base::TimeTicks end_ticks = start_ticks + options_.duration;
+  uint32_t in_flight = 0;
+  for (uint32_t tag = 0; tag < queue_depth; ++tag) {
+    if (!submit(tag))
+      return std::nullopt;
+    in_flight++;
+  }
+
+  std::vector<int64_t> latencies_us;
+  std::vector<ReadQueue::Completion> completions;
+  while (in_flight > 0) {
+    completions.clear();
+    if (!queue->Wait(&completions))
+      return std::nullopt;
+
+    const base::TimeTicks now = base::TimeTicks::Now();
+    for (const auto& completion : completions) {
+      const uint32_t tag = completion.tag;
+      in_flight--;
+      result.reads++;
+      if (latencies_us.size() < kMaxLatencySamples)
+        latencies_us.push_back((now - submit_ticks[tag]).InMicroseconds());
+
+      if (completion.result != static_cast<int64_t>(block_size)) {
+        LOG(ERROR) << "Read at offset " << offsets[tag] << " returned "
+                   << completion.result;
+        result.read_errors++;
+      } else {
+        result.bytes_read += block_size;
+        if (!VerifySectors(reinterpret_cast<const uint64_t*>(
+                               buffers.get() + tag * block_size),
+                           block_size, offsets[tag])) {
+          LOG(ERROR) << "Unexpected data at offset " << offsets[tag];
+          result.data_errors++;
+        }
+      }
+
+      if (now < end_ticks && !cancelled->load()) {
+        if (!submit(tag))
+          return std::nullopt;
+        in_flight++;
+      }
+    }
+  }
+  result.elapsed = base::TimeTicks::Now() - start_ticks;
+
+  result.latency_p50 = Percentile(&latencies_us, 0.50);
+  result.latency_p90 = Percentile(&latencies_us, 0.90);
+  result.latency_p99 = Percentile(&latencies_us, 0.99);
+  result.latency_max = Percentile(&latencies_us, 1.0);
+  return result;
+}
+
+}  // namespace diagnostics
@@ -0,0 +1,86 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DIAGNOSTICS_CROS_HEALTHD_ROUTINES_DISK_READ_DISK_READER_H_
+#define DIAGNOSTICS_CROS_HEALTHD_ROUTINES_DISK_READ_DISK_READER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <base/files/file_path.h>
+#include <base/time/time.h>
+
+namespace diagnostics {
+
+// Reads are aligned on sectors of this size, which is also the granularity of
+// the pattern of the test file.
+constexpr size_t kDiskReadSectorSize = 4096;
+
+// Writes a test file of |size| bytes, rounded down to whole sectors, at
+// |path|. Every sector holds a pattern derived from its offset, which
+// DiskReader verifies. |written_bytes| is updated as the file is written.
+// Returns false on failure or if |cancelled| is set.
+bool WriteDiskReadTestFile(const base::FilePath& path,
+                           uint64_t size,
+                           std::atomic<uint64_t>* written_bytes,
+                           const std::atomic<bool>* cancelled);
+
+struct DiskReadOptions {
+  // Random or sequential reads.
+  bool random = false;
+  // Size of every read, a multiple of kDiskReadSectorSize.
+  size_t block_size = kDiskReadSectorSize;
+  // Maximum number of reads in flight.
+  uint32_t queue_depth = 1;
+  // No read is started once |duration| has elapsed.
+  base::TimeDelta duration;
+};
+
+struct DiskReadResult {
+  // I/O interface used, see ReadQueue::GetName().
+  std::string io_interface;
+  // Queue depth used, which is 1 if io_uring is not available.
+  uint32_t queue_depth = 0;
+  uint64_t reads = 0;
+  uint64_t bytes_read = 0;
+  // Reads which failed or returned less than a block.
+  uint64_t read_errors = 0;
+  // Blocks not holding the pattern of the test file.
+  uint64_t data_errors = 0;
+  base::TimeDelta elapsed;
+  // Percentiles of the latency of the reads.
+  base::TimeDelta latency_p50;
+  base::TimeDelta latency_p90;
+  base::TimeDelta latency_p99;
+  base::TimeDelta latency_max;
+};
+
+// DiskReader reads a test file written by WriteDiskReadTestFile(), keeping
+// several reads in flight through io_uring when available, and measures their
+// throughput and latency. Open the file with O_DIRECT to bypass the page
+// cache.
+class DiskReader {
+ public:
+  // |fd| is the test file of |file_size| bytes.
+  DiskReader(int fd, uint64_t file_size, const DiskReadOptions& options);
+  DiskReader(const DiskReader&) = delete;
+  DiskReader& operator=(const DiskReader&) = delete;
+  ~DiskReader();
+
+  // Reads until the duration of the options has elapsed or |cancelled| is
+  // set. Returns nullopt if the reads could not be started.
+  std::optional<DiskReadResult> Run(const std::atomic<bool>* cancelled);
+
+ private:
+  const int fd_;
+  const uint64_t file_size_;
+  const DiskReadOptions options_;
+};
+
+}  // namespace diagnostics
+
+#endif  // DIAGNOSTICS_CROS_HEALTHD_ROUTINES_DISK_READ_DISK_READER_H_
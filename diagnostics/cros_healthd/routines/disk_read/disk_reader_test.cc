@@ -0,0 +1,191 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <base/files/file.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/time/time.h>
+#include <gtest/gtest.h>
+
+#include "diagnostics/cros_healthd/routines/disk_read/disk_reader.h"
+#include "diagnostics/cros_healthd/routines/disk_read/read_queue.h"
+
+namespace diagnostics {
+namespace {
+
+constexpr uint64_t kFileSize = 1024 * 1024;
+
+class DiskReaderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    test_file_ = temp_dir_.GetPath().Append("test-file");
+    std::atomic<uint64_t> written_bytes{0};
+    ASSERT_TRUE(WriteDiskReadTestFile(test_file_, kFileSize, &written_bytes,
+                                      &cancelled_));
+    ASSERT_EQ(written_bytes.load(), kFileSize);
+    fd_.reset(
+        HANDLE_EINTR(open(test_file_.value().c_str(), O_RDONLY | O_CLOEXEC)));
+    ASSERT_TRUE(fd_.is_valid());
+  }
+
+  // Reads the whole test file through |queue|, with up to |queue_depth| reads
+  // in flight, and returns the bytes read.
+  std::vector<char> ReadAll(ReadQueue* queue, uint32_t queue_depth) {
+    std::vector<char> data(kFileSize);
+    uint64_t next_offset = 0;
+    uint32_t in_flight = 0;
+    for (uint32_t tag = 0; tag < queue_depth; ++tag) {
+      EXPECT_TRUE(queue->Submit(tag, data.data() + next_offset,
+                                kDiskReadSectorSize, next_offset));
+      next_offset += kDiskReadSectorSize;
+      in_flight++;
+    }
+    std::vector<ReadQueue::Completion> completions;
+    while (in_flight > 0) {
+      completions.clear();
+      if (!queue->Wait(&completions)) {
+        ADD_FAILURE() << "Wait failed";
+        break;
+      }
+      for (const auto& completion : completions) {
+        EXPECT_EQ(completion.result, kDiskReadSectorSize);
+        in_flight--;
+        if (next_offset < kFileSize) {
+          EXPECT_TRUE(queue->Submit(completion.tag, data.data() + next_offset,
+                                    kDiskReadSectorSize, next_offset));
+          next_offset += kDiskReadSectorSize;
+          in_flight++;
+        }
+      }
+    }
+    return data;
+  }
+
+  std::string ReadFile() {
+    std::string content;
+    EXPECT_TRUE(base::ReadFileToString(test_file_, &content));
+    return content;
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath test_file_;
+  base::ScopedFD fd_;
+  std::atomic<bool> cancelled_{false};
+};
+
+// Test that the size of the test file is rounded down to whole sectors.
+TEST_F(DiskReaderTest, WriteTestFileRoundsDown) {
+  const base::FilePath path = temp_dir_.GetPath().Append("other-file");
+  std::atomic<uint64_t> written_bytes{0};
+
+  ASSERT_TRUE(WriteDiskReadTestFile(path, 3 * kDiskReadSectorSize + 1,
+                                    &written_bytes, &cancelled_));
+
+  EXPECT_EQ(written_bytes.load(), 3 * kDiskReadSectorSize);
+  int64_t size;
+  ASSERT_TRUE(base::GetFileSize(path, &size));
+  EXPECT_EQ(size, 3 * kDiskReadSectorSize);
+}
+
+// Test that a cancelled write fails.
+TEST_F(DiskReaderTest, WriteTestFileCancelled) {
+  std::atomic<uint64_t> written_bytes{0};
+  cancelled_.store(true);
+
+  EXPECT_FALSE(WriteDiskReadTestFile(temp_dir_.GetPath().Append("other-file"),
+                                     kFileSize, &written_bytes, &cancelled_));
+  EXPECT_EQ(written_bytes.load(), 0u);
+}
+
+// Test that the pread() queue reads the test file.
+TEST_F(DiskReaderTest, PreadQueue) {
+  auto queue = CreatePreadReadQueue(fd_.get());
+  ASSERT_TRUE(queue);
+
+  EXPECT_EQ(queue->GetName(), "pread");
+  const std::vector<char> data = ReadAll(queue.get(), 4);
+  EXPECT_EQ(std::string(data.begin(), data.end()), ReadFile());
+}
+
+// Test that the io_uring queue reads the test file, if the kernel supports
+// io_uring.
+TEST_F(DiskReaderTest, IoUringQueue) {
+  auto queue = CreateIoUringReadQueue(fd_.get(), 8);
+  if (!queue)
+    GTEST_SKIP() << "io_uring is not available";
+
+  EXPECT_EQ(queue->GetName(), "io_uring");
+  const std::vector<char> data = ReadAll(queue.get(), 8);
+  EXPECT_EQ(std::string(data.begin(), data.end()), ReadFile());
+}
+
+// Test that sequential reads of the test file pass.
+TEST_F(DiskReaderTest, LinearRead) {
+  DiskReadOptions options;
+  options.block_size = 4 * kDiskReadSectorSize;
+  options.queue_depth = 4;
+  options.duration = base::Milliseconds(10);
+
+  const std::optional<DiskReadResult> result =
+      DiskReader(fd_.get(), kFileSize, options).Run(&cancelled_);
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_GT(result->reads, 0u);
+  EXPECT_EQ(result->bytes_read, result->reads * options.block_size);
+  EXPECT_EQ(result->read_errors, 0u);
+  EXPECT_EQ(result->data_errors, 0u);
+  EXPECT_LE(result->latency_p50, result->latency_p99);
+  EXPECT_LE(result->latency_p99, result->latency_max);
+}
+
+// Test that random reads of the test file pass.
+TEST_F(DiskReaderTest, RandomRead) {
+  DiskReadOptions options;
+  options.random = true;
+  options.queue_depth = 16;
+  options.duration = base::Milliseconds(10);
+
+  const std::optional<DiskReadResult> result =
+      DiskReader(fd_.get(), kFileSize, options).Run(&cancelled_);
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_GT(result->reads, 0u);
+  EXPECT_EQ(result->read_errors, 0u);
+  EXPECT_EQ(result->data_errors, 0u);
+}
+
+// Test that a corrupted sector of the test file is detected.
+TEST_F(DiskReaderTest, DataError) {
+  {
+    base::File file(test_file_, base::File::FLAG_OPEN | base::File::FLAG_WRITE);
+    ASSERT_TRUE(file.IsValid());
+    ASSERT_EQ(file.Write(5 * kDiskReadSectorSize + 10, "x", 1), 1);
+  }
+  DiskReadOptions options;
+  // A single read of the whole file.
+  options.block_size = kFileSize;
+  options.duration = base::TimeDelta();
+
+  const std::optional<DiskReadResult> result =
+      DiskReader(fd_.get(), kFileSize, options).Run(&cancelled_);
+
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(result->reads, 1u);
+  EXPECT_EQ(result->read_errors, 0u);
+  EXPECT_EQ(result->data_errors, 1u);
+}
+
+}  // namespace
+}  // namespace diagnostics
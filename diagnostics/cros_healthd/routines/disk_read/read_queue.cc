@@ -0,0 +1,237 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "diagnostics/cros_healthd/routines/disk_read/read_queue.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <utility>
+
+#include <base/files/scoped_file.h>
+#include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
+
+namespace diagnostics {
+
+namespace {
+
+// A mapping of an io_uring ring, unmapped on destruction.
+class RingMapping {
+ public:
+  RingMapping() = default;
+  RingMapping(const RingMapping&) = delete;
+  RingMapping& operator=(const RingMapping&) = delete;
+  ~RingMapping() {
+    if (data_)
+      munmap(data_, size_);
+  }
+
+  bool Map(int ring_fd, size_t size, off_t offset) {
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+    if (data == MAP_FAILED) {
+      PLOG(ERROR) << "Failed to map io_uring ring";
+      return false;
+    }
+    data_ = static_cast<char*>(data);
+    size_ = size;
+    return true;
+  }
+
+  template <typename T>
+  T* At(uint32_t offset) const {
+    return reinterpret_cast<T*>(data_ + offset);
+  }
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// io_uring is driven through its system calls directly, the rings are shared
+// with the kernel and accessed with acquire/release semantics.
+class IoUringReadQueue : public ReadQueue {
+ public:
+  IoUringReadQueue(int fd, uint32_t queue_depth)
+      : fd_(fd), iovecs_(queue_depth) {}
+  IoUringReadQueue(const IoUringReadQueue&) = delete;
+  IoUringReadQueue& operator=(const IoUringReadQueue&) = delete;
+  ~IoUringReadQueue() override = default;
+
+  bool Init() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd_.reset(
+        syscall(__NR_io_uring_setup, static_cast<uint32_t>(iovecs_.size()),
+                &params));
+    if (!ring_fd_.is_valid()) {
+      PLOG(WARNING) << "io_uring is not available";
+      return false;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(__u32);
+    size_t cq_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    // Recent kernels map both rings at once.
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+      sq_size = cq_size = std::max(sq_size, cq_size);
+
+    if (!sq_ring_.Map(ring_fd_.get(), sq_size, IORING_OFF_SQ_RING))
+      return false;
+    const RingMapping* cq_ring = &sq_ring_;
+    if (!single_mmap) {
+      if (!cq_ring_.Map(ring_fd_.get(), cq_size, IORING_OFF_CQ_RING))
+        return false;
+      cq_ring = &cq_ring_;
+    }
+    if (!sqes_.Map(ring_fd_.get(), params.sq_entries * sizeof(io_uring_sqe),
+                   IORING_OFF_SQES)) {
+      return false;
+    }
+
+    sq_tail_ = sq_ring_.At<__u32>(params.sq_off.tail);
+    sq_mask_ = *sq_ring_.At<__u32>(params.sq_off.ring_mask);
+    sq_array_ = sq_ring_.At<__u32>(params.sq_off.array);
+    cq_head_ = cq_ring->At<__u32>(params.cq_off.head);
+    cq_tail_ = cq_ring->At<__u32>(params.cq_off.tail);
+    cq_mask_ = *cq_ring->At<__u32>(params.cq_off.ring_mask);
+    cqes_ = cq_ring->At<io_uring_cqe>(params.cq_off.cqes);
+    return true;
+  }
+
+  // ReadQueue overrides:
+  std::string GetName() const override { return "io_uring"; }
+
+  bool Submit(uint32_t tag,
+              void* buffer,
+              size_t length,
+              off_t offset) override {
+    if (tag >= iovecs_.size())
+      return false;
+    // Vectored reads are used as they are supported by all io_uring kernels.
+    // The iovec must stay valid until the read completes on old kernels.
+    iovecs_[tag] = {buffer, length};
+
+    // This is the only thread producing submissions.
+    const __u32 tail = *sq_tail_;
+    const __u32 index = tail & sq_mask_;
+    io_uring_sqe* sqe = sqes_.At<io_uring_sqe>(index * sizeof(io_uring_sqe));
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd_;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<__u64>(&iovecs_[tag]);
+    sqe->len = 1;
+    sqe->user_data = tag;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    to_submit_++;
+    return true;
+  }
+
+  bool Wait(std::vector<Completion>* completions) override {
+    const int submitted =
+        HANDLE_EINTR(syscall(__NR_io_uring_enter, ring_fd_.get(), to_submit_,
+                             1, IORING_ENTER_GETEVENTS, nullptr, 0));
+    if (submitted < 0) {
+      PLOG(ERROR) << "io_uring_enter failed";
+      return false;
+    }
+    to_submit_ -= submitted;
+
+    __u32 head = *cq_head_;
+    const __u32 tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+      completions->push_back({static_cast<uint32_t>(cqe.user_data), cqe.res});
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return true;
+  }
+
+ private:
+  const int fd_;
+  std::vector<iovec> iovecs_;
+  uint32_t to_submit_ = 0;
+
+  base::ScopedFD ring_fd_;
+  RingMapping sq_ring_;
+  RingMapping cq_ring_;
+  RingMapping sqes_;
+  __u32* sq_tail_ = nullptr;
+  __u32 sq_mask_ = 0;
+  __u32* sq_array_ = nullptr;
+  __u32* cq_head_ = nullptr;
+  __u32* cq_tail_ = nullptr;
+  __u32 cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+class PreadReadQueue : public ReadQueue {
+ public:
+  explicit PreadReadQueue(int fd) : fd_(fd) {}
+  PreadReadQueue(const PreadReadQueue&) = delete;
+  PreadReadQueue& operator=(const PreadReadQueue&) = delete;
+  ~PreadReadQueue() override = default;
+
+  // ReadQueue overrides:
+  std::string GetName() const override { return "pread"; }
+
+  bool Submit(uint32_t tag,
+              void* buffer,
+              size_t length,
+              off_t offset) override {
+    pending_.push_back({tag, buffer, length, offset});
+    return true;
+  }
+
+  bool Wait(std::vector<Completion>* completions) override {
+    if (pending_.empty())
+      return false;
+    // Reads are done one at a time, the caller should use a queue depth of 1
+    // to measure their latency.
+    const Read read = pending_.front();
+    pending_.pop_front();
+    const ssize_t result =
+        HANDLE_EINTR(pread(fd_, read.buffer, read.length, read.offset));
+    completions->push_back({read.tag, result < 0 ? -errno : result});
+    return true;
+  }
+
+ private:
+  struct Read {
+    uint32_t tag;
+    void* buffer;
+    size_t length;
+    off_t offset;
+  };
+
+  const int fd_;
+  std::deque<Read> pending_;
+};
+
+}  // namespace
+
+std::unique_ptr<ReadQueue> CreateIoUringReadQueue(int fd,
+                                                  uint32_t queue_depth) {
+  auto queue = std::make_unique<IoUringReadQueue>(fd, queue_depth);
+  if (!queue->Init())
+    return nullptr;
+  return queue;
+}
+
+std::unique_ptr<ReadQueue> CreatePreadReadQueue(int fd) {
+  return std::make_unique<PreadReadQueue>(fd);
+}
+
+}  // namespace diagnostics
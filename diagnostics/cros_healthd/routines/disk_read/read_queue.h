@@ -0,0 +1,56 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DIAGNOSTICS_CROS_HEALTHD_ROUTINES_DISK_READ_READ_QUEUE_H_
+#define DIAGNOSTICS_CROS_HEALTHD_ROUTINES_DISK_READ_READ_QUEUE_H_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace diagnostics {
+
+// ReadQueue submits reads of a file and reaps their completions, keeping up to
+// |queue_depth| reads in flight. Reads are identified by a tag smaller than
+// the queue depth, which the caller must not reuse until the read completed.
+class ReadQueue {
+ public:
+  struct Completion {
+    uint32_t tag;
+    // Number of bytes read, or a negative errno.
+    int64_t result;
+  };
+
+  virtual ~ReadQueue() = default;
+
+  // Returns the name of the I/O interface used, for reports.
+  virtual std::string GetName() const = 0;
+
+  // Queues a read of |length| bytes at |offset| into |buffer|.
+  virtual bool Submit(uint32_t tag,
+                      void* buffer,
+                      size_t length,
+                      off_t offset) = 0;
+
+  // Sends the queued reads and waits for at least one completion, which are
+  // appended to |completions|. Returns false on failure.
+  virtual bool Wait(std::vector<Completion>* completions) = 0;
+};
+
+// Returns a queue reading |fd| through io_uring, or nullptr if io_uring is not
+// available.
+std::unique_ptr<ReadQueue> CreateIoUringReadQueue(int fd,
+                                                  uint32_t queue_depth);
+
+// Returns a queue reading |fd| with pread(). Reads are done one at a time when
+// waiting for completions.
+std::unique_ptr<ReadQueue> CreatePreadReadQueue(int fd);
+
+}  // namespace diagnostics
+
+#endif  // DIAGNOSTICS_CROS_HEALTHD_ROUTINES_DISK_READ_READ_QUEUE_H_
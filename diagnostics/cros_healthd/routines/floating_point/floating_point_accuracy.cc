@@ -26,11 +26,14 @@ constexpr char kFloatingPointAccuracyTestExePath[] =
 std::unique_ptr<DiagnosticRoutine> CreateFloatingPointAccuracyRoutine(
     const std::optional<base::TimeDelta>& exec_duration) {
   base::TimeDelta duration = exec_duration.value_or(kDefaultCpuStressRuntime);
-  return std::make_unique<SubprocRoutine>(
+  auto routine = std::make_unique<SubprocRoutine>(
       base::CommandLine(std::vector<std::string>{
           kFloatingPointAccuracyTestExePath,
           "--duration=" + std::to_string(duration.InSeconds())}),
       duration);
+  // The executable reports the results of every CPU core.
+  routine->EnableProcessOutput();
+  return routine;
 }
 
 }  // namespace diagnostics
@@ -5,24 +5,19 @@
 #include "diagnostics/cros_healthd/routines/memory/memory.h"
 
 #include <algorithm>
-#include <cctype>
+#include <atomic>
 #include <cstdint>
-#include <cstdlib>
 #include <string>
 #include <utility>
-#include <vector>
 
 #include <base/bind.h>
 #include <base/check.h>
 #include <base/check_op.h>
 #include <base/json/json_writer.h>
 #include <base/logging.h>
-#include <base/strings/string_number_conversions.h>
-#include <base/strings/string_split.h>
-#include <base/strings/string_util.h>
-#include <base/strings/stringprintf.h>
 #include <base/system/sys_info.h>
-#include <re2/re2.h>
+#include <base/task/task_traits.h>
+#include <base/task/thread_pool.h>
 
 #include "diagnostics/common/mojo_utils.h"
 #include "diagnostics/cros_healthd/routines/memory/memory_constants.h"
@@ -31,81 +26,67 @@ namespace diagnostics {
 
 namespace {
 
-// Approximate number of microseconds per byte of memory tested. Derived from
-// testing on a nami device.
-constexpr double kMicrosecondsPerByte = 0.20;
-
-// Regex to parse out the version of memtester used.
-constexpr char kMemtesterVersionRegex[] = R"(memtester version (.+))";
-// Regex to parse out the amount of memory tested.
-constexpr char kMemtesterBytesTestedRegex[] = R"(got  \d+MB \((\d+) bytes\))";
-// Regex to parse out a particular subtest and its result.
-constexpr char kMemtesterSubtestRegex[] = R"((.+)\s*: (.+))";
-// Failure messages in subtests will begin with this pattern.
-constexpr char kMemtesterSubtestFailurePattern[] = "FAILURE:";
-
-// Takes a |raw_string|, potentially with backspace characters ('\b'), and
-// processes the backspaces in the string like the console would. For example,
-// if |raw_string| was "Hello, Worlb\bd\n", this function would return
-// "Hello, World\n". This function operates a single character at a time, and
-// should only be used for small inputs.
-std::string ProcessBackspaces(const std::string& raw_string) {
-  std::string processed;
-  for (const char& c : raw_string) {
-    if (c == '\b') {
-      // std::string::pop_back() causes undefined behavior if the string is
-      // empty. We never expect to call this method on an empty string - that
-      // would indicate |raw_string| was invalid.
-      DCHECK(!processed.empty());
-      processed.pop_back();
-    } else {
-      processed.push_back(c);
-    }
-  }
+// Set while a MemoryTester runs. Only one test can run at a time, because a
+// test uses almost the entirety of the device's memory, and a second test
+// wouldn't have any memory to test.
+std::atomic<bool> g_tester_running{false};
 
-  return processed;
+MemoryTester::Result RunTester(scoped_refptr<MemoryTester> tester) {
+  MemoryTester::Result result = tester->Run();
+  g_tester_running.store(false);
+  return result;
 }
 
 }  // namespace
 
-MemoryRoutine::MemoryRoutine(Context* context,
-                             const base::TickClock* tick_clock)
-    : context_(context), status_(mojom::DiagnosticRoutineStatusEnum::kReady) {
-  DCHECK(context_);
+MemoryRoutine::MemoryRoutine(std::optional<size_t> test_size)
+    : test_size_(test_size),
+      status_(mojom::DiagnosticRoutineStatusEnum::kReady) {}
 
-  if (tick_clock) {
-    tick_clock_ = tick_clock;
-  } else {
-    default_tick_clock_ = std::make_unique<base::DefaultTickClock>();
-    tick_clock_ = default_tick_clock_.get();
-  }
-  DCHECK(tick_clock_);
+MemoryRoutine::~MemoryRoutine() {
+  // Stop the background test early, it would not be reported anyway.
+  if (status_ == mojom::DiagnosticRoutineStatusEnum::kRunning)
+    tester_->Cancel();
 }
 
-MemoryRoutine::~MemoryRoutine() = default;
-
 void MemoryRoutine::Start() {
   DCHECK_EQ(status_, mojom::DiagnosticRoutineStatusEnum::kReady);
 
-  // Estimate the routine's duration based on the amount of free memory.
-  expected_duration_us_ =
-      base::SysInfo::AmountOfAvailablePhysicalMemory() * kMicrosecondsPerByte;
-  start_ticks_ = tick_clock_->NowTicks();
-
-  // Ealry check and return if system doesn't have enough memory remains.
-  // Get AvailablePhysicalMemory in MiB.
+  // Leave kMemoryRoutineReservedSizeMiB to the operating system to avoid out
+  // of memory errors.
   int64_t available_mem = base::SysInfo::AmountOfAvailablePhysicalMemory();
-  available_mem /= (1024 * 1024);
-  if (available_mem <= kMemoryRoutineReservedSizeMiB) {
+  available_mem -= int64_t{kMemoryRoutineReservedSizeMiB} * 1024 * 1024;
+  if (!test_size_.has_value() && available_mem <= 0) {
     status_ = mojom::DiagnosticRoutineStatusEnum::kFailedToStart;
-    status_message_ = kMemoryRoutineAllocatingLockingInvokingFailureMessage;
+    status_message_ = kMemoryRoutineAllocatingFailureMessage;
     return;
   }
 
+  if (g_tester_running.exchange(true)) {
+    status_ = mojom::DiagnosticRoutineStatusEnum::kFailedToStart;
+    status_message_ = kMemoryRoutineAlreadyRunningMessage;
+    return;
+  }
+
+  // The tested memory is locked so that it stays resident, which is limited
+  // by RLIMIT_MEMLOCK unless cros_healthd has CAP_IPC_LOCK. An overridden test
+  // size is tested without locking.
+  size_t test_size;
+  if (test_size_.has_value()) {
+    test_size = test_size_.value();
+  } else {
+    test_size = std::min<uint64_t>(available_mem,
+                                   MemoryTester::GetLockableSize());
+  }
+  tester_ = base::MakeRefCounted<MemoryTester>(
+      test_size, base::SysInfo::NumberOfProcessors(),
+      /*lock_memory=*/!test_size_.has_value());
   status_ = mojom::DiagnosticRoutineStatusEnum::kRunning;
   status_message_ = kMemoryRoutineRunningMessage;
-  context_->executor()->RunMemtester(base::BindOnce(
-      &MemoryRoutine::DetermineRoutineResult, weak_ptr_factory_.GetWeakPtr()));
+  base::ThreadPool::PostTaskAndReplyWithResult(
+      FROM_HERE, {base::MayBlock()}, base::BindOnce(&RunTester, tester_),
+      base::BindOnce(&MemoryRoutine::DetermineRoutineResult,
+                     weak_ptr_factory_.GetWeakPtr()));
 }
 
 // The memory routine cannot be resumed.
@@ -120,7 +101,7 @@ void MemoryRoutine::Cancel() {
   // and status message.
   weak_ptr_factory_.InvalidateWeakPtrs();
 
-  context_->executor()->KillMemtester();
+  tester_->Cancel();
   status_ = mojom::DiagnosticRoutineStatusEnum::kCancelled;
   status_message_ = kMemoryRoutineCancelledMessage;
 }
@@ -145,107 +126,85 @@ void MemoryRoutine::PopulateStatusUpdate(mojom::RoutineUpdate* response,
         CreateReadOnlySharedMemoryRegionMojoHandle(base::StringPiece(json));
   }
 
-  // If the routine has finished, set the progress percent to 100 and don't take
-  // the amount of time ran into account.
+  // If the routine has finished, set the progress percent to 100.
   if (status_ == mojom::DiagnosticRoutineStatusEnum::kPassed ||
       status_ == mojom::DiagnosticRoutineStatusEnum::kFailed) {
     response->progress_percent = 100;
     return;
   }
 
-  if (status_ == mojom::DiagnosticRoutineStatusEnum::kReady) {
+  if (!tester_) {
     // The routine has not started.
     response->progress_percent = 0;
     return;
   }
 
-  // Cap the progress at 99, in case it's taking longer than the estimated
-  // time.
-  base::TimeDelta elapsed_time = tick_clock_->NowTicks() - start_ticks_;
+  // Cap the progress at 99 until the result is determined.
   response->progress_percent =
-      std::min<int64_t>(99, static_cast<int64_t>(elapsed_time.InMicroseconds() /
-                                                 expected_duration_us_ * 100));
+      std::min<uint32_t>(99, tester_->GetProgressPercent());
 }
 
 mojom::DiagnosticRoutineStatusEnum MemoryRoutine::GetStatus() {
   return status_;
 }
 
-void MemoryRoutine::DetermineRoutineResult(
-    mojom::ExecutedProcessResultPtr process) {
-  ParseMemtesterOutput(process->out);
+void MemoryRoutine::DetermineRoutineResult(const MemoryTester::Result& result) {
+  if (!result.allocated) {
+    status_ = mojom::DiagnosticRoutineStatusEnum::kError;
+    status_message_ = kMemoryRoutineAllocatingFailureMessage;
+    return;
+  }
+  if (result.lock_failed) {
+    status_ = mojom::DiagnosticRoutineStatusEnum::kError;
+    status_message_ = kMemoryRoutineLockingFailureMessage;
+    return;
+  }
+
+  bool stuck_address_failed = false;
+  bool other_test_failed = false;
+  // Holds the results of all subtests.
+  base::Value subtest_dict(base::Value::Type::DICTIONARY);
+  // Holds the memory bandwidth measured by all subtests, in MiB/s.
+  base::Value bandwidth_dict(base::Value::Type::DICTIONARY);
+  for (const auto& subtest : result.subtests) {
+    subtest_dict.SetStringKey(subtest.name, subtest.errors ? "failed" : "ok");
+
+    const double seconds = subtest.elapsed.InSecondsF();
+    if (seconds > 0) {
+      bandwidth_dict.SetDoubleKey(
+          subtest.name, subtest.bytes_processed / seconds / (1024 * 1024));
+    }
+
+    if (!subtest.errors)
+      continue;
+    if (subtest.name == MemoryTester::kStuckAddressSubtest)
+      stuck_address_failed = true;
+    else
+      other_test_failed = true;
+  }
 
-  int32_t ret = process->return_code;
-  if (ret == EXIT_SUCCESS) {
+  base::Value result_dict(base::Value::Type::DICTIONARY);
+  // A double, as an int overflows above 2 GiB, while a double holds sizes up
+  // to 8 PiB exactly.
+  result_dict.SetDoubleKey("bytesTested", result.bytes_tested);
+  result_dict.SetKey("subtests", std::move(subtest_dict));
+  result_dict.SetKey("bandwidthMiBPerSecond", std::move(bandwidth_dict));
+  output_dict_.SetKey("resultDetails", std::move(result_dict));
+
+  if (!stuck_address_failed && !other_test_failed) {
     status_message_ = kMemoryRoutineSucceededMessage;
     status_ = mojom::DiagnosticRoutineStatusEnum::kPassed;
     return;
   }
 
-  auto status = mojom::DiagnosticRoutineStatusEnum::kFailed;
   std::string status_message;
-  if (ret & MemtesterErrorCodes::kAllocatingLockingInvokingError) {
-    // Return the error message from executor if applicable
-    status_message +=
-        !process->err.empty()
-            ? process->err
-            : kMemoryRoutineAllocatingLockingInvokingFailureMessage;
-    status = mojom::DiagnosticRoutineStatusEnum::kError;
-  }
-
-  if (ret & MemtesterErrorCodes::kStuckAddressTestError)
+  if (stuck_address_failed)
     status_message += kMemoryRoutineStuckAddressTestFailureMessage;
-
-  if (ret & MemtesterErrorCodes::kOtherTestError)
+  if (other_test_failed)
     status_message += kMemoryRoutineOtherTestFailureMessage;
 
   status_message_ = std::move(status_message);
-  status_ = status;
-}
-
-void MemoryRoutine::ParseMemtesterOutput(const std::string& raw_output) {
-  std::vector<std::string> lines = base::SplitString(
-      raw_output, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
-
-  // The following strings are used to hold values matched from regexes.
-  std::string version;
-  std::string bytes_tested_str;
-  std::string subtest_name;
-  std::string subtest_result;
-  // Holds the integer value for the number of bytes tested, converted from
-  // |bytes_tested_str|.
-  uint64_t bytes_tested;
-  // Holds the results of all subtests.
-  base::Value subtest_dict(base::Value::Type::DICTIONARY);
-  // Holds all the parsed output from memtester.
-  base::Value result_dict(base::Value::Type::DICTIONARY);
-  for (int index = 0; index < lines.size(); index++) {
-    std::string line = ProcessBackspaces(lines[index]);
-
-    if (RE2::FullMatch(line, kMemtesterVersionRegex, &version)) {
-      result_dict.SetStringKey("memtesterVersion", version);
-    } else if (RE2::PartialMatch(line, kMemtesterBytesTestedRegex,
-                                 &bytes_tested_str) &&
-               base::StringToUint64(bytes_tested_str, &bytes_tested)) {
-      result_dict.SetIntKey("bytesTested", static_cast<int>(bytes_tested));
-    } else if (RE2::FullMatch(line, kMemtesterSubtestRegex, &subtest_name,
-                              &subtest_result) &&
-               !base::StartsWith(line, kMemtesterSubtestFailurePattern,
-                                 base::CompareCase::SENSITIVE)) {
-      // Process |subtest_name| so it's formatted like a JSON key - remove
-      // spaces and make sure the first letter is lowercase. For example, Stuck
-      // Address should become stuckAddress.
-      base::RemoveChars(subtest_name, " ", &subtest_name);
-      subtest_name[0] = std::tolower(subtest_name[0]);
-
-      subtest_dict.SetStringKey(subtest_name, subtest_result);
-    }
-  }
-
-  if (!subtest_dict.DictEmpty())
-    result_dict.SetKey("subtests", std::move(subtest_dict));
-  if (!result_dict.DictEmpty())
-    output_dict_.SetKey("resultDetails", std::move(result_dict));
+  status_ = mojom::DiagnosticRoutineStatusEnum::kFailed;
 }
 
 }  // namespace diagnostics
@@ -5,30 +5,31 @@
 #ifndef DIAGNOSTICS_CROS_HEALTHD_ROUTINES_MEMORY_MEMORY_H_
 #define DIAGNOSTICS_CROS_HEALTHD_ROUTINES_MEMORY_MEMORY_H_
 
-#include <memory>
+#include <cstddef>
+#include <optional>
 #include <string>
 
+#include <base/memory/scoped_refptr.h>
 #include <base/memory/weak_ptr.h>
-#include <base/time/default_tick_clock.h>
-#include <base/time/tick_clock.h>
-#include <base/time/time.h>
 #include <base/values.h>
 
-#include "diagnostics/cros_healthd/executor/mojom/executor.mojom.h"
 #include "diagnostics/cros_healthd/routines/diag_routine.h"
-#include "diagnostics/cros_healthd/system/context.h"
+#include "diagnostics/cros_healthd/routines/memory/memory_tester.h"
 #include "diagnostics/mojom/public/cros_healthd_diagnostics.mojom.h"
 
 namespace diagnostics {
 
 namespace mojom = chromeos::cros_healthd::mojom;
 
-// The memory routine checks that the device's memory is working correctly.
+// The memory routine checks that the device's memory is working correctly. It
+// tests the available memory, except kMemoryRoutineReservedSizeMiB and up to
+// the amount cros_healthd can lock, with a MemoryTester running in the
+// background.
 class MemoryRoutine final : public DiagnosticRoutine {
  public:
-  // Override |tick_clock| for testing only.
-  explicit MemoryRoutine(Context* context,
-                         const base::TickClock* tick_clock = nullptr);
+  // Override the amount of memory tested, in bytes, for testing only. The
+  // overridden amount is not locked in memory.
+  explicit MemoryRoutine(std::optional<size_t> test_size = std::nullopt);
   MemoryRoutine(const MemoryRoutine&) = delete;
   MemoryRoutine& operator=(const MemoryRoutine&) = delete;
   ~MemoryRoutine() override;
@@ -44,15 +45,12 @@ class MemoryRoutine final : public DiagnosticRoutine {
       override;
 
  private:
-  // Takes the memtester result code from |process| and parses it to determine
-  // whether or not the routine succeeded.
-  void DetermineRoutineResult(mojom::ExecutedProcessResultPtr process);
+  // Determines whether or not the routine succeeded from |result|, and
+  // reports its details in |output_dict_|.
+  void DetermineRoutineResult(const MemoryTester::Result& result);
 
-  // Takes raw output from memtester and parses it into |output_dict_|.
-  void ParseMemtesterOutput(const std::string& raw_output);
-
-  // Unowned. Should outlive this instance.
-  Context* const context_ = nullptr;
+  // Amount of memory to test, in bytes, if overridden.
+  const std::optional<size_t> test_size_;
 
   // Status of the routine, reported by GetStatus() or routine updates.
   chromeos::cros_healthd::mojom::DiagnosticRoutineStatusEnum status_;
@@ -62,16 +60,10 @@ class MemoryRoutine final : public DiagnosticRoutine {
   // requested.
   base::Value output_dict_{base::Value::Type::DICTIONARY};
 
-  // Expected duration of the routine, in microseconds.
-  double expected_duration_us_;
-  // When the routine started. Used to calculate the routine's progress percent.
-  base::TimeTicks start_ticks_;
-  // Tracks the passage of time. Should never be used directly - instead, use
-  // |tick_clock_|.
-  std::unique_ptr<base::DefaultTickClock> default_tick_clock_;
-  // Unowned pointer which should outlive this instance. Allows the default tick
-  // clock to be overridden for testing.
-  const base::TickClock* tick_clock_;
+  // Runs the test in the background while the routine is running. It is
+  // shared with the background task so that it outlives the routine if the
+  // routine is destroyed first.
+  scoped_refptr<MemoryTester> tester_;
 
   // Must be the last class member.
   base::WeakPtrFactory<MemoryRoutine> weak_ptr_factory_{this};
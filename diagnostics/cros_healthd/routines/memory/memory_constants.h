@@ -9,18 +9,6 @@
 
 namespace diagnostics {
 
-// Different bit flags which can be encoded in the return value for memtester.
-// See https://linux.die.net/man/8/memtester for details. Note that this is not
-// an enum class so that it can be implicitly converted to a bit flag.
-enum MemtesterErrorCodes {
-  // An error allocating or locking memory, or invoking the memtester binary.
-  kAllocatingLockingInvokingError = 0x01,
-  // Stuck address test found an error.
-  kStuckAddressTestError = 0x02,
-  // Any test other than the stuck address test found an error.
-  kOtherTestError = 0x04,
-};
-
 // Ensure the operating system is left with at least the following size to avoid
 // out of memory error.
 constexpr int kMemoryRoutineReservedSizeMiB = 500;
@@ -31,8 +19,12 @@ inline constexpr char kMemoryRoutineSucceededMessage[] =
 inline constexpr char kMemoryRoutineRunningMessage[] = "Memory routine running";
 inline constexpr char kMemoryRoutineCancelledMessage[] =
     "Memory routine cancelled.";
-inline constexpr char kMemoryRoutineAllocatingLockingInvokingFailureMessage[] =
-    "Error allocating or locking memory, or invoking the memtester binary.\n";
+inline constexpr char kMemoryRoutineAllocatingFailureMessage[] =
+    "Error allocating memory.\n";
+inline constexpr char kMemoryRoutineLockingFailureMessage[] =
+    "Error locking memory.\n";
+inline constexpr char kMemoryRoutineAlreadyRunningMessage[] =
+    "Another memory routine is already running.";
 inline constexpr char kMemoryRoutineStuckAddressTestFailureMessage[] =
     "Error during the stuck address test.\n";
 inline constexpr char kMemoryRoutineOtherTestFailureMessage[] =
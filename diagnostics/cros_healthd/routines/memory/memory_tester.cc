@@ -0,0 +1,362 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "diagnostics/cros_healthd/routines/memory/memory_tester.h"
+
+#include <linux/capability.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/check.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/rand_util.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <base/threading/simple_thread.h>
+
+namespace diagnostics {
+
+namespace {
+
+// Number of words accessed between two progress reports, which are also the
+// points where the workers check for cancellation.
+constexpr size_t kBlockWords = 1024 * 1024 / sizeof(uint64_t);
+
+// The buffer is a whole number of transparent huge pages.
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+constexpr uint64_t kMovingInversionsPattern = 0x5555555555555555ull;
+
+// Reports the effective capabilities and the locked memory of the process.
+constexpr char kProcSelfStatusPath[] = "/proc/self/status";
+
+// Returns a well mixed 64-bit value derived from |x| (SplitMix64).
+uint64_t Mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+// Makes the compiler assume that any memory may have been read and written, so
+// that it neither drops the writes of a pass nor folds the reads of the next
+// pass into the values just written. Unlike accessing the words through a
+// volatile pointer, this keeps the loops vectorized.
+inline void CompilerBarrier() {
+  asm volatile("" ::: "memory");
+}
+
+}  // namespace
+
+struct MemoryTestChunk {
+  // Adds |count| word accesses to the progress. Returns false if the test was
+  // cancelled.
+  bool ReportProgress(size_t count) const {
+    processed_bytes->fetch_add(count * sizeof(uint64_t),
+                               std::memory_order_relaxed);
+    return !cancelled->load(std::memory_order_relaxed);
+  }
+
+  uint64_t* words;
+  size_t count;
+  // Seed of the randomValue subtest, unique to the chunk.
+  uint64_t seed;
+  std::atomic<uint64_t>* processed_bytes;
+  const std::atomic<bool>* cancelled;
+};
+
+namespace {
+
+// The loops below have no early exit so that the compiler vectorizes them. Each
+// block of accesses ends with a |CompilerBarrier()|, so that all of them reach
+// the memory.
+
+// Writes |value(i)| to every word |i| of |chunk|. Returns false if the test was
+// cancelled.
+template <typename ValueFunction>
+bool Fill(const MemoryTestChunk& chunk, ValueFunction value) {
+  for (size_t begin = 0; begin < chunk.count; begin += kBlockWords) {
+    const size_t end = std::min(chunk.count, begin + kBlockWords);
+    for (size_t i = begin; i < end; ++i)
+      chunk.words[i] = value(i);
+    CompilerBarrier();
+    if (!chunk.ReportProgress(end - begin))
+      return false;
+  }
+  return true;
+}
+
+// Adds the number of words |i| of |chunk| not holding |value(i)| to |errors|.
+// Returns false if the test was cancelled.
+template <typename ValueFunction>
+bool Verify(const MemoryTestChunk& chunk,
+            ValueFunction value,
+            uint64_t* errors) {
+  for (size_t begin = 0; begin < chunk.count; begin += kBlockWords) {
+    const size_t end = std::min(chunk.count, begin + kBlockWords);
+    uint64_t block_errors = 0;
+    for (size_t i = begin; i < end; ++i)
+      block_errors += chunk.words[i] != value(i);
+    CompilerBarrier();
+    *errors += block_errors;
+    if (!chunk.ReportProgress(end - begin))
+      return false;
+  }
+  return true;
+}
+
+// Writes |value(i)| and verifies it, then does the same with its complement.
+template <typename ValueFunction>
+uint64_t FillAndVerifyWithComplement(const MemoryTestChunk& chunk,
+                                     ValueFunction value) {
+  auto complement = [value](size_t i) { return ~value(i); };
+  uint64_t errors = 0;
+  if (Fill(chunk, value) && Verify(chunk, value, &errors) &&
+      Fill(chunk, complement)) {
+    Verify(chunk, complement, &errors);
+  }
+  return errors;
+}
+
+uint64_t StuckAddress(const MemoryTestChunk& chunk) {
+  return FillAndVerifyWithComplement(chunk, [&chunk](size_t i) {
+    return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(chunk.words + i));
+  });
+}
+
+uint64_t WalkingOnes(const MemoryTestChunk& chunk) {
+  return FillAndVerifyWithComplement(
+      chunk, [](size_t i) { return uint64_t{1} << (i % 64); });
+}
+
+uint64_t MovingInversions(const MemoryTestChunk& chunk) {
+  const uint64_t pattern = kMovingInversionsPattern;
+  const uint64_t inverted = ~pattern;
+  uint64_t errors = 0;
+  if (!Fill(chunk, [pattern](size_t) { return pattern; }))
+    return errors;
+
+  // Verify and invert in ascending order.
+  for (size_t begin = 0; begin < chunk.count; begin += kBlockWords) {
+    const size_t end = std::min(chunk.count, begin + kBlockWords);
+    for (size_t i = begin; i < end; ++i) {
+      errors += chunk.words[i] != pattern;
+      chunk.words[i] = inverted;
+    }
+    CompilerBarrier();
+    if (!chunk.ReportProgress(2 * (end - begin)))
+      return errors;
+  }
+
+  // Verify and invert back in descending order.
+  for (size_t end = chunk.count; end > 0;) {
+    const size_t begin = end > kBlockWords ? end - kBlockWords : 0;
+    for (size_t i = end; i > begin; --i) {
+      errors += chunk.words[i - 1] != inverted;
+      chunk.words[i - 1] = pattern;
+    }
+    CompilerBarrier();
+    if (!chunk.ReportProgress(2 * (end - begin)))
+      return errors;
+    end = begin;
+  }
+
+  Verify(chunk, [pattern](size_t) { return pattern; }, &errors);
+  return errors;
+}
+
+uint64_t RandomValue(const MemoryTestChunk& chunk) {
+  const uint64_t seed = chunk.seed;
+  auto value = [seed](size_t i) { return Mix(seed + i); };
+  uint64_t errors = 0;
+  if (Fill(chunk, value))
+    Verify(chunk, value, &errors);
+  return errors;
+}
+
+struct Subtest {
+  const char* name;
+  uint64_t (*function)(const MemoryTestChunk& chunk);
+  // Number of times the subtest accesses every word.
+  int accesses;
+};
+
+constexpr Subtest kSubtests[] = {
+    {MemoryTester::kStuckAddressSubtest, &StuckAddress, 4},
+    {"walkingOnes", &WalkingOnes, 4},
+    {"movingInversions", &MovingInversions, 6},
+    {"randomValue", &RandomValue, 2},
+};
+
+// Runs a subtest on a chunk of the buffer.
+class SubtestWorker : public base::SimpleThread {
+ public:
+  SubtestWorker(const std::string& name,
+                uint64_t (*subtest)(const MemoryTestChunk& chunk),
+                const MemoryTestChunk& chunk)
+      : base::SimpleThread("memory_" + name),
+        subtest_(subtest),
+        chunk_(chunk) {}
+  SubtestWorker(const SubtestWorker&) = delete;
+  SubtestWorker& operator=(const SubtestWorker&) = delete;
+
+  uint64_t errors() const { return errors_; }
+
+  void Run() override { errors_ = subtest_(chunk_); }
+
+ private:
+  uint64_t (*const subtest_)(const MemoryTestChunk& chunk);
+  const MemoryTestChunk chunk_;
+  uint64_t errors_ = 0;
+};
+
+}  // namespace
+
+MemoryTester::MemoryTester(size_t size, int num_threads, bool lock_memory)
+    : size_(size / kHugePageSize * kHugePageSize),
+      num_threads_(std::max(num_threads, 1)),
+      lock_memory_(lock_memory) {
+  for (const auto& subtest : kSubtests)
+    total_bytes_ += subtest.accesses * size_;
+}
+
+MemoryTester::~MemoryTester() {
+  DCHECK(!words_);
+}
+
+MemoryTester::Result MemoryTester::Run() {
+  Result result;
+  if (size_ == 0) {
+    LOG(ERROR) << "Not enough memory to test";
+    return result;
+  }
+
+  void* buffer = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer == MAP_FAILED) {
+    PLOG(ERROR) << "Failed to allocate " << size_ << " bytes";
+    return result;
+  }
+  // Huge pages spare most TLB misses. Regular pages are tested otherwise.
+  if (madvise(buffer, size_, MADV_HUGEPAGE) != 0)
+    PLOG(WARNING) << "Failed to use transparent huge pages";
+
+  result.allocated = true;
+  // Pages swapped out and back in during the test would be tested by neither
+  // the writes nor the reads they went through, so nothing is tested unless
+  // all of the buffer stays resident.
+  if (lock_memory_ && mlock(buffer, size_) != 0) {
+    PLOG(ERROR) << "Failed to lock " << size_ << " bytes in memory";
+    result.lock_failed = true;
+    if (munmap(buffer, size_) != 0)
+      PLOG(ERROR) << "Failed to free the memory to test";
+    return result;
+  }
+  result.bytes_tested = size_;
+  words_ = static_cast<uint64_t*>(buffer);
+  num_words_ = size_ / sizeof(uint64_t);
+  seed_ = base::RandUint64();
+
+  for (const auto& subtest : kSubtests) {
+    if (cancelled_.load())
+      break;
+    result.subtests.push_back(RunSubtest(subtest.name, subtest.function));
+  }
+  result.cancelled = cancelled_.load();
+
+  if (munmap(buffer, size_) != 0)
+    PLOG(ERROR) << "Failed to free the tested memory";
+  words_ = nullptr;
+  num_words_ = 0;
+  return result;
+}
+
+void MemoryTester::Cancel() {
+  cancelled_.store(true);
+}
+
+// static
+size_t MemoryTester::GetLockableSize() {
+  constexpr size_t kNoLimit = std::numeric_limits<size_t>::max();
+
+  std::string status;
+  if (!base::ReadFileToString(base::FilePath(kProcSelfStatusPath), &status)) {
+    PLOG(ERROR) << "Failed to read " << kProcSelfStatusPath;
+    return 0;
+  }
+  uint64_t effective_caps = 0;
+  uint64_t locked_kib = 0;
+  base::StringPairs fields;
+  base::SplitStringIntoKeyValuePairs(status, ':', '\n', &fields);
+  for (const auto& [key, value] : fields) {
+    // Values are padded with tabs, and VmLck is reported as "<size> kB".
+    const std::vector<base::StringPiece> tokens = base::SplitStringPiece(
+        value, " \t", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+    if (tokens.empty())
+      continue;
+    if (key == "CapEff")
+      base::HexStringToUInt64(tokens[0], &effective_caps);
+    else if (key == "VmLck")
+      base::StringToUint64(tokens[0], &locked_kib);
+  }
+  if (effective_caps & CAP_TO_MASK(CAP_IPC_LOCK))
+    return kNoLimit;
+
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_MEMLOCK, &limit) != 0) {
+    PLOG(ERROR) << "Failed to get RLIMIT_MEMLOCK";
+    return 0;
+  }
+  if (limit.rlim_cur == RLIM_INFINITY)
+    return kNoLimit;
+  const uint64_t locked = locked_kib * 1024;
+  return limit.rlim_cur > locked ? limit.rlim_cur - locked : 0;
+}
+
+uint32_t MemoryTester::GetProgressPercent() const {
+  if (total_bytes_ == 0)
+    return 0;
+  return std::min<uint64_t>(100, 100 * processed_bytes_.load() / total_bytes_);
+}
+
+MemoryTester::SubtestResult MemoryTester::RunSubtest(const std::string& name,
+                                                     SubtestFunction subtest) {
+  SubtestResult result;
+  result.name = name;
+  const uint64_t start_bytes = processed_bytes_.load();
+  const base::TimeTicks start_ticks = base::TimeTicks::Now();
+
+  std::vector<std::unique_ptr<SubtestWorker>> workers;
+  const size_t words_per_thread =
+      (num_words_ + num_threads_ - 1) / num_threads_;
+  for (size_t begin = 0; begin < num_words_; begin += words_per_thread) {
+    const MemoryTestChunk chunk{words_ + begin,
+                                std::min(words_per_thread, num_words_ - begin),
+                                seed_ + begin, &processed_bytes_, &cancelled_};
+    workers.push_back(std::make_unique<SubtestWorker>(name, subtest, chunk));
+    workers.back()->Start();
+  }
+
+  for (auto& worker : workers) {
+    worker->Join();
+    result.errors += worker->errors();
+  }
+  result.elapsed = base::TimeTicks::Now() - start_ticks;
+  result.bytes_processed = processed_bytes_.load() - start_bytes;
+  if (result.errors)
+    LOG(ERROR) << "Memory subtest " << name << " found " << result.errors
+               << " errors";
+  return result;
+}
+
+}  // namespace diagnostics
@@ -0,0 +1,111 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DIAGNOSTICS_CROS_HEALTHD_ROUTINES_MEMORY_MEMORY_TESTER_H_
+#define DIAGNOSTICS_CROS_HEALTHD_ROUTINES_MEMORY_MEMORY_TESTER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <base/memory/ref_counted.h>
+#include <base/time/time.h>
+
+namespace diagnostics {
+
+// Share of the buffer tested by a worker thread, defined in memory_tester.cc.
+struct MemoryTestChunk;
+
+// MemoryTester writes patterns to a large buffer and verifies them, splitting
+// the buffer between one worker thread per CPU. The buffer is backed by
+// transparent huge pages when available, and can be locked in memory so that
+// none of it is swapped out while it is tested.
+//
+// The subtests are:
+// * stuckAddress: every word holds its own address, then its complement.
+// * walkingOnes: a single set bit walking through the words, then its
+//   complement (walking zeroes).
+// * movingInversions: a pattern is verified and inverted in ascending address
+//   order, then verified and inverted back in descending order.
+// * randomValue: pseudo-random words derived from a random seed.
+//
+// Run() blocks until all subtests are done or Cancel() is called. Cancel() and
+// GetProgressPercent() can be called from any thread.
+class MemoryTester : public base::RefCountedThreadSafe<MemoryTester> {
+ public:
+  struct SubtestResult {
+    std::string name;
+    // Number of words holding an unexpected value.
+    uint64_t errors = 0;
+    // Number of bytes written and read by the subtest, and the time it took.
+    uint64_t bytes_processed = 0;
+    base::TimeDelta elapsed;
+  };
+
+  struct Result {
+    // False if the buffer could not be allocated.
+    bool allocated = false;
+    // True if the buffer could not be locked in memory. Nothing is tested
+    // then.
+    bool lock_failed = false;
+    bool cancelled = false;
+    uint64_t bytes_tested = 0;
+    std::vector<SubtestResult> subtests;
+  };
+
+  // Name of the subtest whose errors indicate faulty address lines.
+  static constexpr char kStuckAddressSubtest[] = "stuckAddress";
+
+  // Tests |size| bytes of memory with |num_threads| worker threads. The memory
+  // is locked with mlock() if |lock_memory| is true.
+  MemoryTester(size_t size, int num_threads, bool lock_memory);
+  MemoryTester(const MemoryTester&) = delete;
+  MemoryTester& operator=(const MemoryTester&) = delete;
+
+  Result Run();
+
+  void Cancel();
+
+  // Returns the number of bytes the process can still lock in memory: no limit
+  // with CAP_IPC_LOCK, RLIMIT_MEMLOCK minus the memory already locked
+  // otherwise.
+  static size_t GetLockableSize();
+
+  // Returns the percentage of the memory accesses of all subtests done so
+  // far.
+  uint32_t GetProgressPercent() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<MemoryTester>;
+  ~MemoryTester();
+
+  // Tests a chunk of the buffer and returns the number of errors found.
+  using SubtestFunction = uint64_t (*)(const MemoryTestChunk& chunk);
+
+  // Runs |subtest| on every worker thread, each on its share of the buffer,
+  // and waits for them.
+  SubtestResult RunSubtest(const std::string& name, SubtestFunction subtest);
+
+  const size_t size_;
+  const int num_threads_;
+  const bool lock_memory_;
+
+  // Buffer under test, only valid during Run().
+  uint64_t* words_ = nullptr;
+  size_t num_words_ = 0;
+
+  // Seed of the randomValue subtest.
+  uint64_t seed_ = 0;
+
+  std::atomic<bool> cancelled_{false};
+  // Bytes accessed so far, out of |total_bytes_|.
+  std::atomic<uint64_t> processed_bytes_{0};
+  uint64_t total_bytes_ = 0;
+};
+
+}  // namespace diagnostics
+
+#endif  // DIAGNOSTICS_CROS_HEALTHD_ROUTINES_MEMORY_MEMORY_TESTER_H_
@@ -0,0 +1,94 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <sys/resource.h>
+
+#include <cstddef>
+#include <string>
+
+#include <base/memory/scoped_refptr.h>
+#include <gtest/gtest.h>
+
+#include "diagnostics/cros_healthd/routines/memory/memory_tester.h"
+
+namespace diagnostics {
+namespace {
+
+constexpr size_t kMiB = 1024 * 1024;
+
+// Test that all subtests pass on a buffer split unevenly between the workers.
+TEST(MemoryTesterTest, RunAllSubtests) {
+  auto tester = base::MakeRefCounted<MemoryTester>(
+      6 * kMiB, 5, /*lock_memory=*/false);
+  EXPECT_EQ(tester->GetProgressPercent(), 0);
+
+  const MemoryTester::Result result = tester->Run();
+
+  EXPECT_TRUE(result.allocated);
+  EXPECT_FALSE(result.cancelled);
+  EXPECT_EQ(result.bytes_tested, 6 * kMiB);
+  ASSERT_EQ(result.subtests.size(), 4u);
+  EXPECT_EQ(result.subtests[0].name, MemoryTester::kStuckAddressSubtest);
+  for (const auto& subtest : result.subtests) {
+    EXPECT_EQ(subtest.errors, 0u) << subtest.name;
+    EXPECT_GE(subtest.bytes_processed, 2 * result.bytes_tested)
+        << subtest.name;
+  }
+  EXPECT_EQ(tester->GetProgressPercent(), 100);
+}
+
+// Test that the tested size is rounded down to whole huge pages.
+TEST(MemoryTesterTest, RoundDownSize) {
+  auto tester = base::MakeRefCounted<MemoryTester>(
+      3 * kMiB, 2, /*lock_memory=*/false);
+
+  EXPECT_EQ(tester->Run().bytes_tested, 2 * kMiB);
+}
+
+// Test that nothing is tested when there is less than a huge page.
+TEST(MemoryTesterTest, NotEnoughMemory) {
+  auto tester = base::MakeRefCounted<MemoryTester>(
+      kMiB, 1, /*lock_memory=*/false);
+
+  const MemoryTester::Result result = tester->Run();
+
+  EXPECT_FALSE(result.allocated);
+  EXPECT_TRUE(result.subtests.empty());
+}
+
+// Test that a cancelled tester stops before running any subtest.
+TEST(MemoryTesterTest, Cancel) {
+  auto tester = base::MakeRefCounted<MemoryTester>(
+      2 * kMiB, 1, /*lock_memory=*/false);
+  tester->Cancel();
+
+  const MemoryTester::Result result = tester->Run();
+
+  EXPECT_TRUE(result.allocated);
+  EXPECT_TRUE(result.cancelled);
+  EXPECT_TRUE(result.subtests.empty());
+}
+
+// Test that nothing is tested when the memory can't be locked.
+TEST(MemoryTesterTest, LockFailure) {
+  struct rlimit original_limit;
+  ASSERT_EQ(getrlimit(RLIMIT_MEMLOCK, &original_limit), 0);
+  struct rlimit limit = original_limit;
+  limit.rlim_cur = 0;
+  ASSERT_EQ(setrlimit(RLIMIT_MEMLOCK, &limit), 0);
+  const size_t lockable_size = MemoryTester::GetLockableSize();
+  auto tester = base::MakeRefCounted<MemoryTester>(
+      2 * kMiB, 1, /*lock_memory=*/true);
+  const MemoryTester::Result result = tester->Run();
+  ASSERT_EQ(setrlimit(RLIMIT_MEMLOCK, &original_limit), 0);
+
+  if (lockable_size != 0)
+    GTEST_SKIP() << "The test can lock memory beyond RLIMIT_MEMLOCK";
+  EXPECT_TRUE(result.lock_failed);
+  EXPECT_EQ(result.bytes_tested, 0u);
+  EXPECT_TRUE(result.subtests.empty());
+}
+
+}  // namespace
+}  // namespace diagnostics
@@ -3,17 +3,32 @@
 // found in the LICENSE file.
 
 #include <stdlib.h>
-#include <cmath>
+
 #include <cstdint>
+#include <iostream>
+#include <string>
 
+#include <base/bind.h>
+#include <base/json/json_writer.h>
 #include <base/time/time.h>
 #include <brillo/flag_helper.h>
 
+#include "diagnostics/cros_healthd/routines/cpu_validation/cpu_validation_engine.h"
+#include "diagnostics/cros_healthd/routines/cpu_validation/cpu_validation_kernels.h"
 #include "diagnostics/cros_healthd/routines/prime_search/prime_number_search.h"
 
+namespace {
+
+// Size of the buffer written and read back by the cache kernel of every
+// worker. It is larger than the last level cache share of a core.
+constexpr size_t kCacheBufferSize = 8 * 1024 * 1024;
+
+}  // namespace
+
 // 'prime_search' command-line tool:
 //  Calculates prime number between 2 to max_num and verifies the calculation
-//  repeatedly within a duration.
+//  repeatedly within a duration, on every CPU core at once, interleaved with
+//  cache thrashing. Prints a JSON report of the results of every core.
 int main(int argc, char** argv) {
   DEFINE_uint64(time, 10, "duration in seconds to run routine for.");
   DEFINE_uint64(max_num, diagnostics::kMaxPrimeNumber,
@@ -21,21 +36,22 @@ int main(int argc, char** argv) {
                 "Max and default is 1000000");
   brillo::FlagHelper::Init(argc, argv, "prime_search - diagnostic routine.");
 
-  base::TimeTicks end_time = base::TimeTicks::Now() + base::Seconds(FLAGS_time);
-
   uint64_t max_num = diagnostics::kMaxPrimeNumber;
   if (FLAGS_max_num <= diagnostics::kMaxPrimeNumber && FLAGS_max_num >= 2)
     max_num = FLAGS_max_num;
 
-  auto prime_number_search =
-      std::make_unique<diagnostics::PrimeNumberSearch>(max_num);
-  bool result = false;
+  diagnostics::CpuValidationEngine engine(
+      {base::BindRepeating(&diagnostics::CreatePrimeSearchKernel, max_num),
+       base::BindRepeating(&diagnostics::CreateCacheKernel,
+                           kCacheBufferSize)});
+  const auto results = engine.Run(base::Seconds(FLAGS_time));
 
-  while (base::TimeTicks::Now() < end_time) {
-    result = prime_number_search->Run();
-    if (result == false)
-      break;
-  }
+  std::string json;
+  base::JSONWriter::Write(
+      diagnostics::CpuValidationEngine::ResultsToValue(results), &json);
+  std::cout << json << std::endl;
 
-  return result == true ? EXIT_SUCCESS : EXIT_FAILURE;
+  return diagnostics::CpuValidationEngine::CountMismatches(results) == 0
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE;
 }
@@ -28,12 +28,15 @@ std::unique_ptr<DiagnosticRoutine> CreatePrimeSearchRoutine(
     const std::optional<base::TimeDelta>& exec_duration,
     const std::optional<uint64_t>& max_num) {
   base::TimeDelta duration = exec_duration.value_or(kDefaultCpuStressRuntime);
-  return std::make_unique<SubprocRoutine>(
+  auto routine = std::make_unique<SubprocRoutine>(
       base::CommandLine(std::vector<std::string>{
           kPrimeSearchExePath, "--time=" + std::to_string(duration.InSeconds()),
           "--max_num=" +
               std::to_string(max_num.value_or(kPrimeSearchDefaultMaxNum))}),
       duration);
+  // The executable reports the results of every CPU core.
+  routine->EnableProcessOutput();
+  return routine;
 }  // namespace diagnostics
 
 }  // namespace diagnostics
@@ -4,6 +4,10 @@
 
 #include "diagnostics/cros_healthd/routines/subproc_routine.h"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <utility>
 #include <vector>
@@ -11,10 +15,13 @@
 #include <base/check.h>
 #include <base/check_op.h>
 #include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
 #include <base/process/process_handle.h>
+#include <base/strings/string_piece.h>
 #include <base/strings/string_util.h>
 #include <base/time/time.h>
 
+#include "diagnostics/common/mojo_utils.h"
 #include "diagnostics/cros_healthd/routines/diag_process_adapter_impl.h"
 
 namespace diagnostics {
@@ -37,6 +44,34 @@ constexpr char kSubprocRoutineSucceededMessage[] = "Routine passed.";
 
 constexpr uint32_t kSubprocRoutineFakeProgressPercentUnknown = 33;
 
+namespace {
+
+// Upper bound of the output of the processes reported by the routine.
+constexpr size_t kMaxProcessOutputSize = 1024 * 1024;
+
+// Reads up to |kMaxProcessOutputSize| bytes from the start of |fd|.
+std::string ReadProcessOutput(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    PLOG(ERROR) << "Failed to get the size of the process output";
+    return "";
+  }
+  std::string output(
+      std::min<size_t>(std::max<off_t>(st.st_size, 0), kMaxProcessOutputSize),
+      '\0');
+  if (output.empty())
+    return output;
+  const ssize_t size = HANDLE_EINTR(pread(fd, &output[0], output.size(), 0));
+  if (size < 0) {
+    PLOG(ERROR) << "Failed to read the process output";
+    return "";
+  }
+  output.resize(size);
+  return output;
+}
+
+}  // namespace
+
 mojo_ipc::DiagnosticRoutineStatusEnum
 GetDiagnosticRoutineStatusFromSubprocRoutineStatus(
     SubprocRoutine::SubprocStatus subproc_status) {
@@ -156,6 +191,16 @@ void SubprocRoutine::PopulateStatusUpdate(mojo_ipc::RoutineUpdate* response,
 
   response->routine_update_union->set_noninteractive_update(update.Clone());
   response->progress_percent = CalculateProgressPercent();
+
+  if (include_output && output_fd_.is_valid() &&
+      (subproc_status_ == kSubprocStatusCompleteSuccess ||
+       subproc_status_ == kSubprocStatusCompleteFailure)) {
+    const std::string output = ReadProcessOutput(output_fd_.get());
+    if (!output.empty()) {
+      response->output =
+          CreateReadOnlySharedMemoryRegionMojoHandle(base::StringPiece(output));
+    }
+  }
 }
 
 mojo_ipc::DiagnosticRoutineStatusEnum SubprocRoutine::GetStatus() {
@@ -174,6 +219,13 @@ void SubprocRoutine::RegisterPostStopCallback(base::OnceClosure callback) {
   post_stop_callback_ = std::move(callback);
 }
 
+void SubprocRoutine::EnableProcessOutput() {
+  DCHECK_EQ(subproc_status_, kSubprocStatusReady);
+  output_fd_.reset(memfd_create("subproc_routine_output", MFD_CLOEXEC));
+  if (!output_fd_.is_valid())
+    PLOG(ERROR) << "Failed to create the process output file";
+}
+
 void SubprocRoutine::StartProcess() {
   DCHECK_EQ(command_lines_.empty(), false);
   DCHECK(subproc_status_ == kSubprocStatusReady ||
@@ -191,7 +243,12 @@ void SubprocRoutine::StartProcess() {
 
   VLOG(1) << "Starting command " << base::JoinString(command_line.argv(), " ");
 
-  if (!process_adapter_->StartProcess(command_line.argv(), &handle_)) {
+  const bool started =
+      output_fd_.is_valid()
+          ? process_adapter_->StartProcessWithOutput(
+                command_line.argv(), output_fd_.get(), &handle_)
+          : process_adapter_->StartProcess(command_line.argv(), &handle_);
+  if (!started) {
     subproc_status_ = kSubprocStatusLaunchFailed;
     LOG(ERROR) << kSubprocRoutineFailedToLaunchProcessMessage;
   }
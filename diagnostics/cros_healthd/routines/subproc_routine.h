@@ -11,6 +11,7 @@
 #include <string>
 
 #include <base/command_line.h>
+#include <base/files/scoped_file.h>
 #include <base/process/process.h>
 #include <base/time/default_tick_clock.h>
 #include <base/time/time.h>
@@ -86,6 +87,10 @@ class SubprocRoutine final : public DiagnosticRoutine {
   // Registers a callback that will execute after process is finished.
   // This function should be called only once.
   void RegisterPostStopCallback(base::OnceClosure callback);
+  // Reports what the processes write to their standard output as the output
+  // of the routine once it completed, e.g. a JSON report of the results.
+  // This function should be called before Start().
+  void EnableProcessOutput();
 
  private:
   // Functions to manipulate the child process.
@@ -129,6 +134,10 @@ class SubprocRoutine final : public DiagnosticRoutine {
   // progress percentage for handling progress reported across status changes.
   uint32_t last_reported_progress_percent_ = 0;
 
+  // |output_fd_| is the memory file collecting the standard output of the
+  // processes when EnableProcessOutput() was called.
+  base::ScopedFD output_fd_;
+
   // |handle_| keeps track of the running process.
   base::ProcessHandle handle_ = base::kNullProcessHandle;
 
@@ -10,11 +10,13 @@
 #include <vector>
 
 #include <base/command_line.h>
+#include <base/files/file_util.h>
 #include <base/test/simple_test_tick_clock.h>
 #include <base/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "diagnostics/common/mojo_test_utils.h"
 #include "diagnostics/cros_healthd/routines/diag_process_adapter.h"
 #include "diagnostics/cros_healthd/routines/routine_test_utils.h"
 
@@ -30,6 +32,7 @@ using ::testing::Return;
 using ::testing::SetArgPointee;
 using ::testing::StrictMock;
 using ::testing::Test;
+using ::testing::WithArg;
 
 constexpr base::TimeDelta kPredictedDuration = base::Seconds(10);
 
@@ -58,6 +61,10 @@ class MockDiagProcessAdapter : public DiagProcessAdapter {
               StartProcess,
               (const std::vector<std::string>&, base::ProcessHandle*),
               (override));
+  MOCK_METHOD(bool,
+              StartProcessWithOutput,
+              (const std::vector<std::string>&, int, base::ProcessHandle*),
+              (override));
   MOCK_METHOD(bool, KillProcess, (const base::ProcessHandle&), (override));
 };
 
@@ -454,6 +461,53 @@ TEST_F(SubprocRoutineTest, Resume) {
   routine()->Resume();
 }
 
+// Test that the standard output of the process is reported as the routine
+// output once the routine completed, on every status update including it.
+TEST_F(SubprocRoutineTest, ReportProcessOutput) {
+  constexpr char kOutput[] = "{\"cpus\": [{\"cpu\": 0, \"mismatches\": 0}]}";
+  CreateRoutine();
+  routine()->EnableProcessOutput();
+  EXPECT_CALL(*mock_adapter(), StartProcessWithOutput(_, _, _))
+      .WillOnce(DoAll(
+          WithArg<1>([&kOutput](int fd) {
+            EXPECT_TRUE(base::WriteFileDescriptor(fd, kOutput));
+          }),
+          SetArgPointee<2>(base::GetCurrentProcessHandle()), Return(true)));
+  routine()->Start();
+
+  // The output is only reported once the routine completed.
+  PopulateStatusUpdateForRunningRoutine(base::TERMINATION_STATUS_STILL_RUNNING);
+  EXPECT_FALSE(update()->output.is_valid());
+
+  PopulateStatusUpdateForRunningRoutine(
+      base::TERMINATION_STATUS_NORMAL_TERMINATION);
+  CheckRoutineUpdate(100, kSubprocRoutineSucceededMessage,
+                     mojo_ipc::DiagnosticRoutineStatusEnum::kPassed, *update());
+  EXPECT_EQ(GetStringFromMojoHandle(std::move(update()->output)), kOutput);
+
+  routine()->PopulateStatusUpdate(update(), true);
+  EXPECT_EQ(GetStringFromMojoHandle(std::move(update()->output)), kOutput);
+
+  routine()->PopulateStatusUpdate(update(), false);
+  EXPECT_FALSE(update()->output.is_valid());
+}
+
+// Test that a process writing nothing doesn't produce any routine output.
+TEST_F(SubprocRoutineTest, ReportEmptyProcessOutput) {
+  CreateRoutine();
+  routine()->EnableProcessOutput();
+  EXPECT_CALL(*mock_adapter(), StartProcessWithOutput(_, _, _))
+      .WillOnce(DoAll(SetArgPointee<2>(base::GetCurrentProcessHandle()),
+                      Return(true)));
+  routine()->Start();
+
+  PopulateStatusUpdateForRunningRoutine(
+      base::TERMINATION_STATUS_NORMAL_TERMINATION);
+  CheckRoutineUpdate(100, kSubprocRoutineSucceededMessage,
+                     mojo_ipc::DiagnosticRoutineStatusEnum::kPassed, *update());
+  EXPECT_FALSE(update()->output.is_valid());
+}
+
 // Test that we can create a SubprocRoutine with the production constructor.
 TEST(SubprocRoutineTestNoFixture, ProductionConstructor) {
   std::unique_ptr<SubprocRoutine> prod_routine =
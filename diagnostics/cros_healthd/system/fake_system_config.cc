@@ -11,10 +11,6 @@ namespace diagnostics {
 FakeSystemConfig::FakeSystemConfig() = default;
 FakeSystemConfig::~FakeSystemConfig() = default;
 
-bool FakeSystemConfig::FioSupported() {
-  return fio_supported_;
-}
-
 bool FakeSystemConfig::HasBacklight() {
   return has_backlight_;
 }
@@ -43,10 +39,6 @@ bool FakeSystemConfig::SmartCtlSupported() {
   return smart_ctrl_supported_;
 }
 
-void FakeSystemConfig::SetFioSupported(bool value) {
-  fio_supported_ = value;
-}
-
 bool FakeSystemConfig::IsWilcoDevice() {
   return wilco_device_;
 }
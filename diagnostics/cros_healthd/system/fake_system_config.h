@@ -20,7 +20,6 @@ class FakeSystemConfig final : public SystemConfigInterface {
   ~FakeSystemConfig() override;
 
   // SystemConfigInterface overrides.
-  bool FioSupported() override;
   bool HasBacklight() override;
   bool HasBattery() override;
   bool HasSmartBattery() override;
@@ -34,7 +33,6 @@ class FakeSystemConfig final : public SystemConfigInterface {
   std::string GetCodeName() override;
 
   // Setters for FakeSystemConfig attributes.
-  void SetFioSupported(bool value);
   void SetHasBacklight(bool value);
   void SetHasBattery(bool value);
   void SetHasSmartBattery(bool value);
@@ -48,7 +46,6 @@ class FakeSystemConfig final : public SystemConfigInterface {
   void SetCodeName(const std::string& value);
 
  private:
-  bool fio_supported_ = true;
   bool has_backlight_ = true;
   bool has_battery_ = true;
   bool has_smart_battery_ = true;
@@ -29,7 +29,6 @@ class SystemConfig final : public SystemConfigInterface {
   ~SystemConfig() override;
 
   // SystemConfigInterface overrides:
-  bool FioSupported() override;
   bool HasBacklight() override;
   bool HasBattery() override;
   bool HasSmartBattery() override;
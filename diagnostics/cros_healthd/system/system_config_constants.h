@@ -35,8 +35,6 @@ inline constexpr char kNvmeToolPath[] = "usr/sbin/nvme";
 inline constexpr char kDevicePath[] = "dev";
 // Smartctl utility program path relative to the root directory.
 inline constexpr char kSmartctlToolPath[] = "usr/sbin/smartctl";
-// Fio utility program path relative to the root directory.
-inline constexpr char kFioToolPath[] = "usr/bin/fio";
 // The path to check a device's branding properties.
 inline constexpr char kBrandingPath[] = "/branding";
 // The master configuration property that specifies a device's marketing name.
@@ -0,0 +1,235 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "diagnostics/cros_healthd/telemetry_subscriptions.h"
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include <base/bind.h>
+#include <base/check.h>
+#include <base/memory/weak_ptr.h>
+#include <base/timer/timer.h>
+#include <mojo/public/cpp/bindings/remote.h>
+
+namespace diagnostics {
+
+namespace {
+
+namespace mojom = ::chromeos::cros_healthd::mojom;
+
+// Copies |sample| to |sent| and |update| if it differs from |sent|, the
+// result last sent to an observer. Returns whether |sample| was copied.
+template <typename T>
+bool UpdateResult(const T& sample, T* sent, T* update) {
+  if (!sample || sample.Equals(*sent))
+    return false;
+  *sent = sample.Clone();
+  *update = sample.Clone();
+  return true;
+}
+
+// Calls UpdateResult() on the result of |category|.
+bool UpdateCategory(mojom::ProbeCategoryEnum category,
+                    const mojom::TelemetryInfo& sample,
+                    mojom::TelemetryInfo* sent,
+                    mojom::TelemetryInfo* update) {
+  switch (category) {
+    case mojom::ProbeCategoryEnum::kUnknown:
+      return false;
+    case mojom::ProbeCategoryEnum::kBattery:
+      return UpdateResult(sample.battery_result, &sent->battery_result,
+                          &update->battery_result);
+    case mojom::ProbeCategoryEnum::kNonRemovableBlockDevices:
+      return UpdateResult(sample.block_device_result,
+                          &sent->block_device_result,
+                          &update->block_device_result);
+    case mojom::ProbeCategoryEnum::kCpu:
+      return UpdateResult(sample.cpu_result, &sent->cpu_result,
+                          &update->cpu_result);
+    case mojom::ProbeCategoryEnum::kTimezone:
+      return UpdateResult(sample.timezone_result, &sent->timezone_result,
+                          &update->timezone_result);
+    case mojom::ProbeCategoryEnum::kMemory:
+      return UpdateResult(sample.memory_result, &sent->memory_result,
+                          &update->memory_result);
+    case mojom::ProbeCategoryEnum::kBacklight:
+      return UpdateResult(sample.backlight_result, &sent->backlight_result,
+                          &update->backlight_result);
+    case mojom::ProbeCategoryEnum::kFan:
+      return UpdateResult(sample.fan_result, &sent->fan_result,
+                          &update->fan_result);
+    case mojom::ProbeCategoryEnum::kStatefulPartition:
+      return UpdateResult(sample.stateful_partition_result,
+                          &sent->stateful_partition_result,
+                          &update->stateful_partition_result);
+    case mojom::ProbeCategoryEnum::kBluetooth:
+      return UpdateResult(sample.bluetooth_result, &sent->bluetooth_result,
+                          &update->bluetooth_result);
+    case mojom::ProbeCategoryEnum::kSystem:
+      return UpdateResult(sample.system_result, &sent->system_result,
+                          &update->system_result);
+    case mojom::ProbeCategoryEnum::kSystem2:
+      return UpdateResult(sample.system_result_v2, &sent->system_result_v2,
+                          &update->system_result_v2);
+    case mojom::ProbeCategoryEnum::kNetwork:
+      return UpdateResult(sample.network_result, &sent->network_result,
+                          &update->network_result);
+    case mojom::ProbeCategoryEnum::kAudio:
+      return UpdateResult(sample.audio_result, &sent->audio_result,
+                          &update->audio_result);
+    case mojom::ProbeCategoryEnum::kBootPerformance:
+      return UpdateResult(sample.boot_performance_result,
+                          &sent->boot_performance_result,
+                          &update->boot_performance_result);
+    case mojom::ProbeCategoryEnum::kBus:
+      return UpdateResult(sample.bus_result, &sent->bus_result,
+                          &update->bus_result);
+    case mojom::ProbeCategoryEnum::kTpm:
+      return UpdateResult(sample.tpm_result, &sent->tpm_result,
+                          &update->tpm_result);
+    case mojom::ProbeCategoryEnum::kNetworkInterface:
+      return UpdateResult(sample.network_interface_result,
+                          &sent->network_interface_result,
+                          &update->network_interface_result);
+    case mojom::ProbeCategoryEnum::kGraphics:
+      return UpdateResult(sample.graphics_result, &sent->graphics_result,
+                          &update->graphics_result);
+    case mojom::ProbeCategoryEnum::kDisplay:
+      return UpdateResult(sample.display_result, &sent->display_result,
+                          &update->display_result);
+  }
+}
+
+}  // namespace
+
+// Fetches the categories of the observers sharing a period and sends them
+// their updates.
+class TelemetrySubscriptions::Sampler final {
+ public:
+  // |on_empty| is run once the last observer is removed.
+  Sampler(FetchCallback fetch,
+          base::TimeDelta period,
+          base::OnceClosure on_empty)
+      : fetch_(std::move(fetch)), on_empty_(std::move(on_empty)) {
+    timer_.Start(FROM_HERE, period,
+                 base::BindRepeating(&Sampler::Sample, base::Unretained(this)));
+  }
+  Sampler(const Sampler&) = delete;
+  Sampler& operator=(const Sampler&) = delete;
+  ~Sampler() = default;
+
+  void AddObserver(
+      const std::vector<mojom::ProbeCategoryEnum>& categories,
+      mojo::PendingRemote<mojom::CrosHealthdTelemetryObserver> observer) {
+    const int id = next_observer_id_++;
+    Observer& entry = observers_[id];
+    entry.remote.Bind(std::move(observer));
+    entry.remote.set_disconnect_handler(base::BindOnce(
+        &Sampler::RemoveObserver, weak_ptr_factory_.GetWeakPtr(), id));
+    entry.categories.insert(categories.begin(), categories.end());
+    entry.sent = mojom::TelemetryInfo::New();
+  }
+
+  // Fetches the categories of every observer.
+  void Sample() {
+    if (fetching_) {
+      // The previous sample is still being fetched, skip this one.
+      return;
+    }
+
+    std::set<mojom::ProbeCategoryEnum> categories;
+    for (const auto& [id, observer] : observers_)
+      categories.insert(observer.categories.begin(), observer.categories.end());
+    if (categories.empty())
+      return;
+
+    fetching_ = true;
+    fetch_.Run(std::vector<mojom::ProbeCategoryEnum>(categories.begin(),
+                                                     categories.end()),
+               base::BindOnce(&Sampler::OnSampled,
+                              weak_ptr_factory_.GetWeakPtr()));
+  }
+
+ private:
+  struct Observer {
+    mojo::Remote<mojom::CrosHealthdTelemetryObserver> remote;
+    std::set<mojom::ProbeCategoryEnum> categories;
+    // Results last sent to |remote|.
+    mojom::TelemetryInfoPtr sent;
+  };
+
+  void OnSampled(mojom::TelemetryInfoPtr sample) {
+    fetching_ = false;
+    for (auto& [id, observer] : observers_) {
+      auto update = mojom::TelemetryInfo::New();
+      bool changed = false;
+      for (const auto category : observer.categories) {
+        if (UpdateCategory(category, *sample, observer.sent.get(),
+                           update.get())) {
+          changed = true;
+        }
+      }
+      if (changed)
+        observer.remote->OnTelemetryUpdate(std::move(update));
+    }
+  }
+
+  void RemoveObserver(int id) {
+    observers_.erase(id);
+    if (observers_.empty()) {
+      // Deletes |this|.
+      std::move(on_empty_).Run();
+    }
+  }
+
+  const FetchCallback fetch_;
+  base::OnceClosure on_empty_;
+  base::RepeatingTimer timer_;
+  // Observers keyed by a unique ID.
+  std::map<int, Observer> observers_;
+  int next_observer_id_ = 0;
+  // Set while a sample is being fetched.
+  bool fetching_ = false;
+
+  // Must be the last class member.
+  base::WeakPtrFactory<Sampler> weak_ptr_factory_{this};
+};
+
+TelemetrySubscriptions::TelemetrySubscriptions(FetchCallback fetch)
+    : fetch_(std::move(fetch)) {
+  DCHECK(fetch_);
+}
+
+TelemetrySubscriptions::~TelemetrySubscriptions() = default;
+
+void TelemetrySubscriptions::AddObserver(
+    const std::vector<mojom::ProbeCategoryEnum>& categories,
+    base::TimeDelta period,
+    mojo::PendingRemote<mojom::CrosHealthdTelemetryObserver> observer) {
+  period = std::max(period, kMinTelemetryPeriod);
+  auto& sampler = samplers_[period];
+  const bool new_sampler = !sampler;
+  if (new_sampler) {
+    // Samplers are only removed by their own callback, which can't run after
+    // |this| is destroyed.
+    sampler = std::make_unique<Sampler>(
+        fetch_, period,
+        base::BindOnce(&TelemetrySubscriptions::RemoveSampler,
+                       base::Unretained(this), period));
+  }
+  sampler->AddObserver(categories, std::move(observer));
+  if (new_sampler) {
+    // Send the first update right away. Observers joining an existing sampler
+    // get theirs with the next sample.
+    sampler->Sample();
+  }
+}
+
+void TelemetrySubscriptions::RemoveSampler(base::TimeDelta period) {
+  samplers_.erase(period);
+}
+
+}  // namespace diagnostics
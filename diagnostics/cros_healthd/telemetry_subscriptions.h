@@ -0,0 +1,71 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DIAGNOSTICS_CROS_HEALTHD_TELEMETRY_SUBSCRIPTIONS_H_
+#define DIAGNOSTICS_CROS_HEALTHD_TELEMETRY_SUBSCRIPTIONS_H_
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <base/callback.h>
+#include <base/time/time.h>
+#include <mojo/public/cpp/bindings/pending_remote.h>
+
+#include "diagnostics/mojom/public/cros_healthd.mojom.h"
+#include "diagnostics/mojom/public/cros_healthd_probe.mojom.h"
+
+namespace diagnostics {
+
+// Shortest period between two updates sent to a telemetry observer.
+constexpr base::TimeDelta kMinTelemetryPeriod = base::Seconds(1);
+
+// Sends periodic telemetry updates to the observers added with
+// CrosHealthdProbeService::AddTelemetryObserver.
+//
+// Observers with the same period share a sampler, which fetches the union of
+// their categories once per period. Each observer is then sent the results of
+// its categories which changed since its previous update, so that an idle
+// device costs little more than the fetch itself.
+class TelemetrySubscriptions final {
+ public:
+  // Fetches the telemetry of the given categories, e.g. FetchAggregator::Run.
+  using FetchCallback = base::RepeatingCallback<void(
+      const std::vector<chromeos::cros_healthd::mojom::ProbeCategoryEnum>&,
+      chromeos::cros_healthd::mojom::CrosHealthdProbeService::
+          ProbeTelemetryInfoCallback)>;
+
+  explicit TelemetrySubscriptions(FetchCallback fetch);
+  TelemetrySubscriptions(const TelemetrySubscriptions&) = delete;
+  TelemetrySubscriptions& operator=(const TelemetrySubscriptions&) = delete;
+  ~TelemetrySubscriptions();
+
+  // Sends the telemetry of |categories| to |observer| every |period|, which is
+  // raised to |kMinTelemetryPeriod| if shorter. The observer is removed when
+  // its message pipe is closed.
+  void AddObserver(
+      const std::vector<chromeos::cros_healthd::mojom::ProbeCategoryEnum>&
+          categories,
+      base::TimeDelta period,
+      mojo::PendingRemote<
+          chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver>
+          observer);
+
+  // Returns the number of periods being sampled.
+  size_t GetSamplerCountForTesting() const { return samplers_.size(); }
+
+ private:
+  class Sampler;
+
+  // Removes the sampler of |period|, once it has no observer left.
+  void RemoveSampler(base::TimeDelta period);
+
+  const FetchCallback fetch_;
+  // Samplers keyed by their period.
+  std::map<base::TimeDelta, std::unique_ptr<Sampler>> samplers_;
+};
+
+}  // namespace diagnostics
+
+#endif  // DIAGNOSTICS_CROS_HEALTHD_TELEMETRY_SUBSCRIPTIONS_H_
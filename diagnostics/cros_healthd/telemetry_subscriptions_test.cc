@@ -0,0 +1,193 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/test/task_environment.h>
+#include <gtest/gtest.h>
+#include <mojo/public/cpp/bindings/pending_receiver.h>
+#include <mojo/public/cpp/bindings/pending_remote.h>
+#include <mojo/public/cpp/bindings/receiver.h>
+
+#include "diagnostics/cros_healthd/telemetry_subscriptions.h"
+#include "diagnostics/mojom/public/cros_healthd_probe.mojom.h"
+
+namespace diagnostics {
+namespace {
+
+namespace mojo_ipc = ::chromeos::cros_healthd::mojom;
+
+constexpr base::TimeDelta kPeriod = base::Seconds(5);
+
+// Records the updates it receives.
+class FakeTelemetryObserver : public mojo_ipc::CrosHealthdTelemetryObserver {
+ public:
+  explicit FakeTelemetryObserver(
+      mojo::PendingReceiver<mojo_ipc::CrosHealthdTelemetryObserver> receiver)
+      : receiver_{this /* impl */, std::move(receiver)} {}
+  FakeTelemetryObserver(const FakeTelemetryObserver&) = delete;
+  FakeTelemetryObserver& operator=(const FakeTelemetryObserver&) = delete;
+
+  // mojo_ipc::CrosHealthdTelemetryObserver overrides:
+  void OnTelemetryUpdate(mojo_ipc::TelemetryInfoPtr telemetry_info) override {
+    updates.push_back(std::move(telemetry_info));
+  }
+
+  std::vector<mojo_ipc::TelemetryInfoPtr> updates;
+
+ private:
+  mojo::Receiver<mojo_ipc::CrosHealthdTelemetryObserver> receiver_;
+};
+
+// Tests for the TelemetrySubscriptions class.
+class TelemetrySubscriptionsTest : public testing::Test {
+ protected:
+  TelemetrySubscriptionsTest() = default;
+  TelemetrySubscriptionsTest(const TelemetrySubscriptionsTest&) = delete;
+  TelemetrySubscriptionsTest& operator=(const TelemetrySubscriptionsTest&) =
+      delete;
+
+  std::unique_ptr<FakeTelemetryObserver> AddObserver(
+      const std::vector<mojo_ipc::ProbeCategoryEnum>& categories,
+      base::TimeDelta period) {
+    mojo::PendingRemote<mojo_ipc::CrosHealthdTelemetryObserver> remote;
+    auto observer = std::make_unique<FakeTelemetryObserver>(
+        remote.InitWithNewPipeAndPassReceiver());
+    subscriptions_.AddObserver(categories, period, std::move(remote));
+    task_environment_.RunUntilIdle();
+    return observer;
+  }
+
+  void FastForwardBy(base::TimeDelta time) {
+    task_environment_.FastForwardBy(time);
+  }
+
+  // Fetches the timezone, whose region is |timezone_region_|, and the fan
+  // info, which is always an error.
+  void Fetch(const std::vector<mojo_ipc::ProbeCategoryEnum>& categories,
+             mojo_ipc::CrosHealthdProbeService::ProbeTelemetryInfoCallback
+                 callback) {
+    fetch_count_++;
+    fetched_categories_ = categories;
+    auto info = mojo_ipc::TelemetryInfo::New();
+    for (const auto category : categories) {
+      if (category == mojo_ipc::ProbeCategoryEnum::kTimezone) {
+        info->timezone_result = mojo_ipc::TimezoneResult::NewTimezoneInfo(
+            mojo_ipc::TimezoneInfo::New("posix", timezone_region_));
+      } else if (category == mojo_ipc::ProbeCategoryEnum::kFan) {
+        info->fan_result =
+            mojo_ipc::FanResult::NewError(mojo_ipc::ProbeError::New(
+                mojo_ipc::ErrorType::kSystemUtilityError, "no fan"));
+      }
+    }
+    std::move(callback).Run(std::move(info));
+  }
+
+  base::test::TaskEnvironment task_environment_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  int fetch_count_ = 0;
+  std::vector<mojo_ipc::ProbeCategoryEnum> fetched_categories_;
+  std::string timezone_region_ = "region";
+  TelemetrySubscriptions subscriptions_{base::BindRepeating(
+      &TelemetrySubscriptionsTest::Fetch, base::Unretained(this))};
+};
+
+// Test that the first update is sent right away with every category.
+TEST_F(TelemetrySubscriptionsTest, FirstUpdate) {
+  auto observer = AddObserver({mojo_ipc::ProbeCategoryEnum::kTimezone,
+                               mojo_ipc::ProbeCategoryEnum::kFan},
+                              kPeriod);
+
+  EXPECT_EQ(fetch_count_, 1);
+  ASSERT_EQ(observer->updates.size(), 1u);
+  const auto& update = observer->updates[0];
+  ASSERT_TRUE(update->timezone_result);
+  EXPECT_EQ(update->timezone_result->get_timezone_info()->region, "region");
+  EXPECT_TRUE(update->fan_result);
+  EXPECT_FALSE(update->memory_result);
+}
+
+// Test that only the categories which changed are sent.
+TEST_F(TelemetrySubscriptionsTest, OnlyChangedCategoriesSent) {
+  auto observer = AddObserver({mojo_ipc::ProbeCategoryEnum::kTimezone,
+                               mojo_ipc::ProbeCategoryEnum::kFan},
+                              kPeriod);
+
+  FastForwardBy(kPeriod);
+  EXPECT_EQ(fetch_count_, 2);
+  EXPECT_EQ(observer->updates.size(), 1u);
+
+  timezone_region_ = "other region";
+  FastForwardBy(kPeriod);
+  EXPECT_EQ(fetch_count_, 3);
+  ASSERT_EQ(observer->updates.size(), 2u);
+  const auto& update = observer->updates[1];
+  ASSERT_TRUE(update->timezone_result);
+  EXPECT_EQ(update->timezone_result->get_timezone_info()->region,
+            "other region");
+  EXPECT_FALSE(update->fan_result);
+}
+
+// Test that observers with the same period share the samples.
+TEST_F(TelemetrySubscriptionsTest, SharedSampling) {
+  auto timezone_observer =
+      AddObserver({mojo_ipc::ProbeCategoryEnum::kTimezone}, kPeriod);
+  auto fan_observer = AddObserver({mojo_ipc::ProbeCategoryEnum::kFan}, kPeriod);
+  EXPECT_EQ(subscriptions_.GetSamplerCountForTesting(), 1u);
+  EXPECT_TRUE(fan_observer->updates.empty());
+
+  FastForwardBy(kPeriod);
+
+  EXPECT_EQ(fetch_count_, 2);
+  EXPECT_EQ(fetched_categories_.size(), 2u);
+  ASSERT_EQ(fan_observer->updates.size(), 1u);
+  EXPECT_TRUE(fan_observer->updates[0]->fan_result);
+  EXPECT_FALSE(fan_observer->updates[0]->timezone_result);
+  EXPECT_EQ(timezone_observer->updates.size(), 1u);
+}
+
+// Test that observers with different periods are sampled separately.
+TEST_F(TelemetrySubscriptionsTest, DifferentPeriods) {
+  auto observer1 =
+      AddObserver({mojo_ipc::ProbeCategoryEnum::kTimezone}, kPeriod);
+  auto observer2 =
+      AddObserver({mojo_ipc::ProbeCategoryEnum::kTimezone}, 2 * kPeriod);
+  EXPECT_EQ(subscriptions_.GetSamplerCountForTesting(), 2u);
+  EXPECT_EQ(fetch_count_, 2);
+
+  FastForwardBy(2 * kPeriod);
+
+  EXPECT_EQ(fetch_count_, 5);
+}
+
+// Test that periods shorter than the minimum are raised to it.
+TEST_F(TelemetrySubscriptionsTest, MinimumPeriod) {
+  auto observer =
+      AddObserver({mojo_ipc::ProbeCategoryEnum::kTimezone}, base::TimeDelta());
+
+  FastForwardBy(kMinTelemetryPeriod);
+
+  EXPECT_EQ(fetch_count_, 2);
+}
+
+// Test that sampling stops once the observers are gone.
+TEST_F(TelemetrySubscriptionsTest, ObserverDisconnected) {
+  auto observer =
+      AddObserver({mojo_ipc::ProbeCategoryEnum::kTimezone}, kPeriod);
+
+  observer.reset();
+  task_environment_.RunUntilIdle();
+  EXPECT_EQ(subscriptions_.GetSamplerCountForTesting(), 0u);
+
+  FastForwardBy(kPeriod);
+  EXPECT_EQ(fetch_count_, 1);
+}
+
+}  // namespace
+}  // namespace diagnostics
@@ -229,6 +229,15 @@ class CrosHealthdMojoAdapterImpl final : public CrosHealthdMojoAdapter {
       mojo::PendingRemote<chromeos::cros_healthd::mojom::CrosHealthdUsbObserver>
           observer) override;
 
+  // Subscribes the client to periodic telemetry updates.
+  bool AddTelemetryObserver(
+      const std::vector<chromeos::cros_healthd::mojom::ProbeCategoryEnum>&
+          categories,
+      uint32_t period_seconds,
+      mojo::PendingRemote<
+          chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver>
+          observer) override;
+
  private:
   // Establishes a mojo connection with cros_healthd.
   bool Connect();
@@ -987,6 +996,21 @@ bool CrosHealthdMojoAdapterImpl::AddUsbObserver(
   return true;
 }
 
+bool CrosHealthdMojoAdapterImpl::AddTelemetryObserver(
+    const std::vector<chromeos::cros_healthd::mojom::ProbeCategoryEnum>&
+        categories,
+    uint32_t period_seconds,
+    mojo::PendingRemote<
+        chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver>
+        observer) {
+  if (!cros_healthd_service_factory_.is_bound() && !Connect())
+    return false;
+
+  cros_healthd_probe_service_->AddTelemetryObserver(
+      categories, period_seconds, std::move(observer));
+  return true;
+}
+
 bool CrosHealthdMojoAdapterImpl::Connect() {
   auto opt_pending_service_factory = delegate_->GetCrosHealthdServiceFactory();
   if (!opt_pending_service_factory)
@@ -232,6 +232,16 @@ class CrosHealthdMojoAdapter {
   virtual bool AddUsbObserver(
       mojo::PendingRemote<chromeos::cros_healthd::mojom::CrosHealthdUsbObserver>
           observer) = 0;
+
+  // Subscribes the client to the telemetry of |categories|, sent every
+  // |period_seconds|.
+  virtual bool AddTelemetryObserver(
+      const std::vector<chromeos::cros_healthd::mojom::ProbeCategoryEnum>&
+          categories,
+      uint32_t period_seconds,
+      mojo::PendingRemote<
+          chromeos::cros_healthd::mojom::CrosHealthdTelemetryObserver>
+          observer) = 0;
 };
 
 }  // namespace diagnostics
@@ -0,0 +1,208 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dns-proxy/dns_cache.h"
+
+#include <algorithm>
+#include <optional>
+
+#include <base/big_endian.h>
+#include <base/memory/ref_counted.h>
+#include <base/strings/string_util.h>
+#include <base/time/default_tick_clock.h>
+#include <chromeos/patchpanel/dns/dns_protocol.h>
+#include <chromeos/patchpanel/dns/dns_query.h>
+#include <chromeos/patchpanel/dns/dns_response.h>
+#include <chromeos/patchpanel/dns/io_buffer.h>
+
+namespace dns_proxy {
+namespace {
+// Upper bounds of the time a response is kept. RFC 2308 section 5 recommends
+// to limit negative caching to a few hours.
+constexpr base::TimeDelta kMaxPositiveTTL = base::Days(1);
+constexpr base::TimeDelta kMaxNegativeTTL = base::Hours(3);
+// An entry that already answered |kPrefetchMinHits| lookups is refreshed when
+// a lookup happens after |kPrefetchThreshold| of its TTL has elapsed.
+constexpr int kPrefetchMinHits = 2;
+constexpr double kPrefetchThreshold = 0.9;
+// Size of the TTL field and the RDLENGTH field of a resource record.
+constexpr size_t kTTLSize = sizeof(uint32_t);
+constexpr size_t kRdlengthSize = sizeof(uint16_t);
+// Maximum size of a DNS message.
+constexpr size_t kMaxMessageSize = 65536;
+
+std::optional<patchpanel::DnsQuery> ParseQuery(const char* msg, size_t len) {
+  if (!msg || len == 0 || len > kMaxMessageSize)
+    return std::nullopt;
+  auto buf = base::MakeRefCounted<patchpanel::IOBufferWithSize>(len);
+  memcpy(buf->data(), msg, len);
+  patchpanel::DnsQuery query(buf);
+  if (!query.Parse(len))
+    return std::nullopt;
+  return query;
+}
+
+// Returns the question of |query| used as the key of the cache. Names are
+// compared case-insensitively (RFC 4343), only QNAME is lowercased and QTYPE
+// and QCLASS are kept as is.
+std::string GetKey(const patchpanel::DnsQuery& query) {
+  std::string key(query.question());
+  const size_t qname_size = query.qname().size();
+  std::transform(key.begin(), key.begin() + qname_size, key.begin(),
+                 base::ToLowerASCII<char>);
+  return key;
+}
+
+}  // namespace
+
+DnsCache::DnsCache(size_t max_entries, const base::TickClock* clock)
+    : max_entries_(max_entries),
+      clock_(clock ? clock : base::DefaultTickClock::GetInstance()) {}
+
+DnsCache::LookupResult DnsCache::Lookup(const char* msg,
+                                        size_t len,
+                                        std::vector<char>* response) {
+  const auto query = ParseQuery(msg, len);
+  if (!query)
+    return LookupResult::kMiss;
+
+  auto it = entries_.find(GetKey(*query));
+  if (it == entries_.end())
+    return LookupResult::kMiss;
+
+  Entry& entry = it->second;
+  const base::TimeDelta elapsed = clock_->NowTicks() - entry.inserted;
+  if (elapsed >= entry.ttl) {
+    Erase(it);
+    return LookupResult::kMiss;
+  }
+
+  *response = entry.response;
+  // Copy the query ID, the response QNAME is left as is as its case might
+  // differ from the query.
+  memcpy(response->data(), msg, sizeof(uint16_t));
+  const uint32_t elapsed_secs = elapsed.InSeconds();
+  for (const size_t offset : entry.ttl_offsets) {
+    uint32_t ttl;
+    base::ReadBigEndian(
+        reinterpret_cast<const uint8_t*>(response->data() + offset), &ttl);
+    ttl = ttl > elapsed_secs ? ttl - elapsed_secs : 0;
+    base::WriteBigEndian(response->data() + offset, ttl);
+  }
+
+  lru_.splice(lru_.begin(), lru_, entry.lru_it);
+  entry.hits++;
+  if (!entry.prefetching && entry.hits >= kPrefetchMinHits &&
+      elapsed >= entry.ttl * kPrefetchThreshold) {
+    entry.prefetching = true;
+    return LookupResult::kHitPrefetch;
+  }
+  return LookupResult::kHit;
+}
+
+bool DnsCache::Put(const char* msg,
+                   size_t len,
+                   const unsigned char* response,
+                   size_t response_len) {
+  if (max_entries_ == 0 || !response || response_len == 0)
+    return false;
+
+  const auto query = ParseQuery(msg, len);
+  if (!query)
+    return false;
+
+  patchpanel::DnsResponse parsed(response, response_len, 0 /* offset */);
+  if (!parsed.InitParse(response_len, *query))
+    return false;
+
+  // Truncated responses are expected to be retried over TCP.
+  if (parsed.flags() & patchpanel::dns_protocol::kFlagTC)
+    return false;
+
+  const uint8_t rcode = parsed.rcode();
+  if (rcode != patchpanel::dns_protocol::kRcodeNOERROR &&
+      rcode != patchpanel::dns_protocol::kRcodeNXDOMAIN) {
+    return false;
+  }
+  const bool negative = rcode == patchpanel::dns_protocol::kRcodeNXDOMAIN ||
+                        parsed.answer_count() == 0;
+
+  Entry entry;
+  std::optional<uint32_t> ttl;
+  patchpanel::DnsRecordParser parser = parsed.Parser();
+  const unsigned num_records = parsed.answer_count() +
+                               parsed.authority_count() +
+                               parsed.additional_answer_count();
+  for (unsigned i = 0; i < num_records; i++) {
+    patchpanel::DnsResourceRecord record;
+    if (!parser.ReadRecord(&record))
+      return false;
+
+    // The TTL field of the OPT pseudo-record holds EDNS flags.
+    if (record.type == patchpanel::dns_protocol::kTypeOPT)
+      continue;
+
+    entry.ttl_offsets.push_back(parser.GetOffset() - record.rdata.size() -
+                                kRdlengthSize - kTTLSize);
+
+    if (!negative) {
+      if (i < parsed.answer_count())
+        ttl = std::min(ttl.value_or(record.ttl), record.ttl);
+      continue;
+    }
+
+    // RFC 2308 section 5: the TTL of a negative response is the minimum of
+    // the SOA record TTL and the SOA MINIMUM field.
+    const unsigned authority_end =
+        parsed.answer_count() + parsed.authority_count();
+    if (record.type != patchpanel::dns_protocol::kTypeSOA ||
+        i < parsed.answer_count() || i >= authority_end ||
+        record.rdata.size() < sizeof(uint32_t)) {
+      continue;
+    }
+    uint32_t minimum;
+    base::ReadBigEndian(reinterpret_cast<const uint8_t*>(
+                            record.rdata.data() + record.rdata.size() -
+                            sizeof(uint32_t)),
+                        &minimum);
+    ttl = std::min(ttl.value_or(record.ttl), std::min(record.ttl, minimum));
+  }
+
+  if (!ttl || ttl.value() == 0)
+    return false;
+
+  entry.ttl = std::min(base::Seconds(ttl.value()),
+                       negative ? kMaxNegativeTTL : kMaxPositiveTTL);
+  entry.inserted = clock_->NowTicks();
+  entry.response.assign(response, response + response_len);
+
+  std::string key = GetKey(*query);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    // Keep the popularity of refreshed entries.
+    entry.hits = it->second.hits;
+    Erase(it);
+  }
+
+  while (entries_.size() >= max_entries_) {
+    Erase(entries_.find(lru_.back()));
+  }
+
+  lru_.push_front(key);
+  entry.lru_it = lru_.begin();
+  entries_.emplace(std::move(key), std::move(entry));
+  return true;
+}
+
+void DnsCache::Clear() {
+  entries_.clear();
+  lru_.clear();
+}
+
+void DnsCache::Erase(std::map<std::string, Entry>::iterator it) {
+  lru_.erase(it->second.lru_it);
+  entries_.erase(it);
+}
+
+}  // namespace dns_proxy
@@ -0,0 +1,92 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef DNS_PROXY_DNS_CACHE_H_
+#define DNS_PROXY_DNS_CACHE_H_
+
+#include <list>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <base/time/tick_clock.h>
+#include <base/time/time.h>
+
+namespace dns_proxy {
+
+// Maximum number of responses kept in the cache.
+constexpr size_t kDefaultMaxCacheEntries = 1024;
+
+// DnsCache stores wire-format DNS responses keyed by the question of the
+// query (QNAME, QTYPE, QCLASS). QNAME is matched case-insensitively.
+//
+// Positive responses are kept for the minimum TTL of their records. Negative
+// responses (NXDOMAIN and NODATA) are kept following RFC 2308, using the
+// minimum of the SOA record TTL and its MINIMUM field. Negative responses
+// without a SOA record, truncated responses and errors are not cached.
+//
+// Responses returned from the cache have their ID set to the query ID and
+// their TTLs decreased by the time spent in the cache.
+class DnsCache {
+ public:
+  enum class LookupResult {
+    kMiss,
+    kHit,
+    // Same as |kHit|, the caller is also expected to refresh the entry by
+    // querying the name servers again and calling `Put(...)` with the result.
+    kHitPrefetch,
+  };
+
+  explicit DnsCache(size_t max_entries = kDefaultMaxCacheEntries,
+                    const base::TickClock* clock = nullptr);
+  DnsCache(const DnsCache&) = delete;
+  DnsCache& operator=(const DnsCache&) = delete;
+  ~DnsCache() = default;
+
+  // Looks up the response of the wire-format DNS query |msg| of length |len|.
+  // On hit, the response is written to |response|.
+  LookupResult Lookup(const char* msg, size_t len, std::vector<char>* response);
+
+  // Caches the wire-format |response| of length |response_len| for the query
+  // |msg| of length |len|. Returns true if the response was cached.
+  bool Put(const char* msg,
+           size_t len,
+           const unsigned char* response,
+           size_t response_len);
+
+  // Drops all cached responses. This must be called whenever the network or
+  // the name servers change.
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::vector<char> response;
+    // Offsets of the TTL fields of every resource records in |response|.
+    std::vector<size_t> ttl_offsets;
+    base::TimeTicks inserted;
+    base::TimeDelta ttl;
+    // Number of lookups answered by this entry.
+    int hits = 0;
+    // Set when a prefetch has been requested for this entry.
+    bool prefetching = false;
+    std::list<std::string>::iterator lru_it;
+  };
+
+  // Remove |it| from the cache.
+  void Erase(std::map<std::string, Entry>::iterator it);
+
+  size_t max_entries_;
+  const base::TickClock* clock_;
+
+  std::map<std::string, Entry> entries_;
+  // Keys of |entries_|, most recently used first.
+  std::list<std::string> lru_;
+};
+
+}  // namespace dns_proxy
+
+#endif  // DNS_PROXY_DNS_CACHE_H_
@@ -0,0 +1,220 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dns-proxy/dns_cache.h"
+
+#include <memory>
+#include <vector>
+
+#include <base/test/simple_test_tick_clock.h>
+#include <base/time/time.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using testing::ElementsAreArray;
+
+namespace dns_proxy {
+namespace {
+// Query of type A for "google.com" with ID "JG".
+const char kQuery[] = {'J',    'G',    '\x01', ' ',    '\x00', '\x01',
+                       '\x00', '\x00', '\x00', '\x00', '\x00', '\x00',
+                       '\x06', 'g',    'o',    'o',    'g',    'l',
+                       'e',    '\x03', 'c',    'o',    'm',    '\x00',
+                       '\x00', '\x01', '\x00', '\x01'};
+
+// Same as |kQuery| with ID "AB" and a different case.
+const char kQueryOtherCase[] = {'A',    'B',    '\x01', ' ',    '\x00', '\x01',
+                                '\x00', '\x00', '\x00', '\x00', '\x00', '\x00',
+                                '\x06', 'G',    'o',    'O',    'g',    'L',
+                                'e',    '\x03', 'C',    'O',    'M',    '\x00',
+                                '\x00', '\x01', '\x00', '\x01'};
+
+// Query of type AAAA for "google.com" with ID "JG".
+const char kQueryAAAA[] = {'J',    'G',    '\x01', ' ',    '\x00', '\x01',
+                           '\x00', '\x00', '\x00', '\x00', '\x00', '\x00',
+                           '\x06', 'g',    'o',    'o',    'g',    'l',
+                           'e',    '\x03', 'c',    'o',    'm',    '\x00',
+                           '\x00', '\x1c', '\x00', '\x01'};
+
+// Response to |kQuery| with a single A record with a TTL of 60 seconds.
+const unsigned char kResponse[] = {
+    'J',  'G',  0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03, 'c',  'o',
+    'm',  0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x08, 0x08, 0x08, 0x08};
+
+// |kResponse| as served for |kQueryOtherCase| after 10 seconds.
+const unsigned char kCachedResponse[] = {
+    'A',  'B',  0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03, 'c',  'o',
+    'm',  0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x32, 0x00, 0x04, 0x08, 0x08, 0x08, 0x08};
+
+// Response to |kQueryAAAA| with a single AAAA record with a TTL of 60 seconds.
+const unsigned char kResponseAAAA[] = {
+    'J',  'G',  0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03, 'c',  'o',  'm',  0x00,
+    0x00, 0x1c, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x1c, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x3c, 0x00, 0x10, 0x20, 0x01, 0x48, 0x60, 0x48, 0x60, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x88, 0x88};
+
+// NXDOMAIN response to |kQuery| with a SOA record with a TTL of 3600 seconds
+// and a MINIMUM of 300 seconds.
+const unsigned char kNxDomainResponse[] = {
+    'J',  'G',  0x81, 0x83, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03, 'c',  'o',  'm',  0x00,
+    0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00,
+    0x0e, 0x10, 0x00, 0x1a, 0x01, 'a',  0x00, 0x01, 'b',  0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00,
+    0x00, 0x04, 0x00, 0x00, 0x01, 0x2c};
+
+// NXDOMAIN response to |kQuery| without any SOA record.
+const unsigned char kNxDomainNoSoaResponse[] = {
+    'J',  'G',  0x81, 0x83, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03,
+    'c',  'o',  'm',  0x00, 0x00, 0x01, 0x00, 0x01};
+
+// SERVFAIL response to |kQuery|.
+const unsigned char kServFailResponse[] = {
+    'J',  'G',  0x81, 0x82, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03,
+    'c',  'o',  'm',  0x00, 0x00, 0x01, 0x00, 0x01};
+}  // namespace
+
+class DnsCacheTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    clock_.SetNowTicks(base::TimeTicks::Now());
+    cache_ = std::make_unique<DnsCache>(kDefaultMaxCacheEntries, &clock_);
+  }
+
+  DnsCache::LookupResult Lookup(const char* msg, size_t len) {
+    return cache_->Lookup(msg, len, &response_);
+  }
+
+  base::SimpleTestTickClock clock_;
+  std::unique_ptr<DnsCache> cache_;
+  std::vector<char> response_;
+};
+
+TEST_F(DnsCacheTest, Miss) {
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kMiss);
+}
+
+TEST_F(DnsCacheTest, InvalidQuery) {
+  EXPECT_FALSE(cache_->Put(kQuery, 5, kResponse, sizeof(kResponse)));
+  EXPECT_EQ(Lookup(kQuery, 5), DnsCache::LookupResult::kMiss);
+}
+
+TEST_F(DnsCacheTest, Hit) {
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kHit);
+  EXPECT_THAT(response_,
+              ElementsAreArray(reinterpret_cast<const char*>(kResponse),
+                               sizeof(kResponse)));
+  EXPECT_EQ(Lookup(kQueryAAAA, sizeof(kQueryAAAA)),
+            DnsCache::LookupResult::kMiss);
+}
+
+TEST_F(DnsCacheTest, HitRewritesIdAndTTL) {
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  clock_.Advance(base::Seconds(10));
+  EXPECT_EQ(Lookup(kQueryOtherCase, sizeof(kQueryOtherCase)),
+            DnsCache::LookupResult::kHit);
+  EXPECT_THAT(response_,
+              ElementsAreArray(reinterpret_cast<const char*>(kCachedResponse),
+                               sizeof(kCachedResponse)));
+}
+
+TEST_F(DnsCacheTest, Expired) {
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  clock_.Advance(base::Seconds(60));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kMiss);
+  EXPECT_EQ(cache_->size(), 0u);
+}
+
+TEST_F(DnsCacheTest, NegativeResponse) {
+  EXPECT_TRUE(cache_->Put(kQuery, sizeof(kQuery), kNxDomainResponse,
+                          sizeof(kNxDomainResponse)));
+  clock_.Advance(base::Seconds(299));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kHit);
+  clock_.Advance(base::Seconds(1));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kMiss);
+}
+
+TEST_F(DnsCacheTest, NegativeResponseWithoutSoa) {
+  EXPECT_FALSE(cache_->Put(kQuery, sizeof(kQuery), kNxDomainNoSoaResponse,
+                           sizeof(kNxDomainNoSoaResponse)));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kMiss);
+}
+
+TEST_F(DnsCacheTest, ServFail) {
+  EXPECT_FALSE(cache_->Put(kQuery, sizeof(kQuery), kServFailResponse,
+                           sizeof(kServFailResponse)));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kMiss);
+}
+
+TEST_F(DnsCacheTest, MismatchedResponse) {
+  EXPECT_FALSE(cache_->Put(kQueryAAAA, sizeof(kQueryAAAA), kResponse,
+                           sizeof(kResponse)));
+}
+
+TEST_F(DnsCacheTest, Prefetch) {
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kHit);
+  clock_.Advance(base::Seconds(55));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)),
+            DnsCache::LookupResult::kHitPrefetch);
+  // Only a single prefetch is requested.
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kHit);
+
+  // Refreshing the entry resets its TTL.
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  clock_.Advance(base::Seconds(10));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kHit);
+}
+
+TEST_F(DnsCacheTest, PrefetchUnpopular) {
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  clock_.Advance(base::Seconds(55));
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kHit);
+}
+
+TEST_F(DnsCacheTest, Clear) {
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  cache_->Clear();
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kMiss);
+}
+
+TEST_F(DnsCacheTest, EvictLeastRecentlyUsed) {
+  cache_ = std::make_unique<DnsCache>(1 /* max_entries */, &clock_);
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  EXPECT_TRUE(cache_->Put(kQueryAAAA, sizeof(kQueryAAAA), kResponseAAAA,
+                          sizeof(kResponseAAAA)));
+  EXPECT_EQ(cache_->size(), 1u);
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kMiss);
+  EXPECT_EQ(Lookup(kQueryAAAA, sizeof(kQueryAAAA)),
+            DnsCache::LookupResult::kHit);
+}
+
+TEST_F(DnsCacheTest, ReplaceEntry) {
+  EXPECT_TRUE(
+      cache_->Put(kQuery, sizeof(kQuery), kResponse, sizeof(kResponse)));
+  EXPECT_TRUE(cache_->Put(kQuery, sizeof(kQuery), kNxDomainResponse,
+                          sizeof(kNxDomainResponse)));
+  EXPECT_EQ(cache_->size(), 1u);
+  EXPECT_EQ(Lookup(kQuery, sizeof(kQuery)), DnsCache::LookupResult::kHit);
+  EXPECT_THAT(response_,
+              ElementsAreArray(reinterpret_cast<const char*>(kNxDomainResponse),
+                               sizeof(kNxDomainResponse)));
+}
+}  // namespace dns_proxy
@@ -20,6 +20,18 @@ constexpr char kLinuxUserAgent[] =
 constexpr std::array<const char*, 2> kDoHHeaderList{
     {"Accept: application/dns-message",
      "Content-Type: application/dns-message"}};
+// Connections to DoH providers are kept alive while idle so that subsequent
+// queries do not pay for the TCP and TLS handshakes. Idle connections are
+// closed by CURL after |kMaxIdleConnectionSeconds|.
+constexpr long kKeepAliveIdleSeconds = 30;
+constexpr long kKeepAliveIntervalSeconds = 15;
+constexpr long kMaxIdleConnectionSeconds = 300;
+// Wire-format query of type NS for the root domain, with ID 0 as recommended
+// by RFC 8484. This is used to open the connections to the DoH providers
+// before any query is made.
+constexpr char kWarmUpQuery[] = {
+    '\x00', '\x00', '\x01', '\x00', '\x00', '\x01', '\x00', '\x00', '\x00',
+    '\x00', '\x00', '\x00', '\x00', '\x00', '\x02', '\x00', '\x01'};
 }  // namespace
 
 DoHCurlClient::CurlResult::CurlResult(CURLcode curl_code,
@@ -64,6 +76,20 @@ DoHCurlClient::DoHCurlClient(base::TimeDelta timeout,
       max_concurrent_queries_(max_concurrent_queries) {
   // Initialize CURL.
   curl_global_init(CURL_GLOBAL_DEFAULT);
+  InitCurlMulti();
+}
+
+DoHCurlClient::~DoHCurlClient() {
+  // Cancel all in-flight queries.
+  for (const auto& requests : requests_) {
+    CancelRequest(requests.second);
+  }
+  curl_multi_cleanup(curlm_);
+  curlm_ = nullptr;
+  curl_global_cleanup();
+}
+
+void DoHCurlClient::InitCurlMulti() {
   curlm_ = curl_multi_init();
 
   // Set socket callback to `SocketCallback(...)`. This function will be called
@@ -79,16 +105,60 @@ DoHCurlClient::DoHCurlClient(base::TimeDelta timeout,
   curl_multi_setopt(curlm_, CURLMOPT_TIMERDATA, this);
   curl_multi_setopt(curlm_, CURLMOPT_TIMERFUNCTION,
                     &DoHCurlClient::TimerCallback);
+
+  // Multiplex concurrent queries to the same DoH provider as HTTP/2 streams
+  // of a single connection instead of opening parallel connections.
+  curl_multi_setopt(curlm_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
 }
 
-DoHCurlClient::~DoHCurlClient() {
-  // Cancel all in-flight queries.
-  for (const auto& requests : requests_) {
-    CancelRequest(requests.second);
+void DoHCurlClient::ResetConnections() {
+  // Connections are owned by the CURL multi handle. They can only be dropped
+  // by re-creating the handle, which would abort the in-flight queries. In
+  // that case, the reset is deferred until they are done, see
+  // `OnQueriesDone()`.
+  if (!states_.empty()) {
+    reset_pending_ = true;
+    return;
   }
+  reset_pending_ = false;
+  read_watchers_.clear();
+  write_watchers_.clear();
   curl_multi_cleanup(curlm_);
-  curlm_ = nullptr;
-  curl_global_cleanup();
+  InitCurlMulti();
+}
+
+void DoHCurlClient::OnQueriesDone() {
+  if (!reset_pending_) {
+    return;
+  }
+  ResetConnections();
+  WarmUp();
+}
+
+void DoHCurlClient::WarmUp() {
+  // The connections opened while a reset is pending would be dropped by it,
+  // the warm-up is done once the reset ran instead, see `OnQueriesDone()`.
+  if (name_servers_.empty() || reset_pending_) {
+    return;
+  }
+  // Each provider is queried by its own request, so that the first response
+  // doesn't cancel the queries to the other providers.
+  for (const auto& doh_provider : doh_providers_) {
+    StartRequest({doh_provider}, kWarmUpQuery, sizeof(kWarmUpQuery),
+                 base::BindRepeating(&DoHCurlClient::OnWarmUpDone,
+                                     weak_factory_.GetWeakPtr()),
+                 nullptr /* ctx */);
+  }
+}
+
+void DoHCurlClient::OnWarmUpDone(void* ctx,
+                                 const CurlResult& res,
+                                 unsigned char* msg,
+                                 size_t len) {
+  if (res.curl_code != CURLE_OK) {
+    LOG(WARNING) << "Failed to connect to DoH providers: "
+                 << curl_easy_strerror(res.curl_code);
+  }
 }
 
 void DoHCurlClient::HandleResult(CURLMsg* curl_msg) {
@@ -111,6 +181,13 @@ void DoHCurlClient::HandleResult(CURLMsg* curl_msg) {
   if (http_code == kHTTPOk || requests_[state->request_id].size() == 1) {
     state->RunCallback(curl_msg, http_code);
     CancelRequest(state->request_id);
+    // The CURL multi handle can't be re-created while its messages are being
+    // read, so the deferred reset is posted.
+    if (reset_pending_ && states_.empty()) {
+      base::ThreadTaskRunnerHandle::Get()->PostTask(
+          FROM_HERE, base::BindOnce(&DoHCurlClient::OnQueriesDone,
+                                    weak_factory_.GetWeakPtr()));
+    }
     return;
   }
   // TODO(jasongustaman): Get and save curl metrics.
@@ -244,12 +321,25 @@ size_t DoHCurlClient::HeaderCallback(char* data,
 
 void DoHCurlClient::SetNameServers(
     const std::vector<std::string>& name_servers) {
-  name_servers_ = base::JoinString(name_servers, ",");
+  std::string name_servers_str = base::JoinString(name_servers, ",");
+  if (name_servers_str == name_servers_) {
+    return;
+  }
+  // Name servers change along with the network. Connections opened on the
+  // previous network are dropped and new ones are opened right away, or once
+  // the in-flight queries are done.
+  name_servers_ = std::move(name_servers_str);
+  ResetConnections();
+  WarmUp();
 }
 
 void DoHCurlClient::SetDoHProviders(
     const std::vector<std::string>& doh_providers) {
+  if (doh_providers == doh_providers_) {
+    return;
+  }
   doh_providers_ = doh_providers;
+  WarmUp();
 }
 
 void DoHCurlClient::CancelRequest(const std::set<State*>& states) {
@@ -305,6 +395,24 @@ std::unique_ptr<DoHCurlClient::State> DoHCurlClient::InitCurl(
   curl_easy_setopt(curl, CURLOPT_POSTFIELDS, msg);
   curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, len);
 
+  // Use HTTP/2 when the DoH provider supports it. Wait for a pending
+  // connection to the provider to be established and multiplex the query on
+  // it instead of opening a new connection.
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+
+  // Don't reuse the connections to be dropped by a deferred reset, they were
+  // opened before the name servers changed.
+  if (reset_pending_) {
+    curl_easy_setopt(curl, CURLOPT_FRESH_CONNECT, 1L);
+  }
+
+  // Keep the connection alive for subsequent queries.
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, kKeepAliveIdleSeconds);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, kKeepAliveIntervalSeconds);
+  curl_easy_setopt(curl, CURLOPT_MAXAGE_CONN, kMaxIdleConnectionSeconds);
+
   // Set the user agent for the query.
   curl_easy_setopt(curl, CURLOPT_USERAGENT, kLinuxUserAgent);
 
@@ -335,10 +443,17 @@ bool DoHCurlClient::Resolve(const char* msg,
     LOG(DFATAL) << "DNS and DoH server must not be empty";
     return false;
   }
+  return StartRequest(doh_providers_, msg, len, callback, ctx);
+}
 
+bool DoHCurlClient::StartRequest(const std::vector<std::string>& doh_providers,
+                                 const char* msg,
+                                 int len,
+                                 const QueryCallback& callback,
+                                 void* ctx) {
   std::set<State*> requests;
   int num_concurrent_queries = 0;
-  for (const auto& doh_provider : doh_providers_) {
+  for (const auto& doh_provider : doh_providers) {
     std::unique_ptr<State> state =
         InitCurl(doh_provider, msg, len, callback, ctx);
     if (!state.get()) {
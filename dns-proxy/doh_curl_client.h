@@ -70,6 +70,12 @@ class DoHCurlClientInterface {
 // response done through CURL. Given multiple DoH servers, DoHCurlClient will
 // query each servers concurrently. It will return only the first successful
 // response OR the last failing response.
+//
+// Connections to the DoH providers are kept alive and shared by the queries.
+// When a provider supports HTTP/2, concurrent queries are multiplexed over a
+// single connection. Connections to the DoH providers are opened ahead of the
+// queries whenever the DoH providers change. When the name servers change,
+// they are dropped and re-opened once the in-flight queries are done.
 class DoHCurlClient : public DoHCurlClientInterface {
  public:
   DoHCurlClient(base::TimeDelta timeout, int max_concurrent_queries);
@@ -99,6 +105,9 @@ class DoHCurlClient : public DoHCurlClientInterface {
     return weak_factory_.GetWeakPtr();
   }
 
+  // Returns the number of queries in flight, including the warm-up ones.
+  size_t GetNumInFlightQueriesForTesting() const { return states_.size(); }
+
  private:
   // State of an individual query.
   struct State {
@@ -138,6 +147,37 @@ class DoHCurlClient : public DoHCurlClientInterface {
     int request_id;
   };
 
+  // Initialize the CURL multi handle |curlm_|.
+  void InitCurlMulti();
+
+  // Drop the connections to the DoH providers. If queries are in-flight, the
+  // connections are dropped once they are done, and the queries made in the
+  // meantime open new connections.
+  void ResetConnections();
+
+  // Run the reset deferred by `ResetConnections()` if no query is in-flight
+  // anymore.
+  void OnQueriesDone();
+
+  // Open connections to the DoH providers ahead of the queries by sending an
+  // independent query to each of them. Does nothing while a reset is pending.
+  void WarmUp();
+
+  // Send DNS query |msg| of size |len| concurrently to the first
+  // |max_concurrent_queries_| of |doh_providers|, as a single request whose
+  // first successful response is passed to |callback|.
+  bool StartRequest(const std::vector<std::string>& doh_providers,
+                    const char* msg,
+                    int len,
+                    const QueryCallback& callback,
+                    void* ctx);
+
+  // Callback of the query sent by `WarmUp()`, the response is ignored.
+  void OnWarmUpDone(void* ctx,
+                    const CurlResult& res,
+                    unsigned char* msg,
+                    size_t len);
+
   // Initialize CURL handle to resolve wire-format data |data| of length |len|.
   // This is done by querying DoH provider |doh_provider|.
   // A state containing the CURL handle will be allocated and used to store
@@ -260,6 +300,10 @@ class DoHCurlClient : public DoHCurlClientInterface {
   // CURL multi handle to do asynchronous requests.
   CURLM* curlm_;
 
+  // Whether the connections must be dropped once the in-flight queries are
+  // done.
+  bool reset_pending_ = false;
+
   base::WeakPtrFactory<DoHCurlClient> weak_factory_{this};
 };
 }  // namespace dns_proxy
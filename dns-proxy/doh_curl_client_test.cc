@@ -0,0 +1,263 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "dns-proxy/doh_curl_client.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <base/check.h>
+#include <base/check_op.h>
+#include <base/files/file_descriptor_watcher_posix.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/run_loop.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_util.h>
+#include <base/strings/stringprintf.h>
+#include <base/test/bind.h>
+#include <base/test/task_environment.h>
+#include <base/threading/thread_task_runner_handle.h>
+#include <base/time/time.h>
+#include <gtest/gtest.h>
+
+namespace dns_proxy {
+namespace {
+constexpr base::TimeDelta kTimeout = base::Seconds(30);
+const std::vector<std::string> kTestNameServers{"8.8.8.8"};
+const std::vector<std::string> kOtherTestNameServers{"8.8.4.4"};
+// Wire-format query of type A for "a.".
+constexpr char kQuery[] = {'\x12', '\x34', '\x01', '\x00', '\x00', '\x01',
+                           '\x00', '\x00', '\x00', '\x00', '\x00', '\x00',
+                           '\x01', 'a',    '\x00', '\x00', '\x01', '\x00',
+                           '\x01'};
+constexpr char kResponse[] = "response";
+
+// Runs the loop until |fd| is readable.
+void WaitForReadable(int fd) {
+  base::RunLoop run_loop;
+  auto watcher =
+      base::FileDescriptorWatcher::WatchReadable(fd, run_loop.QuitClosure());
+  run_loop.Run();
+}
+
+// Reads an HTTP request from |fd| and returns its body.
+std::string ReadRequest(int fd) {
+  std::string request;
+  while (true) {
+    WaitForReadable(fd);
+    char buffer[4096];
+    ssize_t len = HANDLE_EINTR(read(fd, buffer, sizeof(buffer)));
+    if (len <= 0) {
+      ADD_FAILURE() << "Connection closed before the end of the request";
+      return "";
+    }
+    request.append(buffer, len);
+
+    const size_t headers_end = request.find("\r\n\r\n");
+    if (headers_end == std::string::npos) {
+      continue;
+    }
+    const std::string headers =
+        base::ToLowerASCII(request.substr(0, headers_end));
+    const size_t length_start = headers.find("content-length:");
+    size_t body_len = 0;
+    if (length_start != std::string::npos) {
+      const size_t value_start = length_start + strlen("content-length:");
+      const size_t value_end = headers.find("\r\n", value_start);
+      const std::string value =
+          headers.substr(value_start, value_end - value_start);
+      EXPECT_TRUE(base::StringToSizeT(
+          base::TrimWhitespaceASCII(value, base::TRIM_ALL), &body_len));
+    }
+    const size_t body_start = headers_end + strlen("\r\n\r\n");
+    if (request.size() >= body_start + body_len) {
+      return request.substr(body_start, body_len);
+    }
+  }
+}
+
+// Writes an HTTP response of body |body| to |fd|.
+void SendResponse(int fd, const std::string& body) {
+  const std::string response = base::StringPrintf(
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: application/dns-message\r\n"
+      "Content-Length: %zu\r\n\r\n%s",
+      body.size(), body.c_str());
+  ASSERT_TRUE(base::WriteFileDescriptor(fd, response));
+}
+
+// Runs the loop until the peer of |fd| closes the connection.
+void WaitForClosed(int fd) {
+  WaitForReadable(fd);
+  char buffer[1];
+  EXPECT_EQ(HANDLE_EINTR(read(fd, buffer, sizeof(buffer))), 0);
+}
+
+// Runs the loop until |client| has at most |count| queries in flight.
+void WaitForInFlightQueries(const DoHCurlClient& client, size_t count) {
+  while (client.GetNumInFlightQueriesForTesting() > count) {
+    base::RunLoop run_loop;
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE, run_loop.QuitClosure(), base::Milliseconds(10));
+    run_loop.Run();
+  }
+  EXPECT_EQ(client.GetNumInFlightQueriesForTesting(), count);
+}
+
+// Plain HTTP DoH provider listening on the loopback interface. Its URL holds
+// an IP address, so no name resolution is needed to reach it.
+class FakeDoHProvider {
+ public:
+  FakeDoHProvider() {
+    listen_fd_.reset(socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    CHECK(listen_fd_.is_valid());
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    CHECK_EQ(bind(listen_fd_.get(), reinterpret_cast<sockaddr*>(&addr),
+                  addr_len),
+             0);
+    CHECK_EQ(listen(listen_fd_.get(), SOMAXCONN), 0);
+    CHECK_EQ(getsockname(listen_fd_.get(), reinterpret_cast<sockaddr*>(&addr),
+                         &addr_len),
+             0);
+    url_ = base::StringPrintf("http://127.0.0.1:%d/dns-query",
+                              ntohs(addr.sin_port));
+  }
+  FakeDoHProvider(const FakeDoHProvider&) = delete;
+  FakeDoHProvider& operator=(const FakeDoHProvider&) = delete;
+
+  const std::string& url() const { return url_; }
+
+  // Waits for a new connection from the client and returns it.
+  base::ScopedFD Accept() {
+    WaitForReadable(listen_fd_.get());
+    base::ScopedFD fd(HANDLE_EINTR(
+        accept4(listen_fd_.get(), nullptr, nullptr, SOCK_CLOEXEC)));
+    EXPECT_TRUE(fd.is_valid());
+    return fd;
+  }
+
+ private:
+  base::ScopedFD listen_fd_;
+  std::string url_;
+};
+
+class DoHCurlClientTest : public testing::Test {
+ protected:
+  base::test::TaskEnvironment task_environment_{
+      base::test::TaskEnvironment::MainThreadType::IO};
+};
+
+// Test that every DoH provider is warmed up by its own query, which isn't
+// cancelled by the response of another provider.
+TEST_F(DoHCurlClientTest, WarmUpQueriesEachProvider) {
+  FakeDoHProvider provider1;
+  FakeDoHProvider provider2;
+  DoHCurlClient client(kTimeout, /*max_concurrent_queries=*/1);
+
+  client.SetNameServers(kTestNameServers);
+  client.SetDoHProviders({provider1.url(), provider2.url()});
+  base::ScopedFD connection1 = provider1.Accept();
+  base::ScopedFD connection2 = provider2.Accept();
+  ReadRequest(connection1.get());
+  ReadRequest(connection2.get());
+  EXPECT_EQ(client.GetNumInFlightQueriesForTesting(), 2u);
+
+  SendResponse(connection1.get(), kResponse);
+  WaitForInFlightQueries(client, 1);
+  SendResponse(connection2.get(), kResponse);
+  WaitForInFlightQueries(client, 0);
+}
+
+// Result of a query sent by `Resolve(...)`.
+struct QueryResult {
+  CURLcode curl_code = CURLE_FAILED_INIT;
+  int64_t http_code = 0;
+  std::string response;
+};
+
+// Sends |kQuery| through |client|, and quits |run_loop| once |result| holds
+// its result.
+bool Resolve(DoHCurlClient* client,
+             base::RunLoop* run_loop,
+             QueryResult* result) {
+  return client->Resolve(
+      kQuery, sizeof(kQuery),
+      base::BindLambdaForTesting([run_loop, result](
+                                     void* ctx,
+                                     const DoHCurlClient::CurlResult& res,
+                                     unsigned char* msg, size_t len) {
+        result->curl_code = res.curl_code;
+        result->http_code = res.http_code;
+        result->response.assign(reinterpret_cast<char*>(msg), len);
+        run_loop->Quit();
+      }),
+      nullptr /* ctx */);
+}
+
+// Test that a change of name servers doesn't abort the in-flight queries, and
+// that the connections are dropped and warmed up again once they are done.
+TEST_F(DoHCurlClientTest, ResetConnectionsAfterInFlightQueries) {
+  FakeDoHProvider provider;
+  DoHCurlClient client(kTimeout, /*max_concurrent_queries=*/1);
+  client.SetNameServers(kTestNameServers);
+  client.SetDoHProviders({provider.url()});
+  base::ScopedFD connection = provider.Accept();
+  ReadRequest(connection.get());
+  SendResponse(connection.get(), kResponse);
+  WaitForInFlightQueries(client, 0);
+
+  // The query is sent on the warmed up connection.
+  base::RunLoop run_loop;
+  QueryResult result;
+  ASSERT_TRUE(Resolve(&client, &run_loop, &result));
+  EXPECT_EQ(ReadRequest(connection.get()),
+            std::string(kQuery, sizeof(kQuery)));
+
+  // The warm-up for the new name servers waits for the reset, which would drop
+  // its connections.
+  client.SetNameServers(kOtherTestNameServers);
+  EXPECT_EQ(client.GetNumInFlightQueriesForTesting(), 1u);
+
+  // A query sent in the meantime doesn't reuse the connection opened before
+  // the change, while the query in flight keeps it.
+  base::RunLoop other_run_loop;
+  QueryResult other_result;
+  ASSERT_TRUE(Resolve(&client, &other_run_loop, &other_result));
+  base::ScopedFD new_connection = provider.Accept();
+  EXPECT_EQ(ReadRequest(new_connection.get()),
+            std::string(kQuery, sizeof(kQuery)));
+  SendResponse(connection.get(), kResponse);
+  run_loop.Run();
+  EXPECT_EQ(result.curl_code, CURLE_OK);
+  EXPECT_EQ(result.http_code, kHTTPOk);
+  EXPECT_EQ(result.response, kResponse);
+
+  // Once no query is in flight anymore, the connections are dropped and the
+  // provider is warmed up once.
+  SendResponse(new_connection.get(), kResponse);
+  other_run_loop.Run();
+  EXPECT_EQ(other_result.curl_code, CURLE_OK);
+  EXPECT_EQ(other_result.response, kResponse);
+  WaitForClosed(connection.get());
+  WaitForClosed(new_connection.get());
+  base::ScopedFD reopened_connection = provider.Accept();
+  ReadRequest(reopened_connection.get());
+  EXPECT_EQ(client.GetNumInFlightQueriesForTesting(), 1u);
+  SendResponse(reopened_connection.get(), kResponse);
+  WaitForInFlightQueries(client, 0);
+}
+
+}  // namespace
+}  // namespace dns_proxy
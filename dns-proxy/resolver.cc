@@ -6,6 +6,7 @@
 
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/logging.h>
@@ -100,7 +101,7 @@ Metrics::QueryError CurlCodeMetric(int code) {
 }  // namespace
 
 Resolver::SocketFd::SocketFd(int type, int fd)
-    : type(type), fd(fd), num_retries(0) {
+    : type(type), fd(fd), num_retries(0), prefetch(false) {
   if (type == SOCK_STREAM) {
     socklen = 0;
     return;
@@ -128,16 +129,19 @@ Resolver::Resolver(base::TimeDelta timeout,
       ares_client_(
           new AresClient(timeout, max_num_retries, max_concurrent_queries)),
       curl_client_(new DoHCurlClient(timeout, max_concurrent_queries)),
-      metrics_(new Metrics) {}
+      metrics_(new Metrics),
+      cache_(std::make_unique<DnsCache>()) {}
 
 Resolver::Resolver(std::unique_ptr<AresClient> ares_client,
                    std::unique_ptr<DoHCurlClientInterface> curl_client,
-                   std::unique_ptr<Metrics> metrics)
+                   std::unique_ptr<Metrics> metrics,
+                   std::unique_ptr<DnsCache> cache)
     : always_on_doh_(false),
       doh_enabled_(false),
       ares_client_(std::move(ares_client)),
       curl_client_(std::move(curl_client)),
-      metrics_(std::move(metrics)) {}
+      metrics_(std::move(metrics)),
+      cache_(cache ? std::move(cache) : std::make_unique<DnsCache>()) {}
 
 bool Resolver::ListenTCP(struct sockaddr* addr) {
   auto tcp_src = std::make_unique<patchpanel::Socket>(
@@ -216,6 +220,7 @@ void Resolver::HandleAresResult(void* ctx,
     LOG(ERROR) << "Failed to do ares lookup: " << ares_strerror(status);
     return;
   }
+  cache_->Put(sock_fd->msg, sock_fd->len, msg, len);
   ReplyDNS(sock_fd.get(), msg, len);
 }
 
@@ -246,6 +251,7 @@ void Resolver::HandleCurlResult(void* ctx,
 
   switch (res.http_code) {
     case kHTTPOk: {
+      cache_->Put(sock_fd->msg, sock_fd->len, msg, len);
       ReplyDNS(sock_fd, msg, len);
       delete sock_fd;
       return;
@@ -290,6 +296,10 @@ void Resolver::HandleCurlResult(void* ctx,
 }
 
 void Resolver::ReplyDNS(SocketFd* sock_fd, unsigned char* msg, size_t len) {
+  // Prefetch queries are not associated with any client.
+  if (sock_fd->prefetch)
+    return;
+
   sock_fd->timer.StartReply();
   // For TCP, DNS messages have an additional 2-bytes header representing
   // the length of the query. Add the additional header for the reply.
@@ -323,13 +333,54 @@ void Resolver::ReplyDNS(SocketFd* sock_fd, unsigned char* msg, size_t len) {
   }
 }
 
+bool Resolver::ReplyFromCache(SocketFd* sock_fd) {
+  std::vector<char> response;
+  const DnsCache::LookupResult result =
+      cache_->Lookup(sock_fd->msg, sock_fd->len, &response);
+  if (metrics_) {
+    switch (result) {
+      case DnsCache::LookupResult::kMiss:
+        metrics_->RecordCacheResult(Metrics::CacheResult::kMiss);
+        break;
+      case DnsCache::LookupResult::kHit:
+        metrics_->RecordCacheResult(Metrics::CacheResult::kHit);
+        break;
+      case DnsCache::LookupResult::kHitPrefetch:
+        metrics_->RecordCacheResult(Metrics::CacheResult::kHitPrefetch);
+        break;
+    }
+  }
+
+  if (result == DnsCache::LookupResult::kMiss)
+    return false;
+
+  ReplyDNS(sock_fd, reinterpret_cast<unsigned char*>(response.data()),
+           response.size());
+  if (result == DnsCache::LookupResult::kHitPrefetch)
+    Prefetch(*sock_fd);
+  return true;
+}
+
+void Resolver::Prefetch(const SocketFd& sock_fd) {
+  // |prefetch_fd| is freed once the query is done, the same way as queries
+  // from clients.
+  SocketFd* prefetch_fd = new SocketFd(sock_fd.type, -1 /* fd */);
+  prefetch_fd->prefetch = true;
+  prefetch_fd->msg = prefetch_fd->buf;
+  prefetch_fd->len = sock_fd.len;
+  memcpy(prefetch_fd->msg, sock_fd.msg, sock_fd.len);
+  Resolve(prefetch_fd);
+}
+
 void Resolver::SetNameServers(const std::vector<std::string>& name_servers) {
+  cache_->Clear();
   ares_client_->SetNameServers(name_servers);
   curl_client_->SetNameServers(name_servers);
 }
 
 void Resolver::SetDoHProviders(const std::vector<std::string>& doh_providers,
                                bool always_on_doh) {
+  cache_->Clear();
   always_on_doh_ = always_on_doh;
   doh_enabled_ = !doh_providers.empty();
   curl_client_->SetDoHProviders(doh_providers);
@@ -387,6 +438,11 @@ void Resolver::OnDNSQuery(int fd, int type) {
     sock_fd->len -= 2;
   }
 
+  if (ReplyFromCache(sock_fd)) {
+    delete sock_fd;
+    return;
+  }
+
   Resolve(sock_fd);
 }
 
@@ -17,6 +17,7 @@
 #include <chromeos/patchpanel/socket.h>
 
 #include "dns-proxy/ares_client.h"
+#include "dns-proxy/dns_cache.h"
 #include "dns-proxy/doh_curl_client.h"
 #include "dns-proxy/metrics.h"
 
@@ -42,6 +43,10 @@ constexpr int kDefaultMaxConcurrentQueries = 3;
 // are final. In the case of latter, if DNS over HTTP fails, it will fall back
 // to standard plain-text DNS.
 //
+// Successful responses are cached in |cache_| and used to answer subsequent
+// queries for the same question until their TTL expires. The cache is flushed
+// whenever the name servers or the DoH providers change.
+//
 // Resolver listens on UDP and TCP port 53.
 class Resolver {
  public:
@@ -76,6 +81,11 @@ class Resolver {
     // a certain threshold.
     int num_retries;
 
+    // Set for queries refreshing a cached response before it expires. The
+    // response of such queries is only used to update the cache and is not
+    // sent to any client.
+    bool prefetch;
+
     // Records timings for metrics.
     Metrics::QueryTimer timer;
   };
@@ -84,10 +94,11 @@ class Resolver {
            base::TimeDelta retry_delay,
            int max_num_retries,
            int max_concurrent_queries = kDefaultMaxConcurrentQueries);
-  // Provided for testing only.
+  // Provided for testing only. A default cache is used if |cache| is null.
   Resolver(std::unique_ptr<AresClient> ares_client,
            std::unique_ptr<DoHCurlClientInterface> curl_client,
-           std::unique_ptr<Metrics> metrics = nullptr);
+           std::unique_ptr<Metrics> metrics = nullptr,
+           std::unique_ptr<DnsCache> cache = nullptr);
   virtual ~Resolver() = default;
 
   // Listen on an incoming DNS query on address |addr| for UDP and TCP.
@@ -137,6 +148,8 @@ class Resolver {
   patchpanel::DnsResponse ConstructServFailResponse(const char* msg, int len);
 
  private:
+  friend class ResolverTest;
+
   // |TCPConnection| is used to track and terminate TCP connections.
   struct TCPConnection {
     TCPConnection(std::unique_ptr<patchpanel::Socket> sock,
@@ -156,6 +169,14 @@ class Resolver {
   // Send back data taken from CURL or Ares to the client.
   void ReplyDNS(SocketFd* sock_fd, unsigned char* msg, size_t len);
 
+  // Reply to the query of |sock_fd| using |cache_|. Returns false if there is
+  // no cached response for the query.
+  bool ReplyFromCache(SocketFd* sock_fd);
+
+  // Query the name servers again for the query of |sock_fd| in order to
+  // refresh its cached response.
+  void Prefetch(const SocketFd& sock_fd);
+
   // Disallow DoH fallback to standard plain-text DNS.
   bool always_on_doh_;
 
@@ -187,6 +208,9 @@ class Resolver {
 
   std::unique_ptr<Metrics> metrics_;
 
+  // Cache of successful responses shared by DoH and plain-text DNS.
+  std::unique_ptr<DnsCache> cache_;
+
   base::WeakPtrFactory<Resolver> weak_factory_{this};
 };
 }  // namespace dns_proxy
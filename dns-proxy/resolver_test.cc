@@ -4,20 +4,30 @@
 
 #include "dns-proxy/resolver.h"
 
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <memory>
 #include <utility>
 #include <vector>
 
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/test/simple_test_tick_clock.h>
 #include <base/test/task_environment.h>
 #include <base/time/time.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
 #include "dns-proxy/ares_client.h"
+#include "dns-proxy/dns_cache.h"
 #include "dns-proxy/doh_curl_client.h"
 
 using testing::_;
+using testing::DoAll;
 using testing::ElementsAreArray;
 using testing::Return;
+using testing::SaveArg;
 
 namespace dns_proxy {
 namespace {
@@ -27,6 +37,50 @@ const std::vector<std::string> kTestDoHProviders{
 constexpr base::TimeDelta kTimeout = base::Seconds(3);
 constexpr int32_t kMaxNumRetries = 1;
 
+// Query of type A for "google.com" with ID "JG".
+const char kQuery[] = {'J',    'G',    '\x01', ' ',    '\x00', '\x01',
+                       '\x00', '\x00', '\x00', '\x00', '\x00', '\x00',
+                       '\x06', 'g',    'o',    'o',    'g',    'l',
+                       'e',    '\x03', 'c',    'o',    'm',    '\x00',
+                       '\x00', '\x01', '\x00', '\x01'};
+
+// Same as |kQuery| with ID "AB" and a different case.
+const char kQueryOtherCase[] = {'A',    'B',    '\x01', ' ',    '\x00', '\x01',
+                                '\x00', '\x00', '\x00', '\x00', '\x00', '\x00',
+                                '\x06', 'G',    'o',    'O',    'g',    'L',
+                                'e',    '\x03', 'C',    'O',    'M',    '\x00',
+                                '\x00', '\x01', '\x00', '\x01'};
+
+// Response to |kQuery| with a single A record with a TTL of 60 seconds.
+const unsigned char kResponse[] = {
+    'J',  'G',  0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03, 'c',  'o',
+    'm',  0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x3c, 0x00, 0x04, 0x08, 0x08, 0x08, 0x08};
+
+// |kResponse| as served for |kQueryOtherCase| after 10 seconds.
+const unsigned char kCachedResponse[] = {
+    'A',  'B',  0x81, 0x80, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03, 'c',  'o',
+    'm',  0x00, 0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x01, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x32, 0x00, 0x04, 0x08, 0x08, 0x08, 0x08};
+
+// NXDOMAIN response to |kQuery| with a SOA record with a TTL of 3600 seconds
+// and a MINIMUM of 300 seconds.
+const unsigned char kNxDomainResponse[] = {
+    'J',  'G',  0x81, 0x83, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00,
+    0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03, 'c',  'o',  'm',  0x00,
+    0x00, 0x01, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00,
+    0x0e, 0x10, 0x00, 0x1a, 0x01, 'a',  0x00, 0x01, 'b',  0x00, 0x00, 0x00,
+    0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00,
+    0x00, 0x04, 0x00, 0x00, 0x01, 0x2c};
+
+// SERVFAIL response to |kQuery|.
+const unsigned char kServFailQueryResponse[] = {
+    'J',  'G',  0x81, 0x82, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x06, 'g',  'o',  'o',  'g',  'l',  'e',  0x03,
+    'c',  'o',  'm',  0x00, 0x00, 0x01, 0x00, 0x01};
+
 class MockDoHCurlClient : public DoHCurlClient {
  public:
   MockDoHCurlClient() : DoHCurlClient(kTimeout, kDefaultMaxConcurrentQueries) {}
@@ -68,12 +122,55 @@ class ResolverTest : public testing::Test {
         new MockDoHCurlClient());
     ares_client_ = scoped_ares_client.get();
     curl_client_ = scoped_curl_client.get();
-    resolver_ = std::make_unique<Resolver>(std::move(scoped_ares_client),
-                                           std::move(scoped_curl_client));
+    clock_.SetNowTicks(base::TimeTicks::Now());
+    resolver_ = std::make_unique<Resolver>(
+        std::move(scoped_ares_client), std::move(scoped_curl_client),
+        nullptr /* metrics */,
+        std::make_unique<DnsCache>(kDefaultMaxCacheEntries, &clock_));
+
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    client_fd_.reset(fds[0]);
+    server_fd_.reset(fds[1]);
+  }
+
+  // Sends the wire-format DNS query |msg| of length |len| to the resolver
+  // through |client_fd_| as a TCP client would.
+  void Query(const char* msg, size_t len) {
+    const uint16_t dns_len = htons(len);
+    ASSERT_TRUE(base::WriteFileDescriptor(
+        client_fd_.get(),
+        base::StringPiece(reinterpret_cast<const char*>(&dns_len), 2)));
+    ASSERT_TRUE(base::WriteFileDescriptor(client_fd_.get(),
+                                          base::StringPiece(msg, len)));
+    resolver_->OnDNSQuery(server_fd_.get(), SOCK_STREAM);
+  }
+
+  // Answers the ares query of context |ctx| with |response| of length |len|.
+  void ReplyFromAres(void* ctx, const unsigned char* response, size_t len) {
+    std::vector<unsigned char> msg(response, response + len);
+    resolver_->HandleAresResult(ctx, ARES_SUCCESS, msg.data(), msg.size());
+  }
+
+  // Returns the reply received by |client_fd_|, or an empty vector if there
+  // is none.
+  std::vector<char> ReadReply() {
+    uint16_t dns_len = 0;
+    if (!base::ReadFromFD(client_fd_.get(), reinterpret_cast<char*>(&dns_len),
+                          sizeof(dns_len))) {
+      return {};
+    }
+    std::vector<char> reply(ntohs(dns_len));
+    if (!base::ReadFromFD(client_fd_.get(), reply.data(), reply.size()))
+      return {};
+    return reply;
   }
 
   base::test::TaskEnvironment task_environment_;
 
+  base::SimpleTestTickClock clock_;
+  base::ScopedFD client_fd_;
+  base::ScopedFD server_fd_;
   MockAresClient* ares_client_;
   MockDoHCurlClient* curl_client_;
   std::unique_ptr<Resolver> resolver_;
@@ -266,4 +363,112 @@ TEST_F(ResolverTest, ConstructServFailResponse_BadQuery) {
       response.io_buffer()->data() + response.io_buffer_size());
   EXPECT_THAT(response_data, ElementsAreArray(kServFailResponse));
 }
+
+TEST_F(ResolverTest, Cache_Hit) {
+  void* ctx = nullptr;
+  EXPECT_CALL(*ares_client_, Resolve(_, _, _, _))
+      .WillOnce(DoAll(SaveArg<3>(&ctx), Return(true)));
+
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kResponse, sizeof(kResponse));
+  EXPECT_THAT(ReadReply(),
+              ElementsAreArray(reinterpret_cast<const char*>(kResponse),
+                               sizeof(kResponse)));
+
+  // The same question is answered from the cache with the ID of the query and
+  // the TTL decreased by the time spent in the cache.
+  clock_.Advance(base::Seconds(10));
+  Query(kQueryOtherCase, sizeof(kQueryOtherCase));
+  EXPECT_THAT(ReadReply(),
+              ElementsAreArray(reinterpret_cast<const char*>(kCachedResponse),
+                               sizeof(kCachedResponse)));
+}
+
+TEST_F(ResolverTest, Cache_Expired) {
+  void* ctx = nullptr;
+  EXPECT_CALL(*ares_client_, Resolve(_, _, _, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SaveArg<3>(&ctx), Return(true)));
+
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kResponse, sizeof(kResponse));
+  EXPECT_FALSE(ReadReply().empty());
+
+  // Once the TTL of the response expired, the name servers are queried again.
+  clock_.Advance(base::Seconds(60));
+  ctx = nullptr;
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  EXPECT_TRUE(ReadReply().empty());
+  ReplyFromAres(ctx, kResponse, sizeof(kResponse));
+  EXPECT_THAT(ReadReply(),
+              ElementsAreArray(reinterpret_cast<const char*>(kResponse),
+                               sizeof(kResponse)));
+}
+
+TEST_F(ResolverTest, Cache_NegativeResponse) {
+  void* ctx = nullptr;
+  EXPECT_CALL(*ares_client_, Resolve(_, _, _, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SaveArg<3>(&ctx), Return(true)));
+
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kNxDomainResponse, sizeof(kNxDomainResponse));
+  EXPECT_FALSE(ReadReply().empty());
+
+  // NXDOMAIN is answered from the cache for the MINIMUM of the SOA record.
+  clock_.Advance(base::Seconds(299));
+  ctx = nullptr;
+  Query(kQuery, sizeof(kQuery));
+  EXPECT_EQ(ctx, nullptr);
+  const std::vector<char> reply = ReadReply();
+  ASSERT_EQ(reply.size(), sizeof(kNxDomainResponse));
+  EXPECT_EQ(reply[3] & 0x0f, 3 /* NXDOMAIN */);
+
+  clock_.Advance(base::Seconds(1));
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kNxDomainResponse, sizeof(kNxDomainResponse));
+}
+
+TEST_F(ResolverTest, Cache_ServFailNotCached) {
+  void* ctx = nullptr;
+  EXPECT_CALL(*ares_client_, Resolve(_, _, _, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SaveArg<3>(&ctx), Return(true)));
+
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kServFailQueryResponse, sizeof(kServFailQueryResponse));
+  EXPECT_THAT(
+      ReadReply(),
+      ElementsAreArray(reinterpret_cast<const char*>(kServFailQueryResponse),
+                       sizeof(kServFailQueryResponse)));
+
+  ctx = nullptr;
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kResponse, sizeof(kResponse));
+}
+
+TEST_F(ResolverTest, Cache_ClearedOnNameServersChange) {
+  void* ctx = nullptr;
+  EXPECT_CALL(*ares_client_, Resolve(_, _, _, _))
+      .Times(2)
+      .WillRepeatedly(DoAll(SaveArg<3>(&ctx), Return(true)));
+
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kResponse, sizeof(kResponse));
+  EXPECT_FALSE(ReadReply().empty());
+
+  resolver_->SetNameServers(kTestNameServers);
+  ctx = nullptr;
+  Query(kQuery, sizeof(kQuery));
+  ASSERT_NE(ctx, nullptr);
+  ReplyFromAres(ctx, kResponse, sizeof(kResponse));
+}
 }  // namespace dns_proxy
@@ -0,0 +1,165 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "hardware_verifier/component_fingerprinter.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <base/files/file_enumerator.h>
+#include <base/files/file_util.h>
+#include <base/hash/sha1.h>
+#include <base/logging.h>
+#include <base/no_destructor.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+
+namespace hardware_verifier {
+
+namespace {
+
+// The identity files are small, EDIDs being the largest.
+constexpr size_t kMaxIdentityFileSize = 64 * 1024;
+
+constexpr char kLsbReleasePath[] = "etc/lsb-release";
+
+// Identity files of network devices, shared by all network categories.
+#define NETWORK_IDENTITY_PATTERNS                                 \
+  "sys/class/net/*/device/vendor", "sys/class/net/*/device/device", \
+      "sys/class/net/*/device/modalias"
+
+// Patterns of the identity files of the components of each category, relative
+// to the root. Wildcards only match within a single path component. The file
+// paths are not part of the fingerprints, so
+// the device numbering may change across boots.
+//
+// The identity files must be readable by hardware_verifier, which doesn't run
+// as root: e.g. the SMBIOS memory records of |dram| are root-only, and ARM
+// devices don't have any, so |dram| isn't fingerprinted.
+struct FingerprintRule {
+  const char* category;
+  std::vector<const char*> patterns;
+};
+
+const std::vector<FingerprintRule>& GetFingerprintRules() {
+  static const base::NoDestructor<std::vector<FingerprintRule>> rules({
+      {"battery",
+       {"sys/class/power_supply/*/manufacturer",
+        "sys/class/power_supply/*/model_name",
+        "sys/class/power_supply/*/technology"}},
+      {"storage",
+       {"sys/block/*/device/vendor", "sys/block/*/device/model",
+        "sys/block/*/device/name", "sys/block/*/device/cid",
+        "sys/block/*/device/device/vendor",
+        "sys/block/*/device/device/device"}},
+      {"vpd_cached", {"sys/firmware/vpd/ro/*"}},
+      {"camera",
+       {"sys/class/video4linux/*/name",
+        "sys/class/video4linux/*/device/modalias"}},
+      {"stylus",
+       {"sys/class/input/input*/name", "sys/class/input/input*/modalias"}},
+      {"touchpad",
+       {"sys/class/input/input*/name", "sys/class/input/input*/modalias"}},
+      {"touchscreen",
+       {"sys/class/input/input*/name", "sys/class/input/input*/modalias"}},
+      {"display_panel", {"sys/class/drm/*/edid"}},
+      // HDA codecs, and the I2C devices of ASoC codecs.
+      {"audio_codec",
+       {"sys/class/sound/hwC*D*/vendor_id",
+        "sys/class/sound/hwC*D*/subsystem_id", "sys/bus/i2c/devices/*/name"}},
+      {"cellular", {NETWORK_IDENTITY_PATTERNS}},
+      {"ethernet", {NETWORK_IDENTITY_PATTERNS}},
+      {"wireless", {NETWORK_IDENTITY_PATTERNS}},
+  });
+  return *rules;
+}
+
+#undef NETWORK_IDENTITY_PATTERNS
+
+// Appends the paths matching |components|, starting at |index|, under |dir|
+// to |paths|.
+void ExpandPattern(const base::FilePath& dir,
+                   const std::vector<std::string>& components,
+                   size_t index,
+                   std::vector<base::FilePath>* paths) {
+  if (index == components.size()) {
+    paths->push_back(dir);
+    return;
+  }
+  const std::string& component = components[index];
+  if (component.find_first_of("*?") == std::string::npos) {
+    ExpandPattern(dir.Append(component), components, index + 1, paths);
+    return;
+  }
+  base::FileEnumerator enumerator(
+      dir, /*recursive=*/false,
+      base::FileEnumerator::FILES | base::FileEnumerator::DIRECTORIES,
+      component);
+  for (auto path = enumerator.Next(); !path.empty(); path = enumerator.Next())
+    ExpandPattern(path, components, index + 1, paths);
+}
+
+std::string HashEntries(std::vector<std::string>* entries) {
+  std::sort(entries->begin(), entries->end());
+  std::string content;
+  for (const auto& entry : *entries) {
+    content += entry;
+    content.push_back('\0');
+  }
+  const std::string hash = base::SHA1HashString(content);
+  return base::HexEncode(hash.data(), hash.size());
+}
+
+}  // namespace
+
+ComponentFingerprinter::ComponentFingerprinter(const base::FilePath& root)
+    : root_(root) {}
+
+std::map<std::string, std::string>
+ComponentFingerprinter::GetCategoryFingerprints() const {
+  std::map<std::string, std::string> fingerprints;
+  for (const auto& rule : GetFingerprintRules()) {
+    std::vector<std::string> entries;
+    bool readable = true;
+    for (const char* pattern : rule.patterns) {
+      const std::vector<std::string> components = base::SplitString(
+          pattern, "/", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+      std::vector<base::FilePath> paths;
+      ExpandPattern(root_, components, 0, &paths);
+      for (const auto& path : paths) {
+        std::string content;
+        if (base::ReadFileToStringWithMaxSize(path, &content,
+                                              kMaxIdentityFileSize)) {
+          entries.push_back(std::string(pattern) + "=" + content);
+        } else if (base::PathExists(path)) {
+          // A component we can't identify might have changed.
+          VLOG(1) << "Failed to read " << path.value();
+          readable = false;
+        }
+        // Otherwise the component doesn't have this attribute, e.g. the CID
+        // of a non-MMC disk.
+      }
+    }
+    if (!readable) {
+      VLOG(1) << "The category " << rule.category
+              << " can't be fingerprinted.";
+      continue;
+    }
+    VLOG(2) << "Read " << entries.size() << " identities of " << rule.category;
+    fingerprints[rule.category] = HashEntries(&entries);
+  }
+  return fingerprints;
+}
+
+std::string ComponentFingerprinter::GetSystemFingerprint() const {
+  std::string lsb_release;
+  if (!base::ReadFileToString(root_.Append(kLsbReleasePath), &lsb_release))
+    LOG(WARNING) << "Failed to read " << kLsbReleasePath;
+  std::vector<std::string> entries{lsb_release};
+  return HashEntries(&entries);
+}
+
+}  // namespace hardware_verifier
@@ -0,0 +1,44 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#ifndef HARDWARE_VERIFIER_COMPONENT_FINGERPRINTER_H_
+#define HARDWARE_VERIFIER_COMPONENT_FINGERPRINTER_H_
+
+#include <map>
+#include <string>
+
+#include <base/files/file_path.h>
+
+namespace hardware_verifier {
+
+// Computes fingerprints of the components of each category from the device
+// identities exposed by sysfs (IDs, model names, EDIDs, ...). Reading them is
+// much cheaper than probing the components, and a category whose fingerprint
+// didn't change doesn't need to be probed again.
+class ComponentFingerprinter {
+ public:
+  // |root| is the root of the paths read, which is only changed in tests.
+  explicit ComponentFingerprinter(
+      const base::FilePath& root = base::FilePath("/"));
+  ComponentFingerprinter(const ComponentFingerprinter&) = delete;
+  ComponentFingerprinter& operator=(const ComponentFingerprinter&) = delete;
+
+  // Returns the fingerprint of each category which can be fingerprinted, keyed
+  // by the name of the category in |runtime_probe::ProbeResult|. A category is
+  // left out if one of its identity files exists but can't be read, and must
+  // then be probed again.
+  std::map<std::string, std::string> GetCategoryFingerprints() const;
+
+  // Returns a fingerprint of the OS image. The probe config ships with the OS
+  // so the probe results can't be reused across OS updates.
+  std::string GetSystemFingerprint() const;
+
+ private:
+  const base::FilePath root_;
+};
+
+}  // namespace hardware_verifier
+
+#endif  // HARDWARE_VERIFIER_COMPONENT_FINGERPRINTER_H_
@@ -0,0 +1,89 @@
+/* Copyright 2022 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include <map>
+#include <string>
+
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <gtest/gtest.h>
+
+#include "hardware_verifier/component_fingerprinter.h"
+
+namespace hardware_verifier {
+
+class TestComponentFingerprinter : public testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  void WriteFile(const std::string& path, const std::string& content) {
+    const auto file_path = temp_dir_.GetPath().Append(path);
+    ASSERT_TRUE(base::CreateDirectory(file_path.DirName()));
+    ASSERT_TRUE(base::WriteFile(file_path, content));
+  }
+
+  std::map<std::string, std::string> GetCategoryFingerprints() {
+    return ComponentFingerprinter(temp_dir_.GetPath())
+        .GetCategoryFingerprints();
+  }
+
+  base::ScopedTempDir temp_dir_;
+};
+
+TEST_F(TestComponentFingerprinter, TestOnlyChangedCategoryDiffers) {
+  WriteFile("sys/class/power_supply/BAT0/model_name", "model_1");
+  WriteFile("sys/class/drm/card0-eDP-1/edid", "edid_1");
+  const auto fingerprints = GetCategoryFingerprints();
+  EXPECT_TRUE(fingerprints.count("battery"));
+  EXPECT_TRUE(fingerprints.count("display_panel"));
+
+  WriteFile("sys/class/drm/card0-eDP-1/edid", "edid_2");
+  const auto new_fingerprints = GetCategoryFingerprints();
+  EXPECT_EQ(fingerprints.at("battery"), new_fingerprints.at("battery"));
+  EXPECT_NE(fingerprints.at("display_panel"),
+            new_fingerprints.at("display_panel"));
+}
+
+TEST_F(TestComponentFingerprinter, TestDeviceRenumberingIgnored) {
+  WriteFile("sys/block/mmcblk0/device/cid", "cid_1");
+  const auto fingerprints = GetCategoryFingerprints();
+
+  ASSERT_TRUE(base::Move(temp_dir_.GetPath().Append("sys/block/mmcblk0"),
+                         temp_dir_.GetPath().Append("sys/block/mmcblk1")));
+  EXPECT_EQ(fingerprints.at("storage"),
+            GetCategoryFingerprints().at("storage"));
+}
+
+TEST_F(TestComponentFingerprinter, TestAddedComponentChangesFingerprint) {
+  WriteFile("sys/class/net/wlan0/device/vendor", "0x8086");
+  const auto fingerprints = GetCategoryFingerprints();
+
+  WriteFile("sys/class/net/eth0/device/vendor", "0x10ec");
+  EXPECT_NE(fingerprints.at("ethernet"),
+            GetCategoryFingerprints().at("ethernet"));
+}
+
+TEST_F(TestComponentFingerprinter, TestUnreadableCategoryLeftOut) {
+  WriteFile("sys/class/power_supply/BAT0/model_name", "model_1");
+  // An identity file which exists but can't be read.
+  ASSERT_TRUE(base::CreateDirectory(
+      temp_dir_.GetPath().Append("sys/class/drm/card0-eDP-1/edid")));
+  const auto fingerprints = GetCategoryFingerprints();
+  EXPECT_TRUE(fingerprints.count("battery"));
+  EXPECT_FALSE(fingerprints.count("display_panel"));
+  // The identities of DRAM are only readable by root.
+  EXPECT_FALSE(fingerprints.count("dram"));
+}
+
+TEST_F(TestComponentFingerprinter, TestSystemFingerprint) {
+  WriteFile("etc/lsb-release", "CHROMEOS_RELEASE_VERSION=1.0.0");
+  ComponentFingerprinter fingerprinter(temp_dir_.GetPath());
+  const auto fingerprint = fingerprinter.GetSystemFingerprint();
+
+  WriteFile("etc/lsb-release", "CHROMEOS_RELEASE_VERSION=2.0.0");
+  EXPECT_NE(fingerprint, fingerprinter.GetSystemFingerprint());
+}
+
+}  // namespace hardware_verifier
@@ -3,6 +3,7 @@
  * found in the LICENSE file.
  */
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -128,6 +129,16 @@ void Observer::StopTimer(const std::string& timer_name) {
   }
 }
 
+void Observer::RecordTimeSavedByProbeCache(base::TimeDelta time_saved) {
+  // Probing the changed components might take longer than the cached full
+  // probe when the system is busy.
+  const auto time_saved_ms = std::max<int64_t>(time_saved.InMilliseconds(), 0);
+  if (metrics_) {
+    metrics_->SendToUMA(kMetricTimeSavedByProbeCache, time_saved_ms,
+                        kTimerMinMs_, kTimerMaxMs_, kTimerBuckets_);
+  }
+}
+
 void Observer::SetMetricsLibrary(
     std::unique_ptr<MetricsLibraryInterface> metrics) {
   metrics_ = std::move(metrics);
@@ -24,6 +24,11 @@ constexpr auto kMetricTimeToFinish = "ChromeOS.HardwareVerifier.TimeToFinish";
 // Total time to finish probing.
 constexpr auto kMetricTimeToProbe = "ChromeOS.HardwareVerifier.TimeToProbe";
 
+// Time saved by reusing the cached probe result instead of probing all the
+// components.
+constexpr auto kMetricTimeSavedByProbeCache =
+    "ChromeOS.HardwareVerifier.TimeSavedByProbeCache";
+
 // Prefix for VerificationReport items.
 constexpr auto kMetricVerifierReportPrefix =
     "ChromeOS.HardwareVerifier.Report.";
@@ -43,6 +48,8 @@ class Observer {
   void StartTimer(const std::string& timer_name);
   void StopTimer(const std::string& timer_name);
 
+  void RecordTimeSavedByProbeCache(base::TimeDelta time_saved);
+
   void SetMetricsLibrary(std::unique_ptr<MetricsLibraryInterface> metrics);
 
   void RecordHwVerificationReport(const HwVerificationReport&);
@@ -5,13 +5,17 @@
 
 #include "hardware_verifier/probe_result_getter_impl.h"
 
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <base/files/file_util.h>
+#include <base/files/important_file_writer.h>
 #include <base/logging.h>
+#include <base/timer/elapsed_timer.h>
 #include <brillo/dbus/dbus_connection.h>
 #include <brillo/dbus/dbus_method_invoker.h>
 #include <brillo/errors/error.h>
@@ -20,12 +24,17 @@
 #include <runtime_probe/proto_bindings/runtime_probe.pb.h>
 
 #include "hardware_verifier/log_utils.h"
+#include "hardware_verifier/observer.h"
 
 namespace hardware_verifier {
 
 namespace {
 
 const char kTextFmtExt[] = ".prototxt";
+const char kProbeResultCachePath[] =
+    "/var/lib/hardware_verifier/probe_result_cache.pb";
+// Category of |runtime_probe::ProbeResult| which isn't probed anymore.
+const char kObsoleteCategory[] = "network";
 
 bool LogProbeResultAndCheckHasError(const runtime_probe::ProbeResult& pr) {
   VLogProtobuf(2, "ProbeResult", pr);
@@ -38,19 +47,118 @@ bool LogProbeResultAndCheckHasError(const runtime_probe::ProbeResult& pr) {
   return true;
 }
 
+// Returns the categories whose fingerprint differs from the one recorded in
+// |cache|. Returns |std::nullopt| if the cached probe result can't be reused.
+std::optional<std::vector<std::string>> GetChangedCategories(
+    const ProbeResultCache& cache,
+    const std::string& system_fingerprint,
+    const std::map<std::string, std::string>& fingerprints) {
+  if (cache.system_fingerprint() != system_fingerprint) {
+    VLOG(1) << "The OS changed since the probe result was cached.";
+    return std::nullopt;
+  }
+
+  // The components of a category which can't be fingerprinted (e.g. |dram|)
+  // might have changed, even if none was found last time, so they are always
+  // probed again.
+  std::vector<std::string> changed_categories;
+  const auto* descriptor = runtime_probe::ProbeResult::descriptor();
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const auto* field = descriptor->field(i);
+    if (!field->is_repeated() || fingerprints.count(field->name()) ||
+        field->name() == kObsoleteCategory) {
+      continue;
+    }
+    changed_categories.push_back(field->name());
+  }
+
+  for (const auto& [category, fingerprint] : fingerprints) {
+    const auto it = cache.category_fingerprints().find(category);
+    if (it == cache.category_fingerprints().end() ||
+        it->second != fingerprint) {
+      changed_categories.push_back(category);
+    }
+  }
+
+  // Some categories (e.g. |audio_codec|) can only be probed along with all the
+  // others.
+  for (const auto& category : changed_categories) {
+    runtime_probe::ProbeRequest::SupportCategory value;
+    if (!runtime_probe::ProbeRequest::SupportCategory_Parse(category,
+                                                            &value)) {
+      VLOG(1) << "The category " << category
+              << " may have changed and can't be probed alone.";
+      return std::nullopt;
+    }
+  }
+  return changed_categories;
+}
+
 }  // namespace
 
 ProbeResultGetterImpl::ProbeResultGetterImpl()
-    : ProbeResultGetterImpl(std::make_unique<RuntimeProbeProxy>()) {}
+    : ProbeResultGetterImpl(std::make_unique<RuntimeProbeProxy>(),
+                            base::FilePath(kProbeResultCachePath)) {}
 
 ProbeResultGetterImpl::ProbeResultGetterImpl(
-    std::unique_ptr<RuntimeProbeProxy> runtime_probe_proxy)
-    : runtime_probe_proxy_(std::move(runtime_probe_proxy)) {}
+    std::unique_ptr<RuntimeProbeProxy> runtime_probe_proxy,
+    const base::FilePath& cache_path,
+    std::unique_ptr<ComponentFingerprinter> fingerprinter)
+    : runtime_probe_proxy_(std::move(runtime_probe_proxy)),
+      cache_path_(cache_path),
+      fingerprinter_(fingerprinter
+                         ? std::move(fingerprinter)
+                         : std::make_unique<ComponentFingerprinter>()) {}
 
 std::optional<runtime_probe::ProbeResult>
 ProbeResultGetterImpl::GetFromRuntimeProbe() const {
   VLOG(1) << "Try to get the probe result by calling |runtime_probe|.";
 
+  if (cache_path_.empty())
+    return ProbeDefaultCategories();
+
+  const base::ElapsedTimer timer;
+  ProbeResultCache new_cache;
+  new_cache.set_system_fingerprint(fingerprinter_->GetSystemFingerprint());
+  const auto fingerprints = fingerprinter_->GetCategoryFingerprints();
+  new_cache.mutable_category_fingerprints()->insert(fingerprints.begin(),
+                                                    fingerprints.end());
+
+  auto cache = LoadCache();
+  if (cache) {
+    const auto changed_categories = GetChangedCategories(
+        cache.value(), new_cache.system_fingerprint(), fingerprints);
+    auto* probe_result = cache->mutable_probe_result();
+    if (changed_categories &&
+        ProbeCategoriesIncrementally(changed_categories.value(),
+                                     probe_result)) {
+      const auto time_saved =
+          base::Milliseconds(cache->full_probe_time_ms()) - timer.Elapsed();
+      LOG(INFO) << "Reused the cached probe result, "
+                << changed_categories->size()
+                << " categories were probed again, time saved: "
+                << time_saved.InMilliseconds() << "ms.";
+      Observer::GetInstance()->RecordTimeSavedByProbeCache(time_saved);
+
+      new_cache.set_full_probe_time_ms(cache->full_probe_time_ms());
+      *new_cache.mutable_probe_result() = std::move(*probe_result);
+      SaveCache(new_cache);
+      return new_cache.probe_result();
+    }
+  }
+
+  auto probe_result = ProbeDefaultCategories();
+  if (!probe_result) {
+    return std::nullopt;
+  }
+  new_cache.set_full_probe_time_ms(timer.Elapsed().InMilliseconds());
+  *new_cache.mutable_probe_result() = probe_result.value();
+  SaveCache(new_cache);
+  return probe_result;
+}
+
+std::optional<runtime_probe::ProbeResult>
+ProbeResultGetterImpl::ProbeDefaultCategories() const {
   runtime_probe::ProbeRequest probe_request;
   probe_request.set_probe_default_category(true);
   VLogProtobuf(2, "ProbeRequest", probe_request);
@@ -65,6 +173,79 @@ ProbeResultGetterImpl::GetFromRuntimeProbe() const {
   return probe_result;
 }
 
+bool ProbeResultGetterImpl::ProbeCategoriesIncrementally(
+    const std::vector<std::string>& categories,
+    runtime_probe::ProbeResult* probe_result) const {
+  if (categories.empty()) {
+    VLOG(1) << "No component changed since the probe result was cached.";
+    return LogProbeResultAndCheckHasError(*probe_result);
+  }
+
+  runtime_probe::ProbeRequest probe_request;
+  for (const auto& category : categories) {
+    runtime_probe::ProbeRequest::SupportCategory value;
+    if (!runtime_probe::ProbeRequest::SupportCategory_Parse(category,
+                                                            &value)) {
+      LOG(ERROR) << "Unknown category: " << category;
+      return false;
+    }
+    probe_request.add_categories(value);
+  }
+  VLogProtobuf(2, "ProbeRequest", probe_request);
+
+  runtime_probe::ProbeResult new_probe_result;
+  if (!runtime_probe_proxy_->ProbeCategories(probe_request,
+                                             &new_probe_result) ||
+      !LogProbeResultAndCheckHasError(new_probe_result)) {
+    return false;
+  }
+  if (new_probe_result.probe_config_checksum() !=
+      probe_result->probe_config_checksum()) {
+    VLOG(1) << "The probe config changed since the probe result was cached.";
+    return false;
+  }
+
+  const auto* descriptor = probe_result->GetDescriptor();
+  const auto* reflection = probe_result->GetReflection();
+  for (const auto& category : categories) {
+    const auto* field = descriptor->FindFieldByName(category);
+    if (!field || !field->is_repeated()) {
+      LOG(ERROR) << "No such category in the probe result: " << category;
+      return false;
+    }
+    reflection->ClearField(probe_result, field);
+    for (int i = 0; i < reflection->FieldSize(new_probe_result, field); i++) {
+      const auto& component =
+          reflection->GetRepeatedMessage(new_probe_result, field, i);
+      reflection->AddMessage(probe_result, field)->CopyFrom(component);
+    }
+  }
+  return true;
+}
+
+std::optional<ProbeResultCache> ProbeResultGetterImpl::LoadCache() const {
+  std::string content;
+  if (!base::ReadFileToString(cache_path_, &content)) {
+    VLOG(1) << "No cached probe result.";
+    return std::nullopt;
+  }
+  ProbeResultCache cache;
+  if (!cache.ParseFromString(content)) {
+    LOG(WARNING) << "Failed to parse the cached probe result.";
+    return std::nullopt;
+  }
+  return cache;
+}
+
+void ProbeResultGetterImpl::SaveCache(const ProbeResultCache& cache) const {
+  std::string content;
+  if (!cache.SerializeToString(&content) ||
+      !base::ImportantFileWriter::WriteFileAtomically(cache_path_, content)) {
+    LOG(WARNING) << "Failed to save the probe result to "
+                 << cache_path_.value();
+  }
+}
+
 std::optional<runtime_probe::ProbeResult> ProbeResultGetterImpl::GetFromFile(
     const base::FilePath& file_path) const {
   VLOG(1) << "Try to load the probe result from file (" << file_path.value()
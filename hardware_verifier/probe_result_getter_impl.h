@@ -8,7 +8,13 @@
 
 #include <memory>
 #include <optional>
+#include <string>
+#include <vector>
 
+#include <base/files/file_path.h>
+
+#include "hardware_verifier/component_fingerprinter.h"
+#include "hardware_verifier/probe_result_cache.pb.h"
 #include "hardware_verifier/probe_result_getter.h"
 
 namespace hardware_verifier {
@@ -30,10 +36,16 @@ class RuntimeProbeProxy {
 };
 
 // The real implementation of |ProbeResultGetter|.
+//
+// The result of |runtime_probe| is cached along with the fingerprints of the
+// components of each category. Only the categories whose components changed
+// since the last run are probed again, the rest of the result is reused.
 class ProbeResultGetterImpl : public ProbeResultGetter {
  public:
   ProbeResultGetterImpl();
 
+  // Returns the result of probing the default categories, reusing the cached
+  // result of the categories whose components didn't change.
   std::optional<runtime_probe::ProbeResult> GetFromRuntimeProbe()
       const override;
   std::optional<runtime_probe::ProbeResult> GetFromFile(
@@ -42,12 +54,30 @@ class ProbeResultGetterImpl : public ProbeResultGetter {
  private:
   friend class TestProbeResultGetterImpl;
 
+  // The cache is disabled if |cache_path| is empty.
   explicit ProbeResultGetterImpl(
-      std::unique_ptr<RuntimeProbeProxy> runtime_probe_proxy);
+      std::unique_ptr<RuntimeProbeProxy> runtime_probe_proxy,
+      const base::FilePath& cache_path = base::FilePath(),
+      std::unique_ptr<ComponentFingerprinter> fingerprinter = nullptr);
   ProbeResultGetterImpl(const ProbeResultGetterImpl&) = delete;
   ProbeResultGetterImpl& operator=(const ProbeResultGetterImpl&) = delete;
 
+  // Probes all the default categories.
+  std::optional<runtime_probe::ProbeResult> ProbeDefaultCategories() const;
+
+  // Probes |categories| and replaces their components in |probe_result|.
+  // Returns false if they couldn't be probed or if the probe config changed
+  // since |probe_result| was captured.
+  bool ProbeCategoriesIncrementally(
+      const std::vector<std::string>& categories,
+      runtime_probe::ProbeResult* probe_result) const;
+
+  std::optional<ProbeResultCache> LoadCache() const;
+  void SaveCache(const ProbeResultCache& cache) const;
+
   std::unique_ptr<RuntimeProbeProxy> runtime_probe_proxy_;
+  const base::FilePath cache_path_;
+  std::unique_ptr<ComponentFingerprinter> fingerprinter_;
 };
 
 }  // namespace hardware_verifier
@@ -8,12 +8,14 @@
 #include <utility>
 
 #include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
 #include <gmock/gmock.h>
 #include <google/protobuf/util/message_differencer.h>
 #include <gtest/gtest.h>
 #include <runtime_probe-client/runtime_probe/dbus-constants.h>
 #include <runtime_probe/proto_bindings/runtime_probe.pb.h>
 
+#include "hardware_verifier/component_fingerprinter.h"
 #include "hardware_verifier/probe_result_getter_impl.h"
 #include "hardware_verifier/test_utils.h"
 
@@ -35,6 +37,16 @@ class MockRuntimeProbeProxy : public RuntimeProbeProxy {
         .WillOnce(testing::DoAll(testing::SetArgPointee<1>(resp),
                                  testing::Return(retval)));
   }
+  // Same as above, and saves the request to |req|.
+  void ConfigProbeCategories(bool retval,
+                             const runtime_probe::ProbeResult& resp,
+                             runtime_probe::ProbeRequest* req) {
+    EXPECT_CALL(*this, ProbeCategories(testing::_, testing::_))
+        .WillOnce(testing::DoAll(testing::SaveArg<0>(req),
+                                 testing::SetArgPointee<1>(resp),
+                                 testing::Return(retval)))
+        .RetiresOnSaturation();
+  }
 };
 
 }  // namespace
@@ -47,8 +59,42 @@ class TestProbeResultGetterImpl : public testing::Test {
     pr_getter_.reset(new ProbeResultGetterImpl(std::move(proxy)));
   }
 
+  // Recreates |pr_getter_| with the probe result cache enabled and the
+  // components read from a fake root.
+  void EnableCache() {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    root_ = temp_dir_.GetPath().Append("root");
+    WriteRootFile("etc/lsb-release", "CHROMEOS_RELEASE_VERSION=1.0.0");
+    WriteRootFile("sys/class/power_supply/BAT0/model_name", "model_1");
+    WriteRootFile("sys/class/drm/card0-eDP-1/edid", "edid_1");
+
+    auto proxy = std::make_unique<testing::StrictMock<MockRuntimeProbeProxy>>();
+    runtime_probe_proxy_ = proxy.get();
+    pr_getter_.reset(new ProbeResultGetterImpl(
+        std::move(proxy), temp_dir_.GetPath().Append("cache.pb"),
+        std::make_unique<ComponentFingerprinter>(root_)));
+  }
+
+  void WriteRootFile(const std::string& path, const std::string& content) {
+    const auto file_path = root_.Append(path);
+    ASSERT_TRUE(base::CreateDirectory(file_path.DirName()));
+    ASSERT_TRUE(base::WriteFile(file_path, content));
+  }
+
+  // Probes all the categories once to fill the cache with |pr|.
+  void FillCache(const runtime_probe::ProbeResult& pr) {
+    runtime_probe::ProbeRequest req;
+    runtime_probe_proxy_->ConfigProbeCategories(true, pr, &req);
+    const auto actual_pr = pr_getter_->GetFromRuntimeProbe();
+    ASSERT_TRUE(actual_pr);
+    EXPECT_TRUE(req.probe_default_category());
+    EXPECT_TRUE(MessageDifferencer::Equivalent(pr, actual_pr.value()));
+  }
+
   testing::StrictMock<MockRuntimeProbeProxy>* runtime_probe_proxy_;
   std::unique_ptr<ProbeResultGetterImpl> pr_getter_;
+  base::ScopedTempDir temp_dir_;
+  base::FilePath root_;
 };
 
 TEST_F(TestProbeResultGetterImpl, TestGetFromRuntimeProbePass) {
@@ -82,6 +128,141 @@ TEST_F(TestProbeResultGetterImpl, TestGetFromRuntimeProbeProbeResultError) {
   EXPECT_FALSE(pr_getter_->GetFromRuntimeProbe());
 }
 
+TEST_F(TestProbeResultGetterImpl, TestCacheReusedWhenNothingChanged) {
+  EnableCache();
+  runtime_probe::ProbeResult pr;
+  pr.set_probe_config_checksum("checksum");
+  pr.add_battery()->set_name("batt_1");
+  FillCache(pr);
+
+  // Only |dram|, which can't be fingerprinted, is probed again.
+  runtime_probe::ProbeResult new_pr;
+  new_pr.set_probe_config_checksum("checksum");
+  runtime_probe::ProbeRequest req;
+  runtime_probe_proxy_->ConfigProbeCategories(true, new_pr, &req);
+
+  const auto actual_pr = pr_getter_->GetFromRuntimeProbe();
+  EXPECT_TRUE(actual_pr);
+  EXPECT_FALSE(req.probe_default_category());
+  EXPECT_THAT(req.categories(),
+              testing::ElementsAre(
+                  runtime_probe::ProbeRequest_SupportCategory_dram));
+  EXPECT_TRUE(MessageDifferencer::Equivalent(pr, actual_pr.value()));
+}
+
+TEST_F(TestProbeResultGetterImpl, TestCacheOnlyChangedCategoryProbed) {
+  EnableCache();
+  runtime_probe::ProbeResult pr;
+  pr.set_probe_config_checksum("checksum");
+  pr.add_battery()->set_name("batt_1");
+  pr.add_display_panel()->set_name("panel_1");
+  FillCache(pr);
+
+  WriteRootFile("sys/class/drm/card0-eDP-1/edid", "edid_2");
+  runtime_probe::ProbeResult new_pr;
+  new_pr.set_probe_config_checksum("checksum");
+  new_pr.add_display_panel()->set_name("panel_2");
+  runtime_probe::ProbeRequest req;
+  runtime_probe_proxy_->ConfigProbeCategories(true, new_pr, &req);
+
+  const auto actual_pr = pr_getter_->GetFromRuntimeProbe();
+  EXPECT_TRUE(actual_pr);
+  EXPECT_FALSE(req.probe_default_category());
+  EXPECT_THAT(req.categories(),
+              testing::UnorderedElementsAre(
+                  runtime_probe::ProbeRequest_SupportCategory_display_panel,
+                  runtime_probe::ProbeRequest_SupportCategory_dram));
+
+  runtime_probe::ProbeResult expected_pr;
+  expected_pr.set_probe_config_checksum("checksum");
+  expected_pr.add_battery()->set_name("batt_1");
+  expected_pr.add_display_panel()->set_name("panel_2");
+  EXPECT_TRUE(MessageDifferencer::Equivalent(expected_pr, actual_pr.value()));
+}
+
+TEST_F(TestProbeResultGetterImpl, TestCacheUnreadableCategoryProbed) {
+  EnableCache();
+  runtime_probe::ProbeResult pr;
+  pr.set_probe_config_checksum("checksum");
+  pr.add_battery()->set_name("batt_1");
+  FillCache(pr);
+
+  // The EDID can't be read anymore, so the display panels are probed again
+  // although none was found last time.
+  ASSERT_TRUE(base::DeleteFile(root_.Append("sys/class/drm/card0-eDP-1/edid")));
+  ASSERT_TRUE(
+      base::CreateDirectory(root_.Append("sys/class/drm/card0-eDP-1/edid")));
+  runtime_probe::ProbeResult new_pr;
+  new_pr.set_probe_config_checksum("checksum");
+  new_pr.add_display_panel()->set_name("panel_1");
+  runtime_probe::ProbeRequest req;
+  runtime_probe_proxy_->ConfigProbeCategories(true, new_pr, &req);
+
+  const auto actual_pr = pr_getter_->GetFromRuntimeProbe();
+  EXPECT_TRUE(actual_pr);
+  EXPECT_FALSE(req.probe_default_category());
+  EXPECT_THAT(req.categories(),
+              testing::UnorderedElementsAre(
+                  runtime_probe::ProbeRequest_SupportCategory_display_panel,
+                  runtime_probe::ProbeRequest_SupportCategory_dram));
+
+  runtime_probe::ProbeResult expected_pr;
+  expected_pr.set_probe_config_checksum("checksum");
+  expected_pr.add_battery()->set_name("batt_1");
+  expected_pr.add_display_panel()->set_name("panel_1");
+  EXPECT_TRUE(MessageDifferencer::Equivalent(expected_pr, actual_pr.value()));
+}
+
+TEST_F(TestProbeResultGetterImpl, TestCacheInvalidatedByOSUpdate) {
+  EnableCache();
+  runtime_probe::ProbeResult pr;
+  pr.add_battery()->set_name("batt_1");
+  FillCache(pr);
+
+  WriteRootFile("etc/lsb-release", "CHROMEOS_RELEASE_VERSION=2.0.0");
+  FillCache(pr);
+}
+
+TEST_F(TestProbeResultGetterImpl, TestCacheInvalidatedByProbeConfigChange) {
+  EnableCache();
+  runtime_probe::ProbeResult pr;
+  pr.set_probe_config_checksum("checksum_1");
+  pr.add_battery()->set_name("batt_1");
+  FillCache(pr);
+
+  WriteRootFile("sys/class/power_supply/BAT0/model_name", "model_2");
+  runtime_probe::ProbeResult new_pr;
+  new_pr.set_probe_config_checksum("checksum_2");
+  new_pr.add_battery()->set_name("batt_2");
+  runtime_probe::ProbeRequest incremental_req, full_req;
+  {
+    testing::InSequence seq;
+    runtime_probe_proxy_->ConfigProbeCategories(true, new_pr,
+                                                &incremental_req);
+    runtime_probe_proxy_->ConfigProbeCategories(true, new_pr, &full_req);
+  }
+
+  // All the categories are probed again with the new probe config.
+  const auto actual_pr = pr_getter_->GetFromRuntimeProbe();
+  EXPECT_TRUE(actual_pr);
+  EXPECT_FALSE(incremental_req.probe_default_category());
+  EXPECT_TRUE(full_req.probe_default_category());
+  EXPECT_TRUE(MessageDifferencer::Equivalent(new_pr, actual_pr.value()));
+}
+
+TEST_F(TestProbeResultGetterImpl, TestCacheInvalidatedByAudioCodecChange) {
+  EnableCache();
+  runtime_probe::ProbeResult pr;
+  pr.add_battery()->set_name("batt_1");
+  FillCache(pr);
+
+  // |audio_codec| can't be probed alone, so a codec showing up, while none was
+  // found last time, invalidates the whole cache.
+  WriteRootFile("sys/class/sound/hwC0D0/vendor_id", "0x10ec0236");
+  pr.add_audio_codec()->set_name("codec_1");
+  FillCache(pr);
+}
+
 TEST_F(TestProbeResultGetterImpl, TestGetFromFile) {
   const auto tmp_path = GetTestDataPath().Append("test_root1").Append("tmp");
 
@@ -94,6 +94,14 @@ size_t DevInterface::BlockSizeBytes() {
   return 256;
 }
 
+/*
+ * Return the maximum number of blocks per memory write.
+ * Default is 1 block, since not every device accepts longer writes.
+ */
+size_t DevInterface::MaxBlocksPerWrite() {
+  return 1;
+}
+
 std::unique_ptr<WakeLock> DevInterface::CreateWakeLock() {
   return std::make_unique<WakeLockNoOpImpl>();
 }
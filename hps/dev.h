@@ -76,6 +76,14 @@ class DevInterface {
    */
   virtual size_t BlockSizeBytes();
 
+  /*
+   * Return the maximum number of consecutive blocks that may be
+   * written in a single memory write, following the one 4 byte
+   * address header. Only override this for a device known to accept
+   * such writes.
+   */
+  virtual size_t MaxBlocksPerWrite();
+
  private:
   /*
    * Device specific implementations of the Read/Write methods,
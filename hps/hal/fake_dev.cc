@@ -265,8 +265,10 @@ bool FakeDev::WriteMemory(HpsBank bank, const uint8_t* data, size_t len) {
   if (this->Flag(Flags::kMemFail)) {
     return false;
   }
-  // Don't allow writes that exceed the max block size.
-  if (len > (this->block_size_b_ + sizeof(uint32_t))) {
+  // Don't allow writes that exceed the max write size.
+  if (len < sizeof(uint32_t) ||
+      len > (this->block_size_b_ * this->max_blocks_per_write_ +
+             sizeof(uint32_t))) {
     return false;
   }
   // Bank must be explicitly erased before writing.
@@ -277,7 +279,7 @@ bool FakeDev::WriteMemory(HpsBank bank, const uint8_t* data, size_t len) {
     case Stage::kStage0:
       // Stage0 allows the MCU flash to be written.
       if (bank == HpsBank::kMcuFlash) {
-        this->bank_len_[bank] += len - sizeof(uint32_t);
+        this->RecordWrite(bank, len);
         // Check if the fake needs to reset the not-verified bit.
         if (this->Flag(Flags::kResetApplVerification)) {
           this->Clear(Flags::kStage1NotVerified);
@@ -293,7 +295,7 @@ bool FakeDev::WriteMemory(HpsBank bank, const uint8_t* data, size_t len) {
     case Stage::kStage1:
       // Stage1 allows the SPI flash to be written.
       if (bank == HpsBank::kSpiFlash || bank == HpsBank::kSocRom) {
-        this->bank_len_[bank] += len - sizeof(uint32_t);
+        this->RecordWrite(bank, len);
         // Check if the fake needs to reset the not-verified bit.
         if (this->Flag(Flags::kResetSpiVerification)) {
           this->Clear(Flags::kSpiNotVerified);
@@ -307,10 +309,19 @@ bool FakeDev::WriteMemory(HpsBank bank, const uint8_t* data, size_t len) {
   return false;
 }
 
+void FakeDev::RecordWrite(HpsBank bank, size_t len) {
+  this->bank_len_[bank] += len - sizeof(uint32_t);
+  this->bank_writes_[bank]++;
+}
+
 size_t FakeDev::GetBankLen(hps::HpsBank bank) {
   return this->bank_len_[bank];
 }
 
+size_t FakeDev::GetBankWrites(hps::HpsBank bank) {
+  return this->bank_writes_[bank];
+}
+
 std::unique_ptr<WakeLock> FakeDev::CreateWakeLock() {
   return std::make_unique<FakeWakeLock>(*this);
 }
@@ -51,6 +51,7 @@ class FakeDev : public DevInterface {
   bool ReadDevice(uint8_t cmd, uint8_t* data, size_t len) override;
   bool WriteDevice(uint8_t cmd, const uint8_t* data, size_t len) override;
   size_t BlockSizeBytes() override { return this->block_size_b_; }
+  size_t MaxBlocksPerWrite() override { return this->max_blocks_per_write_; }
   std::unique_ptr<WakeLock> CreateWakeLock() override;
 
   void SkipBoot() { this->SetStage(Stage::kAppl); }
@@ -62,6 +63,7 @@ class FakeDev : public DevInterface {
   }
   void SetVersion(uint32_t version) { this->firmware_version_ = version; }
   void SetBlockSizeBytes(size_t sz) { this->block_size_b_ = sz; }
+  void SetMaxBlocksPerWrite(size_t n) { this->max_blocks_per_write_ = n; }
   void SetF0Result(int8_t result, bool valid) {
     this->f0_result_ =
         (valid ? hps::RFeat::kValid : 0) | static_cast<uint8_t>(result);
@@ -71,6 +73,8 @@ class FakeDev : public DevInterface {
         (valid ? hps::RFeat::kValid : 0) | static_cast<uint8_t>(result);
   }
   size_t GetBankLen(hps::HpsBank bank);
+  // Return the number of memory writes to the bank.
+  size_t GetBankWrites(hps::HpsBank bank);
   void SetPowerOnFailureCount(int n) { power_on_failure_count_ = n; }
   // Return a DevInterface accessing the simulator.
   std::unique_ptr<DevInterface> CreateDevInterface();
@@ -92,17 +96,20 @@ class FakeDev : public DevInterface {
     kAppl,
   };
   void SetStage(Stage s);
-  std::map<HpsBank, size_t> bank_len_;   // Count of writes to banks.
-  std::map<HpsBank, bool> bank_erased_;  // Whether bank has been erased
-  Stage stage_;                          // Current stage of the device
-  RError fault_ = RError::kNone;         // Fault (error) value
-  uint16_t feature_on_ = 0;              // Enabled features.
-  uint16_t bank_ = 0;                    // Current memory bank readiness
-  uint16_t flags_ = 0;                   // Behaviour flags
-  uint32_t firmware_version_ = 0;        // Firmware version
-  size_t block_size_b_ = 256;            // Write block size.
-  uint16_t f0_result_ = 0;               // Register value for feature 0
-  uint16_t f1_result_ = 0;               // Register value for feature 1
+  void RecordWrite(HpsBank bank, size_t len);
+  std::map<HpsBank, size_t> bank_len_;     // Length of writes to banks.
+  std::map<HpsBank, size_t> bank_writes_;  // Count of writes to banks.
+  std::map<HpsBank, bool> bank_erased_;    // Whether bank has been erased
+  Stage stage_;                            // Current stage of the device
+  RError fault_ = RError::kNone;           // Fault (error) value
+  uint16_t feature_on_ = 0;                // Enabled features.
+  uint16_t bank_ = 0;                      // Current memory bank readiness
+  uint16_t flags_ = 0;                     // Behaviour flags
+  uint32_t firmware_version_ = 0;          // Firmware version
+  size_t block_size_b_ = 256;              // Write block size.
+  size_t max_blocks_per_write_ = 1;        // Blocks per memory write.
+  uint16_t f0_result_ = 0;                 // Register value for feature 0
+  uint16_t f1_result_ = 0;                 // Register value for feature 1
   int wake_lock_count_ = 0;
   int power_on_failure_count_ = 0;
 };
@@ -26,6 +26,8 @@ class RetryDev : public DevInterface {
   ~RetryDev() override = default;
   bool ReadDevice(uint8_t cmd, uint8_t* data, size_t len) override;
   bool WriteDevice(uint8_t cmd, const uint8_t* data, size_t len) override;
+  size_t BlockSizeBytes() override { return device_->BlockSizeBytes(); }
+  size_t MaxBlocksPerWrite() override { return device_->MaxBlocksPerWrite(); }
 
  private:
   std::unique_ptr<DevInterface> device_;
@@ -75,6 +75,8 @@ void HPS_impl::Boot() {
     LOG(FATAL) << "No HPS firmware to download.";
   }
 
+  // Includes powering on the module.
+  base::ElapsedTimer boot_to_ready_timer;
   this->Reboot();
 
   this->boot_start_time_ = base::TimeTicks::Now();
@@ -84,6 +86,8 @@ void HPS_impl::Boot() {
     switch (this->TryBoot()) {
       case BootResult::kOk:
         LOG(INFO) << "HPS device booted";
+        hps_metrics_->SendHpsBootToReadyDuration(
+            boot_to_ready_timer.Elapsed());
         return;
       case BootResult::kUpdate:
         LOG(INFO) << "Update sent, rebooting";
@@ -692,38 +696,43 @@ bool HPS_impl::WriteFile(uint8_t bank,
   }
   base::ElapsedTimer timer;
   size_t block_size = this->device_->BlockSizeBytes();
+  size_t max_blocks = std::max<size_t>(this->device_->MaxBlocksPerWrite(), 1);
+  size_t write_size = block_size * max_blocks;
   /*
-   * Leave room for a 32 bit address at the start of the block to be written.
-   * The address is updated for each block to indicate
-   * where this block is to be written.
-   * The format of the data block is:
+   * Leave room for a 32 bit address at the start of the data to be written.
+   * The address is updated for each write to indicate
+   * where the data is to be written.
+   * The format of the write is:
    *    4 bytes of address in big endian format
-   *    data
+   *    data of up to *max_blocks* consecutive blocks
    */
-  auto buf = std::make_unique<uint8_t[]>(block_size + sizeof(uint32_t));
-  // Iterate over the firmware contents in blocks of *block_size* bytes.
-  auto block_begin = contents.begin();
-  while (block_begin != contents.end()) {
-    // The current block ends after *block_size* bytes,
+  auto buf = std::make_unique<uint8_t[]>(write_size + sizeof(uint32_t));
+  // Iterate over the firmware contents in writes of up to
+  // *max_blocks* blocks of *block_size* bytes.
+  auto write_begin = contents.begin();
+  size_t num_writes = 0;
+  while (write_begin != contents.end()) {
+    // The current write ends after *max_blocks* blocks,
     // or at end of *contents* if there are fewer bytes remaining.
-    auto block_end = std::distance(block_begin, contents.end()) >=
-                             static_cast<std::ptrdiff_t>(block_size)
-                         ? block_begin + block_size
+    auto write_end = std::distance(write_begin, contents.end()) >=
+                             static_cast<std::ptrdiff_t>(write_size)
+                         ? write_begin + write_size
                          : contents.end();
-    // The address is just the offset of the current block from the beginning.
+    // The address is just the offset of the current write from the beginning.
     uint32_t address =
-        static_cast<uint32_t>(std::distance(contents.begin(), block_begin));
+        static_cast<uint32_t>(std::distance(contents.begin(), write_begin));
     buf[0] = address >> 24;
     buf[1] = (address >> 16) & 0xff;
     buf[2] = (address >> 8) & 0xff;
     buf[3] = address & 0xff;
-    std::copy(block_begin, block_end, &buf[sizeof(uint32_t)]);
-    size_t length = std::distance(block_begin, block_end) + sizeof(uint32_t);
+    std::copy(write_begin, write_end, &buf[sizeof(uint32_t)]);
+    size_t length = std::distance(write_begin, write_end) + sizeof(uint32_t);
     if (!this->device_->Write(I2cMemWrite(bank), &buf[0], length)) {
       LOG(ERROR) << "WriteFile: device write error. bank: "
                  << static_cast<int>(bank);
       return false;
     }
+    ++num_writes;
     // Wait for the bank to become ready, indicating that the previous write has
     // finished.
     if (!this->WaitForBankReady(bank)) {
@@ -733,12 +742,15 @@ bool HPS_impl::WriteFile(uint8_t bank,
     }
     if (download_observer_) {
       download_observer_.Run(source, static_cast<uint32_t>(contents.size()),
-                             std::distance(contents.begin(), block_end),
+                             std::distance(contents.begin(), write_end),
                              timer.Elapsed());
     }
-    block_begin = block_end;
+    write_begin = write_end;
   }
+  hps_metrics_->SendHpsUpdateThroughput(static_cast<HpsBank>(bank),
+                                        contents.size(), timer.Elapsed());
   VLOG(1) << "Wrote " << contents.size() << " bytes from " << source << " in "
+          << num_writes << " writes, "
           << timer.Elapsed().InMilliseconds() << "ms";
   return true;
 }
@@ -12,6 +12,7 @@ namespace hps {
 
 constexpr int kHpsUpdateMcuMaxDurationMilliSeconds = 60 * 1000;
 constexpr int kHpsUpdateSpiMaxDurationMilliSeconds = 40 * 60 * 1000;
+constexpr int kHpsUpdateMaxThroughputKiBPerSecond = 1024;
 constexpr int kHpsBootMaxDurationMilliSeconds =
     kHpsUpdateMcuMaxDurationMilliSeconds +
     kHpsUpdateSpiMaxDurationMilliSeconds + 10 * 60 * 1000;
@@ -112,4 +113,30 @@ bool HpsMetrics::SendHpsUpdateDuration(HpsBank bank, base::TimeDelta duration) {
   return true;
 }
 
+bool HpsMetrics::SendHpsUpdateThroughput(HpsBank bank,
+                                         size_t bytes,
+                                         base::TimeDelta duration) {
+  if (!duration.is_positive())
+    return false;
+  int kib_per_second = static_cast<int>(static_cast<double>(bytes) / 1024 /
+                                        duration.InSecondsF());
+  switch (bank) {
+    case HpsBank::kMcuFlash:
+      return metrics_lib_->SendToUMA(kHpsUpdateMcuThroughput, kib_per_second, 1,
+                                     kHpsUpdateMaxThroughputKiBPerSecond, 50);
+    // Both images on the SPI flash are reported together.
+    case HpsBank::kSpiFlash:
+    case HpsBank::kSocRom:
+      return metrics_lib_->SendToUMA(kHpsUpdateSpiThroughput, kib_per_second, 1,
+                                     kHpsUpdateMaxThroughputKiBPerSecond, 50);
+  }
+  return true;
+}
+
+bool HpsMetrics::SendHpsBootToReadyDuration(base::TimeDelta duration) {
+  return metrics_lib_->SendToUMA(
+      kHpsBootToReadyDuration, static_cast<int>(duration.InMilliseconds()), 1,
+      kHpsBootMaxDurationMilliSeconds, 50);
+}
+
 }  // namespace hps
@@ -21,8 +21,12 @@ constexpr char kHpsTurnOnResult[] = "ChromeOS.HPS.TurnOn.Result";
 constexpr char kHpsBootFailedDuration[] = "ChromeOS.HPS.TurnOn.Failed.Duration";
 constexpr char kHpsBootSuccessDuration[] =
     "ChromeOS.HPS.TurnOn.Success.Duration";
+constexpr char kHpsBootToReadyDuration[] =
+    "ChromeOS.HPS.TurnOn.BootToReady.Duration";
 constexpr char kHpsUpdateMcuDuration[] = "ChromeOS.HPS.Update.Mcu.Duration";
 constexpr char kHpsUpdateSpiDuration[] = "ChromeOS.HPS.Update.Spi.Duration";
+constexpr char kHpsUpdateMcuThroughput[] = "ChromeOS.HPS.Update.Mcu.Throughput";
+constexpr char kHpsUpdateSpiThroughput[] = "ChromeOS.HPS.Update.Spi.Throughput";
 constexpr char kHpsImageInvalidity[] = "ChromeOS.HPS.Image.Invalidity";
 
 constexpr base::TimeDelta kUpdatePeriod = base::Minutes(1);
@@ -59,6 +63,13 @@ class HpsMetricsInterface {
                                    base::TimeDelta duration) = 0;
   virtual bool SendHpsUpdateDuration(HpsBank bank,
                                      base::TimeDelta duration) = 0;
+  // Reports the download rate of |bytes| of firmware written to |bank|.
+  virtual bool SendHpsUpdateThroughput(HpsBank bank,
+                                       size_t bytes,
+                                       base::TimeDelta duration) = 0;
+  // Reports the time from powering on the module to the application running,
+  // including any update and reboot in between.
+  virtual bool SendHpsBootToReadyDuration(base::TimeDelta duration) = 0;
   virtual void SendImageValidity(bool valid) = 0;
 };
 
@@ -75,6 +86,10 @@ class HpsMetrics : public HpsMetricsInterface {
   bool SendHpsTurnOnResult(HpsTurnOnResult result,
                            base::TimeDelta duration) override;
   bool SendHpsUpdateDuration(HpsBank bank, base::TimeDelta duration) override;
+  bool SendHpsUpdateThroughput(HpsBank bank,
+                               size_t bytes,
+                               base::TimeDelta duration) override;
+  bool SendHpsBootToReadyDuration(base::TimeDelta duration) override;
   void SendImageValidity(bool valid) override;
   void UpdateValidityStats(chromeos_metrics::CumulativeMetrics* cm);
   void ReportValidityStats(chromeos_metrics::CumulativeMetrics* cm);
@@ -109,6 +124,14 @@ class HpsNoMetrics : public HpsMetricsInterface {
   bool SendHpsUpdateDuration(HpsBank bank, base::TimeDelta duration) override {
     return true;
   }
+  bool SendHpsUpdateThroughput(HpsBank bank,
+                               size_t bytes,
+                               base::TimeDelta duration) override {
+    return true;
+  }
+  bool SendHpsBootToReadyDuration(base::TimeDelta duration) override {
+    return true;
+  }
   void SendImageValidity(bool valid) override {}
 };
 
@@ -113,6 +113,34 @@ TEST_F(HpsMetricsTest, SendHpsTurnOnResult) {
   }
 }
 
+TEST_F(HpsMetricsTest, SendHpsUpdateThroughput) {
+  EXPECT_CALL(*GetMetricsLibraryMock(),
+              SendToUMA(kHpsUpdateMcuThroughput, 32, _, _, _))
+      .Times(1);
+  EXPECT_TRUE(hps_metrics_->SendHpsUpdateThroughput(
+      HpsBank::kMcuFlash, 64 * 1024, base::Seconds(2)));
+
+  // Both SPI flash banks are reported as SPI.
+  EXPECT_CALL(*GetMetricsLibraryMock(),
+              SendToUMA(kHpsUpdateSpiThroughput, 128, _, _, _))
+      .Times(2);
+  EXPECT_TRUE(hps_metrics_->SendHpsUpdateThroughput(
+      HpsBank::kSpiFlash, 64 * 1024, base::Milliseconds(500)));
+  EXPECT_TRUE(hps_metrics_->SendHpsUpdateThroughput(
+      HpsBank::kSocRom, 64 * 1024, base::Milliseconds(500)));
+
+  // Nothing is sent for an empty duration.
+  EXPECT_FALSE(hps_metrics_->SendHpsUpdateThroughput(
+      HpsBank::kMcuFlash, 64 * 1024, base::TimeDelta()));
+}
+
+TEST_F(HpsMetricsTest, SendHpsBootToReadyDuration) {
+  EXPECT_CALL(*GetMetricsLibraryMock(),
+              SendToUMA(kHpsBootToReadyDuration, 1234, _, _, _))
+      .Times(1);
+  hps_metrics_->SendHpsBootToReadyDuration(base::Milliseconds(1234));
+}
+
 // Without a SendImageValidity call, no metric is sent
 TEST_F(HpsMetricsTest, ValidityNopTest) {
   task_environment_.FastForwardBy(kAccumulatePeriod);
@@ -2,13 +2,16 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <optional>
 #include <utility>
+#include <vector>
 
 #include <base/files/file.h>
 #include <base/files/file_path.h>
+#include <base/files/file_util.h>
 #include <base/memory/ref_counted.h>
 #include <base/files/scoped_temp_dir.h>
 #include <base/sys_byteorder.h>
@@ -53,6 +56,11 @@ class MockHpsMetrics : public hps::HpsMetricsInterface {
               SendHpsUpdateDuration,
               (HpsBank, base::TimeDelta),
               (override));
+  MOCK_METHOD(bool,
+              SendHpsUpdateThroughput,
+              (HpsBank, size_t, base::TimeDelta),
+              (override));
+  MOCK_METHOD(bool, SendHpsBootToReadyDuration, (base::TimeDelta), (override));
   MOCK_METHOD(void, SendImageValidity, (bool), (override));
 };
 
@@ -279,6 +287,26 @@ TEST_F(HPSTest, DownloadSmallBlocks) {
   EXPECT_EQ(fake_->GetBankLen(hps::HpsBank::kMcuFlash), len);
 }
 
+/*
+ * Download testing with several blocks per write.
+ */
+TEST_F(HPSTest, DownloadBatchedBlocks) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  auto f = temp_dir.GetPath().Append("blob");
+  const int len = 1000;
+  CreateBlob(f, len);
+  fake_->SetBlockSizeBytes(32);
+  fake_->SetMaxBlocksPerWrite(4);
+  EXPECT_CALL(*metrics_,
+              SendHpsUpdateThroughput(hps::HpsBank::kMcuFlash, len, _))
+      .Times(1);
+  ASSERT_TRUE(hps_->Download(hps::HpsBank::kMcuFlash, f));
+  EXPECT_EQ(fake_->GetBankLen(hps::HpsBank::kMcuFlash), len);
+  // 1000 bytes in writes of up to 4 * 32 bytes.
+  EXPECT_EQ(fake_->GetBankWrites(hps::HpsBank::kMcuFlash), 8);
+}
+
 /*
  * Observing download progress.
  */
@@ -452,11 +480,15 @@ TEST_F(HPSTest, McuUpdate) {
   // Boot the module.
   EXPECT_CALL(*metrics_, SendHpsUpdateDuration(hps::HpsBank::kMcuFlash, _))
       .Times(1);
+  EXPECT_CALL(*metrics_,
+              SendHpsUpdateThroughput(hps::HpsBank::kMcuFlash, len, _))
+      .Times(1);
   EXPECT_CALL(*metrics_,
               SendHpsTurnOnResult(hps::HpsTurnOnResult::kMcuNotVerified, _))
       .Times(1);
   EXPECT_CALL(*metrics_, SendHpsTurnOnResult(hps::HpsTurnOnResult::kSuccess, _))
       .Times(1);
+  EXPECT_CALL(*metrics_, SendHpsBootToReadyDuration(_)).Times(1);
   hps_->Boot();
 
   // Check that MCU was downloaded.
@@ -0,0 +1,71 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <base/at_exit.h>
+#include <base/callback_helpers.h>
+#include <base/test/task_environment.h>
+#include <benchmark/benchmark.h>
+#include <libmems/test_fakes.h>
+
+#include "iioservice/daemon/common_types.h"
+#include "iioservice/daemon/samples_handler_fusion_gravity.h"
+
+namespace iioservice {
+namespace {
+
+constexpr size_t kNumFakeSamples = std::size(libmems::fakes::kFakeAccelSamples);
+
+int64_t GetFakeTimestamp(size_t index) {
+  return libmems::fakes::kFakeAccelSamples[index][kNumberOfAxes];
+}
+
+// Replays the fake accel samples into a gravity fusion handler, with
+// |state.range(0)| gyro samples between two accel samples.
+void BM_GravityFusion(benchmark::State& state) {
+  base::test::SingleThreadTaskEnvironment task_environment;
+  SamplesHandlerFusionGravity handler(
+      task_environment.GetMainThreadTaskRunner(), GetGravityChannels(),
+      base::DoNothing());
+  handler.SetScale(cros::mojom::DeviceType::ACCEL, 0.0012);
+  handler.SetScale(cros::mojom::DeviceType::ANGLVEL, 0.0001);
+
+  const int num_gyro_samples = state.range(0);
+  const int64_t interval = GetFakeTimestamp(1) - GetFakeTimestamp(0);
+  // Keeps the timestamps increasing when the samples are replayed.
+  const int64_t duration =
+      GetFakeTimestamp(kNumFakeSamples - 1) - GetFakeTimestamp(0) + interval;
+  int64_t offset = 0;
+  for (auto _ : state) {
+    for (size_t i = 0; i < kNumFakeSamples; ++i) {
+      const int64_t* accel = libmems::fakes::kFakeAccelSamples[i];
+      for (int j = 0; j < num_gyro_samples; ++j) {
+        // Rotate slowly around the axes of the accel sample.
+        handler.HandleGyroSample(
+            {accel[2] % 16, accel[0] % 16, accel[1] % 16,
+             offset + accel[kNumberOfAxes] -
+                 interval * (num_gyro_samples - j) / (num_gyro_samples + 1)});
+      }
+      handler.HandleAccelSample({accel[0], accel[1], accel[2],
+                                 offset + accel[kNumberOfAxes]});
+    }
+    offset += duration;
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFakeSamples *
+                          (num_gyro_samples + 1));
+}
+BENCHMARK(BM_GravityFusion)->Arg(0)->Arg(1)->Arg(2)->Arg(4);
+
+}  // namespace
+}  // namespace iioservice
+
+int main(int argc, char** argv) {
+  base::AtExitManager at_exit;
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
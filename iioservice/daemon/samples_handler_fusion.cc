@@ -4,6 +4,7 @@
 
 #include "iioservice/daemon/samples_handler_fusion.h"
 
+#include <algorithm>
 #include <utility>
 
 #include <libmems/common_types.h>
@@ -13,6 +14,9 @@
 
 namespace iioservice {
 
+// static
+constexpr size_t SamplesHandlerFusion::kMaxBatchSize;
+
 SamplesHandlerFusion::SamplesHandlerFusion(
     scoped_refptr<base::SequencedTaskRunner> ipc_task_runner,
     std::vector<std::string> channel_ids,
@@ -22,6 +26,8 @@ SamplesHandlerFusion::SamplesHandlerFusion(
       update_frequency_callback_(std::move(callback)) {
   DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
 
+  raw_samples_.reserve(kMaxBatchSize);
+
   SetNoBatchChannels(std::move(channel_ids));
 }
 
@@ -172,6 +178,29 @@ void SamplesHandlerFusion::OnSampleAvailableOnThread(
   SamplesHandlerBase::OnSampleAvailableOnThread(sample);
 }
 
+void SamplesHandlerFusion::PushRawSampleOnThread(
+    cros::mojom::DeviceType type, const std::vector<int64_t>& values) {
+  DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
+  DCHECK_EQ(values.size(), kNumberOfAxes + 1);
+
+  RawSample& sample = raw_samples_.emplace_back();
+  sample.type = type;
+  for (int i = 0; i < kNumberOfAxes; ++i)
+    sample.axes[i] = values[i];
+  sample.timestamp = values.back();
+}
+
+void SamplesHandlerFusion::DrainRawSamplesOnThread() {
+  DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
+
+  for (size_t begin = 0; begin < raw_samples_.size(); begin += kMaxBatchSize) {
+    ProcessRawSamplesOnThread(
+        raw_samples_.data() + begin,
+        std::min(kMaxBatchSize, raw_samples_.size() - begin));
+  }
+  raw_samples_.clear();
+}
+
 bool SamplesHandlerFusion::SampleIsValid(
     const base::flat_map<int32_t, int64_t>& sample) {
   DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
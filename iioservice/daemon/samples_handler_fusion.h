@@ -53,6 +53,28 @@ class SamplesHandlerFusion : public SamplesHandlerBase {
  protected:
   friend SamplesHandlerFusionTestWithParam;
 
+  // The max number of raw samples passed to ProcessRawSamplesOnThread() at
+  // once.
+  static constexpr size_t kMaxBatchSize = 64;
+
+  // A raw sample of one of the iio devices being fused.
+  struct RawSample {
+    cros::mojom::DeviceType type = cros::mojom::DeviceType::NONE;
+    int64_t axes[kNumberOfAxes] = {0, 0, 0};
+    int64_t timestamp = 0;
+  };
+
+  // Appends a raw sample of the iio device with |type| to |raw_samples_|.
+  // |values| holds the axes followed by the timestamp.
+  void PushRawSampleOnThread(cros::mojom::DeviceType type,
+                             const std::vector<int64_t>& values);
+  // Passes |raw_samples_| to ProcessRawSamplesOnThread() in batches, and
+  // clears it.
+  void DrainRawSamplesOnThread();
+  // Fuses |num_samples| raw samples, in the order they were pushed.
+  virtual void ProcessRawSamplesOnThread(const RawSample* samples,
+                                         size_t num_samples) {}
+
   // SamplesHandlerBase overrides:
   bool UpdateRequestedFrequencyOnThread() override;
   void OnSampleAvailableOnThread(
@@ -65,6 +87,9 @@ class SamplesHandlerFusion : public SamplesHandlerBase {
 
   bool invalid_ = false;
 
+  // The raw samples pushed and not fused yet.
+  std::vector<RawSample> raw_samples_;
+
  private:
   base::WeakPtrFactory<SamplesHandlerFusion> weak_factory_{this};
 };
@@ -56,21 +56,77 @@ void SamplesHandlerFusionGravity::HandleAccelSample(
   DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
   DCHECK_EQ(accel_sample.size(), kNumberOfAxes + 1);
 
-  if (!accel_scale_.has_value())
-    return;
+  PushRawSampleOnThread(cros::mojom::DeviceType::ACCEL, accel_sample);
+  DrainRawSamplesOnThread();
+}
 
-  int64_t dT_int = accel_sample.back() - accel_timestamp_;
-  if (dT_int > 0 && dT_int < (int64_t)(1e8)) {  // 0.1sec }
-    const float dT = (dT_int) / 1000000000.0f;
+void SamplesHandlerFusionGravity::HandleGyroSample(
+    std::vector<int64_t> gyro_sample) {
+  DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
+  DCHECK_EQ(gyro_sample.size(), kNumberOfAxes + 1);
+
+  PushRawSampleOnThread(cros::mojom::DeviceType::ANGLVEL, gyro_sample);
+  // Don't let the gyro samples pile up if the accel samples stop coming.
+  if (raw_samples_.size() >= kMaxBatchSize)
+    DrainRawSamplesOnThread();
+}
+
+void SamplesHandlerFusionGravity::ProcessRawSamplesOnThread(
+    const RawSample* samples, size_t num_samples) {
+  DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
+  DCHECK_LE(num_samples, kMaxBatchSize);
+
+  // Scale the whole batch first. The iterations are independent of each
+  // other, so the compiler can vectorize the loops.
+  double scales[kMaxBatchSize];
+  android::vec3_t values[kMaxBatchSize];
+  const double accel_scale = accel_scale_.value_or(0.0);
+  const double gyro_scale = gyro_scale_.value_or(0.0);
+  for (size_t i = 0; i < num_samples; ++i) {
+    scales[i] = samples[i].type == cros::mojom::DeviceType::ACCEL ? accel_scale
+                                                                  : gyro_scale;
+  }
+  for (size_t i = 0; i < num_samples; ++i) {
+    for (int j = 0; j < kNumberOfAxes; ++j)
+      values[i][j] = scales[i] * samples[i].axes[j];
+  }
+
+  // The filter updates depend on the previous state, so they run in order.
+  for (size_t i = 0; i < num_samples; ++i) {
+    const RawSample& sample = samples[i];
+    switch (sample.type) {
+      case cros::mojom::DeviceType::ACCEL:
+        if (!accel_scale_.has_value())
+          break;
+
+        HandleScaledAccelSample(values[i], sample.timestamp);
+        break;
 
-    android::vec3_t a;
-    for (int i = 0; i < kNumberOfAxes; ++i)
-      a[i] = accel_scale_.value() * accel_sample[i];
+      case cros::mojom::DeviceType::ANGLVEL:
+        if (!gyro_scale_.has_value())
+          break;
 
+        HandleScaledGyroSample(values[i], sample.timestamp);
+        break;
+
+      default:
+        NOTREACHED() << "Invalid type: " << sample.type;
+        break;
+    }
+  }
+}
+
+void SamplesHandlerFusionGravity::HandleScaledAccelSample(
+    const android::vec3_t& a, int64_t timestamp) {
+  DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
+
+  int64_t dT_int = timestamp - accel_timestamp_;
+  if (dT_int > 0 && dT_int < (int64_t)(1e8)) {  // 0.1sec }
+    const float dT = (dT_int) / 1000000000.0f;
     fusion_.HandleAccel(a, dT);
   }
 
-  accel_timestamp_ = accel_sample.back();
+  accel_timestamp_ = timestamp;
 
   if (!fusion_.HasEstimate())
     return;
@@ -86,26 +142,17 @@ void SamplesHandlerFusionGravity::HandleAccelSample(
   OnSampleAvailableOnThread(gravity_sample);
 }
 
-void SamplesHandlerFusionGravity::HandleGyroSample(
-    std::vector<int64_t> gyro_sample) {
+void SamplesHandlerFusionGravity::HandleScaledGyroSample(
+    const android::vec3_t& w, int64_t timestamp) {
   DCHECK(ipc_task_runner_->RunsTasksInCurrentSequence());
-  DCHECK_EQ(gyro_sample.size(), kNumberOfAxes + 1);
 
-  if (!gyro_scale_.has_value())
-    return;
-
-  int64_t dT_int = gyro_sample.back() - gyro_timestamp_;
+  int64_t dT_int = timestamp - gyro_timestamp_;
   if (dT_int > 0 && dT_int < (int64_t)(5e7)) {  // 0.05sec }
     const float dT = (dT_int) / 1000000000.0f;
-
-    android::vec3_t w;
-    for (int i = 0; i < kNumberOfAxes; ++i)
-      w[i] = gyro_scale_.value() * gyro_sample[i];
-
     fusion_.HandleGyro(w, dT);
   }
 
-  gyro_timestamp_ = gyro_sample.back();
+  gyro_timestamp_ = timestamp;
 }
 
 bool SamplesHandlerFusionGravity::SampleIsValid(
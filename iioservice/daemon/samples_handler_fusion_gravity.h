@@ -31,6 +31,8 @@ class SamplesHandlerFusionGravity final : public SamplesHandlerFusion {
 
   void SetScale(cros::mojom::DeviceType type, double scale);
 
+  // Gyro samples are buffered and fused with the next accel sample, which
+  // produces a gravity sample.
   void HandleAccelSample(std::vector<int64_t> accel_sample);
   void HandleGyroSample(std::vector<int64_t> gyro_sample);
 
@@ -41,8 +43,13 @@ class SamplesHandlerFusionGravity final : public SamplesHandlerFusion {
  protected:
   // SamplesHandlerFusion overrides:
   bool SampleIsValid(const base::flat_map<int32_t, int64_t>& sample);
+  void ProcessRawSamplesOnThread(const RawSample* samples,
+                                 size_t num_samples) override;
 
  private:
+  void HandleScaledAccelSample(const android::vec3_t& a, int64_t timestamp);
+  void HandleScaledGyroSample(const android::vec3_t& w, int64_t timestamp);
+
   Fusion fusion_;
 
   std::optional<double> accel_scale_;
@@ -0,0 +1,187 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <gtest/gtest.h>
+
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <aosp/frameworks/native/services/sensorservice/mat.h>
+#include <aosp/frameworks/native/services/sensorservice/vec.h>
+#include <base/callback_helpers.h>
+#include <base/run_loop.h>
+#include <base/test/task_environment.h>
+#include <libmems/iio_device.h>
+#include <libmems/test_fakes.h>
+#include <mojo/public/cpp/bindings/receiver.h>
+
+#include "iioservice/daemon/common_types.h"
+#include "iioservice/daemon/fusion.h"
+#include "iioservice/daemon/samples_handler_fusion_gravity.h"
+#include "iioservice/daemon/sensor_metrics_mock.h"
+#include "iioservice/mojo/sensor.mojom.h"
+
+namespace iioservice {
+
+namespace {
+
+constexpr double kAccelScale = 0.0012;
+constexpr double kGyroScale = 0.0001;
+constexpr double kFrequency = 10.0;
+constexpr float kGravityEarth = 9.80665f;
+
+// The gyro samples between the |kManyGyroSamplesIndex|-th accel sample and the
+// previous one don't fit in a single batch.
+constexpr size_t kManyGyroSamplesIndex = 10;
+constexpr int kNumManyGyroSamples = 150;
+
+struct RawSample {
+  cros::mojom::DeviceType type;
+  std::vector<int64_t> values;
+};
+
+// Returns the fake accel samples with a varying number of gyro samples
+// between them, in the order they arrive.
+std::vector<RawSample> GetRawSamples() {
+  const int64_t interval = libmems::fakes::kFakeAccelSamples[1][kNumberOfAxes] -
+                           libmems::fakes::kFakeAccelSamples[0][kNumberOfAxes];
+  std::vector<RawSample> samples;
+  for (size_t i = 0; i < std::size(libmems::fakes::kFakeAccelSamples); ++i) {
+    const int64_t* accel = libmems::fakes::kFakeAccelSamples[i];
+    const int num_gyro_samples =
+        i == kManyGyroSamplesIndex ? kNumManyGyroSamples : i % 4;
+    for (int j = 0; j < num_gyro_samples; ++j) {
+      // Rotate slowly around the axes of the accel sample.
+      samples.push_back(
+          {cros::mojom::DeviceType::ANGLVEL,
+           {accel[2] % 16, accel[0] % 16, accel[1] % 16,
+            accel[kNumberOfAxes] -
+                interval * (num_gyro_samples - j) / (num_gyro_samples + 1)}});
+    }
+    samples.push_back({cros::mojom::DeviceType::ACCEL,
+                       {accel[0], accel[1], accel[2], accel[kNumberOfAxes]}});
+  }
+  return samples;
+}
+
+// Fuses |samples| one at a time, and returns the gravity samples produced
+// after each accel sample.
+std::vector<libmems::IioDevice::IioSample> FuseOneByOne(
+    const std::vector<RawSample>& samples) {
+  Fusion fusion;
+  int64_t accel_timestamp = 0;
+  int64_t gyro_timestamp = 0;
+  std::vector<libmems::IioDevice::IioSample> gravity_samples;
+  for (const RawSample& sample : samples) {
+    android::vec3_t v;
+    const int64_t timestamp = sample.values[kNumberOfAxes];
+    if (sample.type == cros::mojom::DeviceType::ANGLVEL) {
+      for (int i = 0; i < kNumberOfAxes; ++i)
+        v[i] = kGyroScale * sample.values[i];
+      const int64_t dT = timestamp - gyro_timestamp;
+      if (dT > 0 && dT < 50000000)
+        fusion.HandleGyro(v, dT / 1000000000.0f);
+      gyro_timestamp = timestamp;
+      continue;
+    }
+
+    for (int i = 0; i < kNumberOfAxes; ++i)
+      v[i] = kAccelScale * sample.values[i];
+    const int64_t dT = timestamp - accel_timestamp;
+    if (dT > 0 && dT < 100000000)
+      fusion.HandleAccel(v, dT / 1000000000.0f);
+    accel_timestamp = timestamp;
+    if (!fusion.HasEstimate())
+      continue;
+
+    const android::mat33_t R(fusion.GetRotationMatrix());
+    const android::vec3_t g = R[2] * kGravityEarth;
+    gravity_samples.push_back({{0, static_cast<int64_t>(g.x / kAccelScale)},
+                               {1, static_cast<int64_t>(g.y / kAccelScale)},
+                               {2, static_cast<int64_t>(g.z / kAccelScale)},
+                               {3, timestamp}});
+  }
+  return gravity_samples;
+}
+
+class GravityObserver : public cros::mojom::SensorDeviceSamplesObserver {
+ public:
+  mojo::PendingRemote<cros::mojom::SensorDeviceSamplesObserver> GetRemote() {
+    return receiver_.BindNewPipeAndPassRemote();
+  }
+
+  const std::vector<libmems::IioDevice::IioSample>& samples() const {
+    return samples_;
+  }
+
+  // cros::mojom::SensorDeviceSamplesObserver overrides:
+  void OnSampleUpdated(const libmems::IioDevice::IioSample& sample) override {
+    samples_.push_back(sample);
+  }
+  void OnErrorOccurred(cros::mojom::ObserverErrorType type) override {
+    ADD_FAILURE() << "Unexpected error: " << type;
+  }
+
+ private:
+  mojo::Receiver<cros::mojom::SensorDeviceSamplesObserver> receiver_{this};
+  std::vector<libmems::IioDevice::IioSample> samples_;
+};
+
+class SamplesHandlerFusionGravityTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SensorMetricsMock::InitializeForTesting();
+
+    handler_ = std::make_unique<SamplesHandlerFusionGravity>(
+        task_environment_.GetMainThreadTaskRunner(), GetGravityChannels(),
+        base::DoNothing());
+    handler_->SetScale(cros::mojom::DeviceType::ACCEL, kAccelScale);
+    handler_->SetScale(cros::mojom::DeviceType::ANGLVEL, kGyroScale);
+
+    client_data_.frequency = kFrequency;
+    client_data_.timeout = 0;
+    for (int32_t i = 0; i < kNumberOfAxes + 1; ++i)
+      client_data_.enabled_chn_indices.emplace(i);
+    handler_->AddClient(&client_data_, observer_.GetRemote());
+  }
+
+  void TearDown() override {
+    handler_->RemoveClient(&client_data_);
+    handler_.reset();
+    base::RunLoop().RunUntilIdle();
+
+    SensorMetrics::Shutdown();
+  }
+
+  base::test::SingleThreadTaskEnvironment task_environment_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME,
+      base::test::TaskEnvironment::MainThreadType::IO};
+
+  ClientData client_data_{0};
+  GravityObserver observer_;
+  std::unique_ptr<SamplesHandlerFusionGravity> handler_;
+};
+
+// The gyro samples are fused in batches with the next accel sample, which must
+// produce the same gravity samples as fusing every raw sample on its own.
+TEST_F(SamplesHandlerFusionGravityTest, BatchedSamplesMatchOneByOne) {
+  const std::vector<RawSample> samples = GetRawSamples();
+  for (const RawSample& sample : samples) {
+    if (sample.type == cros::mojom::DeviceType::ACCEL)
+      handler_->HandleAccelSample(sample.values);
+    else
+      handler_->HandleGyroSample(sample.values);
+  }
+  base::RunLoop().RunUntilIdle();
+
+  const std::vector<libmems::IioDevice::IioSample> expected =
+      FuseOneByOne(samples);
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(observer_.samples(), expected);
+}
+
+}  // namespace
+
+}  // namespace iioservice
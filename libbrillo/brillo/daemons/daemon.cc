@@ -12,17 +12,50 @@
 #include <base/bind.h>
 #include <base/files/file_util.h>
 #include <base/logging.h>
+#include <base/pending_task.h>
 #include <base/run_loop.h>
+#include <base/task/current_thread.h>
+#include <brillo/tracing.h>
 
 namespace brillo {
 
+#if defined(BRILLO_USE_PERFETTO)
+namespace {
+
+// Emits a span for each task run by the message loop, annotated with the
+// location the task was posted from.
+class TaskTracer : public base::TaskObserver {
+ public:
+  void WillProcessTask(const base::PendingTask& pending_task,
+                       bool was_blocked_or_low_priority) override {
+    BRILLO_TRACE_EVENT_BEGIN(kTraceCategoryTask, "RunTask", "posted_from",
+                             pending_task.posted_from.ToString());
+  }
+
+  void DidProcessTask(const base::PendingTask& pending_task) override {
+    BRILLO_TRACE_EVENT_END(kTraceCategoryTask);
+  }
+};
+
+}  // namespace
+#endif
+
 Daemon::Daemon() : exit_code_{EX_OK}, exiting_(false) {
   message_loop_.SetAsCurrent();
 }
 
-Daemon::~Daemon() {}
+Daemon::~Daemon() {
+  if (task_tracer_)
+    base::CurrentThread::Get()->RemoveTaskObserver(task_tracer_.get());
+}
 
 int Daemon::Run() {
+  InitializeTracing();
+#if defined(BRILLO_USE_PERFETTO)
+  task_tracer_ = std::make_unique<TaskTracer>();
+  base::CurrentThread::Get()->AddTaskObserver(task_tracer_.get());
+#endif
+
   int exit_code = OnInit();
   if (exit_code != EX_OK)
     return exit_code;
@@ -5,10 +5,12 @@
 #ifndef LIBBRILLO_BRILLO_DAEMONS_DAEMON_H_
 #define LIBBRILLO_BRILLO_DAEMONS_DAEMON_H_
 
+#include <memory>
 #include <string>
 
 #include <base/at_exit.h>
 #include <base/files/file_path.h>
+#include <base/task/task_observer.h>
 #include <base/time/time.h>
 #include <brillo/asynchronous_signal_handler.h>
 #include <brillo/brillo_export.h>
@@ -115,6 +117,9 @@ class BRILLO_EXPORT Daemon : public AsynchronousSignalHandlerInterface {
   int exit_code_;
   // Daemon is in the process of exiting.
   bool exiting_;
+  // Emits a trace event for each task run by |message_loop_|, if libbrillo is
+  // built with tracing.
+  std::unique_ptr<base::TaskObserver> task_tracer_;
 };
 
 // Moves |latest_log_symlink| to |previous_log_symlink| and creates a relative
@@ -15,6 +15,7 @@
 #include <brillo/dbus/async_event_sequencer.h>
 #include <brillo/dbus/exported_object_manager.h>
 #include <brillo/dbus/exported_property_set.h>
+#include <brillo/tracing.h>
 #include <dbus/property.h>
 
 namespace brillo {
@@ -191,6 +192,9 @@ void DBusInterface::HandleMethodCall(dbus::MethodCall* method_call,
     return;
   }
   VLOG(1) << "Dispatching DBus method call: " << method_name;
+  // Asynchronous methods may send their response after the span ends.
+  BRILLO_TRACE_EVENT(kTraceCategoryDBus, "HandleMethodCall", "interface",
+                     interface_name, "member", method_name);
   pair->second->HandleMethod(method_call, std::move(sender));
 }
 
@@ -347,6 +351,8 @@ void DBusObject::UnregisterAsync() {
 }
 
 bool DBusObject::SendSignal(dbus::Signal* signal) {
+  BRILLO_TRACE_EVENT(kTraceCategoryDBus, "SendSignal", "interface",
+                     signal->GetInterface(), "member", signal->GetMember());
   if (exported_object_) {
     exported_object_->SendSignal(signal);
     return true;
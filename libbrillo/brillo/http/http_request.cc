@@ -5,6 +5,9 @@
 #include <base/check.h>
 #include <brillo/http/http_request.h>
 
+#include <atomic>
+#include <utility>
+
 #include <base/bind.h>
 #include <base/callback.h>
 #include <base/logging.h>
@@ -13,10 +16,43 @@
 #include <brillo/mime_utils.h>
 #include <brillo/streams/memory_stream.h>
 #include <brillo/strings/string_utils.h>
+#include <brillo/tracing.h>
+#include <brillo/url_utils.h>
 
 namespace brillo {
 namespace http {
 
+#if defined(BRILLO_USE_PERFETTO)
+namespace {
+
+// Asynchronous requests are traced on their own track, since they complete on
+// a later task.
+perfetto::Track NewRequestTrack() {
+  static std::atomic<uint64_t> next_id{0};
+  return perfetto::Track(next_id++);
+}
+
+void OnTracedRequestSuccess(perfetto::Track track,
+                            const SuccessCallback& callback,
+                            RequestID request_id,
+                            std::unique_ptr<Response> response) {
+  BRILLO_TRACE_EVENT_END(kTraceCategoryHttp, track, "status_code",
+                         response->GetStatusCode());
+  callback.Run(request_id, std::move(response));
+}
+
+void OnTracedRequestError(perfetto::Track track,
+                          const ErrorCallback& callback,
+                          RequestID request_id,
+                          const brillo::Error* error) {
+  BRILLO_TRACE_EVENT_END(kTraceCategoryHttp, track, "error",
+                         error->GetCode());
+  callback.Run(request_id, error);
+}
+
+}  // namespace
+#endif
+
 // request_type
 const char request_type::kOptions[] = "OPTIONS";
 const char request_type::kGet[] = "GET";
@@ -134,6 +170,9 @@ void Request::AddRange(uint64_t from_byte, uint64_t to_byte) {
 
 std::unique_ptr<Response> Request::GetResponseAndBlock(
     brillo::ErrorPtr* error) {
+  // The query string may carry credentials, so it's not traced.
+  BRILLO_TRACE_EVENT(kTraceCategoryHttp, "HttpRequest", "method", method_,
+                     "url", url::RemoveQueryString(request_url_, true));
   if (!SendRequestIfNeeded(error) || !connection_->FinishRequest(error))
     return std::unique_ptr<Response>();
   std::unique_ptr<Response> response(new Response(connection_));
@@ -144,14 +183,28 @@ std::unique_ptr<Response> Request::GetResponseAndBlock(
 
 RequestID Request::GetResponse(const SuccessCallback& success_callback,
                                const ErrorCallback& error_callback) {
+#if defined(BRILLO_USE_PERFETTO)
+  const perfetto::Track track = NewRequestTrack();
+  BRILLO_TRACE_EVENT_BEGIN(kTraceCategoryHttp, "HttpRequest", track, "method",
+                           method_, "url",
+                           url::RemoveQueryString(request_url_, true));
+  const SuccessCallback traced_success_callback =
+      base::Bind(&OnTracedRequestSuccess, track, success_callback);
+  const ErrorCallback traced_error_callback =
+      base::Bind(&OnTracedRequestError, track, error_callback);
+#else
+  const SuccessCallback& traced_success_callback = success_callback;
+  const ErrorCallback& traced_error_callback = error_callback;
+#endif
   ErrorPtr error;
   if (!SendRequestIfNeeded(&error)) {
     transport_->RunCallbackAsync(
-        FROM_HERE, base::Bind(error_callback, 0, base::Owned(error.release())));
+        FROM_HERE, base::Bind(traced_error_callback, 0,
+                              base::Owned(error.release())));
     return 0;
   }
-  RequestID id =
-      connection_->FinishRequestAsync(success_callback, error_callback);
+  RequestID id = connection_->FinishRequestAsync(traced_success_callback,
+                                                 traced_error_callback);
   connection_.reset();
   transport_.reset();  // Indicate that the request has been dispatched.
   return id;
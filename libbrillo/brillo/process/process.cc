@@ -28,6 +28,7 @@
 #include <base/strings/string_number_conversions.h>
 #include <base/strings/string_util.h>
 #include <base/time/time.h>
+#include <brillo/tracing.h>
 
 #ifndef __linux__
 #define setresuid(_u1, _u2, _u3) setreuid(_u1, _u2)
@@ -353,6 +354,8 @@ bool ProcessImpl::Start() {
   if (arguments_.empty()) {
     return false;
   }
+  // The span ends when the parent returns, the child never returns.
+  BRILLO_TRACE_EVENT(kTraceCategoryProcess, "Start", "program", arguments_[0]);
   std::unique_ptr<char*[]> argv =
       std::make_unique<char*[]>(arguments_.size() + 1);
 
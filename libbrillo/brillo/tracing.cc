@@ -0,0 +1,37 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <brillo/tracing.h>
+
+#include <base/logging.h>
+
+#if defined(BRILLO_USE_PERFETTO)
+PERFETTO_TRACK_EVENT_STATIC_STORAGE_IN_NAMESPACE_WITH_ATTRS(brillo::tracing,
+                                                            BRILLO_EXPORT);
+#endif
+
+namespace brillo {
+
+void InitializeTracing(bool in_process_backend) {
+#if defined(BRILLO_USE_PERFETTO)
+  static const bool initialized = [in_process_backend]() {
+    if (!perfetto::Tracing::IsInitialized()) {
+      perfetto::TracingInitArgs args;
+      args.backends |= perfetto::kSystemBackend;
+      if (in_process_backend) {
+        args.backends |= perfetto::kInProcessBackend;
+      }
+      perfetto::Tracing::Initialize(args);
+    }
+    if (!tracing::TrackEvent::Register()) {
+      LOG(ERROR) << "Failed to register the libbrillo track event categories";
+      return false;
+    }
+    return true;
+  }();
+  static_cast<void>(initialized);
+#endif
+}
+
+}  // namespace brillo
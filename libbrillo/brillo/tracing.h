@@ -0,0 +1,101 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Perfetto track event instrumentation for libbrillo.
+//
+// libbrillo emits track events in the categories below for the tasks run by
+// brillo::Daemon, the D-Bus methods dispatched and the signals sent by
+// DBusObject, the processes spawned by brillo::Process and the HTTP requests
+// sent by brillo::http::Request. The events are compiled out unless libbrillo
+// is built with the "perfetto" USE flag, and cost a single load and branch
+// per event when no tracing session enables their category.
+//
+// brillo::Daemon connects to the system tracing service when it starts.
+// Daemons can add their own spans by defining their categories with
+// PERFETTO_DEFINE_CATEGORIES() and PERFETTO_TRACK_EVENT_STATIC_STORAGE(),
+// which live in a different namespace than the libbrillo ones, and by
+// registering them after brillo::InitializeTracing() was called:
+//
+//   brillo::InitializeTracing();
+//   perfetto::TrackEvent::Register();
+//   ...
+//   TRACE_EVENT("shill", "Manager::ConfigureService");
+//
+// Code using libbrillo categories must use the BRILLO_TRACE_EVENT*() macros,
+// which pick the libbrillo categories instead of the caller's ones.
+
+#ifndef LIBBRILLO_BRILLO_TRACING_H_
+#define LIBBRILLO_BRILLO_TRACING_H_
+
+#include <brillo/brillo_export.h>
+
+#if defined(BRILLO_USE_PERFETTO)
+#include <perfetto/perfetto.h>
+#endif
+
+namespace brillo {
+
+// Tasks run by brillo::Daemon.
+constexpr char kTraceCategoryTask[] = "brillo.task";
+// D-Bus method calls dispatched and signals sent by DBusObject.
+constexpr char kTraceCategoryDBus[] = "brillo.dbus";
+// Processes spawned by brillo::Process.
+constexpr char kTraceCategoryProcess[] = "brillo.process";
+// HTTP requests sent by brillo::http::Request.
+constexpr char kTraceCategoryHttp[] = "brillo.http";
+
+// Initializes Perfetto with the system backend, plus the in-process backend
+// if |in_process_backend| is true, and registers the libbrillo categories.
+// Only registers the categories if the process already initialized Perfetto
+// itself. Only the first call has an effect, and it does nothing if libbrillo
+// was built without Perfetto.
+BRILLO_EXPORT void InitializeTracing(bool in_process_backend = false);
+
+}  // namespace brillo
+
+#if defined(BRILLO_USE_PERFETTO)
+
+PERFETTO_DEFINE_CATEGORIES_IN_NAMESPACE_WITH_ATTRS(
+    brillo::tracing,
+    BRILLO_EXPORT,
+    perfetto::Category(brillo::kTraceCategoryTask)
+        .SetDescription("Tasks run by brillo::Daemon"),
+    perfetto::Category(brillo::kTraceCategoryDBus)
+        .SetDescription("D-Bus methods and signals of brillo::DBusObject"),
+    perfetto::Category(brillo::kTraceCategoryProcess)
+        .SetDescription("Processes spawned by brillo::Process"),
+    perfetto::Category(brillo::kTraceCategoryHttp)
+        .SetDescription("HTTP requests of brillo::http::Request"));
+
+// Emits a span covering the rest of the enclosing scope.
+#define BRILLO_TRACE_EVENT(category, name, ...)                     \
+  PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(::brillo::tracing); \
+  TRACE_EVENT(category, name, ##__VA_ARGS__)
+
+// Begins and ends a span explicitly, e.g. on a perfetto::Track for spans
+// which don't end on the thread they started on.
+#define BRILLO_TRACE_EVENT_BEGIN(category, name, ...)                 \
+  do {                                                                \
+    PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(::brillo::tracing); \
+    TRACE_EVENT_BEGIN(category, name, ##__VA_ARGS__);                 \
+  } while (0)
+#define BRILLO_TRACE_EVENT_END(category, ...)                         \
+  do {                                                                \
+    PERFETTO_USE_CATEGORIES_FROM_NAMESPACE_SCOPED(::brillo::tracing); \
+    TRACE_EVENT_END(category, ##__VA_ARGS__);                         \
+  } while (0)
+
+#else  // !defined(BRILLO_USE_PERFETTO)
+
+#define BRILLO_TRACE_EVENT(category, name, ...)
+#define BRILLO_TRACE_EVENT_BEGIN(category, name, ...) \
+  do {                                                \
+  } while (0)
+#define BRILLO_TRACE_EVENT_END(category, ...) \
+  do {                                        \
+  } while (0)
+
+#endif  // defined(BRILLO_USE_PERFETTO)
+
+#endif  // LIBBRILLO_BRILLO_TRACING_H_
@@ -0,0 +1,83 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <brillo/tracing.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "brillo/process/process.h"
+
+namespace brillo {
+
+// Captures the libbrillo track events with an in-process tracing session.
+class TracingTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    InitializeTracing(/*in_process_backend=*/true);
+    StartSession();
+  }
+
+  void StartSession() {
+    perfetto::TraceConfig config;
+    config.add_buffers()->set_size_kb(1024);
+    auto* ds_config = config.add_data_sources()->mutable_config();
+    ds_config->set_name("track_event");
+    session_ = perfetto::Tracing::NewTrace(perfetto::kInProcessBackend);
+    session_->Setup(config);
+    session_->StartBlocking();
+  }
+
+  // Stops the session and returns the serialized trace.
+  std::string StopAndReadTrace() {
+    tracing::TrackEvent::Flush();
+    session_->StopBlocking();
+    std::vector<char> trace = session_->ReadTraceBlocking();
+    return std::string(trace.begin(), trace.end());
+  }
+
+  std::unique_ptr<perfetto::TracingSession> session_;
+};
+
+TEST_F(TracingTest, ScopedEvent) {
+  {
+    BRILLO_TRACE_EVENT(kTraceCategoryTask, "TracingTestScopedEvent", "answer",
+                       42);
+  }
+  std::string trace = StopAndReadTrace();
+  EXPECT_NE(std::string::npos, trace.find("TracingTestScopedEvent"));
+  EXPECT_NE(std::string::npos, trace.find(kTraceCategoryTask));
+}
+
+TEST_F(TracingTest, AsyncEvent) {
+  const perfetto::Track track(1234);
+  BRILLO_TRACE_EVENT_BEGIN(kTraceCategoryHttp, "TracingTestAsyncEvent", track);
+  BRILLO_TRACE_EVENT_END(kTraceCategoryHttp, track);
+  std::string trace = StopAndReadTrace();
+  EXPECT_NE(std::string::npos, trace.find("TracingTestAsyncEvent"));
+}
+
+TEST_F(TracingTest, ProcessStart) {
+  ProcessImpl process;
+  process.AddArg("/bin/true");
+  EXPECT_EQ(0, process.Run());
+  std::string trace = StopAndReadTrace();
+  EXPECT_NE(std::string::npos, trace.find(kTraceCategoryProcess));
+  EXPECT_NE(std::string::npos, trace.find("/bin/true"));
+}
+
+TEST_F(TracingTest, EventsOutsideSessionAreDropped) {
+  StopAndReadTrace();
+  {
+    BRILLO_TRACE_EVENT(kTraceCategoryTask, "TracingTestDroppedEvent");
+  }
+  StartSession();
+  std::string trace = StopAndReadTrace();
+  EXPECT_EQ(std::string::npos, trace.find("TracingTestDroppedEvent"));
+}
+
+}  // namespace brillo
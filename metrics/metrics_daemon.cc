@@ -343,42 +343,33 @@ void MetricsDaemon::Init(bool testing,
   // Sysconf cannot fail, so no sanity checks are needed.
   ticks_per_second_ = sysconf(_SC_CLK_TCK);
 
-  daily_active_use_.reset(
-      new PersistentInteger(backing_dir_.Append(kDailyUseTimeName)));
-  version_cumulative_active_use_.reset(
-      new PersistentInteger(backing_dir_.Append(kCumulativeUseTimeName)));
-  version_cumulative_cpu_use_.reset(
-      new PersistentInteger(backing_dir_.Append(kCumulativeCpuTimeName)));
-  kernel_crash_interval_.reset(
-      new PersistentInteger(backing_dir_.Append(kKernelCrashIntervalName)));
-  unclean_shutdown_interval_.reset(
-      new PersistentInteger(backing_dir_.Append(kUncleanShutdownIntervalName)));
-  user_crash_interval_.reset(
-      new PersistentInteger(backing_dir_.Append(kUserCrashIntervalName)));
-  any_crashes_daily_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kAnyCrashesDailyName)));
-  any_crashes_weekly_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kAnyCrashesWeeklyName)));
-  user_crashes_daily_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kUserCrashesDailyName)));
-  user_crashes_weekly_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kUserCrashesWeeklyName)));
-  kernel_crashes_daily_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kKernelCrashesDailyName)));
-  kernel_crashes_weekly_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kKernelCrashesWeeklyName)));
-  kernel_crashes_version_count_.reset(new PersistentInteger(
-      backing_dir_.Append(kKernelCrashesSinceUpdateName)));
-  unclean_shutdowns_daily_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kUncleanShutdownsDailyName)));
-  unclean_shutdowns_weekly_count_.reset(
-      new PersistentInteger(backing_dir_.Append(kUncleanShutdownsWeeklyName)));
-
-  daily_cycle_.reset(new PersistentInteger(backing_dir_.Append("daily.cycle")));
-  weekly_cycle_.reset(
-      new PersistentInteger(backing_dir_.Append("weekly.cycle")));
-  version_cycle_.reset(
-      new PersistentInteger(backing_dir_.Append("version.cycle")));
+  persistent_integer_store_ = PersistentIntegerStore::Open(backing_dir_);
+  daily_active_use_ = CreatePersistentInteger(kDailyUseTimeName);
+  version_cumulative_active_use_ =
+      CreatePersistentInteger(kCumulativeUseTimeName);
+  version_cumulative_cpu_use_ = CreatePersistentInteger(kCumulativeCpuTimeName);
+  kernel_crash_interval_ = CreatePersistentInteger(kKernelCrashIntervalName);
+  unclean_shutdown_interval_ =
+      CreatePersistentInteger(kUncleanShutdownIntervalName);
+  user_crash_interval_ = CreatePersistentInteger(kUserCrashIntervalName);
+  any_crashes_daily_count_ = CreatePersistentInteger(kAnyCrashesDailyName);
+  any_crashes_weekly_count_ = CreatePersistentInteger(kAnyCrashesWeeklyName);
+  user_crashes_daily_count_ = CreatePersistentInteger(kUserCrashesDailyName);
+  user_crashes_weekly_count_ = CreatePersistentInteger(kUserCrashesWeeklyName);
+  kernel_crashes_daily_count_ =
+      CreatePersistentInteger(kKernelCrashesDailyName);
+  kernel_crashes_weekly_count_ =
+      CreatePersistentInteger(kKernelCrashesWeeklyName);
+  kernel_crashes_version_count_ =
+      CreatePersistentInteger(kKernelCrashesSinceUpdateName);
+  unclean_shutdowns_daily_count_ =
+      CreatePersistentInteger(kUncleanShutdownsDailyName);
+  unclean_shutdowns_weekly_count_ =
+      CreatePersistentInteger(kUncleanShutdownsWeeklyName);
+
+  daily_cycle_ = CreatePersistentInteger("daily.cycle");
+  weekly_cycle_ = CreatePersistentInteger("weekly.cycle");
+  version_cycle_ = CreatePersistentInteger("version.cycle");
 
   diskstats_path_ = diskstats_path;
   vmstats_path_ = vmstats_path;
@@ -904,9 +895,10 @@ void MetricsDaemon::ReportProcessMemoryCallback(base::TimeDelta wait) {
 void MetricsDaemon::ReportProcessMemory() {
   base::FilePath procfs_path("/proc");
   base::FilePath run_path("/run");
-  ProcessInfo info(procfs_path, run_path);
-  info.Collect();
-  info.Classify();
+  if (!process_info_)
+    process_info_ = std::make_unique<ProcessInfo>(procfs_path, run_path);
+  process_info_->Collect();
+  process_info_->Classify();
   for (int i = 0; i < PG_KINDS_COUNT; i++) {
     ProcessGroupKind kind = static_cast<ProcessGroupKind>(i);
     ProcessMemoryStats stats;
@@ -919,7 +911,7 @@ void MetricsDaemon::ReportProcessMemory() {
                           sizeof(*kProcessMemoryUMANames[i]) ==
                       sizeof(stats.rss_sizes) / sizeof(*stats.rss_sizes),
                   "RSS array size mismatch");
-    AccumulateProcessGroupStats(procfs_path, info.GetGroup(kind), &stats);
+    process_info_->AccumulateGroupStats(kind, &stats);
     ReportProcessGroupStats(kProcessMemoryUMANames[i], stats);
   }
 }
@@ -1417,6 +1409,12 @@ void MetricsDaemon::SendAndResetDailyUseSample() {
              50);             // number of buckets
 }
 
+std::unique_ptr<PersistentInteger> MetricsDaemon::CreatePersistentInteger(
+    const std::string& name) {
+  return std::make_unique<PersistentInteger>(backing_dir_.Append(name),
+                                             persistent_integer_store_.get());
+}
+
 void MetricsDaemon::SendAndResetCrashIntervalSample(
     const std::unique_ptr<PersistentInteger>& interval,
     const std::string& name) {
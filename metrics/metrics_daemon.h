@@ -19,6 +19,7 @@
 
 #include "metrics/metrics_library.h"
 #include "metrics/persistent_integer.h"
+#include "metrics/persistent_integer_store.h"
 #include "metrics/process_meter.h"
 #include "metrics/vmlog_writer.h"
 #include "uploader/upload_service.h"
@@ -235,6 +236,11 @@ class MetricsDaemon : public brillo::DBusDaemon {
   // for a 24-hour period and reset |use|.
   void SendAndResetDailyUseSample();
 
+  // Returns the persistent integer |name| of |backing_dir_|, held in
+  // |persistent_integer_store_| if it could be opened.
+  std::unique_ptr<PersistentInteger> CreatePersistentInteger(
+      const std::string& name);
+
   // Sends a sample representing a time interval between two crashes of the
   // same type and reset |interval|.
   void SendAndResetCrashIntervalSample(
@@ -414,6 +420,13 @@ class MetricsDaemon : public brillo::DBusDaemon {
   uint64_t detachable_base_active_time_;
   uint64_t detachable_base_suspended_time_;
 
+  // The processes sampled by ReportProcessMemory, kept between reports so
+  // that unchanged processes aren't read again.
+  std::unique_ptr<ProcessInfo> process_info_;
+
+  // Holds the persistent values below, which must not outlive it.
+  std::unique_ptr<PersistentIntegerStore> persistent_integer_store_;
+
   // Persistent values and accumulators for crash statistics.
   std::unique_ptr<PersistentInteger> daily_cycle_;
   std::unique_ptr<PersistentInteger> weekly_cycle_;
@@ -10,11 +10,13 @@
 #include <base/callback.h>
 #include <base/check.h>
 #include <base/files/file.h>
+#include <base/files/file_util.h>
 #include <base/logging.h>
 #include <base/posix/eintr_wrapper.h>
 #include <base/strings/string_util.h>
 
 #include "metrics/metrics_library.h"
+#include "metrics/persistent_integer_store.h"
 
 namespace chromeos_metrics {
 
@@ -36,20 +38,35 @@ base::RepeatingCallback<void(const base::FilePath&)>* GetCreationCallback() {
 bool PersistentInteger::testing_ = false;
 
 PersistentInteger::PersistentInteger(const base::FilePath& backing_file_path)
+    : PersistentInteger(backing_file_path, nullptr) {}
+
+PersistentInteger::PersistentInteger(const base::FilePath& backing_file_path,
+                                     PersistentIntegerStore* store)
     : path_(backing_file_path), synced_(false), value_(0), version_(kVersion) {
   if (!GetCreationCallback()->is_null()) {
     GetCreationCallback()->Run(backing_file_path);
   }
+  if (store)
+    BindToStore(store);
 }
 
 PersistentInteger::~PersistentInteger() {}
 
 void PersistentInteger::Set(int64_t value) {
   value_ = value;
+  if (stored_value_) {
+    stored_value_->store(value, std::memory_order_relaxed);
+    store_->OnUpdate();
+    return;
+  }
   Write();
 }
 
 int64_t PersistentInteger::Get() {
+  if (stored_value_) {
+    value_ = stored_value_->load(std::memory_order_relaxed);
+    return value_;
+  }
   // If not synced, then read.  If the read fails, it's a good idea to write.
   // The write will create the file if needed.
   if (!synced_ && !Read())
@@ -109,6 +126,23 @@ bool PersistentInteger::Read() {
   return true;
 }
 
+void PersistentInteger::BindToStore(PersistentIntegerStore* store) {
+  DCHECK_EQ(path_.DirName().value(), store->path().DirName().value());
+  const std::string name = path_.BaseName().value();
+  stored_value_ = store->Find(name);
+  if (!stored_value_) {
+    // First use of the store: carry over the value of the backing file.
+    bool migrated = Read();
+    stored_value_ = store->Create(name, value_);
+    if (!stored_value_)
+      return;
+    if (migrated && !base::DeleteFile(path_))
+      PLOG(WARNING) << "cannot delete " << path_.MaybeAsASCII();
+  }
+  store_ = store;
+  synced_ = true;
+}
+
 // static
 void PersistentInteger::SetCreationCallbackForTesting(
     const base::RepeatingCallback<void(const base::FilePath&)>&
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <string>
 
 #include <base/callback_forward.h>
@@ -15,9 +16,15 @@
 
 namespace chromeos_metrics {
 
+class PersistentIntegerStore;
+
 // PersistentIntegers is a 64-bit integer value backed by a file.
 // The in-memory value acts as a write-through cache of the file value.
 // If the backing file doesn't exist or has bad content, the value is 0.
+//
+// When a PersistentIntegerStore is given, the value lives in the store
+// instead.  The backing file is then only read once, to migrate its value
+// into the store, and deleted.
 
 class PersistentInteger {
  public:
@@ -25,6 +32,11 @@ class PersistentInteger {
   // written in order to preserves the integer value across restarts of the
   // program using it.  The directory of the file must exist.
   explicit PersistentInteger(const base::FilePath& backing_file_path);
+  // |store| must be the store of the directory of |backing_file_path|, and
+  // outlive this object.  Falls back to the backing file if |store| is null
+  // or can't hold the value.
+  PersistentInteger(const base::FilePath& backing_file_path,
+                    PersistentIntegerStore* store);
   PersistentInteger(const PersistentInteger&) = delete;
   PersistentInteger& operator=(const PersistentInteger&) = delete;
 
@@ -66,10 +78,16 @@ class PersistentInteger {
   // a valid backing file as a side effect.
   bool Read();
 
+  // Finds the value in |store|, or migrates the backing file into it.
+  void BindToStore(PersistentIntegerStore* store);
+
   base::FilePath path_;
   bool synced_;
   int64_t value_;
   int32_t version_;
+  // The store holding the value, and the value in it, if any.
+  PersistentIntegerStore* store_ = nullptr;
+  std::atomic<int64_t>* stored_value_ = nullptr;
 
   static bool testing_;
 };
@@ -0,0 +1,83 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/check.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/strings/string_number_conversions.h>
+#include <benchmark/benchmark.h>
+
+#include "metrics/persistent_integer.h"
+#include "metrics/persistent_integer_store.h"
+
+namespace chromeos_metrics {
+namespace {
+
+// The size of a per-file backing file: a version and a value.
+constexpr int kBackingFileSize = sizeof(int32_t) + sizeof(int64_t);
+
+std::vector<std::unique_ptr<PersistentInteger>> CreateIntegers(
+    const base::FilePath& dir, int count, PersistentIntegerStore* store) {
+  std::vector<std::unique_ptr<PersistentInteger>> integers;
+  for (int i = 0; i < count; ++i) {
+    integers.push_back(std::make_unique<PersistentInteger>(
+        dir.Append("Platform.Counter" + base::NumberToString(i)), store));
+  }
+  return integers;
+}
+
+// Adds to |state.range(0)| integers backed by one file each, as updated by
+// CumulativeMetrics or metrics_daemon on every cycle.
+void BM_PersistentIntegerFiles(benchmark::State& state) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  auto integers = CreateIntegers(temp_dir.GetPath(), state.range(0), nullptr);
+  for (auto _ : state) {
+    for (auto& integer : integers)
+      integer->Add(1);
+  }
+  const int64_t num_updates = state.iterations() * integers.size();
+  state.SetItemsProcessed(num_updates);
+  // Each update truncates and rewrites a whole backing file.
+  state.counters["file_writes_per_update"] = 1;
+  state.counters["bytes_written_per_update"] = kBackingFileSize;
+}
+BENCHMARK(BM_PersistentIntegerFiles)->Arg(1)->Arg(16)->Arg(64);
+
+// The same updates on integers held in a PersistentIntegerStore.
+void BM_PersistentIntegerStore(benchmark::State& state) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  auto store = PersistentIntegerStore::Open(temp_dir.GetPath());
+  CHECK(store);
+  auto integers =
+      CreateIntegers(temp_dir.GetPath(), state.range(0), store.get());
+  const PersistentIntegerStore::Stats initial_stats = store->stats();
+  for (auto _ : state) {
+    for (auto& integer : integers)
+      integer->Add(1);
+  }
+  const int64_t num_updates = state.iterations() * integers.size();
+  state.SetItemsProcessed(num_updates);
+  // Updates only reach the disk through the periodic checkpoints, which sync
+  // at most the whole store file.
+  int64_t store_size = 0;
+  CHECK(base::GetFileSize(store->path(), &store_size));
+  const uint64_t num_checkpoints =
+      store->stats().num_checkpoints - initial_stats.num_checkpoints;
+  state.counters["file_writes_per_update"] =
+      static_cast<double>(num_checkpoints) / num_updates;
+  state.counters["bytes_written_per_update"] =
+      static_cast<double>(num_checkpoints * store_size) / num_updates;
+}
+BENCHMARK(BM_PersistentIntegerStore)->Arg(1)->Arg(16)->Arg(64);
+
+}  // namespace
+}  // namespace chromeos_metrics
+
+BENCHMARK_MAIN();
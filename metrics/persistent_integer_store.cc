@@ -0,0 +1,168 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "metrics/persistent_integer_store.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include <utility>
+
+#include <base/check.h>
+#include <base/files/file.h>
+#include <base/logging.h>
+
+namespace chromeos_metrics {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x50495354;  // "PIST"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kCommitted = 1;
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entry_size;
+  uint32_t max_entries;
+  uint8_t padding[48];
+};
+
+// An entry is only valid once |committed| is kCommitted, which is stored
+// after |name| and the initial |value|.
+struct Entry {
+  std::atomic<uint32_t> committed;
+  uint32_t name_length;
+  char name[PersistentIntegerStore::kMaxNameLength + 1];
+  std::atomic<int64_t> value;
+};
+
+static_assert(sizeof(Header) == 64, "unexpected header size");
+static_assert(sizeof(Entry) == 64, "unexpected entry size");
+static_assert(std::atomic<int64_t>::is_always_lock_free,
+              "values must be lock free to live in a shared mapping");
+
+constexpr size_t kFileSize =
+    sizeof(Header) + PersistentIntegerStore::kMaxEntries * sizeof(Entry);
+
+Header* GetHeader(const base::MemoryMappedFile& mapping) {
+  return reinterpret_cast<Header*>(mapping.data());
+}
+
+Entry* GetEntries(const base::MemoryMappedFile& mapping) {
+  return reinterpret_cast<Entry*>(mapping.data() + sizeof(Header));
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<PersistentIntegerStore> PersistentIntegerStore::Open(
+    const base::FilePath& dir) {
+  std::unique_ptr<PersistentIntegerStore> store(
+      new PersistentIntegerStore(dir.Append(kFileName)));
+  if (!store->Initialize())
+    return nullptr;
+  return store;
+}
+
+PersistentIntegerStore::PersistentIntegerStore(const base::FilePath& path)
+    : path_(path), last_checkpoint_time_(base::TimeTicks::Now()) {}
+
+PersistentIntegerStore::~PersistentIntegerStore() {
+  Checkpoint();
+}
+
+bool PersistentIntegerStore::Initialize() {
+  base::File file(path_, base::File::FLAG_OPEN_ALWAYS |
+                             base::File::FLAG_READ | base::File::FLAG_WRITE);
+  if (!file.IsValid()) {
+    PLOG(ERROR) << "cannot open " << path_.MaybeAsASCII();
+    return false;
+  }
+  if (file.GetLength() != static_cast<int64_t>(kFileSize) &&
+      !file.SetLength(kFileSize)) {
+    PLOG(ERROR) << "cannot resize " << path_.MaybeAsASCII();
+    return false;
+  }
+  if (!mapping_.Initialize(std::move(file),
+                           base::MemoryMappedFile::READ_WRITE)) {
+    LOG(ERROR) << "cannot map " << path_.MaybeAsASCII();
+    return false;
+  }
+
+  Header* h = GetHeader(mapping_);
+  if (h->magic != kMagic || h->version != kVersion ||
+      h->entry_size != sizeof(Entry) || h->max_entries != kMaxEntries) {
+    // A new or foreign file.  The magic is written last, so that a crash
+    // here leaves a file that is initialized again on the next run.
+    memset(mapping_.data(), 0, kFileSize);
+    h->version = kVersion;
+    h->entry_size = sizeof(Entry);
+    h->max_entries = kMaxEntries;
+    h->magic = kMagic;
+    return true;
+  }
+
+  Entry* entries = GetEntries(mapping_);
+  while (num_entries_ < kMaxEntries &&
+         entries[num_entries_].committed.load(std::memory_order_acquire) ==
+             kCommitted) {
+    ++num_entries_;
+  }
+  // Clear a creation that was interrupted by a crash.
+  if (num_entries_ < kMaxEntries) {
+    memset(static_cast<void*>(&entries[num_entries_]), 0,
+           (kMaxEntries - num_entries_) * sizeof(Entry));
+  }
+  return true;
+}
+
+std::atomic<int64_t>* PersistentIntegerStore::Find(base::StringPiece name) {
+  for (size_t i = 0; i < num_entries_; ++i) {
+    Entry& entry = GetEntries(mapping_)[i];
+    if (base::StringPiece(entry.name, entry.name_length) == name)
+      return &entry.value;
+  }
+  return nullptr;
+}
+
+std::atomic<int64_t>* PersistentIntegerStore::Create(base::StringPiece name,
+                                                     int64_t initial_value) {
+  DCHECK(!Find(name));
+  if (name.size() > kMaxNameLength) {
+    LOG(WARNING) << "name too long for " << path_.MaybeAsASCII() << ": "
+                 << name;
+    return nullptr;
+  }
+  if (num_entries_ == kMaxEntries) {
+    LOG(WARNING) << path_.MaybeAsASCII() << " is full";
+    return nullptr;
+  }
+  Entry& entry = GetEntries(mapping_)[num_entries_];
+  entry.name_length = name.size();
+  memcpy(entry.name, name.data(), name.size());
+  entry.value.store(initial_value, std::memory_order_relaxed);
+  entry.committed.store(kCommitted, std::memory_order_release);
+  ++num_entries_;
+  OnUpdate();
+  return &entry.value;
+}
+
+void PersistentIntegerStore::OnUpdate() {
+  ++stats_.num_updates;
+  if (base::TimeTicks::Now() - last_checkpoint_time_ >= kCheckpointInterval)
+    Checkpoint();
+}
+
+bool PersistentIntegerStore::Checkpoint() {
+  last_checkpoint_time_ = base::TimeTicks::Now();
+  ++stats_.num_checkpoints;
+  if (msync(mapping_.data(), mapping_.length(), MS_SYNC) != 0) {
+    PLOG(ERROR) << "cannot sync " << path_.MaybeAsASCII();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace chromeos_metrics
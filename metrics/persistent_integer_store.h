@@ -0,0 +1,101 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef METRICS_PERSISTENT_INTEGER_STORE_H_
+#define METRICS_PERSISTENT_INTEGER_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+
+#include <base/files/file_path.h>
+#include <base/files/memory_mapped_file.h>
+#include <base/strings/string_piece.h>
+#include <base/time/time.h>
+
+namespace chromeos_metrics {
+
+// PersistentIntegerStore keeps the values of the PersistentIntegers of a
+// directory in a single memory-mapped file, instead of one file per integer.
+// Updating a value is a store to the shared mapping: the kernel writes the
+// dirty page back, and the store msync()s it at most every
+// |kCheckpointInterval|, so a burst of updates costs no system call.
+//
+// The file stays consistent if the process dies at any point.  Values are
+// 64-bit aligned words that are never torn, and a new entry only becomes
+// visible once its name and initial value are written.
+//
+// The store must only be used by one process at a time, like the per-file
+// PersistentIntegers it replaces.  It is not thread-safe.
+//
+// The store is opt-in, since it needs ftruncate(), mmap() and msync(), which
+// the seccomp policies of some users of libmetrics don't allow.  Only
+// metrics_daemon, which runs without a seccomp policy, uses one;
+// CumulativeMetrics, used by sandboxed daemons such as ml_service and hpsd,
+// keeps one file per integer.
+class PersistentIntegerStore {
+ public:
+  // The name of the store file in the directory.
+  static constexpr char kFileName[] = "persistent_integers.store";
+  static constexpr size_t kMaxEntries = 255;
+  // Longer names don't fit in an entry.
+  static constexpr size_t kMaxNameLength = 47;
+  static constexpr base::TimeDelta kCheckpointInterval = base::Minutes(1);
+
+  struct Stats {
+    // The number of values updated.
+    uint64_t num_updates = 0;
+    // The number of times the file was synced to disk.
+    uint64_t num_checkpoints = 0;
+  };
+
+  // Opens the store of |dir|, creating it if needed.  Returns nullptr on
+  // failure, in which case the caller should keep using per-file integers.
+  static std::unique_ptr<PersistentIntegerStore> Open(
+      const base::FilePath& dir);
+
+  PersistentIntegerStore(const PersistentIntegerStore&) = delete;
+  PersistentIntegerStore& operator=(const PersistentIntegerStore&) = delete;
+
+  // Checkpoints the store.
+  ~PersistentIntegerStore();
+
+  // Returns the value of |name|, or nullptr if there is no such entry.  The
+  // pointer is valid for the lifetime of the store.
+  std::atomic<int64_t>* Find(base::StringPiece name);
+
+  // Adds an entry for |name| set to |initial_value|, and returns its value.
+  // Returns nullptr if |name| is too long or the store is full.
+  std::atomic<int64_t>* Create(base::StringPiece name, int64_t initial_value);
+
+  // Must be called after a value returned by Find() or Create() is changed.
+  // Checkpoints the store if |kCheckpointInterval| has elapsed since the
+  // last checkpoint.
+  void OnUpdate();
+
+  // Syncs the store file to disk.  Returns false on failure.
+  bool Checkpoint();
+
+  const base::FilePath& path() const { return path_; }
+  const Stats& stats() const { return stats_; }
+
+ private:
+  explicit PersistentIntegerStore(const base::FilePath& path);
+
+  // Maps the store file, and initializes it if it isn't a valid store.
+  bool Initialize();
+
+  const base::FilePath path_;
+  base::MemoryMappedFile mapping_;
+  // The number of committed entries, which are all at the start of the file.
+  size_t num_entries_ = 0;
+  base::TimeTicks last_checkpoint_time_;
+  Stats stats_;
+};
+
+}  // namespace chromeos_metrics
+
+#endif  // METRICS_PERSISTENT_INTEGER_STORE_H_
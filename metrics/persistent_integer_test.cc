@@ -3,16 +3,20 @@
 // found in the LICENSE file.
 
 #include <memory>
+#include <string>
 
 #include <gtest/gtest.h>
 
 #include <base/check.h>
 #include <base/compiler_specific.h>
+#include <base/files/file_util.h>
 #include <base/files/scoped_temp_dir.h>
 
 #include "metrics/persistent_integer.h"
+#include "metrics/persistent_integer_store.h"
 
 using chromeos_metrics::PersistentInteger;
+using chromeos_metrics::PersistentIntegerStore;
 
 class PersistentIntegerTest : public testing::Test {};
 
@@ -49,3 +53,85 @@ TEST_F(PersistentIntegerTest, BasicChecks) {
   pi.reset(new PersistentInteger(backing_path));
   EXPECT_EQ(0, pi->Get());
 }
+
+TEST_F(PersistentIntegerTest, StoreChecks) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  const base::FilePath backing_path = temp_dir.GetPath().Append("xyz");
+  auto store = PersistentIntegerStore::Open(temp_dir.GetPath());
+  ASSERT_TRUE(store);
+  auto pi = std::make_unique<PersistentInteger>(backing_path, store.get());
+
+  EXPECT_EQ(0, pi->Get());
+  pi->Set(2);
+  pi->Add(3);
+  pi->Max(4);
+  EXPECT_EQ(5, pi->Get());
+  // The value lives in the store, not in a backing file.
+  EXPECT_FALSE(base::PathExists(backing_path));
+  // Creating the entry, then Set(), Add() and Max().
+  EXPECT_EQ(4u, store->stats().num_updates);
+
+  // Test persistence across instances and reopening the store.
+  pi.reset(new PersistentInteger(backing_path, store.get()));
+  EXPECT_EQ(5, pi->Get());
+  pi.reset();
+  store = PersistentIntegerStore::Open(temp_dir.GetPath());
+  ASSERT_TRUE(store);
+  pi.reset(new PersistentInteger(backing_path, store.get()));
+  EXPECT_EQ(5, pi->GetAndClear());
+  EXPECT_EQ(0, pi->Get());
+}
+
+TEST_F(PersistentIntegerTest, StoreMigration) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  const base::FilePath backing_path = temp_dir.GetPath().Append("xyz");
+  PersistentInteger(backing_path).Set(7);
+  ASSERT_TRUE(base::PathExists(backing_path));
+
+  auto store = PersistentIntegerStore::Open(temp_dir.GetPath());
+  ASSERT_TRUE(store);
+  auto pi = std::make_unique<PersistentInteger>(backing_path, store.get());
+  EXPECT_EQ(7, pi->Get());
+  // The backing file is gone once migrated.
+  EXPECT_FALSE(base::PathExists(backing_path));
+
+  pi->Add(1);
+  pi.reset(new PersistentInteger(backing_path, store.get()));
+  EXPECT_EQ(8, pi->Get());
+}
+
+TEST_F(PersistentIntegerTest, StoreFallback) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  // The name doesn't fit in the store, so the backing file is used.
+  const base::FilePath backing_path = temp_dir.GetPath().Append(
+      std::string(PersistentIntegerStore::kMaxNameLength + 1, 'x'));
+  auto store = PersistentIntegerStore::Open(temp_dir.GetPath());
+  ASSERT_TRUE(store);
+  auto pi = std::make_unique<PersistentInteger>(backing_path, store.get());
+  pi->Set(3);
+  EXPECT_TRUE(base::PathExists(backing_path));
+  pi.reset(new PersistentInteger(backing_path, store.get()));
+  EXPECT_EQ(3, pi->Get());
+}
+
+TEST_F(PersistentIntegerTest, StoreRecoversFromBadFile) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  const base::FilePath store_path =
+      temp_dir.GetPath().Append(PersistentIntegerStore::kFileName);
+  ASSERT_EQ(4, base::WriteFile(store_path, "junk", 4));
+
+  auto store = PersistentIntegerStore::Open(temp_dir.GetPath());
+  ASSERT_TRUE(store);
+  EXPECT_EQ(nullptr, store->Find("xyz"));
+  ASSERT_NE(nullptr, store->Create("xyz", 9));
+  EXPECT_TRUE(store->Checkpoint());
+
+  store = PersistentIntegerStore::Open(temp_dir.GetPath());
+  ASSERT_TRUE(store);
+  ASSERT_NE(nullptr, store->Find("xyz"));
+  EXPECT_EQ(9, store->Find("xyz")->load());
+}
@@ -43,7 +43,7 @@ int PrintProcessGroupStats() {
   for (int i = 0; i < PG_KINDS_COUNT; i++) {
     ProcessMemoryStats stats;
     ProcessGroupKind kind = static_cast<ProcessGroupKind>(i);
-    AccumulateProcessGroupStats(procfs_path, info.GetGroup(kind), &stats);
+    info.AccumulateGroupStats(kind, &stats);
     std::cout << base::StringPrintf("%-9s %5" PRIu64 " %5" PRIu64 " %5" PRIu64
                                     " %5" PRIu64 " %5" PRIu64,
                                     kGroupNames[i],
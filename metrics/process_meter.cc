@@ -5,22 +5,27 @@
 #include "metrics/process_meter.h"
 
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <base/callback.h>
 #include <base/check_op.h>
 #include <base/command_line.h>
-#include <base/files/file_enumerator.h>
 #include <base/files/file_path.h>
 #include <base/files/file_util.h>
 #include <base/logging.h>
+#include <base/posix/eintr_wrapper.h>
 #include <base/strings/string_number_conversions.h>
+#include <base/strings/string_piece.h>
 #include <base/strings/string_split.h>
 #include <base/strings/string_util.h>
 #include <base/strings/stringprintf.h>
+#include <brillo/files/scoped_dir.h>
 #include <gtest/gtest_prod.h>  // for FRIEND_TEST
 #include <re2/re2.h>
 
@@ -41,6 +46,41 @@ bool IsNotArcVmProcess(const ProcessNode& node) {
   return !IsArcVmProcess(node);
 }
 
+// stat: pid (comm) run_state ppid etc. The only parentheses in the file
+// are around <comm>.
+constexpr LazyRE2 kStatRegexp = {R"(.*\((.*)\) \w+ (\d+)((.|\n)*))"};
+
+// Indexes of the utime, stime, starttime and rss fields of /proc/<pid>/stat,
+// counting from the field after ppid.
+constexpr size_t kStatUtimeIndex = 9;
+constexpr size_t kStatStimeIndex = 10;
+constexpr size_t kStatStartTimeIndex = 17;
+constexpr size_t kStatRssIndex = 19;
+
+// Opens the file |name| of process |pid| in the /proc open as |procfs_fd|.
+base::ScopedFD OpenProcessFile(int procfs_fd, int pid, const char* name) {
+  const std::string path = base::StringPrintf("%d/%s", pid, name);
+  return base::ScopedFD(
+      HANDLE_EINTR(openat(procfs_fd, path.c_str(), O_RDONLY | O_CLOEXEC)));
+}
+
+// Reads the whole file open as |fd| into |contents|, so that a file kept open
+// can be read again.
+bool ReadFromStart(int fd, std::string* contents) {
+  contents->clear();
+  char buffer[4096];
+  off_t offset = 0;
+  while (true) {
+    const ssize_t n = HANDLE_EINTR(pread(fd, buffer, sizeof(buffer), offset));
+    if (n < 0)
+      return false;
+    if (n == 0)
+      return true;
+    contents->append(buffer, n);
+    offset += n;
+  }
+}
+
 }  // namespace
 
 // UMA histogram names for process memory usage, split by process groups and
@@ -199,9 +239,19 @@ void ProcessNode::CollectSubtree(std::vector<ProcessNode*>* processes,
 }
 
 void ProcessInfo::Classify() {
-  // Find all ARC processes starting from ARC init.
+  // ARC may have restarted without other changes to the process tree.
   int arc_init_pid;
-  if (GetARCInitPID(run_root_, &arc_init_pid)) {
+  if (!GetARCInitPID(run_root_, &arc_init_pid))
+    arc_init_pid = 0;
+  if (classified_ && arc_init_pid == arc_init_pid_)
+    return;
+  classified_ = true;
+  arc_init_pid_ = arc_init_pid;
+  for (auto& group : groups_)
+    group.clear();
+
+  // Find all ARC processes starting from ARC init.
+  if (arc_init_pid != 0) {
     if (process_map_.find(arc_init_pid) == process_map_.end()) {
       LOG(WARNING) << "ARC init disappeared";
     } else {
@@ -227,7 +277,8 @@ void ProcessInfo::Classify() {
   // Find the browser process.
   ProcessNode* browser_process = nullptr;
   for (const auto& pit : process_map_) {
-    if (GetChromeKind(pit.second->GetCmdline()) == CHROME_BROWSER) {
+    if (pit.second->is_valid() &&
+        pit.second->chrome_kind() == CHROME_BROWSER) {
       browser_process = pit.second.get();
     }
   }
@@ -239,7 +290,7 @@ void ProcessInfo::Classify() {
 
   // Classify the chrome processes.
   for (const auto& process : chrome_processes) {
-    switch (GetChromeKind(process->GetCmdline())) {
+    switch (process->chrome_kind()) {
       case CHROME_RENDERER:
         groups_[PG_RENDERERS].push_back(process);
         break;
@@ -285,39 +336,116 @@ void ProcessInfo::Classify() {
   }
 }
 
-bool ProcessNode::RetrieveProcessData(const base::FilePath& procfs_root) {
+bool ProcessNode::Refresh(int procfs_fd,
+                          bool keep_stat_fd,
+                          ProcfsReadStats* stats) {
+  const bool was_valid = valid_;
+  valid_ = false;
+
+  // Get PPID, name, and the fields that tell whether the process changed, from
+  // /proc/#/stat.
   std::string file_content;
-  // Get PPID and name from /proc/#/stat.
-  const std::string stat_name = base::StringPrintf("%d/stat", pid_);
-  const base::FilePath stat_path = procfs_root.Append(stat_name);
-  if (!base::ReadFileToString(stat_path, &file_content)) {
+  if (!ReadStat(procfs_fd, keep_stat_fd, stats, &file_content)) {
     // Assume process has exited.
-    return false;
+    memory_stats_.reset();
+    return was_valid;
   }
-  // stat: pid (comm) run_state ppid etc. The only parentheses in the file
-  // are around <comm>.
-  RE2 re(R"(.*\((.*)\) \w+ (\d+)(.|\n)*)");
-  if (!RE2::FullMatch(file_content, re, &name_, &ppid_)) {
+  std::string name;
+  int ppid;
+  std::string tail;
+  if (!RE2::FullMatch(file_content, *kStatRegexp, &name, &ppid, &tail)) {
     // Since there's no guarantees about a processes name -- it might not
     // be UTF-8, for example -- this is just a warning.
     LOG(WARNING) << "cannot parse /proc/pid/stat: " << file_content;
-    return false;
+    memory_stats_.reset();
+    return was_valid;
+  }
+  const std::vector<base::StringPiece> fields = base::SplitStringPiece(
+      tail, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  uint64_t utime, stime;
+  uint64_t start_time = 0;
+  uint64_t rss_pages = 0;
+  if (fields.size() <= kStatRssIndex ||
+      !base::StringToUint64(fields[kStatUtimeIndex], &utime) ||
+      !base::StringToUint64(fields[kStatStimeIndex], &stime) ||
+      !base::StringToUint64(fields[kStatStartTimeIndex], &start_time) ||
+      !base::StringToUint64(fields[kStatRssIndex], &rss_pages)) {
+    utime = stime = start_time = rss_pages = 0;
   }
 
-  // Get command line from /proc/#/cmdline and parse it.
-  const std::string cmdline_name = base::StringPrintf("%d/cmdline", pid_);
-  const base::FilePath cmdline_path = procfs_root.Append(cmdline_name);
-  if (!base::ReadFileToString(cmdline_path, &file_content)) {
-    // Assume process has exited.
-    return false;
+  if (start_time == 0 || start_time != start_time_) {
+    // Either the PID was reused by a new process, or there's no telling
+    // whether it was.
+    cmdline_stable_ = false;
+    memory_stats_.reset();
+  }
+  if (name != name_) {
+    // The process exec'd.
+    cmdline_stable_ = false;
   }
-  cmdline_string_ = file_content;
-  cmdline_ = base::CommandLine(base::SplitString(
-      file_content, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY));
+  if (utime + stime != cpu_time_ || rss_pages != rss_pages_) {
+    // The process ran or changed size, and its memory usage probably changed.
+    memory_stats_.reset();
+  }
+  bool changed = !was_valid || ppid != ppid_;
+  name_ = std::move(name);
+  ppid_ = ppid;
+  start_time_ = start_time;
+  cpu_time_ = utime + stime;
+  rss_pages_ = rss_pages;
+
+  // Get command line from /proc/#/cmdline and parse it.  New processes may
+  // still rewrite it, so it is read until two reads agree.
+  if (!cmdline_stable_) {
+    base::ScopedFD fd = OpenProcessFile(procfs_fd, pid_, "cmdline");
+    ++stats->file_opens;
+    ++stats->cmdline_reads;
+    if (!fd.is_valid() || !ReadFromStart(fd.get(), &file_content)) {
+      // Assume process has exited.
+      return was_valid;
+    }
+    if (was_valid && file_content == cmdline_string_) {
+      cmdline_stable_ = true;
+    } else {
+      cmdline_string_ = file_content;
+      cmdline_ = base::CommandLine(base::SplitString(
+          file_content, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY));
+      chrome_kind_ = GetChromeKind(cmdline_);
+      changed = true;
+    }
+  }
+
+  valid_ = true;
+  return changed;
+}
 
+bool ProcessNode::ReadStat(int procfs_fd,
+                           bool keep_stat_fd,
+                           ProcfsReadStats* stats,
+                           std::string* contents) {
+  ++stats->stat_reads;
+  // Reading a kept stat file fails once its process has exited, even if the
+  // PID was reused since.  The file of the new process is then opened.
+  if (stat_fd_.is_valid() && ReadFromStart(stat_fd_.get(), contents))
+    return true;
+  stat_fd_.reset();
+  base::ScopedFD fd = OpenProcessFile(procfs_fd, pid_, "stat");
+  ++stats->file_opens;
+  if (!fd.is_valid() || !ReadFromStart(fd.get(), contents))
+    return false;
+  if (keep_stat_fd)
+    stat_fd_ = std::move(fd);
   return true;
 }
 
+const ProcessMemoryStats* ProcessNode::GetCachedMemoryStats() const {
+  return memory_stats_ ? &*memory_stats_ : nullptr;
+}
+
+void ProcessNode::SetCachedMemoryStats(const ProcessMemoryStats& stats) {
+  memory_stats_ = stats;
+}
+
 void ProcessNode::LinkToParent(
     const std::unordered_map<int, std::unique_ptr<ProcessNode>>& processes) {
   if (ppid_ == 0) {
@@ -328,49 +456,105 @@ void ProcessNode::LinkToParent(
   if (pit == processes.end()) {
     // Parent process does not exist.  This might happen on a race, before the
     // orphan is reparented to init.  At worst, this should be rare.  We do the
-    // reparenting for consistency.
+    // reparenting for consistency.  |ppid_| is kept, so that the next refresh
+    // sees the actual reparenting as a change.
     LOG(WARNING) << "PID " << pid_ << ": parent " << ppid_ << " not found";
-    ppid_ = 1;
-    pit = processes.find(ppid_);
+    pit = processes.find(1);
   }
   // |pit| is now guaranteed to be valid.
   parent_ = pit->second.get();
   parent_->children_.push_back(this);
 }
 
+void ProcessNode::ClearLinks() {
+  parent_ = nullptr;
+  children_.clear();
+}
+
 void ProcessInfo::Collect() {
-  // Collect all processes.
-  base::FileEnumerator proc_enum(procfs_root_, false,
-                                 base::FileEnumerator::DIRECTORIES);
-  for (base::FilePath path = proc_enum.Next(); !path.empty();
-       path = proc_enum.Next()) {
-    std::string pid_string = path.BaseName().MaybeAsASCII();
+  if (!procfs_fd_.is_valid()) {
+    procfs_fd_.reset(HANDLE_EINTR(open(procfs_root_.value().c_str(),
+                                       O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+    if (!procfs_fd_.is_valid())
+      PLOG(FATAL) << "cannot open " << procfs_root_.value();
+  }
+  ++sample_;
+  bool tree_changed = false;
+
+  // Collect all processes.  The directory is read directly, since
+  // base::FileEnumerator would stat each of its entries.
+  brillo::ScopedDIR proc_dir(opendir(procfs_root_.value().c_str()));
+  if (!proc_dir.is_valid())
+    PLOG(FATAL) << "cannot list " << procfs_root_.value();
+  while (const dirent* entry =
+             HANDLE_EINTR_IF_EQ(readdir(proc_dir.get()), nullptr)) {
     // Skip directories that do not represent processes.
+    if (entry->d_type != DT_DIR && entry->d_type != DT_UNKNOWN)
+      continue;
     int pid;
-    if (!base::StringToInt(pid_string, &pid))
+    if (!base::StringToInt(entry->d_name, &pid))
       continue;
-    if (process_map_.find(pid) == process_map_.end()) {
-      process_map_.emplace(pid, std::make_unique<ProcessNode>(pid));
-    } else {
+    std::unique_ptr<ProcessNode>& process = process_map_[pid];
+    if (!process) {
+      process = std::make_unique<ProcessNode>(pid);
+      tree_changed = true;
+    } else if (process->last_seen_sample() == sample_) {
       // This seems rather unlikely, but just in case.
       LOG(WARNING) << "duplicate PID: " << pid;
     }
+    process->set_last_seen_sample(sample_);
+  }
+
+  // Forget the processes that exited.
+  for (auto pit = process_map_.begin(); pit != process_map_.end();) {
+    if (pit->second->last_seen_sample() != sample_) {
+      pit = process_map_.erase(pit);
+      tree_changed = true;
+    } else {
+      ++pit;
+    }
   }
 
   // Sanity check.
   if (process_map_.find(1) == process_map_.end())
     LOG(FATAL) << "cannot find init process";
 
+  // Refresh the processes.  The processes that have a stat file descriptor
+  // keep it, and others get one while fewer than kMaxStatFds are open.
+  size_t num_stat_fds = 0;
+  for (const auto& pit : process_map_) {
+    if (pit.second->has_stat_fd())
+      ++num_stat_fds;
+  }
+  for (const auto& pit : process_map_) {
+    ProcessNode* process = pit.second.get();
+    bool keep_stat_fd = process->has_stat_fd();
+    if (!keep_stat_fd && num_stat_fds < kMaxStatFds) {
+      keep_stat_fd = true;
+      ++num_stat_fds;
+    }
+    if (process->Refresh(procfs_fd_.get(), keep_stat_fd, &stats_))
+      tree_changed = true;
+  }
+  if (!tree_changed)
+    return;
+
   // Construct process tree.
+  for (const auto& pit : process_map_)
+    pit.second->ClearLinks();
   for (const auto& pit : process_map_) {
     ProcessNode* process = pit.second.get();
-    if (!process->RetrieveProcessData(procfs_root_)) {
+    if (!process->is_valid()) {
       // Process went away, so ignore it.
       continue;
     }
     // Set up parent/children links.
     process->LinkToParent(process_map_);
   }
+  // The groups may point to processes that exited.
+  classified_ = false;
+  for (auto& group : groups_)
+    group.clear();
 }
 
 const std::vector<ProcessNode*>& ProcessInfo::GetGroup(
@@ -378,6 +562,25 @@ const std::vector<ProcessNode*>& ProcessInfo::GetGroup(
   return groups_[group_kind];
 }
 
+void ProcessInfo::AccumulateGroupStats(ProcessGroupKind group_kind,
+                                       ProcessMemoryStats* stats) {
+  for (ProcessNode* process : groups_[group_kind]) {
+    if (!process->GetCachedMemoryStats()) {
+      // If GetMemoryUsage fails (which will happen if the process has
+      // exited), the cached stats are all 0 until the next refresh.
+      ProcessMemoryStats process_stats;
+      GetMemoryUsage(procfs_root_, process->GetPID(), &process_stats);
+      ++stats_.memory_reads;
+      ++stats_.file_opens;
+      process->SetCachedMemoryStats(process_stats);
+    }
+    const ProcessMemoryStats* process_stats = process->GetCachedMemoryStats();
+    for (int i = 0; i < MEM_KINDS_COUNT; i++) {
+      stats->rss_sizes[i] += process_stats->rss_sizes[i];
+    }
+  }
+}
+
 void GetMemoryUsage(const base::FilePath& procfs_path,
                     int pid,
                     ProcessMemoryStats* stats) {
@@ -5,7 +5,10 @@
 #ifndef METRICS_PROCESS_METER_H_
 #define METRICS_PROCESS_METER_H_
 
+#include <stdint.h>
+
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -13,6 +16,7 @@
 #include <base/callback_forward.h>
 #include <base/command_line.h>
 #include <base/files/file_path.h>
+#include <base/files/scoped_file.h>
 
 namespace chromeos_metrics {
 
@@ -59,9 +63,23 @@ enum ChromeProcessKind {
   CHROME_OTHER,
 };
 
+// Counts of the /proc files read by ProcessInfo.
+struct ProcfsReadStats {
+  uint64_t stat_reads = 0;
+  uint64_t cmdline_reads = 0;
+  uint64_t memory_reads = 0;
+  // Files opened for the reads above.  Reads of a kept stat file descriptor
+  // don't open a file.
+  uint64_t file_opens = 0;
+};
+
 // ProcessNode represents a process, and is used in building a process tree,
 // where each node has pointers to nodes representing the parent and children of
 // its process.
+//
+// A node is kept across samples of a ProcessInfo for as long as its PID is in
+// use.  The start time of the process tells a reused PID from the process
+// first seen with it.
 class ProcessNode {
  public:
   explicit ProcessNode(int pid)
@@ -89,26 +107,69 @@ class ProcessNode {
   void CollectSubtree(std::vector<ProcessNode*>* processes,
                       const CollectSubtreeFilter& filter);
 
-  // Fills the process node with data from /proc.
-  bool RetrieveProcessData(const base::FilePath& procfs_root);
+  // Returns the kind of chrome process, from the command line.
+  ChromeProcessKind chrome_kind() const { return chrome_kind_; }
+
+  // Returns whether the last refresh could read and parse the process data.
+  bool is_valid() const { return valid_; }
+
+  // Fills the process node with data from /proc, whose directory is open as
+  // |procfs_fd|.  The stat file is read at each call, from a file descriptor
+  // kept open if |keep_stat_fd|.  The command line is only read again until
+  // two reads agree, and after the process execs or its PID is reused.
+  // Returns true if the data that the process tree and classification depend
+  // on changed.
+  bool Refresh(int procfs_fd, bool keep_stat_fd, ProcfsReadStats* stats);
+
+  // Returns whether a stat file descriptor is kept open.
+  bool has_stat_fd() const { return stat_fd_.is_valid(); }
+
+  // Returns the memory stats cached since the process last ran or changed
+  // size, or nullptr.
+  const ProcessMemoryStats* GetCachedMemoryStats() const;
+  void SetCachedMemoryStats(const ProcessMemoryStats& stats);
 
   // Links this process node to its parent based on the node PID,
   // and adds the node to the parent's children list.
   void LinkToParent(
       const std::unordered_map<int, std::unique_ptr<ProcessNode>>& processes);
 
+  // Removes the links set by LinkToParent.
+  void ClearLinks();
+
   // Finds the type of chrome process from its command line.
   const ChromeProcessKind GetChromeKind(std::string cmdline) const;
 
   // Returns true if the process name starts with |prefix|.
   const bool HasPrefix(const std::string& prefix) const;
 
+  // The sample of ProcessInfo in which the PID was last listed in /proc.
+  uint64_t last_seen_sample() const { return last_seen_sample_; }
+  void set_last_seen_sample(uint64_t sample) { last_seen_sample_ = sample; }
+
  private:
+  // Reads the stat file into |contents|.
+  bool ReadStat(int procfs_fd,
+                bool keep_stat_fd,
+                ProcfsReadStats* stats,
+                std::string* contents);
+
   const int pid_;
   int ppid_ = 0;
   std::string name_;
   base::CommandLine cmdline_;
   std::string cmdline_string_;
+  ChromeProcessKind chrome_kind_ = CHROME_NOT_CHROME;
+  bool valid_ = false;
+  bool cmdline_stable_ = false;
+  // The start time of the process in clock ticks since boot, and its CPU time
+  // and resident set size, from the stat file.  0 when stat doesn't have them.
+  uint64_t start_time_ = 0;
+  uint64_t cpu_time_ = 0;
+  uint64_t rss_pages_ = 0;
+  base::ScopedFD stat_fd_;
+  std::optional<ProcessMemoryStats> memory_stats_;
+  uint64_t last_seen_sample_ = 0;
   // All ProcessNode instances are owned by process_map_ in ProcessInfo.
   ProcessNode* parent_ = nullptr;
   std::vector<ProcessNode*> children_;
@@ -125,6 +186,10 @@ bool FindProcessWithPrefix(
     ProcessNode** process);
 
 // Class for collecting information about all processes.
+//
+// A ProcessInfo can sample processes repeatedly.  The process tree, its
+// classification and the memory stats of each process are kept between
+// samples, and only the parts that changed are read again from /proc.
 class ProcessInfo {
  public:
   ProcessInfo(const base::FilePath& procfs_root, const base::FilePath& run_root)
@@ -134,15 +199,30 @@ class ProcessInfo {
 
   ~ProcessInfo() {}
 
+  // At most this many stat file descriptors are kept open between samples.
+  static constexpr size_t kMaxStatFds = 512;
+
   // Takes a snapshot of existing processes and builds the process tree.
+  // Processes that are unchanged since the previous snapshot are not read
+  // again.
   void Collect();
 
-  // Classifies processes in process_map_ into groups.
+  // Classifies processes in process_map_ into groups.  The groups of the
+  // previous call are kept if the process tree didn't change.
   void Classify();
 
   // Returns process group |g| (for instance, g = PG_RENDERERS).
   const std::vector<ProcessNode*>& GetGroup(ProcessGroupKind group_kind);
 
+  // Adds the memory usage of the processes in group |group_kind| to |stats|,
+  // like AccumulateProcessGroupStats, but only reads the memory usage of
+  // processes that ran or changed size since it was last read.  Other
+  // processes are assumed to keep their proportional set sizes.
+  void AccumulateGroupStats(ProcessGroupKind group_kind,
+                            ProcessMemoryStats* stats);
+
+  const ProcfsReadStats& stats() const { return stats_; }
+
  private:
   // Maps PIDs to nodes in the process tree.  This is the owner of all process
   // nodes.
@@ -153,6 +233,15 @@ class ProcessInfo {
   // Paths to /proc and /run, or mocks for testing.
   base::FilePath procfs_root_;
   base::FilePath run_root_;
+
+  base::ScopedFD procfs_fd_;
+  uint64_t sample_ = 0;
+  // Whether |groups_| match the current process tree, and the ARC init PID
+  // they were computed with.
+  bool classified_ = false;
+  int arc_init_pid_ = 0;
+
+  ProcfsReadStats stats_;
 };
 
 // Accumulates memory usage stats for a group of processes.  |procfs_path|
@@ -0,0 +1,160 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+
+#include <string>
+
+#include <base/check.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+#include "metrics/process_meter.h"
+
+namespace chromeos_metrics {
+namespace {
+
+constexpr int kBrowserPid = 100;
+constexpr int kFirstChildPid = 1000;
+
+void WriteProcFile(const base::FilePath& path, const std::string& content) {
+  CHECK(base::WriteFile(path, content));
+}
+
+// Writes a stat file for |pid|, with the fields up to rss.
+void WriteStat(const base::FilePath& procfs_path,
+               int pid,
+               int ppid,
+               uint64_t utime) {
+  WriteProcFile(
+      procfs_path.Append(base::NumberToString(pid)).Append("stat"),
+      base::StringPrintf("%d (proc) S %d %d %d 0 -1 4194560 100 0 0 0 %" PRIu64
+                         " 7 0 0 20 0 1 0 %d 1000000 2500 "
+                         "18446744073709551615\n",
+                         pid, ppid, pid, pid, utime, pid));
+}
+
+void CreateProcess(const base::FilePath& procfs_path,
+                   int pid,
+                   int ppid,
+                   const std::string& cmdline) {
+  const base::FilePath pid_path =
+      procfs_path.Append(base::NumberToString(pid));
+  CHECK(base::CreateDirectory(pid_path));
+  WriteProcFile(pid_path.Append("cmdline"), cmdline);
+  WriteProcFile(pid_path.Append("totmaps"),
+            "Rss:        10240 kB\n"
+            "Pss:         8192 kB\n"
+            "Pss_Anon:    4096 kB\n"
+            "Pss_File:    2048 kB\n"
+            "Pss_Shmem:   2048 kB\n"
+            "Swap:        1024 kB\n");
+  WriteStat(procfs_path, pid, ppid, 0);
+}
+
+// Creates a /proc with init, a chrome browser, and |num_processes| renderers
+// and daemons.
+void CreateProcfs(const base::FilePath& procfs_path, int num_processes) {
+  CreateProcess(procfs_path, 1, 0, "/sbin/init");
+  CreateProcess(procfs_path, kBrowserPid, 1, "/opt/google/chrome/chrome");
+  for (int i = 0; i < num_processes; ++i) {
+    if (i % 2 == 0) {
+      CreateProcess(procfs_path, kFirstChildPid + i, kBrowserPid,
+                    "/opt/google/chrome/chrome --type=renderer");
+    } else {
+      CreateProcess(procfs_path, kFirstChildPid + i, 1, "/usr/bin/daemon");
+    }
+  }
+}
+
+void Sample(ProcessInfo* info) {
+  info->Collect();
+  info->Classify();
+  for (int i = 0; i < PG_KINDS_COUNT; ++i) {
+    ProcessMemoryStats stats;
+    info->AccumulateGroupStats(static_cast<ProcessGroupKind>(i), &stats);
+    benchmark::DoNotOptimize(stats);
+  }
+}
+
+void SetCounters(benchmark::State& state,
+                 const ProcfsReadStats& stats,
+                 int num_processes) {
+  const double num_samples = state.iterations() * num_processes;
+  state.SetItemsProcessed(state.iterations() * num_processes);
+  state.counters["file_opens_per_process"] = stats.file_opens / num_samples;
+  state.counters["cmdline_reads_per_process"] =
+      stats.cmdline_reads / num_samples;
+  state.counters["memory_reads_per_process"] =
+      stats.memory_reads / num_samples;
+}
+
+// Samples |state.range(0)| processes with a new ProcessInfo each time, as
+// every sample did before ProcessInfo was kept between samples.
+void BM_ProcessInfoFullSample(benchmark::State& state) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  const base::FilePath procfs_path = temp_dir.GetPath().Append("proc");
+  CreateProcfs(procfs_path, state.range(0));
+  const base::FilePath run_path = temp_dir.GetPath().Append("run");
+
+  ProcfsReadStats total;
+  for (auto _ : state) {
+    ProcessInfo info(procfs_path, run_path);
+    Sample(&info);
+    total.file_opens += info.stats().file_opens;
+    total.cmdline_reads += info.stats().cmdline_reads;
+    total.memory_reads += info.stats().memory_reads;
+  }
+  SetCounters(state, total, state.range(0));
+}
+BENCHMARK(BM_ProcessInfoFullSample)->Arg(1000)->Arg(4000);
+
+// Samples |state.range(0)| processes with the same ProcessInfo, while 1% of
+// them run between samples.
+void BM_ProcessInfoIncrementalSample(benchmark::State& state) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  const base::FilePath procfs_path = temp_dir.GetPath().Append("proc");
+  const int num_processes = state.range(0);
+  CreateProcfs(procfs_path, num_processes);
+
+  ProcessInfo info(procfs_path, temp_dir.GetPath().Append("run"));
+  // Let the command lines settle.
+  Sample(&info);
+  Sample(&info);
+  const ProcfsReadStats initial = info.stats();
+
+  const int num_running = num_processes / 100;
+  int next_running = 0;
+  uint64_t utime = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    ++utime;
+    for (int i = 0; i < num_running; ++i) {
+      // Renderers have even PIDs.
+      const int pid = kFirstChildPid + next_running;
+      WriteStat(procfs_path, pid, pid % 2 == 0 ? kBrowserPid : 1, utime);
+      next_running = (next_running + 1) % num_processes;
+    }
+    state.ResumeTiming();
+    Sample(&info);
+  }
+
+  ProcfsReadStats total;
+  total.file_opens = info.stats().file_opens - initial.file_opens;
+  total.cmdline_reads = info.stats().cmdline_reads - initial.cmdline_reads;
+  total.memory_reads = info.stats().memory_reads - initial.memory_reads;
+  SetCounters(state, total, num_processes);
+}
+BENCHMARK(BM_ProcessInfoIncrementalSample)->Arg(1000)->Arg(4000);
+
+}  // namespace
+}  // namespace chromeos_metrics
+
+BENCHMARK_MAIN();
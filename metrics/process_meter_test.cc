@@ -4,6 +4,8 @@
 
 #include "metrics/process_meter.h"
 
+#include <inttypes.h>
+
 #include <memory>
 #include <optional>
 
@@ -260,6 +262,96 @@ TEST_F(ProcessMeterTest, ReportProcessStats_VM) {
   }
 }
 
+// Writes a stat file for |pid| with all the fields up to rss, like the
+// kernel's.
+void CreateFullStat(const base::FilePath& procfs_path,
+                    int pid,
+                    int ppid,
+                    const char* name,
+                    uint64_t start_time,
+                    uint64_t utime,
+                    uint64_t rss_pages) {
+  base::FilePath stat_path(
+      procfs_path.Append(base::StringPrintf("%d", pid)).Append("stat"));
+  CreateFile(stat_path,
+             base::StringPrintf("%d (%s) S %d %d %d 0 -1 4194560 100 0 0 0 "
+                                "%" PRIu64 " 7 0 0 20 0 1 0 %" PRIu64
+                                " 1000000 %" PRIu64 " 18446744073709551615\n",
+                                pid, name, ppid, pid, pid, utime, start_time,
+                                rss_pages));
+}
+
+// Test that repeated samples only read again the processes that changed.
+TEST_F(ProcessMeterTest, IncrementalCollect) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath run_path = temp_dir.GetPath().Append("run");
+  base::FilePath procfs_path = temp_dir.GetPath().Append("proc");
+  CHECK(CreateDirectory(procfs_path));
+
+  // clang-format off
+  CreateProcEntry(procfs_path, 1, 0, nullptr, "/sbin/init",
+                  10, 5, 5, 0, 0);
+  CreateFullStat(procfs_path, 1, 0, "init", 1, 100, 1000);
+  CreateProcEntry(procfs_path, 100, 1, nullptr,
+                  "/opt/google/chrome/chrome blah",
+                  300, 200, 90, 10, 0);
+  CreateFullStat(procfs_path, 100, 1, "chrome", 500, 100, 1000);
+  CreateProcEntry(procfs_path, 120, 100, nullptr,
+                  "/opt/google/chrome/chrome --type=renderer",
+                  500, 450, 30, 20, 0);
+  CreateFullStat(procfs_path, 120, 100, "chrome", 600, 100, 1000);
+  // clang-format on
+
+  ProcessInfo info(procfs_path, run_path);
+  auto sample = [&info](ProcessGroupKind kind) {
+    info.Collect();
+    info.Classify();
+    ProcessMemoryStats stats;
+    info.AccumulateGroupStats(kind, &stats);
+    return stats.rss_sizes[MEM_TOTAL] >> 20;
+  };
+
+  EXPECT_EQ(sample(PG_RENDERERS), 500u);
+  EXPECT_EQ(info.stats().cmdline_reads, 3u);
+  EXPECT_EQ(info.stats().memory_reads, 1u);
+
+  // The command lines are read once more, until two reads agree.
+  EXPECT_EQ(sample(PG_RENDERERS), 500u);
+  EXPECT_EQ(info.stats().cmdline_reads, 6u);
+  EXPECT_EQ(info.stats().memory_reads, 1u);
+
+  // Nothing is read again for unchanged processes, but their stat.
+  const ProcfsReadStats before = info.stats();
+  EXPECT_EQ(sample(PG_RENDERERS), 500u);
+  EXPECT_EQ(info.stats().stat_reads, before.stat_reads + 3);
+  EXPECT_EQ(info.stats().cmdline_reads, before.cmdline_reads);
+  EXPECT_EQ(info.stats().memory_reads, before.memory_reads);
+  EXPECT_EQ(info.stats().file_opens, before.file_opens);
+
+  // The memory usage is read again once the process runs.
+  CreateProcEntry(procfs_path, 120, 100, nullptr,
+                  "/opt/google/chrome/chrome --type=renderer", 700, 450, 30,
+                  20, 0);
+  EXPECT_EQ(sample(PG_RENDERERS), 500u);
+  CreateFullStat(procfs_path, 120, 100, "chrome", 600, 101, 1000);
+  EXPECT_EQ(sample(PG_RENDERERS), 700u);
+  EXPECT_EQ(info.stats().cmdline_reads, before.cmdline_reads);
+
+  // A new process with a reused PID is classified again.
+  CreateProcEntry(procfs_path, 120, 100, nullptr,
+                  "/opt/google/chrome/chrome --type=gpu-process", 400, 70, 30,
+                  300, 0);
+  CreateFullStat(procfs_path, 120, 100, "chrome", 900, 0, 1000);
+  EXPECT_EQ(sample(PG_RENDERERS), 0u);
+  EXPECT_EQ(sample(PG_GPU), 400u);
+
+  // Exited processes are forgotten.
+  ASSERT_TRUE(base::DeletePathRecursively(procfs_path.Append("120")));
+  EXPECT_EQ(sample(PG_GPU), 0u);
+  EXPECT_EQ(sample(PG_BROWSER), 300u);
+}
+
 void CheckPG(int pg, const char* field) {
   for (int i = 0; i < MEM_KINDS_COUNT; i++) {
     CHECK(strcasestr(kProcessMemoryUMANames[pg][i], field) != NULL);
@@ -0,0 +1,303 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "metrics/structured/event_log.h"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <base/bind.h>
+#include <base/files/file_enumerator.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/guid.h>
+#include <base/logging.h>
+#include <base/strings/strcat.h>
+#include <base/threading/sequenced_task_runner_handle.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <metrics/structured/proto/storage.pb.h>
+
+namespace metrics {
+namespace structured {
+namespace {
+
+constexpr mode_t kFilePermissions = 0660;
+
+// An empty segment that isn't locked may be about to be locked by the
+// process that just created it, so it's only deleted after this long.
+constexpr base::TimeDelta kEmptySegmentMinAge = base::Minutes(1);
+
+enum class TrimResult {
+  // The segment holds complete events only, and can be published.
+  kComplete,
+  // The segment holds no complete event.
+  kEmpty,
+  // The segment can't be read, or its incomplete event can't be dropped.
+  kFailed,
+};
+
+// Truncates a segment to its last complete event, in case its writer died in
+// the middle of an append. The uploader would otherwise fail to parse, and
+// drop, the whole segment.
+TrimResult TrimIncompleteEvent(const base::FilePath& path) {
+  std::string contents;
+  if (!base::ReadFileToString(path, &contents)) {
+    PLOG(ERROR) << path.value() << " cannot read";
+    return TrimResult::kFailed;
+  }
+  // A segment is a sequence of the top-level fields of EventsProto.
+  google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+  size_t complete_size = 0;
+  for (uint32_t tag = input.ReadTag(); tag != 0; tag = input.ReadTag()) {
+    if (!google::protobuf::internal::WireFormatLite::SkipField(&input, tag))
+      break;
+    complete_size = input.CurrentPosition();
+  }
+  if (complete_size == 0)
+    return TrimResult::kEmpty;
+  if (complete_size == contents.size())
+    return TrimResult::kComplete;
+  LOG(WARNING) << path.value() << ": dropping "
+               << contents.size() - complete_size
+               << " bytes of incomplete event";
+  if (truncate(path.value().c_str(), complete_size) < 0) {
+    PLOG(ERROR) << path.value() << " cannot truncate";
+    return TrimResult::kFailed;
+  }
+  return TrimResult::kComplete;
+}
+
+}  // namespace
+
+bool WriteEventsProtoToDir(const std::string& directory,
+                           const EventsProto& events) {
+  const std::string guid = base::GenerateGUID();
+  if (guid.empty())
+    return false;
+  const std::string filepath = base::StrCat({directory, "/", guid});
+
+  base::ScopedFD file_descriptor(
+      open(filepath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600));
+  if (file_descriptor.get() < 0) {
+    PLOG(ERROR) << filepath << " cannot open";
+    return false;
+  }
+
+  if (!events.SerializeToFileDescriptor(file_descriptor.get())) {
+    PLOG(ERROR) << filepath << " write error";
+    return false;
+  }
+
+  // Explicitly set permissions on the created event file. This is done
+  // separately to the open call to be independent of the umask.
+  if (fchmod(file_descriptor.get(), kFilePermissions) < 0) {
+    PLOG(ERROR) << filepath << " cannot chmod";
+    return false;
+  }
+
+  return true;
+}
+
+EventLog::EventLog(const std::string& events_directory,
+                   const std::string& pending_directory,
+                   const Options& options)
+    : events_directory_(events_directory),
+      pending_directory_(pending_directory),
+      options_(options),
+      task_runner_(base::SequencedTaskRunnerHandle::IsSet()
+                       ? base::SequencedTaskRunnerHandle::Get()
+                       : nullptr) {}
+
+EventLog::~EventLog() {
+  base::AutoLock lock(lock_);
+  ForgetParentSegmentLocked();
+  PublishLocked();
+}
+
+bool EventLog::Append(const EventsProto& events) {
+  std::string data;
+  if (!events.SerializeToString(&data))
+    return false;
+
+  base::AutoLock lock(lock_);
+  ForgetParentSegmentLocked();
+  if (segment_fd_.is_valid() &&
+      base::TimeTicks::Now() - segment_open_time_ >= options_.max_segment_age) {
+    PublishLocked();
+  }
+  if (!segment_fd_.is_valid() && !OpenSegmentLocked())
+    return false;
+
+  if (!base::WriteFileDescriptor(segment_fd_.get(), data)) {
+    PLOG(ERROR) << segment_name_ << " write error";
+    // Drop the partial event, so that the segment stays readable.
+    if (ftruncate(segment_fd_.get(), segment_bytes_) < 0) {
+      PLOG(ERROR) << segment_name_ << " cannot truncate";
+      segment_fd_.reset();
+    }
+    return false;
+  }
+  segment_bytes_ += data.size();
+  ++num_unsynced_events_;
+  ++stats_.num_events;
+
+  if (segment_bytes_ >= options_.max_segment_bytes)
+    PublishLocked();
+  else if (num_unsynced_events_ >= options_.max_unsynced_events)
+    SyncLocked();
+  return true;
+}
+
+bool EventLog::Publish() {
+  base::AutoLock lock(lock_);
+  ForgetParentSegmentLocked();
+  return PublishLocked();
+}
+
+EventLog::Stats EventLog::GetStats() const {
+  base::AutoLock lock(lock_);
+  return stats_;
+}
+
+bool EventLog::OpenSegmentLocked() {
+  if (!orphans_published_) {
+    PublishOrphanedSegmentsLocked();
+    orphans_published_ = true;
+  }
+
+  segment_name_ = base::GenerateGUID();
+  if (segment_name_.empty())
+    return false;
+  const std::string filepath =
+      base::StrCat({pending_directory_, "/", segment_name_});
+  segment_fd_.reset(open(filepath.c_str(),
+                         O_WRONLY | O_APPEND | O_CREAT | O_EXCL | O_CLOEXEC,
+                         0600));
+  if (!segment_fd_.is_valid()) {
+    PLOG(ERROR) << filepath << " cannot open";
+    return false;
+  }
+  // The lock tells other processes that the segment is still being written.
+  // It works across pid namespaces, and is released if this process dies.
+  // As in WriteEventsProtoToDir, set the permissions independently of the
+  // umask.
+  if (flock(segment_fd_.get(), LOCK_EX | LOCK_NB) < 0 ||
+      fchmod(segment_fd_.get(), kFilePermissions) < 0) {
+    PLOG(ERROR) << filepath << " cannot lock or chmod";
+    segment_fd_.reset();
+    unlink(filepath.c_str());
+    return false;
+  }
+  segment_pid_ = getpid();
+  segment_bytes_ = 0;
+  segment_open_time_ = base::TimeTicks::Now();
+  num_unsynced_events_ = 0;
+  ++stats_.num_segments;
+  if (task_runner_) {
+    task_runner_->PostDelayedTask(
+        FROM_HERE,
+        base::BindOnce(&EventLog::PublishExpiredSegment,
+                       weak_ptr_factory_.GetWeakPtr(), segment_name_),
+        options_.max_segment_age);
+  }
+  return true;
+}
+
+bool EventLog::SyncLocked() {
+  if (num_unsynced_events_ == 0)
+    return true;
+  ++stats_.num_syncs;
+  num_unsynced_events_ = 0;
+  if (fdatasync(segment_fd_.get()) < 0) {
+    PLOG(ERROR) << segment_name_ << " cannot sync";
+    return false;
+  }
+  return true;
+}
+
+bool EventLog::PublishLocked() {
+  if (!segment_fd_.is_valid())
+    return true;
+
+  const std::string pending_path =
+      base::StrCat({pending_directory_, "/", segment_name_});
+  if (segment_bytes_ == 0) {
+    segment_fd_.reset();
+    unlink(pending_path.c_str());
+    return true;
+  }
+  SyncLocked();
+
+  // Move the segment while still holding its lock, so that no other process
+  // takes it for an orphan.
+  const std::string events_path =
+      base::StrCat({events_directory_, "/", segment_name_});
+  const bool published = rename(pending_path.c_str(), events_path.c_str()) == 0;
+  if (!published)
+    PLOG(ERROR) << pending_path << " cannot publish";
+  segment_fd_.reset();
+  return published;
+}
+
+void EventLog::PublishExpiredSegment(const std::string& segment_name) {
+  base::AutoLock lock(lock_);
+  ForgetParentSegmentLocked();
+  // The segment may have been published already, and another one opened.
+  if (segment_fd_.is_valid() && segment_name_ == segment_name)
+    PublishLocked();
+}
+
+void EventLog::PublishOrphanedSegmentsLocked() {
+  base::FileEnumerator segments(base::FilePath(pending_directory_),
+                                /*recursive=*/false,
+                                base::FileEnumerator::FILES);
+  for (base::FilePath path = segments.Next(); !path.empty();
+       path = segments.Next()) {
+    // Segments of other users are skipped if they can't be opened; they are
+    // published when their writer's user records events again.
+    base::ScopedFD fd(open(path.value().c_str(), O_RDONLY | O_CLOEXEC));
+    if (!fd.is_valid() || flock(fd.get(), LOCK_EX | LOCK_NB) < 0)
+      continue;
+
+    const base::FileEnumerator::FileInfo info = segments.GetInfo();
+    if (info.GetSize() == 0) {
+      if (base::Time::Now() - info.GetLastModifiedTime() >= kEmptySegmentMinAge)
+        base::DeleteFile(path);
+      continue;
+    }
+    switch (TrimIncompleteEvent(path)) {
+      case TrimResult::kComplete:
+        break;
+      case TrimResult::kEmpty:
+        base::DeleteFile(path);
+        continue;
+      case TrimResult::kFailed:
+        // Leave the segment for the next EventLog rather than publishing an
+        // event the uploader can't parse.
+        continue;
+    }
+    const std::string events_path =
+        base::StrCat({events_directory_, "/", path.BaseName().value()});
+    if (rename(path.value().c_str(), events_path.c_str()) < 0)
+      PLOG(ERROR) << path.value() << " cannot publish";
+  }
+}
+
+void EventLog::ForgetParentSegmentLocked() {
+  if (!segment_fd_.is_valid() || segment_pid_ == getpid())
+    return;
+  // Closing the inherited descriptor keeps the lock of the parent, which
+  // shares the open file.
+  segment_fd_.reset();
+  segment_name_.clear();
+  segment_bytes_ = 0;
+  num_unsynced_events_ = 0;
+}
+
+}  // namespace structured
+}  // namespace metrics
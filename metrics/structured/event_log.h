@@ -0,0 +1,139 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef METRICS_STRUCTURED_EVENT_LOG_H_
+#define METRICS_STRUCTURED_EVENT_LOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+
+#include <base/files/scoped_file.h>
+#include <base/memory/scoped_refptr.h>
+#include <base/memory/weak_ptr.h>
+#include <base/synchronization/lock.h>
+#include <base/task/sequenced_task_runner.h>
+#include <base/thread_annotations.h>
+#include <base/time/time.h>
+
+namespace metrics {
+namespace structured {
+
+class EventsProto;
+
+// Writes |events| to a new file within |directory|. Fails if |directory|
+// doesn't exist. Returns whether the write was successful.
+bool WriteEventsProtoToDir(const std::string& directory,
+                           const EventsProto& events);
+
+// EventLog appends events to a segment file in a pending directory, instead
+// of writing one file per event, and moves the segment into the events
+// directory once it is large or old enough. The age is checked when
+// appending, and on a timer if the EventLog is created on a sequence with a
+// task runner, so that the events of a process which stops recording are
+// published too.
+//
+// A segment is a concatenation of serialized EventsProtos. Protobuf merges
+// concatenated messages, so the uploader reads a published segment as a
+// single EventsProto holding all of its events, exactly like the files of
+// WriteEventsProtoToDir. Segments are only moved into the events directory
+// once complete, so the uploader never reads, nor deletes, a segment that is
+// still being appended to.
+//
+// Appends are synced to disk in groups of |max_unsynced_events|, and when the
+// segment is published. A segment is locked while it is written, so segments
+// left unlocked in the pending directory by a process that exited without
+// publishing them are published by the next EventLog that opens a segment.
+//
+// A forked child doesn't touch the segment inherited from its parent, which
+// the parent keeps appending to and publishes. It opens its own instead.
+//
+// The class is thread-safe, but must be destroyed on the sequence it was
+// created on.
+class EventLog {
+ public:
+  struct Options {
+    // A segment is published once it reaches this size...
+    size_t max_segment_bytes = 64 * 1024;
+    // ...or this age.
+    base::TimeDelta max_segment_age = base::Minutes(10);
+    // The number of appends between two syncs of the segment.
+    size_t max_unsynced_events = 32;
+  };
+
+  struct Stats {
+    uint64_t num_events = 0;
+    uint64_t num_syncs = 0;
+    uint64_t num_segments = 0;
+  };
+
+  EventLog(const std::string& events_directory,
+           const std::string& pending_directory,
+           const Options& options);
+  EventLog(const EventLog&) = delete;
+  EventLog& operator=(const EventLog&) = delete;
+
+  // Publishes the current segment.
+  ~EventLog();
+
+  // Appends |events| to the current segment, opening one if needed. Returns
+  // false if the events couldn't be written, in which case the caller may
+  // fall back to WriteEventsProtoToDir().
+  bool Append(const EventsProto& events);
+
+  // Syncs the current segment and moves it to the events directory, where the
+  // uploader will read it.
+  bool Publish();
+
+  Stats GetStats() const;
+
+ private:
+  bool OpenSegmentLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  bool SyncLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+  bool PublishLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Publishes the current segment if it is still |segment_name|, which
+  // reached the maximum age.
+  void PublishExpiredSegment(const std::string& segment_name);
+
+  // Publishes the segments of the pending directory that no process is
+  // appending to.
+  void PublishOrphanedSegmentsLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Forgets the current segment if it was opened by the parent of this
+  // process.
+  void ForgetParentSegmentLocked() EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  const std::string events_directory_;
+  const std::string pending_directory_;
+  const Options options_;
+
+  // Where segments are published once they reach the maximum age, if any.
+  const scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  mutable base::Lock lock_;
+
+  // The current segment, if any, and the process which opened it.
+  base::ScopedFD segment_fd_ GUARDED_BY(lock_);
+  pid_t segment_pid_ GUARDED_BY(lock_) = 0;
+  std::string segment_name_ GUARDED_BY(lock_);
+  size_t segment_bytes_ GUARDED_BY(lock_) = 0;
+  base::TimeTicks segment_open_time_ GUARDED_BY(lock_);
+  size_t num_unsynced_events_ GUARDED_BY(lock_) = 0;
+
+  // Whether the pending directory was checked for orphaned segments.
+  bool orphans_published_ GUARDED_BY(lock_) = false;
+
+  Stats stats_ GUARDED_BY(lock_);
+
+  // Must be the last class member.
+  base::WeakPtrFactory<EventLog> weak_ptr_factory_{this};
+};
+
+}  // namespace structured
+}  // namespace metrics
+
+#endif  // METRICS_STRUCTURED_EVENT_LOG_H_
@@ -0,0 +1,75 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+
+#include <base/check.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <benchmark/benchmark.h>
+
+#include "metrics/structured/event_log.h"
+#include "metrics/structured/proto/storage.pb.h"
+
+namespace metrics {
+namespace structured {
+namespace {
+
+// An event the size of a typical cros event: an id and a few metrics.
+EventsProto CreateEvents() {
+  EventsProto events;
+  StructuredEventProto* event = events.add_non_uma_events();
+  event->set_profile_event_id(0x0123456789abcdefULL);
+  event->set_event_name_hash(0xfedcba9876543210ULL);
+  event->set_event_type(StructuredEventProto_EventType_REGULAR);
+  for (int i = 0; i < 4; ++i) {
+    auto* metric = event->add_metrics();
+    metric->set_name_hash(0x1000 + i);
+    metric->set_value_int64(i * 1000);
+  }
+  return events;
+}
+
+// Records with the per-event file writer that EventLog replaces.
+void BM_WriteEventsProtoToDir(benchmark::State& state) {
+  base::ScopedTempDir events_dir;
+  CHECK(events_dir.CreateUniqueTempDir());
+  const EventsProto events = CreateEvents();
+  for (auto _ : state)
+    CHECK(WriteEventsProtoToDir(events_dir.GetPath().value(), events));
+  state.SetItemsProcessed(state.iterations());
+  state.counters["files_per_event"] = 1;
+  state.counters["fsyncs_per_event"] = 0;
+}
+BENCHMARK(BM_WriteEventsProtoToDir);
+
+// Records through an EventLog syncing every |state.range(0)| events.
+void BM_EventLog(benchmark::State& state) {
+  base::ScopedTempDir events_dir;
+  base::ScopedTempDir pending_dir;
+  CHECK(events_dir.CreateUniqueTempDir());
+  CHECK(pending_dir.CreateUniqueTempDir());
+  EventLog::Options options;
+  options.max_unsynced_events = state.range(0);
+  EventLog event_log(events_dir.GetPath().value(),
+                     pending_dir.GetPath().value(), options);
+  const EventsProto events = CreateEvents();
+  for (auto _ : state)
+    CHECK(event_log.Append(events));
+  CHECK(event_log.Publish());
+
+  const EventLog::Stats stats = event_log.GetStats();
+  state.SetItemsProcessed(state.iterations());
+  state.counters["files_per_event"] =
+      static_cast<double>(stats.num_segments) / stats.num_events;
+  state.counters["fsyncs_per_event"] =
+      static_cast<double>(stats.num_syncs) / stats.num_events;
+}
+BENCHMARK(BM_EventLog)->Arg(1)->Arg(8)->Arg(32)->Arg(128);
+
+}  // namespace
+}  // namespace structured
+}  // namespace metrics
+
+BENCHMARK_MAIN();
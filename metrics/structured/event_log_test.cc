@@ -0,0 +1,266 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "metrics/structured/event_log.h"
+
+#include <stdint.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/files/file_enumerator.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/posix/eintr_wrapper.h>
+#include <base/test/task_environment.h>
+#include <base/time/time.h>
+#include <gtest/gtest.h>
+#include <metrics/structured/proto/storage.pb.h>
+
+namespace metrics {
+namespace structured {
+namespace {
+
+constexpr base::TimeDelta kMaxSegmentAge = base::Minutes(10);
+
+// Returns an EventsProto holding one event named |name_hash|.
+EventsProto MakeEvents(uint64_t name_hash) {
+  EventsProto events;
+  events.add_non_uma_events()->set_event_name_hash(name_hash);
+  return events;
+}
+
+class EventLogTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    events_dir_ = temp_dir_.GetPath().Append("events");
+    pending_dir_ = temp_dir_.GetPath().Append("pending");
+    ASSERT_TRUE(base::CreateDirectory(events_dir_));
+    ASSERT_TRUE(base::CreateDirectory(pending_dir_));
+  }
+
+  void CreateEventLog(size_t max_segment_bytes = 64 * 1024) {
+    EventLog::Options options;
+    options.max_segment_bytes = max_segment_bytes;
+    options.max_segment_age = kMaxSegmentAge;
+    event_log_ = std::make_unique<EventLog>(events_dir_.value(),
+                                            pending_dir_.value(), options);
+  }
+
+  // Returns the files of |dir|.
+  std::vector<base::FilePath> ListFiles(const base::FilePath& dir) {
+    std::vector<base::FilePath> files;
+    base::FileEnumerator enumerator(dir, /*recursive=*/false,
+                                    base::FileEnumerator::FILES);
+    for (base::FilePath path = enumerator.Next(); !path.empty();
+         path = enumerator.Next()) {
+      files.push_back(path);
+    }
+    return files;
+  }
+
+  // Returns the name hashes of the events of the segment at |path|, parsed
+  // like the uploader does.
+  std::vector<uint64_t> ReadEventNames(const base::FilePath& path) {
+    std::string contents;
+    EXPECT_TRUE(base::ReadFileToString(path, &contents));
+    EventsProto events;
+    EXPECT_TRUE(events.ParseFromString(contents));
+    std::vector<uint64_t> names;
+    for (const auto& event : events.non_uma_events())
+      names.push_back(event.event_name_hash());
+    return names;
+  }
+
+  // Writes |contents| to a segment left in the pending directory by a process
+  // that exited without publishing it.
+  void WriteOrphanedSegment(const std::string& name,
+                            const std::string& contents) {
+    ASSERT_TRUE(base::WriteFile(pending_dir_.Append(name), contents));
+  }
+
+  base::test::TaskEnvironment task_environment_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  base::ScopedTempDir temp_dir_;
+  base::FilePath events_dir_;
+  base::FilePath pending_dir_;
+  std::unique_ptr<EventLog> event_log_;
+};
+
+// Test that appended events are only visible to the uploader once published,
+// as a single segment.
+TEST_F(EventLogTest, AppendAndPublish) {
+  CreateEventLog();
+
+  ASSERT_TRUE(event_log_->Append(MakeEvents(1)));
+  ASSERT_TRUE(event_log_->Append(MakeEvents(2)));
+  EXPECT_TRUE(ListFiles(events_dir_).empty());
+  EXPECT_EQ(ListFiles(pending_dir_).size(), 1u);
+
+  ASSERT_TRUE(event_log_->Publish());
+
+  const std::vector<base::FilePath> segments = ListFiles(events_dir_);
+  ASSERT_EQ(segments.size(), 1u);
+  EXPECT_EQ(ReadEventNames(segments[0]), (std::vector<uint64_t>{1, 2}));
+  EXPECT_TRUE(ListFiles(pending_dir_).empty());
+  const EventLog::Stats stats = event_log_->GetStats();
+  EXPECT_EQ(stats.num_events, 2u);
+  EXPECT_EQ(stats.num_segments, 1u);
+}
+
+// Test that the current segment is published when the log is destroyed.
+TEST_F(EventLogTest, PublishOnDestruction) {
+  CreateEventLog();
+  ASSERT_TRUE(event_log_->Append(MakeEvents(1)));
+
+  event_log_.reset();
+
+  const std::vector<base::FilePath> segments = ListFiles(events_dir_);
+  ASSERT_EQ(segments.size(), 1u);
+  EXPECT_EQ(ReadEventNames(segments[0]), (std::vector<uint64_t>{1}));
+}
+
+// Test that a segment is published once it reaches the maximum size.
+TEST_F(EventLogTest, RotateBySize) {
+  CreateEventLog(MakeEvents(1).ByteSizeLong() * 2);
+
+  ASSERT_TRUE(event_log_->Append(MakeEvents(1)));
+  EXPECT_TRUE(ListFiles(events_dir_).empty());
+  ASSERT_TRUE(event_log_->Append(MakeEvents(2)));
+  ASSERT_EQ(ListFiles(events_dir_).size(), 1u);
+  ASSERT_TRUE(event_log_->Append(MakeEvents(3)));
+
+  EXPECT_EQ(ListFiles(events_dir_).size(), 1u);
+  EXPECT_EQ(ListFiles(pending_dir_).size(), 1u);
+  EXPECT_EQ(event_log_->GetStats().num_segments, 2u);
+}
+
+// Test that a segment is published once it reaches the maximum age, even if
+// nothing is appended anymore.
+TEST_F(EventLogTest, RotateByAge) {
+  CreateEventLog();
+  ASSERT_TRUE(event_log_->Append(MakeEvents(1)));
+
+  task_environment_.FastForwardBy(kMaxSegmentAge - base::Seconds(1));
+  EXPECT_TRUE(ListFiles(events_dir_).empty());
+  task_environment_.FastForwardBy(base::Seconds(1));
+
+  const std::vector<base::FilePath> segments = ListFiles(events_dir_);
+  ASSERT_EQ(segments.size(), 1u);
+  EXPECT_EQ(ReadEventNames(segments[0]), (std::vector<uint64_t>{1}));
+  EXPECT_TRUE(ListFiles(pending_dir_).empty());
+}
+
+// Test that the timer of a segment published early doesn't publish the next
+// segment before it reaches the maximum age.
+TEST_F(EventLogTest, RotateByAgeAfterPublish) {
+  CreateEventLog();
+  ASSERT_TRUE(event_log_->Append(MakeEvents(1)));
+  task_environment_.FastForwardBy(kMaxSegmentAge / 2);
+  ASSERT_TRUE(event_log_->Publish());
+  ASSERT_TRUE(event_log_->Append(MakeEvents(2)));
+
+  task_environment_.FastForwardBy(kMaxSegmentAge / 2);
+  EXPECT_EQ(ListFiles(events_dir_).size(), 1u);
+  EXPECT_EQ(ListFiles(pending_dir_).size(), 1u);
+
+  task_environment_.FastForwardBy(kMaxSegmentAge / 2);
+  EXPECT_EQ(ListFiles(events_dir_).size(), 2u);
+  EXPECT_TRUE(ListFiles(pending_dir_).empty());
+}
+
+// Test that segments left unlocked in the pending directory are published
+// when a segment is opened.
+TEST_F(EventLogTest, PublishOrphanedSegments) {
+  std::string orphan;
+  ASSERT_TRUE(MakeEvents(1).SerializeToString(&orphan));
+  WriteOrphanedSegment("orphan", orphan);
+  CreateEventLog();
+
+  ASSERT_TRUE(event_log_->Append(MakeEvents(2)));
+
+  const base::FilePath published = events_dir_.Append("orphan");
+  ASSERT_TRUE(base::PathExists(published));
+  EXPECT_EQ(ReadEventNames(published), (std::vector<uint64_t>{1}));
+  EXPECT_EQ(ListFiles(pending_dir_).size(), 1u);
+}
+
+// Test that the partial event an orphaned segment ends with is dropped, so
+// that the uploader can parse the other events.
+TEST_F(EventLogTest, TruncatePartialOrphanedEvent) {
+  std::string complete;
+  ASSERT_TRUE(MakeEvents(1).SerializeToString(&complete));
+  std::string partial;
+  ASSERT_TRUE(MakeEvents(2).SerializeToString(&partial));
+  partial.resize(partial.size() - 1);
+  WriteOrphanedSegment("orphan", complete + partial);
+  CreateEventLog();
+
+  ASSERT_TRUE(event_log_->Append(MakeEvents(3)));
+
+  const base::FilePath published = events_dir_.Append("orphan");
+  int64_t size = 0;
+  ASSERT_TRUE(base::GetFileSize(published, &size));
+  EXPECT_EQ(size, static_cast<int64_t>(complete.size()));
+  EXPECT_EQ(ReadEventNames(published), (std::vector<uint64_t>{1}));
+}
+
+// Test that an orphaned segment without a complete event is deleted.
+TEST_F(EventLogTest, DeleteOrphanedSegmentWithoutEvent) {
+  std::string partial;
+  ASSERT_TRUE(MakeEvents(1).SerializeToString(&partial));
+  partial.resize(partial.size() - 1);
+  WriteOrphanedSegment("orphan", partial);
+  CreateEventLog();
+
+  ASSERT_TRUE(event_log_->Append(MakeEvents(2)));
+
+  EXPECT_FALSE(base::PathExists(events_dir_.Append("orphan")));
+  EXPECT_FALSE(base::PathExists(pending_dir_.Append("orphan")));
+}
+
+// Test that a forked child leaves the segment of its parent alone, so that the
+// child exiting doesn't publish the events of the parent.
+TEST_F(EventLogTest, ForkedChildKeepsParentSegment) {
+  CreateEventLog();
+  ASSERT_TRUE(event_log_->Append(MakeEvents(1)));
+
+  const pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // The child reports failures through its exit code.
+    const bool ok = event_log_->Append(MakeEvents(2)) && event_log_->Publish();
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(HANDLE_EINTR(waitpid(pid, &status, 0)), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+
+  // The child published its own segment only.
+  std::vector<base::FilePath> segments = ListFiles(events_dir_);
+  ASSERT_EQ(segments.size(), 1u);
+  const base::FilePath child_segment = segments[0];
+  EXPECT_EQ(ReadEventNames(child_segment), (std::vector<uint64_t>{2}));
+  EXPECT_EQ(ListFiles(pending_dir_).size(), 1u);
+
+  // The parent keeps appending to its segment.
+  ASSERT_TRUE(event_log_->Append(MakeEvents(3)));
+  ASSERT_TRUE(event_log_->Publish());
+  EXPECT_TRUE(ListFiles(pending_dir_).empty());
+  segments = ListFiles(events_dir_);
+  ASSERT_EQ(segments.size(), 2u);
+  const base::FilePath parent_segment =
+      segments[0] == child_segment ? segments[1] : segments[0];
+  EXPECT_EQ(ReadEventNames(parent_segment), (std::vector<uint64_t>{1, 3}));
+}
+
+}  // namespace
+}  // namespace structured
+}  // namespace metrics
@@ -4,8 +4,9 @@
 
 #include "metrics/structured/recorder.h"
 
+#include <stdlib.h>
+
 #include <memory>
-#include <sys/file.h>
 #include <utility>
 
 #include <base/bind.h>
@@ -13,6 +14,7 @@
 #include <base/guid.h>
 #include <metrics/structured/structured_events.h>
 #include <metrics/structured/event_base.h>
+#include <metrics/structured/event_log.h>
 #include <metrics/structured/proto/storage.pb.h>
 #include <base/files/file_util.h>
 #include <base/strings/string_number_conversions.h>
@@ -26,50 +28,37 @@ constexpr char kEventsPath[] = "/var/lib/metrics/structured/events";
 
 constexpr char kKeysPath[] = "/var/lib/metrics/structured/keys";
 
-constexpr mode_t kFilePermissions = 0660;
-
-// Writes |events| to a file within |directory|. Fails if |directory| doesn't
-// exist. Returns whether the write was successful.
-bool WriteEventsProtoToDir(const std::string& directory,
-                           const EventsProto& events) {
-  const std::string guid = base::GenerateGUID();
-  if (guid.empty())
-    return false;
-  const std::string filepath = base::StrCat({directory, "/", guid});
-
-  base::ScopedFD file_descriptor(
-      open(filepath.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600));
-  if (file_descriptor.get() < 0) {
-    PLOG(ERROR) << filepath << " cannot open";
-    return false;
-  }
-
-  if (!events.SerializeToFileDescriptor(file_descriptor.get())) {
-    PLOG(ERROR) << filepath << " write error";
-    return false;
-  }
-
-  // Explicitly set permissions on the created event file. This is done
-  // separately to the open call to be independent of the umask.
-  if (fchmod(file_descriptor.get(), kFilePermissions) < 0) {
-    PLOG(ERROR) << filepath << " cannot chmod";
-    return false;
-  }
+// Where events are appended before being moved to |kEventsPath|.
+constexpr char kPendingEventsPath[] =
+    "/var/lib/metrics/structured/pending_events";
 
-  return true;
+void FlushAtExit() {
+  Recorder::GetInstance()->Flush();
 }
 
 }  // namespace
 
 // static
 Recorder* Recorder::GetInstance() {
-  static base::NoDestructor<Recorder> recorder{kEventsPath, kKeysPath};
+  static base::NoDestructor<Recorder> recorder{kEventsPath,
+                                               kPendingEventsPath, kKeysPath};
   return recorder.get();
 }
 
 Recorder::Recorder(const std::string& events_directory,
+                   const std::string& pending_events_directory,
                    const std::string& keys_path)
-    : events_directory_(events_directory), key_data_(keys_path) {}
+    : events_directory_(events_directory), key_data_(keys_path) {
+  // Images without the pending directory keep writing a file per event.
+  if (base::DirectoryExists(base::FilePath(pending_events_directory))) {
+    event_log_ = std::make_unique<EventLog>(
+        events_directory, pending_events_directory, EventLog::Options());
+    // The recorder is never destroyed, so publish the pending events when a
+    // short-lived process exits. A forked child which exits only publishes
+    // its own events, not the segment of its parent.
+    std::atexit(&FlushAtExit);
+  }
+}
 
 Recorder::~Recorder() = default;
 
@@ -149,8 +138,15 @@ bool Recorder::Record(const EventBase& event) {
     }
   }
 
+  if (event_log_ && event_log_->Append(events_proto))
+    return true;
   return WriteEventsProtoToDir(events_directory_, events_proto);
 }
 
+void Recorder::Flush() {
+  if (event_log_)
+    event_log_->Publish();
+}
+
 }  // namespace structured
 }  // namespace metrics
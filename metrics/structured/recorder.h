@@ -18,6 +18,7 @@ namespace metrics {
 namespace structured {
 
 class EventBase;
+class EventLog;
 class EventsProto;
 
 // Writes metrics to disk for collection and upload by chrome. A singleton
@@ -32,10 +33,16 @@ class Recorder {
   // may fail if, for example, chrome fails to upload the log after collection.
   bool Record(const EventBase& event);
 
+  // Makes the recorded events available to chrome. Events are otherwise
+  // batched, and published at the latest when the process exits.
+  void Flush();
+
  private:
   friend class base::NoDestructor<Recorder>;
 
-  Recorder(const std::string& events_directory, const std::string& keys_path);
+  Recorder(const std::string& events_directory,
+           const std::string& pending_events_directory,
+           const std::string& keys_path);
   ~Recorder();
   Recorder(const Recorder&) = delete;
   Recorder& operator=(const Recorder&) = delete;
@@ -43,6 +50,9 @@ class Recorder {
   // Where to save event protos.
   const std::string events_directory_;
 
+  // Batches events into segments, if the pending events directory exists.
+  std::unique_ptr<EventLog> event_log_;
+
   // Used for checking the UMA consent.
   MetricsLibrary metrics_library_;
 
@@ -6,10 +6,10 @@
 
 #include <lzma.h>
 #include <stdint.h>
-#include <stdio.h>
 
 #include <memory>
 
+#include <base/check.h>
 #include <base/files/file.h>
 #include <base/logging.h>
 
@@ -17,13 +17,6 @@ namespace modemfwd {
 
 bool DecompressXzFile(const base::FilePath& in_file_path,
                       const base::FilePath& out_file_path) {
-  base::File in_file(in_file_path,
-                     base::File::FLAG_OPEN | base::File::FLAG_READ);
-  if (!in_file.IsValid()) {
-    LOG(ERROR) << "Failed to open '" << in_file_path.value() << "' for read";
-    return false;
-  }
-
   base::File out_file(out_file_path,
                       base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
   if (!out_file.IsValid()) {
@@ -31,6 +24,20 @@ bool DecompressXzFile(const base::FilePath& in_file_path,
     return false;
   }
 
+  return DecompressXzFile(in_file_path, &out_file);
+}
+
+bool DecompressXzFile(const base::FilePath& in_file_path,
+                      base::File* out_file) {
+  DCHECK(out_file);
+
+  base::File in_file(in_file_path,
+                     base::File::FLAG_OPEN | base::File::FLAG_READ);
+  if (!in_file.IsValid()) {
+    LOG(ERROR) << "Failed to open '" << in_file_path.value() << "' for read";
+    return false;
+  }
+
   lzma_stream stream = LZMA_STREAM_INIT;
   lzma_ret ret = lzma_stream_decoder(&stream, UINT64_MAX, 0);
   if (ret != LZMA_OK) {
@@ -42,8 +49,10 @@ bool DecompressXzFile(const base::FilePath& in_file_path,
       &stream, &lzma_end);
 
   lzma_action action = LZMA_RUN;
-  const size_t in_buffer_size = BUFSIZ;
-  const size_t out_buffer_size = BUFSIZ;
+  // Firmware images can be hundreds of MB, use large enough buffers to not
+  // spend most of the time in read and write syscalls.
+  const size_t in_buffer_size = 64 * 1024;
+  const size_t out_buffer_size = 1024 * 1024;
   auto in_buffer = std::make_unique<uint8_t[]>(in_buffer_size);
   auto out_buffer = std::make_unique<uint8_t[]>(out_buffer_size);
 
@@ -57,7 +66,7 @@ bool DecompressXzFile(const base::FilePath& in_file_path,
       int read_ret = in_file.ReadAtCurrentPos(
           reinterpret_cast<char*>(in_buffer.get()), in_buffer_size);
       if (read_ret < 0) {
-        PLOG(ERROR) << "Failed to read from '" << out_file_path.value() << "'";
+        PLOG(ERROR) << "Failed to read from '" << in_file_path.value() << "'";
         return false;
       }
 
@@ -73,10 +82,11 @@ bool DecompressXzFile(const base::FilePath& in_file_path,
     // Flushes the decoded data from the output buffer to the output file.
     if (stream.avail_out == 0 || ret == LZMA_STREAM_END) {
       size_t write_size = out_buffer_size - stream.avail_out;
-      if (out_file.WriteAtCurrentPos(reinterpret_cast<char*>(out_buffer.get()),
-                                     write_size) !=
+      if (out_file->WriteAtCurrentPos(
+              reinterpret_cast<char*>(out_buffer.get()), write_size) !=
           static_cast<int>(write_size)) {
-        PLOG(ERROR) << "Failed to write to '" << out_file_path.value() << "'";
+        PLOG(ERROR) << "Failed to write decompressed '" << in_file_path.value()
+                    << "'";
         return false;
       }
 
@@ -5,6 +5,7 @@
 #ifndef MODEMFWD_FILE_DECOMPRESSOR_H_
 #define MODEMFWD_FILE_DECOMPRESSOR_H_
 
+#include <base/files/file.h>
 #include <base/files/file_path.h>
 
 namespace modemfwd {
@@ -14,6 +15,10 @@ namespace modemfwd {
 bool DecompressXzFile(const base::FilePath& in_file_path,
                       const base::FilePath& out_file_path);
 
+// Decompresses a XZ file at |in_file_path| into |out_file|, starting at its
+// current position. Returns true on success.
+bool DecompressXzFile(const base::FilePath& in_file_path, base::File* out_file);
+
 }  // namespace modemfwd
 
 #endif  // MODEMFWD_FILE_DECOMPRESSOR_H_
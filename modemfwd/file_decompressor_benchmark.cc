@@ -0,0 +1,104 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lzma.h>
+
+#include <string>
+#include <vector>
+
+#include <base/check.h>
+#include <base/check_op.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/rand_util.h>
+#include <benchmark/benchmark.h>
+
+#include "modemfwd/file_decompressor.h"
+#include "modemfwd/firmware_file.h"
+
+namespace modemfwd {
+namespace {
+
+constexpr char kFirmwareFileName[] = "firmware.bin.xz";
+constexpr int64_t kMiB = 1024 * 1024;
+
+// Writes a XZ-compressed firmware image of |size| bytes into |dir|. The image
+// is made of repeated random blocks so that it compresses like real firmware
+// rather than like a stream of zeroes.
+base::FilePath CreateCompressedFirmware(const base::FilePath& dir,
+                                        int64_t size) {
+  const std::string block = base::RandBytesAsString(64 * 1024);
+  std::string content;
+  content.reserve(size);
+  while (content.size() < static_cast<size_t>(size)) {
+    content += block;
+    content += base::RandBytesAsString(4 * 1024);
+  }
+  content.resize(size);
+
+  std::vector<uint8_t> compressed(lzma_stream_buffer_bound(content.size()));
+  size_t compressed_size = 0;
+  CHECK_EQ(lzma_easy_buffer_encode(
+               1, LZMA_CHECK_CRC64, nullptr,
+               reinterpret_cast<const uint8_t*>(content.data()), content.size(),
+               compressed.data(), &compressed_size, compressed.size()),
+           LZMA_OK);
+
+  base::FilePath path = dir.Append(kFirmwareFileName);
+  CHECK_EQ(base::WriteFile(path,
+                            reinterpret_cast<const char*>(compressed.data()),
+                            compressed_size),
+           static_cast<int>(compressed_size));
+  return path;
+}
+
+}  // namespace
+
+// Measures decompressing a firmware image into a file on disk.
+static void BM_DecompressXzFileToDisk(benchmark::State& state) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  const base::FilePath compressed_path =
+      CreateCompressedFirmware(temp_dir.GetPath(), state.range(0) * kMiB);
+  const base::FilePath out_path = temp_dir.GetPath().Append("firmware.bin");
+
+  for (auto _ : state) {
+    CHECK(DecompressXzFile(compressed_path, out_path));
+    state.PauseTiming();
+    CHECK(base::DeleteFile(out_path));
+    state.ResumeTiming();
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * kMiB);
+}
+BENCHMARK(BM_DecompressXzFileToDisk)
+    ->Arg(64)
+    ->Arg(256)
+    ->Arg(512)
+    ->Unit(benchmark::kMillisecond);
+
+// Measures preparing a compressed firmware image for flashing, which
+// decompresses it into memory.
+static void BM_FirmwareFilePrepare(benchmark::State& state) {
+  base::ScopedTempDir temp_dir;
+  CHECK(temp_dir.CreateUniqueTempDir());
+  CreateCompressedFirmware(temp_dir.GetPath(), state.range(0) * kMiB);
+  const FirmwareFileInfo file_info(kFirmwareFileName, "1.0",
+                                   FirmwareFileInfo::Compression::XZ);
+
+  for (auto _ : state) {
+    FirmwareFile firmware_file;
+    CHECK(firmware_file.PrepareFrom(temp_dir.GetPath(), file_info));
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0) * kMiB);
+}
+BENCHMARK(BM_FirmwareFilePrepare)
+    ->Arg(64)
+    ->Arg(256)
+    ->Arg(512)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace modemfwd
+
+BENCHMARK_MAIN();
@@ -9,6 +9,7 @@
 #include <string>
 
 #include <base/check.h>
+#include <base/files/file.h>
 #include <base/files/file_path.h>
 #include <base/files/file_util.h>
 #include <base/logging.h>
@@ -91,5 +92,34 @@ TEST_F(FileDecompressorTest, Decompress1MOfZeroes) {
     EXPECT_EQ(0, content[i]);
 }
 
+TEST_F(FileDecompressorTest, DecompressIntoOpenFile) {
+  // Generated from `echo test | xz | xxd -i`
+  static const uint8_t kCompressedContent[] = {
+      0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6, 0xb4,
+      0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00, 0x74, 0x2f,
+      0xe5, 0xa3, 0x01, 0x00, 0x04, 0x74, 0x65, 0x73, 0x74, 0x0a, 0x00,
+      0x00, 0x00, 0x00, 0x9d, 0xed, 0x31, 0x1d, 0x0f, 0x9f, 0xd7, 0xe6,
+      0x00, 0x01, 0x1d, 0x05, 0xb8, 0x2d, 0x80, 0xaf, 0x1f, 0xb6, 0xf3,
+      0x7d, 0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a,
+  };
+
+  ASSERT_EQ(base::WriteFile(in_file_->path(),
+                            reinterpret_cast<const char*>(kCompressedContent),
+                            std::size(kCompressedContent)),
+            std::size(kCompressedContent));
+
+  // The decompressed data is appended at the current position of the file.
+  base::File out_file(out_file_->path(),
+                      base::File::FLAG_CREATE_ALWAYS | base::File::FLAG_WRITE);
+  ASSERT_TRUE(out_file.IsValid());
+  ASSERT_EQ(out_file.WriteAtCurrentPos("foo", 3), 3);
+  EXPECT_TRUE(DecompressXzFile(in_file_->path(), &out_file));
+  out_file.Close();
+
+  std::string content;
+  ASSERT_TRUE(base::ReadFileToString(out_file_->path(), &content));
+  EXPECT_EQ("footest\n", content);
+}
+
 }  // namespace
 }  // namespace modemfwd
@@ -4,10 +4,17 @@
 
 #include "modemfwd/firmware_file.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <utility>
+
 #include <base/check_op.h>
 #include <base/files/file_path.h>
+#include <base/files/file_util.h>
 #include <base/logging.h>
 #include <base/notreached.h>
+#include <base/strings/stringprintf.h>
 
 #include "modemfwd/file_decompressor.h"
 
@@ -30,6 +37,12 @@ bool FirmwareFile::PrepareFrom(const base::FilePath& firmware_dir,
       // A xz-compressed firmware file should end with a .xz extension.
       CHECK_EQ(firmware_path.FinalExtension(), ".xz");
 
+      base::File::Info compressed_file_info;
+      if (!base::GetFileInfo(firmware_path, &compressed_file_info)) {
+        LOG(ERROR) << "Failed to stat firmware: " << firmware_path.value();
+        return false;
+      }
+
       if (!temp_dir_.CreateUniqueTempDir()) {
         LOG(ERROR) << "Failed to create temporary directory for "
                       "decompressing firmware";
@@ -41,13 +54,30 @@ bool FirmwareFile::PrepareFrom(const base::FilePath& firmware_dir,
       base::FilePath actual_path = temp_dir_.GetPath().Append(
           firmware_path.BaseName().RemoveFinalExtension());
 
-      if (!DecompressXzFile(firmware_path, actual_path)) {
+      // Decompressing into memory avoids writing the whole firmware to disk
+      // only to read it back while flashing. The in-memory file is only
+      // passed to the flashing helper, see helper_fd().
+      base::File memory_file(
+          memfd_create(actual_path.BaseName().value().c_str(),
+                       MFD_CLOEXEC | MFD_ALLOW_SEALING));
+      bool decompressed;
+      if (memory_file.IsValid()) {
+        decompressed = DecompressXzFile(firmware_path, &memory_file) &&
+                       AttachMemoryFile(std::move(memory_file), actual_path);
+      } else {
+        PLOG(WARNING) << "Failed to create in-memory file, decompressing "
+                         "firmware to disk";
+        decompressed = DecompressXzFile(firmware_path, actual_path);
+      }
+
+      if (!decompressed) {
         LOG(ERROR) << "Failed to decompress firmware: "
                    << firmware_path.value();
         return false;
       }
       path_for_logging_ = firmware_path;
       path_on_filesystem_ = actual_path;
+      compressed_file_info_ = compressed_file_info;
       return true;
     }
   }
@@ -56,4 +86,32 @@ bool FirmwareFile::PrepareFrom(const base::FilePath& firmware_dir,
   return false;
 }
 
+bool FirmwareFile::IsDecompressedAndUpToDate() const {
+  base::File::Info info;
+  return compressed_file_info_ &&
+         base::GetFileInfo(path_for_logging_, &info) &&
+         info.size == compressed_file_info_->size &&
+         info.last_modified == compressed_file_info_->last_modified;
+}
+
+bool FirmwareFile::AttachMemoryFile(base::File file,
+                                    const base::FilePath& path) {
+  // The decompressed firmware must not change while it is being flashed.
+  if (fcntl(file.GetPlatformFile(), F_ADD_SEALS,
+            F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+    PLOG(WARNING) << "Failed to seal in-memory file";
+  }
+
+  memfd_.reset(file.TakePlatformFile());
+  // /proc/self resolves to the process opening the link, i.e. the flashing
+  // helper, which inherits the file descriptor under the same number.
+  base::FilePath fd_path(base::StringPrintf("/proc/self/fd/%d", memfd_.get()));
+  if (!base::CreateSymbolicLink(fd_path, path)) {
+    PLOG(ERROR) << "Failed to link in-memory file to '" << path.value() << "'";
+    memfd_.reset();
+    return false;
+  }
+  return true;
+}
+
 }  // namespace modemfwd
@@ -5,7 +5,12 @@
 #ifndef MODEMFWD_FIRMWARE_FILE_H_
 #define MODEMFWD_FIRMWARE_FILE_H_
 
+#include <optional>
+#include <string>
+
+#include <base/files/file.h>
 #include <base/files/file_path.h>
+#include <base/files/scoped_file.h>
 #include <base/files/scoped_temp_dir.h>
 
 #include "modemfwd/firmware_file_info.h"
@@ -24,8 +29,10 @@ class FirmwareFile {
 
   // Prepares the firmware file based on the given firmware file information.
   // If the firmware file is compressed, it decompresses the firmware file into
-  // a temporary directory, which will be cleaned up upon destruction of this
-  // object.
+  // an anonymous in-memory file, which is exposed through a temporary
+  // directory and released upon destruction of this object. If in-memory files
+  // are not supported, the firmware file is decompressed into the temporary
+  // directory instead.
   bool PrepareFrom(const base::FilePath& firmware_dir,
                    const FirmwareFileInfo& file_info);
 
@@ -38,8 +45,26 @@ class FirmwareFile {
     return path_on_filesystem_;
   }
 
+  // Returns the descriptor which the flashing helper must inherit, under the
+  // same number, to open |path_on_filesystem()|, or -1 if it doesn't need any.
+  // The descriptor is close-on-exec so that other helpers don't inherit it.
+  int helper_fd() const { return memfd_.get(); }
+
+  // Returns true if the firmware was decompressed, and the compressed file
+  // still has the same size and modification time as when it was.
+  bool IsDecompressedAndUpToDate() const;
+
  private:
+  // Seals the in-memory |file| holding the decompressed firmware, keeps it
+  // open as |memfd_| and exposes it as a symbolic link at |path|.
+  bool AttachMemoryFile(base::File file, const base::FilePath& path);
+
   base::ScopedTempDir temp_dir_;
+  // Holds the decompressed firmware. It is only inherited by the flashing
+  // helper, which accesses it through the symbolic link |path_on_filesystem_|.
+  base::ScopedFD memfd_;
+  // The compressed file when it was decompressed.
+  std::optional<base::File::Info> compressed_file_info_;
   base::FilePath path_for_logging_;
   base::FilePath path_on_filesystem_;
 };
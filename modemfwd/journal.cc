@@ -102,8 +102,8 @@ bool RestartOperation(const JournalEntry& entry,
       continue;
     }
 
-    flashed_fw.push_back(
-        {fw_type, firmware_file->path_on_filesystem(), info->version});
+    flashed_fw.push_back({fw_type, firmware_file->path_on_filesystem(),
+                          info->version, firmware_file->helper_fd()});
     paths_for_logging.push_back(firmware_file->path_for_logging().value());
     all_files.push_back(std::move(firmware_file));
   }
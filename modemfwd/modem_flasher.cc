@@ -9,9 +9,11 @@
 #include <utility>
 #include <vector>
 
+#include <base/bind.h>
 #include <base/files/file_util.h>
 #include <base/logging.h>
 #include <base/stl_util.h>
+#include <base/time/time.h>
 #include <chromeos/switches/modemfwd_switches.h>
 #include <dbus/modemfwd/dbus-constants.h>
 
@@ -22,6 +24,8 @@
 
 namespace modemfwd {
 
+const base::TimeDelta kDecompressedFilesLifetime = base::Minutes(2);
+
 namespace {
 
 class InhibitMode {
@@ -62,6 +66,8 @@ base::OnceClosure ModemFlasher::TryFlash(Modem* modem) {
                << "\" failed to flash too many times; not flashing";
     notification_mgr_->NotifyUpdateFirmwareCompletedFailure(
         kErrorResultFlashFailure);
+    decompressed_files_timer_.Stop();
+    decompressed_files_.clear();
     return base::OnceClosure();
   }
 
@@ -91,15 +97,14 @@ base::OnceClosure ModemFlasher::TryFlash(Modem* modem) {
       // Pretend that we successfully flashed it.
       flash_state->OnFlashedMainFirmware();
     } else {
-      auto firmware_file = std::make_unique<FirmwareFile>();
-      if (!firmware_file->PrepareFrom(firmware_directory_->GetFirmwarePath(),
-                                      file_info))
+      auto firmware_file = PrepareFirmwareFile(file_info);
+      if (!firmware_file)
         return base::OnceClosure();
 
       // We found different firmware!
       // record to flash the main firmware binary.
-      flash_cfg.push_back(
-          {kFwMain, firmware_file->path_on_filesystem(), file_info.version});
+      flash_cfg.push_back({kFwMain, firmware_file->path_on_filesystem(),
+                           file_info.version, firmware_file->helper_fd()});
       flash_files[kFwMain] = std::move(firmware_file);
     }
   }
@@ -113,13 +118,12 @@ base::OnceClosure ModemFlasher::TryFlash(Modem* modem) {
     if (file_info.version == modem->GetOemFirmwareVersion()) {
       flash_state->OnFlashedOemFirmware();
     } else {
-      auto firmware_file = std::make_unique<FirmwareFile>();
-      if (!firmware_file->PrepareFrom(firmware_directory_->GetFirmwarePath(),
-                                      file_info))
+      auto firmware_file = PrepareFirmwareFile(file_info);
+      if (!firmware_file)
         return base::OnceClosure();
 
-      flash_cfg.push_back(
-          {kFwOem, firmware_file->path_on_filesystem(), file_info.version});
+      flash_cfg.push_back({kFwOem, firmware_file->path_on_filesystem(),
+                           file_info.version, firmware_file->helper_fd()});
       flash_files[kFwOem] = std::move(firmware_file);
     }
   }
@@ -152,13 +156,12 @@ base::OnceClosure ModemFlasher::TryFlash(Modem* modem) {
         !firmware_directory_->IsUsingSameFirmware(device_id, carrier_fw_id,
                                                   current_carrier) ||
         carrier_fw_version != file_info.version) {
-      auto firmware_file = std::make_unique<FirmwareFile>();
-      if (!firmware_file->PrepareFrom(firmware_directory_->GetFirmwarePath(),
-                                      file_info))
+      auto firmware_file = PrepareFirmwareFile(file_info);
+      if (!firmware_file)
         return base::OnceClosure();
 
-      flash_cfg.push_back(
-          {kFwCarrier, firmware_file->path_on_filesystem(), file_info.version});
+      flash_cfg.push_back({kFwCarrier, firmware_file->path_on_filesystem(),
+                           file_info.version, firmware_file->helper_fd()});
       flash_files[kFwCarrier] = std::move(firmware_file);
     }
   } else {
@@ -192,8 +195,12 @@ base::OnceClosure ModemFlasher::TryFlash(Modem* modem) {
   if (!modem->FlashFirmwares(flash_cfg)) {
     flash_state->OnFlashFailed();
     journal_->MarkEndOfFlashingFirmware(device_id, current_carrier);
+
+    KeepDecompressedFiles(std::move(flash_files));
     return base::OnceClosure();
   }
+  decompressed_files_timer_.Stop();
+  decompressed_files_.clear();
 
   for (const auto& info : flash_cfg) {
     std::string fw_type = info.fw_type;
@@ -212,4 +219,49 @@ base::OnceClosure ModemFlasher::TryFlash(Modem* modem) {
                         current_carrier);
 }
 
+std::unique_ptr<FirmwareFile> ModemFlasher::PrepareFirmwareFile(
+    const FirmwareFileInfo& file_info) {
+  const base::FilePath firmware_dir = firmware_directory_->GetFirmwarePath();
+  const base::FilePath firmware_path =
+      firmware_dir.Append(file_info.firmware_path);
+
+  auto it = decompressed_files_.find(firmware_path);
+  if (it != decompressed_files_.end()) {
+    std::unique_ptr<FirmwareFile> firmware_file = std::move(it->second);
+    decompressed_files_.erase(it);
+    if (firmware_file->IsDecompressedAndUpToDate()) {
+      ELOG(INFO) << "Reusing decompressed firmware " << firmware_path;
+      return firmware_file;
+    }
+  }
+
+  auto firmware_file = std::make_unique<FirmwareFile>();
+  if (!firmware_file->PrepareFrom(firmware_dir, file_info))
+    return nullptr;
+  return firmware_file;
+}
+
+void ModemFlasher::KeepDecompressedFiles(
+    std::map<std::string, std::unique_ptr<FirmwareFile>> flash_files) {
+  decompressed_files_.clear();
+  for (auto& entry : flash_files) {
+    // Uncompressed firmware files are flashed as is.
+    if (entry.second->IsDecompressedAndUpToDate()) {
+      const base::FilePath path = entry.second->path_for_logging();
+      decompressed_files_[path] = std::move(entry.second);
+    }
+  }
+  if (decompressed_files_.empty())
+    return;
+
+  decompressed_files_timer_.Start(
+      FROM_HERE, kDecompressedFilesLifetime,
+      base::BindOnce(
+          [](ModemFlasher* flasher) {
+            ELOG(INFO) << "Releasing decompressed firmware";
+            flasher->decompressed_files_.clear();
+          },
+          base::Unretained(this)));
+}
+
 }  // namespace modemfwd
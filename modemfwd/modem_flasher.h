@@ -11,14 +11,22 @@
 #include <string>
 
 #include <base/callback.h>
+#include <base/files/file_path.h>
+#include <base/time/time.h>
+#include <base/timer/timer.h>
 
 #include "modemfwd/firmware_directory.h"
+#include "modemfwd/firmware_file.h"
 #include "modemfwd/journal.h"
 #include "modemfwd/modem.h"
 #include "modemfwd/notification_manager.h"
 
 namespace modemfwd {
 
+// How long the firmware decompressed for a failed attempt is kept for the
+// retry, which happens when the modem reappears.
+extern const base::TimeDelta kDecompressedFilesLifetime;
+
 // ModemFlasher contains all of the logic to make decisions about whether
 // or not it should flash new firmware onto the modem.
 class ModemFlasher {
@@ -38,6 +46,17 @@ class ModemFlasher {
                                        const std::string& variant);
 
  private:
+  // Returns the firmware file described by |file_info| ready to be flashed,
+  // or nullptr on failure. The firmware decompressed by the previous failed
+  // attempt is reused if the compressed file didn't change.
+  std::unique_ptr<FirmwareFile> PrepareFirmwareFile(
+      const FirmwareFileInfo& file_info);
+
+  // Keeps the decompressed files of |flash_files| for the next attempt, for at
+  // most |kDecompressedFilesLifetime|.
+  void KeepDecompressedFiles(
+      std::map<std::string, std::unique_ptr<FirmwareFile>> flash_files);
+
   class FlashState {
    public:
     FlashState() = default;
@@ -100,6 +119,13 @@ class ModemFlasher {
 
   std::map<std::string, FlashState> modem_info_;
 
+  // Firmware files decompressed for the last failed flashing attempt, keyed by
+  // the path of their compressed file, so that retrying when the modem
+  // reappears doesn't need to decompress them again. They can take hundreds of
+  // MiB of memory, so they are released if the modem doesn't come back soon.
+  std::map<base::FilePath, std::unique_ptr<FirmwareFile>> decompressed_files_;
+  base::OneShotTimer decompressed_files_timer_;
+
   // Owned by Daemon
   FirmwareDirectory* firmware_directory_;
   NotificationManager* notification_mgr_;
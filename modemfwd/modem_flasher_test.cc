@@ -4,11 +4,19 @@
 
 #include "modemfwd/modem_flasher.h"
 
+#include <fcntl.h>
+
 #include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
 #include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_temp_dir.h>
+#include <base/strings/stringprintf.h>
+#include <base/test/task_environment.h>
+#include <base/time/time.h>
 #include <chromeos/switches/modemfwd_switches.h>
 #include <gtest/gtest.h>
 
@@ -19,6 +27,7 @@
 
 using ::testing::_;
 using ::testing::AtLeast;
+using ::testing::Invoke;
 using ::testing::Mock;
 using ::testing::Return;
 
@@ -34,6 +43,30 @@ constexpr char kMainFirmware1Version[] = "versionA";
 
 constexpr char kMainFirmware2Path[] = "main_fw_2.fls";
 constexpr char kMainFirmware2Version[] = "versionB";
+constexpr char kCompressedMainFirmware2Path[] = "main_fw_2.fls.xz";
+
+// Generated from `echo test | xz | xxd -i`
+constexpr uint8_t kCompressedFirmware[] = {
+    0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6, 0xb4,
+    0x46, 0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00, 0x74, 0x2f,
+    0xe5, 0xa3, 0x01, 0x00, 0x04, 0x74, 0x65, 0x73, 0x74, 0x0a, 0x00,
+    0x00, 0x00, 0x00, 0x9d, 0xed, 0x31, 0x1d, 0x0f, 0x9f, 0xd7, 0xe6,
+    0x00, 0x01, 0x1d, 0x05, 0xb8, 0x2d, 0x80, 0xaf, 0x1f, 0xb6, 0xf3,
+    0x7d, 0x01, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a,
+};
+constexpr char kDecompressedFirmware[] = "test\n";
+
+// Generated from `echo firmware-v2 | xz | xxd -i`
+constexpr uint8_t kCompressedOtherFirmware[] = {
+    0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6, 0xb4, 0x46,
+    0x04, 0xc0, 0x10, 0x0c, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x7b, 0xb0, 0x54, 0x28, 0x01, 0x00, 0x0b, 0x66,
+    0x69, 0x72, 0x6d, 0x77, 0x61, 0x72, 0x65, 0x2d, 0x76, 0x32, 0x0a, 0x00,
+    0xc1, 0xde, 0x6d, 0x9e, 0xab, 0x2e, 0x98, 0xa4, 0x00, 0x01, 0x2c, 0x0c,
+    0xae, 0x92, 0x01, 0x10, 0x1f, 0xb6, 0xf3, 0x7d, 0x01, 0x00, 0x00, 0x00,
+    0x00, 0x04, 0x59, 0x5a,
+};
+constexpr char kDecompressedOtherFirmware[] = "firmware-v2\n";
 
 constexpr char kOemFirmware1Path[] = "oem_cust_1.fls";
 constexpr char kOemFirmware1Version[] = "6000.1";
@@ -62,8 +95,17 @@ constexpr char kGenericCarrierFirmware2Version[] = "2017-10-14";
 class ModemFlasherTest : public ::testing::Test {
  public:
   ModemFlasherTest() {
-    firmware_directory_ =
-        std::make_unique<FirmwareDirectoryStub>(base::FilePath());
+    CreateModemFlasher(base::FilePath());
+
+    only_main_ = {kFwMain};
+    only_carrier_ = {kFwCarrier};
+  }
+
+ protected:
+  // Replaces the modem flasher by one looking for firmware in |firmware_dir|.
+  void CreateModemFlasher(const base::FilePath& firmware_dir) {
+    modem_flasher_.reset();
+    firmware_directory_ = std::make_unique<FirmwareDirectoryStub>(firmware_dir);
 
     auto journal = std::make_unique<MockJournal>();
     journal_ = journal.get();
@@ -72,12 +114,8 @@ class ModemFlasherTest : public ::testing::Test {
 
     modem_flasher_ = std::make_unique<ModemFlasher>(
         firmware_directory_.get(), std::move(journal), notification_mgr_.get());
-
-    only_main_ = {kFwMain};
-    only_carrier_ = {kFwCarrier};
   }
 
- protected:
   void AddMainFirmwareFile(const std::string& device_id,
                            const base::FilePath& rel_firmware_path,
                            const std::string& version) {
@@ -85,6 +123,14 @@ class ModemFlasherTest : public ::testing::Test {
     firmware_directory_->AddMainFirmware(kDeviceId1, firmware_info);
   }
 
+  void AddCompressedMainFirmwareFile(const std::string& device_id,
+                                     const base::FilePath& rel_firmware_path,
+                                     const std::string& version) {
+    FirmwareFileInfo firmware_info(rel_firmware_path.value(), version,
+                                   FirmwareFileInfo::Compression::XZ);
+    firmware_directory_->AddMainFirmware(kDeviceId1, firmware_info);
+  }
+
   void AddMainFirmwareFileForCarrier(const std::string& device_id,
                                      const std::string& carrier_name,
                                      const base::FilePath& rel_firmware_path,
@@ -144,6 +190,8 @@ class ModemFlasherTest : public ::testing::Test {
     ON_CALL(*modem, GetCarrierFirmwareVersion()).WillByDefault(Return(version));
   }
 
+  base::test::TaskEnvironment task_environment_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
   MockJournal* journal_;
   std::unique_ptr<ModemFlasher> modem_flasher_;
   std::unique_ptr<MockNotificationManager> notification_mgr_;
@@ -175,6 +223,20 @@ TEST_F(ModemFlasherTest, FlashMainFirmware) {
   modem_flasher_->TryFlash(modem.get());
 }
 
+TEST_F(ModemFlasherTest, FlashUncompressedFirmwareWithoutDescriptor) {
+  base::FilePath new_firmware(kMainFirmware2Path);
+  AddMainFirmwareFile(kDeviceId1, new_firmware, kMainFirmware2Version);
+
+  auto modem = GetDefaultModem();
+  EXPECT_CALL(*modem, FlashFirmwares(_))
+      .WillOnce(Invoke([](const std::vector<FirmwareConfig>& configs) {
+        EXPECT_EQ(configs.size(), 1u);
+        EXPECT_EQ(configs[0].fd, -1);
+        return true;
+      }));
+  modem_flasher_->TryFlash(modem.get());
+}
+
 TEST_F(ModemFlasherTest, FlashMainFirmwareEmptyCarrier) {
   base::FilePath new_firmware(kMainFirmware2Path);
   AddMainFirmwareFile(kDeviceId1, new_firmware, kMainFirmware2Version);
@@ -717,4 +779,111 @@ TEST_F(ModemFlasherTest, SkipCarrierWithTwoUuidSameFirmware) {
   modem_flasher_->TryFlash(modem.get());
 }
 
+class ModemFlasherDecompressionTest : public ModemFlasherTest {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    CreateModemFlasher(temp_dir_.GetPath());
+
+    compressed_firmware_ =
+        temp_dir_.GetPath().Append(kCompressedMainFirmware2Path);
+    WriteCompressedFirmware(kCompressedFirmware, sizeof(kCompressedFirmware));
+    AddCompressedMainFirmwareFile(kDeviceId1,
+                                  base::FilePath(kCompressedMainFirmware2Path),
+                                  kMainFirmware2Version);
+    modem_ = GetDefaultModem();
+  }
+
+  void WriteCompressedFirmware(const uint8_t* content, int size) {
+    ASSERT_EQ(base::WriteFile(compressed_firmware_,
+                              reinterpret_cast<const char*>(content), size),
+              size);
+  }
+
+  // Tries to flash |modem_|, checking that the helper reads
+  // |expected_content| as the main firmware, and makes the helper succeed or
+  // fail depending on |success|. Returns the configuration of the firmware.
+  FirmwareConfig TryFlash(bool success, const std::string& expected_content) {
+    FirmwareConfig flashed_config;
+    EXPECT_CALL(*modem_, FlashFirmwares(_))
+        .WillOnce(Invoke([&](const std::vector<FirmwareConfig>& configs) {
+          EXPECT_EQ(configs.size(), 1u);
+          if (configs.empty())
+            return success;
+          flashed_config = configs[0];
+          std::string content;
+          EXPECT_TRUE(base::ReadFileToString(configs[0].path, &content));
+          EXPECT_EQ(content, expected_content);
+          return success;
+        }));
+    modem_flasher_->TryFlash(modem_.get());
+    return flashed_config;
+  }
+
+  base::ScopedTempDir temp_dir_;
+  base::FilePath compressed_firmware_;
+  std::unique_ptr<MockModem> modem_;
+};
+
+TEST_F(ModemFlasherDecompressionTest, PassDescriptorOnlyToFlashingHelper) {
+  EXPECT_CALL(*modem_, FlashFirmwares(_))
+      .WillOnce(Invoke([](const std::vector<FirmwareConfig>& configs) {
+        EXPECT_EQ(configs.size(), 1u);
+        if (configs.empty())
+          return true;
+        // The descriptor is close-on-exec so that only the flashing helper,
+        // which clears the flag, inherits it.
+        const int fd = configs[0].fd;
+        EXPECT_GE(fd, 0);
+        EXPECT_EQ(fcntl(fd, F_GETFD) & FD_CLOEXEC, FD_CLOEXEC);
+        base::FilePath target;
+        EXPECT_TRUE(base::ReadSymbolicLink(configs[0].path, &target));
+        EXPECT_EQ(target.value(), base::StringPrintf("/proc/self/fd/%d", fd));
+        return true;
+      }));
+  modem_flasher_->TryFlash(modem_.get());
+}
+
+TEST_F(ModemFlasherDecompressionTest, ReuseDecompressedFirmwareOnRetry) {
+  const FirmwareConfig failed = TryFlash(false, kDecompressedFirmware);
+  const FirmwareConfig retried = TryFlash(true, kDecompressedFirmware);
+  EXPECT_EQ(retried.path, failed.path);
+  EXPECT_EQ(retried.fd, failed.fd);
+}
+
+TEST_F(ModemFlasherDecompressionTest, DecompressAgainIfSizeChanged) {
+  const FirmwareConfig failed = TryFlash(false, kDecompressedFirmware);
+  WriteCompressedFirmware(kCompressedOtherFirmware,
+                          sizeof(kCompressedOtherFirmware));
+  const FirmwareConfig retried = TryFlash(true, kDecompressedOtherFirmware);
+  EXPECT_NE(retried.path, failed.path);
+}
+
+TEST_F(ModemFlasherDecompressionTest, DecompressAgainIfMtimeChanged) {
+  const FirmwareConfig failed = TryFlash(false, kDecompressedFirmware);
+  base::File::Info info;
+  ASSERT_TRUE(base::GetFileInfo(compressed_firmware_, &info));
+  ASSERT_TRUE(base::TouchFile(compressed_firmware_, info.last_accessed,
+                              info.last_modified - base::Seconds(10)));
+  const FirmwareConfig retried = TryFlash(true, kDecompressedFirmware);
+  EXPECT_NE(retried.path, failed.path);
+}
+
+TEST_F(ModemFlasherDecompressionTest, ReleaseDecompressedFirmwareOnTimer) {
+  const FirmwareConfig failed = TryFlash(false, kDecompressedFirmware);
+  task_environment_.FastForwardBy(kDecompressedFilesLifetime -
+                                  base::Seconds(1));
+  EXPECT_TRUE(base::PathExists(failed.path));
+
+  task_environment_.FastForwardBy(base::Seconds(1));
+  EXPECT_FALSE(base::PathExists(failed.path));
+  const FirmwareConfig retried = TryFlash(true, kDecompressedFirmware);
+  EXPECT_NE(retried.path, failed.path);
+}
+
+TEST_F(ModemFlasherDecompressionTest, ReleaseDecompressedFirmwareOnSuccess) {
+  const FirmwareConfig flashed = TryFlash(true, kDecompressedFirmware);
+  EXPECT_FALSE(base::PathExists(flashed.path));
+}
+
 }  // namespace modemfwd
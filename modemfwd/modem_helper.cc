@@ -4,11 +4,14 @@
 
 #include "modemfwd/modem_helper.h"
 
+#include <fcntl.h>
+
 #include <memory>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include <base/bind.h>
 #include <base/check.h>
 #include <base/files/file.h>
 #include <base/files/file_util.h>
@@ -31,14 +34,26 @@ constexpr char kPowerOverrideLockFilePath[] =
 
 constexpr char kModemfwdLogDirectory[] = "/var/log/modemfwd";
 
+// Clears the close-on-exec flag of |fds| in the child process.
+bool InheritFds(const std::vector<int>& fds) {
+  for (int fd : fds) {
+    if (fcntl(fd, F_SETFD, 0) < 0)
+      return false;
+  }
+  return true;
+}
+
 bool RunHelperProcessWithLogs(const HelperInfo& helper_info,
-                              const std::vector<std::string>& arguments) {
+                              const std::vector<std::string>& arguments,
+                              const std::vector<int>& inherited_fds = {}) {
   brillo::ProcessImpl helper;
   helper.AddArg(helper_info.executable_path.value());
   for (const std::string& argument : arguments)
     helper.AddArg("--" + argument);
   for (const std::string& extra_argument : helper_info.extra_arguments)
     helper.AddArg(extra_argument);
+  if (!inherited_fds.empty())
+    helper.SetPreExecCallback(base::BindOnce(&InheritFds, inherited_fds));
 
   base::Time::Exploded time;
   base::Time::Now().LocalExplode(&time);
@@ -204,7 +219,10 @@ class ModemHelperImpl : public ModemHelper {
 
     std::vector<std::string> firmwares;
     std::vector<std::string> versions;
+    std::vector<int> fds;
     for (const auto& config : configs) {
+      if (config.fd >= 0)
+        fds.push_back(config.fd);
       firmwares.push_back(base::StringPrintf("%s:%s", config.fw_type.c_str(),
                                              config.path.value().c_str()));
       versions.push_back(base::StringPrintf("%s:%s", config.fw_type.c_str(),
@@ -216,7 +234,8 @@ class ModemHelperImpl : public ModemHelper {
         {base::StringPrintf("%s=%s", kFlashFirmware,
                             base::JoinString(firmwares, ",").c_str()),
          base::StringPrintf("%s=%s", kFwVersion,
-                            base::JoinString(versions, ",").c_str())});
+                            base::JoinString(versions, ",").c_str())},
+        fds);
   }
 
   bool FlashModeCheck() override {
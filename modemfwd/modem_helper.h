@@ -43,6 +43,8 @@ struct FirmwareConfig {
   std::string fw_type;
   base::FilePath path;
   std::string version;
+  // Descriptor which the helper must inherit to open |path|, or -1.
+  int fd = -1;
 
   // Used to get a proper default matcher in googletest.
   bool operator==(const FirmwareConfig& rhs) const {
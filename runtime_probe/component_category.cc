@@ -40,18 +40,28 @@ std::unique_ptr<ComponentCategory> ComponentCategory::FromValue(
 }
 
 base::Value ComponentCategory::Eval() const {
+  ProbeFunctionBatch batch;
+  AddProbeFunctions(&batch);
+  batch.Eval();
+  return Eval(batch);
+}
+
+base::Value ComponentCategory::Eval(const ProbeFunctionBatch& batch) const {
   base::Value::ListStorage results;
 
   for (const auto& entry : component_) {
     const auto& component_name = entry.first;
     const auto& probe_statement = entry.second;
-    for (auto& probe_statement_dv : probe_statement->Eval()) {
+    const double eval_time_ms =
+        probe_statement->GetElapsedTime(batch).InMillisecondsF();
+    for (auto& probe_statement_dv : probe_statement->Eval(batch)) {
       base::Value result(base::Value::Type::DICTIONARY);
       result.SetStringKey("name", component_name);
       result.SetKey("values", std::move(probe_statement_dv));
       auto information_dv = probe_statement->GetInformation();
       if (information_dv)
         result.SetKey("information", std::move(*information_dv));
+      result.SetDoubleKey("eval_time_ms", eval_time_ms);
       results.push_back(std::move(result));
     }
   }
@@ -59,6 +69,11 @@ base::Value ComponentCategory::Eval() const {
   return base::Value(std::move(results));
 }
 
+void ComponentCategory::AddProbeFunctions(ProbeFunctionBatch* batch) const {
+  for (const auto& entry : component_)
+    entry.second->AddProbeFunction(batch);
+}
+
 std::vector<std::string> ComponentCategory::GetComponentNames() const {
   return brillo::GetMapKeysAsVector(component_);
 }
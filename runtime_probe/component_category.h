@@ -13,6 +13,7 @@
 #include <base/values.h>
 #include <gtest/gtest.h>
 
+#include "runtime_probe/probe_function_batch.h"
 #include "runtime_probe/probe_statement.h"
 
 namespace runtime_probe {
@@ -31,6 +32,14 @@ class ComponentCategory {
   // Evaluates this category and return a base::Value with type list.
   base::Value Eval() const;
 
+  // Same as |Eval()|, but takes the results of the probe functions from
+  // |batch|, to which they must have been added with |AddProbeFunctions()|.
+  base::Value Eval(const ProbeFunctionBatch& batch) const;
+
+  // Adds the probe functions of all the components of this category to
+  // |batch|.
+  void AddProbeFunctions(ProbeFunctionBatch* batch) const;
+
   std::vector<std::string> GetComponentNames() const;
 
  private:
@@ -11,6 +11,7 @@
 
 #include "runtime_probe/component_category.h"
 #include "runtime_probe/probe_config.h"
+#include "runtime_probe/probe_function_batch.h"
 
 namespace runtime_probe {
 
@@ -44,14 +45,26 @@ base::Value ProbeConfig::Eval() const {
 base::Value ProbeConfig::Eval(const std::vector<std::string>& category) const {
   base::Value result(base::Value::Type::DICTIONARY);
 
+  // Evaluate the probe functions of all the categories at once, so that
+  // probe functions shared by several categories are only evaluated once and
+  // helpers run concurrently.
+  ProbeFunctionBatch batch;
   for (const auto& c : category) {
     auto it = category_.find(c);
     if (it == category_.end()) {
       LOG(ERROR) << "Category " << c << " is not defined";
       continue;
     }
+    it->second->AddProbeFunctions(&batch);
+  }
+  batch.Eval();
+
+  for (const auto& c : category) {
+    auto it = category_.find(c);
+    if (it == category_.end())
+      continue;
 
-    result.SetKey(c, it->second->Eval());
+    result.SetKey(c, it->second->Eval(batch));
   }
 
   return result;
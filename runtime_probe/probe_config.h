@@ -40,7 +40,8 @@ class ProbeConfig {
   //       {
   //         "name": <component_name:string>,
   //         "values": <probed_values of ProbeStatement>,
-  //         "information": <information of ProbeStatement>
+  //         "information": <information of ProbeStatement>,
+  //         "eval_time_ms": <time taken by the probe function:double>
   //       }
   //     ]
   //   }
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 
 #include <base/check.h>
@@ -19,7 +20,66 @@ namespace runtime_probe {
 
 using DataType = typename ProbeFunction::DataType;
 
-ProbeFunction::ProbeFunction(base::Value&& raw_value) {}
+namespace {
+
+// Evaluates a probe function only when its results are waited for.
+class DeferredPendingEval : public ProbeFunction::PendingEval {
+ public:
+  explicit DeferredPendingEval(const ProbeFunction* probe_function)
+      : probe_function_(probe_function) {}
+
+  DataType Wait() override {
+    const base::TimeTicks start = base::TimeTicks::Now();
+    DataType results = probe_function_->Eval();
+    elapsed_time_ = base::TimeTicks::Now() - start;
+    return results;
+  }
+
+  base::TimeDelta GetElapsedTime() const override { return elapsed_time_; }
+
+ private:
+  const ProbeFunction* probe_function_;
+  base::TimeDelta elapsed_time_;
+};
+
+}  // namespace
+
+// Waits for the helper started for a privileged probe function.
+class PrivilegedProbeFunction::HelperPendingEval
+    : public ProbeFunction::PendingEval {
+ public:
+  HelperPendingEval(
+      const PrivilegedProbeFunction* probe_function,
+      std::unique_ptr<HelperInvoker::PendingResult> pending_result,
+      base::TimeTicks start)
+      : probe_function_(probe_function),
+        pending_result_(std::move(pending_result)),
+        start_(start) {}
+
+  // The helper is timed from its start until it ended, even if that was
+  // before this is called.
+  DataType Wait() override {
+    std::string raw_output;
+    if (!pending_result_ || !pending_result_->Wait(&raw_output)) {
+      LOG(ERROR) << "Failed to invoke helper (empty output).";
+      elapsed_time_ = base::TimeTicks::Now() - start_;
+      return {};
+    }
+    elapsed_time_ = pending_result_->GetEndTime() - start_;
+    return probe_function_->EvalFromHelperOutput(raw_output);
+  }
+
+  base::TimeDelta GetElapsedTime() const override { return elapsed_time_; }
+
+ private:
+  const PrivilegedProbeFunction* probe_function_;
+  std::unique_ptr<HelperInvoker::PendingResult> pending_result_;
+  const base::TimeTicks start_;
+  base::TimeDelta elapsed_time_;
+};
+
+ProbeFunction::ProbeFunction(base::Value&& raw_value)
+    : raw_value_(std::move(raw_value)) {}
 
 std::unique_ptr<ProbeFunction> ProbeFunction::FromValue(const base::Value& dv) {
   if (!dv.is_dict()) {
@@ -61,6 +121,10 @@ std::unique_ptr<ProbeFunction> ProbeFunction::FromValue(const base::Value& dv) {
       registered_functions_[function_name](kwargs));
 }
 
+std::unique_ptr<ProbeFunction::PendingEval> ProbeFunction::StartEval() const {
+  return std::make_unique<DeferredPendingEval>(this);
+}
+
 int ProbeFunction::EvalInHelper(std::string* /*output*/) const {
   LOG(ERROR) << "Probe function \"" << GetFunctionName()
              << "\" cannot be invoked in helper.";
@@ -68,11 +132,11 @@ int ProbeFunction::EvalInHelper(std::string* /*output*/) const {
 }
 
 PrivilegedProbeFunction::PrivilegedProbeFunction(base::Value&& raw_value)
-    : raw_value_(std::move(raw_value)) {}
+    : ProbeFunction(std::move(raw_value)) {}
 
 bool PrivilegedProbeFunction::InvokeHelper(std::string* result) const {
   std::string probe_statement_str;
-  base::JSONWriter::Write(raw_value_, &probe_statement_str);
+  base::JSONWriter::Write(raw_value(), &probe_statement_str);
 
   return Context::Get()->helper_invoker()->Invoke(
       /*probe_function=*/this, probe_statement_str, result);
@@ -98,7 +162,26 @@ int PrivilegedProbeFunction::EvalInHelper(std::string* output) const {
 }
 
 PrivilegedProbeFunction::DataType PrivilegedProbeFunction::Eval() const {
-  auto json_output = InvokeHelperToJSON();
+  return StartEval()->Wait();
+}
+
+std::unique_ptr<ProbeFunction::PendingEval>
+PrivilegedProbeFunction::StartEval() const {
+  std::string probe_statement_str;
+  base::JSONWriter::Write(raw_value(), &probe_statement_str);
+
+  const base::TimeTicks start = base::TimeTicks::Now();
+  return std::make_unique<HelperPendingEval>(
+      this,
+      Context::Get()->helper_invoker()->Start(
+          /*probe_function=*/this, probe_statement_str),
+      start);
+}
+
+PrivilegedProbeFunction::DataType PrivilegedProbeFunction::EvalFromHelperOutput(
+    const std::string& output) const {
+  VLOG(3) << "InvokeHelper raw output:\n" << output;
+  auto json_output = base::JSONReader::Read(output);
   if (!json_output) {
     LOG(ERROR) << "Failed to invoke helper (empty output).";
     return {};
@@ -15,6 +15,7 @@
 #include <vector>
 
 #include <base/json/json_writer.h>
+#include <base/time/time.h>
 #include <base/values.h>
 #include <base/strings/string_util.h>
 
@@ -71,6 +72,20 @@ class ProbeFunction {
  public:
   using DataType = std::vector<base::Value>;
 
+  // An evaluation started by |StartEval()|.
+  class PendingEval {
+   public:
+    virtual ~PendingEval() = default;
+
+    // Waits for the evaluation to end and returns the same results as
+    // |Eval()|.
+    virtual DataType Wait() = 0;
+
+    // Returns the time the evaluation took, from its start to its end, which
+    // may be before |Wait()| was called.  Must be called after |Wait()|.
+    virtual base::TimeDelta GetElapsedTime() const = 0;
+  };
+
   // Returns the name of the probe function.  The returned value should always
   // identical to the static member |function_name| of the derived class.
   //
@@ -95,6 +110,16 @@ class ProbeFunction {
   // function that requests sandboxing, see |PrivilegedProbeFunction|.
   virtual DataType Eval() const { return EvalImpl(); }
 
+  // Starts evaluating this probe function, so that several probe functions can
+  // be evaluated concurrently. The default implementation defers the
+  // evaluation to |PendingEval::Wait()|, while |PrivilegedProbeFunction|
+  // starts its helper right away.
+  virtual std::unique_ptr<PendingEval> StartEval() const;
+
+  // Returns the value this probe function was created from, with function name
+  // as key. Identical values describe identical probe functions.
+  const base::Value& raw_value() const { return raw_value_; }
+
   // This is for helper to evaluate the probe function. Helper is designed for
   // portion that need extended sandbox. See |PrivilegedProbeFunction| for more
   // detials.
@@ -123,6 +148,10 @@ class ProbeFunction {
   virtual DataType EvalImpl() const = 0;
 
   // Each probe function must define their own args type.
+
+ private:
+  // The value to describe this probe function.
+  base::Value raw_value_;
 };
 
 class PrivilegedProbeFunction : public ProbeFunction {
@@ -139,6 +168,7 @@ class PrivilegedProbeFunction : public ProbeFunction {
  public:
   // ProbeFunction overrides.
   DataType Eval() const final;
+  std::unique_ptr<PendingEval> StartEval() const final;
   int EvalInHelper(std::string* output) const final;
 
   // Redefine this to access protected constructor.
@@ -164,6 +194,11 @@ class PrivilegedProbeFunction : public ProbeFunction {
   std::optional<base::Value> InvokeHelperToJSON() const;
 
  private:
+  class HelperPendingEval;
+
+  // Converts the raw |output| of the helper to the result of |Eval()|.
+  DataType EvalFromHelperOutput(const std::string& output) const;
+
   // This method is called after |EvalImpl()| finished. The |result| is the
   // value returned by |EvalImpl()|. Because |EvalImpl()| is executed in helper,
   // this method is for those operations that cannot or don't want to be
@@ -171,9 +206,6 @@ class PrivilegedProbeFunction : public ProbeFunction {
   // logic out of helper and modify the |result|. See b/185292404 for the
   // discussion about this two steps EvalImpl.
   virtual void PostHelperEvalImpl(DataType* result) const {}
-
-  // The value to describe this probe function.
-  base::Value raw_value_;
 };
 
 #define NAME_PROBE_FUNCTION(name)                       \
@@ -0,0 +1,77 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "runtime_probe/probe_function_batch.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <base/check.h>
+#include <base/json/json_writer.h>
+#include <base/logging.h>
+#include <base/strings/stringprintf.h>
+#include <base/time/time.h>
+
+namespace runtime_probe {
+
+void ProbeFunctionBatch::Add(const ProbeFunction* probe_function) {
+  DCHECK(probe_function);
+  entries_.emplace(GetKey(probe_function), Entry{probe_function, {}, {}});
+}
+
+void ProbeFunctionBatch::Eval() {
+  const base::TimeTicks start = base::TimeTicks::Now();
+
+  std::vector<std::pair<Entry*, std::unique_ptr<ProbeFunction::PendingEval>>>
+      pending_evals;
+  for (auto& [key, entry] : entries_) {
+    pending_evals.emplace_back(&entry, entry.probe_function->StartEval());
+  }
+
+  for (auto& [entry, pending_eval] : pending_evals) {
+    entry->results = pending_eval->Wait();
+    entry->elapsed_time = pending_eval->GetElapsedTime();
+    VLOG(1) << "Probe function \"" << entry->probe_function->GetFunctionName()
+            << "\" returned " << entry->results.size() << " result(s) in "
+            << entry->elapsed_time.InMilliseconds() << " ms";
+  }
+  VLOG(1) << "Evaluated " << entries_.size() << " probe function(s) in "
+          << (base::TimeTicks::Now() - start).InMilliseconds() << " ms";
+}
+
+ProbeFunction::DataType ProbeFunctionBatch::GetResults(
+    const ProbeFunction* probe_function) const {
+  const auto it = entries_.find(GetKey(probe_function));
+  DCHECK(it != entries_.end());
+  if (it == entries_.end())
+    return {};
+
+  ProbeFunction::DataType results;
+  for (const auto& result : it->second.results)
+    results.push_back(result.Clone());
+  return results;
+}
+
+base::TimeDelta ProbeFunctionBatch::GetElapsedTime(
+    const ProbeFunction* probe_function) const {
+  const auto it = entries_.find(GetKey(probe_function));
+  DCHECK(it != entries_.end());
+  if (it == entries_.end())
+    return base::TimeDelta();
+  return it->second.elapsed_time;
+}
+
+// static
+std::string ProbeFunctionBatch::GetKey(const ProbeFunction* probe_function) {
+  // Probe functions not created from a value cannot be compared.
+  if (probe_function->raw_value().is_none())
+    return base::StringPrintf("%p", probe_function);
+
+  std::string key;
+  base::JSONWriter::Write(probe_function->raw_value(), &key);
+  return key;
+}
+
+}  // namespace runtime_probe
@@ -0,0 +1,66 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef RUNTIME_PROBE_PROBE_FUNCTION_BATCH_H_
+#define RUNTIME_PROBE_PROBE_FUNCTION_BATCH_H_
+
+#include <map>
+#include <string>
+
+#include <base/time/time.h>
+
+#include "runtime_probe/probe_function.h"
+
+namespace runtime_probe {
+
+class ProbeFunctionBatch {
+  // Evaluates a set of probe functions together, e.g. all the probe functions
+  // of a probe config.
+  //
+  // Identical probe functions, that is probe functions with the same name and
+  // arguments, are only evaluated once even if they are used by several
+  // components or categories.  All the helpers of |PrivilegedProbeFunction|
+  // are started before any probe function is waited for, so they run
+  // concurrently with each other and with the unprivileged probe functions.
+ public:
+  ProbeFunctionBatch() = default;
+  ProbeFunctionBatch(const ProbeFunctionBatch&) = delete;
+  ProbeFunctionBatch& operator=(const ProbeFunctionBatch&) = delete;
+
+  // Adds |probe_function| to the batch.  |probe_function| must outlive the
+  // batch.
+  void Add(const ProbeFunction* probe_function);
+
+  // Evaluates all the probe functions added to the batch.
+  void Eval();
+
+  // Returns the results of |probe_function|, which must have been added to
+  // the batch before calling |Eval()|.
+  ProbeFunction::DataType GetResults(
+      const ProbeFunction* probe_function) const;
+
+  // Returns the time the evaluation of |probe_function| took, from its own
+  // start to its end.  |probe_function| must have been added to the batch
+  // before calling |Eval()|.
+  base::TimeDelta GetElapsedTime(const ProbeFunction* probe_function) const;
+
+  // Returns the number of distinct probe functions in the batch.
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    const ProbeFunction* probe_function;
+    ProbeFunction::DataType results;
+    base::TimeDelta elapsed_time;
+  };
+
+  // Returns the key of |probe_function| in |entries_|.
+  static std::string GetKey(const ProbeFunction* probe_function);
+
+  std::map<std::string, Entry> entries_;
+};
+
+}  // namespace runtime_probe
+
+#endif  // RUNTIME_PROBE_PROBE_FUNCTION_BATCH_H_
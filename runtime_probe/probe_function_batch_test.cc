@@ -0,0 +1,121 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <utility>
+
+#include <base/threading/platform_thread.h>
+#include <base/time/time.h>
+#include <base/values.h>
+#include <gtest/gtest.h>
+
+#include "runtime_probe/probe_function.h"
+#include "runtime_probe/probe_function_batch.h"
+
+namespace runtime_probe {
+namespace {
+
+// Returns the raw value of the probe function |function_name| with |arg| as
+// its only argument.
+base::Value MakeRawValue(const std::string& function_name,
+                         const std::string& arg) {
+  base::Value args(base::Value::Type::DICTIONARY);
+  args.SetStringKey("arg", arg);
+  base::Value raw_value(base::Value::Type::DICTIONARY);
+  raw_value.SetKey(function_name, std::move(args));
+  return raw_value;
+}
+
+// Returns its arguments as its only result and counts its evaluations.
+class CountingProbeFunction : public ProbeFunction {
+ public:
+  NAME_PROBE_FUNCTION("counting_function");
+
+  CountingProbeFunction(const std::string& arg, int* eval_count)
+      : ProbeFunction(MakeRawValue(function_name, arg)),
+        eval_count_(eval_count) {}
+  explicit CountingProbeFunction(int* eval_count) : eval_count_(eval_count) {}
+
+ private:
+  DataType EvalImpl() const override {
+    (*eval_count_)++;
+    DataType results;
+    results.push_back(raw_value().Clone());
+    return results;
+  }
+
+  int* eval_count_;
+};
+
+// Takes |delay| to evaluate.
+class SleepingProbeFunction : public ProbeFunction {
+ public:
+  NAME_PROBE_FUNCTION("sleeping_function");
+
+  SleepingProbeFunction(const std::string& arg, base::TimeDelta delay)
+      : ProbeFunction(MakeRawValue(function_name, arg)), delay_(delay) {}
+
+ private:
+  DataType EvalImpl() const override {
+    base::PlatformThread::Sleep(delay_);
+    return {};
+  }
+
+  base::TimeDelta delay_;
+};
+
+TEST(ProbeFunctionBatchTest, EvalIdenticalFunctionsOnce) {
+  int eval_count = 0;
+  CountingProbeFunction function_a("a", &eval_count);
+  CountingProbeFunction function_a2("a", &eval_count);
+  CountingProbeFunction function_b("b", &eval_count);
+
+  ProbeFunctionBatch batch;
+  batch.Add(&function_a);
+  batch.Add(&function_a2);
+  batch.Add(&function_b);
+  EXPECT_EQ(batch.size(), 2);
+
+  batch.Eval();
+  EXPECT_EQ(eval_count, 2);
+
+  for (const auto* function : {&function_a, &function_a2, &function_b}) {
+    auto results = batch.GetResults(function);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results[0], function->raw_value());
+  }
+}
+
+TEST(ProbeFunctionBatchTest, EvalFunctionsWithoutValueSeparately) {
+  int eval_count = 0;
+  CountingProbeFunction function_a(&eval_count);
+  CountingProbeFunction function_b(&eval_count);
+
+  ProbeFunctionBatch batch;
+  batch.Add(&function_a);
+  batch.Add(&function_b);
+  EXPECT_EQ(batch.size(), 2);
+
+  batch.Eval();
+  EXPECT_EQ(eval_count, 2);
+}
+
+TEST(ProbeFunctionBatchTest, TimeEachFunctionSeparately) {
+  // |function_a| is evaluated first.
+  SleepingProbeFunction function_a("a", base::Milliseconds(200));
+  SleepingProbeFunction function_b("b", base::Milliseconds(10));
+
+  ProbeFunctionBatch batch;
+  batch.Add(&function_a);
+  batch.Add(&function_b);
+  batch.Eval();
+
+  EXPECT_GE(batch.GetElapsedTime(&function_a), base::Milliseconds(200));
+  EXPECT_GE(batch.GetElapsedTime(&function_b), base::Milliseconds(10));
+  // The evaluation of |function_a| isn't counted for |function_b|.
+  EXPECT_LT(batch.GetElapsedTime(&function_b), base::Milliseconds(200));
+}
+
+}  // namespace
+}  // namespace runtime_probe
@@ -93,8 +93,16 @@ std::unique_ptr<ProbeStatement> ProbeStatement::FromValue(
 }
 
 ProbeFunction::DataType ProbeStatement::Eval() const {
-  auto results = eval_->Eval();
+  return ProcessResults(eval_->Eval());
+}
+
+ProbeFunction::DataType ProbeStatement::Eval(
+    const ProbeFunctionBatch& batch) const {
+  return ProcessResults(batch.GetResults(eval_.get()));
+}
 
+ProbeFunction::DataType ProbeStatement::ProcessResults(
+    ProbeFunction::DataType results) const {
   if (!key_.empty()) {
     std::for_each(results.begin(), results.end(),
                   [this](auto& result) { FilterValueByKey(&result, key_); });
@@ -114,4 +122,5 @@ ProbeFunction::DataType ProbeStatement::Eval() const {
 
   return results;
 }
+
 }  // namespace runtime_probe
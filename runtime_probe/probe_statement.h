@@ -17,6 +17,7 @@
 #include <gtest/gtest.h>
 
 #include "runtime_probe/probe_function.h"
+#include "runtime_probe/probe_function_batch.h"
 #include "runtime_probe/probe_result_checker.h"
 
 namespace runtime_probe {
@@ -59,6 +60,20 @@ class ProbeStatement {
   // - Return final results that passed |expect_| check.
   ProbeFunction::DataType Eval() const;
 
+  // Same as |Eval()|, but takes the results of the probe function from
+  // |batch|, to which it must have been added with |AddProbeFunction()|.
+  ProbeFunction::DataType Eval(const ProbeFunctionBatch& batch) const;
+
+  // Returns the time the probe function of this statement took in |batch|.
+  base::TimeDelta GetElapsedTime(const ProbeFunctionBatch& batch) const {
+    return batch.GetElapsedTime(eval_.get());
+  }
+
+  // Adds the probe function of this statement to |batch|.
+  void AddProbeFunction(ProbeFunctionBatch* batch) const {
+    batch->Add(eval_.get());
+  }
+
   std::optional<base::Value> GetInformation() const {
     if (information_)
       return information_->Clone();
@@ -68,6 +83,9 @@ class ProbeStatement {
  private:
   ProbeStatement() = default;
 
+  // Filters and checks the |results| of the probe function.
+  ProbeFunction::DataType ProcessResults(ProbeFunction::DataType results) const;
+
   std::string component_name_;
   std::unique_ptr<ProbeFunction> eval_;
   std::set<std::string> key_;
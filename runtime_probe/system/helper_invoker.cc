@@ -0,0 +1,45 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "runtime_probe/system/helper_invoker.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace runtime_probe {
+
+namespace {
+
+// The result of a helper that already ended.
+class CompletedResult : public HelperInvoker::PendingResult {
+ public:
+  CompletedResult(bool success, std::string result)
+      : success_(success), result_(std::move(result)) {}
+
+  bool Wait(std::string* result) override {
+    if (success_)
+      *result = std::move(result_);
+    return success_;
+  }
+
+  base::TimeTicks GetEndTime() const override { return end_time_; }
+
+ private:
+  bool success_;
+  std::string result_;
+  const base::TimeTicks end_time_ = base::TimeTicks::Now();
+};
+
+}  // namespace
+
+std::unique_ptr<HelperInvoker::PendingResult> HelperInvoker::Start(
+    const ProbeFunction* probe_function,
+    const std::string& probe_statement_str) const {
+  std::string result;
+  bool success = Invoke(probe_function, probe_statement_str, &result);
+  return std::make_unique<CompletedResult>(success, std::move(result));
+}
+
+}  // namespace runtime_probe
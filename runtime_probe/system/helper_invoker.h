@@ -5,14 +5,33 @@
 #ifndef RUNTIME_PROBE_SYSTEM_HELPER_INVOKER_H_
 #define RUNTIME_PROBE_SYSTEM_HELPER_INVOKER_H_
 
+#include <memory>
 #include <string>
 
+#include <base/time/time.h>
+
 namespace runtime_probe {
 
 class ProbeFunction;
 
 class HelperInvoker {
  public:
+  // A helper instance started by |Start()|.
+  class PendingResult {
+   public:
+    virtual ~PendingResult() = default;
+
+    // Waits for the helper process to end. If it successes, the method stores
+    // the probed result in |result| and returns |true|; otherwise, the method
+    // returns |false|.
+    virtual bool Wait(std::string* result) = 0;
+
+    // Returns when the helper process ended, as noticed while this or another
+    // helper was waited for, so it may be before |Wait()| was called.  Must be
+    // called after |Wait()|.
+    virtual base::TimeTicks GetEndTime() const = 0;
+  };
+
   HelperInvoker() = default;
   HelperInvoker(const HelperInvoker&) = delete;
   HelperInvoker& operator=(const HelperInvoker&) = delete;
@@ -27,6 +46,14 @@ class HelperInvoker {
   virtual bool Invoke(const ProbeFunction* probe_function,
                       const std::string& probe_statement_str,
                       std::string* result) const = 0;
+
+  // Same as |Invoke()|, but returns without waiting for the helper process to
+  // end so that several helper processes can run concurrently.  Returns
+  // nullptr if the helper cannot be started.  The default implementation
+  // calls |Invoke()| and returns once the helper process ended.
+  virtual std::unique_ptr<PendingResult> Start(
+      const ProbeFunction* probe_function,
+      const std::string& probe_statement_str) const;
 };
 
 }  // namespace runtime_probe
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include <base/check.h>
+#include <base/files/scoped_file.h>
 #include <base/logging.h>
 #include <brillo/errors/error.h>
 #include <debugd/dbus-proxies.h>
@@ -19,9 +20,56 @@
 
 namespace runtime_probe {
 
+namespace {
+
+// A helper process started by `debugd`, which only passes the pipes of its
+// output back.
+class DebugdPendingResult : public HelperInvoker::PendingResult {
+ public:
+  DebugdPendingResult(base::ScopedFD result_fd, base::ScopedFD error_fd)
+      : result_fd_(std::move(result_fd)),
+        error_fd_(std::move(error_fd)),
+        reader_({result_fd_.get(), error_fd_.get()}) {}
+
+  bool Wait(std::string* result) override {
+    std::vector<std::string> out;
+    bool res = reader_.Wait(&out);
+    if (out[1].size()) {
+      LOG(INFO)
+          << "Helper stderr:\n"
+          << "^--------------------------------------------------------^\n"
+          << out[1]
+          << "$--------------------------------------------------------$";
+    }
+    if (!res) {
+      LOG(ERROR) << "Cannot read result from helper";
+      return false;
+    }
+    *result = std::move(out[0]);
+    return true;
+  }
+
+  base::TimeTicks GetEndTime() const override { return reader_.end_time(); }
+
+ private:
+  base::ScopedFD result_fd_;
+  base::ScopedFD error_fd_;
+  // Declared after the pipes so that it's destroyed before they are closed.
+  PipeReader reader_;
+};
+
+}  // namespace
+
 bool HelperInvokerDebugdImpl::Invoke(const ProbeFunction* probe_function,
                                      const std::string& probe_statement_str,
                                      std::string* result) const {
+  auto pending_result = Start(probe_function, probe_statement_str);
+  return pending_result && pending_result->Wait(result);
+}
+
+std::unique_ptr<HelperInvoker::PendingResult> HelperInvokerDebugdImpl::Start(
+    const ProbeFunction* probe_function,
+    const std::string& probe_statement_str) const {
   base::ScopedFD result_fd{};
   base::ScopedFD error_fd{};
   brillo::ErrorPtr error;
@@ -29,24 +77,11 @@ bool HelperInvokerDebugdImpl::Invoke(const ProbeFunction* probe_function,
           probe_statement_str, &result_fd, &error_fd, &error)) {
     LOG(ERROR) << "Debugd::EvaluateProbeFunction failed: "
                << error->GetMessage();
-    return false;
+    return nullptr;
   }
 
-  std::vector<std::string> out;
-  bool res =
-      ReadNonblockingPipeToString({result_fd.get(), error_fd.get()}, &out);
-  if (out[1].size()) {
-    LOG(INFO) << "Helper stderr:\n"
-              << "^--------------------------------------------------------^\n"
-              << out[1]
-              << "$--------------------------------------------------------$";
-  }
-  if (!res) {
-    LOG(ERROR) << "Cannot read result from helper";
-    return false;
-  }
-  *result = std::move(out[0]);
-  return true;
+  return std::make_unique<DebugdPendingResult>(std::move(result_fd),
+                                               std::move(error_fd));
 }
 
 }  // namespace runtime_probe
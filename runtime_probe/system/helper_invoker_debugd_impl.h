@@ -8,6 +8,7 @@
 #include "runtime_probe/system/context.h"
 #include "runtime_probe/system/helper_invoker.h"
 
+#include <memory>
 #include <string>
 
 namespace runtime_probe {
@@ -20,6 +21,12 @@ class HelperInvokerDebugdImpl : public HelperInvoker {
   bool Invoke(const ProbeFunction* probe_function,
               const std::string& probe_statement_str,
               std::string* result) const override;
+
+  // `debugd` returns as soon as the helper is started, so helpers started
+  // through it run concurrently.
+  std::unique_ptr<PendingResult> Start(
+      const ProbeFunction* probe_function,
+      const std::string& probe_statement_str) const override;
 };
 
 }  // namespace runtime_probe
@@ -4,6 +4,7 @@
 
 #include "runtime_probe/system/helper_invoker_direct_impl.h"
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -20,35 +21,66 @@ static_assert(USE_FACTORY_RUNTIME_PROBE,
               "The compiler should never reach " __FILE__
               " while building a regular runtime_probe.");
 
+namespace {
+
+// A helper subprocess, which is terminated when this is destroyed.
+class DirectPendingResult : public HelperInvoker::PendingResult {
+ public:
+  explicit DirectPendingResult(std::unique_ptr<brillo::ProcessImpl> helper_proc)
+      : helper_proc_(std::move(helper_proc)),
+        reader_({helper_proc_->GetPipe(STDOUT_FILENO),
+                 helper_proc_->GetPipe(STDERR_FILENO)}) {}
+
+  bool Wait(std::string* result) override {
+    std::vector<std::string> out;
+    bool res = reader_.Wait(&out);
+    if (out[1].size()) {
+      LOG(INFO)
+          << "Helper stderr:\n"
+          << "^--------------------------------------------------------^\n"
+          << out[1]
+          << "$--------------------------------------------------------$";
+    }
+    *result = std::move(out[0]);
+    return res;
+  }
+
+  base::TimeTicks GetEndTime() const override { return reader_.end_time(); }
+
+ private:
+  std::unique_ptr<brillo::ProcessImpl> helper_proc_;
+  // Declared after the process so that it's destroyed before the pipes are
+  // closed.
+  PipeReader reader_;
+};
+
+}  // namespace
+
 bool HelperInvokerDirectImpl::Invoke(const ProbeFunction* probe_function,
                                      const std::string& probe_statement_str,
                                      std::string* result) const {
-  brillo::ProcessImpl helper_proc;
-  helper_proc.AddArg(
+  auto pending_result = Start(probe_function, probe_statement_str);
+  return pending_result && pending_result->Wait(result);
+}
+
+std::unique_ptr<HelperInvoker::PendingResult> HelperInvokerDirectImpl::Start(
+    const ProbeFunction* probe_function,
+    const std::string& probe_statement_str) const {
+  auto helper_proc = std::make_unique<brillo::ProcessImpl>();
+  helper_proc->AddArg(
       base::CommandLine::ForCurrentProcess()->GetProgram().value());
-  helper_proc.AddArg("--helper");
-  helper_proc.AddArg(probe_statement_str);
-  helper_proc.RedirectInput("/dev/null");
-  helper_proc.RedirectUsingPipe(STDOUT_FILENO, false);
-  helper_proc.RedirectUsingPipe(STDERR_FILENO, false);
+  helper_proc->AddArg("--helper");
+  helper_proc->AddArg(probe_statement_str);
+  helper_proc->RedirectInput("/dev/null");
+  helper_proc->RedirectUsingPipe(STDOUT_FILENO, false);
+  helper_proc->RedirectUsingPipe(STDERR_FILENO, false);
 
-  if (!helper_proc.Start()) {
+  if (!helper_proc->Start()) {
     LOG(ERROR) << "Failed to start the helper process.";
-    return false;
+    return nullptr;
   }
 
-  std::vector<std::stirng> out;
-  bool res = ReadNonblockingPipeToString(
-      {helper_proc.GetPipe(STDOUT_FILENO), helper_proc.GetPipe(STDERR_FILENO)},
-      &out);
-  if (out[1].size()) {
-    LOG(INFO) << "Helper stderr:\n"
-              << "^--------------------------------------------------------^\n"
-              << out[1]
-              << "$--------------------------------------------------------$";
-  }
-  *result = std::move(out[0]);
-  return res;
+  return std::make_unique<DirectPendingResult>(std::move(helper_proc));
 }
 
 }  // namespace runtime_probe
@@ -7,6 +7,7 @@
 
 #include "runtime_probe/system/helper_invoker.h"
 
+#include <memory>
 #include <string>
 
 namespace runtime_probe {
@@ -26,6 +27,10 @@ class HelperInvokerDirectImpl : public HelperInvoker {
   bool Invoke(const ProbeFunction* probe_function,
               const std::string& probe_statement_str,
               std::string* result) const override;
+
+  std::unique_ptr<PendingResult> Start(
+      const ProbeFunction* probe_function,
+      const std::string& probe_statement_str) const override;
 };
 
 }  // namespace runtime_probe
@@ -9,9 +9,12 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <set>
 #include <string>
+#include <utility>
 
 #include <base/logging.h>
+#include <base/no_destructor.h>
 #include <base/posix/eintr_wrapper.h>
 
 namespace runtime_probe {
@@ -46,6 +49,12 @@ PipeState ReadPipe(int src_fd, std::string* dst_str) {
   return PipeState::PENDING;
 }
 
+// The |PipeReader| which are not done, read together by any of them waiting.
+std::set<PipeReader*>& GetPendingReaders() {
+  static base::NoDestructor<std::set<PipeReader*>> readers;
+  return *readers;
+}
+
 }  // namespace
 
 bool ReadNonblockingPipeToString(const std::vector<int>& fds,
@@ -101,4 +110,84 @@ bool ReadNonblockingPipeToString(const std::vector<int>& fds,
   }
 }
 
+PipeReader::PipeReader(std::vector<int> fds)
+    : fds_(std::move(fds)),
+      out_(fds_.size()),
+      fd_done_(fds_.size(), false) {
+  if (fds_.empty()) {
+    Finish(true);
+    return;
+  }
+  GetPendingReaders().insert(this);
+}
+
+PipeReader::~PipeReader() {
+  GetPendingReaders().erase(this);
+}
+
+bool PipeReader::Wait(std::vector<std::string>* out) {
+  while (!done_)
+    ReadPendingReaders();
+  *out = std::move(out_);
+  return success_;
+}
+
+// static
+void PipeReader::ReadPendingReaders() {
+  // Copied, as the readers which finish are removed from the set.
+  const std::vector<PipeReader*> readers(GetPendingReaders().begin(),
+                                         GetPendingReaders().end());
+  fd_set read_fds;
+  int nfds = 0;
+  FD_ZERO(&read_fds);
+  for (const PipeReader* reader : readers) {
+    for (int i = 0; i < reader->fds_.size(); ++i) {
+      if (!reader->fd_done_[i]) {
+        FD_SET(reader->fds_[i], &read_fds);
+        nfds = std::max(nfds, reader->fds_[i] + 1);
+      }
+    }
+  }
+
+  struct timeval timeout;
+  timeout.tv_sec = kWaitSeconds;
+  timeout.tv_usec = 0;
+  int retval =
+      HANDLE_EINTR(select(nfds, &read_fds, nullptr, nullptr, &timeout));
+  if (retval <= 0) {
+    if (retval < 0)
+      PLOG(ERROR) << "select() failed from runtime_probe_helper";
+    else
+      LOG(WARNING) << "select() timed out. Process might be stale.";
+    for (PipeReader* reader : readers)
+      reader->Finish(false);
+    return;
+  }
+
+  for (PipeReader* reader : readers) {
+    bool done = true;
+    for (int i = 0; i < reader->fds_.size(); ++i) {
+      if (!reader->fd_done_[i] && FD_ISSET(reader->fds_[i], &read_fds)) {
+        PipeState state = ReadPipe(reader->fds_[i], &reader->out_[i]);
+        if (state == PipeState::ERROR) {
+          reader->Finish(false);
+          break;
+        }
+        if (state == PipeState::DONE)
+          reader->fd_done_[i] = true;
+      }
+      done = done && reader->fd_done_[i];
+    }
+    if (done && !reader->done_)
+      reader->Finish(true);
+  }
+}
+
+void PipeReader::Finish(bool success) {
+  done_ = true;
+  success_ = success;
+  end_time_ = base::TimeTicks::Now();
+  GetPendingReaders().erase(this);
+}
+
 }  // namespace runtime_probe
@@ -8,11 +8,47 @@
 #include <string>
 #include <vector>
 
+#include <base/time/time.h>
+
 namespace runtime_probe {
 
 bool ReadNonblockingPipeToString(const std::vector<int>& fds,
                                  std::vector<std::string>* out);
 
+// Reads the pipes |fds| until they are all closed, e.g. when the process
+// writing them ended.  While one |PipeReader| is waited for, the pipes of all
+// the others are read too, so that the time the pipes of each of them were
+// closed is known even if it is waited for later.  This needs no thread, but
+// all the |PipeReader| must be used on the same thread.
+class PipeReader {
+ public:
+  // |fds| must stay open until this is destroyed.
+  explicit PipeReader(std::vector<int> fds);
+  PipeReader(const PipeReader&) = delete;
+  PipeReader& operator=(const PipeReader&) = delete;
+  ~PipeReader();
+
+  // Waits for the pipes to be read and returns the same as
+  // |ReadNonblockingPipeToString()|.  Must only be called once.
+  bool Wait(std::vector<std::string>* out);
+
+  // Returns when the reading ended.  Must be called after |Wait()|.
+  base::TimeTicks end_time() const { return end_time_; }
+
+ private:
+  // Waits for any pipe of the pending readers to be readable and reads it.
+  static void ReadPendingReaders();
+
+  void Finish(bool success);
+
+  const std::vector<int> fds_;
+  std::vector<std::string> out_;
+  std::vector<bool> fd_done_;
+  bool done_ = false;
+  bool success_ = false;
+  base::TimeTicks end_time_;
+};
+
 }  // namespace runtime_probe
 
 #endif  // RUNTIME_PROBE_UTILS_PIPE_UTILS_H_
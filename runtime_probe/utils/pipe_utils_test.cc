@@ -0,0 +1,87 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include <base/bind.h>
+#include <base/check.h>
+#include <base/files/file_util.h>
+#include <base/files/scoped_file.h>
+#include <base/threading/thread.h>
+#include <base/time/time.h>
+#include <gtest/gtest.h>
+
+#include "runtime_probe/utils/pipe_utils.h"
+
+namespace runtime_probe {
+namespace {
+
+// The pipes of a fake helper process, which ends when they are closed.
+struct FakeHelper {
+  FakeHelper() {
+    int fds[2];
+    CHECK(base::CreateLocalNonBlockingPipe(fds));
+    read_fd.reset(fds[0]);
+    write_fd.reset(fds[1]);
+  }
+
+  // Writes |output| and ends the helper.
+  void End(const std::string& output) {
+    CHECK(base::WriteFileDescriptor(write_fd.get(), output));
+    write_fd.reset();
+  }
+
+  base::ScopedFD read_fd;
+  base::ScopedFD write_fd;
+};
+
+TEST(PipeReaderTest, ReadOutput) {
+  FakeHelper helper;
+  PipeReader reader({helper.read_fd.get()});
+  helper.End("output");
+
+  std::vector<std::string> out;
+  EXPECT_TRUE(reader.Wait(&out));
+  EXPECT_EQ(out, std::vector<std::string>{"output"});
+}
+
+TEST(PipeReaderTest, NoPipes) {
+  PipeReader reader({});
+  std::vector<std::string> out;
+  EXPECT_TRUE(reader.Wait(&out));
+  EXPECT_TRUE(out.empty());
+}
+
+// Test that a fast helper waited for after a slow one is timed until it ended,
+// not until it was waited for.
+TEST(PipeReaderTest, EndTimeOfFastHelperWaitedAfterSlowHelper) {
+  constexpr base::TimeDelta kSlowHelperTime = base::Milliseconds(500);
+  FakeHelper fast_helper;
+  FakeHelper slow_helper;
+  base::Thread slow_helper_thread("SlowHelper");
+  ASSERT_TRUE(slow_helper_thread.Start());
+  const base::TimeTicks start = base::TimeTicks::Now();
+  PipeReader fast_reader({fast_helper.read_fd.get()});
+  PipeReader slow_reader({slow_helper.read_fd.get()});
+
+  fast_helper.End("fast");
+  slow_helper_thread.task_runner()->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&FakeHelper::End, base::Unretained(&slow_helper),
+                     std::string("slow")),
+      kSlowHelperTime);
+
+  std::vector<std::string> out;
+  EXPECT_TRUE(slow_reader.Wait(&out));
+  EXPECT_EQ(out, std::vector<std::string>{"slow"});
+  EXPECT_TRUE(fast_reader.Wait(&out));
+  EXPECT_EQ(out, std::vector<std::string>{"fast"});
+
+  EXPECT_GE(slow_reader.end_time() - start, kSlowHelperTime);
+  EXPECT_LT(fast_reader.end_time() - start, kSlowHelperTime);
+}
+
+}  // namespace
+}  // namespace runtime_probe
@@ -0,0 +1,196 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shill/cellular/mobile_operator_database.h"
+
+#include <map>
+#include <utility>
+
+#include <base/check.h>
+#include <base/files/file.h>
+#include <base/files/file_util.h>
+#include <base/logging.h>
+#include <base/no_destructor.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_util.h>
+
+#include "shill/logging.h"
+#include "shill/protobuf_lite_streams.h"
+
+namespace shill {
+
+namespace Logging {
+static auto kModuleLogScope = ScopeLogger::kCellular;
+static std::string ObjectID(const MobileOperatorDatabase* d) {
+  return "(mobile_operator_database)";
+}
+}  // namespace Logging
+
+namespace {
+
+// Databases currently in use keyed by the identity of the files they were
+// loaded from. Entries are removed when the database is destroyed.
+std::map<std::string, const MobileOperatorDatabase*>& LoadedDatabases() {
+  static base::NoDestructor<
+      std::map<std::string, const MobileOperatorDatabase*>>
+      databases;
+  return *databases;
+}
+
+// Returns a key identifying the content of the files at |paths|, based on
+// their path, size and modification time.
+std::string GetCacheKey(const std::vector<base::FilePath>& paths) {
+  std::string key;
+  for (const auto& path : paths) {
+    base::File::Info info;
+    key += path.value();
+    if (base::GetFileInfo(path, &info)) {
+      key += ":" + base::NumberToString(info.size) + ":" +
+             base::NumberToString(info.last_modified.ToDeltaSinceWindowsEpoch()
+                                      .InMicroseconds());
+    }
+    key += ";";
+  }
+  return key;
+}
+
+}  // namespace
+
+// static
+scoped_refptr<const MobileOperatorDatabase> MobileOperatorDatabase::Load(
+    const std::vector<base::FilePath>& paths) {
+  const std::string cache_key = GetCacheKey(paths);
+  const auto it = LoadedDatabases().find(cache_key);
+  if (it != LoadedDatabases().end()) {
+    SLOG(it->second, 1) << "Reusing loaded database";
+    return base::WrapRefCounted(it->second);
+  }
+
+  auto database = std::make_unique<mobile_operator_db::MobileOperatorDB>();
+  bool found_databases = false;
+  for (const auto& path : paths) {
+    const char* path_cstr = path.value().c_str();
+    std::unique_ptr<google::protobuf::io::CopyingInputStreamAdaptor>
+        database_stream;
+    database_stream.reset(protobuf_lite_file_input_stream(path_cstr));
+    if (!database_stream) {
+      LOG(ERROR) << "Failed to read mobile operator database: " << path_cstr;
+      continue;
+    }
+
+    // The first database is parsed in place, the following ones are merged
+    // into it.
+    if (!found_databases) {
+      if (!database->ParseFromZeroCopyStream(database_stream.get())) {
+        LOG(ERROR) << "Could not parse mobile operator database: " << path_cstr;
+        database->Clear();
+        continue;
+      }
+    } else {
+      mobile_operator_db::MobileOperatorDB other;
+      if (!other.ParseFromZeroCopyStream(database_stream.get())) {
+        LOG(ERROR) << "Could not parse mobile operator database: " << path_cstr;
+        continue;
+      }
+      database->MergeFrom(other);
+    }
+    SLOG(nullptr, 1) << "Successfully loaded database: " << path_cstr;
+    found_databases = true;
+  }
+
+  if (!found_databases) {
+    return nullptr;
+  }
+  return base::MakeRefCounted<MobileOperatorDatabase>(std::move(database),
+                                                      cache_key);
+}
+
+MobileOperatorDatabase::MobileOperatorDatabase(
+    std::unique_ptr<mobile_operator_db::MobileOperatorDB> database,
+    const std::string& cache_key)
+    : database_(std::move(database)), cache_key_(cache_key) {
+  DCHECK(database_);
+
+  // Tables are filled in ordered maps first, and then moved at once to the
+  // sorted vectors backing the flat maps.
+  std::map<std::string, MNOList> mccmnc_to_mnos;
+  std::map<std::string, MNOList> sid_to_mnos;
+  std::map<std::string, MNOList> name_to_mnos;
+  for (const auto& mno : database_->mno()) {
+    // MobileNetworkOperator::data is a required field.
+    DCHECK(mno.has_data());
+    const auto& data = mno.data();
+
+    // These tables assume that duplicate MNOs are never inserted for the same
+    // key.
+    for (const auto& mccmnc : data.mccmnc()) {
+      mccmnc_to_mnos[mccmnc].push_back(&mno);
+    }
+    for (const auto& sid : data.sid()) {
+      sid_to_mnos[sid].push_back(&mno);
+    }
+    for (const auto& localized_name : data.localized_name()) {
+      // LocalizedName::name is a required field.
+      DCHECK(localized_name.has_name());
+      name_to_mnos[NormalizeOperatorName(localized_name.name())].push_back(
+          &mno);
+    }
+  }
+  mccmnc_to_mnos_ = StringToMNOListMap(
+      std::make_move_iterator(mccmnc_to_mnos.begin()),
+      std::make_move_iterator(mccmnc_to_mnos.end()));
+  sid_to_mnos_ =
+      StringToMNOListMap(std::make_move_iterator(sid_to_mnos.begin()),
+                         std::make_move_iterator(sid_to_mnos.end()));
+  name_to_mnos_ =
+      StringToMNOListMap(std::make_move_iterator(name_to_mnos.begin()),
+                         std::make_move_iterator(name_to_mnos.end()));
+
+  if (!cache_key_.empty()) {
+    LoadedDatabases()[cache_key_] = this;
+  }
+}
+
+MobileOperatorDatabase::~MobileOperatorDatabase() {
+  if (!cache_key_.empty()) {
+    LoadedDatabases().erase(cache_key_);
+  }
+}
+
+// static
+std::string MobileOperatorDatabase::NormalizeOperatorName(
+    const std::string& name) {
+  auto result = base::ToLowerASCII(name);
+  base::RemoveChars(result, base::kWhitespaceASCII, &result);
+  return result;
+}
+
+const MobileOperatorDatabase::MNOList* MobileOperatorDatabase::FindByMCCMNC(
+    const std::string& mccmnc) const {
+  return Find(mccmnc_to_mnos_, mccmnc);
+}
+
+const MobileOperatorDatabase::MNOList* MobileOperatorDatabase::FindBySID(
+    const std::string& sid) const {
+  return Find(sid_to_mnos_, sid);
+}
+
+const MobileOperatorDatabase::MNOList* MobileOperatorDatabase::FindByName(
+    const std::string& name) const {
+  return Find(name_to_mnos_, name);
+}
+
+// static
+const MobileOperatorDatabase::MNOList* MobileOperatorDatabase::Find(
+    const StringToMNOListMap& table, const std::string& key) {
+  const auto it = table.find(key);
+  if (it == table.end()) {
+    return nullptr;
+  }
+  // An empty list is never inserted into the tables.
+  DCHECK(!it->second.empty());
+  return &it->second;
+}
+
+}  // namespace shill
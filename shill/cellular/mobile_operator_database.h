@@ -0,0 +1,79 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHILL_CELLULAR_MOBILE_OPERATOR_DATABASE_H_
+#define SHILL_CELLULAR_MOBILE_OPERATOR_DATABASE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/containers/flat_map.h>
+#include <base/files/file_path.h>
+#include <base/memory/ref_counted.h>
+
+#include "shill/mobile_operator_db/mobile_operator_db.pb.h"
+
+namespace shill {
+
+// MobileOperatorDatabase holds a parsed mobile operator database along with
+// sorted lookup tables of its MNOs keyed by MCCMNC, SID and normalized
+// operator name.
+//
+// Parsing and indexing the database is costly, both in time and memory. A
+// database is therefore immutable once loaded and shared by every user
+// loading the same database files (e.g. the home and serving
+// MobileOperatorInfo of a Cellular device) for as long as one of them holds a
+// reference to it.
+class MobileOperatorDatabase : public base::RefCounted<MobileOperatorDatabase> {
+ public:
+  using MNOList = std::vector<const mobile_operator_db::MobileNetworkOperator*>;
+
+  // Returns the database built by merging the databases at |paths|. A
+  // database still in use that was loaded from the same, unmodified, files is
+  // returned as is. Returns nullptr if none of |paths| could be loaded.
+  static scoped_refptr<const MobileOperatorDatabase> Load(
+      const std::vector<base::FilePath>& paths);
+
+  // Builds the lookup tables of |database|. |cache_key| identifies the files
+  // |database| was loaded from and is empty if it is not shared.
+  explicit MobileOperatorDatabase(
+      std::unique_ptr<mobile_operator_db::MobileOperatorDB> database,
+      const std::string& cache_key = "");
+  MobileOperatorDatabase(const MobileOperatorDatabase&) = delete;
+  MobileOperatorDatabase& operator=(const MobileOperatorDatabase&) = delete;
+
+  // Operator names are compared after removing whitespaces and case.
+  static std::string NormalizeOperatorName(const std::string& name);
+
+  const mobile_operator_db::MobileOperatorDB& database() const {
+    return *database_;
+  }
+
+  // Returns the MNOs matching |mccmnc|, |sid| or the normalized operator name
+  // |name|. Returns nullptr if there is no match.
+  const MNOList* FindByMCCMNC(const std::string& mccmnc) const;
+  const MNOList* FindBySID(const std::string& sid) const;
+  const MNOList* FindByName(const std::string& name) const;
+
+ private:
+  friend class base::RefCounted<MobileOperatorDatabase>;
+  using StringToMNOListMap = base::flat_map<std::string, MNOList>;
+
+  ~MobileOperatorDatabase();
+
+  static const MNOList* Find(const StringToMNOListMap& table,
+                             const std::string& key);
+
+  const std::unique_ptr<mobile_operator_db::MobileOperatorDB> database_;
+  const std::string cache_key_;
+
+  StringToMNOListMap mccmnc_to_mnos_;
+  StringToMNOListMap sid_to_mnos_;
+  StringToMNOListMap name_to_mnos_;
+};
+
+}  // namespace shill
+
+#endif  // SHILL_CELLULAR_MOBILE_OPERATOR_DATABASE_H_
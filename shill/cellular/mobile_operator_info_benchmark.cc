@@ -0,0 +1,88 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <base/check.h>
+#include <base/files/file_path.h>
+#include <base/files/file_util.h>
+#include <base/strings/string_number_conversions.h>
+#include <base/strings/string_split.h>
+#include <benchmark/benchmark.h>
+
+#include "shill/cellular/mobile_operator_info.h"
+#include "shill/test_event_dispatcher.h"
+
+namespace shill {
+namespace {
+
+base::FilePath GetDatabasePath() {
+  const char* out_dir = getenv("OUT");
+  CHECK(out_dir);
+  return base::FilePath(out_dir).Append("serviceproviders.pbf");
+}
+
+// Returns the resident set size of the current process in kB.
+int64_t GetRssKb() {
+  std::string statm;
+  CHECK(base::ReadFileToString(base::FilePath("/proc/self/statm"), &statm));
+  const std::vector<std::string> fields = base::SplitString(
+      statm, " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  int64_t resident_pages;
+  CHECK(fields.size() > 1 && base::StringToInt64(fields[1], &resident_pages));
+  return resident_pages * sysconf(_SC_PAGESIZE) / 1024;
+}
+
+}  // namespace
+
+// Measures the initialization of the home and serving operator infos of a
+// Cellular device, which both load the default database.
+static void BM_MobileOperatorInfoInit(benchmark::State& state) {
+  EventDispatcherForTest dispatcher;
+  const base::FilePath database_path = GetDatabasePath();
+  int64_t rss_delta_kb = 0;
+  for (auto _ : state) {
+    const int64_t rss_before_kb = GetRssKb();
+    auto home = std::make_unique<MobileOperatorInfo>(&dispatcher, "home");
+    auto serving = std::make_unique<MobileOperatorInfo>(&dispatcher, "serving");
+    for (auto* operator_info : {home.get(), serving.get()}) {
+      operator_info->ClearDatabasePaths();
+      operator_info->AddDatabasePath(database_path);
+      CHECK(operator_info->Init());
+    }
+    rss_delta_kb = GetRssKb() - rss_before_kb;
+
+    state.PauseTiming();
+    home.reset();
+    serving.reset();
+    state.ResumeTiming();
+  }
+  state.counters["rss_delta_kb"] = rss_delta_kb;
+}
+BENCHMARK(BM_MobileOperatorInfoInit)->Unit(benchmark::kMillisecond);
+
+// Measures the lookup of an MNO by MCCMNC and name on an initialized
+// database.
+static void BM_MobileOperatorInfoLookup(benchmark::State& state) {
+  EventDispatcherForTest dispatcher;
+  MobileOperatorInfo operator_info(&dispatcher, "home");
+  operator_info.ClearDatabasePaths();
+  operator_info.AddDatabasePath(GetDatabasePath());
+  CHECK(operator_info.Init());
+  for (auto _ : state) {
+    operator_info.UpdateMCCMNC("310260");
+    operator_info.UpdateOperatorName("T-Mobile");
+    benchmark::DoNotOptimize(operator_info.IsMobileNetworkOperatorKnown());
+    operator_info.Reset();
+  }
+}
+BENCHMARK(BM_MobileOperatorInfoLookup)->Unit(benchmark::kMicrosecond);
+
+}  // namespace shill
+
+BENCHMARK_MAIN();
@@ -22,7 +22,6 @@
 
 #include "shill/ipconfig.h"
 #include "shill/logging.h"
-#include "shill/protobuf_lite_streams.h"
 
 namespace shill {
 
@@ -129,42 +128,14 @@ void MobileOperatorInfoImpl::AddDatabasePath(
 
 bool MobileOperatorInfoImpl::Init() {
   // |database_| is guaranteed to be set once |Init| is called.
-  database_.reset(new shill::mobile_operator_db::MobileOperatorDB());
-
-  bool found_databases = false;
-  for (const auto& database_path : database_paths_) {
-    const char* database_path_cstr = database_path.value().c_str();
-    std::unique_ptr<google::protobuf::io::CopyingInputStreamAdaptor>
-        database_stream;
-    database_stream.reset(protobuf_lite_file_input_stream(database_path_cstr));
-    if (!database_stream) {
-      LOG(ERROR) << "Failed to read mobile operator database: "
-                 << database_path_cstr;
-      continue;
-    }
-
-    shill::mobile_operator_db::MobileOperatorDB database;
-    if (!database.ParseFromZeroCopyStream(database_stream.get())) {
-      LOG(ERROR) << "Could not parse mobile operator database: "
-                 << database_path_cstr;
-      continue;
-    }
-    SLOG(this, 1) << "Successfully loaded database: " << database_path_cstr;
-    // Collate loaded databases into one as they're found.
-    // TODO(pprabhu) This merge might be very costly. Determine if we need to
-    // implement move semantics / bias the merge to use the largest database
-    // as the base database and merge other databases into it.
-    database_->MergeFrom(database);
-    found_databases = true;
-  }
-
-  if (!found_databases) {
+  database_ = MobileOperatorDatabase::Load(database_paths_);
+  if (!database_) {
     LOG(ERROR) << "Could not read any mobile operator database. "
                << "Will not be able to determine MVNO.";
+    database_ = base::MakeRefCounted<MobileOperatorDatabase>(
+        std::make_unique<mobile_operator_db::MobileOperatorDB>());
     return false;
   }
-
-  PreprocessDatabase();
   return true;
 }
 
@@ -370,13 +341,11 @@ void MobileOperatorInfoImpl::UpdateOperatorName(
   HandleOperatorNameUpdate();
 
   // We must update the candidates by name anyway.
-  StringToMNOListMap::const_iterator cit =
-      name_to_mnos_.find(NormalizeOperatorName(operator_name));
+  const MobileOperatorDatabase::MNOList* mnos =
+      database_->FindByName(NormalizeOperatorName(operator_name));
   candidates_by_name_.clear();
-  if (cit != name_to_mnos_.end()) {
-    candidates_by_name_ = cit->second;
-    // We should never have inserted an empty vector into the map.
-    DCHECK(!candidates_by_name_.empty());
+  if (mnos) {
+    candidates_by_name_ = *mnos;
   } else {
     LOG(INFO) << "Operator name [" << operator_name << "] "
               << "(Normalized: [" << NormalizeOperatorName(operator_name)
@@ -439,49 +408,6 @@ void MobileOperatorInfoImpl::Reset() {
   }
 }
 
-void MobileOperatorInfoImpl::PreprocessDatabase() {
-  SLOG(this, 3) << __func__;
-
-  mccmnc_to_mnos_.clear();
-  sid_to_mnos_.clear();
-  name_to_mnos_.clear();
-
-  const auto& mnos = database_->mno();
-  for (const auto& mno : mnos) {
-    // MobileNetworkOperator::data is a required field.
-    DCHECK(mno.has_data());
-    const auto& data = mno.data();
-
-    const auto& mccmncs = data.mccmnc();
-    for (const auto& mccmnc : mccmncs) {
-      InsertIntoStringToMNOListMap(&mccmnc_to_mnos_, mccmnc, &mno);
-    }
-
-    const auto& sids = data.sid();
-    for (const auto& sid : sids) {
-      InsertIntoStringToMNOListMap(&sid_to_mnos_, sid, &mno);
-    }
-
-    const auto& localized_names = data.localized_name();
-    for (const auto& localized_name : localized_names) {
-      // LocalizedName::name is a required field.
-      DCHECK(localized_name.has_name());
-      InsertIntoStringToMNOListMap(
-          &name_to_mnos_, NormalizeOperatorName(localized_name.name()), &mno);
-    }
-  }
-}
-
-// This function assumes that duplicate |values| are never inserted for the
-// same |key|. If you do that, the function is too dumb to deduplicate the
-// |value|s, and two copies will get stored.
-void MobileOperatorInfoImpl::InsertIntoStringToMNOListMap(
-    StringToMNOListMap* table,
-    const std::string& key,
-    const shill::mobile_operator_db::MobileNetworkOperator* value) {
-  (*table)[key].push_back(value);
-}
-
 bool MobileOperatorInfoImpl::AppendToCandidatesByMCCMNC(
     const std::string& mccmnc) {
   // First check that we haven't determined candidates using SID.
@@ -492,15 +418,14 @@ bool MobileOperatorInfoImpl::AppendToCandidatesByMCCMNC(
   }
 
   operator_code_type_ = OperatorCodeType::kMCCMNC;
-  StringToMNOListMap::const_iterator cit = mccmnc_to_mnos_.find(mccmnc);
-  if (cit == mccmnc_to_mnos_.end()) {
+  const MobileOperatorDatabase::MNOList* mnos =
+      database_->FindByMCCMNC(mccmnc);
+  if (!mnos) {
     LOG(WARNING) << "Unknown MCCMNC value [" << mccmnc << "].";
     return false;
   }
 
-  // We should never have inserted an empty vector into the map.
-  DCHECK(!cit->second.empty());
-  for (const auto& mno : cit->second) {
+  for (const auto& mno : *mnos) {
     candidates_by_operator_code_.push_back(mno);
   }
   return true;
@@ -515,15 +440,13 @@ bool MobileOperatorInfoImpl::AppendToCandidatesBySID(const std::string& sid) {
   }
 
   operator_code_type_ = OperatorCodeType::kSID;
-  StringToMNOListMap::const_iterator cit = sid_to_mnos_.find(sid);
-  if (cit == sid_to_mnos_.end()) {
+  const MobileOperatorDatabase::MNOList* mnos = database_->FindBySID(sid);
+  if (!mnos) {
     LOG(WARNING) << "Unknown SID value [" << sid << "].";
     return false;
   }
 
-  // We should never have inserted an empty vector into the map.
-  DCHECK(!cit->second.empty());
-  for (const auto& mno : cit->second) {
+  for (const auto& mno : *mnos) {
     candidates_by_operator_code_.push_back(mno);
   }
   return true;
@@ -629,7 +552,7 @@ bool MobileOperatorInfoImpl::UpdateMVNO() {
 
   std::vector<const shill::mobile_operator_db::MobileVirtualNetworkOperator*>
       candidate_mvnos;
-  for (const auto& mvno : database_->mvno()) {
+  for (const auto& mvno : database_->database().mvno()) {
     candidate_mvnos.push_back(&mvno);
   }
   if (current_mno_) {
@@ -1066,9 +989,7 @@ bool MobileOperatorInfoImpl::ShouldNotifyPropertyUpdate() const {
 
 std::string MobileOperatorInfoImpl::NormalizeOperatorName(
     const std::string& name) const {
-  auto result = base::ToLowerASCII(name);
-  base::RemoveChars(result, base::kWhitespaceASCII, &result);
-  return result;
+  return MobileOperatorDatabase::NormalizeOperatorName(name);
 }
 
 }  // namespace shill
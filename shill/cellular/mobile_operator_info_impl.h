@@ -13,9 +13,11 @@
 #include <base/cancelable_callback.h>
 #include <base/files/file_util.h>
 #include <base/memory/weak_ptr.h>
+#include <base/memory/scoped_refptr.h>
 #include <base/observer_list.h>
 #include <google/protobuf/text_format.h>
 
+#include "shill/cellular/mobile_operator_database.h"
 #include "shill/cellular/mobile_operator_info.h"
 #include "shill/event_dispatcher.h"
 #include "shill/mobile_operator_db/mobile_operator_db.pb.h"
@@ -24,10 +26,6 @@ namespace shill {
 
 class MobileOperatorInfoImpl {
  public:
-  using StringToMNOListMap =
-      std::map<std::string,
-               std::vector<const mobile_operator_db::MobileNetworkOperator*>>;
-
   // Delegates to private constructor
   MobileOperatorInfoImpl(EventDispatcher* dispatcher,
                          const std::string& info_owner);
@@ -94,15 +92,6 @@ class MobileOperatorInfoImpl {
 
   // ///////////////////////////////////////////////////////////////////////////
   // Functions.
-  void PreprocessDatabase();
-  // This function assumes that duplicate |values| are never inserted for the
-  // same |key|. If you do that, the function is too dumb to deduplicate the
-  // |value|s, and two copies will get stored.
-  void InsertIntoStringToMNOListMap(
-      StringToMNOListMap* table,
-      const std::string& key,
-      const mobile_operator_db::MobileNetworkOperator* value);
-
   bool UpdateMNO();
   bool UpdateMVNO();
   bool FilterMatches(const shill::mobile_operator_db::Filter& filter);
@@ -147,7 +136,9 @@ class MobileOperatorInfoImpl {
   void HandleOnlinePortalUpdate();
 
   // Accessor functions for testing purpose only.
-  mobile_operator_db::MobileOperatorDB* database() { return database_.get(); }
+  const mobile_operator_db::MobileOperatorDB* database() const {
+    return &database_->database();
+  }
 
   // ///////////////////////////////////////////////////////////////////////////
   // Data.
@@ -166,10 +157,9 @@ class MobileOperatorInfoImpl {
   base::ObserverList<MobileOperatorInfo::Observer> observers_;
   base::CancelableClosure notify_operator_changed_task_;
 
-  std::unique_ptr<mobile_operator_db::MobileOperatorDB> database_;
-  StringToMNOListMap mccmnc_to_mnos_;
-  StringToMNOListMap sid_to_mnos_;
-  StringToMNOListMap name_to_mnos_;
+  // Shared with the other MobileOperatorInfoImpl instances using the same
+  // database files.
+  scoped_refptr<const MobileOperatorDatabase> database_;
 
   // |candidates_by_operator_code| can be determined either using MCCMNC or
   // using SID.  At any one time, we only expect one of these operator codes to
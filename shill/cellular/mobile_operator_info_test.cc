@@ -93,6 +93,11 @@ class MobileOperatorInfoInitTest : public Test {
     return operator_info_impl_->database();
   }
 
+  const shill::mobile_operator_db::MobileOperatorDB* GetDatabase(
+      MobileOperatorInfo* operator_info) {
+    return operator_info->impl()->database();
+  }
+
   EventDispatcherForTest dispatcher_;
   std::unique_ptr<MobileOperatorInfo> operator_info_;
   // Owned by |operator_info_| and tied to its life cycle.
@@ -143,6 +148,26 @@ TEST_F(MobileOperatorInfoInitTest, MultipleDBInit) {
   EXPECT_GT(GetDatabase()->mvno_size(), 0);
 }
 
+TEST_F(MobileOperatorInfoInitTest, SharedDatabase) {
+  // - Initialize two objects with the same database file.
+  // - Verify that the database is loaded once and shared.
+  EXPECT_TRUE(SetUpDatabase({"init_test_successful_init.pbf"}));
+  MobileOperatorInfo other_operator_info(&dispatcher_, "OtherOperator");
+  other_operator_info.ClearDatabasePaths();
+  other_operator_info.AddDatabasePath(
+      GetTestProtoPath("init_test_successful_init.pbf"));
+  EXPECT_TRUE(other_operator_info.Init());
+  EXPECT_EQ(GetDatabase(), GetDatabase(&other_operator_info));
+
+  // - Initialize the second object with different database files.
+  // - Verify that the databases are not shared anymore.
+  other_operator_info.ClearDatabasePaths();
+  other_operator_info.AddDatabasePath(
+      GetTestProtoPath("init_test_multiple_db_init_1.pbf"));
+  EXPECT_TRUE(other_operator_info.Init());
+  EXPECT_NE(GetDatabase(), GetDatabase(&other_operator_info));
+}
+
 TEST_F(MobileOperatorInfoInitTest, InitWithObserver) {
   // - Add an Observer.
   // - Initialize the object with empty database file.
@@ -113,6 +113,7 @@ bool Connection::SetupIncludedRoutes(const IPConfig::Properties& properties,
   bool ret = true;
 
   IPAddress::Family address_family = properties.address_family;
+  std::vector<RoutingTableEntry> entries;
   for (const auto& route : properties.routes) {
     SLOG(this, 2) << "Installing route:"
                   << " Destination: " << route.host
@@ -135,14 +136,14 @@ bool Connection::SetupIncludedRoutes(const IPConfig::Properties& properties,
       gateway_address.SetAddressToDefault();
     }
     destination_address.set_prefix(route.prefix);
-    if (!routing_table_->AddRoute(
-            interface_index_,
-            RoutingTableEntry::Create(destination_address, source_address,
-                                      gateway_address)
-                .SetMetric(priority_)
-                .SetTable(table_id_))) {
-      ret = false;
-    }
+    entries.push_back(RoutingTableEntry::Create(destination_address,
+                                                source_address, gateway_address)
+                          .SetMetric(priority_)
+                          .SetTable(table_id_));
+  }
+  // VPNs can push thousands of routes, they are all sent to the kernel at once.
+  if (!routing_table_->AddRoutes(interface_index_, entries)) {
+    ret = false;
   }
   return ret;
 }
@@ -158,15 +159,22 @@ bool Connection::SetupExcludedRoutes(const IPConfig::Properties& properties,
                    .SetScope(RT_SCOPE_LINK)
                    .SetTable(table_id_)
                    .SetType(RTN_THROW);
+  std::vector<RoutingTableEntry> entries;
+  bool ret = true;
   for (const auto& excluded_ip : properties.exclusion_list) {
     if (!entry.dst.SetAddressAndPrefixFromString(excluded_ip) ||
-        !entry.dst.IsValid() ||
-        !routing_table_->AddRoute(interface_index_, entry)) {
+        !entry.dst.IsValid()) {
       LOG(ERROR) << "Unable to setup route for " << excluded_ip << ".";
-      return false;
+      ret = false;
+      break;
     }
+    entries.push_back(entry);
   }
-  return true;
+  if (!routing_table_->AddRoutes(interface_index_, entries)) {
+    LOG(ERROR) << "Unable to setup excluded routes.";
+    ret = false;
+  }
+  return ret;
 }
 
 void Connection::UpdateFromIPConfig(const IPConfig::Properties& properties) {
@@ -307,6 +315,7 @@ void Connection::UpdateGatewayMetric(const IPConfig::Properties& properties) {
 
 void Connection::UpdateRoutingPolicy() {
   routing_table_->FlushRules(interface_index_);
+  std::vector<RoutingPolicyEntry> rules;
 
   // b/180521518: IPv6 routing rules are always omitted for a Cellular
   // connection that is not the primary physical connection. This prevents
@@ -323,15 +332,16 @@ void Connection::UpdateRoutingPolicy() {
                        .SetPriority(priority_)
                        .SetTable(blackhole_table_id_)
                        .SetUidRange({uid, uid});
-      routing_table_->AddRule(interface_index_, entry);
+      rules.push_back(entry);
       if (no_ipv6) {
         continue;
       }
-      routing_table_->AddRule(interface_index_, entry.FlipFamily());
+      rules.push_back(entry.FlipFamily());
     }
   }
 
-  AllowTrafficThrough(table_id_, priority_ + blackhole_offset, no_ipv6);
+  AllowTrafficThrough(table_id_, priority_ + blackhole_offset, no_ipv6,
+                      &rules);
 
   // b/177620923 Add uid rules just before the default rule to route to the VPN
   // interface any untagged traffic owner by a uid routed through VPN
@@ -344,8 +354,8 @@ void Connection::UpdateRoutingPolicy() {
                        .SetPriority(kVpnUidRulePriority)
                        .SetTable(table_id_)
                        .SetUid(uid);
-      routing_table_->AddRule(interface_index_, entry);
-      routing_table_->AddRule(interface_index_, entry.FlipFamily());
+      rules.push_back(entry);
+      rules.push_back(entry.FlipFamily());
     }
   }
 
@@ -358,8 +368,8 @@ void Connection::UpdateRoutingPolicy() {
         RoutingPolicyEntry::CreateFromSrc(IPAddress(IPAddress::kFamilyIPv4))
             .SetPriority(priority_ + blackhole_offset - 1)
             .SetTable(RT_TABLE_MAIN);
-    routing_table_->AddRule(interface_index_, main_table_rule);
-    routing_table_->AddRule(interface_index_, main_table_rule.FlipFamily());
+    rules.push_back(main_table_rule);
+    rules.push_back(main_table_rule.FlipFamily());
     // Add a default routing rule to use the primary interface if there is
     // nothing better.
     // TODO(crbug.com/999589) Remove this rule.
@@ -367,14 +377,17 @@ void Connection::UpdateRoutingPolicy() {
         RoutingPolicyEntry::CreateFromSrc(IPAddress(IPAddress::kFamilyIPv4))
             .SetTable(table_id_)
             .SetPriority(kCatchallPriority);
-    routing_table_->AddRule(interface_index_, catch_all_rule);
-    routing_table_->AddRule(interface_index_, catch_all_rule.FlipFamily());
+    rules.push_back(catch_all_rule);
+    rules.push_back(catch_all_rule.FlipFamily());
   }
+
+  routing_table_->AddRules(interface_index_, rules);
 }
 
 void Connection::AllowTrafficThrough(uint32_t table_id,
                                      uint32_t base_priority,
-                                     bool no_ipv6) {
+                                     bool no_ipv6,
+                                     std::vector<RoutingPolicyEntry>* rules) {
   // b/189952150: when |no_ipv6| is true and shill must prevent IPv6 traffic on
   // this connection for applications, it is still necessary to ensure that some
   // critical system IPv6 traffic can be routed. Example: shill portal detection
@@ -389,7 +402,7 @@ void Connection::AllowTrafficThrough(uint32_t table_id,
     if (dst_address.family() == IPAddress::kFamilyIPv6 && no_ipv6) {
       dst_addr_rule.SetUid(shill_uid);
     }
-    routing_table_->AddRule(interface_index_, dst_addr_rule);
+    rules->push_back(dst_addr_rule);
   }
 
   // Always set a rule for matching traffic tagged with the fwmark routing tag
@@ -399,11 +412,11 @@ void Connection::AllowTrafficThrough(uint32_t table_id,
           .SetPriority(base_priority)
           .SetTable(table_id)
           .SetFwMark(GetFwmarkRoutingTag(interface_index_));
-  routing_table_->AddRule(interface_index_, fwmark_routing_entry);
+  rules->push_back(fwmark_routing_entry);
   if (no_ipv6) {
     fwmark_routing_entry.SetUid(shill_uid);
   }
-  routing_table_->AddRule(interface_index_, fwmark_routing_entry.FlipFamily());
+  rules->push_back(fwmark_routing_entry.FlipFamily());
 
   // Add output interface rule for all interfaces, such that SO_BINDTODEVICE can
   // be used without explicitly binding the socket.
@@ -412,11 +425,11 @@ void Connection::AllowTrafficThrough(uint32_t table_id,
           .SetTable(table_id)
           .SetPriority(base_priority)
           .SetOif(interface_name_);
-  routing_table_->AddRule(interface_index_, oif_rule);
+  rules->push_back(oif_rule);
   if (no_ipv6) {
     oif_rule.SetUid(shill_uid);
   }
-  routing_table_->AddRule(interface_index_, oif_rule.FlipFamily());
+  rules->push_back(oif_rule.FlipFamily());
 
   if (use_if_addrs_) {
     // Select the per-device table if the outgoing packet's src address matches
@@ -431,18 +444,18 @@ void Connection::AllowTrafficThrough(uint32_t table_id,
       if (address.family() == IPAddress::kFamilyIPv6 && no_ipv6) {
         if_addr_rule.SetUid(shill_uid);
       }
-      routing_table_->AddRule(interface_index_, if_addr_rule);
+      rules->push_back(if_addr_rule);
     }
     auto iif_rule =
         RoutingPolicyEntry::CreateFromSrc(IPAddress(IPAddress::kFamilyIPv4))
             .SetTable(table_id)
             .SetPriority(base_priority)
             .SetIif(interface_name_);
-    routing_table_->AddRule(interface_index_, iif_rule);
+    rules->push_back(iif_rule);
     if (no_ipv6) {
       iif_rule.SetUid(shill_uid);
     }
-    routing_table_->AddRule(interface_index_, iif_rule.FlipFamily());
+    rules->push_back(iif_rule.FlipFamily());
   }
 }
 
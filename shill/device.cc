@@ -1136,6 +1136,16 @@ bool Device::StartPortalDetection() {
   portal_detector_.reset(new PortalDetector(
       dispatcher(), metrics(),
       base::Bind(&Device::PortalDetectorCallback, AsWeakPtr())));
+  // Race the probes over IPv6 too on dual-stack networks, so that a network
+  // with broken IPv4 or IPv6 connectivity is still validated quickly.
+  std::vector<IPAddress> alt_src_addresses;
+  if (ip6config_ && connection_->local().family() == IPAddress::kFamilyIPv4) {
+    IPAddress ipv6_address(IPAddress::kFamilyIPv6);
+    if (ipv6_address.SetAddressFromString(ip6config_->properties().address)) {
+      alt_src_addresses.push_back(ipv6_address);
+    }
+  }
+  portal_detector_->EnableProbeRacing(alt_src_addresses);
   if (!portal_detector_->Start(
           manager_->GetProperties(), connection_->interface_name(),
           connection_->local(), connection_->dns_servers())) {
@@ -1053,6 +1053,14 @@ class Metrics : public DefaultServiceObserver {
   // Portal detection results.
   static constexpr char kMetricPortalDetectionMultiProbeResult[] =
       "Network.Shill.PortalDetectionMultiProbeResult";
+  // Time taken by a portal detection trial racing probes to find that a
+  // network is online.
+  static constexpr char kMetricPortalDetectionRacingTimeToOnline[] =
+      "Network.Shill.PortalDetectionRacingTimeToOnline";
+  static constexpr int kMetricPortalDetectionRacingTimeToOnlineMax =
+      20 * 1000;  // 20 seconds
+  static constexpr int kMetricPortalDetectionRacingTimeToOnlineMin = 1;
+  static constexpr int kMetricPortalDetectionRacingTimeToOnlineNumBuckets = 50;
 
   // Wireless regulatory domain metric.
   static constexpr char kMetricRegulatoryDomain[] =
@@ -10,4 +10,24 @@ MockRoutingTable::MockRoutingTable() = default;
 
 MockRoutingTable::~MockRoutingTable() = default;
 
+bool MockRoutingTable::AddRoutes(
+    int interface_index, const std::vector<RoutingTableEntry>& entries) {
+  for (const auto& entry : entries) {
+    if (!AddRoute(interface_index, entry)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool MockRoutingTable::AddRules(
+    int interface_index, const std::vector<RoutingPolicyEntry>& entries) {
+  for (const auto& entry : entries) {
+    if (!AddRule(interface_index, entry)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 }  // namespace shill
@@ -5,6 +5,8 @@
 #ifndef SHILL_MOCK_ROUTING_TABLE_H_
 #define SHILL_MOCK_ROUTING_TABLE_H_
 
+#include <vector>
+
 #include <gmock/gmock.h>
 
 #include "shill/routing_table.h"
@@ -51,6 +53,13 @@ class MockRoutingTable : public RoutingTable {
   MOCK_METHOD(void, FreeAdditionalTableId, (uint32_t), (override));
   MOCK_METHOD(bool, AddRule, (int, const RoutingPolicyEntry&), (override));
   MOCK_METHOD(void, FlushRules, (int), (override));
+
+  // Batches are expected one entry at a time through AddRoute() and
+  // AddRule().
+  bool AddRoutes(int interface_index,
+                 const std::vector<RoutingTableEntry>& entries) override;
+  bool AddRules(int interface_index,
+                const std::vector<RoutingPolicyEntry>& entries) override;
 };
 
 }  // namespace shill
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -57,6 +58,18 @@ class MockRTNLHandler : public RTNLHandler {
                    uint32_t* seq) override {
     return DoSendMessage(message.get(), seq);
   }
+  // Messages sent in a batch are checked one by one.
+  size_t SendMessages(
+      std::vector<std::unique_ptr<RTNLMessage>> messages) override {
+    size_t sent = 0;
+    for (auto& message : messages) {
+      if (!DoSendMessage(message.get(), nullptr)) {
+        break;
+      }
+      sent++;
+    }
+    return sent;
+  }
 };
 
 }  // namespace shill
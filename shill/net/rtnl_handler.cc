@@ -20,6 +20,7 @@
 
 #include <limits>
 #include <utility>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/check.h>
@@ -53,6 +54,7 @@ const uint32_t RTNLHandler::kRequestBridgeNeighbor = 64;
 
 const int RTNLHandler::kErrorWindowSize = 16;
 const uint32_t RTNLHandler::kStoredRequestWindowSize = 32;
+const size_t RTNLHandler::kMaxBatchBytes = 32 * 1024;
 
 namespace {
 base::LazyInstance<RTNLHandler>::DestructorAtExit g_rtnl_handler =
@@ -127,6 +129,7 @@ void RTNLHandler::Stop() {
   request_sequence_ = 0;
   last_dump_sequence_ = 0;
   stored_requests_.clear();
+  batched_requests_.clear();
   oldest_request_sequence_ = 0;
 
   SLOG(this, 2) << "RTNLHandler stopped";
@@ -315,6 +318,14 @@ void RTNLHandler::ParseRTNL(InputData* data) {
             break;
           }
 
+          // Only the acknowledgement ends a batched request: notifications
+          // caused by the request carry its sequence too.
+          ErrorMask batched_error_mask;
+          if (!request_msg) {
+            request_msg =
+                PopBatchedRequest(hdr->nlmsg_seq, &batched_error_mask);
+          }
+
           const struct nlmsgerr* hdrErr =
               reinterpret_cast<nlmsgerr*>(NLMSG_DATA(hdr));
           std::string request_str;
@@ -355,6 +366,7 @@ void RTNLHandler::ParseRTNL(InputData* data) {
                 request_str.c_str(), error_number, strerror(error_number));
             if (base::Contains(GetAndClearErrorMask(hdr->nlmsg_seq),
                                error_number) ||
+                base::Contains(batched_error_mask, error_number) ||
                 (error_number == EEXIST && mode == RTNLMessage::kModeAdd) ||
                 (mode == RTNLMessage::kModeDelete &&
                  (error_number == ENOENT || error_number == ESRCH ||
@@ -515,16 +527,74 @@ bool RTNLHandler::AddInterface(const std::string& interface_name,
 
 bool RTNLHandler::SendMessage(std::unique_ptr<RTNLMessage> message,
                               uint32_t* msg_seq) {
+  ErrorMask error_mask = GetDefaultErrorMask(*message);
+  return SendMessageWithErrorMask(std::move(message), error_mask, msg_seq);
+}
+
+size_t RTNLHandler::SendMessages(
+    std::vector<std::unique_ptr<RTNLMessage>> messages) {
+  size_t sent = 0;
+  ByteString batch;
+  std::vector<std::unique_ptr<RTNLMessage>> batched_messages;
+
+  // Writes |batch| to the socket and stores the requests it contains.
+  auto send_batch = [&]() {
+    if (batched_messages.empty()) {
+      return true;
+    }
+    SLOG(this, 5) << "RTNL sending " << batched_messages.size()
+                  << " messages, length " << batch.GetLength();
+    if (sockets_->Send(rtnl_socket_, batch.GetConstData(), batch.GetLength(),
+                       0) < 0) {
+      PLOG(ERROR) << "RTNL send failed";
+      return false;
+    }
+    sent += batched_messages.size();
+    for (auto& message : batched_messages) {
+      const uint32_t seq = message->seq();
+      ErrorMask error_mask = GetDefaultErrorMask(*message);
+      batched_requests_[seq] = {std::move(message), std::move(error_mask)};
+    }
+    batched_messages.clear();
+    batch.Clear();
+    return true;
+  };
+
+  for (auto& message : messages) {
+    message->set_seq(request_sequence_);
+    message->set_flags(message->flags() | NLM_F_ACK);
+    ByteString msgdata = message->Encode();
+    if (msgdata.GetLength() == 0) {
+      LOG(ERROR) << "Failed to encode RTNL message " << message->ToString();
+      break;
+    }
+    // Messages sharing a write must be aligned.
+    msgdata.Resize(NLMSG_ALIGN(msgdata.GetLength()));
+    if (batch.GetLength() + msgdata.GetLength() > kMaxBatchBytes &&
+        !send_batch()) {
+      return sent;
+    }
+    request_sequence_++;
+    batch.Append(msgdata);
+    batched_messages.push_back(std::move(message));
+  }
+  send_batch();
+  return sent;
+}
+
+// static
+RTNLHandler::ErrorMask RTNLHandler::GetDefaultErrorMask(
+    const RTNLMessage& message) {
   ErrorMask error_mask;
-  if (message->mode() == RTNLMessage::kModeAdd) {
+  if (message.mode() == RTNLMessage::kModeAdd) {
     error_mask = {EEXIST};
-  } else if (message->mode() == RTNLMessage::kModeDelete) {
+  } else if (message.mode() == RTNLMessage::kModeDelete) {
     error_mask = {ESRCH, ENODEV};
-    if (message->type() == RTNLMessage::kTypeAddress) {
+    if (message.type() == RTNLMessage::kTypeAddress) {
       error_mask.insert(EADDRNOTAVAIL);
     }
   }
-  return SendMessageWithErrorMask(std::move(message), error_mask, msg_seq);
+  return error_mask;
 }
 
 bool RTNLHandler::SendMessageWithErrorMask(std::unique_ptr<RTNLMessage> message,
@@ -615,6 +685,18 @@ void RTNLHandler::StoreRequest(std::unique_ptr<RTNLMessage> request) {
   }
 }
 
+std::unique_ptr<RTNLMessage> RTNLHandler::PopBatchedRequest(
+    uint32_t seq, ErrorMask* error_mask) {
+  auto it = batched_requests_.find(seq);
+  if (it == batched_requests_.end()) {
+    return nullptr;
+  }
+  std::unique_ptr<RTNLMessage> res = std::move(it->second.request);
+  *error_mask = std::move(it->second.error_mask);
+  batched_requests_.erase(it);
+  return res;
+}
+
 std::unique_ptr<RTNLMessage> RTNLHandler::PopStoredRequest(uint32_t seq) {
   auto seq_request = stored_requests_.find(seq);
   if (seq_request == stored_requests_.end()) {
@@ -132,6 +132,14 @@ class SHILL_EXPORT RTNLHandler {
   // not null, then it will be set to the message's assigned sequence number.
   virtual bool SendMessage(std::unique_ptr<RTNLMessage> message, uint32_t* seq);
 
+  // Sends |messages| in order, packing as many of them as possible in each
+  // write to the RTNL socket. The messages are sent with NLM_F_ACK, so that
+  // their default error masks are kept until the kernel replies, however many
+  // messages are in flight. Returns the number of messages, from the start of
+  // |messages|, which were successfully sent.
+  virtual size_t SendMessages(
+      std::vector<std::unique_ptr<RTNLMessage>> messages);
+
  protected:
   RTNLHandler();
   RTNLHandler(const RTNLHandler&) = delete;
@@ -158,6 +166,9 @@ class SHILL_EXPORT RTNLHandler {
   // Size of the window for maintaining RTNLMessages in |stored_requests_| that
   // haven't yet gotten a response.
   static const uint32_t kStoredRequestWindowSize;
+  // Maximum number of bytes written to the RTNL socket by SendMessages() at
+  // once. This is well below the default socket send buffer size.
+  static const size_t kMaxBatchBytes;
 
   // This stops the event-monitoring function of the RTNL handler -- it is
   // private since it will never happen in normal running, but is useful for
@@ -182,6 +193,10 @@ class SHILL_EXPORT RTNLHandler {
                       const IPAddress& gateway,
                       const IPAddress& peer);
 
+  // Returns the errors which are expected for |message| and should not be
+  // logged.
+  static ErrorMask GetDefaultErrorMask(const RTNLMessage& message);
+
   // Send a formatted RTNL message.  Associates an error mask -- a list
   // of errors that are expected and should not trigger log messages by
   // default -- with the outgoing message.  If the message is sent
@@ -215,6 +230,11 @@ class SHILL_EXPORT RTNLHandler {
   // Removes a stored request from |stored_requests_| and returns it. Returns
   // nullptr if there is no request stored with that sequence.
   std::unique_ptr<RTNLMessage> PopStoredRequest(uint32_t seq);
+  // Removes a request sent by SendMessages() from |batched_requests_| and
+  // returns it, with its error mask in |error_mask|. Returns nullptr if there
+  // is no such request with that sequence.
+  std::unique_ptr<RTNLMessage> PopBatchedRequest(uint32_t seq,
+                                                 ErrorMask* error_mask);
   uint32_t CalculateStoredRequestWindowSize();
 
   std::unique_ptr<Sockets> sockets_;
@@ -229,6 +249,15 @@ class SHILL_EXPORT RTNLHandler {
   uint32_t oldest_request_sequence_;
   // Mapping of sequence number to corresponding RTNLMessage.
   std::map<uint32_t, std::unique_ptr<RTNLMessage>> stored_requests_;
+  // Requests sent by SendMessages(), and their error masks, until the kernel
+  // acknowledges them. Unlike |stored_requests_| and |error_mask_window_| this
+  // isn't bounded by a window, since a single batch can hold hundreds of
+  // requests.
+  struct BatchedRequest {
+    std::unique_ptr<RTNLMessage> request;
+    ErrorMask error_mask;
+  };
+  std::unordered_map<uint32_t, BatchedRequest> batched_requests_;
 
   base::ObserverList<RTNLListener> listeners_;
   std::unique_ptr<IOHandler> rtnl_handler_;
@@ -7,6 +7,7 @@
 #include <limits>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <net/if.h>
@@ -30,6 +31,7 @@ using testing::AtLeast;
 using testing::DoAll;
 using testing::ElementsAre;
 using testing::HasSubstr;
+using testing::Mock;
 using testing::Return;
 using testing::ReturnArg;
 using testing::StrictMock;
@@ -103,6 +105,8 @@ class RTNLHandlerTest : public Test {
 
   int GetErrorWindowSize() { return RTNLHandler::kErrorWindowSize; }
 
+  size_t GetMaxBatchBytes() { return RTNLHandler::kMaxBatchBytes; }
+
   void StoreRequest(std::unique_ptr<RTNLMessage> request) {
     RTNLHandler::GetInstance()->StoreRequest(std::move(request));
   }
@@ -329,6 +333,77 @@ TEST_F(RTNLHandlerTest, SendMessageInferredErrorMasks) {
   }
 }
 
+TEST_F(RTNLHandlerTest, SendMessagesInOneWrite) {
+  StartRTNLHandler();
+  const uint32_t kSequenceNumber = 123;
+  SetRequestSequence(kSequenceNumber);
+  const size_t message_size = CreateFakeMessage()->Encode().GetLength();
+  EXPECT_CALL(*sockets_, Send(kTestSocket, _, 3 * message_size, 0))
+      .WillOnce(ReturnArg<2>());
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  for (int i = 0; i < 3; i++) {
+    messages.push_back(CreateFakeMessage());
+  }
+  EXPECT_EQ(3, RTNLHandler::GetInstance()->SendMessages(std::move(messages)));
+  EXPECT_EQ(kSequenceNumber + 3, GetRequestSequence());
+  StopRTNLHandler();
+}
+
+TEST_F(RTNLHandlerTest, SendMessagesSplitsLargeBatches) {
+  StartRTNLHandler();
+  const size_t message_size = CreateFakeMessage()->Encode().GetLength();
+  const size_t messages_per_write = GetMaxBatchBytes() / message_size;
+  // The second write fails, only the messages of the first one are sent.
+  EXPECT_CALL(*sockets_, Send(kTestSocket, _, _, 0))
+      .WillOnce(ReturnArg<2>())
+      .WillOnce(Return(-1));
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  for (size_t i = 0; i < 2 * messages_per_write; i++) {
+    messages.push_back(CreateFakeMessage());
+  }
+  EXPECT_EQ(messages_per_write,
+            RTNLHandler::GetInstance()->SendMessages(std::move(messages)));
+  StopRTNLHandler();
+}
+
+TEST_F(RTNLHandlerTest, SendMessagesMasksErrorsBeyondWindow) {
+  StartRTNLHandler();
+  const uint32_t kSequenceNumber = 123;
+  SetRequestSequence(kSequenceNumber);
+  EXPECT_CALL(*sockets_, Send(kTestSocket, _, _, 0)).WillOnce(ReturnArg<2>());
+  // Deletions expect ENODEV, which is only masked by their error mask.
+  const int kNumMessages = 4 * GetErrorWindowSize();
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  for (int i = 0; i < kNumMessages; i++) {
+    messages.push_back(std::make_unique<RTNLMessage>(
+        RTNLMessage::kTypeLink, RTNLMessage::kModeDelete, 0, 0, 0, 0,
+        IPAddress::kFamilyUnknown));
+  }
+  EXPECT_EQ(kNumMessages,
+            RTNLHandler::GetInstance()->SendMessages(std::move(messages)));
+  ScopedMockLog log;
+
+  // The errors of all the messages of the batch are masked, including the ones
+  // out of the error mask window.
+  EXPECT_CALL(log, Log(logging::LOGGING_ERROR, _, HasSubstr("error 19")))
+      .Times(0);
+  for (int i = 0; i < kNumMessages; i += 2) {
+    ReturnError(kSequenceNumber + i, ENODEV);
+  }
+  Mock::VerifyAndClearExpectations(&log);
+
+  // The other messages are acknowledged, which drops their error masks too.
+  for (int i = 1; i < kNumMessages; i += 2) {
+    ReturnError(kSequenceNumber + i, 0);
+  }
+  EXPECT_CALL(log, Log(logging::LOGGING_ERROR, _, HasSubstr("error 19")))
+      .Times(2);
+  ReturnError(kSequenceNumber, ENODEV);
+  ReturnError(kSequenceNumber + 1, ENODEV);
+
+  StopRTNLHandler();
+}
+
 TEST_F(RTNLHandlerTest, MaskedError) {
   StartRTNLHandler();
   const uint32_t kSequenceNumber = 123;
@@ -170,6 +170,7 @@ class SHILL_EXPORT RTNLMessage {
   Type type() const { return type_; }
   Mode mode() const { return mode_; }
   uint16_t flags() const { return flags_; }
+  void set_flags(uint16_t flags) { flags_ = flags; }
   uint32_t seq() const { return seq_; }
   void set_seq(uint32_t seq) { seq_ = seq; }
   uint32_t pid() const { return pid_; }
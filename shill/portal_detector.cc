@@ -4,11 +4,14 @@
 
 #include "shill/portal_detector.h"
 
+#include <algorithm>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <base/bind.h>
+#include <base/containers/contains.h>
 #include <base/logging.h>
 #include <base/rand_util.h>
 #include <base/strings/pattern.h>
@@ -74,6 +77,63 @@ const std::string& PortalDetector::PickProbeUrl(
   return index < fallback_urls.size() ? fallback_urls[index] : default_url;
 }
 
+// static
+std::vector<std::string> PortalDetector::PickRacingProbeUrls(
+    const std::string& first_url,
+    const std::string& default_url,
+    const std::vector<std::string>& fallback_urls) {
+  std::vector<std::string> candidates = {first_url, default_url};
+  candidates.insert(candidates.end(), fallback_urls.begin(),
+                    fallback_urls.end());
+  std::vector<std::string> urls;
+  for (const auto& url_string : candidates) {
+    if (urls.size() >= kMaxRacingProbeUrls) {
+      break;
+    }
+    HttpUrl url;
+    if (base::Contains(urls, url_string) || !url.ParseFromString(url_string)) {
+      continue;
+    }
+    urls.push_back(url_string);
+  }
+  return urls;
+}
+
+void PortalDetector::CreateRacingProbes(
+    const std::vector<std::string>& http_urls,
+    const std::vector<std::string>& https_urls,
+    const std::string& ifname,
+    const IPAddress& src_address,
+    const std::vector<std::string>& dns_list) {
+  std::vector<IPAddress> src_addresses = {src_address};
+  src_addresses.insert(src_addresses.end(), racing_alt_src_addresses_.begin(),
+                       racing_alt_src_addresses_.end());
+
+  racing_probes_.clear();
+  for (bool is_https : {false, true}) {
+    for (const auto& url_string : is_https ? https_urls : http_urls) {
+      for (const auto& address : src_addresses) {
+        RacingProbe probe;
+        probe.is_https = is_https;
+        probe.url_string = url_string;
+        probe.src_address = address;
+        // For non-default URLs, allow for secure communication with both
+        // Google and non-Google servers.
+        probe.request = std::make_unique<HttpRequest>(
+            dispatcher_, ifname, address, dns_list,
+            is_https && url_string != kDefaultHttpsUrl);
+        racing_probes_.push_back(std::move(probe));
+      }
+    }
+  }
+}
+
+void PortalDetector::EnableProbeRacing(
+    const std::vector<IPAddress>& alt_src_addresses) {
+  racing_enabled_ = true;
+  racing_alt_src_addresses_ = alt_src_addresses;
+}
+
 bool PortalDetector::Start(const ManagerProperties& props,
                            const std::string& ifname,
                            const IPAddress& src_address,
@@ -104,6 +164,21 @@ bool PortalDetector::Start(const ManagerProperties& props,
   }
 
   attempt_count_++;
+  if (racing_enabled_) {
+    CleanupTrial();
+    CreateRacingProbes(
+        PickRacingProbeUrls(http_url_string_, props.portal_http_url,
+                            props.portal_fallback_http_urls),
+        PickRacingProbeUrls(https_url_string_, props.portal_https_url,
+                            props.portal_fallback_https_urls),
+        ifname, src_address, dns_list);
+    trial_.Reset(base::Bind(&PortalDetector::StartRacingTrialTask,
+                            weak_ptr_factory_.GetWeakPtr()));
+    dispatcher_->PostDelayedTask(FROM_HERE, trial_.callback(), delay);
+    last_attempt_start_time_ = base::Time::NowFromSystemTime() + delay;
+    return true;
+  }
+
   if (http_request_ || https_request_) {
     CleanupTrial();
   } else {
@@ -174,6 +249,147 @@ void PortalDetector::StartTrialTask() {
   is_active_ = true;
 }
 
+void PortalDetector::StartRacingTrialTask() {
+  LOG(INFO) << LoggingTag() << ": Starting racing trial with "
+            << racing_probes_.size() << " probes";
+  result_ = std::make_unique<Result>();
+  trial_start_time_ = base::TimeTicks::Now();
+  is_active_ = true;
+  // The first HTTP probe and the first HTTPS probe start right away. If one
+  // of them fails to start the trial may complete, and |this| may be deleted,
+  // before the second one is started.
+  auto weak_this = weak_ptr_factory_.GetWeakPtr();
+  StartNextRacingProbe(false);
+  if (weak_this && result_) {
+    StartNextRacingProbe(true);
+  }
+}
+
+void PortalDetector::StartNextRacingProbe(bool is_https) {
+  auto& next_probe =
+      is_https ? next_racing_https_probe_ : next_racing_http_probe_;
+  next_probe.Cancel();
+
+  const auto it = std::find_if(racing_probes_.begin(), racing_probes_.end(),
+                               [is_https](const RacingProbe& probe) {
+                                 return probe.is_https == is_https &&
+                                        !probe.started;
+                               });
+  if (it == racing_probes_.end()) {
+    return;
+  }
+
+  const size_t index = it - racing_probes_.begin();
+  it->started = true;
+  const std::string logging_tag =
+      LoggingTag() + (is_https ? " HTTPS probe " : " HTTP probe ") +
+      base::NumberToString(index) + " " +
+      IPAddress::GetAddressFamilyName(it->src_address.family());
+  HttpRequest::Result result = it->request->Start(
+      logging_tag, it->url_string, kHeaders,
+      base::Bind(&PortalDetector::RacingProbeSuccessCallback,
+                 weak_ptr_factory_.GetWeakPtr(), index),
+      base::Bind(&PortalDetector::RacingProbeErrorCallback,
+                 weak_ptr_factory_.GetWeakPtr(), index));
+  if (result != HttpRequest::kResultInProgress) {
+    LOG(ERROR) << logging_tag << ": Failed to start";
+    RacingProbeErrorCallback(index, result);
+    return;
+  }
+
+  next_probe.Reset(base::Bind(&PortalDetector::StartNextRacingProbe,
+                              weak_ptr_factory_.GetWeakPtr(), is_https));
+  dispatcher_->PostDelayedTask(FROM_HERE, next_probe.callback(),
+                               kRacingProbeDelay);
+}
+
+void PortalDetector::RacingProbeSuccessCallback(
+    size_t index, std::shared_ptr<brillo::http::Response> response) {
+  RacingProbe& probe = racing_probes_[index];
+  probe.completed = true;
+  int status_code = response->GetStatusCode();
+  LOG(INFO) << LoggingTag() << ": Racing probe " << index << " to "
+            << probe.url_string << " from " << probe.src_address
+            << " response code=" << status_code;
+  if (probe.is_https) {
+    // Only the expected 204 status code is a decisive answer for HTTPS.
+    if (!result_->https_probe_completed) {
+      result_->https_phase = Phase::kContent;
+      result_->https_status_code = status_code;
+      result_->https_status =
+          (status_code == brillo::http::status_code::NoContent)
+              ? Status::kSuccess
+              : Status::kFailure;
+      result_->https_probe_completed =
+          result_->https_status == Status::kSuccess;
+    }
+  } else if (!result_->http_probe_completed) {
+    // Any HTTP response is decisive: either the server is reached, or the
+    // network intercepted the request.
+    ProcessHttpProbeResponse(response, probe.url_string);
+    result_->http_probe_completed = true;
+  }
+  OnRacingProbeCompleted(probe.is_https);
+}
+
+void PortalDetector::RacingProbeErrorCallback(size_t index,
+                                              HttpRequest::Result result) {
+  RacingProbe& probe = racing_probes_[index];
+  probe.completed = true;
+  const Phase phase = GetPortalPhaseForRequestResult(result);
+  const Status status = GetPortalStatusForRequestResult(result);
+  LOG(INFO) << LoggingTag() << ": Racing probe " << index << " to "
+            << probe.url_string << " from " << probe.src_address
+            << " failed with phase=" << phase << " status=" << status;
+  // Errors are not decisive, they are only reported if all the probes of the
+  // same scheme fail.
+  if (probe.is_https && !result_->https_probe_completed) {
+    result_->https_phase = phase;
+    result_->https_status = status;
+  } else if (!probe.is_https && !result_->http_probe_completed) {
+    result_->http_phase = phase;
+    result_->http_status = status;
+  }
+  OnRacingProbeCompleted(probe.is_https);
+}
+
+void PortalDetector::OnRacingProbeCompleted(bool is_https) {
+  bool& probe_completed = is_https ? result_->https_probe_completed
+                                   : result_->http_probe_completed;
+  if (!probe_completed) {
+    const bool has_pending_probes =
+        std::any_of(racing_probes_.begin(), racing_probes_.end(),
+                    [is_https](const RacingProbe& probe) {
+                      return probe.is_https == is_https && !probe.completed;
+                    });
+    if (has_pending_probes) {
+      // As with Happy Eyeballs, the next probe starts as soon as the previous
+      // one failed rather than after |kRacingProbeDelay|.
+      StartNextRacingProbe(is_https);
+      return;
+    }
+    probe_completed = true;
+  }
+
+  // The result of the HTTPS probe does not change the connection state if the
+  // HTTP probe did not succeed, see Result::GetConnectionState().
+  if (!result_->IsComplete() && (!result_->http_probe_completed ||
+                                 result_->http_status == Status::kSuccess)) {
+    return;
+  }
+
+  Result result = *result_;
+  if (result.GetConnectionState() == Service::kStateOnline) {
+    metrics_->SendToUMA(
+        Metrics::kMetricPortalDetectionRacingTimeToOnline,
+        (base::TimeTicks::Now() - trial_start_time_).InMilliseconds(),
+        Metrics::kMetricPortalDetectionRacingTimeToOnlineMin,
+        Metrics::kMetricPortalDetectionRacingTimeToOnlineMax,
+        Metrics::kMetricPortalDetectionRacingTimeToOnlineNumBuckets);
+  }
+  CompleteTrial(result);
+}
+
 void PortalDetector::CompleteTrial(Result result) {
   LOG(INFO) << LoggingTag()
             << ": Trial completed. HTTP probe: phase=" << result.http_phase
@@ -192,6 +408,11 @@ void PortalDetector::CleanupTrial() {
     http_request_->Stop();
   if (https_request_)
     https_request_->Stop();
+  for (auto& probe : racing_probes_) {
+    probe.request->Stop();
+  }
+  next_racing_http_probe_.Cancel();
+  next_racing_https_probe_.Cancel();
 
   is_active_ = false;
 }
@@ -200,19 +421,28 @@ void PortalDetector::Stop() {
   SLOG(this, 3) << "In " << __func__;
 
   attempt_count_ = 0;
-  if (!http_request_ && !https_request_)
+  if (!http_request_ && !https_request_ && racing_probes_.empty())
     return;
 
   CleanupTrial();
   http_request_.reset();
   https_request_.reset();
+  racing_probes_.clear();
 }
 
 void PortalDetector::HttpRequestSuccessCallback(
     std::shared_ptr<brillo::http::Response> response) {
+  result_->http_probe_completed = true;
+  ProcessHttpProbeResponse(response, http_url_string_);
+  if (result_->IsComplete())
+    CompleteTrial(*result_);
+}
+
+void PortalDetector::ProcessHttpProbeResponse(
+    const std::shared_ptr<brillo::http::Response>& response,
+    const std::string& probe_url_string) {
   // TODO(matthewmwang): check for 0 length data as well
   int status_code = response->GetStatusCode();
-  result_->http_probe_completed = true;
   result_->http_phase = Phase::kContent;
   result_->http_status_code = status_code;
   if (status_code == brillo::http::status_code::NoContent) {
@@ -232,7 +462,7 @@ void PortalDetector::HttpRequestSuccessCallback(
       } else {
         LOG(INFO) << LoggingTag() << ": Redirect URL: " << redirect_url_string;
         result_->redirect_url_string = redirect_url_string;
-        result_->probe_url_string = http_url_string_;
+        result_->probe_url_string = probe_url_string;
       }
     }
   } else {
@@ -240,8 +470,6 @@ void PortalDetector::HttpRequestSuccessCallback(
   }
   LOG(INFO) << LoggingTag() << ": HTTP probe response code=" << status_code
             << " status=" << result_->http_status;
-  if (result_->IsComplete())
-    CompleteTrial(*result_);
 }
 
 void PortalDetector::HttpsRequestSuccessCallback(
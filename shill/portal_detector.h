@@ -65,6 +65,15 @@ struct ManagerProperties;
 //   on the number of previous attempts, until it saturates at
 //   kMaxPortalCheckInterval. The growth factor is controlled by the
 //   |kPortalCheckInterval| parameter.
+//
+// When probe racing is enabled with EnableProbeRacing(), a trial does not
+// depend on a single HTTP probe and a single HTTPS probe. Instead, probes to
+// several of the configured URLs are sent from the source address of every IP
+// family of the network, in the manner of Happy Eyeballs (RFC 8305): probes of
+// the same scheme are started |kRacingProbeDelay| apart, or as soon as the
+// previous one failed, and the trial completes as soon as the first decisive
+// answers are received. Unreachable servers or a broken IP family therefore do
+// not delay the result until the requests time out.
 class PortalDetector {
  public:
   // Default URL used for the first HTTP probe sent by PortalDetector on a new
@@ -183,6 +192,12 @@ class PortalDetector {
   // the callback.
   virtual void Stop();
 
+  // Enables probe racing for the following attempts. Probes are raced from the
+  // source address given to Start() and from every address of
+  // |alt_src_addresses|, typically the address of the other IP family of a
+  // dual-stack network.
+  void EnableProbeRacing(const std::vector<IPAddress>& alt_src_addresses);
+
   // Returns whether portal request is "in progress".
   virtual bool IsInProgress();
 
@@ -203,8 +218,24 @@ class PortalDetector {
   FRIEND_TEST(PortalDetectorTest, RequestHTTPFailureHTTPSSuccess);
   FRIEND_TEST(PortalDetectorTest, IsInProgress);
   FRIEND_TEST(PortalDetectorTest, PickProbeUrlTest);
+  FRIEND_TEST(PortalDetectorTest, PickRacingProbeUrls);
 
   static constexpr base::TimeDelta kZeroTimeDelta = base::TimeDelta();
+  // Delay between the start of two racing probes of the same scheme. This is
+  // the Connection Attempt Delay recommended by RFC 8305.
+  static constexpr base::TimeDelta kRacingProbeDelay = base::Milliseconds(250);
+  // Maximum number of URLs probed by a racing trial for each scheme.
+  static constexpr size_t kMaxRacingProbeUrls = 2;
+
+  // HTTP or HTTPS probe of a racing trial.
+  struct RacingProbe {
+    bool is_https;
+    std::string url_string;
+    IPAddress src_address;
+    std::unique_ptr<HttpRequest> request;
+    bool started = false;
+    bool completed = false;
+  };
 
   // Picks the next probe URL based on |attempt_count_|. Returns |default_url|
   // if this is the first attempt. Otherwise, randomly returns with equal
@@ -213,10 +244,50 @@ class PortalDetector {
       const std::string& default_url,
       const std::vector<std::string>& fallback_urls) const;
 
+  // Returns up to |kMaxRacingProbeUrls| distinct URLs to probe in a racing
+  // trial: |first_url|, followed by |default_url| and |fallback_urls|.
+  static std::vector<std::string> PickRacingProbeUrls(
+      const std::string& first_url,
+      const std::string& default_url,
+      const std::vector<std::string>& fallback_urls);
+
+  // Creates the probes of the next racing trial. Probes of the same URL from
+  // the different source addresses are created next to each other, so that
+  // the IP families are interleaved.
+  void CreateRacingProbes(const std::vector<std::string>& http_urls,
+                          const std::vector<std::string>& https_urls,
+                          const std::string& ifname,
+                          const IPAddress& src_address,
+                          const std::vector<std::string>& dns_list);
+
   // Internal method used to start the actual connectivity trial, called after
   // the start delay completes.
   void StartTrialTask();
 
+  // Same as StartTrialTask() when probe racing is enabled.
+  void StartRacingTrialTask();
+
+  // Starts the next racing probe of the given scheme which has not started
+  // yet, if any, and schedules the start of the following one.
+  void StartNextRacingProbe(bool is_https);
+
+  // Callbacks used to return the response or the error of the racing probe
+  // |racing_probes_[index]|.
+  void RacingProbeSuccessCallback(
+      size_t index, std::shared_ptr<brillo::http::Response> response);
+  void RacingProbeErrorCallback(size_t index, HttpRequest::Result result);
+
+  // Called when a racing probe of the given scheme completes. Starts the next
+  // probe of that scheme if no decisive answer was received yet, or completes
+  // the trial if its result is known.
+  void OnRacingProbeCompleted(bool is_https);
+
+  // Fills the HTTP probe fields of |result_| from the |response| received for
+  // |probe_url_string|.
+  void ProcessHttpProbeResponse(
+      const std::shared_ptr<brillo::http::Response>& response,
+      const std::string& probe_url_string);
+
   // Callback used to return data read from the HTTP HttpRequest.
   void HttpRequestSuccessCallback(
       std::shared_ptr<brillo::http::Response> response);
@@ -254,6 +325,13 @@ class PortalDetector {
   std::string https_url_string_;
   base::CancelableClosure trial_;
   bool is_active_;
+
+  bool racing_enabled_ = false;
+  std::vector<IPAddress> racing_alt_src_addresses_;
+  std::vector<RacingProbe> racing_probes_;
+  base::CancelableClosure next_racing_http_probe_;
+  base::CancelableClosure next_racing_https_probe_;
+  base::TimeTicks trial_start_time_;
 };
 
 std::ostream& operator<<(std::ostream& stream, PortalDetector::Phase phase);
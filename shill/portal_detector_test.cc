@@ -22,6 +22,7 @@
 #include "shill/mock_metrics.h"
 
 using testing::_;
+using testing::AnyNumber;
 using testing::Mock;
 using testing::NiceMock;
 using testing::Return;
@@ -41,6 +42,7 @@ const std::vector<std::string> kFallbackHttpUrls{
     "http://play.googleapis.com/generate_204",
 };
 const IPAddress kIpAddress = IPAddress("1.2.3.4");
+const IPAddress kIpv6Address = IPAddress("2001:db8::1");
 const char kDNSServer0[] = "8.8.8.8";
 const char kDNSServer1[] = "8.8.4.4";
 const char* const kDNSServers[] = {kDNSServer0, kDNSServer1};
@@ -163,6 +165,69 @@ class PortalDetectorTest : public Test {
     portal_detector()->StartTrialTask();
   }
 
+  // Enables probe racing with |alt_src_addresses| and starts an attempt whose
+  // racing probes use mock HttpRequests.
+  void StartRacingAttempt(const std::vector<IPAddress>& alt_src_addresses) {
+    portal_detector_->EnableProbeRacing(alt_src_addresses);
+    EXPECT_CALL(dispatcher(), PostDelayedTask(_, _, base::TimeDelta()));
+    EXPECT_TRUE(portal_detector_->Start(MakePortalProperties(), kInterfaceName,
+                                        kIpAddress, dns_servers_));
+    racing_requests_.clear();
+    for (auto& probe : portal_detector_->racing_probes_) {
+      auto request = std::make_unique<StrictMock<MockHttpRequest>>();
+      // Requests are stopped whenever a trial completes or is cleaned up.
+      EXPECT_CALL(*request, Stop()).Times(AnyNumber());
+      racing_requests_.push_back(request.get());
+      probe.request = std::move(request);
+    }
+  }
+
+  // Starts the racing trial, expecting the first HTTP probe and the first
+  // HTTPS probe to start.
+  void StartRacingTrialTask() {
+    EXPECT_CALL(*racing_request(0), Start(_, kHttpUrl, _, _, _))
+        .WillOnce(Return(HttpRequest::kResultInProgress));
+    EXPECT_CALL(*racing_request(FirstRacingHttpsProbe()),
+                Start(_, kHttpsUrl, _, _, _))
+        .WillOnce(Return(HttpRequest::kResultInProgress));
+    EXPECT_CALL(dispatcher(), PostDelayedTask(_, _, RacingProbeDelay()))
+        .Times(2);
+    portal_detector_->StartRacingTrialTask();
+  }
+
+  static base::TimeDelta RacingProbeDelay() {
+    return PortalDetector::kRacingProbeDelay;
+  }
+
+  size_t FirstRacingHttpsProbe() const {
+    const auto& probes = portal_detector_->racing_probes_;
+    for (size_t i = 0; i < probes.size(); i++) {
+      if (probes[i].is_https) {
+        return i;
+      }
+    }
+    return probes.size();
+  }
+
+  void RacingProbeResponse(size_t index, int status_code) {
+    EXPECT_CALL(*brillo_connection_, GetResponseStatusCode())
+        .WillOnce(Return(status_code));
+    portal_detector_->RacingProbeSuccessCallback(
+        index, std::make_shared<brillo::http::Response>(brillo_connection_));
+  }
+
+  void RacingProbeError(size_t index, HttpRequest::Result result) {
+    portal_detector_->RacingProbeErrorCallback(index, result);
+  }
+
+  const std::vector<PortalDetector::RacingProbe>& racing_probes() const {
+    return portal_detector_->racing_probes_;
+  }
+
+  MockHttpRequest* racing_request(size_t index) {
+    return racing_requests_[index];
+  }
+
   MockHttpRequest* http_request() { return http_request_; }
   MockHttpRequest* https_request() { return https_request_; }
   PortalDetector* portal_detector() { return portal_detector_.get(); }
@@ -211,6 +276,7 @@ class PortalDetectorTest : public Test {
   std::vector<std::string> dns_servers_;
   MockHttpRequest* http_request_;
   MockHttpRequest* https_request_;
+  std::vector<MockHttpRequest*> racing_requests_;
 };
 
 // static
@@ -509,4 +575,119 @@ TEST_F(PortalDetectorTest, PickProbeUrlTest) {
   EXPECT_EQ(all_urls, all_found_urls);
 }
 
+TEST_F(PortalDetectorTest, PickRacingProbeUrls) {
+  const std::string url1 = "http://www.url1.com";
+  const std::string url2 = "http://www.url2.com";
+  const std::string url3 = "http://www.url3.com";
+
+  EXPECT_EQ(std::vector<std::string>({url1}),
+            PortalDetector::PickRacingProbeUrls(url1, url1, {}));
+  EXPECT_EQ(std::vector<std::string>({url2, url1}),
+            PortalDetector::PickRacingProbeUrls(url2, url1, {url2, url3}));
+  EXPECT_EQ(std::vector<std::string>({url1, url3}),
+            PortalDetector::PickRacingProbeUrls(url1, url1, {kBadURL, url3}));
+}
+
+TEST_F(PortalDetectorTest, RacingProbesInterleaveFamilies) {
+  StartRacingAttempt({kIpv6Address});
+
+  // Two HTTP URLs and one HTTPS URL, each probed over IPv4 and IPv6.
+  ASSERT_EQ(6u, racing_probes().size());
+  EXPECT_EQ(4u, FirstRacingHttpsProbe());
+  for (size_t i = 0; i < racing_probes().size(); i++) {
+    const auto& probe = racing_probes()[i];
+    EXPECT_EQ(i >= 4, probe.is_https);
+    EXPECT_EQ(i % 2 == 0 ? kIpAddress : kIpv6Address, probe.src_address);
+  }
+  EXPECT_EQ(kHttpUrl, racing_probes()[0].url_string);
+  EXPECT_EQ(kHttpUrl, racing_probes()[1].url_string);
+  EXPECT_EQ(kFallbackHttpUrls[0], racing_probes()[2].url_string);
+  EXPECT_EQ(kHttpsUrl, racing_probes()[4].url_string);
+  EXPECT_EQ(kHttpsUrl, racing_probes()[5].url_string);
+}
+
+TEST_F(PortalDetectorTest, RacingOnline) {
+  StartRacingAttempt({kIpv6Address});
+  StartRacingTrialTask();
+  EXPECT_TRUE(portal_detector()->IsInProgress());
+
+  EXPECT_CALL(callback_target(), ResultCallback(_)).Times(0);
+  RacingProbeResponse(FirstRacingHttpsProbe(), 204);
+  Mock::VerifyAndClearExpectations(&callback_target());
+
+  PortalDetector::Result result;
+  result.http_phase = PortalDetector::Phase::kContent,
+  result.http_status = PortalDetector::Status::kSuccess;
+  result.https_phase = PortalDetector::Phase::kContent;
+  result.https_status = PortalDetector::Status::kSuccess;
+  EXPECT_CALL(callback_target(), ResultCallback(IsResult(result)));
+  EXPECT_CALL(metrics(), NotifyPortalDetectionMultiProbeResult(_));
+  EXPECT_CALL(metrics(),
+              SendToUMA(Metrics::kMetricPortalDetectionRacingTimeToOnline, _,
+                        _, _, _));
+  RacingProbeResponse(0, 204);
+  EXPECT_FALSE(portal_detector()->IsInProgress());
+}
+
+TEST_F(PortalDetectorTest, RacingFailedProbeStartsNextProbe) {
+  StartRacingAttempt({kIpv6Address});
+  StartRacingTrialTask();
+
+  // The IPv4 HTTP probe fails, the IPv6 one starts without waiting.
+  EXPECT_CALL(*racing_request(1), Start(_, kHttpUrl, _, _, _))
+      .WillOnce(Return(HttpRequest::kResultInProgress));
+  EXPECT_CALL(dispatcher(), PostDelayedTask(_, _, RacingProbeDelay()));
+  EXPECT_CALL(callback_target(), ResultCallback(_)).Times(0);
+  RacingProbeError(0, HttpRequest::kResultConnectionFailure);
+  Mock::VerifyAndClearExpectations(&callback_target());
+
+  // The IPv6 probes decide the result.
+  PortalDetector::Result result;
+  result.http_phase = PortalDetector::Phase::kContent,
+  result.http_status = PortalDetector::Status::kSuccess;
+  result.https_phase = PortalDetector::Phase::kContent;
+  result.https_status = PortalDetector::Status::kSuccess;
+  EXPECT_CALL(callback_target(), ResultCallback(IsResult(result)));
+  RacingProbeResponse(FirstRacingHttpsProbe(), 204);
+  RacingProbeResponse(1, 204);
+}
+
+TEST_F(PortalDetectorTest, RacingAllHttpProbesFail) {
+  StartRacingAttempt({});
+  StartRacingTrialTask();
+  ASSERT_EQ(2u, FirstRacingHttpsProbe());
+
+  EXPECT_CALL(*racing_request(1), Start(_, kFallbackHttpUrls[0], _, _, _))
+      .WillOnce(Return(HttpRequest::kResultInProgress));
+  EXPECT_CALL(dispatcher(), PostDelayedTask(_, _, RacingProbeDelay()));
+  RacingProbeError(0, HttpRequest::kResultDNSTimeout);
+
+  // The trial completes without waiting for the HTTPS probes.
+  PortalDetector::Result result;
+  result.http_phase = PortalDetector::Phase::kConnection,
+  result.http_status = PortalDetector::Status::kFailure;
+  result.https_phase = PortalDetector::Phase::kUnknown;
+  result.https_status = PortalDetector::Status::kFailure;
+  EXPECT_CALL(callback_target(), ResultCallback(IsResult(result)));
+  EXPECT_CALL(metrics(), SendToUMA(_, _, _, _, _)).Times(0);
+  RacingProbeError(1, HttpRequest::kResultConnectionFailure);
+}
+
+TEST_F(PortalDetectorTest, RacingRedirect) {
+  StartRacingAttempt({kIpv6Address});
+  StartRacingTrialTask();
+
+  PortalDetector::Result result;
+  result.http_phase = PortalDetector::Phase::kContent,
+  result.http_status = PortalDetector::Status::kRedirect;
+  result.https_phase = PortalDetector::Phase::kUnknown;
+  result.https_status = PortalDetector::Status::kFailure;
+  result.redirect_url_string = kHttpsUrl;
+  result.probe_url_string = kHttpUrl;
+  EXPECT_CALL(callback_target(), ResultCallback(IsResult(result)));
+  EXPECT_CALL(*brillo_connection(), GetResponseHeader("Location"))
+      .WillOnce(Return(kHttpsUrl));
+  RacingProbeResponse(0, 302);
+}
+
 }  // namespace shill
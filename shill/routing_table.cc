@@ -18,9 +18,12 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <iterator>
 #include <limits>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <base/bind.h>
 #include <base/check.h>
@@ -192,16 +195,22 @@ void RoutingTable::RegisterDevice(int interface_index,
 
   uint32_t table_id = GetInterfaceTableId(interface_index);
   // Move existing entries for this interface to the per-Device table.
-  for (auto& nent : tables_[interface_index]) {
-    if (nent.table == table_id) {
+  InterfaceRoutes& table = tables_[interface_index];
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  for (auto nent = table.begin(); nent != table.end(); ++nent) {
+    if (nent->table == table_id) {
       continue;
     }
-    RoutingTableEntry new_entry = nent;
+    RoutingTableEntry new_entry = *nent;
     new_entry.table = table_id;
-    AddRouteToKernelTable(interface_index, new_entry);
-    RemoveRouteFromKernelTable(interface_index, nent);
-    nent.table = table_id;
+    messages.push_back(CreateRouteMessage(interface_index, new_entry,
+                                          RTNLMessage::kModeAdd,
+                                          NLM_F_CREATE | NLM_F_EXCL));
+    messages.push_back(CreateRouteMessage(interface_index, *nent,
+                                          RTNLMessage::kModeDelete, 0));
+    table.SetTable(nent, table_id);
   }
+  rtnl_handler_->SendMessages(std::move(messages));
 
   // Set accept_ra_rt_table to -N to cause routes created by the reception of
   // RAs to be sent to the table id (interface_index + N).
@@ -237,8 +246,8 @@ void RoutingTable::DeregisterDevice(int interface_index,
   FlushCache();
 }
 
-bool RoutingTable::AddRoute(int interface_index,
-                            const RoutingTableEntry& entry) {
+bool RoutingTable::IsValidRoute(int interface_index,
+                                const RoutingTableEntry& entry) {
   // Normal routes (i.e. not blackhole or unreachable) should be sent to a
   // the interface's per-device table.
   if (entry.table != GetInterfaceTableId(interface_index) &&
@@ -248,21 +257,50 @@ bool RoutingTable::AddRoute(int interface_index,
                << GetInterfaceTableId(interface_index);
     return false;
   }
+  return true;
+}
 
-  if (!AddRouteToKernelTable(interface_index, entry)) {
+bool RoutingTable::AddRoute(int interface_index,
+                            const RoutingTableEntry& entry) {
+  if (!IsValidRoute(interface_index, entry) ||
+      !AddRouteToKernelTable(interface_index, entry)) {
     return false;
   }
   tables_[interface_index].push_back(entry);
   return true;
 }
 
+bool RoutingTable::AddRoutes(int interface_index,
+                             const std::vector<RoutingTableEntry>& entries) {
+  SLOG(this, 2) << __func__ << " index " << interface_index << " "
+                << entries.size() << " entries";
+
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  for (const auto& entry : entries) {
+    if (!IsValidRoute(interface_index, entry)) {
+      break;
+    }
+    messages.push_back(CreateRouteMessage(interface_index, entry,
+                                          RTNLMessage::kModeAdd,
+                                          NLM_F_CREATE | NLM_F_EXCL));
+  }
+
+  // Only keep track of the entries which were sent to the kernel.
+  const size_t sent = rtnl_handler_->SendMessages(std::move(messages));
+  InterfaceRoutes& table = tables_[interface_index];
+  for (size_t i = 0; i < sent; i++) {
+    table.push_back(entries[i]);
+  }
+  return sent == entries.size();
+}
+
 bool RoutingTable::RemoveRoute(int interface_index,
                                const RoutingTableEntry& entry) {
   if (!RemoveRouteFromKernelTable(interface_index, entry)) {
     return false;
   }
-  RouteTableEntryVector& table = tables_[interface_index];
-  for (auto nent = table.begin(); nent != table.end(); ++nent) {
+  InterfaceRoutes& table = tables_[interface_index];
+  for (auto nent : table.Find(entry.dst)) {
     if (*nent == entry) {
       table.erase(nent);
       return true;
@@ -302,11 +340,10 @@ bool RoutingTable::GetDefaultRouteInternal(int interface_index,
   // couple of seconds).  Ignore these when there is another default route
   // with a lower metric.
   uint32_t lowest_metric = UINT_MAX;
-  for (auto& nent : table->second) {
-    if (nent.dst.IsDefault() && nent.dst.family() == family &&
-        nent.metric < lowest_metric) {
-      *entry = &nent;
-      lowest_metric = nent.metric;
+  for (auto nent : table->second.Find(IPAddress(family))) {
+    if (nent->dst.IsDefault() && nent->metric < lowest_metric) {
+      *entry = &*nent;
+      lowest_metric = nent->metric;
     }
   }
 
@@ -368,25 +405,31 @@ void RoutingTable::FlushRoutes(int interface_index) {
     return;
   }
 
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
   for (const auto& nent : table->second) {
-    RemoveRouteFromKernelTable(interface_index, nent);
+    messages.push_back(CreateRouteMessage(interface_index, nent,
+                                          RTNLMessage::kModeDelete, 0));
   }
+  rtnl_handler_->SendMessages(std::move(messages));
   table->second.clear();
 }
 
 void RoutingTable::FlushRoutesWithTag(int tag) {
   SLOG(this, 2) << __func__;
 
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
   for (auto& table : tables_) {
     for (auto nent = table.second.begin(); nent != table.second.end();) {
       if (nent->tag == tag) {
-        RemoveRouteFromKernelTable(table.first, *nent);
+        messages.push_back(CreateRouteMessage(table.first, *nent,
+                                              RTNLMessage::kModeDelete, 0));
         nent = table.second.erase(nent);
       } else {
         ++nent;
       }
     }
   }
+  rtnl_handler_->SendMessages(std::move(messages));
 }
 
 void RoutingTable::ResetTable(int interface_index) {
@@ -512,16 +555,14 @@ void RoutingTable::RouteMsgHandler(const RTNLMessage& message) {
   // be tracked by Shill. In the future, each service could use a unique
   // protocol value, such that Shill would be able to determine which service
   // created a particular route.
-  RouteTableEntryVector& table = tables_[interface_index];
-  for (auto nent = table.begin(); nent != table.end();) {
+  InterfaceRoutes& table = tables_[interface_index];
+  for (auto nent : table.Find(entry.dst)) {
     // clang-format off
-    if (nent->dst != entry.dst ||
-        nent->src != entry.src ||
+    if (nent->src != entry.src ||
         nent->gateway != entry.gateway ||
         nent->scope != entry.scope ||
         nent->metric != entry.metric ||
         nent->type != entry.type) {
-      ++nent;
       continue;
     }
     // clang-format on
@@ -539,9 +580,7 @@ void RoutingTable::RouteMsgHandler(const RTNLMessage& message) {
       // Keep track of route deletions that come from outside of shill. Continue
       // the loop for resilience to any failure scenario in which
       // tables_[interface_index] has duplicate entries.
-      nent = table.erase(nent);
-    } else {
-      ++nent;
+      table.erase(nent);
     }
   }
 
@@ -569,6 +608,15 @@ bool RoutingTable::ApplyRoute(uint32_t interface_index,
                               const RoutingTableEntry& entry,
                               RTNLMessage::Mode mode,
                               unsigned int flags) {
+  return rtnl_handler_->SendMessage(
+      CreateRouteMessage(interface_index, entry, mode, flags), nullptr);
+}
+
+std::unique_ptr<RTNLMessage> RoutingTable::CreateRouteMessage(
+    uint32_t interface_index,
+    const RoutingTableEntry& entry,
+    RTNLMessage::Mode mode,
+    unsigned int flags) {
   DCHECK(entry.table != RT_TABLE_UNSPEC && entry.table != RT_TABLE_COMPAT)
       << "Attempted to apply route: " << entry;
 
@@ -607,7 +655,7 @@ bool RoutingTable::ApplyRoute(uint32_t interface_index,
                           ByteString::CreateFromCPUUInt32(interface_index));
   }
 
-  return rtnl_handler_->SendMessage(std::move(message), nullptr);
+  return message;
 }
 
 // Somewhat surprisingly, the kernel allows you to create multiple routes
@@ -728,6 +776,15 @@ bool RoutingTable::ApplyRule(uint32_t interface_index,
                              const RoutingPolicyEntry& entry,
                              RTNLMessage::Mode mode,
                              unsigned int flags) {
+  return rtnl_handler_->SendMessage(
+      CreateRuleMessage(interface_index, entry, mode, flags), nullptr);
+}
+
+std::unique_ptr<RTNLMessage> RoutingTable::CreateRuleMessage(
+    uint32_t interface_index,
+    const RoutingPolicyEntry& entry,
+    RTNLMessage::Mode mode,
+    unsigned int flags) {
   SLOG(this, 2) << base::StringPrintf(
       "%s: index %d family %s prio %d", __func__, interface_index,
       IPAddress::GetAddressFamilyName(entry.family).c_str(), entry.priority);
@@ -771,7 +828,7 @@ bool RoutingTable::ApplyRule(uint32_t interface_index,
     message->SetAttribute(FRA_SRC, entry.src.address());
   }
 
-  return rtnl_handler_->SendMessage(std::move(message), nullptr);
+  return message;
 }
 
 bool RoutingTable::ParseRoutingPolicyMessage(const RTNLMessage& message,
@@ -900,6 +957,20 @@ bool RoutingTable::AddRule(int interface_index,
   return true;
 }
 
+bool RoutingTable::AddRules(int interface_index,
+                            const std::vector<RoutingPolicyEntry>& entries) {
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
+  for (const auto& entry : entries) {
+    messages.push_back(CreateRuleMessage(interface_index, entry,
+                                         RTNLMessage::kModeAdd,
+                                         NLM_F_CREATE | NLM_F_EXCL));
+  }
+  const size_t sent = rtnl_handler_->SendMessages(std::move(messages));
+  PolicyTableEntryVector& table = policy_tables_[interface_index];
+  table.insert(table.end(), entries.begin(), entries.begin() + sent);
+  return sent == entries.size();
+}
+
 void RoutingTable::FlushRules(int interface_index) {
   SLOG(this, 2) << __func__;
 
@@ -908,12 +979,77 @@ void RoutingTable::FlushRules(int interface_index) {
     return;
   }
 
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
   for (const auto& nent : table->second) {
-    ApplyRule(interface_index, nent, RTNLMessage::kModeDelete, 0);
+    messages.push_back(CreateRuleMessage(interface_index, nent,
+                                         RTNLMessage::kModeDelete, 0));
   }
+  rtnl_handler_->SendMessages(std::move(messages));
   table->second.clear();
 }
 
+RoutingTable::InterfaceRoutes::InterfaceRoutes() = default;
+
+RoutingTable::InterfaceRoutes::~InterfaceRoutes() = default;
+
+void RoutingTable::InterfaceRoutes::push_back(const RoutingTableEntry& entry) {
+  entries_.push_back(entry);
+  index_.emplace(GetKey(entry.dst, entry.table), std::prev(entries_.end()));
+}
+
+RoutingTable::InterfaceRoutes::iterator RoutingTable::InterfaceRoutes::erase(
+    iterator it) {
+  auto range = index_.equal_range(GetKey(it->dst, it->table));
+  for (auto index_it = range.first; index_it != range.second; ++index_it) {
+    if (index_it->second == it) {
+      index_.erase(index_it);
+      break;
+    }
+  }
+  return entries_.erase(it);
+}
+
+void RoutingTable::InterfaceRoutes::clear() {
+  index_.clear();
+  entries_.clear();
+}
+
+void RoutingTable::InterfaceRoutes::SetTable(iterator it, uint32_t table) {
+  auto range = index_.equal_range(GetKey(it->dst, it->table));
+  for (auto index_it = range.first; index_it != range.second; ++index_it) {
+    if (index_it->second == it) {
+      index_.erase(index_it);
+      break;
+    }
+  }
+  it->table = table;
+  index_.emplace(GetKey(it->dst, it->table), it);
+}
+
+std::vector<RoutingTable::InterfaceRoutes::iterator>
+RoutingTable::InterfaceRoutes::Find(const IPAddress& dst) {
+  // Entries with the same destination are contiguous in |index_|, sorted by
+  // table.
+  const Key key = GetKey(dst, 0);
+  std::vector<iterator> entries;
+  for (auto it = index_.lower_bound(key);
+       it != index_.end() && std::get<0>(it->first) == std::get<0>(key) &&
+       std::get<1>(it->first) == std::get<1>(key) &&
+       std::get<2>(it->first) == std::get<2>(key);
+       ++it) {
+    entries.push_back(it->second);
+  }
+  return entries;
+}
+
+// static
+RoutingTable::InterfaceRoutes::Key RoutingTable::InterfaceRoutes::GetKey(
+    const IPAddress& dst, uint32_t table) {
+  return Key(dst.family(),
+             dst.address().IsZero() ? ByteString() : dst.address(),
+             dst.prefix(), table);
+}
+
 // static
 uint32_t RoutingTable::GetInterfaceTableId(int interface_index) {
   return static_cast<uint32_t>(interface_index + kInterfaceTableIdIncrement);
@@ -930,16 +1066,19 @@ uint32_t RoutingTable::RequestAdditionalTableId() {
 
   // Flush any entries currently in this table before letting the caller
   // use it.
+  std::vector<std::unique_ptr<RTNLMessage>> messages;
   for (auto& table : tables_) {
     for (auto nent = table.second.begin(); nent != table.second.end();) {
       if (nent->table == table_id) {
-        RemoveRouteFromKernelTable(table.first, *nent);
+        messages.push_back(CreateRouteMessage(table.first, *nent,
+                                              RTNLMessage::kModeDelete, 0));
         nent = table.second.erase(nent);
       } else {
         ++nent;
       }
     }
   }
+  rtnl_handler_->SendMessages(std::move(messages));
   return table_id;
 }
 
@@ -6,9 +6,12 @@
 #define SHILL_ROUTING_TABLE_H_
 
 #include <deque>
+#include <list>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
@@ -16,6 +19,7 @@
 #include <base/lazy_instance.h>
 #include <base/memory/ref_counted.h>
 
+#include "shill/net/byte_string.h"
 #include "shill/net/ip_address.h"
 #include "shill/net/rtnl_message.h"
 #include "shill/refptr_types.h"
@@ -69,8 +73,18 @@ class RoutingTable {
   // Remove an entry from the routing table.
   virtual bool RemoveRoute(int interface_index, const RoutingTableEntry& entry);
 
+  // Add entries to the routing table. The entries are sent to the kernel at
+  // once, which is much faster than adding them one by one when there are many
+  // of them (e.g. split-tunnel VPN routes). Returns false if any of them
+  // couldn't be added.
+  virtual bool AddRoutes(int interface_index,
+                         const std::vector<RoutingTableEntry>& entries);
+
   // Add an entry to the routing rule table.
   virtual bool AddRule(int interface_index, const RoutingPolicyEntry& entry);
+  // Add entries to the routing rule table, sending them to the kernel at once.
+  virtual bool AddRules(int interface_index,
+                        const std::vector<RoutingPolicyEntry>& entries);
 
   // Get the default route associated with an interface of a given addr family.
   // The route is copied into |*entry|.
@@ -151,10 +165,54 @@ class RoutingTable {
 
  private:
   friend base::LazyInstanceTraitsBase<RoutingTable>;
+  friend class RoutingTableBenchmark;
   friend class RoutingTableTest;
 
-  using RouteTableEntryVector = std::vector<RoutingTableEntry>;
-  using RouteTables = std::unordered_map<int, RouteTableEntryVector>;
+  // Routes of an interface, in the order they were added, indexed by their
+  // destination prefix and table so that finding a route doesn't require
+  // going through all the routes of the interface.
+  class InterfaceRoutes {
+   public:
+    using iterator = std::list<RoutingTableEntry>::iterator;
+    using const_iterator = std::list<RoutingTableEntry>::const_iterator;
+
+    InterfaceRoutes();
+    // |index_| refers to the elements of |entries_|.
+    InterfaceRoutes(const InterfaceRoutes&) = delete;
+    InterfaceRoutes& operator=(const InterfaceRoutes&) = delete;
+    ~InterfaceRoutes();
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    iterator begin() { return entries_.begin(); }
+    iterator end() { return entries_.end(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+
+    void push_back(const RoutingTableEntry& entry);
+    iterator erase(iterator it);
+    void clear();
+
+    // Moves the entry at |it| to |table|.
+    void SetTable(iterator it, uint32_t table);
+
+    // Returns the entries whose destination is |dst|, including its prefix,
+    // in any table.
+    std::vector<iterator> Find(const IPAddress& dst);
+
+   private:
+    // Family, address, prefix and table of the destination. Zero addresses
+    // are all represented by an empty address.
+    using Key =
+        std::tuple<IPAddress::Family, ByteString, unsigned int, uint32_t>;
+
+    static Key GetKey(const IPAddress& dst, uint32_t table);
+
+    std::list<RoutingTableEntry> entries_;
+    std::multimap<Key, iterator> index_;
+  };
+
+  using RouteTables = std::unordered_map<int, InterfaceRoutes>;
   using PolicyTableEntryVector = std::vector<RoutingPolicyEntry>;
   using PolicyTables = std::unordered_map<int, PolicyTableEntryVector>;
 
@@ -184,11 +242,20 @@ class RoutingTable {
   bool RemoveRouteFromKernelTable(int interface_index,
                                   const RoutingTableEntry& entry);
 
+  // Returns whether |entry| can be added to the routing table of
+  // |interface_index|.
+  bool IsValidRoute(int interface_index, const RoutingTableEntry& entry);
+
   void RouteMsgHandler(const RTNLMessage& msg);
   bool ApplyRoute(uint32_t interface_index,
                   const RoutingTableEntry& entry,
                   RTNLMessage::Mode mode,
                   unsigned int flags);
+  std::unique_ptr<RTNLMessage> CreateRouteMessage(
+      uint32_t interface_index,
+      const RoutingTableEntry& entry,
+      RTNLMessage::Mode mode,
+      unsigned int flags);
   // Get the default route associated with an interface of a given addr family.
   // A pointer to the route is placed in |*entry|.
   virtual bool GetDefaultRouteInternal(int interface_index,
@@ -203,6 +270,11 @@ class RoutingTable {
                  const RoutingPolicyEntry& entry,
                  RTNLMessage::Mode mode,
                  unsigned int flags);
+  std::unique_ptr<RTNLMessage> CreateRuleMessage(
+      uint32_t interface_index,
+      const RoutingPolicyEntry& entry,
+      RTNLMessage::Mode mode,
+      unsigned int flags);
   bool ParseRoutingPolicyMessage(const RTNLMessage& message,
                                  RoutingPolicyEntry* entry);
   bool HandleRoutingPolicyMessage(const RTNLMessage& message);
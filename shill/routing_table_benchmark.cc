@@ -0,0 +1,204 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <linux/rtnetlink.h>
+
+#include <memory>
+#include <vector>
+
+#include <base/check.h>
+#include <base/strings/stringprintf.h>
+#include <benchmark/benchmark.h>
+
+#include "shill/net/ip_address.h"
+#include "shill/net/rtnl_handler.h"
+#include "shill/net/rtnl_message.h"
+#include "shill/routing_table.h"
+#include "shill/routing_table_entry.h"
+
+namespace shill {
+namespace {
+
+constexpr int kInterfaceIndex = 3;
+constexpr uint32_t kTableId = 1003;
+// Number of routes pushed by a large split-tunnel VPN configuration.
+constexpr int kNumRoutes = 5000;
+
+// RTNLHandler encoding messages without writing them to a socket, and
+// counting the number of send requests it receives.
+class FakeRTNLHandler : public RTNLHandler {
+ public:
+  FakeRTNLHandler() = default;
+  FakeRTNLHandler(const FakeRTNLHandler&) = delete;
+  FakeRTNLHandler& operator=(const FakeRTNLHandler&) = delete;
+
+  bool SendMessage(std::unique_ptr<RTNLMessage> message,
+                   uint32_t* seq) override {
+    message->set_seq(++seq_);
+    CHECK(!message->Encode().IsEmpty());
+    sends_++;
+    if (seq) {
+      *seq = seq_;
+    }
+    return true;
+  }
+
+  size_t SendMessages(
+      std::vector<std::unique_ptr<RTNLMessage>> messages) override {
+    for (auto& message : messages) {
+      message->set_seq(++seq_);
+      CHECK(!message->Encode().IsEmpty());
+    }
+    sends_++;
+    return messages.size();
+  }
+
+  int64_t sends() const { return sends_; }
+  void reset_sends() { sends_ = 0; }
+
+ private:
+  uint32_t seq_ = 0;
+  int64_t sends_ = 0;
+};
+
+std::vector<RoutingTableEntry> CreateVpnRoutes() {
+  std::vector<RoutingTableEntry> entries;
+  for (int i = 0; i < kNumRoutes; i++) {
+    IPAddress dst(IPAddress::kFamilyIPv4);
+    CHECK(dst.SetAddressFromString(
+        base::StringPrintf("10.%d.%d.0", (i >> 8) & 0xff, i & 0xff)));
+    dst.set_prefix(24);
+    entries.push_back(RoutingTableEntry::Create(
+                          dst, IPAddress(IPAddress::kFamilyIPv4),
+                          IPAddress(IPAddress::kFamilyIPv4))
+                          .SetTable(kTableId));
+  }
+  return entries;
+}
+
+// Returns the notification sent by the kernel when |entry| is added to or
+// removed from the routing tables.
+std::unique_ptr<RTNLMessage> CreateRouteNotification(
+    RTNLMessage::Mode mode, const RoutingTableEntry& entry) {
+  auto msg = std::make_unique<RTNLMessage>(RTNLMessage::kTypeRoute, mode, 0, 0,
+                                           0, 0, entry.dst.family());
+  msg->set_route_status(RTNLMessage::RouteStatus(
+      entry.dst.prefix(), entry.src.prefix(), RT_TABLE_COMPAT, RTPROT_BOOT,
+      entry.scope, RTN_UNICAST, 0));
+  msg->SetAttribute(RTA_DST, entry.dst.address());
+  msg->SetAttribute(RTA_TABLE, ByteString::CreateFromCPUUInt32(entry.table));
+  msg->SetAttribute(RTA_PRIORITY,
+                    ByteString::CreateFromCPUUInt32(entry.metric));
+  msg->SetAttribute(RTA_OIF, ByteString::CreateFromCPUUInt32(kInterfaceIndex));
+  return msg;
+}
+
+}  // namespace
+
+class RoutingTableBenchmark : public benchmark::Fixture {
+ public:
+  void SetUp(const benchmark::State& state) override {
+    routing_table_.reset(new RoutingTable());
+    routing_table_->rtnl_handler_ = &rtnl_handler_;
+    entries_ = CreateVpnRoutes();
+  }
+
+  void TearDown(const benchmark::State& state) override {
+    routing_table_.reset();
+  }
+
+ protected:
+  void HandleRouteMessage(const RTNLMessage& msg) {
+    routing_table_->RouteMsgHandler(msg);
+  }
+
+  size_t GetNumRoutes() const {
+    const auto it = routing_table_->tables_.find(kInterfaceIndex);
+    return it == routing_table_->tables_.end() ? 0 : it->second.size();
+  }
+
+  FakeRTNLHandler rtnl_handler_;
+  std::unique_ptr<RoutingTable> routing_table_;
+  std::vector<RoutingTableEntry> entries_;
+};
+
+// Measures installing the routes of a VPN one at a time, which costs one
+// send request, and one write to the RTNL socket, per route.
+BENCHMARK_DEFINE_F(RoutingTableBenchmark, AddRouteOneByOne)
+(benchmark::State& state) {
+  int64_t sends = 0;
+  for (auto _ : state) {
+    rtnl_handler_.reset_sends();
+    for (const auto& entry : entries_) {
+      CHECK(routing_table_->AddRoute(kInterfaceIndex, entry));
+    }
+    sends = rtnl_handler_.sends();
+
+    state.PauseTiming();
+    routing_table_->FlushRoutes(kInterfaceIndex);
+    state.ResumeTiming();
+  }
+  state.counters["netlink_sends"] = sends;
+}
+BENCHMARK_REGISTER_F(RoutingTableBenchmark, AddRouteOneByOne)
+    ->Unit(benchmark::kMillisecond);
+
+// Measures installing the routes of a VPN with AddRoutes().
+BENCHMARK_DEFINE_F(RoutingTableBenchmark, AddRoutes)
+(benchmark::State& state) {
+  int64_t sends = 0;
+  for (auto _ : state) {
+    rtnl_handler_.reset_sends();
+    CHECK(routing_table_->AddRoutes(kInterfaceIndex, entries_));
+    sends = rtnl_handler_.sends();
+
+    state.PauseTiming();
+    routing_table_->FlushRoutes(kInterfaceIndex);
+    state.ResumeTiming();
+  }
+  state.counters["netlink_sends"] = sends;
+}
+BENCHMARK_REGISTER_F(RoutingTableBenchmark, AddRoutes)
+    ->Unit(benchmark::kMillisecond);
+
+// Measures removing all the routes of a VPN when it disconnects.
+BENCHMARK_DEFINE_F(RoutingTableBenchmark, FlushRoutes)
+(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    CHECK(routing_table_->AddRoutes(kInterfaceIndex, entries_));
+    state.ResumeTiming();
+
+    routing_table_->FlushRoutes(kInterfaceIndex);
+  }
+}
+BENCHMARK_REGISTER_F(RoutingTableBenchmark, FlushRoutes)
+    ->Unit(benchmark::kMillisecond);
+
+// Measures handling the kernel notifications sent when the routes of a VPN
+// are removed behind shill's back, e.g. when the interface goes down.
+BENCHMARK_DEFINE_F(RoutingTableBenchmark, RouteDeletedNotifications)
+(benchmark::State& state) {
+  std::vector<std::unique_ptr<RTNLMessage>> notifications;
+  for (const auto& entry : entries_) {
+    notifications.push_back(
+        CreateRouteNotification(RTNLMessage::kModeDelete, entry));
+  }
+  for (auto _ : state) {
+    state.PauseTiming();
+    CHECK(routing_table_->AddRoutes(kInterfaceIndex, entries_));
+    state.ResumeTiming();
+
+    for (const auto& msg : notifications) {
+      HandleRouteMessage(*msg);
+    }
+    CHECK_EQ(GetNumRoutes(), 0u);
+  }
+}
+BENCHMARK_REGISTER_F(RoutingTableBenchmark, RouteDeletedNotifications)
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace shill
+
+BENCHMARK_MAIN();
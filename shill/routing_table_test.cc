@@ -8,14 +8,17 @@
 #include <sys/socket.h>
 
 #include <deque>
+#include <iterator>
 #include <memory>
 #include <vector>
 
 #include <base/bind.h>
 #include <base/callback.h>
 #include <base/check.h>
+#include <base/check_op.h>
 #include <base/containers/contains.h>
 #include <base/memory/weak_ptr.h>
+#include <base/strings/stringprintf.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -29,6 +32,7 @@
 using testing::_;
 using testing::Field;
 using testing::Invoke;
+using testing::Property;
 using testing::Return;
 using testing::StrictMock;
 using testing::Test;
@@ -47,10 +51,17 @@ class RoutingTableTest : public Test {
 
   void TearDown() override { RTNLHandler::GetInstance()->Stop(); }
 
-  std::unordered_map<int, std::vector<RoutingTableEntry>>* GetRoutingTables() {
+  RoutingTable::RouteTables* GetRoutingTables() {
     return &routing_table_->tables_;
   }
 
+  // Returns the |i|-th route added to the table of |interface_index|.
+  RoutingTableEntry GetRoute(int interface_index, size_t i) {
+    const auto& table = routing_table_->tables_[interface_index];
+    CHECK_LT(i, table.size());
+    return *std::next(table.begin(), i);
+  }
+
   std::deque<RoutingTable::Query>* GetQueries() {
     return &routing_table_->route_queries_;
   }
@@ -267,15 +278,14 @@ TEST_F(RoutingTableTest, RouteAddDelete) {
           .SetTable(RoutingTable::GetInterfaceTableId(kTestDeviceIndex0));
   SendRouteEntry(RTNLMessage::kModeAdd, kTestDeviceIndex0, entry0);
 
-  std::unordered_map<int, std::vector<RoutingTableEntry>>* tables =
-      GetRoutingTables();
+  auto* tables = GetRoutingTables();
 
   // We should have a single table, which should in turn have a single entry.
   EXPECT_EQ(1, tables->size());
   EXPECT_TRUE(base::Contains(*tables, kTestDeviceIndex0));
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex0].size());
 
-  RoutingTableEntry test_entry = (*tables)[kTestDeviceIndex0][0];
+  RoutingTableEntry test_entry = GetRoute(kTestDeviceIndex0, 0);
   EXPECT_EQ(entry0, test_entry);
 
   // Add a second entry for a different interface.
@@ -292,7 +302,7 @@ TEST_F(RoutingTableTest, RouteAddDelete) {
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex0].size());
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex1].size());
 
-  test_entry = (*tables)[kTestDeviceIndex1][0];
+  test_entry = GetRoute(kTestDeviceIndex1, 0);
   EXPECT_EQ(entry1, test_entry);
 
   IPAddress gateway_address1(IPAddress::kFamilyIPv4);
@@ -313,7 +323,7 @@ TEST_F(RoutingTableTest, RouteAddDelete) {
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex0].size());
   EXPECT_EQ(2, (*tables)[kTestDeviceIndex1].size());
 
-  test_entry = (*tables)[kTestDeviceIndex1][1];
+  test_entry = GetRoute(kTestDeviceIndex1, 1);
   EXPECT_EQ(entry2, test_entry);
 
   // Remove the first gateway route from the second interface.
@@ -324,7 +334,7 @@ TEST_F(RoutingTableTest, RouteAddDelete) {
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex0].size());
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex1].size());
 
-  test_entry = (*tables)[kTestDeviceIndex1][0];
+  test_entry = GetRoute(kTestDeviceIndex1, 0);
   EXPECT_EQ(entry2, test_entry);
 
   // Send a duplicate of the second gateway route message, changing the metric.
@@ -334,9 +344,9 @@ TEST_F(RoutingTableTest, RouteAddDelete) {
 
   // Both entries should show up.
   EXPECT_EQ(2, (*tables)[kTestDeviceIndex1].size());
-  test_entry = (*tables)[kTestDeviceIndex1][0];
+  test_entry = GetRoute(kTestDeviceIndex1, 0);
   EXPECT_EQ(entry2, test_entry);
-  test_entry = (*tables)[kTestDeviceIndex1][1];
+  test_entry = GetRoute(kTestDeviceIndex1, 1);
   EXPECT_EQ(entry3, test_entry);
 
   // Find a matching entry.
@@ -485,6 +495,98 @@ TEST_F(RoutingTableTest, PolicyRuleAddFlush) {
   routing_table_->FreeAdditionalTableId(table0);
 }
 
+// Returns |count| routes to distinct /32 destinations through
+// |interface_index|.
+std::vector<RoutingTableEntry> CreateHostRoutes(uint32_t interface_index,
+                                                int count) {
+  std::vector<RoutingTableEntry> entries;
+  IPAddress src(IPAddress::kFamilyIPv4);
+  src.SetAddressToDefault();
+  for (int i = 0; i < count; i++) {
+    IPAddress dst(IPAddress::kFamilyIPv4);
+    CHECK(dst.SetAddressFromString(
+        base::StringPrintf("10.%d.%d.1", i / 256, i % 256)));
+    dst.set_prefix(32);
+    entries.push_back(
+        RoutingTableEntry::Create(dst, src, src)
+            .SetTable(RoutingTable::GetInterfaceTableId(interface_index)));
+  }
+  return entries;
+}
+
+TEST_F(RoutingTableTest, AddRoutes) {
+  const auto entries = CreateHostRoutes(kTestDeviceIndex0, 100);
+  EXPECT_CALL(rtnl_handler_,
+              DoSendMessage(Property(&RTNLMessage::mode, RTNLMessage::kModeAdd),
+                            nullptr))
+      .Times(100)
+      .WillRepeatedly(Return(true));
+  EXPECT_TRUE(routing_table_->AddRoutes(kTestDeviceIndex0, entries));
+  EXPECT_EQ(100, (*GetRoutingTables())[kTestDeviceIndex0].size());
+  EXPECT_EQ(entries[42], GetRoute(kTestDeviceIndex0, 42));
+
+  // Routes are still found through the index once removed by the kernel.
+  SendRouteEntry(RTNLMessage::kModeDelete, kTestDeviceIndex0, entries[42]);
+  EXPECT_EQ(99, (*GetRoutingTables())[kTestDeviceIndex0].size());
+  EXPECT_EQ(entries[43], GetRoute(kTestDeviceIndex0, 42));
+
+  EXPECT_CALL(rtnl_handler_, DoSendMessage(_, _)).WillOnce(Return(true));
+  EXPECT_TRUE(routing_table_->RemoveRoute(kTestDeviceIndex0, entries[0]));
+  EXPECT_EQ(98, (*GetRoutingTables())[kTestDeviceIndex0].size());
+
+  EXPECT_CALL(rtnl_handler_,
+              DoSendMessage(
+                  Property(&RTNLMessage::mode, RTNLMessage::kModeDelete), _))
+      .Times(98)
+      .WillRepeatedly(Return(true));
+  routing_table_->FlushRoutes(kTestDeviceIndex0);
+  EXPECT_EQ(0, (*GetRoutingTables())[kTestDeviceIndex0].size());
+}
+
+TEST_F(RoutingTableTest, AddRoutesPartialFailure) {
+  const auto entries = CreateHostRoutes(kTestDeviceIndex0, 3);
+  EXPECT_CALL(rtnl_handler_, DoSendMessage(_, _))
+      .WillOnce(Return(true))
+      .WillOnce(Return(false));
+  EXPECT_FALSE(routing_table_->AddRoutes(kTestDeviceIndex0, entries));
+
+  // Only the route which was sent is tracked.
+  EXPECT_EQ(1, (*GetRoutingTables())[kTestDeviceIndex0].size());
+  EXPECT_EQ(entries[0], GetRoute(kTestDeviceIndex0, 0));
+}
+
+TEST_F(RoutingTableTest, AddRoutesWrongTable) {
+  auto entries = CreateHostRoutes(kTestDeviceIndex0, 3);
+  entries[1].table = RT_TABLE_MAIN;
+  EXPECT_CALL(rtnl_handler_, DoSendMessage(_, _)).WillOnce(Return(true));
+  EXPECT_FALSE(routing_table_->AddRoutes(kTestDeviceIndex0, entries));
+  EXPECT_EQ(1, (*GetRoutingTables())[kTestDeviceIndex0].size());
+}
+
+TEST_F(RoutingTableTest, AddRules) {
+  Start();
+  uint32_t table = routing_table_->RequestAdditionalTableId();
+  std::vector<RoutingPolicyEntry> entries;
+  for (int priority = 100; priority < 110; priority++) {
+    entries.push_back(RoutingPolicyEntry::Create(IPAddress::kFamilyIPv4)
+                          .SetPriority(priority)
+                          .SetTable(table));
+  }
+
+  EXPECT_CALL(rtnl_handler_, DoSendMessage(_, _))
+      .Times(10)
+      .WillRepeatedly(Return(true));
+  EXPECT_TRUE(routing_table_->AddRules(kTestDeviceIndex0, entries));
+  EXPECT_EQ(CountRoutingPolicyEntries(), 10);
+
+  EXPECT_CALL(rtnl_handler_, DoSendMessage(_, _))
+      .Times(10)
+      .WillRepeatedly(Return(true));
+  routing_table_->FlushRules(kTestDeviceIndex0);
+  EXPECT_EQ(CountRoutingPolicyEntries(), 0);
+  routing_table_->FreeAdditionalTableId(table);
+}
+
 TEST_F(RoutingTableTest, LowestMetricDefault) {
   // Expect the tables to be empty by default.
   EXPECT_EQ(0, GetRoutingTables()->size());
@@ -540,15 +642,14 @@ TEST_F(RoutingTableTest, IPv6StatelessAutoconfiguration) {
   SendRouteEntryWithSeqAndProto(RTNLMessage::kModeAdd, kTestDeviceIndex0,
                                 entry0, 0 /* seq */, RTPROT_RA);
 
-  std::unordered_map<int, std::vector<RoutingTableEntry>>* tables =
-      GetRoutingTables();
+  auto* tables = GetRoutingTables();
 
   // We should have a single table, which should in turn have a single entry.
   EXPECT_EQ(1, tables->size());
   EXPECT_TRUE(base::Contains(*tables, kTestDeviceIndex0));
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex0].size());
 
-  RoutingTableEntry test_entry = (*tables)[kTestDeviceIndex0][0];
+  RoutingTableEntry test_entry = GetRoute(kTestDeviceIndex0, 0);
   EXPECT_EQ(entry0, test_entry);
 
   // Now send an RTPROT_RA netlink message advertising some other random
@@ -627,8 +728,7 @@ TEST_F(RoutingTableTest, RequestHostRoute) {
   SendRouteEntryWithSeqAndProto(RTNLMessage::kModeAdd, kTestDeviceIndex0, entry,
                                 kTestRequestSeq, RTPROT_UNSPEC);
 
-  std::unordered_map<int, std::vector<RoutingTableEntry>>* tables =
-      GetRoutingTables();
+  auto* tables = GetRoutingTables();
 
   // We should have a single table, which should in turn have a single entry.
   EXPECT_EQ(1, tables->size());
@@ -636,7 +736,7 @@ TEST_F(RoutingTableTest, RequestHostRoute) {
   EXPECT_EQ(1, (*tables)[kTestDeviceIndex0].size());
 
   // This entry's tag should match the tag we requested.
-  EXPECT_EQ(kTestRouteTag, (*tables)[kTestDeviceIndex0][0].tag);
+  EXPECT_EQ(kTestRouteTag, GetRoute(kTestDeviceIndex0, 0).tag);
 
   EXPECT_TRUE(GetQueries()->empty());
 
@@ -0,0 +1,185 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "smbfs/buffered_file.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include <base/check.h>
+#include <base/logging.h>
+#include <base/posix/safe_strerror.h>
+
+namespace smbfs {
+
+BufferedFile::BufferedFile(SambaInterface* samba_impl, SMBCFILE* file)
+    : samba_impl_(samba_impl), file_(file) {
+  DCHECK(samba_impl_);
+  DCHECK(file_);
+}
+
+BufferedFile::~BufferedFile() = default;
+
+int BufferedFile::Read(off_t offset, size_t size, std::vector<char>* buf) {
+  DCHECK(buf);
+
+  // The write-behind buffer may overlap the requested range.
+  WriteBack();
+
+  const off_t read_ahead_end = read_ahead_offset_ + read_ahead_buf_.size();
+  if (offset >= read_ahead_offset_ && offset < read_ahead_end &&
+      (offset + static_cast<off_t>(size) <= read_ahead_end ||
+       read_ahead_eof_)) {
+    const auto begin = read_ahead_buf_.begin() + (offset - read_ahead_offset_);
+    const auto end = begin + std::min<off_t>(size, read_ahead_end - offset);
+    buf->assign(begin, end);
+    next_read_offset_ = offset + buf->size();
+    return 0;
+  }
+
+  if (offset != next_read_offset_) {
+    read_ahead_size_ = 0;
+    int error = ReadFromServer(offset, size, buf);
+    if (error) {
+      return error;
+    }
+    next_read_offset_ = offset + buf->size();
+    return 0;
+  }
+
+  read_ahead_size_ = std::clamp(read_ahead_size_ * 2, kMinReadAheadSize,
+                                kMaxReadAheadSize);
+  const size_t read_size = std::max(size, read_ahead_size_);
+  int error = ReadFromServer(offset, read_size, &read_ahead_buf_);
+  if (error) {
+    InvalidateReadAhead();
+    return error;
+  }
+  read_ahead_offset_ = offset;
+  read_ahead_eof_ = read_ahead_buf_.size() < read_size;
+
+  buf->assign(read_ahead_buf_.begin(),
+              read_ahead_buf_.begin() + std::min(size, read_ahead_buf_.size()));
+  next_read_offset_ = offset + buf->size();
+  return 0;
+}
+
+int BufferedFile::Write(off_t offset, const char* buf, size_t size) {
+  DCHECK(buf);
+
+  InvalidateReadAhead();
+
+  const off_t write_behind_end =
+      write_behind_offset_ + write_behind_buf_.size();
+  if (!write_behind_buf_.empty() &&
+      (offset != write_behind_end ||
+       write_behind_buf_.size() + size > kMaxWriteBehindSize)) {
+    WriteBack();
+  }
+  int error = TakeWriteBackError();
+  if (error) {
+    return error;
+  }
+
+  if (write_behind_buf_.empty()) {
+    if (size >= kMaxWriteBehindSize) {
+      return WriteToServer(offset, buf, size);
+    }
+    write_behind_offset_ = offset;
+  }
+  write_behind_buf_.insert(write_behind_buf_.end(), buf, buf + size);
+  return 0;
+}
+
+int BufferedFile::Flush() {
+  WriteBack();
+  // Release the memory of the buffer, which is kept between write backs.
+  write_behind_buf_.shrink_to_fit();
+  return TakeWriteBackError();
+}
+
+bool BufferedFile::WriteBack() {
+  if (write_behind_buf_.empty()) {
+    return false;
+  }
+
+  int error = WriteToServer(write_behind_offset_, write_behind_buf_.data(),
+                            write_behind_buf_.size());
+  if (error) {
+    LOG(ERROR) << "Failed to write back " << write_behind_buf_.size()
+               << " bytes at offset " << write_behind_offset_ << ": "
+               << base::safe_strerror(error);
+    // Only the first error is kept, the data is dropped in any case.
+    if (!write_back_error_) {
+      write_back_error_ = error;
+    }
+  }
+  write_behind_buf_.clear();
+  return true;
+}
+
+void BufferedFile::InvalidateReadAhead() {
+  read_ahead_buf_.clear();
+  read_ahead_eof_ = false;
+}
+
+int BufferedFile::TakeWriteBackError() {
+  int error = write_back_error_;
+  write_back_error_ = 0;
+  return error;
+}
+
+int BufferedFile::ReadFromServer(off_t offset,
+                                 size_t size,
+                                 std::vector<char>* buf) {
+  int error = samba_impl_->SeekFile(file_, offset, SEEK_SET);
+  if (error) {
+    VLOG(1) << "SeekFile offset: " << offset
+            << " failed: " << base::safe_strerror(error);
+    return error;
+  }
+
+  buf->resize(size);
+  size_t bytes_read = 0;
+  error = samba_impl_->ReadFile(file_, buf->data(), size, &bytes_read);
+  if (error) {
+    VLOG(1) << "ReadFile offset: " << offset << ", size: " << size
+            << " failed: " << base::safe_strerror(error);
+    buf->clear();
+    return error;
+  }
+  buf->resize(bytes_read);
+  return 0;
+}
+
+int BufferedFile::WriteToServer(off_t offset, const char* buf, size_t size) {
+  int error = samba_impl_->SeekFile(file_, offset, SEEK_SET);
+  if (error) {
+    VLOG(1) << "SeekFile offset: " << offset
+            << " failed: " << base::safe_strerror(error);
+    return error;
+  }
+
+  size_t total_written = 0;
+  while (total_written < size) {
+    size_t bytes_written = 0;
+    error = samba_impl_->WriteFile(file_, buf + total_written,
+                                   size - total_written, &bytes_written);
+    if (error) {
+      VLOG(1) << "WriteFile offset: " << offset + total_written
+              << ", size: " << size - total_written
+              << " failed: " << base::safe_strerror(error);
+      return error;
+    }
+    if (!bytes_written) {
+      return EIO;
+    }
+    total_written += bytes_written;
+  }
+  return 0;
+}
+
+}  // namespace smbfs
@@ -0,0 +1,101 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SMBFS_BUFFERED_FILE_H_
+#define SMBFS_BUFFERED_FILE_H_
+
+#include <libsmbclient.h>
+#include <sys/types.h>
+
+#include <vector>
+
+#include "smbfs/samba_interface.h"
+
+namespace smbfs {
+
+// BufferedFile wraps an open SMB file to reduce the number of round trips to
+// the server done by sequential reads and writes, which FUSE splits into
+// requests of at most 128 KiB.
+//
+// Reads: once two reads are found to be contiguous, the file is read ahead in
+// a single request whose size doubles on every refill, from
+// |kMinReadAheadSize| up to |kMaxReadAheadSize|. Following reads are served
+// from the read-ahead buffer. libsmbclient pipelines the SMB2 requests of a
+// large read, so this also keeps several requests in flight.
+//
+// Writes: contiguous writes are coalesced into a write-behind buffer of up to
+// |kMaxWriteBehindSize| bytes, which is written back to the server when it is
+// full, when a non-contiguous write or a read happens, and on Flush(). An
+// error writing back data which was not flushed by the write request itself is
+// reported by the next Write() or Flush(), in the same way NFS reports write
+// back errors on close().
+//
+// This class is not thread-safe and must only be used on the thread which
+// |samba_impl| is used on.
+class BufferedFile {
+ public:
+  static constexpr size_t kMinReadAheadSize = 256 * 1024;
+  static constexpr size_t kMaxReadAheadSize = 4 * 1024 * 1024;
+  static constexpr size_t kMaxWriteBehindSize = 4 * 1024 * 1024;
+
+  // |samba_impl| must outlive this object. |file| is not owned.
+  BufferedFile(SambaInterface* samba_impl, SMBCFILE* file);
+  BufferedFile(const BufferedFile&) = delete;
+  BufferedFile& operator=(const BufferedFile&) = delete;
+  ~BufferedFile();
+
+  SMBCFILE* file() const { return file_; }
+
+  // Reads up to |size| bytes at |offset| into |buf|, which is resized to the
+  // number of bytes read. Returns 0 on success, and an errno value otherwise.
+  int Read(off_t offset, size_t size, std::vector<char>* buf);
+
+  // Writes |size| bytes of |buf| at |offset|, possibly in the write-behind
+  // buffer. Returns 0 on success, and an errno value otherwise.
+  int Write(off_t offset, const char* buf, size_t size);
+
+  // Writes back buffered data to the server. Returns 0 on success, or the
+  // error of this or of any earlier deferred write back.
+  int Flush();
+
+  // Writes back buffered data to the server, on behalf of an operation which
+  // needs the server to be up to date (e.g. a stat() or truncate()). Errors
+  // are deferred to the next Write() or Flush(). Returns true if there was
+  // data to write back.
+  bool WriteBack();
+
+  // Drops the read-ahead buffer, e.g. after the file was modified through
+  // another file handle.
+  void InvalidateReadAhead();
+
+ private:
+  // Returns and clears |write_back_error_|.
+  int TakeWriteBackError();
+
+  // Reads or writes |size| bytes at |offset| with the server.
+  int ReadFromServer(off_t offset, size_t size, std::vector<char>* buf);
+  int WriteToServer(off_t offset, const char* buf, size_t size);
+
+  SambaInterface* const samba_impl_;
+  SMBCFILE* const file_;
+
+  // Offset following the last read, used to detect sequential reads.
+  off_t next_read_offset_ = -1;
+  // Size of the last read-ahead, 0 if the last read was not sequential.
+  size_t read_ahead_size_ = 0;
+  // Data read ahead at |read_ahead_offset_|. |read_ahead_eof_| is true if the
+  // end of the file was reached while reading ahead.
+  off_t read_ahead_offset_ = 0;
+  std::vector<char> read_ahead_buf_;
+  bool read_ahead_eof_ = false;
+
+  // Data written at |write_behind_offset_| and not yet sent to the server.
+  off_t write_behind_offset_ = 0;
+  std::vector<char> write_behind_buf_;
+  int write_back_error_ = 0;
+};
+
+}  // namespace smbfs
+
+#endif  // SMBFS_BUFFERED_FILE_H_
@@ -0,0 +1,171 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <base/check.h>
+#include <base/threading/platform_thread.h>
+#include <base/time/time.h>
+#include <benchmark/benchmark.h>
+
+#include "smbfs/buffered_file.h"
+#include "smbfs/samba_interface_impl.h"
+
+namespace smbfs {
+namespace {
+
+// Size of the reads and writes done by FUSE.
+constexpr size_t kFuseRequestSize = 128 * 1024;
+constexpr size_t kFileSize = 32 * 1024 * 1024;
+
+// Round trip time and throughput of a Samba server on a gigabit local network.
+constexpr base::TimeDelta kRoundTripTime = base::Milliseconds(1);
+constexpr int64_t kBytesPerSecond = 1000 * 1000 * 1000 / 8;
+
+// SambaInterface standing in for a Samba server serving a single file: every
+// read or write request sleeps for a round trip plus the transfer time of the
+// data.
+class FakeSambaServer : public SambaInterfaceImpl {
+ public:
+  FakeSambaServer() : content_(kFileSize, 'a') {}
+
+  int SeekFile(SMBCFILE* file, off_t offset, int whence) override {
+    position_ = offset;
+    return 0;
+  }
+
+  int ReadFile(SMBCFILE* file,
+               void* buf,
+               size_t count,
+               size_t* out_bytes_read) override {
+    const size_t start = std::min<size_t>(position_, content_.size());
+    *out_bytes_read = std::min(count, content_.size() - start);
+    content_.copy(static_cast<char*>(buf), *out_bytes_read, start);
+    position_ += *out_bytes_read;
+    Transfer(*out_bytes_read);
+    return 0;
+  }
+
+  int WriteFile(SMBCFILE* file,
+                const void* buf,
+                size_t count,
+                size_t* out_bytes_written) override {
+    CHECK_LE(position_ + count, content_.size());
+    content_.replace(position_, count, static_cast<const char*>(buf), count);
+    position_ += count;
+    *out_bytes_written = count;
+    Transfer(count);
+    return 0;
+  }
+
+  int requests() const { return requests_; }
+  void reset_requests() { requests_ = 0; }
+
+ private:
+  void Transfer(size_t size) {
+    requests_++;
+    base::PlatformThread::Sleep(kRoundTripTime +
+                                base::Seconds(1) * size / kBytesPerSecond);
+  }
+
+  std::string content_;
+  size_t position_ = 0;
+  int requests_ = 0;
+};
+
+SMBCFILE* GetFile() {
+  static int file;
+  return reinterpret_cast<SMBCFILE*>(&file);
+}
+
+}  // namespace
+
+// Measures copying a file out of the share with one request per FUSE read,
+// as done before BufferedFile.
+static void BM_SequentialReadUnbuffered(benchmark::State& state) {
+  FakeSambaServer server;
+  std::vector<char> buf(kFuseRequestSize);
+  for (auto _ : state) {
+    server.reset_requests();
+    for (size_t offset = 0; offset < kFileSize; offset += kFuseRequestSize) {
+      size_t bytes_read;
+      CHECK_EQ(server.SeekFile(GetFile(), offset, SEEK_SET), 0);
+      CHECK_EQ(server.ReadFile(GetFile(), buf.data(), buf.size(), &bytes_read),
+               0);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kFileSize);
+  state.counters["server_requests"] = server.requests();
+}
+BENCHMARK(BM_SequentialReadUnbuffered)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Measures copying a file out of the share with read-ahead.
+static void BM_SequentialReadBuffered(benchmark::State& state) {
+  FakeSambaServer server;
+  std::vector<char> buf;
+  for (auto _ : state) {
+    server.reset_requests();
+    BufferedFile file(&server, GetFile());
+    for (size_t offset = 0; offset < kFileSize; offset += kFuseRequestSize) {
+      CHECK_EQ(file.Read(offset, kFuseRequestSize, &buf), 0);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kFileSize);
+  state.counters["server_requests"] = server.requests();
+}
+BENCHMARK(BM_SequentialReadBuffered)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Measures copying a file to the share with one request per FUSE write, as
+// done before BufferedFile.
+static void BM_SequentialWriteUnbuffered(benchmark::State& state) {
+  FakeSambaServer server;
+  const std::vector<char> buf(kFuseRequestSize, 'b');
+  for (auto _ : state) {
+    server.reset_requests();
+    for (size_t offset = 0; offset < kFileSize; offset += kFuseRequestSize) {
+      size_t bytes_written;
+      CHECK_EQ(server.SeekFile(GetFile(), offset, SEEK_SET), 0);
+      CHECK_EQ(
+          server.WriteFile(GetFile(), buf.data(), buf.size(), &bytes_written),
+          0);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kFileSize);
+  state.counters["server_requests"] = server.requests();
+}
+BENCHMARK(BM_SequentialWriteUnbuffered)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+// Measures copying a file to the share with write-behind, including the
+// flush done when the file is closed.
+static void BM_SequentialWriteBuffered(benchmark::State& state) {
+  FakeSambaServer server;
+  const std::vector<char> buf(kFuseRequestSize, 'b');
+  for (auto _ : state) {
+    server.reset_requests();
+    BufferedFile file(&server, GetFile());
+    for (size_t offset = 0; offset < kFileSize; offset += kFuseRequestSize) {
+      CHECK_EQ(file.Write(offset, buf.data(), buf.size()), 0);
+    }
+    CHECK_EQ(file.Flush(), 0);
+  }
+  state.SetBytesProcessed(state.iterations() * kFileSize);
+  state.counters["server_requests"] = server.requests();
+}
+BENCHMARK(BM_SequentialWriteBuffered)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace smbfs
+
+BENCHMARK_MAIN();
@@ -0,0 +1,246 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "smbfs/buffered_file.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "smbfs/samba_interface_impl.h"
+
+namespace smbfs {
+namespace {
+
+// Size of the reads and writes done by FUSE.
+constexpr size_t kFuseRequestSize = 128 * 1024;
+
+// SambaInterface serving a single file from memory, and counting the requests
+// done to read and write it.
+class FakeSambaInterface : public SambaInterfaceImpl {
+ public:
+  int SeekFile(SMBCFILE* file, off_t offset, int whence) override {
+    EXPECT_EQ(SEEK_SET, whence);
+    position_ = offset;
+    return 0;
+  }
+
+  int ReadFile(SMBCFILE* file,
+               void* buf,
+               size_t count,
+               size_t* out_bytes_read) override {
+    reads_++;
+    if (read_error_) {
+      return read_error_;
+    }
+    const size_t start = std::min<size_t>(position_, content_.size());
+    *out_bytes_read = std::min(count, content_.size() - start);
+    content_.copy(static_cast<char*>(buf), *out_bytes_read, start);
+    position_ += *out_bytes_read;
+    return 0;
+  }
+
+  int WriteFile(SMBCFILE* file,
+                const void* buf,
+                size_t count,
+                size_t* out_bytes_written) override {
+    writes_++;
+    if (write_error_) {
+      return write_error_;
+    }
+    if (content_.size() < position_ + count) {
+      content_.resize(position_ + count);
+    }
+    content_.replace(position_, count, static_cast<const char*>(buf), count);
+    position_ += count;
+    *out_bytes_written = count;
+    return 0;
+  }
+
+  std::string& content() { return content_; }
+  int reads() const { return reads_; }
+  int writes() const { return writes_; }
+  void set_read_error(int error) { read_error_ = error; }
+  void set_write_error(int error) { write_error_ = error; }
+
+ private:
+  std::string content_;
+  size_t position_ = 0;
+  int reads_ = 0;
+  int writes_ = 0;
+  int read_error_ = 0;
+  int write_error_ = 0;
+};
+
+std::string MakeContent(size_t size) {
+  std::string content(size, 0);
+  for (size_t i = 0; i < size; i++) {
+    content[i] = static_cast<char>(i * 7 + i / 251);
+  }
+  return content;
+}
+
+}  // namespace
+
+class BufferedFileTest : public testing::Test {
+ protected:
+  BufferedFileTest()
+      : file_(&samba_impl_, reinterpret_cast<SMBCFILE*>(&dummy_file_)) {}
+
+  // Reads |size| bytes at |offset| and checks they match the file content.
+  void ExpectRead(off_t offset, size_t size) {
+    std::vector<char> buf;
+    ASSERT_EQ(0, file_.Read(offset, size, &buf));
+    const size_t start = std::min<size_t>(offset, content_.size());
+    const size_t expected_size = std::min(size, content_.size() - start);
+    ASSERT_EQ(expected_size, buf.size());
+    EXPECT_EQ(content_.substr(start, expected_size),
+              std::string(buf.begin(), buf.end()));
+  }
+
+  int Write(off_t offset, const std::string& data) {
+    return file_.Write(offset, data.data(), data.size());
+  }
+
+  int dummy_file_ = 0;
+  std::string content_;
+  FakeSambaInterface samba_impl_;
+  BufferedFile file_;
+};
+
+TEST_F(BufferedFileTest, RandomReadsAreNotReadAhead) {
+  content_ = MakeContent(4 * 1024 * 1024);
+  samba_impl_.content() = content_;
+
+  ExpectRead(1024 * 1024, kFuseRequestSize);
+  ExpectRead(0, kFuseRequestSize);
+  ExpectRead(3 * 1024 * 1024, kFuseRequestSize);
+  EXPECT_EQ(3, samba_impl_.reads());
+}
+
+TEST_F(BufferedFileTest, SequentialReadsGrowReadAhead) {
+  content_ = MakeContent(32 * 1024 * 1024);
+  samba_impl_.content() = content_;
+
+  for (size_t offset = 0; offset < content_.size();
+       offset += kFuseRequestSize) {
+    ExpectRead(offset, kFuseRequestSize);
+  }
+  // The first read is not read ahead, the read-ahead then doubles from 256 KiB
+  // to 4 MiB: 128K + 256K + 512K + 1M + 2M + 4M * 7 = 32 MiB - 128K, and one
+  // more read returns the last 128 KiB.
+  EXPECT_EQ(13, samba_impl_.reads());
+
+  // Reading past the end of the file is served from the read-ahead buffer
+  // which reached the end of the file.
+  ExpectRead(content_.size() - 1024, kFuseRequestSize);
+  EXPECT_EQ(13, samba_impl_.reads());
+}
+
+TEST_F(BufferedFileTest, ReadAheadStopsAtEndOfFile) {
+  content_ = MakeContent(kFuseRequestSize + 1000);
+  samba_impl_.content() = content_;
+
+  ExpectRead(0, kFuseRequestSize);
+  ExpectRead(kFuseRequestSize, kFuseRequestSize);
+  ExpectRead(content_.size(), kFuseRequestSize);
+  EXPECT_EQ(3, samba_impl_.reads());
+}
+
+TEST_F(BufferedFileTest, ReadError) {
+  content_ = MakeContent(1024 * 1024);
+  samba_impl_.content() = content_;
+
+  ExpectRead(0, kFuseRequestSize);
+  samba_impl_.set_read_error(EIO);
+  std::vector<char> buf;
+  EXPECT_EQ(EIO, file_.Read(kFuseRequestSize, kFuseRequestSize, &buf));
+
+  // A failed read-ahead is not used.
+  samba_impl_.set_read_error(0);
+  ExpectRead(kFuseRequestSize, kFuseRequestSize);
+}
+
+TEST_F(BufferedFileTest, SequentialWritesAreCoalesced) {
+  content_ = MakeContent(10 * 1024 * 1024);
+
+  for (size_t offset = 0; offset < content_.size();
+       offset += kFuseRequestSize) {
+    EXPECT_EQ(0, Write(offset, content_.substr(offset, kFuseRequestSize)));
+  }
+  // Two full 4 MiB write-behind buffers were written back.
+  EXPECT_EQ(2, samba_impl_.writes());
+  EXPECT_EQ(0, file_.Flush());
+  EXPECT_EQ(3, samba_impl_.writes());
+  EXPECT_EQ(content_, samba_impl_.content());
+
+  // Nothing is left to flush.
+  EXPECT_EQ(0, file_.Flush());
+  EXPECT_EQ(3, samba_impl_.writes());
+}
+
+TEST_F(BufferedFileTest, NonContiguousWriteWritesBack) {
+  EXPECT_EQ(0, Write(0, "abc"));
+  EXPECT_EQ(0, Write(3, "def"));
+  EXPECT_EQ(0, samba_impl_.writes());
+
+  EXPECT_EQ(0, Write(1, "XY"));
+  EXPECT_EQ(1, samba_impl_.writes());
+  EXPECT_EQ("abcdef", samba_impl_.content());
+
+  EXPECT_EQ(0, file_.Flush());
+  EXPECT_EQ("aXYdef", samba_impl_.content());
+}
+
+TEST_F(BufferedFileTest, LargeWriteIsNotBuffered) {
+  content_ = MakeContent(BufferedFile::kMaxWriteBehindSize);
+
+  EXPECT_EQ(0, Write(0, content_));
+  EXPECT_EQ(1, samba_impl_.writes());
+  EXPECT_EQ(content_, samba_impl_.content());
+}
+
+TEST_F(BufferedFileTest, ReadAfterWrite) {
+  content_ = MakeContent(1024 * 1024);
+  samba_impl_.content() = content_;
+
+  // Fill the read-ahead buffer.
+  ExpectRead(0, kFuseRequestSize);
+  ExpectRead(kFuseRequestSize, kFuseRequestSize);
+
+  // The write must be visible to the following reads.
+  EXPECT_EQ(0, Write(kFuseRequestSize * 2, "hello"));
+  content_.replace(kFuseRequestSize * 2, 5, "hello");
+  ExpectRead(kFuseRequestSize * 2, kFuseRequestSize);
+  EXPECT_EQ(1, samba_impl_.writes());
+}
+
+TEST_F(BufferedFileTest, WriteBackErrorIsReportedByFlush) {
+  EXPECT_EQ(0, Write(0, "abc"));
+  samba_impl_.set_write_error(ENOSPC);
+  EXPECT_TRUE(file_.WriteBack());
+  EXPECT_FALSE(file_.WriteBack());
+
+  EXPECT_EQ(ENOSPC, file_.Flush());
+  // The error is only reported once.
+  EXPECT_EQ(0, file_.Flush());
+}
+
+TEST_F(BufferedFileTest, WriteBackErrorIsReportedByWrite) {
+  EXPECT_EQ(0, Write(0, "abc"));
+  samba_impl_.set_write_error(EACCES);
+  EXPECT_EQ(EACCES, Write(10, "def"));
+
+  samba_impl_.set_write_error(0);
+  EXPECT_EQ(0, Write(10, "def"));
+  EXPECT_EQ(0, file_.Flush());
+  EXPECT_EQ(std::string(10, 0) + "def", samba_impl_.content());
+}
+
+}  // namespace smbfs
@@ -71,6 +71,19 @@ void Filesystem::Write(std::unique_ptr<WriteRequest> request,
   request->ReplyError(ENOSYS);
 }
 
+void Filesystem::Flush(std::unique_ptr<SimpleRequest> request,
+                       fuse_ino_t inode,
+                       uint64_t file_handle) {
+  request->ReplyError(ENOSYS);
+}
+
+void Filesystem::FSync(std::unique_ptr<SimpleRequest> request,
+                       fuse_ino_t inode,
+                       uint64_t file_handle,
+                       bool datasync) {
+  request->ReplyError(ENOSYS);
+}
+
 void Filesystem::Release(std::unique_ptr<SimpleRequest> request,
                          fuse_ino_t inode,
                          uint64_t file_handle) {
@@ -53,6 +53,13 @@ class Filesystem {
                      const char* buf,
                      size_t size,
                      off_t offset);
+  virtual void Flush(std::unique_ptr<SimpleRequest> request,
+                     fuse_ino_t inode,
+                     uint64_t file_handle);
+  virtual void FSync(std::unique_ptr<SimpleRequest> request,
+                     fuse_ino_t inode,
+                     uint64_t file_handle,
+                     bool datasync);
   virtual void Release(std::unique_ptr<SimpleRequest> request,
                        fuse_ino_t inode,
                        uint64_t file_handle);
@@ -111,6 +111,20 @@ class FuseSession::Impl {
         ->Write(request, inode, buf, size, off, info);
   }
 
+  static void FuseFlush(fuse_req_t request,
+                        fuse_ino_t inode,
+                        fuse_file_info* info) {
+    static_cast<Impl*>(fuse_req_userdata(request))->Flush(request, inode, info);
+  }
+
+  static void FuseFSync(fuse_req_t request,
+                        fuse_ino_t inode,
+                        int datasync,
+                        fuse_file_info* info) {
+    static_cast<Impl*>(fuse_req_userdata(request))
+        ->FSync(request, inode, datasync, info);
+  }
+
   static void FuseRelease(fuse_req_t request,
                           fuse_ino_t inode,
                           fuse_file_info* info) {
@@ -257,6 +271,21 @@ class FuseSession::Impl {
                size, off);
   }
 
+  void Flush(fuse_req_t request, fuse_ino_t inode, fuse_file_info* info) {
+    VLOG(1) << "FuseSession::Flush inode: " << inode << " handle:" << info->fh;
+    fs_->Flush(std::make_unique<SimpleRequest>(request), inode, info->fh);
+  }
+
+  void FSync(fuse_req_t request,
+             fuse_ino_t inode,
+             int datasync,
+             fuse_file_info* info) {
+    VLOG(1) << "FuseSession::FSync inode: " << inode << " handle:" << info->fh
+            << " datasync: " << datasync;
+    fs_->FSync(std::make_unique<SimpleRequest>(request), inode, info->fh,
+               datasync);
+  }
+
   void Release(fuse_req_t request, fuse_ino_t inode, fuse_file_info* info) {
     VLOG(1) << "FuseSession::Release inode: " << inode
             << " handle:" << info->fh;
@@ -361,6 +390,8 @@ bool FuseSession::Start(base::OnceClosure stop_callback) {
   ops.create = &Impl::FuseCreate;
   ops.read = &Impl::FuseRead;
   ops.write = &Impl::FuseWrite;
+  ops.flush = &Impl::FuseFlush;
+  ops.fsync = &Impl::FuseFSync;
   ops.release = &Impl::FuseRelease;
   ops.rename = &Impl::FuseRename;
   ops.unlink = &Impl::FuseUnlink;
@@ -253,6 +253,45 @@ SMBCFILE* SmbFilesystem::LookupOpenFile(uint64_t handle) const {
   return it->second;
 }
 
+uint64_t SmbFilesystem::AddBufferedFile(fuse_ino_t inode, SMBCFILE* file) {
+  uint64_t handle = AddOpenFile(file);
+  buffered_files_[handle] = {
+      inode, std::make_unique<BufferedFile>(samba_impl_.get(), file)};
+  return handle;
+}
+
+void SmbFilesystem::RemoveBufferedFile(uint64_t handle) {
+  buffered_files_.erase(handle);
+  RemoveOpenFile(handle);
+}
+
+BufferedFile* SmbFilesystem::LookupBufferedFile(uint64_t handle) const {
+  const auto it = buffered_files_.find(handle);
+  if (it == buffered_files_.end()) {
+    return nullptr;
+  }
+  return it->second.file.get();
+}
+
+bool SmbFilesystem::WriteBackInode(fuse_ino_t inode) {
+  bool wrote_back = false;
+  for (auto& item : buffered_files_) {
+    if (item.second.inode == inode) {
+      wrote_back |= item.second.file->WriteBack();
+    }
+  }
+  return wrote_back;
+}
+
+void SmbFilesystem::InvalidateReadAhead(fuse_ino_t inode,
+                                        const BufferedFile* file) {
+  for (auto& item : buffered_files_) {
+    if (item.second.inode == inode && item.second.file.get() != file) {
+      item.second.file->InvalidateReadAhead();
+    }
+  }
+}
+
 void SmbFilesystem::MaybeUpdateCredentials(int error) {
   if (use_kerberos_) {
     // If Kerberos is being used, it is assumed a valid user/workgroup has
@@ -400,6 +439,11 @@ void SmbFilesystem::GetAttrInternal(std::unique_ptr<AttrRequest> request,
     return;
   }
 
+  // The size and modification time must account for buffered writes.
+  if (WriteBackInode(inode)) {
+    EraseCachedInodeStat(inode);
+  }
+
   struct stat smb_stat = {0};
   const std::string share_file_path = ShareFilePathFromInode(inode);
 
@@ -465,6 +509,9 @@ void SmbFilesystem::SetAttrInternal(std::unique_ptr<AttrRequest> request,
     return;
   }
 
+  // Buffered writes must not be applied after the new size or times.
+  WriteBackInode(inode);
+
   const std::string share_file_path = ShareFilePathFromInode(inode);
 
   struct stat smb_stat = {0};
@@ -487,6 +534,7 @@ void SmbFilesystem::SetAttrInternal(std::unique_ptr<AttrRequest> request,
       request->ReplyError(error);
       return;
     }
+    InvalidateReadAhead(inode, nullptr);
   }
 
   if (to_set & (FUSE_SET_ATTR_ATIME | FUSE_SET_ATTR_MTIME)) {
@@ -622,7 +670,7 @@ void SmbFilesystem::OpenInternal(std::unique_ptr<OpenRequest> request,
     return;
   }
 
-  request->ReplyOpen(AddOpenFile(file));
+  request->ReplyOpen(AddBufferedFile(inode, file));
 }
 
 void SmbFilesystem::Create(std::unique_ptr<CreateRequest> request,
@@ -664,9 +712,8 @@ void SmbFilesystem::CreateInternal(std::unique_ptr<CreateRequest> request,
     return;
   }
 
-  uint64_t handle = AddOpenFile(file);
-
   ino_t inode = inode_map_.IncInodeRef(file_path);
+  uint64_t handle = AddBufferedFile(inode, file);
   struct stat entry_stat = MakeStat(inode, {0});
   entry_stat.st_mode = S_IFREG | mode;
   fuse_entry_param entry = {0};
@@ -700,33 +747,26 @@ void SmbFilesystem::ReadInternal(std::unique_ptr<BufRequest> request,
     return;
   }
 
-  SMBCFILE* file = LookupOpenFile(file_handle);
+  BufferedFile* file = LookupBufferedFile(file_handle);
   if (!file) {
     request->ReplyError(EBADF);
     return;
   }
 
-  int error = samba_impl_->SeekFile(file, offset, SEEK_SET);
-  if (error) {
-    VLOG(1) << "SeekFile path: " << ShareFilePathFromInode(inode)
-            << ", offset: " << offset
-            << " failed: " << base::safe_strerror(error);
-    request->ReplyError(error);
-    return;
-  }
+  // Writes buffered through other handles on the same file must be visible.
+  WriteBackInode(inode);
 
-  std::vector<char> buf(size);
-  size_t bytes_read = 0;
-  error = samba_impl_->ReadFile(file, buf.data(), size, &bytes_read);
+  std::vector<char> buf;
+  int error = file->Read(offset, size, &buf);
   if (error) {
-    VLOG(1) << "ReadFile path: " << ShareFilePathFromInode(inode)
+    VLOG(1) << "Read path: " << ShareFilePathFromInode(inode)
             << " offset: " << offset << ", size: " << size
             << " failed: " << base::safe_strerror(error);
     request->ReplyError(error);
     return;
   }
 
-  request->ReplyBuf(buf.data(), bytes_read);
+  request->ReplyBuf(buf.data(), buf.size());
 }
 
 void SmbFilesystem::Write(std::unique_ptr<WriteRequest> request,
@@ -751,35 +791,71 @@ void SmbFilesystem::WriteInternal(std::unique_ptr<WriteRequest> request,
     return;
   }
 
-  SMBCFILE* file = LookupOpenFile(file_handle);
+  BufferedFile* file = LookupBufferedFile(file_handle);
   if (!file) {
     request->ReplyError(EBADF);
     return;
   }
 
-  int error = samba_impl_->SeekFile(file, offset, SEEK_SET);
+  int error = file->Write(offset, buf.data(), buf.size());
   if (error) {
-    VLOG(1) << "SeekFile path: " << ShareFilePathFromInode(inode)
-            << ", offset: " << offset
+    VLOG(1) << "Write path: " << ShareFilePathFromInode(inode)
+            << " offset: " << offset << ", size: " << buf.size()
             << " failed: " << base::safe_strerror(error);
     request->ReplyError(error);
     return;
   }
 
-  size_t bytes_written = 0;
-  error = samba_impl_->WriteFile(file, buf.data(), buf.size(), &bytes_written);
+  // Modifying the file invalidates any cached inode and data we have.
+  InvalidateReadAhead(inode, file);
+  EraseCachedInodeStat(inode);
+
+  request->ReplyWrite(buf.size());
+}
+
+void SmbFilesystem::Flush(std::unique_ptr<SimpleRequest> request,
+                          fuse_ino_t inode,
+                          uint64_t file_handle) {
+  samba_thread_.task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&SmbFilesystem::FlushInternal, base::Unretained(this),
+                     std::move(request), inode, file_handle));
+}
+
+void SmbFilesystem::FSync(std::unique_ptr<SimpleRequest> request,
+                          fuse_ino_t inode,
+                          uint64_t file_handle,
+                          bool datasync) {
+  // libsmbclient has no equivalent of fsync(), data is committed by the server
+  // once written, so only the buffered writes need to be written back.
+  samba_thread_.task_runner()->PostTask(
+      FROM_HERE,
+      base::BindOnce(&SmbFilesystem::FlushInternal, base::Unretained(this),
+                     std::move(request), inode, file_handle));
+}
+
+void SmbFilesystem::FlushInternal(std::unique_ptr<SimpleRequest> request,
+                                  fuse_ino_t inode,
+                                  uint64_t file_handle) {
+  if (request->IsInterrupted()) {
+    return;
+  }
+
+  BufferedFile* file = LookupBufferedFile(file_handle);
+  if (!file) {
+    request->ReplyError(EBADF);
+    return;
+  }
+
+  int error = file->Flush();
   if (error) {
-    VLOG(1) << "WriteFile path: " << ShareFilePathFromInode(inode)
-            << " offset: " << offset << ", size: " << buf.size()
+    VLOG(1) << "Flush path: " << ShareFilePathFromInode(inode)
             << " failed: " << base::safe_strerror(error);
     request->ReplyError(error);
     return;
   }
 
-  // Modifying the file invalidates any cached inode we have.
-  EraseCachedInodeStat(inode);
-
-  request->ReplyWrite(bytes_written);
+  request->ReplyOk();
 }
 
 void SmbFilesystem::Release(std::unique_ptr<SimpleRequest> request,
@@ -798,19 +874,26 @@ void SmbFilesystem::ReleaseInternal(std::unique_ptr<SimpleRequest> request,
     return;
   }
 
-  SMBCFILE* file = LookupOpenFile(file_handle);
+  BufferedFile* file = LookupBufferedFile(file_handle);
   if (!file) {
     request->ReplyError(EBADF);
     return;
   }
 
-  int error = samba_impl_->CloseFile(file);
+  // Buffered writes are normally written back by the Flush() sent on close(),
+  // but the file can still be written to after it, e.g. through mmap().
+  int flush_error = file->Flush();
+  int error = samba_impl_->CloseFile(file->file());
   if (error) {
     request->ReplyError(error);
     return;
   }
 
-  RemoveOpenFile(file_handle);
+  RemoveBufferedFile(file_handle);
+  if (flush_error) {
+    request->ReplyError(flush_error);
+    return;
+  }
   request->ReplyOk();
 }
 
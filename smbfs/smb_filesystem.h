@@ -26,6 +26,7 @@
 #include <base/threading/thread_task_runner_handle.h>
 #include <gtest/gtest_prod.h>
 
+#include "smbfs/buffered_file.h"
 #include "smbfs/filesystem.h"
 #include "smbfs/inode_map.h"
 #include "smbfs/recursive_delete_operation.h"
@@ -132,6 +133,13 @@ class SmbFilesystem : public Filesystem {
              const char* buf,
              size_t size,
              off_t offset) override;
+  void Flush(std::unique_ptr<SimpleRequest> request,
+             fuse_ino_t inode,
+             uint64_t file_handle) override;
+  void FSync(std::unique_ptr<SimpleRequest> request,
+             fuse_ino_t inode,
+             uint64_t file_handle,
+             bool datasync) override;
   void Release(std::unique_ptr<SimpleRequest> request,
                fuse_ino_t inode,
                uint64_t file_handle) override;
@@ -234,6 +242,9 @@ class SmbFilesystem : public Filesystem {
                      uint64_t file_handle,
                      const std::vector<char>& buf,
                      off_t offset);
+  void FlushInternal(std::unique_ptr<SimpleRequest> request,
+                     fuse_ino_t inode,
+                     uint64_t file_handle);
   void ReleaseInternal(std::unique_ptr<SimpleRequest> request,
                        fuse_ino_t inode,
                        uint64_t file_handle);
@@ -298,6 +309,25 @@ class SmbFilesystem : public Filesystem {
   // does not exist.
   SMBCFILE* LookupOpenFile(uint64_t handle) const;
 
+  // Registers |file|, a regular file open on |inode|, and returns a handle to
+  // that file. Reads and writes on the file go through a BufferedFile.
+  uint64_t AddBufferedFile(fuse_ino_t inode, SMBCFILE* file);
+
+  // Removes |handle| from the open and buffered file tables.
+  void RemoveBufferedFile(uint64_t handle);
+
+  // Returns the buffered file referred to by |handle|. Returns nullptr if
+  // |handle| does not exist or is not a regular file.
+  BufferedFile* LookupBufferedFile(uint64_t handle) const;
+
+  // Writes back the buffered writes of the files open on |inode|, for
+  // operations which need the server to be up to date. Returns true if there
+  // were buffered writes.
+  bool WriteBackInode(fuse_ino_t inode);
+
+  // Drops the read-ahead of the files open on |inode|, except |file|.
+  void InvalidateReadAhead(fuse_ino_t inode, const BufferedFile* file);
+
   // Request credentials, if |error| is an auth failure, and the share has not
   // previously connected successfully.
   void MaybeUpdateCredentials(int error);
@@ -334,6 +364,13 @@ class SmbFilesystem : public Filesystem {
   std::unordered_map<uint64_t, SMBCFILE*> open_files_;
   uint64_t open_files_seq_ = 1;
 
+  // Regular files in |open_files_|, with the inode they are open on.
+  struct OpenBufferedFile {
+    fuse_ino_t inode;
+    std::unique_ptr<BufferedFile> file;
+  };
+  std::unordered_map<uint64_t, OpenBufferedFile> buffered_files_;
+
   mutable base::Lock lock_;
   std::string resolved_share_path_ = share_path_;
 
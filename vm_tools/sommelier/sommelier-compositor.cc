@@ -2,9 +2,10 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
-#include "sommelier.h"          // NOLINT(build/include_directory)
-#include "sommelier-timing.h"   // NOLINT(build/include_directory)
-#include "sommelier-tracing.h"  // NOLINT(build/include_directory)
+#include "sommelier.h"              // NOLINT(build/include_directory)
+#include "sommelier-damage-copy.h"  // NOLINT(build/include_directory)
+#include "sommelier-timing.h"       // NOLINT(build/include_directory)
+#include "sommelier-tracing.h"      // NOLINT(build/include_directory)
 
 #include <assert.h>
 #include <errno.h>
@@ -18,6 +19,8 @@
 #include <wayland-client.h>
 #include <wayland-util.h>
 
+#include <vector>
+
 #include "drm-server-protocol.h"  // NOLINT(build/include_directory)
 #include "linux-dmabuf-unstable-v1-client-protocol.h"  // NOLINT(build/include_directory)
 #include "linux-explicit-synchronization-unstable-v1-client-protocol.h"  // NOLINT(build/include_directory)
@@ -554,21 +557,15 @@ static void sl_host_surface_set_input_region(
                               host_region ? host_region->proxy : NULL);
 }  // NOLINT(whitespace/indent)
 
-static void copy_damaged_rect(sl_host_surface* host,
-                              pixman_box32_t* rect,
-                              double scale_x,
-                              double scale_y,
-                              double offset_x,
-                              double offset_y) {
-  uint8_t* src_addr = static_cast<uint8_t*>(host->contents_shm_mmap->addr);
-  uint8_t* dst_addr = static_cast<uint8_t*>(host->current_buffer->mmap->addr);
-  size_t* src_offset = host->contents_shm_mmap->offset;
-  size_t* dst_offset = host->current_buffer->mmap->offset;
-  size_t* src_stride = host->contents_shm_mmap->stride;
-  size_t* dst_stride = host->current_buffer->mmap->stride;
-  size_t* y_ss = host->contents_shm_mmap->y_ss;
-  size_t bpp = host->contents_shm_mmap->bpp;
-  size_t num_planes = host->contents_shm_mmap->num_planes;
+// Adds the rect enclosing |rect| after applying scale and offset to |rects|,
+// if it isn't empty once clipped to the contents.
+static void add_damaged_rect(sl_host_surface* host,
+                             pixman_box32_t* rect,
+                             double scale_x,
+                             double scale_y,
+                             double offset_x,
+                             double offset_y,
+                             std::vector<pixman_box32_t>* rects) {
   int32_t x1, y1, x2, y2;
 
   // Enclosing rect after applying scale and offset.
@@ -582,25 +579,30 @@ static void copy_damaged_rect(sl_host_surface* host,
   x2 = MIN(static_cast<int32_t>(host->contents_width), x2);
   y2 = MIN(static_cast<int32_t>(host->contents_height), y2);
 
-  if (x1 < x2 && y1 < y2) {
-    size_t i;
-
-    for (i = 0; i < num_planes; ++i) {
-      uint8_t* src_base = src_addr + src_offset[i];
-      uint8_t* dst_base = dst_addr + dst_offset[i];
-      uint8_t* src = src_base + y1 * src_stride[i] + x1 * bpp;
-      uint8_t* dst = dst_base + y1 * dst_stride[i] + x1 * bpp;
-      int32_t width = x2 - x1;
-      int32_t height = (y2 - y1) / y_ss[i];
-      size_t bytes = width * bpp;
-
-      while (height--) {
-        memcpy(dst, src, bytes);
-        dst += dst_stride[i];
-        src += src_stride[i];
-      }
-    }
+  if (x1 < x2 && y1 < y2)
+    rects->push_back({x1, y1, x2, y2});
+}
+
+static void copy_damaged_region(sl_host_surface* host,
+                                pixman_region32_t* damage) {
+  struct sl_mmap* src = host->contents_shm_mmap;
+  struct sl_mmap* dst = host->current_buffer->mmap;
+  struct sl_damage_copy_plane planes[ARRAY_SIZE(src->offset)];
+  size_t num_planes = MIN(src->num_planes, ARRAY_SIZE(planes));
+  size_t i;
+
+  for (i = 0; i < num_planes; ++i) {
+    planes[i].src = static_cast<uint8_t*>(src->addr) + src->offset[i];
+    planes[i].dst = static_cast<uint8_t*>(dst->addr) + dst->offset[i];
+    planes[i].src_stride = src->stride[i];
+    planes[i].dst_stride = dst->stride[i];
+    planes[i].y_ss = src->y_ss[i];
   }
+
+  int n;
+  pixman_box32_t* rects = pixman_region32_rectangles(damage, &n);
+  sl_damage_copy(host->ctx->damage_copier, planes, num_planes, src->bpp,
+                 host->contents_width, rects, n, NULL);
 }
 
 static void sl_host_surface_commit(struct wl_client* client,
@@ -630,33 +632,33 @@ static void sl_host_surface_commit(struct wl_client* client,
       host->current_buffer->mmap->begin_write(host->current_buffer->mmap->fd,
                                               host->ctx);
 
-    // Copy damaged regions (surface-relative coordinates).
-    int n;
-    pixman_box32_t* rect =
-        pixman_region32_rectangles(&host->current_buffer->surface_damage, &n);
-    while (n--) {
-      TRACE_EVENT("surface",
-                  "sl_host_surface_commit: memcpy_loop (surface damage)");
-      copy_damaged_rect(host, rect, contents_scale_x, contents_scale_y,
-                        wl_fixed_to_double(contents_offset_x),
-                        wl_fixed_to_double(contents_offset_y));
-      ++rect;
-    }
+    // Copy damaged regions. Surface damage is transformed to buffer
+    // coordinates and merged with buffer damage, so that no pixel is copied
+    // twice.
+    {
+      TRACE_EVENT("surface", "sl_host_surface_commit: copy damage");
+      int n;
+      pixman_box32_t* rect = pixman_region32_rectangles(
+          &host->current_buffer->surface_damage, &n);
+      std::vector<pixman_box32_t> rects;
+      rects.reserve(n);
+      while (n--) {
+        add_damaged_rect(host, rect, contents_scale_x, contents_scale_y,
+                         wl_fixed_to_double(contents_offset_x),
+                         wl_fixed_to_double(contents_offset_y), &rects);
+        ++rect;
+      }
+      rect =
+          pixman_region32_rectangles(&host->current_buffer->buffer_damage, &n);
+      while (n--) {
+        add_damaged_rect(host, rect, 1.0, 1.0, 0.0, 0.0, &rects);
+        ++rect;
+      }
 
-    // Copy damaged regions (buffer-relative coordinates).
-    //
-    // In theory, if we've accumulated both surface damage and buffer damage,
-    // it might be more efficient to first transform and union the regions, so
-    // that we won't ever copy the same pixel twice.
-    // In practice, wl_surface::damage_buffer obsoletes wl_surface::damage, and
-    // it doesn't seem worthwhile to optimize for the edge case in which an app
-    // uses both in the same frame.
-    rect = pixman_region32_rectangles(&host->current_buffer->buffer_damage, &n);
-    while (n--) {
-      TRACE_EVENT("surface",
-                  "sl_host_surface_commit: memcpy_loop (buffer damage)");
-      copy_damaged_rect(host, rect, 1.0, 1.0, 0.0, 0.0);
-      ++rect;
+      pixman_region32_t damage;
+      pixman_region32_init_rects(&damage, rects.data(), rects.size());
+      copy_damaged_region(host, &damage);
+      pixman_region32_fini(&damage);
     }
 
     if (host->current_buffer->mmap->end_write)
@@ -176,6 +176,7 @@ void sl_context_init_default(struct sl_context* ctx) {
   ctx->timing = NULL;
   ctx->trace_filename = NULL;
   ctx->trace_system = false;
+  ctx->damage_copier = NULL;
 
   wl_list_init(&ctx->accelerators);
   wl_list_init(&ctx->registries);
@@ -164,6 +164,8 @@ struct sl_context {
   bool trace_system;
   bool use_explicit_fence;
   bool use_virtgpu_channel;
+  // Copies damage of shm buffers with worker threads, if any.
+  struct sl_damage_copier* damage_copier;
   // Never freed after allocation due the fact sommelier doesn't have a
   // shutdown function yet.
   WaylandChannel* channel;
@@ -0,0 +1,333 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sommelier-damage-copy.h"  // NOLINT(build/include_directory)
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Rectangles of a band closer than this are copied as one, along with the
+// pixels between them: copying a few more bytes is cheaper than another copy.
+static const size_t kMergeGapBytes = 256;
+
+// Copies of damage larger than this would evict most of the cache, and the
+// destination isn't read back, so they bypass the cache...
+static const size_t kStreamMinTotalBytes = 1024 * 1024;
+// ...for the spans that are long enough to be worth the alignment.
+static const size_t kStreamMinBytes = 1024;
+
+// Copies of damage larger than this are split between the threads of a copier,
+// in tiles of about kTileBytes.
+static const size_t kParallelMinBytes = 1024 * 1024;
+static const size_t kTileBytes = 128 * 1024;
+
+// Rows |row_begin| to |row_end| of a span in a plane.
+struct sl_damage_copy_tile {
+  const pixman_box32_t* span;
+  size_t plane;
+  int32_t row_begin;
+  int32_t row_end;
+};
+
+struct sl_damage_copy_job {
+  const struct sl_damage_copy_plane* planes;
+  size_t bpp;
+  int32_t width;
+  bool stream;
+  std::vector<sl_damage_copy_tile> tiles;
+  std::atomic<size_t> next_tile;
+  std::atomic<size_t> num_copies;
+};
+
+struct sl_damage_copier {
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable work_cv;
+  std::condition_variable done_cv;
+  // The job being copied, cleared once the calling thread is done with it.
+  sl_damage_copy_job* job = nullptr;
+  uint64_t job_id = 0;
+  int num_busy = 0;
+  bool quit = false;
+};
+
+static void sl_copy_bytes(uint8_t* dst,
+                          const uint8_t* src,
+                          size_t bytes,
+                          bool stream) {
+#if defined(__SSE2__)
+  if (stream && bytes >= kStreamMinBytes) {
+    size_t head = -reinterpret_cast<uintptr_t>(dst) & 15;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    bytes -= head;
+    for (; bytes >= 64; bytes -= 64, src += 64, dst += 64) {
+      const __m128i* s = reinterpret_cast<const __m128i*>(src);
+      __m128i* d = reinterpret_cast<__m128i*>(dst);
+      __m128i a = _mm_loadu_si128(s);
+      __m128i b = _mm_loadu_si128(s + 1);
+      __m128i c = _mm_loadu_si128(s + 2);
+      __m128i e = _mm_loadu_si128(s + 3);
+      _mm_stream_si128(d, a);
+      _mm_stream_si128(d + 1, b);
+      _mm_stream_si128(d + 2, c);
+      _mm_stream_si128(d + 3, e);
+    }
+  }
+#endif
+  memcpy(dst, src, bytes);
+}
+
+// Makes the non-temporal stores of this thread visible to the others.
+static void sl_copy_fence(bool stream) {
+#if defined(__SSE2__)
+  if (stream)
+    _mm_sfence();
+#endif
+}
+
+// Returns the rows of |plane| covered by rows |y1| to |y2| of the buffer.
+static void sl_plane_rows(const struct sl_damage_copy_plane* plane,
+                          int32_t y1,
+                          int32_t y2,
+                          int32_t* row_begin,
+                          int32_t* row_end) {
+  int32_t y_ss = plane->y_ss;
+  *row_begin = y1 / y_ss;
+  *row_end = (y2 + y_ss - 1) / y_ss;
+}
+
+static size_t sl_copy_rows(const struct sl_damage_copy_plane* plane,
+                           const pixman_box32_t* span,
+                           int32_t row_begin,
+                           int32_t row_end,
+                           size_t bpp,
+                           int32_t width,
+                           bool stream) {
+  const uint8_t* src =
+      plane->src + row_begin * plane->src_stride + span->x1 * bpp;
+  uint8_t* dst = plane->dst + row_begin * plane->dst_stride + span->x1 * bpp;
+  size_t bytes = (span->x2 - span->x1) * bpp;
+  int32_t height = row_end - row_begin;
+
+  // Full rows of buffers with the same layout are contiguous.
+  if (span->x1 == 0 && span->x2 == width &&
+      plane->src_stride == plane->dst_stride) {
+    sl_copy_bytes(dst, src, (height - 1) * plane->src_stride + bytes, stream);
+    return 1;
+  }
+  for (int32_t i = 0; i < height; ++i) {
+    sl_copy_bytes(dst, src, bytes, stream);
+    dst += plane->dst_stride;
+    src += plane->src_stride;
+  }
+  return height;
+}
+
+static size_t sl_copy_spans(const struct sl_damage_copy_plane* plane,
+                            const std::vector<pixman_box32_t>& spans,
+                            size_t bpp,
+                            int32_t width,
+                            bool stream) {
+  size_t num_copies = 0;
+  for (const pixman_box32_t& span : spans) {
+    int32_t row_begin, row_end;
+    sl_plane_rows(plane, span.y1, span.y2, &row_begin, &row_end);
+    num_copies +=
+        sl_copy_rows(plane, &span, row_begin, row_end, bpp, width, stream);
+  }
+  return num_copies;
+}
+
+static void sl_damage_copy_job_run(sl_damage_copy_job* job) {
+  size_t i;
+  while ((i = job->next_tile.fetch_add(1)) < job->tiles.size()) {
+    const sl_damage_copy_tile& tile = job->tiles[i];
+    job->num_copies +=
+        sl_copy_rows(&job->planes[tile.plane], tile.span, tile.row_begin,
+                     tile.row_end, job->bpp, job->width, job->stream);
+  }
+  sl_copy_fence(job->stream);
+}
+
+static void sl_damage_copier_run(struct sl_damage_copier* copier) {
+  uint64_t seen_job_id = 0;
+  std::unique_lock<std::mutex> lock(copier->mutex);
+  while (true) {
+    copier->work_cv.wait(lock, [copier, seen_job_id] {
+      return copier->quit || copier->job_id != seen_job_id;
+    });
+    if (copier->quit)
+      return;
+    seen_job_id = copier->job_id;
+    sl_damage_copy_job* job = copier->job;
+    if (!job)
+      continue;
+    ++copier->num_busy;
+    lock.unlock();
+    sl_damage_copy_job_run(job);
+    lock.lock();
+    if (--copier->num_busy == 0)
+      copier->done_cv.notify_one();
+  }
+}
+
+struct sl_damage_copier* sl_damage_copier_create(int num_threads) {
+  struct sl_damage_copier* copier = new sl_damage_copier();
+  for (int i = 0; i < num_threads; ++i)
+    copier->threads.emplace_back(sl_damage_copier_run, copier);
+  return copier;
+}
+
+void sl_damage_copier_destroy(struct sl_damage_copier* copier) {
+  {
+    std::lock_guard<std::mutex> lock(copier->mutex);
+    copier->quit = true;
+  }
+  copier->work_cv.notify_all();
+  for (auto& thread : copier->threads)
+    thread.join();
+  delete copier;
+}
+
+// Merges y-x banded |rects| into spans, and calls |copy| with each span.
+template <typename F>
+static void sl_merge_rects(const pixman_box32_t* rects,
+                           int num_rects,
+                           size_t bpp,
+                           F copy) {
+  pixman_box32_t span = {};
+  bool has_span = false;
+  for (int i = 0; i < num_rects; ++i) {
+    const pixman_box32_t& rect = rects[i];
+    if (rect.x1 >= rect.x2 || rect.y1 >= rect.y2)
+      continue;
+    if (has_span) {
+      // Rectangles of the same band, ordered by x.
+      if (span.y1 == rect.y1 && span.y2 == rect.y2 &&
+          (rect.x1 - span.x2) * bpp <= kMergeGapBytes) {
+        span.x2 = std::max(span.x2, rect.x2);
+        continue;
+      }
+      // Rectangles of consecutive bands with the same columns.
+      if (span.y2 == rect.y1 && span.x1 == rect.x1 && span.x2 == rect.x2) {
+        span.y2 = rect.y2;
+        continue;
+      }
+      copy(span);
+    }
+    span = rect;
+    has_span = true;
+  }
+  if (has_span)
+    copy(span);
+}
+
+void sl_damage_copy(struct sl_damage_copier* copier,
+                    const struct sl_damage_copy_plane* planes,
+                    size_t num_planes,
+                    size_t bpp,
+                    int32_t width,
+                    const pixman_box32_t* rects,
+                    int num_rects,
+                    struct sl_damage_copy_stats* stats) {
+  size_t total_bytes = 0;
+  for (int i = 0; i < num_rects; ++i) {
+    total_bytes += static_cast<size_t>(rects[i].x2 - rects[i].x1) *
+                   (rects[i].y2 - rects[i].y1) * bpp * num_planes;
+  }
+  const bool stream = total_bytes >= kStreamMinTotalBytes;
+  if (stats) {
+    stats->num_spans = 0;
+    stats->num_copies = 0;
+    stats->num_bytes = total_bytes;
+    stats->num_tiles = 0;
+    stats->streamed = stream;
+  }
+
+  if (!copier || copier->threads.empty() || total_bytes < kParallelMinBytes) {
+    size_t num_spans = 0;
+    size_t num_copies = 0;
+    for (size_t i = 0; i < num_planes; ++i) {
+      const struct sl_damage_copy_plane* plane = &planes[i];
+      sl_merge_rects(rects, num_rects, bpp, [&](const pixman_box32_t& span) {
+        int32_t row_begin, row_end;
+        sl_plane_rows(plane, span.y1, span.y2, &row_begin, &row_end);
+        num_copies +=
+            sl_copy_rows(plane, &span, row_begin, row_end, bpp, width, stream);
+        ++num_spans;
+      });
+    }
+    sl_copy_fence(stream);
+    if (stats) {
+      stats->num_spans = num_spans / std::max<size_t>(num_planes, 1);
+      stats->num_copies = num_copies;
+    }
+    return;
+  }
+
+  std::vector<pixman_box32_t> spans;
+  sl_merge_rects(rects, num_rects, bpp, [&spans](const pixman_box32_t& span) {
+    spans.push_back(span);
+  });
+  if (stats)
+    stats->num_spans = spans.size();
+
+  // Split the spans in tiles of whole rows. Rows of subsampled planes may be
+  // covered by two spans, so these planes are left to the calling thread.
+  sl_damage_copy_job job;
+  job.planes = planes;
+  job.bpp = bpp;
+  job.width = width;
+  job.stream = stream;
+  job.next_tile = 0;
+  job.num_copies = 0;
+  for (size_t i = 0; i < num_planes; ++i) {
+    if (planes[i].y_ss != 1)
+      continue;
+    for (const pixman_box32_t& span : spans) {
+      int32_t row_begin, row_end;
+      sl_plane_rows(&planes[i], span.y1, span.y2, &row_begin, &row_end);
+      size_t row_bytes = (span.x2 - span.x1) * bpp;
+      int32_t tile_rows =
+          std::max<int32_t>(1, kTileBytes / std::max<size_t>(row_bytes, 1));
+      for (int32_t row = row_begin; row < row_end; row += tile_rows) {
+        job.tiles.push_back(
+            {&span, i, row, std::min(row + tile_rows, row_end)});
+      }
+    }
+  }
+  if (stats)
+    stats->num_tiles = job.tiles.size();
+
+  {
+    std::lock_guard<std::mutex> lock(copier->mutex);
+    copier->job = &job;
+    ++copier->job_id;
+  }
+  copier->work_cv.notify_all();
+  for (size_t i = 0; i < num_planes; ++i) {
+    if (planes[i].y_ss != 1)
+      job.num_copies += sl_copy_spans(&planes[i], spans, bpp, width, stream);
+  }
+  sl_damage_copy_job_run(&job);
+
+  // Workers that didn't start on the job yet won't anymore.
+  std::unique_lock<std::mutex> lock(copier->mutex);
+  copier->job = nullptr;
+  copier->done_cv.wait(lock, [copier] { return copier->num_busy == 0; });
+  if (stats)
+    stats->num_copies = job.num_copies;
+}
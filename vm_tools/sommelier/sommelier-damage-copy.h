@@ -0,0 +1,56 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef VM_TOOLS_SOMMELIER_SOMMELIER_DAMAGE_COPY_H_
+#define VM_TOOLS_SOMMELIER_SOMMELIER_DAMAGE_COPY_H_
+
+#include <pixman.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A plane of the buffers that damage is copied between.
+struct sl_damage_copy_plane {
+  const uint8_t* src;
+  uint8_t* dst;
+  size_t src_stride;
+  size_t dst_stride;
+  // Vertical subsampling of the plane, 1 if not subsampled.
+  size_t y_ss;
+};
+
+struct sl_damage_copy_stats {
+  // Rectangles copied after merging, and copy calls made for them.
+  size_t num_spans;
+  size_t num_copies;
+  size_t num_bytes;
+  // Tiles shared with worker threads, 0 if the copy wasn't split.
+  size_t num_tiles;
+  bool streamed;
+};
+
+// Copies damage with a pool of worker threads.
+struct sl_damage_copier;
+
+// Creates a copier with |num_threads| worker threads, which copy large damage
+// along with the calling thread.
+struct sl_damage_copier* sl_damage_copier_create(int num_threads);
+void sl_damage_copier_destroy(struct sl_damage_copier* copier);
+
+// Copies the pixels of |rects| from the source to the destination of each of
+// |planes|. |rects| must be y-x banded and within |width|, like the rectangles
+// of a pixman region. Rectangles in the same band and close to each other are
+// copied as one, as are full rows of buffers with equal strides. Large copies
+// use non-temporal stores where supported, and are split in tiles between the
+// threads of |copier|, which may be NULL to copy on the calling thread only.
+// |stats| may be NULL.
+void sl_damage_copy(struct sl_damage_copier* copier,
+                    const struct sl_damage_copy_plane* planes,
+                    size_t num_planes,
+                    size_t bpp,
+                    int32_t width,
+                    const pixman_box32_t* rects,
+                    int num_rects,
+                    struct sl_damage_copy_stats* stats);
+
+#endif  // VM_TOOLS_SOMMELIER_SOMMELIER_DAMAGE_COPY_H_
@@ -2,8 +2,9 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
-#include "sommelier.h"          // NOLINT(build/include_directory)
-#include "sommelier-tracing.h"  // NOLINT(build/include_directory)
+#include "sommelier.h"              // NOLINT(build/include_directory)
+#include "sommelier-damage-copy.h"  // NOLINT(build/include_directory)
+#include "sommelier-tracing.h"      // NOLINT(build/include_directory)
 
 #include <assert.h>
 #include <errno.h>
@@ -3086,6 +3087,8 @@ static void sl_print_usage() {
       "  --drm-device=DEVICE\t\tDRM device to use\n"
       "  --glamor\t\t\tUse glamor to accelerate X11 clients\n"
       "  --timing-filename=PATH\tPath to timing output log\n"
+      "  --damage-copy-threads=N\tThreads copying large damage of shm "
+      "buffers\n"
 #ifdef PERFETTO_TRACING
       "  --trace-filename=PATH\t\tPath to Perfetto trace filename\n"
       "  --trace-system\t\tPerfetto trace to system daemon\n"
@@ -3134,6 +3137,7 @@ int real_main(int argc, char** argv) {
   int xdisplay = -1;
   int parent = 0;
   int client_fd = -1;
+  int damage_copy_threads = 0;
   int rv;
   int i;
 
@@ -3213,6 +3217,8 @@ int real_main(int argc, char** argv) {
       xfont_path = sl_arg_value(arg);
     } else if (strstr(arg, "--timing-filename") == arg) {
       ctx.timing = new Timing(sl_arg_value(arg));
+    } else if (strstr(arg, "--damage-copy-threads") == arg) {
+      damage_copy_threads = atoi(sl_arg_value(arg));
     } else if (strstr(arg, "--explicit-fence") == arg) {
       ctx.use_explicit_fence = true;
     } else if (strstr(arg, "--virtgpu-channel") == arg) {
@@ -3370,7 +3376,8 @@ int real_main(int argc, char** argv) {
               strstr(arg, "--scale") == arg ||
               strstr(arg, "--accelerators") == arg ||
               strstr(arg, "--drm-device") == arg ||
-              strstr(arg, "--support-damage-buffer") == arg) {
+              strstr(arg, "--support-damage-buffer") == arg ||
+              strstr(arg, "--damage-copy-threads") == arg) {
             args[i++] = arg;
           }
         }
@@ -3685,6 +3692,10 @@ int real_main(int argc, char** argv) {
     close(sv[1]);
   }
 
+  // Like tracing, copy threads are only started once all children are spawned.
+  if (damage_copy_threads > 0)
+    ctx.damage_copier = sl_damage_copier_create(damage_copy_threads);
+
   // Attempt to enable tracing.  This could be called earlier but would rather
   // spawn all children first.
   const bool tracing_needed = ctx.trace_filename || ctx.trace_system;
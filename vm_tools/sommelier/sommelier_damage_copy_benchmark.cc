@@ -0,0 +1,197 @@
+// Copyright 2022 The Chromium OS Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Replays damage patterns of typical Crostini apps against in-memory buffers,
+// comparing sl_damage_copy with the row-by-row copy of each damage rectangle
+// it replaced.
+
+#include <benchmark/benchmark.h>
+#include <pixman.h>
+#include <string.h>
+
+#include <vector>
+
+#include "sommelier-damage-copy.h"  // NOLINT(build/include_directory)
+
+namespace {
+
+const int32_t kWidth = 1920;
+const int32_t kHeight = 1080;
+const size_t kBpp = 4;
+const size_t kStride = kWidth * kBpp;
+const int kNumFrames = 64;
+
+// A character cell of a terminal or editor.
+const int32_t kCellWidth = 9;
+const int32_t kCellHeight = 18;
+
+typedef std::vector<pixman_box32_t> Frame;
+
+pixman_box32_t Box(int32_t x, int32_t y, int32_t width, int32_t height) {
+  return {x, y, x + width, y + height};
+}
+
+pixman_box32_t Cell(int32_t column, int32_t row, int32_t num_columns) {
+  return Box(column * kCellWidth, row * kCellHeight, num_columns * kCellWidth,
+             kCellHeight);
+}
+
+// Typing in a terminal: the cursor moves by a cell per frame.
+std::vector<Frame> TerminalTyping() {
+  std::vector<Frame> frames;
+  for (int i = 0; i < kNumFrames; ++i)
+    frames.push_back({Cell(10 + i, 40, 1), Cell(11 + i, 40, 1)});
+  return frames;
+}
+
+// Output in a terminal: lines of words are drawn word by word.
+std::vector<Frame> TerminalOutput() {
+  std::vector<Frame> frames;
+  for (int i = 0; i < kNumFrames; ++i) {
+    Frame frame;
+    for (int row = 0; row < 8; ++row) {
+      int32_t column = 0;
+      for (int word = 0; word < 12; ++word) {
+        int32_t length = 2 + (i + row + word) % 7;
+        frame.push_back(Cell(column, (i + row) % 56, length));
+        column += length + 1;
+      }
+    }
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+// Editing in an IDE: the edited line, its gutter, the minimap, the status
+// bar, and the tab title change.
+std::vector<Frame> IdeEditing() {
+  std::vector<Frame> frames;
+  for (int i = 0; i < kNumFrames; ++i) {
+    int32_t row = 10 + i % 30;
+    frames.push_back({
+        Cell(8, row, 60 + i % 20),
+        Box(0, row * kCellHeight, 48, kCellHeight),
+        Box(kWidth - 120, row * 2, 100, 4),
+        Box(0, kHeight - 24, 300, 24),
+        Box(kWidth - 400, kHeight - 24, 200, 24),
+        Box(200, 40, 160, 30),
+    });
+  }
+  return frames;
+}
+
+// Scrolling, or any app redrawing all of its contents below a toolbar.
+std::vector<Frame> Scrolling() {
+  std::vector<Frame> frames;
+  for (int i = 0; i < kNumFrames; ++i)
+    frames.push_back({Box(0, 80, kWidth, kHeight - 80)});
+  return frames;
+}
+
+std::vector<Frame> GetPattern(int pattern) {
+  switch (pattern) {
+    case 0:
+      return TerminalTyping();
+    case 1:
+      return TerminalOutput();
+    case 2:
+      return IdeEditing();
+    default:
+      return Scrolling();
+  }
+}
+
+const char* kPatternNames[] = {"terminal_typing", "terminal_output",
+                               "ide_editing", "scrolling"};
+
+// Accumulates each frame in a region, like sl_host_surface_damage_buffer.
+std::vector<pixman_region32_t> CreateRegions(int pattern) {
+  std::vector<pixman_region32_t> regions;
+  for (const Frame& frame : GetPattern(pattern)) {
+    pixman_region32_t region;
+    pixman_region32_init(&region);
+    for (const pixman_box32_t& box : frame) {
+      pixman_region32_union_rect(&region, &region, box.x1, box.y1,
+                                 box.x2 - box.x1, box.y2 - box.y1);
+    }
+    regions.push_back(region);
+  }
+  return regions;
+}
+
+void DestroyRegions(std::vector<pixman_region32_t>* regions) {
+  for (pixman_region32_t& region : *regions)
+    pixman_region32_fini(&region);
+}
+
+// The copy that sl_damage_copy replaced.
+size_t CopyRowByRow(const sl_damage_copy_plane& plane,
+                    const pixman_box32_t* rects,
+                    int num_rects) {
+  size_t num_copies = 0;
+  for (int i = 0; i < num_rects; ++i) {
+    const uint8_t* src =
+        plane.src + rects[i].y1 * plane.src_stride + rects[i].x1 * kBpp;
+    uint8_t* dst =
+        plane.dst + rects[i].y1 * plane.dst_stride + rects[i].x1 * kBpp;
+    size_t bytes = (rects[i].x2 - rects[i].x1) * kBpp;
+    for (int32_t y = rects[i].y1; y < rects[i].y2; ++y) {
+      memcpy(dst, src, bytes);
+      dst += plane.dst_stride;
+      src += plane.src_stride;
+      ++num_copies;
+    }
+  }
+  return num_copies;
+}
+
+void BM_RowByRowCopy(benchmark::State& state) {
+  std::vector<uint8_t> src(kStride * kHeight, 1);
+  std::vector<uint8_t> dst(kStride * kHeight);
+  sl_damage_copy_plane plane = {src.data(), dst.data(), kStride, kStride, 1};
+  std::vector<pixman_region32_t> regions = CreateRegions(state.range(0));
+  size_t num_copies = 0;
+  for (auto _ : state) {
+    for (pixman_region32_t& region : regions) {
+      int n;
+      pixman_box32_t* rects = pixman_region32_rectangles(&region, &n);
+      num_copies += CopyRowByRow(plane, rects, n);
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetLabel(kPatternNames[state.range(0)]);
+  state.counters["copies_per_frame"] =
+      static_cast<double>(num_copies) / (state.iterations() * regions.size());
+  DestroyRegions(&regions);
+}
+BENCHMARK(BM_RowByRowCopy)->DenseRange(0, 3);
+
+void BM_DamageCopy(benchmark::State& state) {
+  std::vector<uint8_t> src(kStride * kHeight, 1);
+  std::vector<uint8_t> dst(kStride * kHeight);
+  sl_damage_copy_plane plane = {src.data(), dst.data(), kStride, kStride, 1};
+  std::vector<pixman_region32_t> regions = CreateRegions(state.range(0));
+  sl_damage_copier* copier = sl_damage_copier_create(state.range(1));
+  size_t num_copies = 0;
+  for (auto _ : state) {
+    for (pixman_region32_t& region : regions) {
+      int n;
+      pixman_box32_t* rects = pixman_region32_rectangles(&region, &n);
+      sl_damage_copy_stats stats;
+      sl_damage_copy(copier, &plane, 1, kBpp, kWidth, rects, n, &stats);
+      num_copies += stats.num_copies;
+    }
+    benchmark::ClobberMemory();
+  }
+  state.SetLabel(kPatternNames[state.range(0)]);
+  state.counters["copies_per_frame"] =
+      static_cast<double>(num_copies) / (state.iterations() * regions.size());
+  sl_damage_copier_destroy(copier);
+  DestroyRegions(&regions);
+}
+BENCHMARK(BM_DamageCopy)->ArgsProduct({{0, 1, 2, 3}, {0, 1, 3}});
+
+}  // namespace
+
+BENCHMARK_MAIN();
@@ -5,6 +5,7 @@
 #include <ctype.h>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -13,6 +14,7 @@
 #include <wayland-util.h>
 
 #include "sommelier.h"  // NOLINT(build/include_directory)
+#include "sommelier-damage-copy.h"  // NOLINT(build/include_directory)
 #include "virtualization/wayland_channel.h"  // NOLINT(build/include_directory)
 
 #include "aura-shell-client-protocol.h"      // NOLINT(build/include_directory)
@@ -531,6 +533,57 @@ TEST_F(X11Test, IconifySuppressesStateChanges) {
 }
 #endif
 
+// Copies a few small rectangles and a large one between buffers of different
+// strides, with and without worker threads, and checks that exactly the
+// damaged pixels of both planes are copied.
+TEST(DamageCopyTest, CopiesDamagedPixelsOnly) {
+  const int32_t kWidth = 1024;
+  const int32_t kHeight = 600;
+  const size_t kBpp = 4;
+  const size_t kSrcStride = kWidth * kBpp;
+  const size_t kDstStride = kSrcStride + 64;
+  const pixman_box32_t kRects[] = {
+      {0, 0, 10, 2},
+      {20, 0, 30, 2},
+      {0, 2, 10, 4},
+      {0, 8, kWidth, kHeight},
+  };
+
+  for (int num_threads : {0, 2}) {
+    std::vector<uint8_t> src(kSrcStride * kHeight);
+    for (size_t i = 0; i < src.size(); ++i)
+      src[i] = i % 251 + 1;
+    std::vector<uint8_t> dst(kDstStride * kHeight);
+    std::vector<uint8_t> src_uv(kSrcStride * kHeight / 2, 7);
+    std::vector<uint8_t> dst_uv(kDstStride * kHeight / 2);
+    sl_damage_copy_plane planes[] = {
+        {src.data(), dst.data(), kSrcStride, kDstStride, 1},
+        {src_uv.data(), dst_uv.data(), kSrcStride, kDstStride, 2},
+    };
+
+    sl_damage_copier* copier = sl_damage_copier_create(num_threads);
+    sl_damage_copy_stats stats;
+    sl_damage_copy(copier, planes, 2, kBpp, kWidth, kRects, 4, &stats);
+    sl_damage_copier_destroy(copier);
+
+    // The first rectangles merge in a span, the last one is a single copy.
+    EXPECT_EQ(stats.num_spans, 3u);
+    for (int32_t y = 0; y < kHeight; ++y) {
+      for (int32_t x = 0; x < kWidth; ++x) {
+        bool damaged = y >= 8 || (y < 4 && x < 10) || (y < 2 && x < 30);
+        const uint8_t* pixel = &dst[y * kDstStride + x * kBpp];
+        ASSERT_EQ(pixel[0], damaged ? src[y * kSrcStride + x * kBpp] : 0)
+            << "at " << x << "," << y << " with " << num_threads
+            << " threads";
+        const uint8_t* uv_pixel = &dst_uv[y / 2 * kDstStride + x * kBpp];
+        if (y >= 8) {
+          ASSERT_EQ(uv_pixel[0], 7);
+        }
+      }
+    }
+  }
+}
+
 }  // namespace sommelier
 }  // namespace vm_tools
 